@@ -0,0 +1,68 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "AdaptationHotReload.h"
+
+#include "UIModel.h"
+
+#include <spdlog/spdlog.h>
+#include "SpdLogJuce.h"
+
+AdaptationHotReload::AdaptationHotReload()
+{
+	startTimer(kPollIntervalMs);
+}
+
+AdaptationHotReload::~AdaptationHotReload()
+{
+	stopTimer();
+}
+
+void AdaptationHotReload::reload(std::shared_ptr<knobkraft::GenericAdaptation> adaptation)
+{
+	if (!adaptation || !adaptation->isFromFile()) {
+		return;
+	}
+	auto oldName = adaptation->getName();
+	adaptation->reloadPython();
+	auto newName = adaptation->getName();
+	if (newName != oldName) {
+		spdlog::warn("Adaptation {} now calls itself {}, the new name will only be used after a restart", oldName, newName);
+	}
+	spdlog::info("Reloaded adaptation {}", oldName);
+	UIModel::instance()->adaptationReloads_.reloaded(oldName);
+}
+
+void AdaptationHotReload::timerCallback()
+{
+	// Pick up adaptations imported since the last tick, e.g. by activating a synth
+	for (auto const &holder : UIModel::instance()->synthList_.allSynths()) {
+		auto adaptation = std::dynamic_pointer_cast<knobkraft::GenericAdaptation>(holder.synth());
+		if (adaptation && adaptation->isFromFile() && watched_.find(adaptation.get()) == watched_.end()) {
+			File source(adaptation->getSourceFilePath());
+			auto modified = source.getLastModificationTime();
+			watched_[adaptation.get()] = { adaptation, source, modified, modified };
+		}
+	}
+
+	for (auto it = watched_.begin(); it != watched_.end();) {
+		auto adaptation = it->second.adaptation.lock();
+		if (!adaptation) {
+			it = watched_.erase(it);
+			continue;
+		}
+		auto &watched = it->second;
+		auto modified = watched.source.getLastModificationTime();
+		if (modified != watched.loaded) {
+			if (modified == watched.seen) {
+				watched.loaded = modified;
+				reload(adaptation);
+			}
+			watched.seen = modified;
+		}
+		it++;
+	}
+}
@@ -0,0 +1,41 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include "GenericAdaptation.h"
+
+#include <map>
+#include <memory>
+#include <string>
+
+// Reloads the Python module of a user adaptation when its file changes, so developing an adaptation needs no restart of the Orm.
+// The GenericAdaptation instance stays the same, as the patches in the database and the UI refer to it, only its module, function
+// table and caches are renewed. Only adaptations already imported are watched, by polling their file's modification time.
+class AdaptationHotReload : private Timer {
+public:
+	AdaptationHotReload();
+	~AdaptationHotReload() override;
+
+	// Reloads now, and tells everybody holding results of the old module via UIModel::adaptationReloads_
+	static void reload(std::shared_ptr<knobkraft::GenericAdaptation> adaptation);
+
+private:
+	struct Watched {
+		std::weak_ptr<knobkraft::GenericAdaptation> adaptation;
+		File source;
+		Time loaded; // Modification time of the file imported
+		Time seen; // Changed, but wait for it to stay the same for a tick, as editors might write in several steps
+	};
+
+	void timerCallback() override;
+
+	static constexpr int kPollIntervalMs = 1000;
+
+	std::map<knobkraft::GenericAdaptation *, Watched> watched_;
+};
@@ -12,18 +12,109 @@
 #include "ProgramDumpCapability.h"
 #include "BankDumpCapability.h"
 
+#include "AdaptationHotReload.h"
+
 #include <fmt/format.h>
+#include <spdlog/spdlog.h>
 
 namespace knobkraft {
 
+	void CallStatisticsTableModel::setStatistics(std::vector<AdaptationCallProfiler::FunctionStatistics> const &statistics)
+	{
+		statistics_ = statistics;
+		sort();
+	}
+
+	std::vector<AdaptationCallProfiler::FunctionStatistics> const &CallStatisticsTableModel::statistics() const
+	{
+		return statistics_;
+	}
+
+	int CallStatisticsTableModel::getNumRows()
+	{
+		return (int) statistics_.size();
+	}
+
+	void CallStatisticsTableModel::paintRowBackground(Graphics &g, int rowNumber, int width, int height, bool rowIsSelected)
+	{
+		ignoreUnused(width, height);
+		auto &lookAndFeel = LookAndFeel::getDefaultLookAndFeel();
+		if (rowIsSelected) {
+			g.fillAll(lookAndFeel.findColour(TextEditor::highlightColourId));
+		}
+		else if (rowNumber % 2) {
+			g.fillAll(lookAndFeel.findColour(ListBox::backgroundColourId).interpolatedWith(lookAndFeel.findColour(ListBox::textColourId), 0.03f));
+		}
+	}
+
+	void CallStatisticsTableModel::paintCell(Graphics &g, int rowNumber, int columnId, int width, int height, bool rowIsSelected)
+	{
+		ignoreUnused(rowIsSelected);
+		if (rowNumber < 0 || rowNumber >= (int) statistics_.size()) return;
+		auto const &stats = statistics_[(size_t) rowNumber];
+		std::string text;
+		switch (columnId) {
+		case FUNCTION: text = stats.functionName; break;
+		case CALLS: text = fmt::format("{}", stats.calls); break;
+		case TOTAL: text = fmt::format("{:.1f}", stats.totalMilliseconds); break;
+		case P50: text = fmt::format("{:.3f}", stats.p50Milliseconds); break;
+		case P99: text = fmt::format("{:.3f}", stats.p99Milliseconds); break;
+		case BYTES_IN: text = fmt::format("{}", stats.bytesIn); break;
+		case BYTES_OUT: text = fmt::format("{}", stats.bytesOut); break;
+		default: break;
+		}
+		g.setColour(LookAndFeel::getDefaultLookAndFeel().findColour(ListBox::textColourId));
+		g.drawText(text, 2, 0, width - 4, height, columnId == FUNCTION ? Justification::centredLeft : Justification::centredRight, true);
+	}
+
+	void CallStatisticsTableModel::sortOrderChanged(int newSortColumnId, bool isForwards)
+	{
+		sortColumn_ = newSortColumnId;
+		sortForwards_ = isForwards;
+		sort();
+	}
+
+	void CallStatisticsTableModel::sort()
+	{
+		auto key = [this](AdaptationCallProfiler::FunctionStatistics const &stats) -> double {
+			switch (sortColumn_) {
+			case CALLS: return (double) stats.calls;
+			case TOTAL: return stats.totalMilliseconds;
+			case P50: return stats.p50Milliseconds;
+			case P99: return stats.p99Milliseconds;
+			case BYTES_IN: return (double) stats.bytesIn;
+			case BYTES_OUT: return (double) stats.bytesOut;
+			default: return 0.0;
+			}
+		};
+		std::stable_sort(statistics_.begin(), statistics_.end(), [&](AdaptationCallProfiler::FunctionStatistics const &a, AdaptationCallProfiler::FunctionStatistics const &b) {
+			if (sortColumn_ == FUNCTION) {
+				return sortForwards_ ? a.functionName < b.functionName : a.functionName > b.functionName;
+			}
+			return sortForwards_ ? key(a) < key(b) : key(a) > key(b);
+		});
+	}
+
 	AdaptationView::AdaptationView() : extraFunctions_(900, LambdaButtonStrip::Direction::Horizontal)
 	{
 		addAndMakeVisible(adaptationInfo_);
 
+		auto &header = callStatistics_.getHeader();
+		header.addColumn("Function", CallStatisticsTableModel::FUNCTION, 180);
+		header.addColumn("Calls", CallStatisticsTableModel::CALLS, 60);
+		header.addColumn("Total ms", CallStatisticsTableModel::TOTAL, 70);
+		header.addColumn("p50 ms", CallStatisticsTableModel::P50, 60);
+		header.addColumn("p99 ms", CallStatisticsTableModel::P99, 60);
+		header.addColumn("Bytes in", CallStatisticsTableModel::BYTES_IN, 70);
+		header.addColumn("Bytes out", CallStatisticsTableModel::BYTES_OUT, 70);
+		header.setSortColumnId(CallStatisticsTableModel::TOTAL, false);
+		callStatistics_.setModel(&callStatisticsModel_);
+		addAndMakeVisible(callStatistics_);
+
 		LambdaButtonStrip::TButtonMap buttons = {
 			{ "ReloadAdaptation", { "Reload python file", [this]() {
 				if (adaptation_ && adaptation_->isFromFile()) {
-					adaptation_->reloadPython();
+					AdaptationHotReload::reload(adaptation_);
 					setupForAdaptation(adaptation_);
 				}
 				else {
@@ -51,6 +142,12 @@ namespace knobkraft {
 							adaptationSource.revealToUser();
 					}
 				}
+			}}},
+			{ "RefreshStatistics", { "Refresh call statistics", [this]() {
+				refreshCallStatistics();
+			}}},
+			{ "ExportStatistics", { "Export call statistics", [this]() {
+				exportCallStatistics();
 			}}}
 		};
 
@@ -107,6 +204,33 @@ namespace knobkraft {
 		knobkraftWiki_.setButtonText(adaptation_->getName() + " in the KnobKraft Wiki");
 		String pageName = String(adaptation_->getName()).replace(" ", "-");
 		knobkraftWiki_.setURL(URL("https://github.com/christofmuc/KnobKraft-orm/wiki/" + pageName));
+
+		refreshCallStatistics();
+	}
+
+	void AdaptationView::refreshCallStatistics()
+	{
+		if (adaptation_) {
+			callStatisticsModel_.setStatistics(adaptation_->callProfiler().statistics());
+		}
+		else {
+			callStatisticsModel_.setStatistics({});
+		}
+		callStatistics_.updateContent();
+		callStatistics_.repaint();
+	}
+
+	void AdaptationView::exportCallStatistics()
+	{
+		if (!adaptation_) return;
+		refreshCallStatistics();
+		FileChooser csvChooser("Please enter the name of the CSV file to export the call statistics to...", File::getSpecialLocation(File::userDocumentsDirectory), "*.csv");
+		if (csvChooser.browseForFileToSave(true)) {
+			auto csv = AdaptationCallProfiler::toCsv(callStatisticsModel_.statistics());
+			if (!csvChooser.getResult().replaceWithText(csv)) {
+				spdlog::error("Failed to write call statistics to {}", csvChooser.getResult().getFullPathName().toStdString());
+			}
+		}
 	}
 
 	void AdaptationView::resized()
@@ -127,7 +251,11 @@ namespace knobkraft {
 		layout.alignContent = FlexBox::AlignContent::stretch;
 		layout.justifyContent = FlexBox::JustifyContent::center;
 		layout.items.add(FlexItem(leftColumn).withWidth(600).withMargin({ 0, 4, 0, 0 }));
-		layout.items.add(FlexItem(adaptationInfo_).withWidth(600).withMargin({ 0, 0, 0, 4 }));
+		FlexBox rightColumn;
+		rightColumn.flexDirection = FlexBox::Direction::column;
+		rightColumn.items.add(FlexItem(adaptationInfo_).withFlex(1.0f));
+		rightColumn.items.add(FlexItem(callStatistics_).withHeight(220).withMargin({ 8, 0, 0, 0 }));
+		layout.items.add(FlexItem(rightColumn).withWidth(600).withMargin({ 0, 0, 0, 4 }));
 		layout.performLayout(area.reduced(8));
 	}
 
@@ -15,6 +15,35 @@
 
 namespace knobkraft {
 
+	// Sortable table of the call statistics recorded by the GenericAdaptation
+	class CallStatisticsTableModel : public TableListBoxModel {
+	public:
+		enum Columns {
+			FUNCTION = 1,
+			CALLS,
+			TOTAL,
+			P50,
+			P99,
+			BYTES_IN,
+			BYTES_OUT
+		};
+
+		void setStatistics(std::vector<AdaptationCallProfiler::FunctionStatistics> const &statistics);
+		std::vector<AdaptationCallProfiler::FunctionStatistics> const &statistics() const;
+
+		int getNumRows() override;
+		void paintRowBackground(Graphics &g, int rowNumber, int width, int height, bool rowIsSelected) override;
+		void paintCell(Graphics &g, int rowNumber, int columnId, int width, int height, bool rowIsSelected) override;
+		void sortOrderChanged(int newSortColumnId, bool isForwards) override;
+
+	private:
+		void sort();
+
+		std::vector<AdaptationCallProfiler::FunctionStatistics> statistics_;
+		int sortColumn_ = TOTAL;
+		bool sortForwards_ = false;
+	};
+
 	class AdaptationView : public Component {
 	public:
 		AdaptationView();
@@ -24,11 +53,16 @@ namespace knobkraft {
 		virtual void resized() override;
 
 	private:
+		void refreshCallStatistics();
+		void exportCallStatistics();
+
 		std::shared_ptr<GenericAdaptation> adaptation_;
 
 		InfoText setupHelp_;
 		InfoText adaptationInfo_;
 		HyperlinkButton knobkraftWiki_;
+		CallStatisticsTableModel callStatisticsModel_;
+		TableListBox callStatistics_;
 
 		LambdaButtonStrip extraFunctions_;
 	};
@@ -0,0 +1,64 @@
+/*
+   Copyright (c) 2020 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "AutoCategorizeJob.h"
+
+#include "ParallelFor.h"
+
+#include <spdlog/spdlog.h>
+#include "SpdLogJuce.h"
+
+#include <algorithm>
+
+void AutoCategorizeJob::restrictTo(std::function<bool(midikraft::PatchHolder const &)> mightChange)
+{
+	mightChange_ = mightChange;
+}
+
+bool AutoCategorizeJob::run()
+{
+	try {
+		// The UI connection made the backup when it opened the file
+		database_ = std::make_unique<midikraft::PatchDatabase>(databaseFile_.getFullPathName().toStdString(), midikraft::PatchDatabase::OpenMode::READ_WRITE_NO_BACKUPS);
+	}
+	catch (std::exception &e) {
+		spdlog::error("Failed to open {} for the auto categorization: {}", databaseFile_.getFullPathName(), e.what());
+		return false;
+	}
+	// Load the auto category file and re-categorize everything!
+	if (detector_->autoCategoryFileExists()) {
+		detector_->loadFromFile(database_->getCategories(), detector_->getAutoCategoryFile().getFullPathName().toStdString());
+	}
+	setStatus("Loading patches");
+	auto patches = database_->getPatches(activeFilter_, 0, 100000);
+	setStatus(String(patches.size()) + " patches");
+
+	// Matching the rules is the expensive part and runs on all cores, the database is only written from this thread
+	std::vector<uint8> changed(patches.size(), 0);
+	bool completed = parallelFor(patches.size(), [this, &patches, &changed](size_t i) {
+		if (!mightChange_ || mightChange_(patches[i])) {
+			changed[i] = patches[i].autoCategorizeAgain(detector_) ? 1 : 0;
+		}
+	}, [this](double progress) {
+		setProgress(progress);
+		return !shouldExit();
+	}, 0.0, 0.8);
+
+	if (completed) {
+		size_t numberChanged = (size_t) std::count(changed.begin(), changed.end(), 1);
+		setStatus(String(numberChanged) + " of " + String(patches.size()) + " patches changed");
+		size_t written = 0;
+		for (size_t i = 0; i < patches.size(); i++) {
+			if (!changed[i]) continue;
+			if (shouldExit()) break;
+			// This was changed, updating database
+			spdlog::info("Updating patch {} with new categories", patches[i].name());
+			database_->putPatch(patches[i]);
+			setProgress(0.8 + 0.2 * ++written / (double) numberChanged);
+		}
+	}
+	return completed;
+}
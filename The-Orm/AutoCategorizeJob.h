@@ -0,0 +1,40 @@
+/*
+   Copyright (c) 2020 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include "AutomaticCategory.h"
+#include "Logger.h"
+
+#include "BackgroundJobs.h"
+#include "UIModel.h"
+#include "PatchDatabase.h"
+
+#include <memory>
+
+// Reads and writes through its own connection to the database file, the connection of the UI is never touched from the job thread
+class AutoCategorizeJob : public BackgroundJob {
+public:
+	AutoCategorizeJob(File const &database, std::shared_ptr<midikraft::AutomaticCategory> detector, midikraft::PatchFilter activeFilter) :
+		BackgroundJob("Re-running auto categorization"), databaseFile_(database), detector_(detector), activeFilter_(activeFilter)
+	{
+	}
+
+	// Only patches passing this test are evaluated again, the others are known not to be affected by the rule changes
+	void restrictTo(std::function<bool(midikraft::PatchHolder const &)> mightChange);
+
+	virtual bool run() override;
+
+private:
+	File databaseFile_;
+	std::unique_ptr<midikraft::PatchDatabase> database_; // Opened by run()
+	std::shared_ptr<midikraft::AutomaticCategory> detector_;
+	midikraft::PatchFilter activeFilter_;
+	std::function<bool(midikraft::PatchHolder const &)> mightChange_;
+};
+
@@ -7,6 +7,7 @@
 #include "AutoDetectProgressWindow.h"
 
 #include "UIModel.h"
+#include "ConcurrentAutoDetection.h"
 
 AutoDetectProgressWindow::AutoDetectProgressWindow(std::vector<midikraft::SynthHolder> synths) :
 	ProgressHandlerWindow("Running auto-detection", "Detecting synth...")
@@ -34,7 +35,11 @@ void AutoDetectProgressWindow::run()
 			synths.push_back(synth.lock());
 		}
 	}
-	autodetector_.autoconfigure(synths, this);
+	// Probe all synths at once instead of one after the other, then store what was found
+	ConcurrentAutoDetection::autoconfigure(synths, this);
+	for (auto const &synth : synths) {
+		autodetector_.persistSetting(synth.get());
+	}
 	if (!shouldAbort()) {
 		onSuccess();
 	}
@@ -6,137 +6,295 @@
 
 #include "AutoThumbnailingDialog.h"
 
-#include "WaitForEvent.h"
 #include "Logger.h"
 #include "UIModel.h"
+#include "Settings.h"
+
+#include "DiscoverableDevice.h"
+#include "MidiLocationCapability.h"
 
 #include <spdlog/spdlog.h>
+#include <fmt/format.h>
 
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <set>
+
+namespace {
+
+	constexpr double kMaxRecordingSeconds = 60.0;
+	constexpr double kOnsetTimeoutMs = 5000.0;
+	constexpr double kMinSettleMs = 30.0;
+	// An onset this much later than the fastest one seen means the synth was still busy with the patch when the note came
+	constexpr double kLateOnsetMs = 40.0;
+	constexpr int kMaxFailuresInARow = 3;
+	// How often onsets and releases are looked for, the recorder can't wake us up without taking a lock on the audio thread
+	constexpr double kPollMs = 20.0;
+	// Bounds how stale the progress display can get
+	constexpr double kMaxWaitMs = 1000.0;
+
+	std::string channelSettingKey(std::shared_ptr<midikraft::Synth> synth) {
+		// The input channel counted from 1, as shown in the audio setup
+		return "thumbnailChannel-" + synth->getName();
+	}
+
+	struct LoadedPatches {
+		WaitableEvent loaded;
+		std::vector<midikraft::PatchHolder> patches;
+	};
 
-AutoThumbnailingDialog::AutoThumbnailingDialog(PatchView &patchView, RecordingView &recordingView) : 
-	ThreadWithProgressWindow("Recording patch thumbnails", true, true), patchView_(patchView), recordingView_(recordingView)
-{
-	UIModel::instance()->currentPatch_.addChangeListener(this);
-	UIModel::instance()->thumbnails_.addChangeListener(this);
 }
 
-AutoThumbnailingDialog::~AutoThumbnailingDialog()
+AutoThumbnailingDialog::AutoThumbnailingDialog(PatchView &patchView, RecordingView &recordingView) :
+	ThreadWithProgressWindow("Recording patch thumbnails", true, true), patchView_(patchView), recordingView_(recordingView)
+	, recorder_(RecordingView::kMaxInputChannels)
 {
-	UIModel::instance()->currentPatch_.removeChangeListener(this);
-	UIModel::instance()->thumbnails_.removeChangeListener(this);
 }
 
-bool AutoThumbnailingDialog::syncSwitchToNextPatch() {
-	// Select the next patch. This is asynchronous, because the database might need to load
-	patchSwitched_ = false;
+std::vector<midikraft::PatchHolder> AutoThumbnailingDialog::loadPatches()
+{
+	// The database is queried from the message thread, the shared state outlives us should we give up waiting
+	auto result = std::make_shared<LoadedPatches>();
 	PatchView *patchView = &patchView_;
-	MessageManager::callAsync([patchView]() {
-		patchView->selectNextPatch();
+	MessageManager::callAsync([patchView, result]() {
+		patchView->loadPatchesOfCurrentFilter([result](std::vector<midikraft::PatchHolder> patches) {
+			result->patches = std::move(patches);
+			result->loaded.signal();
+		});
 	});
-	return waitForPatchSwitchAndSendToSynth();
+	while (!threadShouldExit()) {
+		if (result->loaded.wait(100)) {
+			return result->patches;
+		}
+	}
+	return {};
 }
 
-bool AutoThumbnailingDialog::waitForPatchSwitchAndSendToSynth() {
-	WaitForEvent waiter1([this]() { return patchSwitched_;  }, this);
-	waiter1.startThread();
-	if (!wait(1000)) {
-		waiter1.stopThread(1000);
-		// No more patches!
-		return false;
+std::vector<AutoThumbnailingDialog::Lane> AutoThumbnailingDialog::createLanes(std::vector<midikraft::PatchHolder> const &patches)
+{
+	// Keep the order of the synths as they first appear in the filter
+	std::vector<std::shared_ptr<midikraft::Synth>> synths;
+	std::map<std::string, std::vector<midikraft::PatchHolder>> patchesBySynth;
+	for (auto const &patch : patches) {
+		auto synth = patch.smartSynth();
+		if (!synth || !patch.patch()) continue;
+		auto &list = patchesBySynth[synth->getName()];
+		if (list.empty()) {
+			synths.push_back(synth);
+		}
+		list.push_back(patch);
 	}
 
-	// Now, each synth needs a different amount of time to process the new patch and be able to play the first note with it
-	// let's use the detection interval as a hint
-	auto synth = UIModel::instance()->currentSynth_.smartSynth();
-	auto discoverableDevice = std::dynamic_pointer_cast<midikraft::DiscoverableDevice>(synth);
-	if (discoverableDevice) {
-		sleep(discoverableDevice->deviceDetectSleepMS());
+	std::vector<Lane> lanes;
+	std::set<int> usedChannels;
+	int nextFreeChannel = 0;
+	for (auto const &synth : synths) {
+		auto device = std::dynamic_pointer_cast<midikraft::DiscoverableDevice>(synth);
+		if (!device || !device->wasDetected()) {
+			spdlog::error("Cannot record patches when the {} hasn't been detected!", synth->getName());
+			continue;
+		}
+		if (!midikraft::Capability::hasCapability<midikraft::MidiLocationCapability>(synth)) {
+			spdlog::error("Cannot record patches of the {}, it has no MIDI channel to play the note on", synth->getName());
+			continue;
+		}
+
+		int channel;
+		auto key = channelSettingKey(synth);
+		if (Settings::instance().keyIsSet(key)) {
+			channel = std::atoi(Settings::instance().get(key).c_str()) - 1;
+		}
+		else {
+			while (usedChannels.count(nextFreeChannel)) nextFreeChannel++;
+			channel = nextFreeChannel;
+		}
+		if (channel < 0 || channel >= recorder_.numInputChannels()) {
+			spdlog::warn("Skipping the {}, its audio input {} is not active. Enable more inputs in the audio setup or set {} in the settings file", synth->getName(), channel + 1, key);
+			continue;
+		}
+		if (usedChannels.count(channel)) {
+			spdlog::warn("Skipping the {}, audio input {} is already used by another synth. Set {} in the settings file", synth->getName(), channel + 1, key);
+			continue;
+		}
+		usedChannels.insert(channel);
+
+		Lane lane;
+		lane.synth = synth;
+		lane.channel = channel;
+		lane.patches = patchesBySynth[synth->getName()];
+		// The detection sleep is a generous upper bound of how long the synth needs, start well below it and learn
+		auto detectSleep = (double) device->deviceDetectSleepMS();
+		lane.maxSettleMs = std::max(kMinSettleMs, detectSleep * 2.0);
+		lane.settleMs = std::max(kMinSettleMs, detectSleep / 4.0);
+		spdlog::info("Recording {} patches of the {} on audio input {}", lane.patches.size(), synth->getName(), channel + 1);
+		lanes.push_back(std::move(lane));
 	}
-	return true;
+	return lanes;
 }
 
-bool AutoThumbnailingDialog::syncSwitchToFirstPatch() {
-	// Select the next patch. This is asynchronous, because the database might need to load
-	patchSwitched_ = false;
-	PatchView *patchView = &patchView_;
-	MessageManager::callAsync([patchView]() {
-		patchView->selectFirstPatch();
-	});
-	return waitForPatchSwitchAndSendToSynth();
+void AutoThumbnailingDialog::nextPatch(Lane &lane, double nowMs)
+{
+	lane.current++;
+	lane.step = lane.current < lane.patches.size() ? Lane::Step::SendPatch : Lane::Step::Finished;
+	lane.stepStartedMs = nowMs;
 }
 
+void AutoThumbnailingDialog::adaptSettleTime(Lane &lane, double onsetLatencyMs)
+{
+	if (lane.fastestOnsetMs < 0.0 || onsetLatencyMs < lane.fastestOnsetMs) {
+		lane.fastestOnsetMs = onsetLatencyMs;
+	}
+	auto lateBy = onsetLatencyMs - lane.fastestOnsetMs;
+	if (lateBy > kLateOnsetMs) {
+		// The synth was not ready, back off quickly
+		lane.settleMs = std::min(lane.maxSettleMs, lane.settleMs * 1.5 + lateBy);
+	}
+	else {
+		lane.settleMs = std::max(kMinSettleMs, lane.settleMs * 0.9);
+	}
+}
 
-bool AutoThumbnailingDialog::syncRecordThumbnail() {
-	// Record the current patch
-	thumbnailDone_ = false;
-	recordingView_.sampleNote();
-
-	// First check that we can actually record a signal, that should be quick
-	WaitForEvent waitingForSignal([&]() { return recordingView_.hasDetectedSignal(); }, this);
-	WaitForEvent waitingForDone([this]() { return thumbnailDone_; }, this);
-	waitingForSignal.startThread();
-	if (wait(5000)) {
-		waitingForDone.startThread();
-		if (wait(60000)) {
-			// What do we do in case of drones?
+bool AutoThumbnailingDialog::step(Lane &lane, double nowMs)
+{
+	switch (lane.step) {
+	case Lane::Step::SendPatch: {
+		auto synth = lane.synth;
+		auto patch = lane.patches[lane.current].patch();
+		MessageManager::callAsync([synth, patch]() {
+			synth->sendDataFileToSynth(patch, nullptr);
+		});
+		lane.step = Lane::Step::Settle;
+		lane.stepStartedMs = nowMs;
+		break;
+	}
+	case Lane::Step::Settle:
+		if (nowMs - lane.stepStartedMs >= lane.settleMs) {
+			if (!recorder_.arm(lane.channel, kMaxRecordingSeconds)) {
+				spdlog::error("Could not start recording on audio input {}, is the audio device still running?", lane.channel + 1);
+				lane.step = Lane::Step::Finished;
+				break;
+			}
+			auto synth = lane.synth;
+			RecordingView *recordingView = &recordingView_;
+			MessageManager::callAsync([synth, recordingView]() {
+				recordingView->sendSampleNote(synth);
+			});
+			lane.step = Lane::Step::WaitForOnset;
+			lane.stepStartedMs = Time::getMillisecondCounterHiRes();
 		}
-		else {
-			waitingForDone.stopThread(1000);
-			spdlog::info("That was a never ending patch - you're sure you're not recording something else?");
-			return false;
+		break;
+	case Lane::Step::WaitForOnset:
+		if (recorder_.state(lane.channel) != ParallelThumbnailRecorder::State::Armed) {
+			adaptSettleTime(lane, recorder_.onsetTimeMs(lane.channel) - lane.stepStartedMs);
+			lane.failuresInARow = 0;
+			lane.step = Lane::Step::Recording;
+		}
+		else if (nowMs - lane.stepStartedMs > kOnsetTimeoutMs) {
+			recorder_.disarm(lane.channel);
+			// Wait for the audio thread to let go of the channel, then drop the empty recording
+			while (recorder_.state(lane.channel) == ParallelThumbnailRecorder::State::Armed && !threadShouldExit()) {
+				wait((int) kPollMs);
+			}
+			recorder_.discard(lane.channel);
+			spdlog::warn("No sound from the {} for patch {}, please check the audio input {}", lane.synth->getName(), lane.patches[lane.current].name(), lane.channel + 1);
+			if (++lane.failuresInARow >= kMaxFailuresInARow) {
+				spdlog::error("Giving up on the {} after {} patches without sound", lane.synth->getName(), kMaxFailuresInARow);
+				lane.step = Lane::Step::Finished;
+			}
+			else {
+				// Maybe the synth just needs longer for this kind of patch
+				lane.settleMs = lane.maxSettleMs;
+				nextPatch(lane, nowMs);
+			}
+		}
+		break;
+	case Lane::Step::Recording:
+		if (recorder_.state(lane.channel) == ParallelThumbnailRecorder::State::Done) {
+			auto const &patch = lane.patches[lane.current];
+			if (recorder_.truncated(lane.channel)) {
+				spdlog::info("Patch {} of the {} did not end within {} seconds, keeping the beginning", patch.name(), lane.synth->getName(), (int) kMaxRecordingSeconds);
+			}
+			auto file = UIModel::getPrehearDirectory().getChildFile(patch.md5() + ".wav");
+			bool written = recorder_.writeWav(lane.channel, file);
+			nextPatch(lane, nowMs);
+			if (written) {
+				MessageManager::callAsync([]() {
+					UIModel::instance()->thumbnails_.sendChangeMessage();
+				});
+				return true;
+			}
+			spdlog::error("Could not write thumbnail file {}", file.getFullPathName().toStdString());
 		}
+		break;
+	case Lane::Step::Finished:
+		break;
 	}
-	else {
-		waitingForSignal.stopThread(1000);
-		spdlog::error("No patch could be recorded, please check the Audio setup in the AudioIn view!");
-		return false;
+	return false;
+}
+
+double AutoThumbnailingDialog::msUntilNextDeadline(Lane const &lane, double nowMs) const
+{
+	switch (lane.step) {
+	case Lane::Step::SendPatch:
+		return 0.0;
+	case Lane::Step::Settle:
+		return lane.stepStartedMs + lane.settleMs - nowMs;
+	case Lane::Step::WaitForOnset:
+		return std::min(kPollMs, lane.stepStartedMs + kOnsetTimeoutMs - nowMs);
+	case Lane::Step::Recording:
+		// Ends with the release
+		return kPollMs;
+	case Lane::Step::Finished:
+		break;
 	}
-	return true;
+	return kMaxWaitMs;
 }
 
 void AutoThumbnailingDialog::run()
 {
-	// We need a current Synth, and that needs to be detected successfully!
-	auto synth = UIModel::instance()->currentSynth_.smartSynth();
-	if (!synth) {
-		jassertfalse; // This would be a program error
-		return; 
+	auto patches = loadPatches();
+	if (patches.empty()) {
+		return;
 	}
 
-	auto location = std::dynamic_pointer_cast<midikraft::DiscoverableDevice>(synth);
-	if (!location || !location->wasDetected()) {
-		spdlog::error("Cannot record patches when the {} hasn't been detected!", synth->getName());
+	// Onsets and releases are polled for, everything else is a known deadline
+	// Registering calls audioDeviceAboutToStart, only then the recorder knows how many inputs the lanes can use
+	recordingView_.addAudioCallback(&recorder_);
+	auto lanes = createLanes(patches);
+	if (lanes.empty()) {
+		recordingView_.removeAudioCallback(&recorder_);
+		spdlog::error("None of the synths of the selected patches can be recorded, please check the Audio setup in the AudioIn view!");
 		return;
 	}
+	size_t total = 0;
+	for (auto const &lane : lanes) total += lane.patches.size();
 
-	// Loop over all selected patches and record the thumbnails!
-	if (syncSwitchToFirstPatch()) {
-		int recordedCount = 1;
-		int toRecord = patchView_.totalNumberOfPatches();
-		while (!threadShouldExit()) {
-			// Record current patch
-			if (!syncRecordThumbnail()) {
-				break;
-			}
-
-			// Switch to next Patch
-			if (!syncSwitchToNextPatch()) {
-				// That didn't work, no more patches
-				break;
+	size_t done = 0;
+	while (!threadShouldExit()) {
+		bool allFinished = true;
+		auto now = Time::getMillisecondCounterHiRes();
+		for (auto &lane : lanes) {
+			auto before = lane.current;
+			if (step(lane, now)) {
+				thumbnailsWritten_++;
 			}
-
-			setProgress(recordedCount++ / (double)toRecord);
+			done += lane.current - before;
+			allFinished = allFinished && lane.step == Lane::Step::Finished;
 		}
-	}
-}
+		setProgress(done / (double) total);
+		setStatusMessage(fmt::format("Recorded {} of {} patches on {} synths", thumbnailsWritten_, total, lanes.size()));
+		if (allFinished) break;
 
-void AutoThumbnailingDialog::changeListenerCallback(ChangeBroadcaster* source)
-{
-	if (source == &UIModel::instance()->currentPatch_) {
-		patchSwitched_ = true;
-	}
-	else if (source == &UIModel::instance()->thumbnails_) {
-		thumbnailDone_ = true;
+		double waitMs = kMaxWaitMs;
+		now = Time::getMillisecondCounterHiRes();
+		for (auto const &lane : lanes) {
+			waitMs = std::min(waitMs, msUntilNextDeadline(lane, now));
+		}
+		if (waitMs > 0.0) {
+			wait((int) std::ceil(waitMs));
+		}
 	}
+	recordingView_.removeAudioCallback(&recorder_);
+	spdlog::info("Recorded {} thumbnails of {} patches", thumbnailsWritten_, total);
 }
-
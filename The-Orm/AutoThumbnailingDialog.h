@@ -10,24 +10,45 @@
 
 #include "PatchView.h"
 #include "RecordingView.h"
+#include "ParallelThumbnailRecorder.h"
 
-class AutoThumbnailingDialog : public ThreadWithProgressWindow, private ChangeListener {
+#include <vector>
+
+// Records the thumbnails of all patches of the current filter. Every synth with patches in the filter gets its own lane and
+// input channel of the audio device, and all lanes record at the same time. Instead of a fixed sleep after sending a patch, each lane
+// learns how long its synth needs by watching how late the note starts sounding, and a recording ends as soon as the note has released.
+class AutoThumbnailingDialog : public ThreadWithProgressWindow {
 public:
 	AutoThumbnailingDialog(PatchView &patchView, RecordingView &recordingView);
-	virtual ~AutoThumbnailingDialog() override;
 
 	virtual void run() override;
 
 private:
-	bool syncSwitchToNextPatch();
-	bool waitForPatchSwitchAndSendToSynth();
-	bool syncSwitchToFirstPatch();
-	bool syncRecordThumbnail();
-	void changeListenerCallback(ChangeBroadcaster* source) override;
+	struct Lane {
+		enum class Step { SendPatch, Settle, WaitForOnset, Recording, Finished };
+
+		std::shared_ptr<midikraft::Synth> synth;
+		int channel = 0;
+		std::vector<midikraft::PatchHolder> patches;
+		size_t current = 0;
+		Step step = Step::SendPatch;
+		double stepStartedMs = 0.0;
+		double settleMs = 0.0; // Learned, starts below the detection sleep of the synth
+		double maxSettleMs = 0.0;
+		double fastestOnsetMs = -1.0; // Shortest time from note to sound seen, the latency of the setup without the synth being busy
+		int failuresInARow = 0;
+	};
+
+	std::vector<midikraft::PatchHolder> loadPatches();
+	std::vector<Lane> createLanes(std::vector<midikraft::PatchHolder> const &patches);
+	// Advances the lane by at most one step, returns true if a patch was completed
+	bool step(Lane &lane, double nowMs);
+	void nextPatch(Lane &lane, double nowMs);
+	void adaptSettleTime(Lane &lane, double onsetLatencyMs);
+	double msUntilNextDeadline(Lane const &lane, double nowMs) const;
 
 	PatchView &patchView_;
 	RecordingView &recordingView_;
-	bool patchSwitched_;
-	bool thumbnailDone_;
+	ParallelThumbnailRecorder recorder_;
+	size_t thumbnailsWritten_ = 0;
 };
-
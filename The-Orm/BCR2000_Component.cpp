@@ -26,8 +26,20 @@
 #include <spdlog/spdlog.h>
 #include "SpdLogJuce.h"
 
+#include <algorithm>
+
 const char* kLastPathBCL = "lastPathBCL";
 
+namespace {
+
+	// A MIDI byte takes 10 bits at 31250 baud
+	constexpr double kMsPerMidiByte = 10.0 * 1000.0 / 31250.0;
+	// How far ahead of the wire controller updates are handed to the scheduler, anything beyond waits in pending_ and can still be replaced
+	constexpr double kControllerLookaheadMs = 30.0;
+	constexpr int kControllerFlushMs = 10;
+
+}
+
 // See https://www.sequencer.de/synth/index.php/B-Control-Tokenreferenz for the button layout info
 std::map<int, std::string> defaultLabels = {
 	{ 57, "Group 1"}, { 58, "Group 2"}, { 59, "Group 3"}, { 60, "Group 4"},
@@ -322,7 +334,7 @@ void BCR2000_Component::UpdateSynthListener::valueTreePropertyChanged(ValueTree&
 						if (location) {
 							spdlog::debug("Sending message to {} to update {} to new value {}",
 								UIModel::currentSynthOfPatch()->getName(), param->name(), param->valueInPatchToText(*patch_));
-							UIModel::currentSynthOfPatch()->sendBlockOfMessagesToSynth(location->midiOutput(), messages);
+							coalescer_.post(UIModel::currentSynthOfPatch(), location->midiOutput(), param->name(), messages);
 						}
 						else {
 							spdlog::error("Synth does not provide location information, can't send data to it");
@@ -407,6 +419,7 @@ BCR2000_Component::UpdateControllerListener::UpdateControllerListener(BCR2000_Co
 
 BCR2000_Component::UpdateControllerListener::~UpdateControllerListener()
 {
+	stopTimer();
 	midikraft::MidiController::instance()->removeMessageHandler(midiHandler_);
 }
 
@@ -442,7 +455,11 @@ void BCR2000_Component::UpdateControllerListener::valueTreePropertyChanged(Value
 				if (controllerSync) {
 					if (papa_->bcr2000_->wasDetected()) {
 						auto updateMessage = controllerSync->createParameterMessages(newValue, papa_->bcr2000_->channel());
-						papa_->bcr2000_->sendBlockOfMessagesToSynth(papa_->bcr2000_->midiOutput(), updateMessage);
+						if (pending_.find(paramName) == pending_.end()) {
+							pendingOrder_.push_back(paramName);
+						}
+						pending_[paramName] = updateMessage;
+						sendPending();
 					}
 					return;
 				}
@@ -450,3 +467,41 @@ void BCR2000_Component::UpdateControllerListener::valueTreePropertyChanged(Value
 		}
 	}
 }
+
+void BCR2000_Component::UpdateControllerListener::timerCallback()
+{
+	sendPending();
+}
+
+void BCR2000_Component::UpdateControllerListener::sendPending()
+{
+	auto output = papa_->bcr2000_->midiOutput();
+	if (!producer_ || producerOutput_ != output.identifier) {
+		producer_ = MidiOutputScheduler::forOutput(output).createProducer(MidiOutputScheduler::Lane::Bulk);
+		producerOutput_ = output.identifier;
+		sendCursor_ = 0.0;
+	}
+
+	auto now = Time::getMillisecondCounterHiRes();
+	sendCursor_ = std::max(sendCursor_, now);
+	size_t sent = 0;
+	while (sent < pendingOrder_.size() && sendCursor_ < now + kControllerLookaheadMs) {
+		auto const &messages = pending_[pendingOrder_[sent]];
+		for (auto const &message : messages) {
+			if (!producer_->enqueue(message, sendCursor_)) {
+				spdlog::warn("MIDI output queue full, dropping controller update");
+			}
+			sendCursor_ += message.getRawDataSize() * kMsPerMidiByte;
+		}
+		pending_.erase(pendingOrder_[sent]);
+		sent++;
+	}
+	pendingOrder_.erase(pendingOrder_.begin(), pendingOrder_.begin() + (ptrdiff_t)sent);
+
+	if (pendingOrder_.empty()) {
+		stopTimer();
+	}
+	else if (!isTimerRunning()) {
+		startTimer(kControllerFlushMs);
+	}
+}
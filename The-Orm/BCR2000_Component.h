@@ -14,6 +14,13 @@
 #include "LambdaButtonStrip.h"
 #include "Librarian.h"
 
+#include "ParameterChangeCoalescer.h"
+#include "MidiOutputScheduler.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
 class RotaryWithLabel;
 class SynthParameterDefinition;
 class Synth;
@@ -72,9 +79,13 @@ private:
 		midikraft::MidiController::HandlerHandle midiHandler_ = midikraft::MidiController::makeOneHandle();
 		std::shared_ptr<midikraft::DataFile> patch_;
 		BCR2000_Component* papa_;
+		ParameterChangeCoalescer coalescer_; // Fast knob turns are thinned out to one value per parameter and frame
 	};
 
-	class UpdateControllerListener : public ValueTree::Listener {
+	// The value tree only notifies about values that really changed, so a new patch results in updates for the differing parameters only.
+	// These are paced to what the BCR2000's MIDI input can take, and a value not sent yet is replaced by a newer one of the same parameter,
+	// so scrolling through patches sends only the latest values instead of a backlog of outdated ones
+	class UpdateControllerListener : public ValueTree::Listener, private Timer {
 	public:
 		UpdateControllerListener(BCR2000_Component* papa);
 		virtual ~UpdateControllerListener() override;
@@ -83,8 +94,16 @@ private:
 		void valueTreePropertyChanged(ValueTree& treeWhosePropertyHasChanged, const Identifier& property) override;
 
 	private:
+		void timerCallback() override;
+		void sendPending();
+
 		midikraft::MidiController::HandlerHandle midiHandler_ = midikraft::MidiController::makeOneHandle();
 		BCR2000_Component* papa_;
+		std::map<std::string, std::vector<MidiMessage>> pending_; // By parameter name
+		std::vector<std::string> pendingOrder_; // Parameters in the order they were first changed
+		std::shared_ptr<MidiOutputScheduler::Producer> producer_;
+		String producerOutput_;
+		double sendCursor_ = 0.0; // Time the MIDI output is busy until with what we handed to the scheduler
 	};
 
 	TypedNamedValueSet createParameterModel();
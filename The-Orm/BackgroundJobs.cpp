@@ -0,0 +1,310 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "BackgroundJobs.h"
+
+#include <spdlog/spdlog.h>
+#include "SpdLogJuce.h"
+
+#include <algorithm>
+
+std::unique_ptr<BackgroundJobs> BackgroundJobs::sInstance_;
+
+namespace {
+	// Upper limit for an idle wait, in case a wake up went to the other worker
+	constexpr int kMaxIdleWaitMs = 100;
+
+	class FunctionJob : public BackgroundJob {
+	public:
+		FunctionJob(String const &name, int priority, BackgroundJobs::TJobFunction work) : BackgroundJob(name, priority), work_(work) {}
+
+		bool run() override {
+			return work_([this](double progress) {
+				setProgress(progress);
+				return !shouldExit();
+			});
+		}
+
+	private:
+		BackgroundJobs::TJobFunction work_;
+	};
+}
+
+BackgroundJob::BackgroundJob(String const &name, int priority) : name_(name), priority_(priority)
+{
+}
+
+String BackgroundJob::name() const
+{
+	return name_;
+}
+
+String BackgroundJob::status() const
+{
+	ScopedLock lock(statusLock_);
+	return status_;
+}
+
+double BackgroundJob::progress() const
+{
+	return progress_;
+}
+
+int BackgroundJob::priority() const
+{
+	return priority_;
+}
+
+BackgroundJob::State BackgroundJob::state() const
+{
+	return state_;
+}
+
+bool BackgroundJob::isDone() const
+{
+	auto state = state_.load();
+	return state != State::Waiting && state != State::Running;
+}
+
+void BackgroundJob::cancel()
+{
+	cancelRequested_ = true;
+	if (BackgroundJobs::sInstance_) {
+		BackgroundJobs::sInstance_->dropIfWaiting(this);
+	}
+}
+
+void BackgroundJob::setProgress(double progress)
+{
+	progress_ = progress;
+}
+
+void BackgroundJob::setStatus(String const &status)
+{
+	ScopedLock lock(statusLock_);
+	status_ = status;
+}
+
+bool BackgroundJob::shouldExit() const
+{
+	return cancelRequested_ || Thread::currentThreadShouldExit();
+}
+
+BackgroundJobs::Worker::Worker(BackgroundJobs &jobs, int index) : Thread("Background job worker " + String(index)), jobs_(jobs)
+{
+}
+
+void BackgroundJobs::Worker::run()
+{
+	while (!threadShouldExit()) {
+		auto job = jobs_.nextReadyJob();
+		if (!job) {
+			jobs_.wakeUp_.wait(kMaxIdleWaitMs);
+			continue;
+		}
+		bool succeeded = false;
+		try {
+			succeeded = job->run();
+		}
+		catch (std::exception &e) {
+			spdlog::error("Background job {} failed: {}", job->name(), e.what());
+		}
+		std::vector<std::shared_ptr<BackgroundJob>> done;
+		{
+			ScopedLock lock(jobs_.lock_);
+			jobs_.finish(job, job->cancelRequested_ ? BackgroundJob::State::Cancelled : (succeeded ? BackgroundJob::State::Succeeded : BackgroundJob::State::Failed), done);
+		}
+		jobs_.notifyDone(done);
+	}
+}
+
+BackgroundJobs::BackgroundJobs()
+{
+	for (int i = 0; i < kNumberOfWorkers; i++) {
+		workers_.push_back(std::make_unique<Worker>(*this, i));
+		workers_.back()->startThread();
+	}
+}
+
+BackgroundJobs::~BackgroundJobs()
+{
+	{
+		ScopedLock lock(lock_);
+		stopping_ = true;
+		for (auto const &job : active_) {
+			job->cancelRequested_ = true;
+		}
+		ready_.clear();
+	}
+	for (auto &worker : workers_) {
+		worker->signalThreadShouldExit();
+	}
+	wakeUp_.signal();
+	for (auto &worker : workers_) {
+		worker->stopThread(10000);
+	}
+}
+
+BackgroundJobs &BackgroundJobs::instance()
+{
+	if (!sInstance_) {
+		sInstance_.reset(new BackgroundJobs());
+	}
+	return *sInstance_;
+}
+
+void BackgroundJobs::shutdown()
+{
+	sInstance_.reset();
+}
+
+std::shared_ptr<BackgroundJob> BackgroundJobs::add(std::shared_ptr<BackgroundJob> job, std::shared_ptr<BackgroundJob> after, std::function<void(BackgroundJob::State)> onDone)
+{
+	std::vector<std::shared_ptr<BackgroundJob>> done;
+	{
+		ScopedLock lock(lock_);
+		job->onDone_ = onDone;
+		job->sequence_ = sequence_++;
+		active_.push_back(job);
+		if (stopping_ || (after && after->isDone() && after->state() != BackgroundJob::State::Succeeded)) {
+			finish(job, BackgroundJob::State::Cancelled, done);
+		}
+		else if (after && !after->isDone()) {
+			after->dependents_.push_back(job);
+		}
+		else {
+			makeReady(job);
+		}
+	}
+	if (done.empty()) {
+		sendChangeMessage();
+	}
+	else {
+		notifyDone(done);
+	}
+	return job;
+}
+
+std::shared_ptr<BackgroundJob> BackgroundJobs::add(String const &name, int priority, TJobFunction work, std::shared_ptr<BackgroundJob> after, std::function<void(BackgroundJob::State)> onDone)
+{
+	return add(std::make_shared<FunctionJob>(name, priority, work), after, onDone);
+}
+
+std::vector<std::shared_ptr<BackgroundJob>> BackgroundJobs::jobs() const
+{
+	ScopedLock lock(lock_);
+	auto result = active_;
+	result.insert(result.end(), finished_.rbegin(), finished_.rend());
+	return result;
+}
+
+bool BackgroundJobs::hasActiveJobs() const
+{
+	ScopedLock lock(lock_);
+	return !active_.empty();
+}
+
+void BackgroundJobs::clearFinished()
+{
+	{
+		ScopedLock lock(lock_);
+		finished_.clear();
+	}
+	sendChangeMessage();
+}
+
+std::shared_ptr<BackgroundJob> BackgroundJobs::nextReadyJob()
+{
+	std::shared_ptr<BackgroundJob> job;
+	{
+		ScopedLock lock(lock_);
+		if (stopping_ || ready_.empty()) {
+			return {};
+		}
+		auto next = std::max_element(ready_.begin(), ready_.end(), [](std::shared_ptr<BackgroundJob> const &a, std::shared_ptr<BackgroundJob> const &b) {
+			return a->priority_ < b->priority_ || (a->priority_ == b->priority_ && a->sequence_ > b->sequence_);
+		});
+		job = *next;
+		ready_.erase(next);
+		job->state_ = BackgroundJob::State::Running;
+		if (!ready_.empty()) {
+			// Pass the wake up on to the other workers
+			wakeUp_.signal();
+		}
+	}
+	sendChangeMessage();
+	return job;
+}
+
+void BackgroundJobs::dropIfWaiting(BackgroundJob *job)
+{
+	std::vector<std::shared_ptr<BackgroundJob>> done;
+	{
+		ScopedLock lock(lock_);
+		auto found = std::find_if(active_.begin(), active_.end(), [job](std::shared_ptr<BackgroundJob> const &candidate) { return candidate.get() == job; });
+		if (found == active_.end() || job->state_ != BackgroundJob::State::Waiting) {
+			return;
+		}
+		finish(*found, BackgroundJob::State::Cancelled, done);
+	}
+	notifyDone(done);
+}
+
+void BackgroundJobs::finish(std::shared_ptr<BackgroundJob> const &job, BackgroundJob::State state, std::vector<std::shared_ptr<BackgroundJob>> &outDone)
+{
+	// Keep the job alive, the reference might point into one of the lists
+	auto keep = job;
+	keep->state_ = state;
+	active_.erase(std::remove(active_.begin(), active_.end(), keep), active_.end());
+	ready_.erase(std::remove(ready_.begin(), ready_.end(), keep), ready_.end());
+	finished_.push_back(keep);
+	if (finished_.size() > kFinishedJobsKept) {
+		finished_.erase(finished_.begin());
+	}
+	outDone.push_back(keep);
+
+	// Chained jobs only run after a success of their predecessor
+	auto dependents = std::move(keep->dependents_);
+	keep->dependents_.clear();
+	for (auto const &dependent : dependents) {
+		if (dependent->isDone()) {
+			// Was cancelled while waiting
+			continue;
+		}
+		if (state == BackgroundJob::State::Succeeded && !dependent->cancelRequested_ && !stopping_) {
+			makeReady(dependent);
+		}
+		else {
+			finish(dependent, BackgroundJob::State::Cancelled, outDone);
+		}
+	}
+}
+
+void BackgroundJobs::makeReady(std::shared_ptr<BackgroundJob> const &job)
+{
+	ready_.push_back(job);
+	wakeUp_.signal();
+}
+
+void BackgroundJobs::notifyDone(std::vector<std::shared_ptr<BackgroundJob>> const &done)
+{
+	sendChangeMessage();
+	for (auto const &job : done) {
+		if (job->state() == BackgroundJob::State::Failed) {
+			spdlog::warn("Background job {} failed", job->name());
+		}
+		if (job->onDone_) {
+			MessageManager::callAsync([job]() {
+				// Nobody waits for the outcome of jobs cancelled by the shutdown
+				if (sInstance_ && !sInstance_->stopping_ && job->onDone_) {
+					auto onDone = std::move(job->onDone_);
+					job->onDone_ = nullptr;
+					onDone(job->state());
+				}
+			});
+		}
+	}
+}
@@ -0,0 +1,126 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+
+// A unit of bulk work for the BackgroundJobs, implement run() and report progress and status from it.
+// Long loops inside a job should use parallelFor and stop when shouldExit() returns true
+class BackgroundJob {
+public:
+	enum class State {
+		Waiting = 0,   // For its predecessor or a free worker
+		Running = 1,
+		Succeeded = 2,
+		Failed = 3,
+		Cancelled = 4
+	};
+
+	// Jobs with a higher priority are started first, jobs of the same priority in the order they were added
+	BackgroundJob(String const &name, int priority = 0);
+	virtual ~BackgroundJob() = default;
+
+	// Called on a worker thread. Return false if the job failed, this cancels the jobs depending on it
+	virtual bool run() = 0;
+
+	String name() const;
+	String status() const;
+	double progress() const;
+	int priority() const;
+	State state() const;
+	bool isDone() const;
+
+	// Call from the message thread. A waiting job is dropped right away, a running one is asked to stop
+	void cancel();
+
+protected:
+	void setProgress(double progress);
+	void setStatus(String const &status);
+	bool shouldExit() const;
+
+private:
+	friend class BackgroundJobs;
+
+	String name_;
+	int priority_;
+	std::atomic<double> progress_ { 0.0 };
+	std::atomic<State> state_ { State::Waiting };
+	std::atomic<bool> cancelRequested_ { false };
+	mutable CriticalSection statusLock_;
+	String status_;
+
+	// Guarded by the lock of the BackgroundJobs
+	uint64 sequence_ = 0;
+	std::vector<std::shared_ptr<BackgroundJob>> dependents_;
+	std::function<void(State)> onDone_;
+};
+
+// The one place bulk work runs in the background, so the UI stays usable and all jobs are shown in one list.
+// A small number of workers take the waiting job with the highest priority, a job can be chained to run after another
+// one, e.g. categorizing after the merge of a download. Listeners are told asynchronously whenever a job is added,
+// started or done; the progress values are meant to be polled
+class BackgroundJobs : public ChangeBroadcaster {
+public:
+	~BackgroundJobs() override;
+
+	static BackgroundJobs &instance();
+	// Cancels everything and waits for the running jobs, call this before the database goes away
+	static void shutdown();
+
+	typedef std::function<bool(std::function<bool(double)> const &progress)> TJobFunction;
+
+	// Queues the job. If after is given, the job starts once it succeeded and is cancelled when it didn't.
+	// onDone is called on the message thread with the final state. Returns the job for chaining
+	std::shared_ptr<BackgroundJob> add(std::shared_ptr<BackgroundJob> job, std::shared_ptr<BackgroundJob> after = {}, std::function<void(BackgroundJob::State)> onDone = {});
+	// Wraps a function into a job, it gets a progress function that returns false when the job should stop
+	std::shared_ptr<BackgroundJob> add(String const &name, int priority, TJobFunction work, std::shared_ptr<BackgroundJob> after = {}, std::function<void(BackgroundJob::State)> onDone = {});
+
+	// The jobs not yet done followed by the most recently finished ones
+	std::vector<std::shared_ptr<BackgroundJob>> jobs() const;
+	bool hasActiveJobs() const;
+	void clearFinished();
+
+	static constexpr int kNumberOfWorkers = 2;
+	static constexpr size_t kFinishedJobsKept = 20;
+
+private:
+	friend class BackgroundJob;
+
+	class Worker : public Thread {
+	public:
+		Worker(BackgroundJobs &jobs, int index);
+		void run() override;
+
+	private:
+		BackgroundJobs &jobs_;
+	};
+
+	BackgroundJobs();
+
+	std::shared_ptr<BackgroundJob> nextReadyJob();
+	void dropIfWaiting(BackgroundJob *job);
+	// Both need the lock held, the jobs done are collected for notifyDone
+	void finish(std::shared_ptr<BackgroundJob> const &job, BackgroundJob::State state, std::vector<std::shared_ptr<BackgroundJob>> &outDone);
+	void makeReady(std::shared_ptr<BackgroundJob> const &job);
+	void notifyDone(std::vector<std::shared_ptr<BackgroundJob>> const &done);
+
+	mutable CriticalSection lock_;
+	std::vector<std::shared_ptr<BackgroundJob>> ready_;    // Their predecessor is done
+	std::vector<std::shared_ptr<BackgroundJob>> active_;   // Waiting or running, in the order added
+	std::vector<std::shared_ptr<BackgroundJob>> finished_; // Most recent last
+	uint64 sequence_ = 0;
+	bool stopping_ = false;
+	WaitableEvent wakeUp_;
+	std::vector<std::unique_ptr<Worker>> workers_;
+
+	static std::unique_ptr<BackgroundJobs> sInstance_;
+};
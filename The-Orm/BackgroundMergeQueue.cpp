@@ -0,0 +1,85 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "BackgroundMergeQueue.h"
+
+#include "PatchMergePreparation.h"
+
+#include <spdlog/spdlog.h>
+#include "SpdLogJuce.h"
+
+BackgroundMergeQueue::BackgroundMergeQueue(midikraft::PatchDatabase &database) : Thread("BackgroundMergeQueue"), database_(database), alive_(std::make_shared<bool>(true))
+{
+	startThread();
+}
+
+BackgroundMergeQueue::~BackgroundMergeQueue()
+{
+	*alive_ = false;
+	signalThreadShouldExit();
+	batchAvailable_.signal();
+	// A merge in progress is not interruptible, and killing the thread would leave the database mid-write. So wait for it
+	waitForThreadToExit(-1);
+	ScopedLock lock(queueLock_);
+	if (!queue_.empty()) {
+		spdlog::warn("{} batches of patches were not stored in the database, the app closed before", queue_.size());
+	}
+}
+
+void BackgroundMergeQueue::add(std::vector<midikraft::PatchHolder> const &patches, TMergedHandler onMerged)
+{
+	{
+		ScopedLock lock(queueLock_);
+		queue_.push_back({ patches, onMerged });
+	}
+	batchAvailable_.signal();
+}
+
+void BackgroundMergeQueue::run()
+{
+	while (!threadShouldExit()) {
+		Batch batch;
+		bool haveBatch = false;
+		{
+			ScopedLock lock(queueLock_);
+			if (!queue_.empty()) {
+				batch = std::move(queue_.front());
+				queue_.pop_front();
+				haveBatch = true;
+			}
+		}
+		if (!haveBatch) {
+			batchAvailable_.wait(500);
+			continue;
+		}
+
+		std::vector<midikraft::PatchHolder> outNewPatches;
+		if (!batch.patches.empty()) {
+			PatchMergePreparation::prepare(batch.patches, database_.getCategorizer(), [this](double) { return !threadShouldExit(); });
+			if (threadShouldExit()) {
+				// The preparation stopped half way, better store nothing than patches without it
+				break;
+			}
+			auto numberNew = PatchMergePreparation::mergeWithoutDuplicates(database_, batch.patches, outNewPatches, nullptr, midikraft::PatchDatabase::UPDATE_NAME | midikraft::PatchDatabase::UPDATE_CATEGORIES | midikraft::PatchDatabase::UPDATE_FAVORITE);
+			if (numberNew > 0) {
+				spdlog::info("Retrieved {} new or changed patches from the synth, uploaded to database", numberNew);
+			}
+			else {
+				spdlog::info("All patches already known to database");
+			}
+		}
+		auto onMerged = batch.onMerged;
+		if (onMerged) {
+			std::weak_ptr<bool> alive = alive_;
+			MessageManager::callAsync([alive, onMerged, outNewPatches]() {
+				auto stillAlive = alive.lock();
+				if (stillAlive && *stillAlive) {
+					onMerged(outNewPatches);
+				}
+			});
+		}
+	}
+}
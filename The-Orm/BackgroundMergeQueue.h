@@ -0,0 +1,45 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include "PatchDatabase.h"
+#include "PatchHolder.h"
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <vector>
+
+// Prepares and merges batches of patches into the database on a background thread, in the order they were added.
+// This lets a download from the synth continue with the next bank while the previous one is still being stored.
+// Destroying the queue waits for the batch being merged, batches not started yet are dropped, and no handler is called afterwards.
+class BackgroundMergeQueue : private Thread {
+public:
+	// Called on the message thread with the patches that were new or changed
+	using TMergedHandler = std::function<void(std::vector<midikraft::PatchHolder>)>;
+
+	explicit BackgroundMergeQueue(midikraft::PatchDatabase &database);
+	~BackgroundMergeQueue() override;
+
+	void add(std::vector<midikraft::PatchHolder> const &patches, TMergedHandler onMerged);
+
+private:
+	struct Batch {
+		std::vector<midikraft::PatchHolder> patches;
+		TMergedHandler onMerged;
+	};
+
+	void run() override;
+
+	midikraft::PatchDatabase &database_;
+	CriticalSection queueLock_;
+	std::deque<Batch> queue_;
+	WaitableEvent batchAvailable_;
+	std::shared_ptr<bool> alive_; // Posted handlers check this, so they don't run after the queue is gone
+};
@@ -0,0 +1,119 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "BackupJournal.h"
+
+#include "FileHelpers.h"
+
+#include <nlohmann/json.hpp>
+
+#include <spdlog/spdlog.h>
+#include "SpdLogJuce.h"
+
+#include <fmt/format.h>
+
+BackupJournal::BackupJournal()
+{
+	auto file = journalFile();
+	if (!file.existsAsFile()) {
+		return;
+	}
+	try {
+		auto journal = nlohmann::json::parse(file.loadFileAsString().toStdString());
+		started_ = journal.value("started", std::string());
+		for (auto const &key : journal.value("stored", std::vector<std::string>())) {
+			stored_.insert(key);
+		}
+		for (auto const &key : journal.value("missing", std::vector<std::string>())) {
+			missing_.insert(key);
+		}
+	}
+	catch (nlohmann::json::exception &e) {
+		spdlog::warn("Ignoring unreadable backup journal {}: {}", file.getFullPathName(), e.what());
+		stored_.clear();
+		missing_.clear();
+	}
+}
+
+size_t BackupJournal::banksStored(std::vector<BankDownloadScheduler::Job> const &jobs) const
+{
+	if (missing_.empty()) {
+		return 0;
+	}
+	size_t count = 0;
+	for (auto const &job : jobs) {
+		if (stored_.count(keyOf(job.synth, job.bank))) {
+			count++;
+		}
+	}
+	return count;
+}
+
+std::string BackupJournal::startedAt() const
+{
+	return started_;
+}
+
+std::vector<BankDownloadScheduler::Job> BackupJournal::continueWith(std::vector<BankDownloadScheduler::Job> const &jobs)
+{
+	std::vector<BankDownloadScheduler::Job> result;
+	missing_.clear();
+	for (auto const &job : jobs) {
+		auto key = keyOf(job.synth, job.bank);
+		if (!stored_.count(key)) {
+			result.push_back(job);
+			missing_.insert(key);
+		}
+	}
+	if (missing_.empty()) {
+		journalFile().deleteFile();
+	}
+	else {
+		save();
+	}
+	return result;
+}
+
+void BackupJournal::start(std::vector<BankDownloadScheduler::Job> const &jobs)
+{
+	started_ = Time::getCurrentTime().formatted("%Y-%m-%d %H:%M").toStdString();
+	stored_.clear();
+	continueWith(jobs);
+}
+
+void BackupJournal::bankStored(std::shared_ptr<midikraft::Synth> synth, MidiBankNumber bank)
+{
+	auto key = keyOf(synth, bank);
+	stored_.insert(key);
+	missing_.erase(key);
+	if (missing_.empty()) {
+		journalFile().deleteFile();
+		stored_.clear();
+		spdlog::info("Backup complete, all banks are stored in the database");
+	}
+	else {
+		save();
+	}
+}
+
+File BackupJournal::journalFile()
+{
+	auto knobkraftorm = getOrCreateSubdirectory(File::getSpecialLocation(File::userApplicationDataDirectory), "KnobKraftOrm");
+	return knobkraftorm.getChildFile("BackupJournal.json");
+}
+
+std::string BackupJournal::keyOf(std::shared_ptr<midikraft::Synth> synth, MidiBankNumber bank)
+{
+	return fmt::format("{}/{}", synth->getName(), bank.toZeroBased());
+}
+
+void BackupJournal::save() const
+{
+	nlohmann::json journal{ { "started", started_ }, { "stored", stored_ }, { "missing", missing_ } };
+	if (!journalFile().replaceWithText(journal.dump())) {
+		spdlog::warn("Could not write the backup journal {}", journalFile().getFullPathName());
+	}
+}
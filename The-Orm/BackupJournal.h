@@ -0,0 +1,43 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include "BankDownloadScheduler.h"
+
+#include <set>
+#include <string>
+#include <vector>
+
+// Remembers which banks of a backup of all synths are stored in the database already, so a backup interrupted by a cable
+// glitch or by closing the app can continue with the banks still missing. The journal is a small file next to the settings,
+// written after every bank stored and deleted when all banks of the backup are in.
+class BackupJournal {
+public:
+	// Reads the journal left by an earlier backup, if any
+	BackupJournal();
+
+	// How many of these jobs the interrupted backup stored already, 0 if there is none to continue
+	size_t banksStored(std::vector<BankDownloadScheduler::Job> const &jobs) const;
+	std::string startedAt() const;
+	// The jobs still missing. Call this or start() before the download
+	std::vector<BankDownloadScheduler::Job> continueWith(std::vector<BankDownloadScheduler::Job> const &jobs);
+	void start(std::vector<BankDownloadScheduler::Job> const &jobs);
+
+	// Message thread, after the bank is in the database. The journal goes away with the last bank
+	void bankStored(std::shared_ptr<midikraft::Synth> synth, MidiBankNumber bank);
+
+private:
+	static File journalFile();
+	static std::string keyOf(std::shared_ptr<midikraft::Synth> synth, MidiBankNumber bank);
+	void save() const;
+
+	std::string started_;
+	std::set<std::string> stored_;
+	std::set<std::string> missing_;
+};
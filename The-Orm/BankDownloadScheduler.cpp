@@ -0,0 +1,240 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "BankDownloadScheduler.h"
+
+#include "MidiController.h"
+#include "NetworkMidi.h"
+#include "PatchListTree.h"
+#include "ProgressHandler.h"
+#include "SettingsWriteQueue.h"
+#include "SynthBank.h"
+#include "TransferStrategy.h"
+#include "UIModel.h"
+
+#include <fmt/format.h>
+#include <spdlog/spdlog.h>
+#include "SpdLogJuce.h"
+
+#include <algorithm>
+#include <atomic>
+#include <map>
+
+namespace {
+
+	// A lane serializes all transfers to one MIDI output
+	class Lane : public midikraft::ProgressHandler {
+	public:
+		explicit Lane(std::vector<midikraft::SynthHolder> const &synths) : librarian(synths) {}
+
+		bool shouldAbort() const override { return aborted; }
+		void setProgressPercentage(double zeroToOne) override {
+			progress = zeroToOne;
+			auto now = Time::getMillisecondCounter();
+			auto gap = now - lastActivity.exchange(now);
+			if (gap > longestGap) {
+				longestGap = gap;
+			}
+		}
+		void onSuccess() override {}
+		void onCancel() override {}
+		void setMessage(std::string const &message) override { ignoreUnused(message); }
+
+		struct Attempt {
+			BankDownloadScheduler::Job job;
+			int number; // Starting with 1
+		};
+
+		midikraft::Librarian librarian;
+		std::vector<Attempt> jobs;
+		size_t next = 0;
+		bool running = false;
+		std::atomic<bool> finished { false };
+		std::atomic<bool> aborted { false };
+		std::atomic<double> progress { 0.0 };
+		std::atomic<uint32> lastActivity { 0 };
+		std::atomic<uint32> longestGap { 0 }; // Between two replies of the current bank
+		double startedMs = 0.0; // Of the current bank
+		uint32 stallTimeout = 0; // Learned per output, set when the lane is created
+		uint32 networkAllowance = 0; // For synths behind a network MIDI server, a few round trips on top
+		String outputName;
+		std::string timeoutSetting;
+		std::vector<midikraft::PatchHolder> received;
+		CriticalSection receivedLock;
+	};
+
+	// Synths not answering for this long lose their current bank. This is for synths never downloaded from, once a bank went
+	// through the timeout is learned from the longest pause seen between replies on this output
+	constexpr uint32 kStallTimeoutMs = 30000;
+	constexpr uint32 kMinStallTimeoutMs = 3000;
+	// The round trip time is measured on an idle connection, a bank transfer can fill the queues on the way
+	constexpr double kRoundTripsAllowed = 8.0;
+	// A stalled bank is tried again at the end of its lane, flaky interfaces often get through the second time
+	constexpr int kMaxAttempts = 2;
+
+	std::string stallTimeoutSetting(std::shared_ptr<midikraft::Synth> synth, String const &output) {
+		return fmt::format("StallTimeoutMs {} {}", synth->getName(), output.toStdString());
+	}
+
+	uint32 learnedStallTimeout(uint32 previous, uint32 longestGap) {
+		// Well above the slowest reply seen, and moving only part of the way so one fast bank doesn't make it tight
+		auto observed = std::clamp(longestGap * 4 + 1000, kMinStallTimeoutMs, kStallTimeoutMs);
+		return (previous * 2 + observed) / 3;
+	}
+
+}
+
+BankDownloadScheduler::BankDownloadScheduler(std::vector<midikraft::SynthHolder> const &synths, std::vector<Job> const &jobs, TBankLoaded bankLoaded) :
+	ThreadWithProgressWindow("Downloading banks from all synths", true, true), synths_(synths), jobs_(jobs), bankLoaded_(bankLoaded)
+{
+	// The settings are for the message thread, so the learned timeouts are looked up before the download starts
+	for (auto const &job : jobs_) {
+		auto location = midikraft::Capability::hasCapability<midikraft::MidiLocationCapability>(job.synth);
+		if (location) {
+			auto setting = stallTimeoutSetting(job.synth, location->midiOutput().identifier);
+			stallTimeouts_[setting] = (uint32) std::clamp(SettingsWriteQueue::instance().get(setting, (int) kStallTimeoutMs), (int) kMinStallTimeoutMs, (int) kStallTimeoutMs);
+		}
+	}
+}
+
+std::vector<BankDownloadScheduler::Job> BankDownloadScheduler::allBanksOfDetectedSynths(std::vector<midikraft::SynthHolder> const &synths)
+{
+	std::vector<Job> result;
+	for (auto const &synthHolder : synths) {
+		auto synth = synthHolder.synth();
+		auto device = synthHolder.device();
+		if (!synth || !device || !device->wasDetected() || !UIModel::instance()->synthList_.isSynthActive(device)) {
+			continue;
+		}
+		auto location = midikraft::Capability::hasCapability<midikraft::MidiLocationCapability>(synth);
+		if (!location || !location->channel().isValid()) {
+			continue;
+		}
+		size_t banks = PatchListTree::numberOfBanks(synth);
+		for (int i = 0; i < (int)banks; i++) {
+			result.push_back({ synth, MidiBankNumber::fromZeroBase(i, midikraft::SynthBank::numberOfPatchesInBank(synth, i)) });
+		}
+	}
+	return result;
+}
+
+void BankDownloadScheduler::run()
+{
+	// Group the jobs by output
+	// The message thread runs the Librarian calls of the lanes, and needs them to stay around until it did
+	std::map<String, std::shared_ptr<Lane>> lanes;
+	for (auto const &job : jobs_) {
+		auto location = midikraft::Capability::hasCapability<midikraft::MidiLocationCapability>(job.synth);
+		if (!location) {
+			continue;
+		}
+		auto &lane = lanes[location->midiOutput().identifier];
+		if (!lane) {
+			lane = std::make_shared<Lane>(synths_);
+			midikraft::MidiController::instance()->enableMidiInput(location->midiInput());
+			// Lanes are per output, the first synth on it names the learned timeout
+			lane->outputName = location->midiOutput().name;
+			lane->timeoutSetting = stallTimeoutSetting(job.synth, location->midiOutput().identifier);
+			lane->stallTimeout = stallTimeouts_[lane->timeoutSetting];
+		}
+		lane->jobs.push_back({ job, 1 });
+	}
+
+	size_t total = jobs_.size();
+	while (!threadShouldExit()) {
+		double done = 0.0;
+		bool allDone = true;
+		for (auto &entry : lanes) {
+			auto &lane = *entry.second;
+			auto lanePtr = entry.second;
+			if (lane.running && Time::getMillisecondCounter() - lane.lastActivity > lane.stallTimeout + lane.networkAllowance) {
+				auto attempt = lane.jobs[lane.next];
+				MessageManager::callAsync([lanePtr]() {
+					lanePtr->librarian.clearHandlers();
+				});
+				lane.running = false;
+				lane.next++;
+				if (attempt.number < kMaxAttempts) {
+					spdlog::warn("No reply from {} for {} seconds, trying {} again later", attempt.job.synth->getName(), lane.stallTimeout / 1000, midikraft::SynthBank::friendlyBankName(attempt.job.synth, attempt.job.bank));
+					lane.jobs.push_back({ attempt.job, attempt.number + 1 });
+					total++;
+				}
+				else {
+					spdlog::warn("No reply from {} for {} seconds, skipping {}", attempt.job.synth->getName(), lane.stallTimeout / 1000, midikraft::SynthBank::friendlyBankName(attempt.job.synth, attempt.job.bank));
+					banksFailed_++;
+				}
+			}
+			if (lane.running && lane.finished) {
+				// Hand the bank over and continue with the next one on this output
+				auto const &job = lane.jobs[lane.next].job;
+				std::vector<midikraft::PatchHolder> patches;
+				{
+					ScopedLock lock(lane.receivedLock);
+					patches.swap(lane.received);
+				}
+				auto bankLoaded = bankLoaded_;
+				auto synth = job.synth;
+				auto bank = job.bank;
+				auto seconds = (Time::getMillisecondCounterHiRes() - lane.startedMs) / 1000.0;
+				MessageManager::callAsync([bankLoaded, synth, bank, patches, seconds]() {
+					TransferStrategy::recordDownload(synth, patches.size(), seconds);
+					bankLoaded(synth, bank, patches);
+				});
+				lane.running = false;
+				lane.next++;
+				banksLoaded_++;
+				auto learned = learnedStallTimeout(lane.stallTimeout, lane.longestGap);
+				if (learned != lane.stallTimeout) {
+					lane.stallTimeout = learned;
+					SettingsWriteQueue::instance().set(lane.timeoutSetting, std::to_string(learned));
+				}
+			}
+			if (!lane.running && lane.next < lane.jobs.size()) {
+				auto const &job = lane.jobs[lane.next].job;
+				auto location = midikraft::Capability::hasCapability<midikraft::MidiLocationCapability>(job.synth);
+				lane.finished = false;
+				lane.progress = 0.0;
+				lane.lastActivity = Time::getMillisecondCounter();
+				lane.longestGap = 0;
+				lane.startedMs = Time::getMillisecondCounterHiRes();
+				lane.networkAllowance = (uint32) (kRoundTripsAllowed * NetworkMidi::roundTripMs(lane.outputName));
+				lane.running = true;
+				// The Librarian installs its MIDI handlers and sends the first request on the message thread
+				MessageManager::callAsync([lanePtr, job, output = location->midiOutput()]() {
+					if (lanePtr->aborted) {
+						return;
+					}
+					Lane *progress = lanePtr.get();
+					lanePtr->librarian.startDownloadingAllPatches(midikraft::MidiController::instance()->getMidiOutput(output), job.synth, job.bank, progress,
+						[progress](std::vector<midikraft::PatchHolder> patchesLoaded) {
+						ScopedLock lock(progress->receivedLock);
+						progress->received = patchesLoaded;
+						progress->finished = true;
+					});
+				});
+			}
+			done += (double)lane.next + (lane.running ? lane.progress.load() : 0.0);
+			if (lane.running || lane.next < lane.jobs.size()) {
+				allDone = false;
+			}
+		}
+		setProgress(total > 0 ? done / (double)total : 1.0);
+		setStatusMessage(fmt::format("Downloaded {} of {} banks over {} MIDI outputs...", banksLoaded_, total, lanes.size()));
+		if (allDone) {
+			break;
+		}
+		wait(100);
+	}
+
+	// Canceled, make sure no handler stays installed and no download still waiting on the message thread starts
+	for (auto &entry : lanes) {
+		auto lane = entry.second;
+		lane->aborted = true;
+		MessageManager::callAsync([lane]() {
+			lane->librarian.clearHandlers();
+		});
+	}
+}
@@ -0,0 +1,50 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include "Librarian.h"
+#include "SynthHolder.h"
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Downloads a list of banks from any number of synths with one aggregated progress window. Transfers to different MIDI
+// outputs run at the same time, each with its own Librarian, while transfers sharing an output run one after the other.
+// A lane that stops making progress for too long gives up on its current bank and continues with the next.
+class BankDownloadScheduler : public ThreadWithProgressWindow {
+public:
+	struct Job {
+		std::shared_ptr<midikraft::Synth> synth;
+		MidiBankNumber bank;
+	};
+
+	// Called on the message thread for every bank completely received
+	using TBankLoaded = std::function<void(std::shared_ptr<midikraft::Synth>, MidiBankNumber, std::vector<midikraft::PatchHolder>)>;
+
+	BankDownloadScheduler(std::vector<midikraft::SynthHolder> const &synths, std::vector<Job> const &jobs, TBankLoaded bankLoaded);
+
+	// All banks of all detected synths that can be downloaded
+	static std::vector<Job> allBanksOfDetectedSynths(std::vector<midikraft::SynthHolder> const &synths);
+
+	void run() override;
+
+	int banksLoaded() const { return banksLoaded_; }
+	int banksFailed() const { return banksFailed_; }
+
+private:
+	std::vector<midikraft::SynthHolder> synths_;
+	std::vector<Job> jobs_;
+	TBankLoaded bankLoaded_;
+	std::map<std::string, uint32> stallTimeouts_; // By setting name, read on the message thread
+	int banksLoaded_ = 0;
+	int banksFailed_ = 0;
+};
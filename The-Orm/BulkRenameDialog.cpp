@@ -81,7 +81,23 @@ void BulkRenameDialog::show(std::vector<midikraft::PatchHolder> input, Component
 	}
 	sBulkRenameDialog_->setList(input);
 	sBulkRenameDialog_->callback_ = callback;
+	sBulkRenameDialog_->namesCallback_ = nullptr;
+	launch(centeredAround);
+}
+
+void BulkRenameDialog::showNames(std::vector<midikraft::PatchHolder> input, Component* centeredAround, TNamesCallback callback)
+{
+	if (!sBulkRenameDialog_) {
+		sBulkRenameDialog_ = std::make_unique<BulkRenameDialog>();
+	}
+	sBulkRenameDialog_->setList(input);
+	sBulkRenameDialog_->callback_ = nullptr;
+	sBulkRenameDialog_->namesCallback_ = callback;
+	launch(centeredAround);
+}
 
+void BulkRenameDialog::launch(Component* centeredAround)
+{
 	DialogWindow::LaunchOptions launcher;
 	launcher.content.set(sBulkRenameDialog_.get(), false);
 	launcher.componentToCentreAround = centeredAround;
@@ -99,6 +115,14 @@ void BulkRenameDialog::release()
 
 void BulkRenameDialog::notifyResult()
 {
+	if (namesCallback_) {
+		std::vector<std::string> names;
+		for (size_t i = 0; i < juce::jmin(input_.size(), props_.size()); i++) {
+			names.push_back(props_[i]->value().toString().toStdString());
+		}
+		namesCallback_(names);
+		return;
+	}
 	// Copy out new values into input list names
 	for (size_t i = 0; i < juce::jmin(input_.size(), props_.size()); i++) {
 		input_[i].setName(props_[i]->value().toString().toStdString());
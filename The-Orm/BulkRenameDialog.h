@@ -14,6 +14,7 @@
 class BulkRenameDialog : public Component, private TextButton::Listener {
 public:
 	typedef std::function<void(std::vector<midikraft::PatchHolder> result)> TCallback;
+	typedef std::function<void(std::vector<std::string> newNames)> TNamesCallback;
 
 	BulkRenameDialog();
 	void setList(std::vector<midikraft::PatchHolder> input);
@@ -21,11 +22,14 @@ public:
 	virtual void resized() override;
 
 	static void show(std::vector<midikraft::PatchHolder> input, Component* centeredAround, TCallback callback);
+	// Same dialog, but the patches are not renamed. The callback gets the new names in the order of the input, to rename them elsewhere
+	static void showNames(std::vector<midikraft::PatchHolder> input, Component* centeredAround, TNamesCallback callback);
 	static void release();
 
 	void notifyResult();
 
 private:
+	static void launch(Component* centeredAround);
 	void buttonClicked(Button* button) override;
 
 	static std::unique_ptr<BulkRenameDialog> sBulkRenameDialog_;
@@ -40,6 +44,7 @@ private:
 	TextButton copy_;
 	TextButton fromFilename_;
 	TCallback callback_;
+	TNamesCallback namesCallback_;
 
 	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(BulkRenameDialog)
 };
\ No newline at end of file
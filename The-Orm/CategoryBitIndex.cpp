@@ -0,0 +1,43 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "CategoryBitIndex.h"
+
+bool CategoryBitIndex::update(std::vector<midikraft::Category> const &categories)
+{
+	bool same = categories.size() == categories_.size();
+	for (size_t i = 0; same && i < categories.size(); i++) {
+		same = categories[i].category() == categories_[i].category() && categories[i].color() == categories_[i].color();
+	}
+	if (same) {
+		return false;
+	}
+
+	categories_ = categories;
+	bitByName_.clear();
+	for (size_t i = 0; i < categories_.size(); i++) {
+		bitByName_.emplace(categories_[i].category(), (int) i);
+	}
+	return true;
+}
+
+midikraft::Category const *CategoryBitIndex::byName(std::string const &name) const
+{
+	auto found = bitByName_.find(name);
+	return found != bitByName_.end() ? &categories_[(size_t) found->second] : nullptr;
+}
+
+BigInteger CategoryBitIndex::bitsOf(std::set<midikraft::Category> const &categories) const
+{
+	BigInteger result;
+	for (auto const &category : categories) {
+		auto found = bitByName_.find(category.category());
+		if (found != bitByName_.end()) {
+			result.setBit(found->second);
+		}
+	}
+	return result;
+}
@@ -0,0 +1,34 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include "PatchHolder.h"
+
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Assigns each category of the database a bit, in the order the database returns them, so category sets become bit masks
+// that are compared and intersected without touching the category objects. Names are only looked up at the UI edge.
+class CategoryBitIndex {
+public:
+	// Rebuilds the index if the categories differ from the ones it was built from, returns true if it did
+	bool update(std::vector<midikraft::Category> const &categories);
+
+	// Nullptr if there is no category of that name
+	midikraft::Category const *byName(std::string const &name) const;
+
+	// Categories not in the index are ignored
+	BigInteger bitsOf(std::set<midikraft::Category> const &categories) const;
+
+private:
+	std::vector<midikraft::Category> categories_;
+	std::unordered_map<std::string, int> bitByName_;
+};
@@ -0,0 +1,115 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "CategoryRuleSnapshot.h"
+
+#include <fmt/format.h>
+#include <spdlog/spdlog.h>
+
+CategoryRuleSnapshot CategoryRuleSnapshot::take(std::shared_ptr<midikraft::AutomaticCategory> categorizer, std::vector<midikraft::Category> const &categories)
+{
+	CategoryRuleSnapshot result;
+	if (!categorizer) {
+		return result;
+	}
+	for (auto const &category : categories) {
+		// The colour doesn't influence the categorization, only name and active state do
+		auto def = category.def();
+		result.definitions_[def->name] = fmt::format("{}:{}", def->id, def->isActive);
+	}
+	File mappingFile = categorizer->getAutoCategoryMappingFile();
+	result.mappingHash_ = mappingFile.existsAsFile() ? mappingFile.loadFileAsString().hashCode64() : 0;
+
+	result.complete_ = readRules(categorizer->getAutoCategoryFile(), result.rules_);
+	for (auto const &category : result.rules_) {
+		auto &compiled = result.compiled_[category.first];
+		for (auto const &rule : category.second) {
+			try {
+				compiled.emplace_back(rule, std::regex::icase);
+			}
+			catch (std::regex_error &e) {
+				spdlog::warn("Auto category rule '{}' for {} is no valid regular expression: {}", rule, category.first, e.what());
+				result.matchAnything_.insert(category.first);
+			}
+		}
+	}
+	return result;
+}
+
+bool CategoryRuleSnapshot::readRules(File const &rulesFile, std::map<std::string, std::vector<std::string>> &outRules)
+{
+	if (!rulesFile.existsAsFile()) {
+		return false;
+	}
+	var json;
+	if (JSON::parse(rulesFile.loadFileAsString(), json).failed()) {
+		return false;
+	}
+	auto categories = json.getProperty("categories", var());
+	if (!categories.getDynamicObject()) {
+		return false;
+	}
+	for (auto const &category : categories.getDynamicObject()->getProperties()) {
+		auto &rules = outRules[category.name.toString().toStdString()];
+		if (category.value.isArray()) {
+			for (auto const &rule : *category.value.getArray()) {
+				rules.push_back(rule.toString().toStdString());
+			}
+		}
+	}
+	return true;
+}
+
+bool CategoryRuleSnapshot::changedCategories(CategoryRuleSnapshot const &older, std::set<std::string> &outChanged) const
+{
+	outChanged.clear();
+	if (!complete_ || !older.complete_ || mappingHash_ != older.mappingHash_) {
+		return false;
+	}
+	auto collect = [&outChanged](auto const &newer, auto const &old) {
+		for (auto const &entry : newer) {
+			auto found = old.find(entry.first);
+			if (found == old.end() || found->second != entry.second) {
+				outChanged.insert(entry.first);
+			}
+		}
+		for (auto const &entry : old) {
+			if (newer.find(entry.first) == newer.end()) {
+				outChanged.insert(entry.first);
+			}
+		}
+	};
+	collect(rules_, older.rules_);
+	collect(definitions_, older.definitions_);
+	return true;
+}
+
+bool CategoryRuleSnapshot::mightChange(midikraft::PatchHolder const &patch, std::set<std::string> const &changed) const
+{
+	// Losing a category is only possible for patches having it
+	for (auto const &category : patch.categories()) {
+		if (changed.find(category.category()) != changed.end()) {
+			return true;
+		}
+	}
+	// Gaining one only for names matching a rule of it
+	auto name = patch.name();
+	for (auto const &category : changed) {
+		if (matchAnything_.find(category) != matchAnything_.end()) {
+			return true;
+		}
+		auto rules = compiled_.find(category);
+		if (rules == compiled_.end()) {
+			continue;
+		}
+		for (auto const &rule : rules->second) {
+			if (std::regex_search(name, rule)) {
+				return true;
+			}
+		}
+	}
+	return false;
+}
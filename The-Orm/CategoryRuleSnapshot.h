@@ -0,0 +1,43 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include "AutomaticCategory.h"
+#include "PatchHolder.h"
+
+#include <map>
+#include <regex>
+#include <set>
+#include <string>
+#include <vector>
+
+// The auto categorization rules and category definitions in effect at one point in time. Comparing two snapshots
+// tells which categories can have changed for any patch, so a rerun of the auto categorization can skip all patches
+// that neither carry one of these categories nor have a name matching one of their new rules.
+class CategoryRuleSnapshot {
+public:
+	static CategoryRuleSnapshot take(std::shared_ptr<midikraft::AutomaticCategory> categorizer, std::vector<midikraft::Category> const &categories);
+
+	// Fills the names of the categories that differ from the older snapshot. Returns false if the difference can't be narrowed
+	// down to categories, e.g. because the import mapping changed or a rules file could not be read. Then all patches are affected
+	bool changedCategories(CategoryRuleSnapshot const &older, std::set<std::string> &outChanged) const;
+
+	// Conservative, true if the patch might get or lose one of the changed categories with the rules of this snapshot
+	bool mightChange(midikraft::PatchHolder const &patch, std::set<std::string> const &changed) const;
+
+private:
+	static bool readRules(File const &rulesFile, std::map<std::string, std::vector<std::string>> &outRules);
+
+	bool complete_ = false;
+	std::map<std::string, std::vector<std::string>> rules_; // Category name to its regular expressions
+	std::map<std::string, std::vector<std::regex>> compiled_;
+	std::set<std::string> matchAnything_; // Categories with a rule that didn't compile, every patch might match
+	std::map<std::string, std::string> definitions_; // Category name to what matters for the categorization
+	int64 mappingHash_ = 0;
+};
@@ -0,0 +1,175 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "ConcurrentAutoDetection.h"
+
+#include "DetectionCache.h"
+
+#include <spdlog/spdlog.h>
+#include "SpdLogJuce.h"
+
+#include <algorithm>
+
+ConcurrentAutoDetection::ReplyCollector::ReplyCollector()
+{
+	handle_ = midikraft::MidiController::makeOneHandle();
+	midikraft::MidiController::instance()->addMessageHandler(handle_, [this](MidiInput *source, MidiMessage const &message) {
+		if (source && (message.isSysEx() || message.isController() || message.isProgramChange())) {
+			ScopedLock lock(lock_);
+			replies_.push_back({ source->getDeviceInfo(), message });
+		}
+	});
+}
+
+ConcurrentAutoDetection::ReplyCollector::~ReplyCollector()
+{
+	midikraft::MidiController::instance()->removeMessageHandler(handle_);
+}
+
+std::vector<ConcurrentAutoDetection::Reply> ConcurrentAutoDetection::ReplyCollector::take()
+{
+	ScopedLock lock(lock_);
+	std::vector<Reply> result;
+	result.swap(replies_);
+	return result;
+}
+
+int ConcurrentAutoDetection::probe(midikraft::SimpleDiscoverableDevice &synth, MidiDeviceInfo const &output)
+{
+	std::vector<MidiMessage> messages;
+	if (synth.needsChannelSpecificDetection()) {
+		for (int channel = 0; channel < 16; channel++) {
+			auto forChannel = synth.deviceDetect(channel);
+			messages.insert(messages.end(), forChannel.begin(), forChannel.end());
+		}
+	}
+	else {
+		messages = synth.deviceDetect(0);
+	}
+	if (!messages.empty()) {
+		midikraft::MidiController::instance()->getMidiOutput(output)->sendBlockOfMessagesFullSpeed(messages);
+	}
+	return synth.deviceDetectSleepMS();
+}
+
+void ConcurrentAutoDetection::markDetected(midikraft::SimpleDiscoverableDevice &synth, Reply const &reply, MidiDeviceInfo const &output, MidiChannel channel)
+{
+	synth.setCurrentChannelZeroBased(reply.input, output, channel.toZeroBasedInt());
+	synth.setWasDetected(true);
+	DetectionCache::remember(synth, &reply.message);
+	spdlog::info("Found {} on channel {} replying on device {} when sending to {}", synth.getName(), channel.toOneBasedInt(),
+		reply.input.name.toStdString(), output.name.toStdString());
+}
+
+int ConcurrentAutoDetection::autoconfigure(std::vector<std::shared_ptr<midikraft::SimpleDiscoverableDevice>> const &synths, midikraft::ProgressHandler *progressHandler)
+{
+	auto outputs = MidiOutput::getAvailableDevices();
+	auto inputs = MidiInput::getAvailableDevices();
+	for (auto const &input : inputs) {
+		midikraft::MidiController::instance()->enableMidiInput(input);
+	}
+	if (outputs.isEmpty() || synths.empty()) {
+		return 0;
+	}
+
+	for (auto const &synth : synths) {
+		synth->setWasDetected(false);
+	}
+
+	ReplyCollector collector;
+	std::vector<bool> detected(synths.size(), false);
+	std::vector<bool> ambiguous(synths.size(), false);
+	int found = 0;
+	int rounds = outputs.size();
+	for (int round = 0; round < rounds && found < (int)synths.size(); round++) {
+		if (progressHandler && progressHandler->shouldAbort()) {
+			break;
+		}
+
+		// Every synth probes another output in this round
+		collector.take();
+		std::vector<int> probedOutput(synths.size(), -1);
+		int waitMs = 0;
+		for (size_t s = 0; s < synths.size(); s++) {
+			if (detected[s] || ambiguous[s]) {
+				continue;
+			}
+			int outputIndex = (int)((s + (size_t)round) % (size_t)rounds);
+			probedOutput[s] = outputIndex;
+			waitMs = std::max(waitMs, probe(*synths[s], outputs[outputIndex]));
+		}
+		if (progressHandler) {
+			progressHandler->setMessage("Probing all synths on " + std::to_string(rounds) + " MIDI outputs...");
+		}
+
+		// Wait for the slowest synth of the round, then demultiplex what came in
+		Thread::sleep(waitMs);
+		auto replies = collector.take();
+		for (auto const &reply : replies) {
+			std::vector<size_t> accepting;
+			std::vector<MidiChannel> channels;
+			for (size_t s = 0; s < synths.size(); s++) {
+				if (probedOutput[s] < 0 || detected[s]) {
+					continue;
+				}
+				auto channel = synths[s]->channelIfValidDeviceResponse(reply.message);
+				if (channel.isValid()) {
+					accepting.push_back(s);
+					channels.push_back(channel);
+				}
+			}
+			if (accepting.empty()) {
+				continue;
+			}
+			bool oneOutput = std::all_of(accepting.begin(), accepting.end(), [&](size_t s) { return probedOutput[s] == probedOutput[accepting.front()]; });
+			if (!oneOutput) {
+				// Any of the outputs probed could have caused this reply
+				for (auto s : accepting) {
+					ambiguous[s] = true;
+				}
+				continue;
+			}
+			for (size_t i = 0; i < accepting.size(); i++) {
+				markDetected(*synths[accepting[i]], reply, outputs[probedOutput[accepting[i]]], channels[i]);
+				detected[accepting[i]] = true;
+				found++;
+			}
+		}
+		if (progressHandler) {
+			progressHandler->setProgressPercentage((round + 1) / (double)rounds);
+		}
+	}
+
+	// The synths whose replies could not be attributed probe one output at a time, alone
+	for (size_t s = 0; s < synths.size(); s++) {
+		if (!ambiguous[s] || detected[s]) {
+			continue;
+		}
+		for (int outputIndex = 0; outputIndex < rounds && !detected[s]; outputIndex++) {
+			if (progressHandler && progressHandler->shouldAbort()) {
+				break;
+			}
+			collector.take();
+			Thread::sleep(probe(*synths[s], outputs[outputIndex]));
+			for (auto const &reply : collector.take()) {
+				auto channel = synths[s]->channelIfValidDeviceResponse(reply.message);
+				if (channel.isValid()) {
+					markDetected(*synths[s], reply, outputs[outputIndex], channel);
+					detected[s] = true;
+					found++;
+					break;
+				}
+			}
+		}
+	}
+
+	for (size_t s = 0; s < synths.size(); s++) {
+		if (!detected[s]) {
+			spdlog::info("No {} could be detected", synths[s]->getName());
+		}
+	}
+	return found;
+}
@@ -0,0 +1,53 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include "DiscoverableDevice.h"
+#include "MidiController.h"
+#include "ProgressHandler.h"
+
+#include <memory>
+#include <vector>
+
+// Detects many synths at once. The probes are scheduled in rounds, and in every round each undetected synth probes a
+// different MIDI output. All replies coming in during a round are demultiplexed through each synth's
+// channelIfValidDeviceResponse. A reply accepted by synths that probed different outputs can't be attributed, e.g. because
+// several adaptations understand the same identity reply. It is not credited to anyone, and these synths probe each output
+// again on their own after the rounds.
+// The number of rounds is the number of outputs, each lasting as long as the slowest synth of the round needs to answer,
+// instead of one wait per synth and output as in the sequential detection.
+class ConcurrentAutoDetection {
+public:
+	struct Reply {
+		MidiDeviceInfo input;
+		MidiMessage message;
+	};
+
+	// Collects everything arriving on any input while it exists. The MIDI callback only appends, the detecting thread evaluates
+	class ReplyCollector {
+	public:
+		ReplyCollector();
+		~ReplyCollector();
+
+		std::vector<Reply> take();
+
+	private:
+		midikraft::MidiController::HandlerHandle handle_ = midikraft::MidiController::makeNoneHandle();
+		CriticalSection lock_;
+		std::vector<Reply> replies_;
+	};
+
+	// Returns the number of synths detected. Synths not found are marked as not detected
+	static int autoconfigure(std::vector<std::shared_ptr<midikraft::SimpleDiscoverableDevice>> const &synths, midikraft::ProgressHandler *progressHandler);
+
+private:
+	// Sends the detect messages of the synth to the output, returns how long to wait for its reply
+	static int probe(midikraft::SimpleDiscoverableDevice &synth, MidiDeviceInfo const &output);
+	static void markDetected(midikraft::SimpleDiscoverableDevice &synth, Reply const &reply, MidiDeviceInfo const &output, MidiChannel channel);
+};
@@ -71,6 +71,8 @@ CurrentPatchDisplay::CurrentPatchDisplay(midikraft::PatchDatabase &database, std
 	, propertyEditor_(true)
 	, favorite_("Fav!")
 	, hide_("Hide")
+	, similar_("Similar")
+	, soundsLike_("Sounds like")
 	, metaData_(categories, [this](CategoryButtons::Category categoryClicked) {
 		categoryUpdated(categoryClicked);
 	})
@@ -89,6 +91,14 @@ CurrentPatchDisplay::CurrentPatchDisplay(midikraft::PatchDatabase &database, std
 	hide_.setColour(TextButton::ColourIds::buttonOnColourId, Colours::indianred);
 	addAndMakeVisible(hide_);
 
+	similar_.setTooltip("Show the patches of the library that are closest to this one");
+	similar_.addListener(this);
+	addAndMakeVisible(similar_);
+
+	soundsLike_.setTooltip("Show the patches of all synths whose prehear recording sounds closest to the one of this patch");
+	soundsLike_.addListener(this);
+	addAndMakeVisible(soundsLike_);
+
 	metaDataScroller_.setViewedComponent(&metaData_, false);
 	addAndMakeVisible(metaDataScroller_);
 	addAndMakeVisible(patchAsText_);
@@ -122,11 +132,7 @@ void CurrentPatchDisplay::setCurrentPatch(std::shared_ptr<midikraft::PatchHolder
 		favorite_.setToggleState(patch->isFavorite(), dontSendNotification);
 		hide_.setToggleState(patch->isHidden(), dontSendNotification);
 		
-		std::set<CategoryButtons::Category> buttonCategories;
-		for (const auto& cat : patch->categories()) {
-			buttonCategories.insert({ cat.category(), cat.color() });
-		}
-		metaData_.setActive(buttonCategories);
+		showActiveCategories(patch->categories());
 
 		if (patchAsText_.isVisible()) {
 			patchAsText_.fillTextBox(patch);
@@ -177,29 +183,43 @@ String getImportName(std::shared_ptr<midikraft::PatchHolder> patch)
 
 void CurrentPatchDisplay::setupPatchProperties(std::shared_ptr<midikraft::PatchHolder> patch)
 {
-	metaDataValues_.clear();
+	TypedNamedValueSet values;
 
 	// Check if the patch is a layered patch
 	auto layers = midikraft::Capability::hasCapability<midikraft::LayeredPatchCapability>(patch->patch());
 	if (layers) {
 		for (int i = 0; i < layers->numberOfLayers(); i++) {
 			TypedNamedValue v("Layer " + String(i), "Patch name", String(layers->layerName(i)).trim(), 20);
-			metaDataValues_.push_back(std::make_shared<TypedNamedValue>(v));
+			values.push_back(std::make_shared<TypedNamedValue>(v));
 		}
 	}
 	else if (patch->patch()) {
 		TypedNamedValue v("Patch name", "Patch name", String(patch->name()).trim(), 20);
-		metaDataValues_.push_back(std::make_shared<TypedNamedValue>(v));
+		values.push_back(std::make_shared<TypedNamedValue>(v));
 	}
 
 	// More read only data
-	metaDataValues_.push_back(std::make_shared<TypedNamedValue>("Synth", "Meta data", patch->synth()->getName(), 100));
-	metaDataValues_.back()->setEnabled(false);
-	metaDataValues_.push_back(std::make_shared<TypedNamedValue>("Type", "Meta data", getTypeName(patch), 100));
-	metaDataValues_.back()->setEnabled(false);
-	metaDataValues_.push_back(std::make_shared<TypedNamedValue>("Import", "Meta data", getImportName(patch), 100));
-	metaDataValues_.back()->setEnabled(false);
+	values.push_back(std::make_shared<TypedNamedValue>("Synth", "Meta data", patch->synth()->getName(), 100));
+	values.back()->setEnabled(false);
+	values.push_back(std::make_shared<TypedNamedValue>("Type", "Meta data", getTypeName(patch), 100));
+	values.back()->setEnabled(false);
+	values.push_back(std::make_shared<TypedNamedValue>("Import", "Meta data", getImportName(patch), 100));
+	values.back()->setEnabled(false);
+
+	bool sameProperties = values.size() == metaDataValues_.size();
+	for (size_t i = 0; sameProperties && i < values.size(); i++) {
+		sameProperties = values[i]->name() == metaDataValues_[i]->name() && values[i]->sectionName() == metaDataValues_[i]->sectionName();
+	}
+	if (sameProperties) {
+		// Mostly the next patch of the same synth, keep the editors and only show the new values. The change notifications
+		// this causes are ignored by valueChanged(), as the values are those of the patch
+		for (size_t i = 0; i < values.size(); i++) {
+			metaDataValues_[i]->value().setValue(values[i]->value().getValue());
+		}
+		return;
+	}
 
+	metaDataValues_ = values;
 	// We need to learn about updates
 	for (auto tnv : metaDataValues_) {
 		tnv->value().addListener(this);
@@ -214,6 +234,10 @@ void CurrentPatchDisplay::valueChanged(Value& value)
 		if (property->name() == "Patch name" && value.refersToSameSourceAs(property->value())) {
 			// Name was changed - do this in the database!
 			if (currentPatch_) {
+				if (value.getValue().toString() == String(currentPatch_->name()).trim()) {
+					// Not an edit, the editor was updated to show the next patch
+					return;
+				}
 				currentPatch_->setName(value.getValue().toString().toStdString());
 				setCurrentPatch(currentPatch_);
 				favoriteHandler_(currentPatch_);
@@ -229,6 +253,9 @@ void CurrentPatchDisplay::valueChanged(Value& value)
 				auto layers = midikraft::Capability::hasCapability<midikraft::LayeredPatchCapability>(currentPatch_->patch());
 				if (layers) {
 					int i = atoi(property->name().substring(6).toStdString().c_str());
+					if (i < layers->numberOfLayers() && value.getValue().toString() == String(layers->layerName(i)).trim()) {
+						return;
+					}
 					layers->setLayerName(i, value.getValue().toString().toStdString());
 					currentPatch_->setName(currentPatch_->name()); // We need to refresh the name in the patch holder to match the name calculated from the 2 layers!
 					setCurrentPatch(currentPatch_);
@@ -253,6 +280,8 @@ void CurrentPatchDisplay::reset()
 	favorite_.setToggleState(false, dontSendNotification);
 	hide_.setToggleState(false, dontSendNotification);
 	metaData_.setActive({});
+	shownCategories_.clear();
+	shownCategoriesValid_ = true;
 	patchAsText_.fillTextBox(nullptr);
 	resized();
 }
@@ -281,7 +310,9 @@ void CurrentPatchDisplay::resized()
 		fb.justifyContent = FlexBox::JustifyContent::center;
 		fb.items.add(FlexItem(favorite_).withMinHeight(LAYOUT_TOUCHBUTTON_HEIGHT).withMinWidth(LAYOUT_BUTTON_WIDTH_MIN));
 		fb.items.add(FlexItem(hide_).withMinHeight(LAYOUT_TOUCHBUTTON_HEIGHT).withMinWidth(LAYOUT_BUTTON_WIDTH_MIN));
-		auto spaceNeeded = FlexBoxHelper::determineSizeForButtonLayout(this, this, { &favorite_, &hide_ }, nextRow);
+		fb.items.add(FlexItem(similar_).withMinHeight(LAYOUT_TOUCHBUTTON_HEIGHT).withMinWidth(LAYOUT_BUTTON_WIDTH_MIN));
+		fb.items.add(FlexItem(soundsLike_).withMinHeight(LAYOUT_TOUCHBUTTON_HEIGHT).withMinWidth(LAYOUT_BUTTON_WIDTH_MIN));
+		auto spaceNeeded = FlexBoxHelper::determineSizeForButtonLayout(this, this, { &favorite_, &hide_, &similar_, &soundsLike_ }, nextRow);
 		fb.performLayout(spaceNeeded.toNearestInt());
 		area.removeFromTop((int) spaceNeeded.getHeight());
 
@@ -307,7 +338,9 @@ void CurrentPatchDisplay::resized()
 		//auto leftCornerLower = leftCorner;
 		auto rightCorner = topRow.removeFromRight(side).withTrimmedLeft(8);
 
-		// Right side - hide and favorite button
+		// Right side - sounds like, similar, hide and favorite button
+		soundsLike_.setBounds(rightCorner.removeFromRight(100));
+		similar_.setBounds(rightCorner.removeFromRight(100));
 		hide_.setBounds(rightCorner.removeFromRight(100));
 		favorite_.setBounds(rightCorner.removeFromRight(100));
 
@@ -338,6 +371,16 @@ void CurrentPatchDisplay::buttonClicked(Button *button)
 				favoriteHandler_(currentPatch_);
 			}
 		}
+		else if (button == &similar_) {
+			if (currentPatch_->patch() && onShowSimilar) {
+				onShowSimilar(currentPatch_);
+			}
+		}
+		else if (button == &soundsLike_) {
+			if (currentPatch_->patch() && onShowSoundsLike) {
+				onShowSoundsLike(currentPatch_);
+			}
+		}
 	}
 }
 
@@ -384,6 +427,7 @@ void CurrentPatchDisplay::changeListenerCallback(ChangeBroadcaster* source)
 		}
 	}
 	metaData_.setCategories(result);
+	shownCategoriesValid_ = false;
 	refreshNameButtonColour();
 	resized();
 }
@@ -391,28 +435,46 @@ void CurrentPatchDisplay::changeListenerCallback(ChangeBroadcaster* source)
 void CurrentPatchDisplay::categoryUpdated(CategoryButtons::Category clicked) {
 	if (currentPatch_ && currentPatch_->patch()) {
 		// Search for the real category
-		for (auto realCat: database_.getCategories()) {
-			if (realCat.category() == clicked.category) {
-				currentPatch_->setUserDecision(realCat);
-				auto categories = metaData_.selectedCategories();
-				currentPatch_->clearCategories();
-				for (const auto& cat : categories) {
-					// Have to convert into juce-widget version of Category here
-					bool found = false;
-					for (auto c : database_.getCategories()) {
-						if (c.category() == cat.category) {
-							currentPatch_->setCategory(c, true);
-							found = true;
-						}
-					}
-					if (!found) {
-						spdlog::error("Can't set category {} as it is not stored in the database. Program error?", cat.category);
-					}
+		categoryIndex_.update(database_.getCategories());
+		auto realCat = categoryIndex_.byName(clicked.category);
+		if (realCat) {
+			currentPatch_->setUserDecision(*realCat);
+			auto categories = metaData_.selectedCategories();
+			currentPatch_->clearCategories();
+			for (const auto& cat : categories) {
+				// Have to convert into juce-widget version of Category here
+				auto c = categoryIndex_.byName(cat.category);
+				if (c) {
+					currentPatch_->setCategory(*c, true);
+				}
+				else {
+					spdlog::error("Can't set category {} as it is not stored in the database. Program error?", cat.category);
 				}
-				favoriteHandler_(currentPatch_);
-				break;
 			}
+			// The buttons were toggled by the user, they show the categories of the patch now
+			shownCategories_ = categoryIndex_.bitsOf(currentPatch_->categories());
+			shownCategoriesValid_ = true;
+			favoriteHandler_(currentPatch_);
 		}
 	}
 	refreshNameButtonColour();
 }
+
+void CurrentPatchDisplay::showActiveCategories(std::set<midikraft::Category> const &categories)
+{
+	// Consecutive patches often share their categories, then the buttons are already right
+	if (categoryIndex_.update(database_.getCategories())) {
+		shownCategoriesValid_ = false;
+	}
+	auto bits = categoryIndex_.bitsOf(categories);
+	if (shownCategoriesValid_ && bits == shownCategories_) {
+		return;
+	}
+	std::set<CategoryButtons::Category> buttonCategories;
+	for (const auto& cat : categories) {
+		buttonCategories.insert({ cat.category(), cat.color() });
+	}
+	metaData_.setActive(buttonCategories);
+	shownCategories_ = bits;
+	shownCategoriesValid_ = true;
+}
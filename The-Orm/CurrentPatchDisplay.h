@@ -17,6 +17,8 @@
 #include "PatchDatabase.h"
 #include "PropertyEditor.h"
 
+#include "CategoryBitIndex.h"
+
 class MetaDataArea: public Component {
 public:
 	MetaDataArea(std::vector<CategoryButtons::Category> categories, std::function<void(CategoryButtons::Category)> categoryUpdateHandler);
@@ -45,6 +47,8 @@ public:
 	virtual ~CurrentPatchDisplay() override;
 
 	std::function<void(std::shared_ptr<midikraft::PatchHolder>)> onCurrentPatchClicked;
+	std::function<void(std::shared_ptr<midikraft::PatchHolder>)> onShowSimilar;
+	std::function<void(std::shared_ptr<midikraft::PatchHolder>)> onShowSoundsLike;
 
 	void setCurrentPatch(std::shared_ptr<midikraft::PatchHolder> patch);
 	void reset();
@@ -66,6 +70,7 @@ private:
 	void changeListenerCallback(ChangeBroadcaster* source) override;
 	void refreshNameButtonColour();
 	void categoryUpdated(CategoryButtons::Category clicked);
+	void showActiveCategories(std::set<midikraft::Category> const &categories);
 	virtual void valueChanged(Value& value) override; // This gets called when the property editor is used
 
 	midikraft::PatchDatabase &database_;
@@ -74,6 +79,8 @@ private:
 	String lastOpenState_;
 	TextButton favorite_;
 	TextButton hide_;
+	TextButton similar_;
+	TextButton soundsLike_;
 	Viewport metaDataScroller_;
 	MetaDataArea metaData_;
 	
@@ -83,5 +90,9 @@ private:
 
 	TypedNamedValueSet metaDataValues_;
 
+	CategoryBitIndex categoryIndex_;
+	BigInteger shownCategories_; // The categories the buttons currently show as active
+	bool shownCategoriesValid_ = false;
+
 	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(CurrentPatchDisplay)
 };
@@ -0,0 +1,95 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "DatabaseBackup.h"
+
+#include <sqlite3.h>
+
+namespace {
+
+	// Small steps keep the source lock short, so the application's connection is only blocked for a moment each time
+	constexpr int kPagesPerStep = 64;
+	constexpr int kSleepBetweenStepsMs = 2;
+	constexpr int kBusyRetryMs = 20;
+
+}
+
+DatabaseBackup::DatabaseBackup(File source, File destination) :
+	ThreadWithProgressWindow("Creating database backup...", true, true), source_(source), destination_(destination)
+{
+}
+
+void DatabaseBackup::run()
+{
+	succeeded_ = copy(source_, destination_, [this](double progress) {
+		setProgress(progress);
+		return !threadShouldExit();
+	}, error_);
+}
+
+bool DatabaseBackup::copy(File const &source, File const &destination, std::function<bool(double)> const &progress, std::string &outError)
+{
+	sqlite3 *from = nullptr;
+	sqlite3 *to = nullptr;
+	if (sqlite3_open_v2(source.getFullPathName().toRawUTF8(), &from, SQLITE_OPEN_READONLY, nullptr) != SQLITE_OK) {
+		outError = std::string("Can't open database: ") + sqlite3_errmsg(from);
+		sqlite3_close(from);
+		return false;
+	}
+	if (sqlite3_open_v2(destination.getFullPathName().toRawUTF8(), &to, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, nullptr) != SQLITE_OK) {
+		outError = std::string("Can't create backup file: ") + sqlite3_errmsg(to);
+		sqlite3_close(to);
+		sqlite3_close(from);
+		return false;
+	}
+
+	bool ok = false;
+	sqlite3_backup *backup = sqlite3_backup_init(to, "main", from, "main");
+	if (backup) {
+		int rc;
+		do {
+			rc = sqlite3_backup_step(backup, kPagesPerStep);
+			int total = sqlite3_backup_pagecount(backup);
+			if (total > 0 && progress && !progress((total - sqlite3_backup_remaining(backup)) / (double) total)) {
+				break;
+			}
+			if (rc == SQLITE_BUSY || rc == SQLITE_LOCKED) {
+				// The application is writing, the backup continues afterwards
+				sqlite3_sleep(kBusyRetryMs);
+			}
+			else if (rc == SQLITE_OK) {
+				sqlite3_sleep(kSleepBetweenStepsMs);
+			}
+		} while (rc == SQLITE_OK || rc == SQLITE_BUSY || rc == SQLITE_LOCKED);
+		ok = rc == SQLITE_DONE;
+		sqlite3_backup_finish(backup);
+	}
+	if (!ok) {
+		int code = sqlite3_errcode(to);
+		outError = code == SQLITE_OK ? "Backup cancelled" : std::string("Backup failed: ") + sqlite3_errmsg(to);
+	}
+	sqlite3_close(to);
+	sqlite3_close(from);
+	if (!ok) {
+		destination.deleteFile();
+	}
+	return ok;
+}
+
+File DatabaseBackup::backupFileFor(File const &database, std::string const &suffix)
+{
+	return database.getSiblingFile(database.getFileNameWithoutExtension() + String(suffix) + database.getFileExtension()).getNonexistentSibling();
+}
+
+bool DatabaseBackup::succeeded() const
+{
+	return succeeded_;
+}
+
+std::string const &DatabaseBackup::error() const
+{
+	return error_;
+}
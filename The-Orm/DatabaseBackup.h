@@ -0,0 +1,36 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include <functional>
+#include <string>
+
+// Copies a database file with the SQLite online backup API, a few pages at a time on its own connection. Between the
+// steps the application's connection can continue to read, and the progress window keeps the UI responsive while copying
+class DatabaseBackup : public ThreadWithProgressWindow {
+public:
+	DatabaseBackup(File source, File destination);
+
+	virtual void run() override;
+
+	// Copies the source into the destination, which is replaced. The progress callback can return false to abort
+	static bool copy(File const &source, File const &destination, std::function<bool(double)> const &progress, std::string &outError);
+
+	// A file next to the database not existing yet, named after the database with the suffix added
+	static File backupFileFor(File const &database, std::string const &suffix);
+
+	bool succeeded() const;
+	std::string const &error() const;
+
+private:
+	File source_;
+	File destination_;
+	bool succeeded_ = false;
+	std::string error_;
+};
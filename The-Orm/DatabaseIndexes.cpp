@@ -0,0 +1,84 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "DatabaseIndexes.h"
+
+#include <spdlog/spdlog.h>
+
+#include <sqlite3.h>
+
+#include <algorithm>
+
+namespace {
+
+	// Creating an index needs the write lock, the writer might just be in a transaction
+	constexpr int kBusyTimeoutMs = 2000;
+
+}
+
+std::set<std::string> DatabaseIndexes::columnsOf(sqlite3 *db, std::string const &table)
+{
+	std::set<std::string> result;
+	sqlite3_stmt *statement = nullptr;
+	auto sql = "PRAGMA table_info(" + table + ")";
+	if (sqlite3_prepare_v2(db, sql.c_str(), -1, &statement, nullptr) == SQLITE_OK) {
+		while (sqlite3_step(statement) == SQLITE_ROW) {
+			auto name = sqlite3_column_text(statement, 1);
+			if (name) {
+				result.insert(reinterpret_cast<const char *>(name));
+			}
+		}
+	}
+	sqlite3_finalize(statement);
+	return result;
+}
+
+std::vector<DatabaseIndexes::Index> const &DatabaseIndexes::wanted()
+{
+	static std::vector<Index> sIndexes = {
+		// The default view, all patches of the selected synths in import order, and the import filter
+		{ "orm_patches_synth_source", "patches", { "synth", "sourceID" } },
+		// The duplicate search groups by name within a synth, and the name ordering walks the same index
+		{ "orm_patches_synth_name", "patches", { "synth", "name" } },
+		// Resolving the import of each patch for the ordering
+		{ "orm_imports_id", "imports", { "id" } },
+	};
+	return sIndexes;
+}
+
+bool DatabaseIndexes::ensure(File const &database, std::string &outError)
+{
+	sqlite3 *db = nullptr;
+	if (sqlite3_open_v2(database.getFullPathName().toRawUTF8(), &db, SQLITE_OPEN_READWRITE, nullptr) != SQLITE_OK) {
+		outError = std::string("Can't open database: ") + sqlite3_errmsg(db);
+		sqlite3_close(db);
+		return false;
+	}
+	sqlite3_busy_timeout(db, kBusyTimeoutMs);
+	bool ok = true;
+	for (auto const &index : wanted()) {
+		auto columns = columnsOf(db, index.table);
+		bool complete = std::all_of(index.columns.begin(), index.columns.end(), [&columns](std::string const &column) { return columns.count(column) != 0; });
+		if (!complete) {
+			spdlog::debug("Database has no columns for index {}, skipping", index.name);
+			continue;
+		}
+		std::string sql = "CREATE INDEX IF NOT EXISTS " + index.name + " ON " + index.table + " (";
+		for (size_t i = 0; i < index.columns.size(); i++) {
+			sql += (i > 0 ? ", " : "") + index.columns[i];
+		}
+		sql += ")";
+		char *error = nullptr;
+		if (sqlite3_exec(db, sql.c_str(), nullptr, nullptr, &error) != SQLITE_OK) {
+			outError = "Can't create index " + index.name + ": " + (error ? error : "unknown error");
+			sqlite3_free(error);
+			ok = false;
+			break;
+		}
+	}
+	sqlite3_close(db);
+	return ok;
+}
@@ -0,0 +1,36 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include <set>
+#include <string>
+#include <vector>
+
+struct sqlite3;
+
+// Secondary indexes for the filters the patch grid uses all the time: all patches of a synth in import order, and the duplicate
+// name search, which groups the patches of a synth by name. The indexes are only created if the table has all of their columns,
+// so a database of another schema version is left alone. Creating them can take a while on a large library, so this is done by the
+// DatabaseMaintenance thread, which also refreshes the query planner statistics afterwards.
+class DatabaseIndexes {
+public:
+	struct Index {
+		std::string name;
+		std::string table;
+		std::vector<std::string> columns;
+	};
+
+	static std::vector<Index> const &wanted();
+
+	// Returns false with the error if the database could not be checked, missing columns are not an error
+	static bool ensure(File const &database, std::string &outError);
+
+	// The column names of the table, empty if there is no such table
+	static std::set<std::string> columnsOf(sqlite3 *db, std::string const &table);
+};
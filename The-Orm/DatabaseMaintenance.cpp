@@ -0,0 +1,242 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "DatabaseMaintenance.h"
+
+#include "DatabaseIndexes.h"
+#include "UIModel.h"
+#include "Metrics.h"
+
+#include <spdlog/spdlog.h>
+#include "SpdLogJuce.h"
+#include <fmt/format.h>
+
+#include <sqlite3.h>
+
+#include <algorithm>
+#include <cstdlib>
+
+namespace {
+
+	// Short, so the maintenance gives way whenever the writer or a reader holds the file
+	constexpr int kBusyTimeoutMs = 50;
+	// The user asked for the compaction, so it may wait for the writer to finish
+	constexpr int kCompactBusyTimeoutMs = 5000;
+
+	// -1 if the pragma can't be read
+	int64 pragmaValue(sqlite3 *db, char const *sql)
+	{
+		int64 result = -1;
+		sqlite3_stmt *statement = nullptr;
+		if (sqlite3_prepare_v2(db, sql, -1, &statement, nullptr) == SQLITE_OK && sqlite3_step(statement) == SQLITE_ROW) {
+			result = sqlite3_column_int64(statement, 0);
+		}
+		sqlite3_finalize(statement);
+		return result;
+	}
+
+	bool execute(sqlite3 *db, std::string const &sql)
+	{
+		char *error = nullptr;
+		if (sqlite3_exec(db, sql.c_str(), nullptr, nullptr, &error) != SQLITE_OK) {
+			spdlog::debug("Database maintenance: {} not done now, {}", sql, error ? error : "unknown error");
+			sqlite3_free(error);
+			return false;
+		}
+		return true;
+	}
+
+	enum AutoVacuum {
+		None = 0,
+		Full = 1,
+		Incremental = 2
+	};
+
+}
+
+DatabaseMaintenance::DatabaseMaintenance(midikraft::PatchDatabase &database) : Thread("DatabaseMaintenance"), database_(database), file_(database.getCurrentDatabaseFileName())
+{
+	UIModel::instance()->databaseChanged.addChangeListener(this);
+	startThread(1);
+}
+
+DatabaseMaintenance::~DatabaseMaintenance()
+{
+	UIModel::instance()->databaseChanged.removeChangeListener(this);
+	signalThreadShouldExit();
+	notify();
+	stopThread(5000);
+}
+
+void DatabaseMaintenance::changeListenerCallback(ChangeBroadcaster* source)
+{
+	ignoreUnused(source);
+	ScopedLock lock(lock_);
+	file_ = File(database_.getCurrentDatabaseFileName());
+	restart_ = true;
+}
+
+bool DatabaseMaintenance::shouldYield() const
+{
+	return threadShouldExit() || restart_ || !idle_.isIdle(kIdleAfterInputMs);
+}
+
+void DatabaseMaintenance::run()
+{
+	while (!threadShouldExit()) {
+		restart_ = false;
+		File file;
+		{
+			ScopedLock lock(lock_);
+			file = file_;
+		}
+		if (file != maintained_) {
+			maintained_ = file;
+			pagesAtAnalyze_ = -1;
+			freePagesAtAnalyze_ = -1;
+			compactSuggested_ = false;
+			indexesEnsured_ = false;
+		}
+		if (!shouldYield() && file.existsAsFile()) {
+			maintain(file);
+		}
+		wait(kCheckIntervalMs);
+	}
+}
+
+void DatabaseMaintenance::maintain(File const &file)
+{
+	if (!indexesEnsured_) {
+		// Before the statistics, so the first refresh covers the new indexes too
+		std::string error;
+		if (DatabaseIndexes::ensure(file, error)) {
+			indexesEnsured_ = true;
+		}
+		else {
+			spdlog::debug("Database maintenance: indexes not created now, {}", error);
+		}
+		if (shouldYield()) {
+			return;
+		}
+	}
+	sqlite3 *db = nullptr;
+	if (sqlite3_open_v2(file.getFullPathName().toRawUTF8(), &db, SQLITE_OPEN_READWRITE, nullptr) != SQLITE_OK) {
+		spdlog::debug("Database maintenance can't open {}: {}", file.getFullPathName(), sqlite3_errmsg(db));
+		sqlite3_close(db);
+		return;
+	}
+	sqlite3_busy_timeout(db, kBusyTimeoutMs);
+	int64 pages = pragmaValue(db, "PRAGMA page_count");
+	int64 freePages = pragmaValue(db, "PRAGMA freelist_count");
+	if (pages > 0 && freePages >= 0) {
+		refreshStatistics(db, pages, freePages);
+		if (!shouldYield()) {
+			int64 shrunk = giveBackFreePages(db, file, pages, freePages);
+			// Giving pages back is no change to the patches, the statistics stay valid
+			pagesAtAnalyze_ -= shrunk;
+			freePagesAtAnalyze_ = std::max((int64) 0, freePagesAtAnalyze_ - shrunk);
+		}
+	}
+	sqlite3_close(db);
+}
+
+void DatabaseMaintenance::refreshStatistics(sqlite3 *db, int64 pages, int64 freePages)
+{
+	if (pagesAtAnalyze_ < 0) {
+		// First visit of this file, nothing known about how much was written before. Optimize only analyzes what needs it
+		if (execute(db, "PRAGMA optimize")) {
+			pagesAtAnalyze_ = pages;
+			freePagesAtAnalyze_ = freePages;
+		}
+		return;
+	}
+	// New patches grow the file or use free pages, deletions free pages
+	int64 changed = std::abs(pages - pagesAtAnalyze_) + std::abs(freePages - freePagesAtAnalyze_);
+	if (changed == 0 || changed < (int64) (pages * kAnalyzeAfterChangedShare)) {
+		return;
+	}
+	MetricsTimer timer(Metrics::instance().histogram("database.analyze"));
+	if (execute(db, "ANALYZE")) {
+		spdlog::debug("Refreshed the query planner statistics after {} pages changed", changed);
+		pagesAtAnalyze_ = pages;
+		freePagesAtAnalyze_ = freePages;
+	}
+}
+
+int64 DatabaseMaintenance::giveBackFreePages(sqlite3 *db, File const &file, int64 pages, int64 freePages)
+{
+	if (freePages < kPagesPerStep || freePages < (int64) (pages * kVacuumAfterFreeShare)) {
+		return 0;
+	}
+	int64 pageSize = pragmaValue(db, "PRAGMA page_size");
+	auto mode = pragmaValue(db, "PRAGMA auto_vacuum");
+	if (mode == AutoVacuum::None) {
+		// Switching on incremental vacuum needs a rewrite of the whole file, which is not done behind the user's back
+		if (!compactSuggested_) {
+			spdlog::info("Database {} has {} of unused space, use Compact database from the Edit menu to give it back to the disk", file.getFileName(), File::descriptionOfSizeInBytes(freePages * pageSize).toStdString());
+			compactSuggested_ = true;
+		}
+		return 0;
+	}
+	else if (mode == AutoVacuum::Incremental) {
+		int64 remaining = freePages;
+		while (remaining > 0 && !shouldYield()) {
+			{
+				MetricsTimer timer(Metrics::instance().histogram("database.incremental_vacuum"));
+				if (!execute(db, fmt::format("PRAGMA incremental_vacuum({})", kPagesPerStep))) {
+					break;
+				}
+			}
+			remaining = pragmaValue(db, "PRAGMA freelist_count");
+			wait(kPauseBetweenStepsMs);
+		}
+	}
+	else {
+		// Full auto vacuum gives the pages back with every commit already
+		return 0;
+	}
+
+	// In WAL mode the file only shrinks when the log is written back, don't wait for readers to let go
+	execute(db, "PRAGMA wal_checkpoint(PASSIVE)");
+	int64 shrunk = std::max((int64) 0, pages - pragmaValue(db, "PRAGMA page_count"));
+	if (shrunk > 0) {
+		Metrics::instance().counter("database.bytes_reclaimed").add((uint64) (shrunk * pageSize));
+		spdlog::info("Database maintenance gave {} of unused space in {} back to the disk", File::descriptionOfSizeInBytes(shrunk * pageSize).toStdString(), file.getFileName());
+	}
+	return shrunk;
+}
+
+bool DatabaseMaintenance::compact(File const &file, std::string &outError)
+{
+	sqlite3 *db = nullptr;
+	if (sqlite3_open_v2(file.getFullPathName().toRawUTF8(), &db, SQLITE_OPEN_READWRITE, nullptr) != SQLITE_OK) {
+		outError = sqlite3_errmsg(db);
+		sqlite3_close(db);
+		return false;
+	}
+	sqlite3_busy_timeout(db, kCompactBusyTimeoutMs);
+	int64 pages = pragmaValue(db, "PRAGMA page_count");
+	int64 pageSize = pragmaValue(db, "PRAGMA page_size");
+	bool ok;
+	{
+		MetricsTimer timer(Metrics::instance().histogram("database.vacuum"));
+		// The mode only takes effect with the VACUUM, from then on the free pages can be given back a few at a time
+		ok = sqlite3_exec(db, "PRAGMA auto_vacuum = INCREMENTAL", nullptr, nullptr, nullptr) == SQLITE_OK
+			&& sqlite3_exec(db, "VACUUM", nullptr, nullptr, nullptr) == SQLITE_OK;
+	}
+	if (ok) {
+		// In WAL mode the file only shrinks when the log is written back
+		sqlite3_exec(db, "PRAGMA wal_checkpoint(PASSIVE)", nullptr, nullptr, nullptr);
+		int64 shrunk = std::max((int64) 0, pages - pragmaValue(db, "PRAGMA page_count"));
+		Metrics::instance().counter("database.bytes_reclaimed").add((uint64) (shrunk * pageSize));
+		spdlog::info("Compacted database {}, gave {} back to the disk", file.getFileName(), File::descriptionOfSizeInBytes(shrunk * pageSize).toStdString());
+	}
+	else {
+		outError = sqlite3_errmsg(db);
+	}
+	sqlite3_close(db);
+	return ok;
+}
@@ -0,0 +1,66 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include "PatchDatabase.h"
+
+#include "IdleDetector.h"
+
+#include <atomic>
+
+struct sqlite3;
+
+// Keeps the database file in shape while nobody uses the app. The first time a file is visited, the DatabaseIndexes are created
+// if missing. After a good part of the file was written, the query planner
+// statistics are refreshed with ANALYZE, otherwise PRAGMA optimize decides if anything is due. The pages freed by deleting
+// patches or lists are given back to the file system a few at a time with SQLite's incremental vacuum. Every step is its own
+// short transaction with a short busy timeout, so when the writer is busy the step is dropped and tried again later.
+// A file made without incremental vacuum is never rewritten in the background, switching it on is left to the user with compact().
+class DatabaseMaintenance : private Thread, private ChangeListener {
+public:
+	explicit DatabaseMaintenance(midikraft::PatchDatabase &database);
+	~DatabaseMaintenance() override;
+
+	// How often to look whether anything is due, and how long without mouse activity before doing it
+	static constexpr int kCheckIntervalMs = 60 * 1000;
+	static constexpr int kIdleAfterInputMs = 10000;
+	// Share of the pages that must have changed since the last ANALYZE for a new one
+	static constexpr double kAnalyzeAfterChangedShare = 0.1;
+	// Share of free pages in the file before they are given back, and how many go per step
+	static constexpr double kVacuumAfterFreeShare = 0.1;
+	static constexpr int kPagesPerStep = 128;
+	static constexpr int kPauseBetweenStepsMs = 250;
+
+	// Rewrites the whole file with one full VACUUM and switches on incremental vacuum for it, so the idle maintenance can give
+	// free pages back from then on. Blocks until done, run it from a progress window
+	static bool compact(File const &file, std::string &outError);
+
+private:
+	void run() override;
+	void changeListenerCallback(ChangeBroadcaster* source) override;
+
+	void maintain(File const &file);
+	void refreshStatistics(sqlite3 *db, int64 pages, int64 freePages);
+	// Returns the number of pages the file shrunk by
+	int64 giveBackFreePages(sqlite3 *db, File const &file, int64 pages, int64 freePages);
+	bool shouldYield() const;
+
+	midikraft::PatchDatabase &database_;
+	CriticalSection lock_;
+	File file_; // Guarded by lock_, set on the message thread
+	IdleDetector idle_;
+	std::atomic<bool> restart_ { false };
+
+	// Only used by the thread
+	File maintained_;
+	int64 pagesAtAnalyze_ = -1;
+	int64 freePagesAtAnalyze_ = -1;
+	bool compactSuggested_ = false;
+	bool indexesEnsured_ = false;
+};
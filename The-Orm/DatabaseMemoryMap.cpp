@@ -0,0 +1,30 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "DatabaseMemoryMap.h"
+
+#include "Settings.h"
+
+#include <spdlog/spdlog.h>
+#include "SpdLogJuce.h"
+
+#include <sqlite3.h>
+
+#include <algorithm>
+
+bool DatabaseMemoryMap::configure()
+{
+	int megabytes = String(Settings::instance().get("DatabaseMemoryMapMB", std::to_string(kDefaultMegabytes))).getIntValue();
+	sqlite3_int64 bytes = (sqlite3_int64) std::max(0, megabytes) * 1024 * 1024;
+	// Default and maximum for each connection, SQLite caps this further at its compile time limit
+	int rc = sqlite3_config(SQLITE_CONFIG_MMAP_SIZE, bytes, bytes);
+	if (rc != SQLITE_OK) {
+		spdlog::warn("Could not configure memory mapped database access, error {}", rc);
+		return false;
+	}
+	spdlog::debug("Database files are memory mapped up to {} MB", megabytes);
+	return true;
+}
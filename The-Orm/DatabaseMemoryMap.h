@@ -0,0 +1,20 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+// Lets all SQLite connections of the process read the database file through a memory mapping instead of read() calls,
+// so a library that fits the limit is queried from the page cache directly. Writes still go through the journal as before,
+// so nothing about crash safety changes. This has to be configured before the first connection is opened.
+class DatabaseMemoryMap {
+public:
+	// The limit is the setting "DatabaseMemoryMapMB", 0 turns the mapping off. Returns false if SQLite refused the setting
+	static bool configure();
+
+	static constexpr int kDefaultMegabytes = 256;
+};
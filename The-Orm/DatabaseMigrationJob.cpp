@@ -0,0 +1,74 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "DatabaseMigrationJob.h"
+
+#include "DatabaseBackup.h"
+#include "PatchDatabase.h"
+
+#include <spdlog/spdlog.h>
+#include "SpdLogJuce.h"
+
+DatabaseMigrationJob::DatabaseMigrationJob(File const &database) :
+	BackgroundJob("Migrating " + database.getFileName(), 1), database_(database), backup_(DatabaseBackup::backupFileFor(database, "-before-migration"))
+{
+}
+
+bool DatabaseMigrationJob::needsMigration(File const &database)
+{
+	try {
+		midikraft::PatchDatabase probe(database.getFullPathName().toStdString(), midikraft::PatchDatabase::OpenMode::READ_ONLY);
+		return false;
+	}
+	catch (midikraft::PatchDatabaseReadonlyException &e) {
+		ignoreUnused(e);
+		return true;
+	}
+	catch (midikraft::PatchDatabaseException &e) {
+		// Not for us to report, the regular open says what is wrong with the file
+		ignoreUnused(e);
+		return false;
+	}
+}
+
+bool DatabaseMigrationJob::run()
+{
+	setStatus("Creating backup");
+	if (!DatabaseBackup::copy(database_, backup_, [this](double progress) {
+		setProgress(progress * 0.5);
+		return !shouldExit();
+	}, error_)) {
+		if (error_.empty()) {
+			error_ = "Cancelled";
+		}
+		return false;
+	}
+	spdlog::info("Created database backup at {}", backup_.getFullPathName());
+
+	// The schema migration runs inside the database code as one step, there is no progress to report until it is done
+	setStatus("Migrating to the current version");
+	try {
+		midikraft::PatchDatabase migrated(database_.getFullPathName().toStdString(), midikraft::PatchDatabase::OpenMode::READ_WRITE_NO_BACKUPS);
+	}
+	catch (midikraft::PatchDatabaseException &e) {
+		error_ = e.what();
+		setStatus("Failed, the backup is at " + backup_.getFullPathName());
+		return false;
+	}
+	setProgress(1.0);
+	setStatus("Done");
+	return true;
+}
+
+std::string const &DatabaseMigrationJob::error() const
+{
+	return error_;
+}
+
+File const &DatabaseMigrationJob::backupFile() const
+{
+	return backup_;
+}
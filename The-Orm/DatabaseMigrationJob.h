@@ -0,0 +1,36 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include "BackgroundJobs.h"
+
+#include <string>
+
+// Brings a database file written by an older version up to the current schema on a worker. Opening the file for writing would
+// do the same on the message thread, which freezes the window for minutes with a big library. The file is backed up first,
+// then opened for writing once on the worker, which migrates it. Afterwards switching to it is as quick as to any current file,
+// and until then the database open before stays usable.
+class DatabaseMigrationJob : public BackgroundJob {
+public:
+	explicit DatabaseMigrationJob(File const &database);
+
+	// True if the file can't be opened read-only because its schema is older than this version
+	static bool needsMigration(File const &database);
+
+	bool run() override;
+
+	// Why run() failed, read it once the job is done
+	std::string const &error() const;
+	File const &backupFile() const;
+
+private:
+	File database_;
+	File backup_;
+	std::string error_;
+};
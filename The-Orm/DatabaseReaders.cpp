@@ -0,0 +1,118 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "DatabaseReaders.h"
+
+#include "UIModel.h"
+
+#include <spdlog/spdlog.h>
+#include "SpdLogJuce.h"
+
+#include <sqlite3.h>
+
+#include <algorithm>
+
+namespace {
+
+	// Setting the mode needs the file for a moment, the writer might just be in a transaction
+	constexpr int kBusyTimeoutMs = 2000;
+
+}
+
+DatabaseReaders::DatabaseReaders(midikraft::PatchDatabase &writer, size_t numReaders) : writer_(writer), numReaders_(std::max(numReaders, (size_t) 1))
+{
+	UIModel::instance()->databaseChanged.addChangeListener(this);
+	UIModel::instance()->categoriesChanged.addChangeListener(this);
+}
+
+DatabaseReaders::~DatabaseReaders()
+{
+	UIModel::instance()->categoriesChanged.removeChangeListener(this);
+	UIModel::instance()->databaseChanged.removeChangeListener(this);
+}
+
+bool DatabaseReaders::enableWriteAheadLog(File const &database, std::string &outError)
+{
+	sqlite3 *db = nullptr;
+	if (sqlite3_open_v2(database.getFullPathName().toRawUTF8(), &db, SQLITE_OPEN_READWRITE, nullptr) != SQLITE_OK) {
+		outError = std::string("Can't open database: ") + sqlite3_errmsg(db);
+		sqlite3_close(db);
+		return false;
+	}
+	sqlite3_busy_timeout(db, kBusyTimeoutMs);
+	std::string mode;
+	sqlite3_stmt *statement = nullptr;
+	if (sqlite3_prepare_v2(db, "PRAGMA journal_mode=WAL", -1, &statement, nullptr) == SQLITE_OK) {
+		if (sqlite3_step(statement) == SQLITE_ROW) {
+			auto text = sqlite3_column_text(statement, 0);
+			mode = text ? reinterpret_cast<const char *>(text) : "";
+		}
+	}
+	if (mode != "wal") {
+		outError = std::string("Can't switch to write-ahead log: ") + (mode.empty() ? sqlite3_errmsg(db) : "journal mode stays " + mode);
+	}
+	sqlite3_finalize(statement);
+	sqlite3_close(db);
+	return mode == "wal";
+}
+
+std::shared_ptr<midikraft::PatchDatabase> DatabaseReaders::reader()
+{
+	ScopedLock lock(lock_);
+	File current(writer_.getCurrentDatabaseFileName());
+	if (current != file_) {
+		close();
+		file_ = current;
+	}
+	if (readers_.empty() && !unusable_) {
+		open(file_);
+	}
+	if (readers_.empty()) {
+		// Not owned, the writer outlives us
+		return std::shared_ptr<midikraft::PatchDatabase>(std::shared_ptr<midikraft::PatchDatabase>(), &writer_);
+	}
+	next_ = (next_ + 1) % readers_.size();
+	return readers_[next_];
+}
+
+void DatabaseReaders::open(File const &database)
+{
+	std::string error;
+	if (!database.existsAsFile() || !enableWriteAheadLog(database, error)) {
+		// Without the WAL a reader would have to wait for the writer just the same
+		if (!error.empty()) {
+			spdlog::warn("Database {} is used with a single connection. {}", database.getFullPathName(), error);
+		}
+		unusable_ = true;
+		return;
+	}
+	try {
+		for (size_t i = 0; i < numReaders_; i++) {
+			readers_.push_back(std::make_shared<midikraft::PatchDatabase>(database.getFullPathName().toStdString(), midikraft::PatchDatabase::OpenMode::READ_ONLY));
+		}
+	}
+	catch (std::exception &e) {
+		spdlog::warn("Can't open read-only connections to database {}, using a single connection: {}", database.getFullPathName(), e.what());
+		readers_.clear();
+		unusable_ = true;
+	}
+}
+
+void DatabaseReaders::close()
+{
+	// Queries still running keep their connection alive until they are done
+	readers_.clear();
+	next_ = 0;
+	unusable_ = false;
+}
+
+void DatabaseReaders::changeListenerCallback(ChangeBroadcaster* source)
+{
+	ignoreUnused(source);
+	// The readers have loaded the categories when they were opened, and now might even look at the wrong file
+	ScopedLock lock(lock_);
+	close();
+}
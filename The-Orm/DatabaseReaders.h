@@ -0,0 +1,44 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include "PatchDatabase.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+// Read-only connections to the database file the writer has open, for the queries of the UI. The file is switched to SQLite's
+// write-ahead log, so these readers see the last committed state and never wait for a long import or reindex on the writer.
+// The connections are opened on first use and closed when the database or the categories change. If the file can't be put
+// into WAL mode, e.g. on a network drive, the writer itself is handed out.
+class DatabaseReaders : private ChangeListener {
+public:
+	explicit DatabaseReaders(midikraft::PatchDatabase &writer, size_t numReaders = 2);
+	~DatabaseReaders() override;
+
+	// Keep the pointer until the query has finished, also for asynchronous queries
+	std::shared_ptr<midikraft::PatchDatabase> reader();
+
+	// Switches the file to the write-ahead log, the mode is stored in the file and used by all connections from then on
+	static bool enableWriteAheadLog(File const &database, std::string &outError);
+
+private:
+	void changeListenerCallback(ChangeBroadcaster* source) override;
+	void open(File const &database);
+	void close();
+
+	midikraft::PatchDatabase &writer_;
+	size_t numReaders_;
+	CriticalSection lock_;
+	File file_;
+	bool unusable_ = false; // Opening readers for file_ failed, use the writer
+	std::vector<std::shared_ptr<midikraft::PatchDatabase>> readers_;
+	size_t next_ = 0;
+};
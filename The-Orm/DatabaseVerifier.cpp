@@ -0,0 +1,281 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "DatabaseVerifier.h"
+
+#include "DatabaseIndexes.h"
+
+#include "UIModel.h"
+
+#include <spdlog/spdlog.h>
+#include "SpdLogJuce.h"
+
+#include <sqlite3.h>
+
+#include <algorithm>
+#include <set>
+
+namespace {
+
+	// Removing list entries needs the write lock, the writer might just be in a transaction
+	constexpr int kBusyTimeoutMs = 2000;
+
+	bool hasColumns(sqlite3 *db, std::string const &table, std::vector<std::string> const &wanted)
+	{
+		auto columns = DatabaseIndexes::columnsOf(db, table);
+		return std::all_of(wanted.begin(), wanted.end(), [&columns](std::string const &column) { return columns.count(column) != 0; });
+	}
+
+	std::string text(sqlite3_stmt *statement, int column)
+	{
+		auto value = sqlite3_column_text(statement, column);
+		return value ? reinterpret_cast<const char *>(value) : "";
+	}
+
+	struct StoredPatch {
+		std::string synth;
+		std::string md5;
+		std::string name;
+		std::vector<uint8> data;
+	};
+
+	char const *kOrphanedEntries = "SELECT e.rowid, e.id, e.synth, e.md5 FROM patch_in_list e WHERE e.rowid > ? AND e.rowid <= ? "
+		"AND NOT EXISTS (SELECT 1 FROM patches p WHERE p.synth = e.synth AND p.md5 = e.md5)";
+
+}
+
+struct DatabaseVerifier::Pass {
+	sqlite3 *db = nullptr;
+	std::vector<Finding> findings;
+	size_t checked = 0;
+};
+
+DatabaseVerifier::DatabaseVerifier(midikraft::PatchDatabase &database, std::vector<midikraft::SynthHolder> const &synths) :
+	Thread("DatabaseVerifier"), database_(database), synths_(synths), file_(database.getCurrentDatabaseFileName())
+{
+	UIModel::instance()->databaseChanged.addChangeListener(this);
+	startThread(1);
+}
+
+DatabaseVerifier::~DatabaseVerifier()
+{
+	UIModel::instance()->databaseChanged.removeChangeListener(this);
+	signalThreadShouldExit();
+	notify();
+	stopThread(5000);
+}
+
+std::vector<DatabaseVerifier::Finding> DatabaseVerifier::findings() const
+{
+	ScopedLock lock(lock_);
+	return findings_;
+}
+
+size_t DatabaseVerifier::patchesChecked() const
+{
+	return patchesChecked_;
+}
+
+void DatabaseVerifier::recheck()
+{
+	restart_ = true;
+	notify();
+}
+
+void DatabaseVerifier::changeListenerCallback(ChangeBroadcaster* source)
+{
+	ignoreUnused(source);
+	{
+		ScopedLock lock(lock_);
+		file_ = File(database_.getCurrentDatabaseFileName());
+		findings_.clear();
+	}
+	patchesChecked_ = 0;
+	recheck();
+}
+
+bool DatabaseVerifier::waitUntilIdle()
+{
+	while (!threadShouldExit() && !restart_) {
+		if (idle_.isIdle(kIdleAfterInputMs)) {
+			return true;
+		}
+		wait(500);
+	}
+	return false;
+}
+
+std::shared_ptr<midikraft::Synth> DatabaseVerifier::synthNamed(std::string const &name) const
+{
+	for (auto const &holder : synths_) {
+		auto synth = holder.smartSynth();
+		if (synth && synth->getName() == name) {
+			return synth;
+		}
+	}
+	return nullptr;
+}
+
+void DatabaseVerifier::run()
+{
+	while (!threadShouldExit()) {
+		restart_ = false;
+		File file;
+		{
+			ScopedLock lock(lock_);
+			file = file_;
+		}
+		Pass pass;
+		if (file.existsAsFile() && sqlite3_open_v2(file.getFullPathName().toRawUTF8(), &pass.db, SQLITE_OPEN_READONLY, nullptr) == SQLITE_OK) {
+			bool complete = checkPatches(pass) && checkListEntries(pass);
+			if (complete) {
+				{
+					ScopedLock lock(lock_);
+					findings_.swap(pass.findings);
+				}
+				spdlog::debug("Database check of {} patches complete, {} problems found", pass.checked, findings().size());
+				sendChangeMessage();
+			}
+		}
+		sqlite3_close(pass.db);
+		if (!restart_) {
+			wait(kPassIntervalMs);
+		}
+	}
+}
+
+bool DatabaseVerifier::checkPatches(Pass &pass)
+{
+	if (!hasColumns(pass.db, "patches", { "synth", "md5", "name", "data" })) {
+		return true;
+	}
+	sqlite3_stmt *statement = nullptr;
+	if (sqlite3_prepare_v2(pass.db, "SELECT rowid, synth, md5, name, data FROM patches WHERE rowid > ? ORDER BY rowid LIMIT ?", -1, &statement, nullptr) != SQLITE_OK) {
+		spdlog::warn("Can't check the patches of the database: {}", sqlite3_errmsg(pass.db));
+		sqlite3_finalize(statement);
+		return false;
+	}
+	sqlite3_int64 lastRow = 0;
+	bool moreRows = true;
+	while (moreRows) {
+		if (!waitUntilIdle()) {
+			sqlite3_finalize(statement);
+			return false;
+		}
+		std::vector<StoredPatch> batch;
+		sqlite3_bind_int64(statement, 1, lastRow);
+		sqlite3_bind_int(statement, 2, kPatchesPerBatch);
+		while (sqlite3_step(statement) == SQLITE_ROW) {
+			lastRow = sqlite3_column_int64(statement, 0);
+			auto data = static_cast<uint8 const *>(sqlite3_column_blob(statement, 4));
+			auto size = sqlite3_column_bytes(statement, 4);
+			batch.push_back({ text(statement, 1), text(statement, 2), text(statement, 3), data ? std::vector<uint8>(data, data + size) : std::vector<uint8>() });
+		}
+		// Ends the read, so the batch is decoded without holding a snapshot of the file
+		sqlite3_reset(statement);
+		moreRows = batch.size() == (size_t) kPatchesPerBatch;
+
+		for (auto const &stored : batch) {
+			pass.checked++;
+			if (stored.data.empty()) {
+				pass.findings.push_back({ Problem::MissingData, stored.synth, stored.md5, stored.name, 0 });
+				continue;
+			}
+			auto synth = synthNamed(stored.synth);
+			if (!synth) {
+				// Not a synth of this build, nothing to judge the data with
+				continue;
+			}
+			std::shared_ptr<midikraft::DataFile> patch;
+			try {
+				patch = synth->patchFromPatchData(stored.data, MidiProgramNumber::fromZeroBase(0));
+			}
+			catch (std::exception &e) {
+				spdlog::debug("Decoding patch {} of {} failed: {}", stored.name, stored.synth, e.what());
+			}
+			if (!patch) {
+				pass.findings.push_back({ Problem::UndecodableData, stored.synth, stored.md5, stored.name, 0 });
+			}
+			else if (synth->calculateFingerprint(patch) != stored.md5) {
+				pass.findings.push_back({ Problem::StaleFingerprint, stored.synth, stored.md5, stored.name, 0 });
+			}
+		}
+		patchesChecked_ = pass.checked;
+		wait(kPauseBetweenBatchesMs);
+	}
+	sqlite3_finalize(statement);
+	return !threadShouldExit();
+}
+
+bool DatabaseVerifier::checkListEntries(Pass &pass)
+{
+	if (!hasColumns(pass.db, "patch_in_list", { "id", "synth", "md5" })) {
+		return true;
+	}
+	sqlite3_int64 maxRow = 0;
+	sqlite3_stmt *statement = nullptr;
+	if (sqlite3_prepare_v2(pass.db, "SELECT max(rowid) FROM patch_in_list", -1, &statement, nullptr) == SQLITE_OK && sqlite3_step(statement) == SQLITE_ROW) {
+		maxRow = sqlite3_column_int64(statement, 0);
+	}
+	sqlite3_finalize(statement);
+	statement = nullptr;
+	if (sqlite3_prepare_v2(pass.db, kOrphanedEntries, -1, &statement, nullptr) != SQLITE_OK) {
+		spdlog::warn("Can't check the lists of the database: {}", sqlite3_errmsg(pass.db));
+		sqlite3_finalize(statement);
+		return false;
+	}
+	for (sqlite3_int64 from = 0; from < maxRow; from += kListEntriesPerBatch) {
+		if (!waitUntilIdle()) {
+			sqlite3_finalize(statement);
+			return false;
+		}
+		sqlite3_bind_int64(statement, 1, from);
+		sqlite3_bind_int64(statement, 2, from + kListEntriesPerBatch);
+		while (sqlite3_step(statement) == SQLITE_ROW) {
+			pass.findings.push_back({ Problem::OrphanedListEntry, text(statement, 2), text(statement, 3), text(statement, 1), sqlite3_column_int64(statement, 0) });
+		}
+		sqlite3_reset(statement);
+		wait(kPauseBetweenBatchesMs);
+	}
+	sqlite3_finalize(statement);
+	return !threadShouldExit();
+}
+
+bool DatabaseVerifier::removeOrphanedListEntries(File const &database, std::vector<Finding> const &findings, std::string &outError)
+{
+	sqlite3 *db = nullptr;
+	if (sqlite3_open_v2(database.getFullPathName().toRawUTF8(), &db, SQLITE_OPEN_READWRITE, nullptr) != SQLITE_OK) {
+		outError = std::string("Can't open database: ") + sqlite3_errmsg(db);
+		sqlite3_close(db);
+		return false;
+	}
+	sqlite3_busy_timeout(db, kBusyTimeoutMs);
+	// The patch might have come back since the check, only entries still pointing nowhere go
+	sqlite3_stmt *statement = nullptr;
+	bool ok = sqlite3_exec(db, "BEGIN IMMEDIATE", nullptr, nullptr, nullptr) == SQLITE_OK
+		&& sqlite3_prepare_v2(db, "DELETE FROM patch_in_list WHERE rowid = ? "
+			"AND NOT EXISTS (SELECT 1 FROM patches p WHERE p.synth = patch_in_list.synth AND p.md5 = patch_in_list.md5)", -1, &statement, nullptr) == SQLITE_OK;
+	for (auto const &finding : findings) {
+		if (!ok) {
+			break;
+		}
+		if (finding.problem == Problem::OrphanedListEntry) {
+			sqlite3_bind_int64(statement, 1, finding.row);
+			ok = sqlite3_step(statement) == SQLITE_DONE;
+			sqlite3_reset(statement);
+		}
+	}
+	sqlite3_finalize(statement);
+	if (ok) {
+		ok = sqlite3_exec(db, "COMMIT", nullptr, nullptr, nullptr) == SQLITE_OK;
+	}
+	if (!ok) {
+		outError = std::string("Can't remove the list entries: ") + sqlite3_errmsg(db);
+		sqlite3_exec(db, "ROLLBACK", nullptr, nullptr, nullptr);
+	}
+	sqlite3_close(db);
+	return ok;
+}
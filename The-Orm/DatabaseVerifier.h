@@ -0,0 +1,81 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include "PatchDatabase.h"
+#include "SynthHolder.h"
+
+#include "IdleDetector.h"
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+// Walks the database file on a low priority thread while nobody uses the mouse, a small batch of patches at a time.
+// Each patch must have data its synth can decode, and the fingerprint it is stored under must still be the one the
+// synth calculates for it. List entries must point to a patch that exists. What is found is kept for the user to repair
+// in one go, instead of surfacing when somebody clicks on the broken patch. The file is read with its own read-only
+// connection, so in WAL mode the writer is never blocked.
+class DatabaseVerifier : public ChangeBroadcaster, private Thread, private ChangeListener {
+public:
+	enum class Problem {
+		MissingData = 0,
+		UndecodableData = 1,
+		StaleFingerprint = 2,
+		OrphanedListEntry = 3
+	};
+
+	struct Finding {
+		Problem problem;
+		std::string synth;
+		std::string md5;
+		std::string name; // Of the patch, or the id of the list for an orphaned entry
+		int64 row; // Of the list entry, to remove exactly that one
+	};
+
+	DatabaseVerifier(midikraft::PatchDatabase &database, std::vector<midikraft::SynthHolder> const &synths);
+	~DatabaseVerifier() override;
+
+	// Of the last complete pass. A change message is sent when a pass is complete
+	std::vector<Finding> findings() const;
+	size_t patchesChecked() const;
+	// Starts a new pass right away, e.g. after a repair
+	void recheck();
+
+	// Removes the list entries of these findings that point nowhere, returns false with the error if the file could not be changed
+	static bool removeOrphanedListEntries(File const &database, std::vector<Finding> const &findings, std::string &outError);
+
+	static constexpr int kPatchesPerBatch = 50;
+	static constexpr int kListEntriesPerBatch = 500;
+	static constexpr int kPauseBetweenBatchesMs = 200;
+	// Without mouse activity for this long the app counts as idle
+	static constexpr int kIdleAfterInputMs = 5000;
+	// A database that passed is looked at again after this time
+	static constexpr int kPassIntervalMs = 60 * 60 * 1000;
+
+private:
+	struct Pass;
+
+	void run() override;
+	void changeListenerCallback(ChangeBroadcaster* source) override;
+
+	bool waitUntilIdle();
+	bool checkPatches(Pass &pass);
+	bool checkListEntries(Pass &pass);
+	std::shared_ptr<midikraft::Synth> synthNamed(std::string const &name) const;
+
+	midikraft::PatchDatabase &database_;
+	std::vector<midikraft::SynthHolder> synths_;
+	mutable CriticalSection lock_;
+	File file_; // Guarded by lock_, set on the message thread
+	std::vector<Finding> findings_;
+	std::atomic<size_t> patchesChecked_ { 0 };
+	std::atomic<bool> restart_ { false };
+	IdleDetector idle_;
+};
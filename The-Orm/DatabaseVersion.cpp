@@ -0,0 +1,71 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "DatabaseVersion.h"
+
+#include "UIModel.h"
+
+#include <spdlog/spdlog.h>
+#include "SpdLogJuce.h"
+
+#include <sqlite3.h>
+
+DatabaseVersion::DatabaseVersion(midikraft::PatchDatabase &writer) : writer_(writer)
+{
+	UIModel::instance()->databaseChanged.addChangeListener(this);
+	UIModel::instance()->categoriesChanged.addChangeListener(this);
+}
+
+DatabaseVersion::~DatabaseVersion()
+{
+	UIModel::instance()->categoriesChanged.removeChangeListener(this);
+	UIModel::instance()->databaseChanged.removeChangeListener(this);
+	closeProbe();
+}
+
+DatabaseVersion::Stamp DatabaseVersion::current()
+{
+	ScopedLock lock(lock_);
+	Stamp result;
+	File current(writer_.getCurrentDatabaseFileName());
+	if (current != file_) {
+		closeProbe();
+		file_ = current;
+		epoch_++;
+	}
+	result.epoch = epoch_;
+	if (!probe_) {
+		if (!file_.existsAsFile() || sqlite3_open_v2(file_.getFullPathName().toRawUTF8(), &probe_, SQLITE_OPEN_READONLY, nullptr) != SQLITE_OK) {
+			spdlog::debug("Can't open {} to check for changes, query results are not reused", file_.getFullPathName());
+			closeProbe();
+			return result;
+		}
+	}
+	sqlite3_stmt *statement = nullptr;
+	if (sqlite3_prepare_v2(probe_, "PRAGMA data_version", -1, &statement, nullptr) == SQLITE_OK) {
+		if (sqlite3_step(statement) == SQLITE_ROW) {
+			result.dataVersion = sqlite3_column_int64(statement, 0);
+		}
+	}
+	sqlite3_finalize(statement);
+	return result;
+}
+
+void DatabaseVersion::closeProbe()
+{
+	if (probe_) {
+		sqlite3_close(probe_);
+		probe_ = nullptr;
+	}
+}
+
+void DatabaseVersion::changeListenerCallback(ChangeBroadcaster* source)
+{
+	ignoreUnused(source);
+	// A different file or changed category definitions, results from before might not match anymore
+	ScopedLock lock(lock_);
+	epoch_++;
+}
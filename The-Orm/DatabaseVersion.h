@@ -0,0 +1,45 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include "PatchDatabase.h"
+
+struct sqlite3;
+
+// Tells whether anything was committed to the database file since a query ran, so its result can be reused. This is SQLite's
+// PRAGMA data_version read on a probe connection that never writes, which changes with every commit of the writer, the readers
+// and the imports alike. Switching the database or changing the categories starts a new epoch, so older stamps never match.
+class DatabaseVersion : private ChangeListener {
+public:
+	struct Stamp {
+		int epoch = 0;
+		int64 dataVersion = -1;
+
+		// Invalid if the version can't be determined, then nothing must be reused
+		bool isValid() const { return dataVersion != -1; }
+		bool operator==(Stamp const &other) const { return isValid() && epoch == other.epoch && dataVersion == other.dataVersion; }
+		bool operator!=(Stamp const &other) const { return !(*this == other); }
+	};
+
+	explicit DatabaseVersion(midikraft::PatchDatabase &writer);
+	~DatabaseVersion() override;
+
+	// Take this before running the query whose result is to be kept
+	Stamp current();
+
+private:
+	void changeListenerCallback(ChangeBroadcaster* source) override;
+	void closeProbe();
+
+	midikraft::PatchDatabase &writer_;
+	CriticalSection lock_;
+	File file_;
+	int epoch_ = 0;
+	sqlite3 *probe_ = nullptr;
+};
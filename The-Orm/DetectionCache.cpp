@@ -0,0 +1,166 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "DetectionCache.h"
+
+#include "ConcurrentAutoDetection.h"
+#include "Settings.h"
+
+#include <spdlog/spdlog.h>
+#include "SpdLogJuce.h"
+
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+
+namespace {
+
+	bool findDevice(Array<MidiDeviceInfo> const &devices, String const &identifier, MidiDeviceInfo &outDevice) {
+		for (auto const &device : devices) {
+			if (device.identifier == identifier) {
+				outDevice = device;
+				return true;
+			}
+		}
+		return false;
+	}
+
+}
+
+std::string DetectionCache::settingsKey(midikraft::SimpleDiscoverableDevice &synth)
+{
+	return "lastDetected:" + synth.getName();
+}
+
+std::string DetectionCache::replyHash(MidiMessage const &reply)
+{
+	return MD5(reply.getRawData(), (size_t)reply.getRawDataSize()).toHexString().toStdString();
+}
+
+void DetectionCache::remember(midikraft::SimpleDiscoverableDevice &synth, MidiMessage const *reply)
+{
+	nlohmann::json entry = {
+		{ "input", synth.midiInput().identifier.toStdString() },
+		{ "output", synth.midiOutput().identifier.toStdString() },
+		{ "channel", synth.channel().toZeroBasedInt() },
+		{ "reply", reply ? replyHash(*reply) : std::string() }
+	};
+	Settings::instance().set(settingsKey(synth), entry.dump());
+}
+
+void DetectionCache::forget(midikraft::SimpleDiscoverableDevice &synth)
+{
+	Settings::instance().set(settingsKey(synth), "");
+}
+
+std::string DetectionCache::replyFingerprint(midikraft::SimpleDiscoverableDevice &synth)
+{
+	auto stored = Settings::instance().get(settingsKey(synth));
+	if (stored.empty()) {
+		return {};
+	}
+	try {
+		return nlohmann::json::parse(stored).value("reply", std::string());
+	}
+	catch (nlohmann::json::exception &) {
+		return {};
+	}
+}
+
+DetectionCache::TSynthList DetectionCache::restore(TSynthList const &synths)
+{
+	TSynthList restored;
+	auto inputs = MidiInput::getAvailableDevices();
+	auto outputs = MidiOutput::getAvailableDevices();
+	for (auto const &synth : synths) {
+		auto stored = Settings::instance().get(settingsKey(*synth));
+		if (stored.empty()) {
+			continue;
+		}
+		try {
+			auto entry = nlohmann::json::parse(stored);
+			MidiDeviceInfo input, output;
+			if (findDevice(inputs, String(entry.value("input", std::string())), input) && findDevice(outputs, String(entry.value("output", std::string())), output)) {
+				int channel = entry.value("channel", -1);
+				if (channel >= 0 && channel < 16) {
+					synth->setCurrentChannelZeroBased(input, output, channel);
+					synth->setWasDetected(true);
+					restored.push_back(synth);
+				}
+			}
+		}
+		catch (nlohmann::json::exception &e) {
+			spdlog::error("Stored detection of {} corrupt, ignoring it. Error is {}", synth->getName(), e.what());
+		}
+	}
+	return restored;
+}
+
+DetectionCache::TSynthList DetectionCache::verify(TSynthList const &synths)
+{
+	TSynthList failed;
+	if (synths.empty()) {
+		return failed;
+	}
+
+	ConcurrentAutoDetection::ReplyCollector collector;
+	int waitMs = 0;
+	for (auto const &synth : synths) {
+		midikraft::MidiController::instance()->enableMidiInput(synth->midiInput());
+		int channel = synth->needsChannelSpecificDetection() ? synth->channel().toZeroBasedInt() : 0;
+		auto messages = synth->deviceDetect(channel);
+		if (!messages.empty()) {
+			midikraft::MidiController::instance()->getMidiOutput(synth->midiOutput())->sendBlockOfMessagesFullSpeed(messages);
+		}
+		waitMs = std::max(waitMs, synth->deviceDetectSleepMS());
+	}
+	Thread::sleep(waitMs);
+
+	auto replies = collector.take();
+	for (auto const &synth : synths) {
+		auto expectedHash = nlohmann::json::parse(Settings::instance().get(settingsKey(*synth), "{}")).value("reply", std::string());
+		bool confirmed = false;
+		for (auto const &reply : replies) {
+			if (reply.input.identifier != synth->midiInput().identifier) {
+				continue;
+			}
+			auto channel = synth->channelIfValidDeviceResponse(reply.message);
+			if (channel.isValid() && channel.toZeroBasedInt() == synth->channel().toZeroBasedInt()
+				&& (expectedHash.empty() || replyHash(reply.message) == expectedHash)) {
+				confirmed = true;
+				break;
+			}
+		}
+		if (!confirmed) {
+			spdlog::info("{} did not answer at its last known location, detecting it again", synth->getName());
+			synth->setWasDetected(false);
+			forget(*synth);
+			failed.push_back(synth);
+		}
+	}
+	return failed;
+}
+
+DetectionVerificationThread::DetectionVerificationThread(DetectionCache::TSynthList synths, std::function<void(DetectionCache::TSynthList)> onFailed) :
+	Thread("DetectionVerification"), synths_(synths), onFailed_(onFailed)
+{
+}
+
+DetectionVerificationThread::~DetectionVerificationThread()
+{
+	stopThread(2000);
+}
+
+void DetectionVerificationThread::run()
+{
+	auto failed = DetectionCache::verify(synths_);
+	if (!threadShouldExit()) {
+		auto onFailed = onFailed_;
+		MessageManager::callAsync([onFailed, failed]() {
+			onFailed(failed);
+		});
+	}
+}
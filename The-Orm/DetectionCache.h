@@ -0,0 +1,54 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include "DiscoverableDevice.h"
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+// Remembers where each synth was last detected, so the Orm can start with the synths marked as detected right away
+// and only verify in the background that nothing in the rack changed.
+class DetectionCache {
+public:
+	using TSynthList = std::vector<std::shared_ptr<midikraft::SimpleDiscoverableDevice>>;
+
+	// Store the current location of a detected synth. Pass the detection reply if known, a later verification then also compares it
+	static void remember(midikraft::SimpleDiscoverableDevice &synth, MidiMessage const *reply);
+	static void forget(midikraft::SimpleDiscoverableDevice &synth);
+	// Hash of the reply the synth was last detected with, empty if not known. Identity replies carry the firmware version,
+	// so this changes with a firmware update
+	static std::string replyFingerprint(midikraft::SimpleDiscoverableDevice &synth);
+
+	// Applies the remembered locations whose MIDI devices are still available and marks these synths as detected.
+	// Returns the synths restored, the others need a regular detection
+	static TSynthList restore(TSynthList const &synths);
+
+	// Probes each synth only at its remembered location, with one wait for all. Synths not answering as expected are marked
+	// as not detected and forgotten. Returns these, blocking, so call it from a background thread
+	static TSynthList verify(TSynthList const &synths);
+
+private:
+	static std::string settingsKey(midikraft::SimpleDiscoverableDevice &synth);
+	static std::string replyHash(MidiMessage const &reply);
+};
+
+// Runs the verification of restored synths off the message thread and reports the synths that failed it on the message thread
+class DetectionVerificationThread : public Thread {
+public:
+	DetectionVerificationThread(DetectionCache::TSynthList synths, std::function<void(DetectionCache::TSynthList)> onFailed);
+	~DetectionVerificationThread() override;
+
+	void run() override;
+
+private:
+	DetectionCache::TSynthList synths_;
+	std::function<void(DetectionCache::TSynthList)> onFailed_;
+};
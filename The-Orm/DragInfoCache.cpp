@@ -0,0 +1,21 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "DragInfoCache.h"
+
+String DragInfoCache::lastDescription_;
+nlohmann::json DragInfoCache::lastInfos_;
+
+nlohmann::json const &DragInfoCache::parse(var const &description)
+{
+	String descriptionString = description;
+	// The var of one drag shares its string, so mostly the text pointer already tells it is the same description
+	if (descriptionString.getCharPointer() != lastDescription_.getCharPointer() && descriptionString != lastDescription_) {
+		lastInfos_ = midikraft::PatchHolder::dragInfoFromString(descriptionString.toStdString());
+		lastDescription_ = descriptionString;
+	}
+	return lastInfos_;
+}
@@ -0,0 +1,23 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include "PatchHolder.h"
+
+// While dragging, every drop target hovered is asked if it accepts the item, and they all look at the same drag description.
+// This parses a description only the first time it is seen and hands out the parsed infos for the rest of the drag.
+class DragInfoCache {
+public:
+	// Message thread only, like all drag and drop. The reference stays valid until called with another description
+	static nlohmann::json const &parse(var const &description);
+
+private:
+	static String lastDescription_;
+	static nlohmann::json lastInfos_;
+};
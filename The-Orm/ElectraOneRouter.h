@@ -6,8 +6,9 @@
 
 #pragma once
 
-#include "MidiController.h"
+#include "MidiRouter.h"
 
+// Forwards everything coming from the Electra One to the current synth, re-channeled to the synth's channel
 class ElectraOneRouter {
 public:
 	ElectraOneRouter();
@@ -17,6 +18,5 @@ public:
 
 private:
 	bool enabled_;
-	midikraft::MidiController::HandlerHandle routerCallback_ = midikraft::MidiController::makeNoneHandle();
+	MidiRouter router_;
 };
-
@@ -0,0 +1,231 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "HeadlessBenchmark.h"
+
+#include "PatchDatabase.h"
+#include "PatchHolder.h"
+#include "Sysex.h"
+#include "SysexCodecs.h"
+
+#include "PatchMergePreparation.h"
+#include "PatchTextRenderer.h"
+#include "ScriptedQuery.h"
+
+#include "Virus.h"
+#include "Rev2.h"
+#include "OB6.h"
+#include "KorgDW8000.h"
+#include "KawaiK3.h"
+#include "Matrix1000.h"
+#include "RefaceDX.h"
+#include "MKS80.h"
+#include "MKS50.h"
+
+#include "GenericAdaptation.h"
+
+#include <nlohmann/json.hpp>
+#include <spdlog/spdlog.h>
+#include "SpdLogJuce.h"
+
+#include <chrono>
+
+namespace {
+
+	// Repeats of the short measurements, so they are long enough to be compared between runs
+	constexpr int kCodecRounds = 20;
+	constexpr int kQueryRounds = 5;
+
+}
+
+HeadlessBenchmark::HeadlessBenchmark(std::vector<std::shared_ptr<midikraft::Synth>> synths, File fixtures) : synths_(std::move(synths)), fixtures_(fixtures)
+{
+}
+
+std::vector<std::shared_ptr<midikraft::Synth>> HeadlessBenchmark::builtinSynths()
+{
+	std::vector<std::shared_ptr<midikraft::Synth>> result;
+	result.push_back(std::make_shared<midikraft::Matrix1000>());
+	result.push_back(std::make_shared<midikraft::KorgDW8000>());
+	result.push_back(std::make_shared<midikraft::KawaiK3>());
+	result.push_back(std::make_shared<midikraft::OB6>());
+	result.push_back(std::make_shared<midikraft::Rev2>());
+	result.push_back(std::make_shared<midikraft::MKS50>());
+	result.push_back(std::make_shared<midikraft::MKS80>());
+	result.push_back(std::make_shared<midikraft::Virus>());
+	result.push_back(std::make_shared<midikraft::RefaceDX>());
+	return result;
+}
+
+std::vector<std::shared_ptr<midikraft::Synth>> HeadlessBenchmark::allSynths()
+{
+	auto result = builtinSynths();
+	if (knobkraft::GenericAdaptation::hasPython()) {
+		for (auto const &adaptation : knobkraft::GenericAdaptation::allAdaptations()) {
+			result.push_back(adaptation);
+		}
+	}
+	return result;
+}
+
+void HeadlessBenchmark::measure(std::string const &name, size_t items, size_t bytes, std::function<void()> const &work)
+{
+	auto start = std::chrono::steady_clock::now();
+	work();
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	measurements_.push_back({ name, items, bytes, seconds });
+	spdlog::info("Benchmark {}: {:.3f} s for {} items", name, seconds, items);
+}
+
+bool HeadlessBenchmark::run(File const &resultFile)
+{
+	TemporaryFile databaseFile(".db3");
+	midikraft::PatchDatabase database(databaseFile.getFile().getFullPathName().toStdString(), midikraft::PatchDatabase::OpenMode::READ_WRITE);
+	auto detector = database.getCategorizer();
+
+	// Import: every fixture through the synths recognizing it
+	Array<File> fixtures;
+	fixtures_.findChildFiles(fixtures, File::findFiles, true, "*.syx");
+	std::vector<midikraft::PatchHolder> allPatches;
+	for (auto const &fixture : fixtures) {
+		std::vector<MidiMessage> messages;
+		size_t bytes = (size_t) fixture.getSize();
+		measure("sysex_file/" + fixture.getFileName().toStdString(), 1, bytes, [&]() {
+			messages = Sysex::loadSysex(fixture.getFullPathName().toStdString());
+		});
+		for (auto const &synth : synths_) {
+			midikraft::TPatchVector loaded;
+			auto start = std::chrono::steady_clock::now();
+			try {
+				loaded = synth->loadSysex(messages);
+			}
+			catch (std::exception &e) {
+				spdlog::warn("Synth {} failed to load {}: {}", synth->getName(), fixture.getFileName(), e.what());
+				continue;
+			}
+			if (loaded.empty()) {
+				// Not a fixture of this synth
+				continue;
+			}
+			double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			measurements_.push_back({ "load_sysex/" + synth->getName() + "/" + fixture.getFileName().toStdString(), loaded.size(), bytes, seconds });
+			int place = 0;
+			for (auto const &dataFile : loaded) {
+				auto source = std::make_shared<midikraft::FromFileSource>(fixture.getFileName().toStdString(), fixture.getFullPathName().toStdString(), MidiProgramNumber::fromZeroBase(place++));
+				allPatches.emplace_back(synth, source, dataFile, detector);
+			}
+		}
+	}
+	if (allPatches.empty()) {
+		spdlog::error("No fixture in {} was recognized by any synth, nothing to measure", fixtures_.getFullPathName());
+		return false;
+	}
+
+	// Codecs: the 7 bit packing of the DSI synths and the nibbles of the Matrix 1000, over all patch data
+	size_t patchBytes = 0;
+	for (auto const &patch : allPatches) {
+		patchBytes += patch.patch()->data().size();
+	}
+	std::vector<uint8_t> packed;
+	std::vector<uint8_t> unpacked;
+	measure("codec/msb_first_round_trip", allPatches.size() * kCodecRounds, patchBytes * kCodecRounds, [&]() {
+		for (int round = 0; round < kCodecRounds; round++) {
+			for (auto const &patch : allPatches) {
+				auto const &data = patch.patch()->data();
+				packed.resize(midikraft::SysexCodecs::msbFirstPackedSize(data.size()));
+				auto packedSize = midikraft::SysexCodecs::packMsbFirst(data.data(), data.size(), packed.data());
+				unpacked.resize(midikraft::SysexCodecs::msbFirstUnpackedSize(packedSize));
+				midikraft::SysexCodecs::unpackMsbFirst(packed.data(), packedSize, unpacked.data());
+			}
+		}
+	});
+	measure("codec/nibbles_round_trip", allPatches.size() * kCodecRounds, patchBytes * kCodecRounds, [&]() {
+		for (int round = 0; round < kCodecRounds; round++) {
+			for (auto const &patch : allPatches) {
+				auto const &data = patch.patch()->data();
+				packed.resize(midikraft::SysexCodecs::nibblesPackedSize(data.size()));
+				auto packedSize = midikraft::SysexCodecs::packNibbles(data.data(), data.size(), packed.data());
+				unpacked.resize(midikraft::SysexCodecs::nibblesUnpackedSize(packedSize));
+				midikraft::SysexCodecs::unpackNibbles(packed.data(), packedSize, unpacked.data());
+			}
+		}
+	});
+
+	// Database: merging into the empty database, then the filter queries of the library view
+	measure("database/prepare_merge", allPatches.size(), patchBytes, [&]() {
+		PatchMergePreparation::prepare(allPatches, nullptr, [](double) { return true; });
+	});
+	size_t merged = 0;
+	measure("database/merge", allPatches.size(), patchBytes, [&]() {
+		std::vector<midikraft::PatchHolder> outNewPatches;
+		merged = (size_t) database.mergePatchesIntoDatabase(allPatches, outNewPatches, nullptr, midikraft::PatchDatabase::UPDATE_NAME | midikraft::PatchDatabase::UPDATE_CATEGORIES | midikraft::PatchDatabase::UPDATE_FAVORITE);
+	});
+	midikraft::PatchFilter allFilter(synths_);
+	measure("database/count", kQueryRounds, 0, [&]() {
+		for (int round = 0; round < kQueryRounds; round++) {
+			database.getPatchesCount(allFilter);
+		}
+	});
+	std::vector<midikraft::PatchHolder> stored;
+	measure("database/load_all", merged * kQueryRounds, 0, [&]() {
+		for (int round = 0; round < kQueryRounds; round++) {
+			stored = database.getPatches(allFilter, 0, -1);
+		}
+	});
+	measure("database/first_pages", kQueryRounds * synths_.size(), 0, [&]() {
+		for (int round = 0; round < kQueryRounds; round++) {
+			for (auto const &synth : synths_) {
+				midikraft::PatchFilter synthFilter({ synth });
+				database.getPatches(synthFilter, 0, 100);
+			}
+		}
+	});
+
+	// Text rendering as used by the patch text box, the diff dialog and the search index
+	measure("text/parameters", stored.size(), 0, [&]() {
+		fmt::memory_buffer buffer;
+		for (auto const &patch : stored) {
+			auto realPatch = std::dynamic_pointer_cast<midikraft::Patch>(patch.patch());
+			if (realPatch) {
+				buffer.clear();
+				PatchTextRenderer::appendParameters(buffer, realPatch, false);
+			}
+		}
+	});
+	measure("text/hex_dump", stored.size(), patchBytes, [&]() {
+		for (auto const &patch : stored) {
+			PatchTextRenderer::hexDump(patch.patch()->data());
+		}
+	});
+
+	// Scripted queries, a single patch predicate and the vectorized form
+	if (knobkraft::GenericAdaptation::hasPython()) {
+		ScriptedQuery query;
+		measure("scripted_query/single", stored.size(), 0, [&]() {
+			query.filterByPredicate("p is not None", stored);
+		});
+		measure("scripted_query/vectorized", stored.size(), 0, [&]() {
+			query.filterByPredicate("[p is not None for p in patches]", stored);
+		});
+	}
+
+	nlohmann::json result = nlohmann::json::array();
+	for (auto const &measurement : measurements_) {
+		result.push_back({
+			{ "name", measurement.name },
+			{ "items", measurement.items },
+			{ "bytes", measurement.bytes },
+			{ "seconds", measurement.seconds },
+			{ "items_per_second", measurement.seconds > 0.0 ? measurement.items / measurement.seconds : 0.0 }
+		});
+	}
+	if (!resultFile.replaceWithText(nlohmann::json({ { "benchmarks", result } }).dump(2))) {
+		spdlog::error("Could not write benchmark result to {}", resultFile.getFullPathName());
+		return false;
+	}
+	spdlog::info("Wrote {} measurements to {}", measurements_.size(), resultFile.getFullPathName());
+	return true;
+}
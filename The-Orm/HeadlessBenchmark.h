@@ -0,0 +1,47 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include "Synth.h"
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Times the import, search and codec hot paths without any UI, started with
+//     KnobKraftOrm --benchmark <directory with .syx fixtures> <result.json>
+// Every sysex fixture is loaded by all synths that recognize it, the patches found are merged into a temporary database, queried,
+// rendered as text, and filtered with a scripted query. The result file has one entry per measurement, so runs can be compared by numbers
+class HeadlessBenchmark {
+public:
+	HeadlessBenchmark(std::vector<std::shared_ptr<midikraft::Synth>> synths, File fixtures);
+
+	// Returns false if nothing could be measured or the result could not be written
+	bool run(File const &resultFile);
+
+	// The synths built into the Orm and all adaptations
+	static std::vector<std::shared_ptr<midikraft::Synth>> allSynths();
+	// Only the synths implemented in C++, no Python needed for these
+	static std::vector<std::shared_ptr<midikraft::Synth>> builtinSynths();
+
+private:
+	struct Measurement {
+		std::string name;
+		size_t items;
+		size_t bytes;
+		double seconds;
+	};
+
+	void measure(std::string const &name, size_t items, size_t bytes, std::function<void()> const &work);
+
+	std::vector<std::shared_ptr<midikraft::Synth>> synths_;
+	File fixtures_;
+	std::vector<Measurement> measurements_;
+};
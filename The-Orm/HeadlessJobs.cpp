@@ -0,0 +1,457 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "HeadlessJobs.h"
+
+#include "HeadlessBenchmark.h"
+#include "DatabaseBackup.h"
+#include "NetworkMidi.h"
+#include "ParallelFor.h"
+#include "PatchMergePreparation.h"
+#include "PatchInterchangeReader.h"
+#include "PatchInterchangeWriter.h"
+#include "Sysex.h"
+
+#include "GenericAdaptation.h"
+#include "LazyGenericAdaptation.h"
+
+#include <spdlog/spdlog.h>
+#include "SpdLogJuce.h"
+
+#include <fmt/format.h>
+#include <iostream>
+
+namespace {
+
+	// Parsed files are merged in batches, so a directory of any size never needs to be in memory at once
+	constexpr size_t kFilesPerBatch = 64;
+	constexpr size_t kPatchesPerChunk = 500;
+	constexpr int kPatchesPerPage = 500;
+
+	const StringArray kJobs{ "--import", "--export", "--reindex", "--sync", "--midi-server" };
+
+	std::string patchKey(midikraft::PatchHolder const &patch)
+	{
+		return (patch.synth() ? patch.synth()->getName() : "") + ":" + patch.md5();
+	}
+
+	// What the user can change about a patch, a patch with the same md5 and metadata needs no transfer
+	std::string metadataOf(midikraft::PatchHolder const &patch)
+	{
+		std::string result = patch.name() + (patch.isFavorite() ? "|F" : "|") + (patch.isHidden() ? "H|" : "|");
+		for (auto const &category : patch.categories()) {
+			result += category.category() + ",";
+		}
+		return result;
+	}
+
+}
+
+bool HeadlessJobs::isJob(StringArray const &arguments)
+{
+	for (auto const &job : kJobs) {
+		if (arguments.contains(job)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+int HeadlessJobs::run(StringArray const &arguments)
+{
+	String job;
+	int index = -1;
+	for (auto const &candidate : kJobs) {
+		index = arguments.indexOf(candidate);
+		if (index >= 0) {
+			job = candidate;
+			break;
+		}
+	}
+	StringArray parameters;
+	for (int i = index + 1; i < arguments.size(); i++) {
+		parameters.add(arguments[i].unquoted());
+	}
+	if (job == "--midi-server") {
+		if (parameters.size() < 2) {
+			print("Usage: KnobKraftOrm --midi-server <tcp port> <midi output> [<midi input>]");
+			return 2;
+		}
+		return NetworkMidi::serve(parameters[0].getIntValue(), parameters[1], parameters[2], print);
+	}
+	int needed = job == "--reindex" ? 2 : 3;
+	if (parameters.size() < needed) {
+		print("Usage: KnobKraftOrm --import <database> <synths> <files or directories>... | --export <database> <synths> <result.json> | --reindex <database> <synths>"
+			" | --sync <database> <synths> <source database> | --midi-server <tcp port> <midi output> [<midi input>]");
+		return 2;
+	}
+
+	TSynthMap synths;
+	if (!selectSynths(parameters[1], synths)) {
+		return 2;
+	}
+	File databaseFile(File::getCurrentWorkingDirectory().getChildFile(parameters[0]));
+	if (job != "--import" && job != "--sync" && !databaseFile.existsAsFile()) {
+		print(fmt::format("Database {} does not exist", databaseFile.getFullPathName().toStdString()));
+		return 1;
+	}
+	auto database = openDatabase(databaseFile);
+	if (!database) {
+		return 1;
+	}
+
+	if (job == "--import") {
+		Array<File> inputs;
+		for (int i = 2; i < parameters.size(); i++) {
+			inputs.add(File::getCurrentWorkingDirectory().getChildFile(parameters[i]));
+		}
+		return importFiles(*database, synths, inputs);
+	}
+	else if (job == "--export") {
+		return exportPatches(*database, synths, File::getCurrentWorkingDirectory().getChildFile(parameters[2]));
+	}
+	else if (job == "--sync") {
+		return sync(*database, synths, parameters[1].trim().equalsIgnoreCase("all"), File::getCurrentWorkingDirectory().getChildFile(parameters[2]));
+	}
+	return reindex(*database, synths);
+}
+
+bool HeadlessJobs::selectSynths(String const &names, TSynthMap &outSynths)
+{
+	bool all = names.trim().equalsIgnoreCase("all");
+	StringArray wanted;
+	wanted.addTokens(names, ",", "\"");
+	wanted.trim();
+	wanted.removeEmptyStrings();
+
+	auto select = [&](std::string const &name) {
+		return outSynths.find(name) == outSynths.end() && (all || wanted.contains(String(name)));
+	};
+	for (auto const &synth : HeadlessBenchmark::builtinSynths()) {
+		if (select(synth->getName())) {
+			outSynths[synth->getName()] = synth;
+		}
+	}
+	if (knobkraft::GenericAdaptation::hasPython()) {
+		// Only the adaptations asked for are imported, the others are known from the manifest by name
+		for (auto const &device : knobkraft::LazyGenericAdaptation::allAdaptations()) {
+			auto name = device->getName();
+			if (!select(name)) {
+				continue;
+			}
+			std::shared_ptr<midikraft::Synth> synth;
+			auto lazy = std::dynamic_pointer_cast<knobkraft::LazyGenericAdaptation>(device);
+			if (lazy) {
+				synth = lazy->load();
+			}
+			else {
+				synth = std::dynamic_pointer_cast<midikraft::Synth>(device);
+			}
+			if (synth) {
+				outSynths[name] = synth;
+			}
+			else {
+				print(fmt::format("Adaptation for {} failed to load", name));
+			}
+		}
+	}
+
+	bool ok = !outSynths.empty();
+	for (auto const &name : wanted) {
+		if (!all && outSynths.find(name.toStdString()) == outSynths.end()) {
+			print(fmt::format("Unknown synth {}", name.toStdString()));
+			ok = false;
+		}
+	}
+	if (outSynths.empty()) {
+		print("No synth selected");
+	}
+	return ok;
+}
+
+std::unique_ptr<midikraft::PatchDatabase> HeadlessJobs::openDatabase(File const &file)
+{
+	try {
+		return std::make_unique<midikraft::PatchDatabase>(file.getFullPathName().toStdString(), midikraft::PatchDatabase::OpenMode::READ_WRITE);
+	}
+	catch (midikraft::PatchDatabaseException &e) {
+		print(fmt::format("Can't open database {}: {}", file.getFullPathName().toStdString(), e.what()));
+		return nullptr;
+	}
+}
+
+midikraft::PatchFilter HeadlessJobs::allPatches(TSynthMap const &synths)
+{
+	std::vector<std::shared_ptr<midikraft::Synth>> selected;
+	for (auto const &synth : synths) {
+		selected.push_back(synth.second);
+	}
+	midikraft::PatchFilter filter(selected);
+	filter.turnOnAll();
+	filter.importID = "";
+	filter.listID = "";
+	return filter;
+}
+
+int HeadlessJobs::importFiles(midikraft::PatchDatabase &database, TSynthMap const &synths, Array<File> const &inputs)
+{
+	Array<File> files;
+	for (auto const &input : inputs) {
+		if (input.isDirectory()) {
+			input.findChildFiles(files, File::findFiles, true, "*.syx;*.json");
+		}
+		else if (input.existsAsFile()) {
+			files.add(input);
+		}
+		else {
+			print(fmt::format("Input {} does not exist", input.getFullPathName().toStdString()));
+			return 1;
+		}
+	}
+
+	auto detector = database.getCategorizer();
+	// A folder can hold files of many synths, each message goes only to the synths that might own it
+	std::vector<std::shared_ptr<midikraft::Synth>> selected;
+	for (auto const &synth : synths) {
+		selected.push_back(synth.second);
+	}
+	SynthSniffer sniffer(selected);
+	size_t newPatches = 0;
+	size_t filesWithoutPatches = 0;
+	for (size_t start = 0; start < (size_t) files.size(); start += kFilesPerBatch) {
+		size_t count = std::min(kFilesPerBatch, (size_t) files.size() - start);
+		std::vector<std::vector<midikraft::PatchHolder>> parsed(count);
+		parallelFor(count, [&](size_t i) {
+			parsed[i] = parseFile(files[(int) (start + i)], synths, sniffer, detector);
+		}, [](double) { return true; });
+
+		// Only this thread writes to the database
+		std::vector<midikraft::PatchHolder> batch;
+		for (size_t i = 0; i < count; i++) {
+			if (parsed[i].empty()) {
+				filesWithoutPatches++;
+			}
+			std::move(parsed[i].begin(), parsed[i].end(), std::back_inserter(batch));
+		}
+		if (!batch.empty()) {
+			PatchMergePreparation::prepare(batch, nullptr, [](double) { return true; });
+			try {
+				std::vector<midikraft::PatchHolder> outNewPatches;
+				newPatches += (size_t) PatchMergePreparation::mergeWithoutDuplicates(database, batch, outNewPatches, nullptr, midikraft::PatchDatabase::UPDATE_NAME | midikraft::PatchDatabase::UPDATE_CATEGORIES | midikraft::PatchDatabase::UPDATE_FAVORITE);
+			}
+			catch (std::exception &e) {
+				print(fmt::format("Failed to store patches: {}", e.what()));
+				return 1;
+			}
+		}
+		print(fmt::format("Import: {} of {} files, {} new patches", start + count, files.size(), newPatches));
+	}
+	print(fmt::format("Imported {} new patches from {} files, {} files contained no patches of the synths selected", newPatches, files.size(), filesWithoutPatches));
+	return 0;
+}
+
+std::vector<midikraft::PatchHolder> HeadlessJobs::parseFile(File const &file, TSynthMap const &synths, SynthSniffer const &sniffer, std::shared_ptr<midikraft::AutomaticCategory> detector)
+{
+	std::vector<midikraft::PatchHolder> result;
+	if (file.hasFileExtension(".json")) {
+		std::string error;
+		if (!PatchInterchangeReader::load(synths, file, detector, kPatchesPerChunk, [&result](std::vector<midikraft::PatchHolder> &patches) {
+			std::move(patches.begin(), patches.end(), std::back_inserter(result));
+			return true;
+		}, error)) {
+			print(fmt::format("Failed to load patch archive {}: {}", file.getFullPathName().toStdString(), error));
+		}
+		return result;
+	}
+
+	std::vector<MidiMessage> messages;
+	try {
+		messages = Sysex::loadSysex(file.getFullPathName().toStdString());
+	}
+	catch (std::exception &e) {
+		print(fmt::format("Failed to read {}: {}", file.getFullPathName().toStdString(), e.what()));
+		return result;
+	}
+	for (auto const &candidate : sniffer.partition(messages)) {
+		auto synth = synths.at(candidate.first);
+		midikraft::TPatchVector loaded;
+		try {
+			loaded = synth->loadSysex(candidate.second);
+		}
+		catch (std::exception &e) {
+			spdlog::warn("Synth {} failed to load {}: {}", candidate.first, file.getFileName(), e.what());
+			continue;
+		}
+		int place = 0;
+		for (auto const &dataFile : loaded) {
+			auto source = std::make_shared<midikraft::FromFileSource>(file.getFileName().toStdString(), file.getFullPathName().toStdString(), MidiProgramNumber::fromZeroBase(place++));
+			result.emplace_back(synth, source, dataFile, detector);
+		}
+	}
+	return result;
+}
+
+int HeadlessJobs::exportPatches(midikraft::PatchDatabase &database, TSynthMap const &synths, File const &output)
+{
+	auto filter = allPatches(synths);
+	int total = database.getPatchesCount(filter);
+	PatchInterchangeWriter writer(output);
+	for (int skip = 0; skip < total; skip += kPatchesPerPage) {
+		auto page = database.getPatches(filter, skip, kPatchesPerPage);
+		if (page.empty()) {
+			break;
+		}
+		if (!writer.append(page)) {
+			print(fmt::format("Failed to write {}", output.getFullPathName().toStdString()));
+			return 1;
+		}
+		print(fmt::format("Export: {} of {} patches", std::min(total, skip + kPatchesPerPage), total));
+	}
+	if (!writer.finish()) {
+		print(fmt::format("Failed to write {}", output.getFullPathName().toStdString()));
+		return 1;
+	}
+	print(fmt::format("Exported {} patches to {}", writer.patchesWritten(), output.getFullPathName().toStdString()));
+	return 0;
+}
+
+int HeadlessJobs::reindex(midikraft::PatchDatabase &database, TSynthMap const &synths)
+{
+	File databaseFile(database.getCurrentDatabaseFileName());
+	File backupFile = DatabaseBackup::backupFileFor(databaseFile, "-before-reindexing");
+	std::string error;
+	if (!DatabaseBackup::copy(databaseFile, backupFile, progressPrinter("Backup"), error)) {
+		print(fmt::format("Not reindexing, could not create a backup of the database: {}", error));
+		return 1;
+	}
+	print(fmt::format("Created database backup at {}", backupFile.getFullPathName().toStdString()));
+	for (auto const &synth : synths) {
+		midikraft::PatchFilter filter = allPatches({ synth });
+		int before = database.getPatchesCount(filter);
+		int after = database.reindexPatches(filter);
+		if (after == -1) {
+			print(fmt::format("Reindexing {} failed, the backup is at {}", synth.first, backupFile.getFullPathName().toStdString()));
+			return 1;
+		}
+		print(fmt::format("Reindexed {}: {} patches before, {} after", synth.first, before, after));
+	}
+	return 0;
+}
+
+int HeadlessJobs::sync(midikraft::PatchDatabase &database, TSynthMap const &synths, bool allSynths, File const &sourceFile)
+{
+	if (!sourceFile.existsAsFile()) {
+		print(fmt::format("Source database {} does not exist", sourceFile.getFullPathName().toStdString()));
+		return 1;
+	}
+	std::unique_ptr<midikraft::PatchDatabase> source;
+	File migrated = File::createTempFile("db3");
+	try {
+		try {
+			source = std::make_unique<midikraft::PatchDatabase>(sourceFile.getFullPathName().toStdString(), midikraft::PatchDatabase::OpenMode::READ_ONLY);
+		}
+		catch (midikraft::PatchDatabaseReadonlyException &e) {
+			ignoreUnused(e);
+			// An older database needs its migration first, which we must not do to the source, so work on a copy
+			midikraft::PatchDatabase::makeDatabaseBackup(sourceFile, migrated);
+			source = std::make_unique<midikraft::PatchDatabase>(migrated.getFullPathName().toStdString(), midikraft::PatchDatabase::OpenMode::READ_WRITE_NO_BACKUPS);
+		}
+	}
+	catch (midikraft::PatchDatabaseException &e) {
+		print(fmt::format("Can't open source database {}: {}", sourceFile.getFullPathName().toStdString(), e.what()));
+		migrated.deleteFile();
+		return 1;
+	}
+
+	// What the database has already, the source only needs to send the difference
+	auto filter = allPatches(synths);
+	std::map<std::string, std::string> known;
+	int existing = database.getPatchesCount(filter);
+	for (int skip = 0; skip < existing; skip += kPatchesPerPage) {
+		auto page = database.getPatches(filter, skip, kPatchesPerPage);
+		if (page.empty()) {
+			break;
+		}
+		for (auto const &patch : page) {
+			known[patchKey(patch)] = metadataOf(patch);
+		}
+	}
+
+	int total = source->getPatchesCount(filter);
+	size_t transferred = 0;
+	size_t newPatches = 0;
+	for (int skip = 0; skip < total; skip += kPatchesPerPage) {
+		auto page = source->getPatches(filter, skip, kPatchesPerPage);
+		if (page.empty()) {
+			break;
+		}
+		std::vector<midikraft::PatchHolder> delta;
+		std::copy_if(page.begin(), page.end(), std::back_inserter(delta), [&known](midikraft::PatchHolder const &patch) {
+			auto found = known.find(patchKey(patch));
+			return found == known.end() || found->second != metadataOf(patch);
+		});
+		if (!delta.empty()) {
+			PatchMergePreparation::prepare(delta, nullptr, [](double) { return true; });
+			try {
+				std::vector<midikraft::PatchHolder> outNewPatches;
+				// Everything metadataOf() compares goes over, else a patch only hidden in the source would be transferred on every sync
+				newPatches += (size_t) database.mergePatchesIntoDatabase(delta, outNewPatches, nullptr, midikraft::PatchDatabase::UPDATE_NAME | midikraft::PatchDatabase::UPDATE_CATEGORIES | midikraft::PatchDatabase::UPDATE_FAVORITE | midikraft::PatchDatabase::UPDATE_HIDDEN);
+			}
+			catch (std::exception &e) {
+				print(fmt::format("Failed to store patches: {}", e.what()));
+				migrated.deleteFile();
+				return 1;
+			}
+			transferred += delta.size();
+		}
+		print(fmt::format("Sync: {} of {} patches compared, {} transferred", std::min(total, skip + kPatchesPerPage), total, transferred));
+	}
+
+	// A list loaded with only some synths would lack the patches of the others, so lists are only synced with all synths.
+	// Lists the database has already are left alone, they might have been edited here
+	size_t lists = 0;
+	if (allSynths) {
+		std::map<std::string, std::weak_ptr<midikraft::Synth>> weakSynths;
+		for (auto const &synth : synths) {
+			weakSynths[synth.first] = synth.second;
+		}
+		for (auto const &list : source->allPatchLists()) {
+			if (database.doesListExist(list.id)) {
+				continue;
+			}
+			auto loaded = source->getPatchList(list, weakSynths);
+			if (loaded) {
+				database.putPatchList(loaded);
+				lists++;
+			}
+		}
+	}
+	source.reset();
+	migrated.deleteFile();
+	print(fmt::format("Synced from {}: {} patches transferred, {} of them new, {} lists added", sourceFile.getFullPathName().toStdString(), transferred, newPatches, lists));
+	return 0;
+}
+
+std::function<bool(double)> HeadlessJobs::progressPrinter(std::string const &what)
+{
+	auto lastPercent = std::make_shared<int>(-1);
+	return [what, lastPercent](double progress) {
+		int percent = (int) (progress * 100.0);
+		if (percent / 10 != *lastPercent / 10) {
+			*lastPercent = percent;
+			print(fmt::format("{}: {}%", what, percent));
+		}
+		return true;
+	};
+}
+
+void HeadlessJobs::print(std::string const &line)
+{
+	// Several parser threads might report at the same time
+	static CriticalSection lock;
+	ScopedLock scoped(lock);
+	std::cout << line << std::endl;
+}
@@ -0,0 +1,54 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include "Synth.h"
+#include "PatchDatabase.h"
+#include "SynthSniffer.h"
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+// The bulk operations of the library without any UI, for running unattended on a server:
+//     KnobKraftOrm --import <database> <synths> <.syx/.json files or directories>...
+//     KnobKraftOrm --export <database> <synths> <result.json>
+//     KnobKraftOrm --reindex <database> <synths>
+//     KnobKraftOrm --sync <database> <synths> <source database>
+//     KnobKraftOrm --midi-server <tcp port> <midi output> [<midi input>]
+// <synths> is a comma separated list of synth names, or "all". Only the adaptations of these synths are imported into Python.
+// The MIDI server needs neither database nor synths, it makes the given ports available to NetworkMidi clients.
+// Files are parsed on all cores while the main thread is the only one writing to the database, progress goes to stdout
+class HeadlessJobs {
+public:
+	static bool isJob(StringArray const &arguments);
+	// Returns the exit code of the process
+	static int run(StringArray const &arguments);
+
+private:
+	typedef std::map<std::string, std::shared_ptr<midikraft::Synth>> TSynthMap;
+
+	static bool selectSynths(String const &names, TSynthMap &outSynths);
+	static std::unique_ptr<midikraft::PatchDatabase> openDatabase(File const &file);
+	static midikraft::PatchFilter allPatches(TSynthMap const &synths);
+
+	static int importFiles(midikraft::PatchDatabase &database, TSynthMap const &synths, Array<File> const &inputs);
+	static int exportPatches(midikraft::PatchDatabase &database, TSynthMap const &synths, File const &output);
+	static int reindex(midikraft::PatchDatabase &database, TSynthMap const &synths);
+	// Brings over the patches the database doesn't have or has with other metadata, and with all synths also the lists it doesn't have.
+	// The source wins: name, categories, favorite and hidden of a patch in both are overwritten with those of the source, even where
+	// they were changed in the database since the last sync. Lists the database has already, and patches only in the database, are kept
+	static int sync(midikraft::PatchDatabase &database, TSynthMap const &synths, bool allSynths, File const &sourceFile);
+
+	static std::vector<midikraft::PatchHolder> parseFile(File const &file, TSynthMap const &synths, SynthSniffer const &sniffer, std::shared_ptr<midikraft::AutomaticCategory> detector);
+	static std::function<bool(double)> progressPrinter(std::string const &what);
+	static void print(std::string const &line);
+};
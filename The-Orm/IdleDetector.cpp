@@ -0,0 +1,34 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "IdleDetector.h"
+
+IdleDetector::IdleDetector() : lastInputMs_(Time::getMillisecondCounterHiRes())
+{
+	startTimer(1000);
+}
+
+IdleDetector::~IdleDetector()
+{
+	stopTimer();
+}
+
+bool IdleDetector::isIdle(int quietMs) const
+{
+	return Time::getMillisecondCounterHiRes() - lastInputMs_ >= quietMs;
+}
+
+void IdleDetector::timerCallback()
+{
+	auto mouse = Desktop::getInstance().getMainMouseSource();
+	auto position = mouse.getScreenPosition();
+	auto lastDown = mouse.getLastMouseDownTime();
+	if (position != lastMousePosition_ || lastDown != lastMouseDown_) {
+		lastMousePosition_ = position;
+		lastMouseDown_ = lastDown;
+		lastInputMs_ = Time::getMillisecondCounterHiRes();
+	}
+}
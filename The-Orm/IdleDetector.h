@@ -0,0 +1,29 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include <atomic>
+
+// Tells background work whether the user is doing something right now. The mouse is what is touched all the time in this
+// app, so it is sampled once a second on the message thread, and any move or click counts as activity. Create and destroy
+// on the message thread, ask from any thread.
+class IdleDetector : private Timer {
+public:
+	IdleDetector();
+	~IdleDetector() override;
+
+	bool isIdle(int quietMs) const;
+
+private:
+	void timerCallback() override;
+
+	std::atomic<double> lastInputMs_;
+	Point<float> lastMousePosition_;
+	Time lastMouseDown_;
+};
@@ -0,0 +1,176 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "JobListPanel.h"
+
+#include "LayoutConstants.h"
+
+#include <algorithm>
+
+namespace {
+
+	// Only while jobs are running, the list itself is updated by the change messages
+	constexpr int kProgressRefreshMs = 250;
+
+	String stateText(BackgroundJob::State state) {
+		switch (state) {
+		case BackgroundJob::State::Waiting: return "Waiting";
+		case BackgroundJob::State::Running: return "Running";
+		case BackgroundJob::State::Succeeded: return "Done";
+		case BackgroundJob::State::Failed: return "Failed";
+		case BackgroundJob::State::Cancelled: return "Cancelled";
+		}
+		return "";
+	}
+
+}
+
+JobListPanel::JobListPanel()
+{
+	title_.setText("Background jobs", dontSendNotification);
+	addAndMakeVisible(title_);
+
+	auto &header = table_.getHeader();
+	header.addColumn("Job", NAME, 260);
+	header.addColumn("State", STATE, 80);
+	header.addColumn("Progress", PROGRESS, 160);
+	header.addColumn("Status", STATUS, 300);
+	table_.setModel(this);
+	addAndMakeVisible(table_);
+
+	cancel_.setButtonText("Cancel job");
+	cancel_.onClick = [this]() {
+		auto job = selectedJob();
+		if (job) {
+			job->cancel();
+		}
+	};
+	addAndMakeVisible(cancel_);
+	clearFinished_.setButtonText("Clear finished");
+	clearFinished_.onClick = []() {
+		BackgroundJobs::instance().clearFinished();
+	};
+	addAndMakeVisible(clearFinished_);
+
+	BackgroundJobs::instance().addChangeListener(this);
+	refresh();
+}
+
+JobListPanel::~JobListPanel()
+{
+	stopTimer();
+	BackgroundJobs::instance().removeChangeListener(this);
+}
+
+void JobListPanel::resized()
+{
+	auto area = getLocalBounds().reduced(LAYOUT_INSET_NORMAL);
+	title_.setBounds(area.removeFromTop(24));
+	auto buttonRow = area.removeFromBottom(LAYOUT_LINE_SPACING);
+	cancel_.setBounds(buttonRow.removeFromLeft(LAYOUT_BUTTON_WIDTH).reduced(LAYOUT_INSET_SMALL));
+	clearFinished_.setBounds(buttonRow.removeFromLeft(LAYOUT_BUTTON_WIDTH).reduced(LAYOUT_INSET_SMALL));
+	table_.setBounds(area);
+}
+
+int JobListPanel::getNumRows()
+{
+	return (int) jobs_.size();
+}
+
+void JobListPanel::paintRowBackground(Graphics &g, int rowNumber, int width, int height, bool rowIsSelected)
+{
+	ignoreUnused(width, height);
+	auto &lookAndFeel = LookAndFeel::getDefaultLookAndFeel();
+	if (rowIsSelected) {
+		g.fillAll(lookAndFeel.findColour(TextEditor::highlightColourId));
+	}
+	else if (rowNumber % 2) {
+		g.fillAll(lookAndFeel.findColour(ListBox::backgroundColourId).interpolatedWith(lookAndFeel.findColour(ListBox::textColourId), 0.03f));
+	}
+}
+
+void JobListPanel::paintCell(Graphics &g, int rowNumber, int columnId, int width, int height, bool rowIsSelected)
+{
+	ignoreUnused(rowIsSelected);
+	if (rowNumber < 0 || rowNumber >= (int) jobs_.size()) return;
+	auto const &job = jobs_[(size_t) rowNumber];
+	auto &lookAndFeel = LookAndFeel::getDefaultLookAndFeel();
+	if (columnId == PROGRESS) {
+		auto state = job->state();
+		if (state == BackgroundJob::State::Running || state == BackgroundJob::State::Succeeded) {
+			auto bar = Rectangle<int>(0, 0, width, height).reduced(2, 4).toFloat();
+			g.setColour(lookAndFeel.findColour(ListBox::textColourId).withAlpha(0.2f));
+			g.drawRect(bar);
+			g.setColour(lookAndFeel.findColour(TextEditor::highlightColourId).brighter());
+			double progress = state == BackgroundJob::State::Succeeded ? 1.0 : jlimit(0.0, 1.0, job->progress());
+			g.fillRect(bar.withWidth(bar.getWidth() * (float) progress).reduced(1.0f));
+		}
+		return;
+	}
+	String text;
+	switch (columnId) {
+	case NAME: text = job->name(); break;
+	case STATE: text = stateText(job->state()); break;
+	case STATUS: text = job->status(); break;
+	default: break;
+	}
+	g.setColour(lookAndFeel.findColour(ListBox::textColourId));
+	g.drawText(text, 2, 0, width - 4, height, Justification::centredLeft, true);
+}
+
+void JobListPanel::selectedRowsChanged(int lastRowSelected)
+{
+	ignoreUnused(lastRowSelected);
+	auto job = selectedJob();
+	cancel_.setEnabled(job && !job->isDone());
+}
+
+void JobListPanel::changeListenerCallback(ChangeBroadcaster *source)
+{
+	ignoreUnused(source);
+	refresh();
+}
+
+void JobListPanel::timerCallback()
+{
+	if (isShowing()) {
+		table_.repaint();
+	}
+}
+
+void JobListPanel::refresh()
+{
+	auto selected = selectedJob();
+	jobs_ = BackgroundJobs::instance().jobs();
+	table_.updateContent();
+	// Keep the selection on the same job, its row moves when others are added or done
+	auto found = std::find(jobs_.begin(), jobs_.end(), selected);
+	if (selected && found != jobs_.end()) {
+		table_.selectRow((int) (found - jobs_.begin()), true, true);
+	}
+	else {
+		table_.deselectAllRows();
+	}
+	selectedRowsChanged(table_.getSelectedRow());
+	table_.repaint();
+
+	bool running = std::any_of(jobs_.begin(), jobs_.end(), [](std::shared_ptr<BackgroundJob> const &job) { return !job->isDone(); });
+	if (running && !isTimerRunning()) {
+		startTimer(kProgressRefreshMs);
+	}
+	else if (!running) {
+		stopTimer();
+	}
+}
+
+std::shared_ptr<BackgroundJob> JobListPanel::selectedJob() const
+{
+	int row = table_.getSelectedRow();
+	if (row >= 0 && row < (int) jobs_.size()) {
+		return jobs_[(size_t) row];
+	}
+	return {};
+}
@@ -0,0 +1,49 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include "BackgroundJobs.h"
+
+#include <memory>
+#include <vector>
+
+// The list of the waiting, running and recently finished background jobs, with their progress. Jobs can be cancelled
+// from here while the rest of the program stays usable
+class JobListPanel : public Component, private TableListBoxModel, private ChangeListener, private Timer {
+public:
+	JobListPanel();
+	~JobListPanel() override;
+
+	void resized() override;
+
+private:
+	enum Columns {
+		NAME = 1,
+		STATE,
+		PROGRESS,
+		STATUS
+	};
+
+	int getNumRows() override;
+	void paintRowBackground(Graphics &g, int rowNumber, int width, int height, bool rowIsSelected) override;
+	void paintCell(Graphics &g, int rowNumber, int columnId, int width, int height, bool rowIsSelected) override;
+	void selectedRowsChanged(int lastRowSelected) override;
+	void changeListenerCallback(ChangeBroadcaster *source) override;
+	void timerCallback() override;
+
+	void refresh();
+	std::shared_ptr<BackgroundJob> selectedJob() const;
+
+	std::vector<std::shared_ptr<BackgroundJob>> jobs_;
+
+	Label title_;
+	TableListBox table_;
+	TextButton cancel_;
+	TextButton clearFinished_;
+};
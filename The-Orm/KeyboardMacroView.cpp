@@ -9,13 +9,17 @@
 #include "MasterkeyboardCapability.h"
 
 #include "Logger.h"
+#include "Setlist.h"
 #include "Settings.h"
+#include "Tracer.h"
 #include "UIModel.h"
 
 #include <nlohmann/json.hpp>
 #include <spdlog/spdlog.h>
 #include "SpdLogJuce.h"
 
+#include <atomic>
+
 // Standardize text
 const char *kMacrosEnabled = "Macros enabled";
 const char *kAutomaticSetup = "Use current synth as master";
@@ -40,8 +44,9 @@ public:
 
 	virtual void run() override {
 		state_.addListener(this);
+		// Woken up by the last note off, or by stopThread() when cancelled
 		while (!threadShouldExit() && !done_) {
-			Thread::sleep(10);
+			wait(-1);
 		}
 	}
 
@@ -61,6 +66,7 @@ public:
 		}
 		if (keyPressed == 0) {
 			done_ = true;
+			notify();
 		}
 	}
 
@@ -70,7 +76,7 @@ private:
 	std::set<int> notes_;
 	MidiKeyboardState &state_;
 	bool atLeastOneKey_;
-	bool done_;
+	std::atomic<bool> done_;
 
 };
 
@@ -88,6 +94,7 @@ KeyboardMacroView::KeyboardMacroView(std::function<void(KeyboardMacroEvent)> cal
 			if (recorder.runThread()) {
 				KeyboardMacro newMacro = { event, recorder.notesSelected() };
 				macros_[event] = newMacro;
+				compileMacros();
 				saveSettings();
 				refreshUI();
 			}
@@ -110,9 +117,19 @@ KeyboardMacroView::KeyboardMacroView(std::function<void(KeyboardMacroEvent)> cal
 		UIModel::instance()->currentSynth_.addChangeListener(this);
 	}
 
+	state_.addListener(this);
+
+	// The MIDI handler below reads the setlist, so it has to exist before
+	Setlist::instance();
+
 	// Install keyboard handler to refresh midi keyboard display
 	midikraft::MidiController::instance()->addMessageHandler(handle_, [this](MidiInput *source, MidiMessage const &message) {
+		TraceScope trace("Keyboard MIDI", "midi");
 		if (source && source->getName().toStdString() == customMasterkeyboardSetup_.typedNamedValueByName(kInputDevice)->lookupValue()) {
+			if (message.isProgramChange() && Setlist::instance().selectPosition(message.getProgramChangeNumber())) {
+				// The armed setlist plays the position, the program change must not reach the synth
+				return;
+			}
 			int forwardMode = customMasterkeyboardSetup_.valueByName(kRouteMasterkeyboard).getValue();
 			if (forwardMode == 2 || forwardMode == 3 || forwardMode == 4) {
 				std::shared_ptr<midikraft::Synth> toWhichSynthToForward;
@@ -154,13 +171,14 @@ KeyboardMacroView::KeyboardMacroView(std::function<void(KeyboardMacroEvent)> cal
 				state_.processNextMidiEvent(message);
 
 				// Check if this is a message we will transform into a macro
-				for (const auto& macro : macros_) {
-					if (isMacroState(macro.second)) {
-						auto code = macro.first;
-						MessageManager::callAsync([this, code]() {
-							executeMacro_(code);
-						});
+				for (auto code : macrosMatchingHeldKeys()) {
+					if ((code == KeyboardMacroEvent::NextPatch || code == KeyboardMacroEvent::PreviousPatch)
+						&& Setlist::instance().step(code == KeyboardMacroEvent::NextPatch ? 1 : -1)) {
+						continue;
 					}
+					MessageManager::callAsync([this, code]() {
+						executeMacro_(code);
+					});
 				}
 			}
 		}
@@ -169,20 +187,23 @@ KeyboardMacroView::KeyboardMacroView(std::function<void(KeyboardMacroEvent)> cal
 	// Load Macro Definitions
 	setupPropertyEditor();
 	loadFromSettings();
+	compileMacros();
+	routingMatrix_.loadFromSettings("MidiRoutingRules");
 	refreshUI();
 	setupKeyboardControl();
 }
 
 KeyboardMacroView::~KeyboardMacroView()
 {
+	MidiDeviceWatcher::instance().removeListener(this);
 	midikraft::MidiController::instance()->removeMessageHandler(handle_);
+	state_.removeListener(this);
 	saveSettings();
 }
 
 void KeyboardMacroView::setupPropertyEditor() {
-	// Midi Device Selector can broadcast a change message when a new device is detected or removed
-	midiDeviceList_ = std::make_shared<MidiDevicePropertyEditor>(kInputDevice, "Setup Masterkeyboard", true);
-	midikraft::MidiController::instance()->addChangeListener(this);
+	midiDeviceList_ = std::make_shared<InputDeviceList>(kInputDevice, "Setup Masterkeyboard", true);
+	MidiDeviceWatcher::instance().addListener(this);
 
 	customMasterkeyboardSetup_.clear();
 	customMasterkeyboardSetup_.push_back(std::make_shared<TypedNamedValue>(kMacrosEnabled, "Setup", true));
@@ -336,12 +357,8 @@ void KeyboardMacroView::turnOnMasterkeyboardInput() {
 
 void KeyboardMacroView::changeListenerCallback(ChangeBroadcaster* source)
 {
-	if (source == midikraft::MidiController::instance()) {
-		// The list of MIDI devices changed, need to refresh the property editor
-		midiDeviceList_->refreshDeviceList();
-		customSetup_.setProperties(customMasterkeyboardSetup_);
-	}
-	else if (customMasterkeyboardSetup_.valueByName(kAutomaticSetup).getValue()) {
+	ignoreUnused(source);
+	if (customMasterkeyboardSetup_.valueByName(kAutomaticSetup).getValue()) {
 		// Mode 1 - follow current synth, use that as master keyboard
 		auto currentSynth = UIModel::instance()->currentSynth_.smartSynth();
 		auto masterKeyboard = midikraft::Capability::hasCapability<midikraft::MasterkeyboardCapability>(currentSynth);
@@ -374,32 +391,71 @@ void KeyboardMacroView::changeListenerCallback(ChangeBroadcaster* source)
 	}
 }
 
-bool KeyboardMacroView::isMacroState(KeyboardMacro const &macro)
+void KeyboardMacroView::midiDevicesChanged(MidiDeviceWatcher::Changes const &changes)
+{
+	if (changes.inputsChanged()) {
+		// The masterkeyboard is one of the inputs, outputs coming or going don't matter here
+		midiDeviceList_->refreshDropdownList(changes.inputs);
+		customSetup_.setProperties(customMasterkeyboardSetup_);
+	}
+}
+
+KeyboardMacroView::TKeyMask KeyboardMacroView::keyMaskOf(std::set<int> const &midiNotes)
+{
+	TKeyMask mask;
+	for (int note : midiNotes) {
+		if (note >= 0 && note < 128) {
+			mask.set((size_t) note);
+		}
+	}
+	return mask;
+}
+
+void KeyboardMacroView::compileMacros()
+{
+	std::unordered_map<TKeyMask, std::vector<KeyboardMacroEvent>> compiled;
+	for (auto const &macro : macros_) {
+		compiled[keyMaskOf(macro.second.midiNotes)].push_back(macro.first);
+	}
+	std::lock_guard<std::mutex> lock(keysLock_);
+	macrosByKeys_ = std::move(compiled);
+}
+
+std::vector<KeyboardMacroEvent> KeyboardMacroView::macrosMatchingHeldKeys()
 {
 	// Check if macros are turned on
 	if (!customMasterkeyboardSetup_.valueByName(kMacrosEnabled).getValue()) {
 		// No - then don't do anything
-		return false;
+		return {};
 	}
 
-	// Check if the keyboard state does contain all keys of the keyboard macro
-	bool allDetected = true;
-	for (int note : macro.midiNotes) {
-		if (!state_.isNoteOnForChannels(0xffff, note)) {
-			// No, this note is missing
-			allDetected = false;
-			break;
-		}
+	// The keys held on any channel must be exactly the keys of the macro
+	std::lock_guard<std::mutex> lock(keysLock_);
+	TKeyMask held;
+	for (auto const &channel : heldKeysPerChannel_) {
+		held |= channel;
 	}
-	// Check that no extra key is pressed
-	bool extraKeyDetected = false;
-	for (int note = 0; note < 128; note++) {
-		if (state_.isNoteOnForChannels(0xffff, note)) {
-			if (macro.midiNotes.find(note) == macro.midiNotes.end()) {
-				extraKeyDetected = true;
-				break;
-			}
-		}
+	auto found = macrosByKeys_.find(held);
+	if (found != macrosByKeys_.end()) {
+		return found->second;
+	}
+	return {};
+}
+
+void KeyboardMacroView::handleNoteOn(MidiKeyboardState* source, int midiChannel, int midiNoteNumber, float velocity)
+{
+	ignoreUnused(source, velocity);
+	if (midiChannel >= 1 && midiChannel <= 16 && midiNoteNumber >= 0 && midiNoteNumber < 128) {
+		std::lock_guard<std::mutex> lock(keysLock_);
+		heldKeysPerChannel_[(size_t) midiChannel - 1].set((size_t) midiNoteNumber);
+	}
+}
+
+void KeyboardMacroView::handleNoteOff(MidiKeyboardState* source, int midiChannel, int midiNoteNumber, float velocity)
+{
+	ignoreUnused(source, velocity);
+	if (midiChannel >= 1 && midiChannel <= 16 && midiNoteNumber >= 0 && midiNoteNumber < 128) {
+		std::lock_guard<std::mutex> lock(keysLock_);
+		heldKeysPerChannel_[(size_t) midiChannel - 1].reset((size_t) midiNoteNumber);
 	}
-	return allDetected && !extraKeyDetected;
 }
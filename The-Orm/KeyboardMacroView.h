@@ -14,9 +14,17 @@
 
 #include "MidiChannelPropertyEditor.h"
 #include "ElectraOneRouter.h"
+#include "MidiRouter.h"
+#include "MidiDeviceWatcher.h"
 
+#include <array>
+#include <bitset>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
 
-class KeyboardMacroView : public Component, private ChangeListener, private Value::Listener {
+
+class KeyboardMacroView : public Component, private ChangeListener, private Value::Listener, private MidiKeyboardStateListener, private MidiDeviceWatcher::Listener {
 public:
 	KeyboardMacroView(std::function<void(KeyboardMacroEvent)> callback);
 	virtual ~KeyboardMacroView() override;
@@ -24,27 +32,46 @@ public:
 	virtual void resized() override;
 
 private:
+	// Filled from the MidiDeviceWatcher instead of listing the devices again on the message thread
+	class InputDeviceList : public MidiDevicePropertyEditor {
+	public:
+		using MidiDevicePropertyEditor::MidiDevicePropertyEditor;
+		using MidiDevicePropertyEditor::refreshDropdownList;
+	};
+
 	void setupPropertyEditor();
 	void setupKeyboardControl();
 	void loadFromSettings();
 	void saveSettings();
-	bool isMacroState(KeyboardMacro const &macro);
+	// A macro matches when exactly its keys are held, so the macros are compiled into key masks and matched with one lookup
+	typedef std::bitset<128> TKeyMask;
+	static TKeyMask keyMaskOf(std::set<int> const &midiNotes);
+	void compileMacros();
+	std::vector<KeyboardMacroEvent> macrosMatchingHeldKeys();
 	void refreshUI();
 
 	void turnOnMasterkeyboardInput();
 
 	void changeListenerCallback(ChangeBroadcaster* source) override; // This gets called when the synth is changed
+	void midiDevicesChanged(MidiDeviceWatcher::Changes const &changes) override;
 	void valueChanged(Value& value) override; // This gets called when the property editor is used
+	// Keeps the held keys up to date, for MIDI input as well as the keyboard on screen
+	void handleNoteOn(MidiKeyboardState* source, int midiChannel, int midiNoteNumber, float velocity) override;
+	void handleNoteOff(MidiKeyboardState* source, int midiChannel, int midiNoteNumber, float velocity) override;
 
 	PropertyEditor customSetup_;
 	MidiKeyboardState state_;
 	MidiKeyboardComponent keyboard_;
-	std::shared_ptr<MidiDevicePropertyEditor> midiDeviceList_; // Listen to this to get notified of newly available devices!
+	std::shared_ptr<InputDeviceList> midiDeviceList_;
 	ElectraOneRouter controllerRouter_;
+	MidiRouter routingMatrix_; // Additional routes from the settings file, e.g. BCR2000 to the current synth
 
 	OwnedArray<MacroConfig> configs_;
 
 	std::map<KeyboardMacroEvent, KeyboardMacro> macros_;
+	std::mutex keysLock_; // The keyboard state is fed from the MIDI thread and the UI
+	std::array<TKeyMask, 16> heldKeysPerChannel_;
+	std::unordered_map<TKeyMask, std::vector<KeyboardMacroEvent>> macrosByKeys_;
 	std::function<void(KeyboardMacroEvent)> executeMacro_;
 
 	midikraft::MidiController::HandlerHandle handle_ = midikraft::MidiController::makeNoneHandle();
@@ -0,0 +1,67 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "LibraryTreeIndex.h"
+
+#include <algorithm>
+
+void LibraryTreeIndex::clear()
+{
+	entries_.clear();
+}
+
+bool LibraryTreeIndex::isEmpty() const
+{
+	return entries_.empty();
+}
+
+void LibraryTreeIndex::add(Entry const &entry)
+{
+	String lowerName = String(entry.name).toLowerCase();
+	entries_.push_back({ entry, lowerName + " " + String(entry.synthName).toLowerCase(), lowerName });
+}
+
+std::vector<LibraryTreeIndex::Entry> LibraryTreeIndex::search(std::string const &query, size_t maxResults) const
+{
+	String lowerQuery = String(query).trim().toLowerCase();
+	StringArray words;
+	words.addTokens(lowerQuery, " ", "\"");
+	words.removeEmptyStrings();
+	if (words.isEmpty()) {
+		return {};
+	}
+
+	std::vector<Indexed const *> prefixMatches;
+	std::vector<Indexed const *> otherMatches;
+	for (auto const &indexed : entries_) {
+		bool all = std::all_of(words.begin(), words.end(), [&indexed](String const &word) { return indexed.searchText.contains(word); });
+		if (all) {
+			(indexed.lowerName.startsWith(lowerQuery) ? prefixMatches : otherMatches).push_back(&indexed);
+		}
+	}
+
+	std::vector<Entry> result;
+	for (auto matches : { &prefixMatches, &otherMatches }) {
+		for (auto indexed : *matches) {
+			if (result.size() >= maxResults) {
+				return result;
+			}
+			result.push_back(indexed->entry);
+		}
+	}
+	return result;
+}
+
+String LibraryTreeIndex::describe(Entry const &entry)
+{
+	switch (entry.kind) {
+	case Kind::UserList: return "User lists > " + String(entry.name);
+	case Kind::UserBank: return String(entry.synthName) + " > User Banks > " + String(entry.name);
+	case Kind::SynthBank: return String(entry.synthName) + " > In synth > " + String(entry.name);
+	case Kind::Import: return String(entry.synthName) + " > By import > " + String(entry.name);
+	}
+	return String(entry.name);
+}
@@ -0,0 +1,52 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include <string>
+#include <vector>
+
+// The names of all user lists, user banks, synth banks and imports shown in the library tree, with the path of tree node ids
+// leading to each. Searching it finds a list without opening the nodes it is in, which would query the database for every
+// node opened on the way. The owner fills it and clears it whenever the lists, imports or synths change.
+class LibraryTreeIndex {
+public:
+	enum class Kind {
+		UserList = 0,
+		UserBank = 1,
+		SynthBank = 2,
+		Import = 3
+	};
+
+	struct Entry {
+		Kind kind;
+		std::string name;
+		std::string synthName; // Empty for user lists, which are not bound to a synth
+		std::vector<std::string> path; // Ids of the tree nodes from the top level down to the entry itself
+		int bankNumber = -1; // Zero based, for the synth banks only
+		int bankSize = 0;
+	};
+
+	void clear();
+	bool isEmpty() const;
+	void add(Entry const &entry);
+
+	// All words of the query must be part of the name, or of the synth name. Names starting with the query come first
+	std::vector<Entry> search(std::string const &query, size_t maxResults) const;
+
+	static String describe(Entry const &entry);
+
+private:
+	struct Indexed {
+		Entry entry;
+		String searchText; // Name and synth name, lower case
+		String lowerName;
+	};
+
+	std::vector<Indexed> entries_;
+};
@@ -0,0 +1,120 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "LogViewBatchSink.h"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+
+LogRecordQueue::LogRecordQueue(size_t capacity) : capacity_(capacity)
+{
+}
+
+LogRecordQueue::~LogRecordQueue()
+{
+	Node *node = head_.exchange(nullptr);
+	while (node) {
+		Node *next = node->next;
+		delete node;
+		node = next;
+	}
+}
+
+size_t LogRecordQueue::capacity() const
+{
+	return capacity_;
+}
+
+void LogRecordQueue::push(spdlog::level::level_enum level, std::string text, std::string payload)
+{
+	if (size_.fetch_add(1, std::memory_order_relaxed) >= capacity_) {
+		size_.fetch_sub(1, std::memory_order_relaxed);
+		dropped_.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+	auto node = new Node{ { level, std::move(text), std::move(payload) }, head_.load(std::memory_order_relaxed) };
+	while (!head_.compare_exchange_weak(node->next, node, std::memory_order_release, std::memory_order_relaxed)) {
+	}
+}
+
+std::vector<LogRecordQueue::Record> LogRecordQueue::takeAll(size_t &outDropped)
+{
+	// The consumer always takes the whole list, so there is no ABA problem with the producers
+	Node *node = head_.exchange(nullptr, std::memory_order_acquire);
+	std::vector<Record> result;
+	while (node) {
+		Node *next = node->next;
+		result.push_back(std::move(node->record));
+		delete node;
+		node = next;
+	}
+	std::reverse(result.begin(), result.end());
+	size_.fetch_sub(result.size(), std::memory_order_relaxed);
+	outDropped = dropped_.exchange(0, std::memory_order_relaxed);
+	return result;
+}
+
+LogViewBatchSink::LogViewBatchSink(std::shared_ptr<LogRecordQueue> queue) : queue_(std::move(queue))
+{
+}
+
+void LogViewBatchSink::sink_it_(const spdlog::details::log_msg &msg)
+{
+	// The formatter is not thread safe, so formatting stays under the sink mutex. The queue is what the message thread sees
+	spdlog::memory_buf_t formatted;
+	formatter_->format(msg, formatted);
+	queue_->push(msg.level, fmt::to_string(formatted), std::string(msg.payload.data(), msg.payload.size()));
+}
+
+void LogViewBatchSink::flush_()
+{
+	// NOP, the feeder drains on its own schedule
+}
+
+LogViewFeeder::LogViewFeeder(LogView &logView, std::shared_ptr<LogRecordQueue> queue, int intervalMs, size_t recordsPerTick) :
+	logView_(logView), queue_(std::move(queue)), recordsPerTick_(recordsPerTick)
+{
+	startTimer(intervalMs);
+}
+
+LogViewFeeder::~LogViewFeeder()
+{
+	stopTimer();
+}
+
+void LogViewFeeder::timerCallback()
+{
+	size_t dropped = 0;
+	for (auto &record : queue_->takeAll(dropped)) {
+		backlog_.push_back(std::move(record));
+	}
+	if (backlog_.size() > queue_->capacity()) {
+		// The view cannot keep up, rather lose the oldest records than grow without bound
+		auto excess = backlog_.size() - queue_->capacity();
+		backlog_.erase(backlog_.begin(), backlog_.begin() + static_cast<std::ptrdiff_t>(excess));
+		dropped += excess;
+	}
+	if (dropped > 0) {
+		logView_.logMessage(spdlog::level::warn, fmt::format("{} log messages were dropped, too many at once to display", dropped));
+	}
+
+	size_t shown = 0;
+	while (!backlog_.empty() && shown < recordsPerTick_) {
+		auto record = std::move(backlog_.front());
+		backlog_.pop_front();
+		size_t repeats = 0;
+		while (!backlog_.empty() && backlog_.front().level == record.level && backlog_.front().payload == record.payload) {
+			backlog_.pop_front();
+			repeats++;
+		}
+		logView_.logMessage(record.level, record.text);
+		if (repeats > 0) {
+			logView_.logMessage(record.level, fmt::format("... repeated {} more times", repeats));
+		}
+		shown++;
+	}
+}
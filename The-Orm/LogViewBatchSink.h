@@ -0,0 +1,80 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include "LogView.h"
+
+#include <spdlog/sinks/base_sink.h>
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// The log records written by any thread, waiting to be shown. Producers push without taking a lock, the message thread takes
+// all records at once. Bounded, records arriving while the queue is full are dropped and counted.
+class LogRecordQueue {
+public:
+	struct Record {
+		spdlog::level::level_enum level;
+		std::string text; // Formatted with timestamp and level
+		std::string payload; // The bare message, to detect repetitions
+	};
+
+	explicit LogRecordQueue(size_t capacity);
+	~LogRecordQueue();
+
+	size_t capacity() const;
+
+	void push(spdlog::level::level_enum level, std::string text, std::string payload);
+	// Oldest first, outDropped is the number of records dropped since the previous call
+	std::vector<Record> takeAll(size_t &outDropped);
+
+private:
+	struct Node {
+		Record record;
+		Node *next;
+	};
+
+	size_t capacity_;
+	std::atomic<Node *> head_{ nullptr }; // Newest first
+	std::atomic<size_t> size_{ 0 };
+	std::atomic<size_t> dropped_{ 0 };
+};
+
+// Formats on the logging thread and queues, never touches the log view itself
+class LogViewBatchSink : public spdlog::sinks::base_sink<std::mutex> {
+public:
+	explicit LogViewBatchSink(std::shared_ptr<LogRecordQueue> queue);
+
+protected:
+	void sink_it_(const spdlog::details::log_msg &msg) override;
+	void flush_() override;
+
+private:
+	std::shared_ptr<LogRecordQueue> queue_;
+};
+
+// Moves the queued records into the log view on the message thread. At most recordsPerTick entries per tick keep the UI responsive
+// during a log storm, consecutive repetitions of the same message are collapsed into one entry. The level filter stays with the log view.
+class LogViewFeeder : private Timer {
+public:
+	LogViewFeeder(LogView &logView, std::shared_ptr<LogRecordQueue> queue, int intervalMs = 50, size_t recordsPerTick = 200);
+	~LogViewFeeder() override;
+
+private:
+	void timerCallback() override;
+
+	LogView &logView_;
+	std::shared_ptr<LogRecordQueue> queue_;
+	size_t recordsPerTick_;
+	std::deque<LogRecordQueue::Record> backlog_;
+};
@@ -9,9 +9,16 @@
 #include "MainComponent.h"
 
 #include "Settings.h"
+#include "SettingsWriteQueue.h"
 #include "UIModel.h"
 #include "Data.h"
 #include "OrmLookAndFeel.h"
+#include "HeadlessBenchmark.h"
+#include "HeadlessJobs.h"
+#include "StartupProfile.h"
+#include "DatabaseMemoryMap.h"
+#include "MidiDeviceWatcher.h"
+#include "Setlist.h"
 
 #include "GenericAdaptation.h"
 #include "embedded_module.h"
@@ -71,11 +78,21 @@ public:
     //==============================================================================
     void initialise (const String& commandLine) override
     {
-		ignoreUnused(commandLine);
+		// Headless benchmark mode: --benchmark <fixture directory> <result file>
+		auto arguments = StringArray::fromTokens(commandLine, true);
+		int benchmarkArgument = arguments.indexOf("--benchmark");
+		bool benchmark = benchmarkArgument >= 0 && benchmarkArgument + 2 < arguments.size();
+		// Headless import, export and reindex, see HeadlessJobs for the arguments
+		bool job = HeadlessJobs::isJob(arguments);
 
 		// This method is where you should put your application's initialization code...
+		StartupProfile::instance();
 		auto applicationDataDirName = "KnobKraftOrm";
 		Settings::setSettingsID(applicationDataDirName);
+		// Created here, so the threads using it later never race to create it
+		SettingsWriteQueue::instance();
+		// Before any database is opened
+		DatabaseMemoryMap::configure();
 
 #ifdef USE_SPARKLE
 #ifdef WIN32
@@ -87,13 +104,15 @@ public:
 		// Init python for GenericAdaptation
 		knobkraft::GenericAdaptation::startupGenericAdaptation();
 
+		StartupProfile::instance().phaseDone("Python");
+
 		// Init python with the embedded pytschirp module, if the Python init was successful
 		if (knobkraft::GenericAdaptation::hasPython()) {
 			pybind11::gil_scoped_acquire acquire;
 			globalImportEmbeddedModules();
 		}
 		else {
-			if (juce::SystemStats::getEnvironmentVariable("ORM_NO_PYTHON", "NOTSET") != "NOTSET") {
+			if (benchmark || job || juce::SystemStats::getEnvironmentVariable("ORM_NO_PYTHON", "NOTSET") != "NOTSET") {
 				spdlog::warn("Turning off Python integration because environment variable ORM_NO_PYTHON found - you will have less synths!");
 			}
 			else {
@@ -113,8 +132,23 @@ public:
 
 		// Load Data
 		Data::instance().initializeFromSettings();
+		StartupProfile::instance().phaseDone("Embedded modules and data");
+
+		if (benchmark) {
+			HeadlessBenchmark bench(HeadlessBenchmark::allSynths(), File(arguments[benchmarkArgument + 1].unquoted()));
+			bool ok = bench.run(File(arguments[benchmarkArgument + 2].unquoted()));
+			setApplicationReturnValue(ok ? 0 : 1);
+			quit();
+			return;
+		}
+		if (job) {
+			setApplicationReturnValue(HeadlessJobs::run(arguments));
+			quit();
+			return;
+		}
 
 		mainWindow = std::make_unique<MainWindow> (getWindowTitle());
+		StartupProfile::instance().phaseDone("Main window");
 
 #ifndef _DEBUG
 #ifdef USE_SENTRY
@@ -144,11 +178,23 @@ public:
 
 		// Fire a test event to see if Sentry actually works
 		sentry_capture_event(sentry_value_new_message_event(SENTRY_LEVEL_INFO,"custom","Launching KnobKraft Orm"));
+		StartupProfile::instance().phaseDone("Sentry");
 #endif
 #endif
 
 		// Window Title Refresher
 		UIModel::instance()->windowTitle_.addChangeListener(this);
+
+		// Runs once the message loop is up and the window got the chance to show, then the rest of the initialization fills in
+		MessageManager::callAsync([this]() {
+			StartupProfile::instance().phaseDone("Message loop");
+			StartupProfile::instance().markInteractive();
+			auto mainComp = mainWindow ? dynamic_cast<MainComponent *>(mainWindow->getContentComponent()) : nullptr;
+			if (mainComp) {
+				mainComp->startDeferredInitialization();
+			}
+			StartupProfile::instance().logSummary();
+		});
     }
 
 	String getWindowTitle() {
@@ -179,14 +225,18 @@ public:
 		// Save UIModel for next run
 		Data::instance().saveToSettings();
 		UIModel::shutdown();
+		// Holds patches of Python adaptations
+		Setlist::shutdown();
 
 		// No more Python from here please
 		knobkraft::GenericAdaptation::shutdownGenericAdaptation();
 
 		// Shutdown MIDI subsystem after all windows are gone
+		MidiDeviceWatcher::shutdown();
 		midikraft::MidiController::shutdown();
 
-		// Shutdown settings subsystem
+		// Shutdown settings subsystem, the settings still pending go in first
+		SettingsWriteQueue::shutdown();
 		Settings::instance().saveAndClose();
 		Settings::shutdown();
 
@@ -203,7 +253,7 @@ public:
     {
 		// Shut down database (that makes a backup)
 		// Do this before calling quit
-		auto mainComp = dynamic_cast<MainComponent *>(mainWindow->getContentComponent());
+		auto mainComp = mainWindow ? dynamic_cast<MainComponent *>(mainWindow->getContentComponent()) : nullptr;
 		if (mainComp) {
 			// Give it a chance to complete the Database backup
 			//TODO - should ask user or at least show progress dialog?
@@ -10,13 +10,23 @@
 #include "MidiController.h"
 #include "UIModel.h"
 
-#include "AutoCategorizeWindow.h"
+#include "AutoCategorizeJob.h"
 #include "AutoDetectProgressWindow.h"
+#include "DatabaseBackup.h"
+#include "DatabaseMigrationJob.h"
 #include "EditCategoryDialog.h"
 #include "ExportDialog.h"
+#include "MidiOutputScheduler.h"
+#include "NetworkMidi.h"
+#include "RomBankCache.h"
 #include "SimplePatchGrid.h"
+#include "StartupProfile.h"
+#include "MemoryReport.h"
+#include "Metrics.h"
+#include "Tracer.h"
 #include "SecondaryWindow.h"
 #include "Settings.h"
+#include "SettingsWriteQueue.h"
 
 #include "Virus.h"
 #include "Rev2.h"
@@ -30,7 +40,10 @@
 #include "MKS50.h"
 
 #include "GenericAdaptation.h"
+#include "LazyGenericAdaptation.h"
 #include "PatchInterchangeFormat.h"
+#include "PatchInterchangeWriter.h"
+#include "ParallelFor.h"
 
 #include "LayoutConstants.h"
 
@@ -49,14 +62,21 @@
 
 // Some command name constants
 const std::string kRetrievePatches{ "retrieveActiveSynthPatches" };
+const std::string kRetrieveAllBanks{ "retrieveAllBanksFromAllSynths" };
+const std::string kForgetRomBanks{ "forgetRomBanks" };
 const std::string kFetchEditBuffer{ "fetchEditBuffer" };
 const std::string kReceiveManualDump{ "receiveManualDump" };
 const std::string kLoadSysEx{ "loadsysEx" };
+const std::string kLoadLargeSysEx{ "loadLargeSysEx" };
 const std::string kExportSysEx{ "exportSysex" };
 const std::string kExportPIF { "exportPIF" };
 const std::string kShowDiff{ "showDiff" };
 const std::string kSynthDetection{ "synthDetection" };
 const std::string kLoopDetection{ "loopDetection" };
+const std::string kProgramChangeAudition{ "programChangeAudition" };
+const std::string kParameterDeltaSend{ "parameterDeltaSend" };
+const std::string kArmSetlist{ "armSetlist" };
+const std::string kDisarmSetlist{ "disarmSetlist" };
 const std::string kSelectAdaptationDirect{ "selectAdaptationDir" };
 const std::string kCreateNewAdaptation{ "createNewAdaptation" };
 
@@ -64,34 +84,12 @@ const std::string kCreateNewAdaptation{ "createNewAdaptation" };
 // Build a spdlog sink that goes into out standard log view
 #include <spdlog/spdlog.h>
 #include "SpdLogJuce.h"
-#include <spdlog/sinks/base_sink.h>
-
-template<typename Mutex>
-class LogViewSink : public spdlog::sinks::base_sink<Mutex>
-{
-public:
-	LogViewSink(LogView& logView) : logView_(logView) {}
-
-protected:
-	void sink_it_(const spdlog::details::log_msg& msg) override
-	{
-		spdlog::memory_buf_t formatted;
-		this->formatter_->format(msg, formatted);
-		logView_.logMessage(msg.level, fmt::to_string(formatted));
-	}
-
-	void flush_() override
-	{
-		// NOP
-	}
-
-private:
-	LogView& logView_;
-};
+#include "LogViewBatchSink.h"
 
+#include <algorithm>
+#include <atomic>
+#include <iterator>
 #include <mutex>
-using LogViewSink_mt = LogViewSink<std::mutex>;
-
 
 class ActiveSynthHolder : public midikraft::SynthHolder, public ActiveListItem {
 public:
@@ -130,6 +128,13 @@ Colour MainComponent::getUIColour(LookAndFeel_V4::ColourScheme::UIColour colourT
 
 //==============================================================================
 MainComponent::MainComponent(bool makeYourOwnSize) :
+	recentDatabases_([]() {
+		std::vector<std::shared_ptr<midikraft::Synth>> result;
+		for (auto &synth : UIModel::instance()->synthList_.allSynths()) {
+			result.push_back(synth.synth());
+		}
+		return result;
+	}, kWarmRecentDatabases),
 	globalScaling_(1.0f),
 	buttons_(301),
 	mainTabs_(TabbedButtonBar::Orientation::TabsAtTop),
@@ -141,7 +146,10 @@ MainComponent::MainComponent(bool makeYourOwnSize) :
 
 	// Setup spd logging
 	std::vector<spdlog::sink_ptr> sinks;
-	sinks.push_back(std::make_shared<LogViewSink_mt>(logView_));
+	// Log storms during imports must not stall the UI, so records are queued and fed to the log view in batches
+	auto logRecords = std::make_shared<LogRecordQueue>(kLogRecordCapacity);
+	sinks.push_back(std::make_shared<LogViewBatchSink>(logRecords));
+	logFeeder_ = std::make_unique<LogViewFeeder>(logView_, logRecords);
 	spdLogger_ = std::make_shared<spdlog::logger>("KnobKraftOrm", begin(sinks), end(sinks));
 	spdLogger_->set_pattern("%H:%M:%S: %l %v");
 	//spdLogger_->set_pattern("%Y-%m-%d %H:%M:%S.%e%z %l [%t] %v");
@@ -150,9 +158,18 @@ MainComponent::MainComponent(bool makeYourOwnSize) :
 	spdlog::set_level(spdlog::level::trace);
 	spdlog::info("Launching KnobKraft Orm");
 
+	// The ports of remote synths must exist before the MIDI devices are listed for the synth detection
+	NetworkMidi::startClients();
+
 	auto customDatabase = Settings::instance().get("LastDatabase");
 	File databaseFile(customDatabase);
-	if (databaseFile.existsAsFile()) {
+	File migrateOnStartup;
+	if (databaseFile.existsAsFile() && DatabaseMigrationJob::needsMigration(databaseFile)) {
+		// Start with the default database, the last one is brought up to date in the background and opened when done
+		migrateOnStartup = databaseFile;
+		database_ = std::make_unique<midikraft::PatchDatabase>(false);
+	}
+	else if (databaseFile.existsAsFile()) {
 		//TODO
 		// This is not openDatabase, because that expects the database_ pointer to be already initialized.
 		// Refactoring would be to create a database without a loaded file state.
@@ -172,7 +189,10 @@ MainComponent::MainComponent(bool makeYourOwnSize) :
 		recentFiles_.restoreFromString(Settings::instance().get("RecentFiles"));
 	}
 
+	StartupProfile::instance().phaseDone("Database");
+
 	automaticCategories_ = database_->getCategorizer();
+	categoryRulesAtStart_ = CategoryRuleSnapshot::take(automaticCategories_, database_->getCategories());
 
 	auto bcr2000 = std::make_shared <midikraft::BCR2000>();
 
@@ -190,14 +210,31 @@ MainComponent::MainComponent(bool makeYourOwnSize) :
 	synths.emplace_back(midikraft::SynthHolder(std::make_shared<midikraft::RefaceDX>(), buttonColour));
 	synths.emplace_back(midikraft::SynthHolder(bcr2000, buttonColour));
 
-	// Now adding all adaptations
-	auto adaptations = knobkraft::GenericAdaptation::allAdaptations();
+	// Now adding all adaptations. Those not changed since the last run are only imported when activated
+	auto adaptations = knobkraft::LazyGenericAdaptation::allAdaptations();
 	for (auto const& adaptation : adaptations) {
 		synths.emplace_back(midikraft::SynthHolder(adaptation, buttonColour));
 	}
 
 	UIModel::instance()->synthList_.setSynthList(synths);
 
+	// Calls into the adaptations show up in the performance counters and traces. The histograms are looked up once here,
+	// the observer runs for every call and must not take the lock of the registry
+	static std::vector<Metrics::Histogram *> adaptationCallHistograms;
+	if (adaptationCallHistograms.empty()) {
+		for (auto name : knobkraft::kAdapatationPythonFunctionNames) {
+			adaptationCallHistograms.push_back(&Metrics::instance().histogram(std::string("adaptation.") + name));
+		}
+		adaptationCallHistograms.push_back(&Metrics::instance().histogram("adaptation.(other)"));
+	}
+	knobkraft::AdaptationCallProfiler::setCallObserver([](int functionIndex, char const *functionName, int64 nanoseconds) {
+		adaptationCallHistograms[std::min((size_t) functionIndex, adaptationCallHistograms.size() - 1)]->record(nanoseconds / 1000);
+		if (Tracer::enabled()) {
+			auto durationMicros = nanoseconds / 1000;
+			Tracer::instance().complete(functionName, "adaptation", Tracer::nowMicros() - durationMicros, durationMicros);
+		}
+	});
+
 	// Load activated state
 	for (auto synth : synths) {
 		if (!synth.device()) continue;
@@ -214,14 +251,18 @@ MainComponent::MainComponent(bool makeYourOwnSize) :
 		UIModel::instance()->synthList_.setSynthActive(synth.device().get(), active);
 	}
 
+	// Activation replaced the lazy adaptations of the active synths with the real ones
+	synths = UIModel::instance()->synthList_.allSynths();
+
 	refreshSynthList();
+	StartupProfile::instance().phaseDone("Synths and adaptations");
 
 	autodetector_.addChangeListener(&synthList_);
 
 	// Prepare for resizing the UI to fit on the screen. Crash on headless devices
 	globalScaling_ = (float)Desktop::getInstance().getDisplays().getPrimaryDisplay()->scale;
 	float scale = calcAcceptableGlobalScaleFactor();
-	auto persistedZoom = Settings::instance().get("zoom", "0");
+	auto persistedZoom = SettingsWriteQueue::instance().get("zoom", "0");
 	if (persistedZoom != "0") {
 		auto stored = (float)atof(persistedZoom.c_str());
 		if (stored >= 0.5f && stored <= 3.0f) {
@@ -240,9 +281,9 @@ MainComponent::MainComponent(bool makeYourOwnSize) :
 				{ "Export multiple databases..."  },
 				{ "Merge multiple databases..."  },
 				{ "Quit" } } } },
-		{1, { "Edit", { { "Copy patch to clipboard..." },  { "Bulk rename patches..."},  {"Delete patches..."}, {"Reindex patches..."}}}},
-		{2, { "MIDI", { { "Auto-detect synths" }, { kSynthDetection},  { kRetrievePatches }, { kFetchEditBuffer }, { kReceiveManualDump }, { kLoopDetection} }}},
-		{3, { "Patches", { { kLoadSysEx}, { kExportSysEx }, { kExportPIF}, { kShowDiff} }}},
+		{1, { "Edit", { { "Copy patch to clipboard..." },  { "Bulk rename patches..."},  {"Delete patches..."}, {"Reindex patches..."}, {"Repair database..."}, {"Compact database..."}, {"Find near duplicates..."}}}},
+		{2, { "MIDI", { { "Auto-detect synths" }, { kSynthDetection},  { kRetrievePatches }, { kRetrieveAllBanks }, { kForgetRomBanks }, { kFetchEditBuffer }, { kReceiveManualDump }, { kLoopDetection}, { kProgramChangeAudition }, { kParameterDeltaSend }, { kArmSetlist }, { kDisarmSetlist } }}},
+		{3, { "Patches", { { kLoadSysEx}, { kLoadLargeSysEx }, { kExportSysEx }, { kExportPIF}, { kShowDiff} }}},
 		{4, { "Categories", { { "Edit categories" }, {{ "Show category naming rules file"}},  {"Edit category import mapping"},  {"Rerun auto categorize"}}}},
 		{5, { "View", { { "Open 2nd window" }, {"Scale 75%"}, {"Scale 100%"}, {"Scale 125%"}, {"Scale 150%"}, {"Scale 175%"}, {"Scale 200%"}}}},
 		{6, { "Options", { { kCreateNewAdaptation}, { kSelectAdaptationDirect} }}},
@@ -253,6 +294,8 @@ MainComponent::MainComponent(bool makeYourOwnSize) :
 			{ "Crash reporting consent" },
 #endif
 #endif
+			{ "Capture performance trace..." },
+			{ "Dump memory report" },
 			{ "Check for updates..." },
 			{ "About" } } } }
 	};
@@ -265,6 +308,15 @@ MainComponent::MainComponent(bool makeYourOwnSize) :
 	{ "Import patches from synth", { kRetrievePatches, [this]() {
 		patchView_->retrievePatches();
 	}, juce::KeyPress::F7Key } },
+	{ "Import all banks from all synths", { kRetrieveAllBanks, [this]() {
+		patchView_->retrieveAllBanksFromAllSynths();
+	} } },
+	{ "Download ROM banks again", { kForgetRomBanks, []() {
+		if (auto synth = UIModel::instance()->currentSynth_.smartSynth()) {
+			RomBankCache::forget(synth);
+			spdlog::info("The ROM banks of {} will be downloaded again the next time", synth->getName());
+		}
+	} } },
 	{ "Import edit buffer from synth",{ kFetchEditBuffer, [this]() {
 		patchView_->retrieveEditBuffer();
 	}, juce::KeyPress::F8Key  } },
@@ -274,6 +326,9 @@ MainComponent::MainComponent(bool makeYourOwnSize) :
 	{ "Import from files into database", { kLoadSysEx, [this]() {
 		patchView_->loadPatches();
 	}, juce::KeyPress::F3Key } },
+	{ "Import large sysex file into database", { kLoadLargeSysEx, [this]() {
+		patchView_->loadLargeSysexFile();
+	} } },
 	{ "Export into sysex files", { kExportSysEx , [this]() {
 		patchView_->exportPatches();
 	}}},
@@ -289,6 +344,22 @@ MainComponent::MainComponent(bool makeYourOwnSize) :
 	{ "Check for MIDI loops", { kLoopDetection, [this]() {
 		setupView_->loopDetection();
 	} } },
+	{ "Toggle program change audition", { kProgramChangeAudition, []() {
+		PatchView::setProgramChangeAudition(!PatchView::programChangeAudition());
+		spdlog::info(PatchView::programChangeAudition() ? "Patches known to be in the synth are now selected by program change"
+			: "Patches are now always sent into the edit buffer");
+	} } },
+	{ "Toggle sending only changed parameters", { kParameterDeltaSend, []() {
+		ParameterDeltaSend::setEnabled(!ParameterDeltaSend::enabled());
+		spdlog::info(ParameterDeltaSend::enabled() ? "Switching between similar patches now sends only the changed parameters where the synth supports it"
+			: "Patches are now always sent as full dumps");
+	} } },
+	{ "Arm current list as setlist", { kArmSetlist, [this]() {
+		patchView_->armSetlist();
+	} } },
+	{ "Disarm setlist", { kDisarmSetlist, [this]() {
+		patchView_->disarmSetlist();
+	} } },
 	{"Set User Adaptation Dir", { kSelectAdaptationDirect, []() {
 		FileChooser directoryChooser("Please select the directory to store your user adaptations...", File(knobkraft::GenericAdaptation::getAdaptationDirectory()));
 		if (directoryChooser.browseForDirectory()) {
@@ -328,15 +399,42 @@ MainComponent::MainComponent(bool makeYourOwnSize) :
 			"And don't worry, if you have manually set categories (or manually removed categories that were auto-detected), this information is retained!"
 			)) {
 			automaticCategories_ = database_->getCategorizer(); // Need to reload the automatic Categories!
-			AutoCategorizeWindow window(database_.get(), automaticCategories_, currentFilter, [this]() {
+			auto job = std::make_shared<AutoCategorizeJob>(File(database_->getCurrentDatabaseFileName()), automaticCategories_, currentFilter);
+			// If only some categories changed during this session, only the patches that could flip need to be looked at
+			auto currentRules = std::make_shared<CategoryRuleSnapshot>(CategoryRuleSnapshot::take(automaticCategories_, database_->getCategories()));
+			std::set<std::string> changed;
+			if (currentRules->changedCategories(categoryRulesAtStart_, changed) && !changed.empty()) {
+				StringArray names;
+				for (auto const &name : changed) {
+					names.add(name);
+				}
+				int choice = AlertWindow::showYesNoCancelBox(AlertWindow::QuestionIcon, "Only changed categories?",
+					fmt::format("Since the start of the program, the rules of {} categories have changed: {}.\n\n"
+						"Re-evaluate only the patches these changes can affect, or all patches? Choose all if you edited the rules files before starting the program.",
+						changed.size(), names.joinIntoString(", ").toStdString()),
+					"Only affected", "All patches", "Cancel");
+				if (choice == 0) return;
+				if (choice == 1) {
+					job->restrictTo([currentRules, changed](midikraft::PatchHolder const &patch) {
+						return currentRules->mightChange(patch, changed);
+					});
+				}
+			}
+			BackgroundJobs::instance().add(job, {}, [this](BackgroundJob::State) {
 				patchView_->retrieveFirstPageFromDatabase();
 			});
-			window.runThread();
+			showJobList();
 		}
 	} } },
 	{ "About", { "About", []() {
 		aboutBox();
 	}}},
+	{ "Capture performance trace...", { "Capture performance trace...", [this]() {
+		captureTrace();
+	}}},
+	{ "Dump memory report", { "Dump memory report", []() {
+		spdlog::info(MemoryReport::instance().report());
+	}}},
 	{ "Quit", { "Quit", []() {
 		JUCEApplicationBase::quit();
 	}}},
@@ -374,6 +472,15 @@ MainComponent::MainComponent(bool makeYourOwnSize) :
 		{ "Reindex patches...", { "Reindex patches...", [this] {
 			patchView_->reindexPatches();
 		}}},
+		{ "Repair database...", { "Repair database...", [this] {
+			patchView_->repairDatabase();
+		}}},
+		{ "Compact database...", { "Compact database...", [this] {
+			patchView_->compactDatabase();
+		}}},
+		{ "Find near duplicates...", { "Find near duplicates...", [this] {
+			patchView_->findNearDuplicates();
+		}}},
 		{ "Copy patch to clipboard...", { "Copy patch to clipboard...", [] {
 			auto patch = UIModel::currentPatch();
 			if (patch.patch() && patch.synth()) {
@@ -433,23 +540,6 @@ MainComponent::MainComponent(bool makeYourOwnSize) :
 	setupView_ = std::make_unique<SetupView>(&autodetector_);
 	//recordingView_ = std::make_unique<RecordingView>(*patchView_);
 
-	// Create Macro Definition view
-	keyboardView_ = std::make_unique<KeyboardMacroView>([this](KeyboardMacroEvent event) {
-		switch (event) {
-		case KeyboardMacroEvent::Hide: patchView_->hideCurrentPatch(); break;
-		case KeyboardMacroEvent::Favorite: patchView_->favoriteCurrentPatch(); break;
-		case KeyboardMacroEvent::NextPatch: patchView_->selectNextPatch(); break;
-		case KeyboardMacroEvent::PreviousPatch: patchView_->selectPreviousPatch(); break;
-		case KeyboardMacroEvent::ImportEditBuffer: patchView_->retrieveEditBuffer(); break;
-		case KeyboardMacroEvent::Unknown:
-			// Fall through
-		default:
-			spdlog::error("Invalid keyboard macro event detected");
-			return;
-		}
-		spdlog::debug("Keyboard Macro event fired {}", KeyboardMacro::toText(event));
-		});
-
 	// Create the BCR2000 view, the predecessor to the generic editor view
 	//bcr2000View_ = std::make_unique<BCR2000_Component>(bcr2000);
 
@@ -460,9 +550,10 @@ MainComponent::MainComponent(bool makeYourOwnSize) :
 	//mainTabs_.addTab("Editor", tabColour, bcr2000View_.get(), false);
 	//mainTabs_.addTab("Audio In", tabColour, recordingView_.get(), false);
 	mainTabs_.addTab("Settings", tabColour, settingsView_.get(), false);
-	mainTabs_.addTab("Macros", tabColour, keyboardView_.get(), false);
 	mainTabs_.addTab("Setup", tabColour, setupView_.get(), false);
 	mainTabs_.addTab("MIDI Log", tabColour, &midiLogArea_, false);
+	jobListPanel_ = std::make_unique<JobListPanel>();
+	mainTabs_.addTab("Jobs", tabColour, jobListPanel_.get(), false);
 
 	addAndMakeVisible(menuBar_);
 	splitter_ = std::make_unique<SplitteredComponent>("LogSplitter", SplitteredEntry{ &mainTabs_, 80, 20, 100 }, SplitteredEntry{ &logArea_, 20, 5, 50 }, false);
@@ -491,17 +582,17 @@ MainComponent::MainComponent(bool makeYourOwnSize) :
 
 	// Install our MidiLogger
 	midikraft::MidiController::instance()->setMidiLogFunction([this](const MidiMessage& message, const String& source, bool isOut) {
+		midiPortMetrics_.record(message, source, isOut);
 		midiLogView_.addMessageToList(message, source, isOut);
 		});
+	Metrics::instance().setGauge("midi.bcr2000.message_drops", []() {
+		return (double) midikraft::BCR2000::detectedMessageDrops();
+	});
 
-	// Do a quickconfigure
 	auto list = UIModel::instance()->synthList_.activeSynths();
-	autodetector_.quickconfigure(list);
-	// Refresh Setup View with the result of this
-	UIModel::instance()->currentSynth_.sendChangeMessage();
 
 	// Monitor the list of available MIDI devices
-	midikraft::MidiController::instance()->addChangeListener(this);
+	MidiDeviceWatcher::instance().addListener(this);
 
 	// If there is no synth configured, like, on first launch, show the Setup tab instead of the default Library tab
 	if (list.empty()) {
@@ -509,9 +600,6 @@ MainComponent::MainComponent(bool makeYourOwnSize) :
 		mainTabs_.setCurrentTabIndex(setupIndex, false);
 	}
 
-	// Feel free to request the globals page from the active synth
-	settingsView_->loadGlobals();
-
 	// Make sure you set the size of the component after
 	// you add any child components.
 	if (makeYourOwnSize) {
@@ -522,6 +610,11 @@ MainComponent::MainComponent(bool makeYourOwnSize) :
 
 	// Check if the secondary main window was open last time we closed
 	openSecondMainWindow(true);
+	StartupProfile::instance().phaseDone("Views");
+
+	if (migrateOnStartup.existsAsFile()) {
+		migrateThenOpen(migrateOnStartup);
+	}
 
 	// Refresh Window title and other things to do when the MainComponent is displayed
 #ifdef WIN32
@@ -555,6 +648,12 @@ MainComponent::MainComponent(bool makeYourOwnSize) :
 
 MainComponent::~MainComponent()
 {
+	detectionVerification_.reset();
+
+	// Stop the background jobs while the database and the views they report to are still there
+	jobListPanel_.reset();
+	BackgroundJobs::shutdown();
+
 	// Prevent memory leaks being reported on shutdown
 	EditCategoryDialog::shutdown();
 	ExportDialog::shutdown();
@@ -569,10 +668,15 @@ MainComponent::~MainComponent()
 	win_sparkle_cleanup();
 #endif
 #endif
+	MidiDeviceWatcher::instance().removeListener(this);
 	UIModel::instance()->synthList_.removeChangeListener(this);
 	UIModel::instance()->currentSynth_.removeChangeListener(&synthList_);
 	UIModel::instance()->currentSynth_.removeChangeListener(this);
 
+	// Stop the output threads before the MIDI outputs are closed
+	MidiOutputScheduler::shutdownAll();
+	NetworkMidi::shutdown();
+
 	Logger::setCurrentLogger(nullptr);
 }
 
@@ -606,6 +710,9 @@ void MainComponent::createNewDatabase()
 	FileChooser databaseChooser("Please enter the name of the database file to create...", File(databasePath), "*.db3");
 	if (databaseChooser.browseForFileToSave(true)) {
 		File databaseFile(databaseChooser.getResult());
+		if (!noBackgroundJobsRunning()) {
+			return;
+		}
 		if (databaseFile.existsAsFile()) {
 			if (!AlertWindow::showOkCancelBox(AlertWindow::WarningIcon, "File already exists", "The file will be overwritten and all contents will be lost! Do you want to proceed?")) {
 				return;
@@ -613,9 +720,12 @@ void MainComponent::createNewDatabase()
 			databaseFile.deleteFile();
 		}
 		recentFiles_.addFile(File(database_->getCurrentDatabaseFileName()));
+		patchView_->flushMetadataEdits();
 		if (database_->switchDatabaseFile(databaseFile.getFullPathName().toStdString(), midikraft::PatchDatabase::OpenMode::READ_WRITE)) {
 			persistRecentFileList();
+			warmRecentDatabases();
 			// That worked, new database file is in use!
+			categoryRulesAtStart_ = CategoryRuleSnapshot::take(database_->getCategorizer(), database_->getCategories());
 			Settings::instance().set("LastDatabasePath", databaseFile.getParentDirectory().getFullPathName().toStdString());
 			Settings::instance().set("LastDatabase", databaseFile.getFullPathName().toStdString());
 			// Refresh UI
@@ -642,13 +752,22 @@ void MainComponent::openDatabase()
 
 void MainComponent::openDatabase(File& databaseFile)
 {
-	if (databaseFile.existsAsFile()) {
+	if (databaseFile.existsAsFile() && DatabaseMigrationJob::needsMigration(databaseFile)) {
+		// The current database is not touched by this, so it can run next to other jobs
+		migrateThenOpen(databaseFile);
+		return;
+	}
+	if (databaseFile.existsAsFile() && noBackgroundJobsRunning()) {
 		recentFiles_.addFile(File(database_->getCurrentDatabaseFileName()));
+		patchView_->flushMetadataEdits();
 		try {
 			if (database_->switchDatabaseFile(databaseFile.getFullPathName().toStdString(), midikraft::PatchDatabase::OpenMode::READ_WRITE)) {
 				recentFiles_.removeFile(databaseFile);
 				persistRecentFileList();
+				recentDatabases_.forget(databaseFile);
+				warmRecentDatabases();
 				// That worked, new database file is in use!
+				categoryRulesAtStart_ = CategoryRuleSnapshot::take(database_->getCategorizer(), database_->getCategories());
 				Settings::instance().set("LastDatabasePath", databaseFile.getParentDirectory().getFullPathName().toStdString());
 				Settings::instance().set("LastDatabase", databaseFile.getFullPathName().toStdString());
 				// Refresh UI
@@ -664,6 +783,50 @@ void MainComponent::openDatabase(File& databaseFile)
 	}
 }
 
+void MainComponent::migrateThenOpen(File const &databaseFile)
+{
+	if (migrating_ != File()) {
+		AlertWindow::showMessageBox(AlertWindow::InfoIcon, "Migration running",
+			"The database " + migrating_.getFullPathName() + " is being migrated to the current version. Please wait for it to finish, it is opened right afterwards.");
+		return;
+	}
+	migrating_ = databaseFile;
+	spdlog::info("Database {} was made by an older version, migrating it in the background. It will be opened once that is done", databaseFile.getFullPathName());
+	auto job = std::make_shared<DatabaseMigrationJob>(databaseFile);
+	BackgroundJobs::instance().add(job, {}, [this, job](BackgroundJob::State state) {
+		File migrated = migrating_;
+		if (state == BackgroundJob::State::Succeeded) {
+			// Still counts as migrating, so nobody starts another one before it is open
+			openMigratedWhenIdle();
+			return;
+		}
+		migrating_ = File();
+		if (state == BackgroundJob::State::Failed) {
+			AlertWindow::showMessageBox(AlertWindow::WarningIcon, "Database not opened",
+				fmt::format("Could not migrate {} to the current version: {}\n\nThe backup made before is at {}", migrated.getFullPathName().toStdString(), job->error(), job->backupFile().getFullPathName().toStdString()));
+		}
+	});
+	showJobList();
+}
+
+void MainComponent::openMigratedWhenIdle()
+{
+	// Other jobs might still work on the current database, the switch waits for them like the user would have to
+	if (BackgroundJobs::instance().hasActiveJobs()) {
+		Component::SafePointer<MainComponent> safeThis(this);
+		Timer::callAfterDelay(kRetryOpenMs, [safeThis]() {
+			if (safeThis) {
+				safeThis->openMigratedWhenIdle();
+			}
+		});
+		return;
+	}
+	File migrated = migrating_;
+	migrating_ = File();
+	// The migration left a current file, so this goes right to opening it
+	openDatabase(migrated);
+}
+
 void MainComponent::saveDatabaseAs()
 {
 	std::string lastPath = Settings::instance().get("LastDatabasePath", "");
@@ -674,14 +837,21 @@ void MainComponent::saveDatabaseAs()
 	FileChooser databaseChooser("Please choose a new KnobKraft Orm SQlite database file...", lastDirectory, "*.db3");
 	if (databaseChooser.browseForFileToSave(true)) {
 		File databaseFile = databaseChooser.getResult();
-		database_->makeDatabaseBackup(databaseFile);
+		DatabaseBackup copy(File(database_->getCurrentDatabaseFileName()), databaseFile);
+		copy.runThread();
+		if (!copy.succeeded()) {
+			AlertWindow::showMessageBox(AlertWindow::WarningIcon, "Error saving database", copy.error());
+			return;
+		}
 		openDatabase(databaseFile);
 	}
 }
 
 class MergeAndExport : public ThreadWithProgressWindow {
 public:
-	explicit MergeAndExport(Array<File> databases) : ThreadWithProgressWindow("Exporting databases...", true, true), databases_(std::move(databases)) {
+	// The patches of one page of each database being exported are in memory at the same time, so the budget limits how many databases are exported in parallel
+	MergeAndExport(Array<File> databases, int patchesInMemory) : ThreadWithProgressWindow("Exporting databases...", true, true), databases_(std::move(databases))
+		, parallelExports_(std::max(1, patchesInMemory / kPatchesPerPage)) {
 	}
 
 	void run() override
@@ -692,60 +862,80 @@ public:
 			allSynths.push_back(synth.synth());
 		}
 
-		double done = 0.0f;
-		int count = 0;
-		for (auto const& file : databases_) {
+		std::atomic<int> count(0);
+		parallelFor((size_t) databases_.size(), [this, &allSynths, &count](size_t index) {
 			if (threadShouldExit()) {
-				break;
+				return;
 			}
-			File exported = file.withFileExtension(".json");
-			if (!exported.exists()) {
-				std::vector<midikraft::PatchHolder> allPatches;
-				try {
-					midikraft::PatchDatabase mergeSource(file.getFullPathName().toStdString(), midikraft::PatchDatabase::OpenMode::READ_ONLY);
-					midikraft::PatchFilter filter(allSynths);
-					spdlog::info("Exporting database file {} containing {} patches", file.getFullPathName(), mergeSource.getPatchesCount(filter));
-					allPatches = mergeSource.getPatches(filter, 0, -1);
-				}
-				catch (midikraft::PatchDatabaseReadonlyException& e) {
-					ignoreUnused(e);
-					// This exception is thrown when opening the database caused a write operation. Most likely this is an old database needing to run migration code first.
-					// We'll do this by creating a backup as temporary file.
-					File tempfile = File::createTempFile("db3");
-					try {
-						midikraft::PatchDatabase::makeDatabaseBackup(file, tempfile);
-						midikraft::PatchDatabase mergeSource(tempfile.getFullPathName().toStdString(), midikraft::PatchDatabase::OpenMode::READ_WRITE_NO_BACKUPS);
-						midikraft::PatchFilter filter(allSynths);
-						spdlog::info("Exporting database file {} containing {} patches", file.getFullPathName(), mergeSource.getPatchesCount(filter));
-						allPatches = mergeSource.getPatches(filter, 0, -1);
-					}
-					catch (midikraft::PatchDatabaseException& e) {
-						spdlog::error("Fatal error opening database file {}: {}", file.getFullPathName(), e.what());
-					}
-					tempfile.deleteFile();
-				}
-				catch (midikraft::PatchDatabaseException& e) {
-					spdlog::error("Fatal error opening database file {}: {}", file.getFullPathName(), e.what());
-				}
+			if (exportDatabase(databases_[(int) index], allSynths)) {
+				count++;
+			}
+		}, [this](double progress) {
+			setProgress(progress);
+			return !threadShouldExit();
+		}, 0.0, 1.0, parallelExports_);
+		spdlog::info("Done, exported {} databases to pip files for reimport and merge", count.load());
+	}
 
-				// We have all patches in memory - write them into a pip file
-				if (!allPatches.empty()) {
-					midikraft::PatchInterchangeFormat::save(allPatches, exported.getFullPathName().toStdString());
-				}
+private:
+	static constexpr int kPatchesPerPage = 500;
+
+	bool exportDatabase(File const &file, std::vector<std::shared_ptr<midikraft::Synth>> const &allSynths) {
+		File exported = file.withFileExtension(".json");
+		if (exported.exists()) {
+			spdlog::warn("Not exporting because file already exists: {}", exported.getFullPathName());
+			return false;
+		}
+		try {
+			midikraft::PatchDatabase mergeSource(file.getFullPathName().toStdString(), midikraft::PatchDatabase::OpenMode::READ_ONLY);
+			return exportPages(mergeSource, file, exported, allSynths);
+		}
+		catch (midikraft::PatchDatabaseReadonlyException& e) {
+			ignoreUnused(e);
+			// This exception is thrown when opening the database caused a write operation. Most likely this is an old database needing to run migration code first.
+			// We'll do this by creating a backup as temporary file.
+			File tempfile = File::createTempFile("db3");
+			bool result = false;
+			try {
+				midikraft::PatchDatabase::makeDatabaseBackup(file, tempfile);
+				midikraft::PatchDatabase mergeSource(tempfile.getFullPathName().toStdString(), midikraft::PatchDatabase::OpenMode::READ_WRITE_NO_BACKUPS);
+				result = exportPages(mergeSource, file, exported, allSynths);
 			}
-			else {
-				spdlog::warn("Not exporting because file already exists: {}", exported.getFullPathName());
+			catch (midikraft::PatchDatabaseException& e) {
+				spdlog::error("Fatal error opening database file {}: {}", file.getFullPathName(), e.what());
 			}
+			tempfile.deleteFile();
+			return result;
+		}
+		catch (midikraft::PatchDatabaseException& e) {
+			spdlog::error("Fatal error opening database file {}: {}", file.getFullPathName(), e.what());
+		}
+		return false;
+	}
 
-			done += 1.0;
-			setProgress(done / databases_.size());
-			count++;
+	// Pages through the database and appends each page to the pip file, an incomplete file is removed again
+	bool exportPages(midikraft::PatchDatabase &mergeSource, File const &file, File const &exported, std::vector<std::shared_ptr<midikraft::Synth>> const &allSynths) {
+		midikraft::PatchFilter filter(allSynths);
+		int total = mergeSource.getPatchesCount(filter);
+		spdlog::info("Exporting database file {} containing {} patches", file.getFullPathName(), total);
+		PatchInterchangeWriter writer(exported);
+		for (int skip = 0; skip < total; skip += kPatchesPerPage) {
+			if (threadShouldExit()) {
+				return false;
+			}
+			auto page = mergeSource.getPatches(filter, skip, kPatchesPerPage);
+			if (page.empty()) {
+				break;
+			}
+			if (!writer.append(page)) {
+				return false;
+			}
 		}
-		spdlog::info("Done, exported {} databases to pip files for reimport and merge", count);
+		return writer.finish() && writer.patchesWritten() > 0;
 	}
 
-private:
 	Array<File> databases_;
+	int parallelExports_;
 
 };
 
@@ -763,7 +953,8 @@ void MainComponent::exportDatabases()
 		// Find all databases
 		Array<File> databases;
 		databaseChooser.getResult().findChildFiles(databases, File::TypesOfFileToFind::findFiles, false, "*.db3");
-		MergeAndExport mergeDialog(databases);
+		int patchesInMemory = String(Settings::instance().get("ExportPatchesInMemory", "4000")).getIntValue();
+		MergeAndExport mergeDialog(databases, patchesInMemory);
 		mergeDialog.runThread();
 	}
 }
@@ -807,6 +998,88 @@ void MainComponent::persistRecentFileList()
 	Settings::instance().set("RecentFiles", recentFiles_.toString().toStdString());
 }
 
+void MainComponent::startDeferredInitialization()
+{
+	// Everything the library does not need, so the window is usable earlier
+	// Create Macro Definition view
+	keyboardView_ = std::make_unique<KeyboardMacroView>([this](KeyboardMacroEvent event) {
+		switch (event) {
+		case KeyboardMacroEvent::Hide: patchView_->hideCurrentPatch(); break;
+		case KeyboardMacroEvent::Favorite: patchView_->favoriteCurrentPatch(); break;
+		case KeyboardMacroEvent::NextPatch: patchView_->selectNextPatch(); break;
+		case KeyboardMacroEvent::PreviousPatch: patchView_->selectPreviousPatch(); break;
+		case KeyboardMacroEvent::ImportEditBuffer: patchView_->retrieveEditBuffer(); break;
+		case KeyboardMacroEvent::Unknown:
+			// Fall through
+		default:
+			spdlog::error("Invalid keyboard macro event detected");
+			return;
+		}
+		spdlog::debug("Keyboard Macro event fired {}", KeyboardMacro::toText(event));
+		});
+	Colour tabColour = getUIColour(LookAndFeel_V4::ColourScheme::UIColour::widgetBackground);
+	mainTabs_.addTab("Macros", tabColour, keyboardView_.get(), false, findIndexOfTabWithNameEnding(&mainTabs_, "Setup"));
+	StartupProfile::instance().phaseDone("Macros");
+
+	// Synths found at the same place as last time are usable right away and verified in the background, only the others need a quickconfigure
+	auto list = UIModel::instance()->synthList_.activeSynths();
+	auto restored = DetectionCache::restore(list);
+	DetectionCache::TSynthList notRestored;
+	std::copy_if(list.begin(), list.end(), std::back_inserter(notRestored), [&restored](std::shared_ptr<midikraft::SimpleDiscoverableDevice> const &synth) {
+		return std::find(restored.begin(), restored.end(), synth) == restored.end();
+	});
+	quickconfigureAndRemember(notRestored);
+	if (!restored.empty()) {
+		Component::SafePointer<MainComponent> safeThis(this);
+		detectionVerification_ = std::make_unique<DetectionVerificationThread>(restored, [safeThis](DetectionCache::TSynthList failed) {
+			if (safeThis && !failed.empty()) {
+				safeThis->quickconfigureAndRemember(failed);
+			}
+		});
+		detectionVerification_->startThread();
+	}
+	StartupProfile::instance().phaseDone("Detection started");
+
+	// Feel free to request the globals page from the active synth
+	settingsView_->loadGlobals();
+
+	warmRecentDatabases();
+	StartupProfile::instance().phaseDone("Globals and recent databases");
+}
+
+void MainComponent::captureTrace()
+{
+	if (Tracer::enabled()) {
+		// A capture is already running and will ask for the file when done
+		return;
+	}
+	int seconds = Settings::instance().get("TraceCaptureSeconds", 10);
+	Tracer::instance().startCapture();
+	spdlog::info("Capturing a performance trace for the next {} seconds, please repeat what is slow", seconds);
+	Timer::callAfterDelay(seconds * 1000, []() {
+		Tracer::instance().stopCapture();
+		FileChooser traceChooser("Please choose where to save the trace, open it in chrome://tracing or Perfetto...",
+			File::getSpecialLocation(File::userDocumentsDirectory).getChildFile("KnobKraft-trace.json"), "*.json");
+		if (traceChooser.browseForFileToSave(true)) {
+			int events = Tracer::instance().exportChromeTrace(traceChooser.getResult());
+			if (events < 0) {
+				AlertWindow::showMessageBox(AlertWindow::WarningIcon, "Error saving trace", "Could not write the trace file " + traceChooser.getResult().getFullPathName());
+			}
+			else {
+				spdlog::info("Wrote {} trace events to {}", events, traceChooser.getResult().getFullPathName());
+			}
+		}
+	});
+}
+
+void MainComponent::warmRecentDatabases()
+{
+	// Oldest first, so the most recent file ends up first in the pool
+	for (int i = std::min(recentFiles_.getNumFiles(), kWarmRecentDatabases) - 1; i >= 0; i--) {
+		recentDatabases_.warm(recentFiles_.getFile(i));
+	}
+}
+
 #ifndef _DEBUG
 #ifdef USE_SENTRY
 void MainComponent::checkUserConsent()
@@ -842,7 +1115,7 @@ void MainComponent::crashTheSoftware()
 
 void MainComponent::setZoomFactor(float newZoomInPercentage) const {
 	Desktop::getInstance().setGlobalScaleFactor(newZoomInPercentage / globalScaling_);
-	Settings::instance().set("zoom", String(newZoomInPercentage).toStdString());
+	SettingsWriteQueue::instance().set("zoom", String(newZoomInPercentage).toStdString());
 }
 
 float MainComponent::calcAcceptableGlobalScaleFactor() {
@@ -883,15 +1156,50 @@ void MainComponent::resized()
 
 void MainComponent::shutdown()
 {
+	// No job must write to the database while it is closed
+	jobListPanel_.reset();
+	BackgroundJobs::shutdown();
 	// Shutdown database, which will make a backup
 	database_.reset();
 }
 
+void MainComponent::showJobList()
+{
+	int index = findIndexOfTabWithNameEnding(&mainTabs_, "Jobs");
+	if (index != -1) {
+		mainTabs_.setCurrentTabIndex(index, false);
+	}
+}
+
+bool MainComponent::noBackgroundJobsRunning() const
+{
+	if (BackgroundJobs::instance().hasActiveJobs()) {
+		AlertWindow::showMessageBox(AlertWindow::InfoIcon, "Background jobs running",
+			"There are still jobs working on the current database. Please wait for them to finish or cancel them in the Jobs tab first.");
+		return false;
+	}
+	return true;
+}
+
 std::string MainComponent::getDatabaseFileName() const
 {
 	return database_->getCurrentDatabaseFileName();
 }
 
+void MainComponent::quickconfigureAndRemember(DetectionCache::TSynthList synths)
+{
+	if (!synths.empty()) {
+		autodetector_.quickconfigure(synths);
+		for (auto const &synth : synths) {
+			if (synth->wasDetected()) {
+				DetectionCache::remember(*synth, nullptr);
+			}
+		}
+	}
+	// Refresh Setup View with the result of this
+	UIModel::instance()->currentSynth_.sendChangeMessage();
+}
+
 void MainComponent::refreshSynthList() {
 	std::vector<std::shared_ptr<ActiveListItem>> listItems;
 	std::vector<midikraft::PatchHolder> patchList;
@@ -943,17 +1251,30 @@ void MainComponent::refreshSynthList() {
 	patchList_.setPatches(patchList);
 }
 
-void MainComponent::changeListenerCallback(ChangeBroadcaster* source)
+void MainComponent::midiDevicesChanged(MidiDeviceWatcher::Changes const &changes)
 {
-	if (source == midikraft::MidiController::instance()) {
-		// Kick off a new quickconfigure, as the MIDI interface setup has changed and synth available will be different
-		auto synthList = UIModel::instance()->synthList_.activeSynths();
-		quickconfigreDebounce_.callDebounced([this, synthList]() {
-			auto myList = synthList;
-			autodetector_.quickconfigure(myList);
-			}, 2000);
+	// Kick off a new quickconfigure for the synths whose ports came or went. New ports might also be where the synths not found so far are
+	bool portsAdded = !changes.addedInputs.isEmpty() || !changes.addedOutputs.isEmpty();
+	for (auto const &synth : UIModel::instance()->synthList_.activeSynths()) {
+		if (changes.affects(synth->midiInput().name) || changes.affects(synth->midiOutput().name) || (portsAdded && !synth->wasDetected())) {
+			if (std::find(pendingRedetection_.begin(), pendingRedetection_.end(), synth) == pendingRedetection_.end()) {
+				pendingRedetection_.push_back(synth);
+			}
+		}
 	}
-	else if (source == &UIModel::instance()->synthList_) {
+	if (pendingRedetection_.empty()) {
+		return;
+	}
+	quickconfigreDebounce_.callDebounced([this]() {
+		auto synthList = std::move(pendingRedetection_);
+		pendingRedetection_.clear();
+		quickconfigureAndRemember(synthList);
+		}, 2000);
+}
+
+void MainComponent::changeListenerCallback(ChangeBroadcaster* source)
+{
+	if (source == &UIModel::instance()->synthList_) {
 		// A synth has been activated or deactivated - rebuild the whole list at the top
 		refreshSynthList();
 		resized();
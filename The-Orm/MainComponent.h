@@ -9,15 +9,18 @@
 #include <juce_gui_basics/juce_gui_basics.h>
 
 #include "LogView.h"
-#include "MidiLogView.h"
+#include "MidiTrafficLog.h"
 #include "PatchButtonGrid.h"
 #include "InsetBox.h"
 #include "DebounceTimer.h"
+#include "MidiDeviceWatcher.h"
 #include "SplitteredComponent.h"
 
 #include "PatchDatabase.h"
 #include "AutoDetection.h"
 #include "AutomaticCategory.h"
+#include "CategoryRuleSnapshot.h"
+#include "DetectionCache.h"
 #include "PropertyEditor.h"
 #include "SynthList.h"
 #include "LambdaMenuModel.h"
@@ -25,22 +28,27 @@
 #include "LambdaValueListener.h"
 #include "PatchPerSynthList.h"
 #include "PatchListTree.h"
+#include "RecentDatabasePool.h"
+#include "Metrics.h"
 
 #include "SecondaryWindow.h"
 
 #include "PatchView.h"
 #include "SettingsView.h"
+#include "JobListPanel.h"
 #include "KeyboardMacroView.h"
 #include "SetupView.h"
 #include "RecordingView.h"
 #include "BCR2000_Component.h"
 #include "AdaptationView.h"
+#include "AdaptationHotReload.h"
 
 #include <spdlog/logger.h>
 
 class LogViewLogger;
+class LogViewFeeder;
 
-class MainComponent : public Component, private ChangeListener
+class MainComponent : public Component, private ChangeListener, private MidiDeviceWatcher::Listener
 {
 public:
 	MainComponent(bool makeYourOwnSize);
@@ -49,6 +57,8 @@ public:
 	virtual void resized() override;
 
 	void shutdown();
+	// Called once the window is shown, starts what the library does not need: the macro tab, the synth detection and the globals request
+	void startDeferredInitialization();
 
 	std::string getDatabaseFileName() const; // This is only there to expose it to the MainApplication for the Window Title?
 
@@ -57,12 +67,19 @@ private:
 	void createNewDatabase();
 	void openDatabase();
 	void openDatabase(File &databaseFile);
+	void migrateThenOpen(File const &databaseFile);
+	// Opens the migrated database once no job runs on the current one anymore
+	void openMigratedWhenIdle();
 	void saveDatabaseAs();
 	static void exportDatabases();
 	void mergeDatabases();
 	PopupMenu recentFileMenu();
 	void recentFileSelected(int selected);
 	void persistRecentFileList();
+	void warmRecentDatabases();
+	void captureTrace();
+	void showJobList();
+	bool noBackgroundJobsRunning() const;
 #ifndef _DEBUG
 #ifdef USE_SENTRY
 	void checkUserConsent();
@@ -74,26 +91,36 @@ private:
     float calcAcceptableGlobalScaleFactor();
 	Colour getUIColour(LookAndFeel_V4::ColourScheme::UIColour colourToGet);
 	void refreshSynthList();
+	void quickconfigureAndRemember(DetectionCache::TSynthList synths);
 	static void aboutBox();
 
 	void openSecondMainWindow(bool fromSettings);
 	static std::unique_ptr<SecondaryMainWindow> sSecondMainWindow;
 
 	virtual void changeListenerCallback(ChangeBroadcaster* source) override;
+	void midiDevicesChanged(MidiDeviceWatcher::Changes const &changes) override;
 	
 	// Helper function because of JUCE API
 	static int findIndexOfTabWithNameEnding(TabbedComponent *mainTabs, String const &name);
 
 	std::unique_ptr<midikraft::PatchDatabase> database_;
 	std::shared_ptr<midikraft::AutomaticCategory> automaticCategories_;
+	CategoryRuleSnapshot categoryRulesAtStart_; // What the patches of the database were categorized with, as far as we know
 	RecentlyOpenedFilesList recentFiles_;
+	static constexpr int kWarmRecentDatabases = 3;
+	static constexpr size_t kLogRecordCapacity = 5000;
+	RecentDatabasePool recentDatabases_; // Keeps the first entries of the recent files ready for switching
+	File migrating_; // The database of an older version brought up to date in the background, to be opened when done
+	static constexpr int kRetryOpenMs = 500;
 	midikraft::AutoDetection autodetector_;
+	std::unique_ptr<DetectionVerificationThread> detectionVerification_;
 
 	// For display size support. This will be filled before we modify any global scales
 	float globalScaling_;
 
 	// For kicking off new quickconfigures automatically
 	DebounceTimer quickconfigreDebounce_;
+	DetectionCache::TSynthList pendingRedetection_; // Collected over the changes of the MIDI devices until the debounce fires
 
 	// The infrastructure for the menu and the short cut keys
 	std::unique_ptr<LambdaMenuModel> menuModel_;
@@ -108,9 +135,12 @@ private:
 	std::unique_ptr<PatchView> patchView_;
 	std::unique_ptr<KeyboardMacroView> keyboardView_;
 	std::unique_ptr<SplitteredComponent> splitter_;
-	MidiLogView midiLogView_;
+	MidiTrafficLog midiLogView_;
+	MidiPortMetrics midiPortMetrics_;
 	knobkraft::AdaptationView adaptationView_;
+	AdaptationHotReload adaptationHotReload_;
 	InsetBox midiLogArea_;
+	std::unique_ptr<JobListPanel> jobListPanel_;
 	std::unique_ptr<SettingsView> settingsView_;
 	std::unique_ptr<SetupView> setupView_;
 	std::unique_ptr<LogViewLogger> logger_;
@@ -120,6 +150,7 @@ private:
 	InsetBox logArea_;
 
 	std::shared_ptr<spdlog::logger> spdLogger_;
+	std::unique_ptr<LogViewFeeder> logFeeder_;
 
 	ListenerSet listeners_;
 
@@ -0,0 +1,150 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "MemoryReport.h"
+
+#include "Metrics.h"
+#include "UIModel.h"
+
+#include "GenericAdaptation.h"
+#include "GenericPatch.h"
+
+#include <pybind11/embed.h>
+#include <sqlite3.h>
+
+#include <fmt/format.h>
+
+#include <vector>
+
+namespace py = pybind11;
+
+MemoryReport &MemoryReport::instance()
+{
+	static MemoryReport report;
+	return report;
+}
+
+MemoryReport::MemoryReport()
+{
+	addProvider("generic_patches", []() {
+		return Usage{ knobkraft::GenericPatch::liveBytes(), knobkraft::GenericPatch::liveInstances() };
+	});
+	addProvider("adaptation_result_cache", []() {
+		Usage usage;
+		for (auto &synth : UIModel::instance()->synthList_.allSynths()) {
+			if (auto adaptation = std::dynamic_pointer_cast<knobkraft::GenericAdaptation>(synth.synth())) {
+				size_t entries = 0;
+				usage.bytes += adaptation->resultCache().memoryUsage(entries);
+				usage.objects += entries;
+			}
+		}
+		return usage;
+	});
+	addProvider("sqlite", []() {
+		// All connections of the process, including their page caches
+		return Usage{ (size_t) sqlite3_memory_used(), 0 };
+	});
+	addProvider("python", []() {
+		// Python does not tell the bytes without tracemalloc, the allocated blocks are the best cheap indicator
+		Usage usage;
+		if (knobkraft::GenericAdaptation::hasPython()) {
+			py::gil_scoped_acquire acquire;
+			try {
+				usage.objects = py::module::import("sys").attr("getallocatedblocks")().cast<size_t>();
+			}
+			catch (py::error_already_set &) {
+			}
+		}
+		return usage;
+	}, false);
+}
+
+int MemoryReport::addProvider(std::string const &subsystem, TProvider provider, bool bytesKnown)
+{
+	bool newSubsystem = false;
+	int handle;
+	{
+		std::lock_guard<std::mutex> lock(lock_);
+		handle = nextHandle_++;
+		providers_[handle] = { subsystem, std::move(provider) };
+		newSubsystem = subsystems_.emplace(subsystem, bytesKnown).second;
+	}
+	if (newSubsystem) {
+		if (bytesKnown) {
+			Metrics::instance().setGauge(fmt::format("memory.{}_kb", subsystem), [this, subsystem]() {
+				return (double) usageOf(subsystem).bytes / 1024.0;
+			});
+		}
+		else {
+			Metrics::instance().setGauge(fmt::format("memory.{}.objects", subsystem), [this, subsystem]() {
+				return (double) usageOf(subsystem).objects;
+			});
+		}
+	}
+	return handle;
+}
+
+void MemoryReport::removeProvider(int handle)
+{
+	std::lock_guard<std::mutex> lock(lock_);
+	providers_.erase(handle);
+}
+
+MemoryReport::Usage MemoryReport::usageOf(std::string const &subsystem) const
+{
+	std::vector<TProvider> providers;
+	{
+		std::lock_guard<std::mutex> lock(lock_);
+		for (auto const &provider : providers_) {
+			if (provider.second.subsystem == subsystem) {
+				providers.push_back(provider.second.provider);
+			}
+		}
+	}
+	Usage total;
+	for (auto const &provider : providers) {
+		auto usage = provider();
+		total.bytes += usage.bytes;
+		total.objects += usage.objects;
+	}
+	return total;
+}
+
+std::map<std::string, MemoryReport::Usage> MemoryReport::bySubsystem() const
+{
+	std::map<std::string, bool> subsystems;
+	{
+		std::lock_guard<std::mutex> lock(lock_);
+		subsystems = subsystems_;
+	}
+	std::map<std::string, Usage> result;
+	for (auto const &subsystem : subsystems) {
+		result[subsystem.first] = usageOf(subsystem.first);
+	}
+	return result;
+}
+
+std::string MemoryReport::report() const
+{
+	std::string result = "Memory report, estimated payloads without allocator overhead:\n";
+	std::map<std::string, bool> bytesKnown;
+	{
+		std::lock_guard<std::mutex> lock(lock_);
+		bytesKnown = subsystems_;
+	}
+	size_t totalBytes = 0;
+	for (auto const &subsystem : bySubsystem()) {
+		if (bytesKnown[subsystem.first]) {
+			result += fmt::format("{}: {} objects, {:.1f} KB\n", subsystem.first, subsystem.second.objects, (double) subsystem.second.bytes / 1024.0);
+			totalBytes += subsystem.second.bytes;
+		}
+		else {
+			result += fmt::format("{}: {} objects, size unknown\n", subsystem.first, subsystem.second.objects);
+		}
+	}
+	result += fmt::format("Total: {:.1f} MB\n", (double) totalBytes / (1024.0 * 1024.0));
+	return result;
+}
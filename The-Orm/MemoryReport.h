@@ -0,0 +1,51 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+
+// Where the memory of a big session goes, by subsystem. The owners of memory register providers reporting what they currently hold,
+// providers of the same subsystem add up. These are estimates of the payloads, allocator overhead is not included.
+// Every subsystem shows up in the Metrics panel as memory.<subsystem>_kb, or as memory.<subsystem>.objects if only objects can be counted.
+class MemoryReport {
+public:
+	struct Usage {
+		size_t bytes = 0;
+		size_t objects = 0;
+	};
+	typedef std::function<Usage()> TProvider;
+
+	static MemoryReport &instance();
+
+	// Returns the handle to remove the provider again. The first provider of a subsystem decides whether its bytes are known
+	int addProvider(std::string const &subsystem, TProvider provider, bool bytesKnown = true);
+	void removeProvider(int handle);
+
+	// Evaluates the providers, call on the message thread
+	std::map<std::string, Usage> bySubsystem() const;
+	std::string report() const;
+
+private:
+	MemoryReport();
+
+	Usage usageOf(std::string const &subsystem) const;
+
+	struct Provider {
+		std::string subsystem;
+		TProvider provider;
+	};
+
+	mutable std::mutex lock_;
+	std::map<int, Provider> providers_;
+	std::map<std::string, bool> subsystems_; // Whether the bytes are known, registered with the Metrics on first use
+	int nextHandle_ = 1;
+};
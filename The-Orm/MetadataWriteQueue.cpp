@@ -0,0 +1,99 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "MetadataWriteQueue.h"
+
+#include <spdlog/spdlog.h>
+#include "SpdLogJuce.h"
+
+MetadataWriteQueue::MetadataWriteQueue(midikraft::PatchDatabase &database, std::function<void()> onWritten, TFailedHandler onFailed) :
+	Thread("MetadataWriteQueue"), database_(database), onWritten_(onWritten), onFailed_(onFailed)
+{
+	startThread();
+}
+
+MetadataWriteQueue::~MetadataWriteQueue()
+{
+	signalThreadShouldExit();
+	editAvailable_.signal();
+	stopThread(5000);
+	// Nothing gets lost on shutdown
+	writePending();
+}
+
+void MetadataWriteQueue::put(midikraft::PatchHolder const &patch)
+{
+	if (!patch.synth()) {
+		return;
+	}
+	{
+		ScopedLock lock(queueLock_);
+		pending_[patch.synth()->getName() + ":" + patch.md5()] = patch;
+	}
+	editAvailable_.signal();
+}
+
+void MetadataWriteQueue::put(std::vector<midikraft::PatchHolder> const &patches)
+{
+	{
+		ScopedLock lock(queueLock_);
+		for (auto const &patch : patches) {
+			if (patch.synth()) {
+				pending_[patch.synth()->getName() + ":" + patch.md5()] = patch;
+			}
+		}
+	}
+	editAvailable_.signal();
+}
+
+void MetadataWriteQueue::flush()
+{
+	writePending();
+}
+
+void MetadataWriteQueue::run()
+{
+	while (!threadShouldExit()) {
+		if (!editAvailable_.wait(1000)) {
+			continue;
+		}
+		// Let more clicks come in, the last one of each patch wins
+		wait(kCoalesceMs);
+		writePending();
+	}
+}
+
+void MetadataWriteQueue::writePending()
+{
+	ScopedLock writing(writeLock_);
+	std::map<std::string, midikraft::PatchHolder> edits;
+	{
+		ScopedLock lock(queueLock_);
+		edits.swap(pending_);
+	}
+	std::vector<midikraft::PatchHolder> failed;
+	for (auto &edit : edits) {
+		try {
+			database_.putPatch(edit.second);
+		}
+		catch (std::exception &e) {
+			// Nobody up the stack of this thread could handle it, and the other edits should still go in
+			spdlog::error("Failed to store the changes of patch {}: {}", edit.second.name(), e.what());
+			failed.push_back(edit.second);
+		}
+	}
+	if (edits.size() > 1) {
+		spdlog::debug("Stored the changes of {} patches", edits.size() - failed.size());
+	}
+	if (!edits.empty() && onWritten_) {
+		MessageManager::callAsync(onWritten_);
+	}
+	if (!failed.empty() && onFailed_) {
+		MessageManager::callAsync([onFailed = onFailed_, failed]() {
+			onFailed(failed);
+		});
+	}
+}
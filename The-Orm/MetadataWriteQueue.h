@@ -0,0 +1,52 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include "PatchDatabase.h"
+#include "PatchHolder.h"
+
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+// Stores edits of the favorite, hidden, categories or name of patches on a background thread, so clicking through the
+// category buttons never waits for the disk. Edits are collected for a moment, and only the last state of each patch is written.
+// The UI shows the edit right away, the database catches up shortly after. Whoever filters by these flags learns through
+// onWritten, called on the message thread after each write, when a query sees the new state. Patches the database refused are
+// logged and handed to onFailed on the message thread, the grid then shows what is stored instead of the edit.
+class MetadataWriteQueue : private Thread {
+public:
+	typedef std::function<void(std::vector<midikraft::PatchHolder> const &failed)> TFailedHandler;
+
+	explicit MetadataWriteQueue(midikraft::PatchDatabase &database, std::function<void()> onWritten = {}, TFailedHandler onFailed = {});
+	~MetadataWriteQueue() override;
+
+	// Message thread. Replaces a pending edit of the same patch not written yet
+	void put(midikraft::PatchHolder const &patch);
+	// The same for the edit of many patches at once, they all go into the next write
+	void put(std::vector<midikraft::PatchHolder> const &patches);
+	// Writes everything pending before returning, e.g. before another database file is opened
+	void flush();
+
+	// How long edits are collected before they are written
+	static constexpr int kCoalesceMs = 300;
+
+private:
+	void run() override;
+	void writePending();
+
+	midikraft::PatchDatabase &database_;
+	std::function<void()> onWritten_;
+	TFailedHandler onFailed_;
+	CriticalSection queueLock_;
+	std::map<std::string, midikraft::PatchHolder> pending_; // Keyed by synth and md5
+	CriticalSection writeLock_; // Held while writing, so flush() can wait for a write in progress
+	WaitableEvent editAvailable_;
+};
@@ -0,0 +1,166 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "Metrics.h"
+
+#include "Tracer.h"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <cmath>
+#include <string_view>
+
+void Metrics::Histogram::record(int64 micros)
+{
+	size_t bucket = 0;
+	uint64 value = micros > 1 ? (uint64) micros : 1;
+	while (value > 1 && bucket + 1 < kBuckets) {
+		value >>= 1;
+		bucket++;
+	}
+	buckets_[bucket].fetch_add(1, std::memory_order_relaxed);
+	sumMicros_.fetch_add(micros > 0 ? (uint64) micros : 0, std::memory_order_relaxed);
+	count_.fetch_add(1, std::memory_order_relaxed);
+}
+
+double Metrics::Histogram::meanMilliseconds() const
+{
+	auto n = count();
+	return n > 0 ? (double) sumMicros_.load(std::memory_order_relaxed) / (double) n / 1000.0 : 0.0;
+}
+
+double Metrics::Histogram::percentileMilliseconds(double percentile) const
+{
+	// The buckets are read one by one while others might record, good enough for monitoring
+	uint64 total = 0;
+	for (auto const &bucket : buckets_) {
+		total += bucket.load(std::memory_order_relaxed);
+	}
+	if (total == 0) {
+		return 0.0;
+	}
+	auto target = (uint64) std::ceil(percentile * (double) total);
+	uint64 seen = 0;
+	for (size_t i = 0; i < kBuckets; i++) {
+		seen += buckets_[i].load(std::memory_order_relaxed);
+		if (seen >= target) {
+			return (double) (uint64(1) << (i + 1)) / 1000.0;
+		}
+	}
+	return (double) (uint64(1) << kBuckets) / 1000.0;
+}
+
+Metrics &Metrics::instance()
+{
+	static Metrics metrics;
+	return metrics;
+}
+
+Metrics::Counter &Metrics::counter(std::string const &name)
+{
+	std::lock_guard<std::mutex> lock(lock_);
+	auto &entry = counters_[name];
+	if (!entry) {
+		entry = std::make_unique<Counter>();
+	}
+	return *entry;
+}
+
+Metrics::Histogram &Metrics::histogram(std::string const &name)
+{
+	std::lock_guard<std::mutex> lock(lock_);
+	auto &entry = histograms_[name];
+	if (!entry) {
+		entry = std::make_unique<Histogram>();
+	}
+	return *entry;
+}
+
+void Metrics::setGauge(std::string const &name, TGauge gauge)
+{
+	std::lock_guard<std::mutex> lock(lock_);
+	gauges_[name] = std::move(gauge);
+}
+
+void Metrics::removeGauge(std::string const &name)
+{
+	std::lock_guard<std::mutex> lock(lock_);
+	gauges_.erase(name);
+}
+
+std::vector<Metrics::Sample> Metrics::snapshot() const
+{
+	std::vector<Sample> result;
+	std::map<std::string, TGauge> gauges;
+	{
+		std::lock_guard<std::mutex> lock(lock_);
+		for (auto const &counter : counters_) {
+			result.push_back({ counter.first, Sample::Kind::Counter, (double) counter.second->value() });
+		}
+		for (auto const &histogram : histograms_) {
+			auto const &h = *histogram.second;
+			result.push_back({ histogram.first, Sample::Kind::Histogram, (double) h.count(), h.meanMilliseconds(), h.percentileMilliseconds(0.5), h.percentileMilliseconds(0.99) });
+		}
+		gauges = gauges_;
+	}
+	// Outside of the lock, a gauge might look up a counter
+	for (auto const &gauge : gauges) {
+		result.push_back({ gauge.first, Sample::Kind::Gauge, gauge.second() });
+	}
+	std::sort(result.begin(), result.end(), [](Sample const &a, Sample const &b) { return a.name < b.name; });
+	return result;
+}
+
+std::string Metrics::summary() const
+{
+	std::string result;
+	for (auto const &sample : snapshot()) {
+		switch (sample.kind) {
+		case Sample::Kind::Counter:
+			result += fmt::format("{}: {:.0f}\n", sample.name, sample.value);
+			break;
+		case Sample::Kind::Histogram:
+			result += fmt::format("{}: {:.0f} calls, mean {:.3f} ms, p50 {:.3f} ms, p99 {:.3f} ms\n", sample.name, sample.value, sample.meanMs, sample.p50Ms, sample.p99Ms);
+			break;
+		case Sample::Kind::Gauge:
+			result += fmt::format("{}: {:.2f}\n", sample.name, sample.value);
+			break;
+		}
+	}
+	return result;
+}
+
+MetricsTimer::MetricsTimer(Metrics::Histogram &histogram) : histogram_(histogram), startMicros_(Tracer::nowMicros())
+{
+}
+
+MetricsTimer::~MetricsTimer()
+{
+	histogram_.record(Tracer::nowMicros() - startMicros_);
+}
+
+void MidiPortMetrics::record(MidiMessage const &message, String const &source, bool isOut)
+{
+	std::lock_guard<std::mutex> lock(lock_);
+	auto key = std::make_pair(source, isOut);
+	auto found = ports_.find(key);
+	if (found == ports_.end()) {
+		auto prefix = fmt::format("midi.{}.{}", isOut ? "out" : "in", source.toStdString());
+		auto &metrics = Metrics::instance();
+		found = ports_.emplace(key, Port{ &metrics.counter(prefix + ".messages"), &metrics.counter(prefix + ".bytes"), isOut ? nullptr : &metrics.counter(prefix + ".duplicates") }).first;
+	}
+	auto &port = found->second;
+	port.messages->add();
+	port.bytes->add((uint64) message.getRawDataSize());
+	if (!isOut && message.isSysEx()) {
+		auto hash = std::hash<std::string_view>()(std::string_view((char const *) message.getRawData(), (size_t) message.getRawDataSize()));
+		if (hash == port.lastSysexHash) {
+			port.duplicates->add();
+		}
+		port.lastSysexHash = hash;
+	}
+}
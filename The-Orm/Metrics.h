@@ -0,0 +1,114 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include <array>
+#include <atomic>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Always-on counters for monitoring long running sessions, complementing the Tracer which only records while a capture runs.
+// Instruments are created by name on first use and live until the end of the process, so call sites may keep the reference.
+// Updating a counter or a histogram is a relaxed atomic add, looking one up by name takes a short lock.
+class Metrics {
+public:
+	class Counter {
+	public:
+		void add(uint64 delta = 1) { value_.fetch_add(delta, std::memory_order_relaxed); }
+		uint64 value() const { return value_.load(std::memory_order_relaxed); }
+
+	private:
+		std::atomic<uint64> value_{ 0 };
+	};
+
+	// Latencies in power of two buckets of microseconds, from 1 us to about 9 hours
+	class Histogram {
+	public:
+		void record(int64 micros);
+		uint64 count() const { return count_.load(std::memory_order_relaxed); }
+		double meanMilliseconds() const;
+		// The upper bound of the bucket the percentile falls into, so this is accurate to a factor of two
+		double percentileMilliseconds(double percentile) const;
+
+	private:
+		static constexpr size_t kBuckets = 36;
+		std::array<std::atomic<uint64>, kBuckets> buckets_{};
+		std::atomic<uint64> count_{ 0 };
+		std::atomic<uint64> sumMicros_{ 0 };
+	};
+
+	// Evaluated on the message thread whenever a snapshot is taken
+	typedef std::function<double()> TGauge;
+
+	struct Sample {
+		enum class Kind { Counter, Histogram, Gauge };
+		std::string name;
+		Kind kind;
+		double value; // Counter value, histogram count or gauge value
+		double meanMs = 0.0;
+		double p50Ms = 0.0;
+		double p99Ms = 0.0;
+	};
+
+	static Metrics &instance();
+
+	Counter &counter(std::string const &name);
+	Histogram &histogram(std::string const &name);
+	void setGauge(std::string const &name, TGauge gauge);
+	void removeGauge(std::string const &name);
+
+	// All instruments sorted by name
+	std::vector<Sample> snapshot() const;
+	// One line per instrument, for the log
+	std::string summary() const;
+
+private:
+	Metrics() = default;
+
+	mutable std::mutex lock_;
+	std::map<std::string, std::unique_ptr<Counter>> counters_;
+	std::map<std::string, std::unique_ptr<Histogram>> histograms_;
+	std::map<std::string, TGauge> gauges_;
+};
+
+// Records the lifetime of the scope into a histogram
+class MetricsTimer {
+public:
+	explicit MetricsTimer(Metrics::Histogram &histogram);
+	~MetricsTimer();
+
+	MetricsTimer(MetricsTimer const &) = delete;
+	MetricsTimer &operator=(MetricsTimer const &) = delete;
+
+private:
+	Metrics::Histogram &histogram_;
+	int64 startMicros_;
+};
+
+// Counts MIDI messages and bytes per port and direction. A sysex message arriving twice in a row on the same port is counted as
+// duplicate, which usually means a loop or a retransmission. Thread safe, called for every MIDI message in and out.
+class MidiPortMetrics {
+public:
+	void record(MidiMessage const &message, String const &source, bool isOut);
+
+private:
+	struct Port {
+		Metrics::Counter *messages;
+		Metrics::Counter *bytes;
+		Metrics::Counter *duplicates; // Incoming only
+		size_t lastSysexHash = 0;
+	};
+
+	std::mutex lock_;
+	std::map<std::pair<String, bool>, Port> ports_;
+};
@@ -0,0 +1,126 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "MetricsPanel.h"
+
+#include "Settings.h"
+
+#include <fmt/format.h>
+#include <spdlog/spdlog.h>
+
+namespace {
+
+	const std::string kMetricsLogSetting{ "MetricsLogPeriodically" };
+
+	constexpr int kRefreshIntervalMs = 1000;
+	constexpr double kLogIntervalMs = 60000.0;
+
+}
+
+MetricsPanel::MetricsPanel()
+{
+	title_.setText("Performance counters", dontSendNotification);
+	addAndMakeVisible(title_);
+
+	auto &header = table_.getHeader();
+	header.addColumn("Counter", NAME, 220);
+	header.addColumn("Value", VALUE, 80);
+	header.addColumn("Per second", RATE, 80);
+	header.addColumn("Mean ms", MEAN, 70);
+	header.addColumn("p50 ms", P50, 60);
+	header.addColumn("p99 ms", P99, 60);
+	table_.setModel(this);
+	addAndMakeVisible(table_);
+
+	logPeriodically_.setButtonText("Write counters to the log every minute");
+	logPeriodically_.setToggleState(Settings::instance().get(kMetricsLogSetting, "0") == "1", dontSendNotification);
+	logPeriodically_.onClick = [this]() {
+		Settings::instance().set(kMetricsLogSetting, logPeriodically_.getToggleState() ? "1" : "0");
+	};
+	addAndMakeVisible(logPeriodically_);
+
+	previousRefreshMs_ = lastDumpMs_ = Time::getMillisecondCounterHiRes();
+	startTimer(kRefreshIntervalMs);
+}
+
+MetricsPanel::~MetricsPanel()
+{
+	stopTimer();
+}
+
+void MetricsPanel::resized()
+{
+	auto area = getLocalBounds();
+	title_.setBounds(area.removeFromTop(24));
+	logPeriodically_.setBounds(area.removeFromBottom(28));
+	table_.setBounds(area);
+}
+
+int MetricsPanel::getNumRows()
+{
+	return (int) samples_.size();
+}
+
+void MetricsPanel::paintRowBackground(Graphics &g, int rowNumber, int width, int height, bool rowIsSelected)
+{
+	ignoreUnused(width, height);
+	auto &lookAndFeel = LookAndFeel::getDefaultLookAndFeel();
+	if (rowIsSelected) {
+		g.fillAll(lookAndFeel.findColour(TextEditor::highlightColourId));
+	}
+	else if (rowNumber % 2) {
+		g.fillAll(lookAndFeel.findColour(ListBox::backgroundColourId).interpolatedWith(lookAndFeel.findColour(ListBox::textColourId), 0.03f));
+	}
+}
+
+void MetricsPanel::paintCell(Graphics &g, int rowNumber, int columnId, int width, int height, bool rowIsSelected)
+{
+	ignoreUnused(rowIsSelected);
+	if (rowNumber < 0 || rowNumber >= (int) samples_.size()) return;
+	auto const &sample = samples_[(size_t) rowNumber];
+	bool histogram = sample.kind == Metrics::Sample::Kind::Histogram;
+	std::string text;
+	switch (columnId) {
+	case NAME: text = sample.name; break;
+	case VALUE: text = sample.kind == Metrics::Sample::Kind::Gauge ? fmt::format("{:.2f}", sample.value) : fmt::format("{:.0f}", sample.value); break;
+	case RATE: text = sample.kind == Metrics::Sample::Kind::Gauge ? "" : fmt::format("{:.1f}", rates_[(size_t) rowNumber]); break;
+	case MEAN: text = histogram ? fmt::format("{:.3f}", sample.meanMs) : ""; break;
+	case P50: text = histogram ? fmt::format("{:.3f}", sample.p50Ms) : ""; break;
+	case P99: text = histogram ? fmt::format("{:.3f}", sample.p99Ms) : ""; break;
+	default: break;
+	}
+	g.setColour(LookAndFeel::getDefaultLookAndFeel().findColour(ListBox::textColourId));
+	g.drawText(text, 2, 0, width - 4, height, columnId == NAME ? Justification::centredLeft : Justification::centredRight, true);
+}
+
+void MetricsPanel::timerCallback()
+{
+	auto now = Time::getMillisecondCounterHiRes();
+	if (logPeriodically_.getToggleState() && now - lastDumpMs_ >= kLogIntervalMs) {
+		lastDumpMs_ = now;
+		spdlog::info("Performance counters:\n{}", Metrics::instance().summary());
+	}
+	if (isShowing()) {
+		refresh();
+	}
+}
+
+void MetricsPanel::refresh()
+{
+	auto now = Time::getMillisecondCounterHiRes();
+	double seconds = std::max(0.001, (now - previousRefreshMs_) / 1000.0);
+	previousRefreshMs_ = now;
+
+	samples_ = Metrics::instance().snapshot();
+	rates_.clear();
+	for (auto const &sample : samples_) {
+		auto previous = previousValues_.find(sample.name);
+		rates_.push_back(previous != previousValues_.end() ? std::max(0.0, sample.value - previous->second) / seconds : 0.0);
+		previousValues_[sample.name] = sample.value;
+	}
+	table_.updateContent();
+	table_.repaint();
+}
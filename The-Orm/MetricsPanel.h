@@ -0,0 +1,52 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include "Metrics.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+// Live table of the Metrics registry, with rates per second for counters and histograms. Optionally writes a summary to the
+// log every minute, also while the panel is not visible.
+class MetricsPanel : public Component, private TableListBoxModel, private Timer {
+public:
+	MetricsPanel();
+	~MetricsPanel() override;
+
+	void resized() override;
+
+private:
+	enum Columns {
+		NAME = 1,
+		VALUE,
+		RATE,
+		MEAN,
+		P50,
+		P99
+	};
+
+	int getNumRows() override;
+	void paintRowBackground(Graphics &g, int rowNumber, int width, int height, bool rowIsSelected) override;
+	void paintCell(Graphics &g, int rowNumber, int columnId, int width, int height, bool rowIsSelected) override;
+	void timerCallback() override;
+
+	void refresh();
+
+	std::vector<Metrics::Sample> samples_;
+	std::vector<double> rates_;
+	std::map<std::string, double> previousValues_;
+	double previousRefreshMs_ = 0.0;
+	double lastDumpMs_ = 0.0;
+
+	Label title_;
+	TableListBox table_;
+	ToggleButton logPeriodically_;
+};
@@ -0,0 +1,152 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "MidiDeviceWatcher.h"
+
+#include "MidiController.h"
+#include "Metrics.h"
+
+#include <spdlog/spdlog.h>
+#include "SpdLogJuce.h"
+
+std::unique_ptr<MidiDeviceWatcher> MidiDeviceWatcher::sInstance_;
+
+bool MidiDeviceWatcher::Changes::inputsChanged() const
+{
+	return !addedInputs.isEmpty() || !removedInputs.isEmpty();
+}
+
+bool MidiDeviceWatcher::Changes::outputsChanged() const
+{
+	return !addedOutputs.isEmpty() || !removedOutputs.isEmpty();
+}
+
+bool MidiDeviceWatcher::Changes::affects(String const &portName) const
+{
+	return addedInputs.contains(portName) || removedInputs.contains(portName) || addedOutputs.contains(portName) || removedOutputs.contains(portName);
+}
+
+MidiDeviceWatcher::MidiDeviceWatcher() : Thread("MIDI device watcher"), alive_(std::make_shared<bool>(true))
+{
+	midikraft::MidiController::instance()->addChangeListener(this);
+	startThread(3);
+}
+
+MidiDeviceWatcher::~MidiDeviceWatcher()
+{
+	midikraft::MidiController::instance()->removeChangeListener(this);
+	signalThreadShouldExit();
+	notify();
+	stopThread(2000);
+}
+
+MidiDeviceWatcher &MidiDeviceWatcher::instance()
+{
+	if (!sInstance_) {
+		sInstance_.reset(new MidiDeviceWatcher());
+	}
+	return *sInstance_;
+}
+
+void MidiDeviceWatcher::shutdown()
+{
+	sInstance_.reset();
+}
+
+void MidiDeviceWatcher::addListener(Listener *listener)
+{
+	listeners_.add(listener);
+}
+
+void MidiDeviceWatcher::removeListener(Listener *listener)
+{
+	listeners_.remove(listener);
+}
+
+bool MidiDeviceWatcher::hasListed() const
+{
+	return listed_;
+}
+
+Array<MidiDeviceInfo> MidiDeviceWatcher::inputs() const
+{
+	return inputs_;
+}
+
+Array<MidiDeviceInfo> MidiDeviceWatcher::outputs() const
+{
+	return outputs_;
+}
+
+void MidiDeviceWatcher::changeListenerCallback(ChangeBroadcaster *source)
+{
+	ignoreUnused(source);
+	lastRequest_ = Time::getMillisecondCounter();
+	requested_ = true;
+	notify();
+}
+
+void MidiDeviceWatcher::run()
+{
+	bool first = true;
+	while (!threadShouldExit()) {
+		if (!requested_) {
+			wait(-1);
+			continue;
+		}
+		// Wait for the burst of change messages to end
+		auto quietFor = Time::getMillisecondCounter() - lastRequest_;
+		if (!first && quietFor < (uint32) kQuietMs) {
+			wait(kQuietMs - (int) quietFor);
+			continue;
+		}
+		requested_ = false;
+
+		Changes changes;
+		{
+			MetricsTimer timer(Metrics::instance().histogram("midi.device_listing"));
+			changes.inputs = MidiInput::getAvailableDevices();
+			changes.outputs = MidiOutput::getAvailableDevices();
+		}
+		changes.addedInputs = difference(changes.inputs, lastInputs_);
+		changes.removedInputs = difference(lastInputs_, changes.inputs);
+		changes.addedOutputs = difference(changes.outputs, lastOutputs_);
+		changes.removedOutputs = difference(lastOutputs_, changes.outputs);
+		lastInputs_ = changes.inputs;
+		lastOutputs_ = changes.outputs;
+		if (!first && !changes.inputsChanged() && !changes.outputsChanged()) {
+			continue;
+		}
+		bool initial = first;
+		first = false;
+
+		std::weak_ptr<bool> alive = alive_;
+		MessageManager::callAsync([this, alive, changes, initial]() {
+			if (alive.expired()) {
+				return;
+			}
+			inputs_ = changes.inputs;
+			outputs_ = changes.outputs;
+			listed_ = true;
+			if (!initial) {
+				spdlog::debug("MIDI devices changed: {} inputs and {} outputs added, {} inputs and {} outputs removed",
+					changes.addedInputs.size(), changes.addedOutputs.size(), changes.removedInputs.size(), changes.removedOutputs.size());
+				listeners_.call([&changes](Listener &listener) { listener.midiDevicesChanged(changes); });
+			}
+		});
+	}
+}
+
+StringArray MidiDeviceWatcher::difference(Array<MidiDeviceInfo> const &from, Array<MidiDeviceInfo> const &without)
+{
+	StringArray result;
+	for (auto const &device : from) {
+		if (!without.contains(device)) {
+			result.add(device.name);
+		}
+	}
+	return result;
+}
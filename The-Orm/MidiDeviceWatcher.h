@@ -0,0 +1,79 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+// Lists the MIDI devices on a background thread whenever the MidiController reports a change, and tells the listeners
+// only which ports actually came or went. With many virtual ports a listing takes long, and plugging in an interface
+// can cause a burst of change messages, so a new listing starts only once they have stopped for a moment.
+class MidiDeviceWatcher : private ChangeListener, private Thread {
+public:
+	struct Changes {
+		Array<MidiDeviceInfo> inputs; // All present now
+		Array<MidiDeviceInfo> outputs;
+		StringArray addedInputs; // Names
+		StringArray removedInputs;
+		StringArray addedOutputs;
+		StringArray removedOutputs;
+
+		bool inputsChanged() const;
+		bool outputsChanged() const;
+		// True if the port with this name came or went
+		bool affects(String const &portName) const;
+	};
+
+	class Listener {
+	public:
+		virtual ~Listener() = default;
+		// Called on the message thread, only when something changed
+		virtual void midiDevicesChanged(Changes const &changes) = 0;
+	};
+
+	~MidiDeviceWatcher() override;
+
+	// Call on the message thread
+	static MidiDeviceWatcher &instance();
+	static void shutdown();
+
+	void addListener(Listener *listener);
+	void removeListener(Listener *listener);
+
+	// The devices of the last listing, to be used on the message thread instead of listing them again
+	bool hasListed() const;
+	Array<MidiDeviceInfo> inputs() const;
+	Array<MidiDeviceInfo> outputs() const;
+
+	static constexpr int kQuietMs = 500;
+
+private:
+	MidiDeviceWatcher();
+
+	void changeListenerCallback(ChangeBroadcaster *source) override;
+	void run() override;
+	static StringArray difference(Array<MidiDeviceInfo> const &from, Array<MidiDeviceInfo> const &without);
+
+	ListenerList<Listener> listeners_;
+	std::atomic<uint32> lastRequest_ { 0 };
+	std::atomic<bool> requested_ { true }; // The first listing is done right away
+
+	// Message thread only
+	bool listed_ = false;
+	Array<MidiDeviceInfo> inputs_;
+	Array<MidiDeviceInfo> outputs_;
+
+	// Listing thread only
+	Array<MidiDeviceInfo> lastInputs_;
+	Array<MidiDeviceInfo> lastOutputs_;
+
+	std::shared_ptr<bool> alive_; // Posted results check this, so they don't touch us after destruction
+	static std::unique_ptr<MidiDeviceWatcher> sInstance_;
+};
@@ -0,0 +1,171 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "MidiOutputScheduler.h"
+
+#include "MidiController.h"
+
+#include <algorithm>
+#include <functional>
+
+CriticalSection MidiOutputScheduler::sRegistryLock_;
+std::map<String, std::shared_ptr<MidiOutputScheduler>> MidiOutputScheduler::sSchedulers_;
+
+namespace {
+	// Upper limit for a sleep, so new messages sent "now" are never delayed by much even if a wake up was missed
+	constexpr int kMaxIdleWaitMs = 5;
+}
+
+MidiOutputScheduler::Producer::Producer(std::weak_ptr<MidiOutputScheduler> scheduler, Lane lane, int capacity) :
+	scheduler_(scheduler), lane_(lane), fifo_(capacity), entries_((size_t)capacity)
+{
+}
+
+bool MidiOutputScheduler::Producer::enqueue(MidiMessage const &message, double when)
+{
+	auto scheduler = scheduler_.lock();
+	if (!scheduler) {
+		return false;
+	}
+	int start1, size1, start2, size2;
+	fifo_.prepareToWrite(1, start1, size1, start2, size2);
+	if (size1 + size2 < 1) {
+		return false;
+	}
+	int slot = size1 > 0 ? start1 : start2;
+	entries_[(size_t)slot] = { message, when };
+	fifo_.finishedWrite(1);
+	scheduler->wakeUp_.signal();
+	return true;
+}
+
+MidiOutputScheduler::MidiOutputScheduler(juce::MidiDeviceInfo const &output) :
+	Thread("MIDI out " + output.name), output_(output)
+{
+	startThread(9);
+}
+
+MidiOutputScheduler::~MidiOutputScheduler()
+{
+	signalThreadShouldExit();
+	wakeUp_.signal();
+	stopThread(1000);
+}
+
+MidiOutputScheduler &MidiOutputScheduler::forOutput(juce::MidiDeviceInfo const &output)
+{
+	ScopedLock lock(sRegistryLock_);
+	auto &scheduler = sSchedulers_[output.identifier];
+	if (!scheduler) {
+		scheduler = std::make_shared<MidiOutputScheduler>(output);
+	}
+	return *scheduler;
+}
+
+void MidiOutputScheduler::shutdownAll()
+{
+	ScopedLock lock(sRegistryLock_);
+	sSchedulers_.clear();
+}
+
+std::shared_ptr<MidiOutputScheduler::Producer> MidiOutputScheduler::createProducer(Lane lane, int capacity)
+{
+	auto producer = std::make_shared<Producer>(weak_from_this(), lane, capacity);
+	ScopedLock lock(producerLock_);
+	producers_.push_back(producer);
+	return producer;
+}
+
+MidiOutputScheduler::JitterStatistics MidiOutputScheduler::jitter() const
+{
+	JitterStatistics result;
+	result.messages = jitterCount_;
+	result.meanMs = result.messages > 0 ? jitterSum_ / (double)result.messages : 0.0;
+	result.maxMs = jitterMax_;
+	return result;
+}
+
+void MidiOutputScheduler::resetJitter()
+{
+	jitterCount_ = 0;
+	jitterSum_ = 0.0;
+	jitterMax_ = 0.0;
+}
+
+void MidiOutputScheduler::drainProducers()
+{
+	{
+		ScopedLock lock(producerLock_);
+		drainList_ = producers_;
+	}
+	for (auto const &producer : drainList_) {
+		int start1, size1, start2, size2;
+		producer->fifo_.prepareToRead(producer->fifo_.getNumReady(), start1, size1, start2, size2);
+		auto &heap = pending_[(int)producer->lane_];
+		auto take = [&](int start, int size) {
+			for (int i = start; i < start + size; i++) {
+				auto &entry = producer->entries_[(size_t)i];
+				heap.push_back({ entry.when, sequence_++, std::move(entry.message) });
+				std::push_heap(heap.begin(), heap.end(), std::greater<Pending>());
+			}
+		};
+		take(start1, size1);
+		take(start2, size2);
+		producer->fifo_.finishedRead(size1 + size2);
+	}
+}
+
+void MidiOutputScheduler::send(Pending const &pending, double now)
+{
+	midikraft::MidiController::instance()->getMidiOutput(output_)->sendMessageNow(pending.message);
+	if (pending.when > 0.0) {
+		double late = std::max(0.0, now - pending.when);
+		jitterCount_++;
+		jitterSum_ = jitterSum_ + late;
+		if (late > jitterMax_) {
+			jitterMax_ = late;
+		}
+	}
+}
+
+void MidiOutputScheduler::run()
+{
+	while (!threadShouldExit()) {
+		drainProducers();
+
+		auto now = Time::getMillisecondCounterHiRes();
+		bool sentBulk = false;
+		for (int lane = 0; lane < 2 && !sentBulk; lane++) {
+			auto &heap = pending_[lane];
+			while (!heap.empty() && heap.front().when <= now) {
+				std::pop_heap(heap.begin(), heap.end(), std::greater<Pending>());
+				send(heap.back(), now);
+				heap.pop_back();
+				now = Time::getMillisecondCounterHiRes();
+				if (lane == (int)Lane::Bulk) {
+					// Give the realtime lane a chance after every bulk message
+					sentBulk = true;
+					break;
+				}
+			}
+		}
+		if (sentBulk) {
+			continue;
+		}
+
+		// Sleep until the next message is due, or a producer wakes us up
+		double next = now + kMaxIdleWaitMs;
+		for (auto const &heap : pending_) {
+			if (!heap.empty()) {
+				next = std::min(next, heap.front().when);
+			}
+		}
+		int waitMs = (int)(next - now);
+		if (waitMs > 0) {
+			wakeUp_.wait(waitMs);
+		}
+	}
+}
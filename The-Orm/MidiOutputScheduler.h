@@ -0,0 +1,98 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <vector>
+
+// One high priority thread per MIDI output doing all sends to that output at the time stamps requested.
+// Every producing thread gets its own single producer, single consumer queue, so enqueueing never blocks nor locks.
+// Messages of the realtime lane are always sent before due messages of the bulk lane, and the bulk lane gives way
+// after each message, so live controller traffic is not stuck behind a long upload.
+// Producers only hold a weak reference, after shutdownAll() their messages are dropped.
+class MidiOutputScheduler : private Thread, public std::enable_shared_from_this<MidiOutputScheduler> {
+public:
+	enum class Lane {
+		Realtime = 0,
+		Bulk = 1
+	};
+
+	class Producer {
+	public:
+		Producer(std::weak_ptr<MidiOutputScheduler> scheduler, Lane lane, int capacity);
+
+		// Only to be called from the one thread owning this producer. The time is in milliseconds of
+		// Time::getMillisecondCounterHiRes(), 0 means as soon as possible. Returns false if the queue is full
+		// or the scheduler was shut down
+		bool enqueue(MidiMessage const &message, double when = 0.0);
+
+	private:
+		friend class MidiOutputScheduler;
+		struct Entry {
+			MidiMessage message;
+			double when;
+		};
+
+		std::weak_ptr<MidiOutputScheduler> scheduler_;
+		Lane lane_;
+		AbstractFifo fifo_;
+		std::vector<Entry> entries_;
+	};
+
+	struct JitterStatistics {
+		uint64 messages = 0;    // Messages sent with a time stamp
+		double meanMs = 0.0;    // Average lateness against the time stamp
+		double maxMs = 0.0;
+	};
+
+	explicit MidiOutputScheduler(juce::MidiDeviceInfo const &output);
+	~MidiOutputScheduler() override;
+
+	// The scheduler for this output, started on first use
+	static MidiOutputScheduler &forOutput(juce::MidiDeviceInfo const &output);
+	// Stop all scheduler threads, call this before the MidiController goes away
+	static void shutdownAll();
+
+	std::shared_ptr<Producer> createProducer(Lane lane, int capacity = 1024);
+
+	JitterStatistics jitter() const;
+	void resetJitter();
+
+private:
+	struct Pending {
+		double when;
+		uint64 sequence; // Keeps the order of messages with the same time stamp
+		MidiMessage message;
+
+		bool operator>(Pending const &other) const {
+			return when > other.when || (when == other.when && sequence > other.sequence);
+		}
+	};
+
+	void run() override;
+	void drainProducers();
+	void send(Pending const &pending, double now);
+
+	juce::MidiDeviceInfo output_;
+	CriticalSection producerLock_; // Only guards the list of producers, never held while sending
+	std::vector<std::shared_ptr<Producer>> producers_;
+	std::vector<std::shared_ptr<Producer>> drainList_;
+	std::vector<Pending> pending_[2]; // Min heap by time per lane
+	uint64 sequence_ = 0;
+	WaitableEvent wakeUp_;
+
+	std::atomic<uint64> jitterCount_ { 0 };
+	std::atomic<double> jitterSum_ { 0.0 };
+	std::atomic<double> jitterMax_ { 0.0 };
+
+	static CriticalSection sRegistryLock_;
+	static std::map<String, std::shared_ptr<MidiOutputScheduler>> sSchedulers_;
+};
@@ -0,0 +1,246 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "MidiRouter.h"
+
+#include "UIModel.h"
+#include "Settings.h"
+#include "Tracer.h"
+
+#include <spdlog/spdlog.h>
+#include "SpdLogJuce.h"
+
+#include <nlohmann/json.hpp>
+
+MidiRouter::MidiRouter()
+{
+	UIModel::instance()->currentSynth_.addChangeListener(this);
+	MidiDeviceWatcher::instance().addListener(this);
+}
+
+MidiRouter::~MidiRouter()
+{
+	MidiDeviceWatcher::instance().removeListener(this);
+	UIModel::instance()->currentSynth_.removeChangeListener(this);
+	if (!routerCallback_.isNull()) {
+		midikraft::MidiController::instance()->removeMessageHandler(routerCallback_);
+	}
+}
+
+void MidiRouter::setRules(std::vector<Rule> const &rules)
+{
+	rules_ = rules;
+	compile(true);
+	if (!rules_.empty() && routerCallback_.isNull()) {
+		routerCallback_ = midikraft::MidiController::makeOneHandle();
+		midikraft::MidiController::instance()->addMessageHandler(routerCallback_, [this](MidiInput *source, MidiMessage const &message) {
+			route(source, message);
+		});
+	}
+}
+
+std::vector<MidiRouter::Rule> MidiRouter::rules() const
+{
+	return rules_;
+}
+
+void MidiRouter::loadFromSettings(std::string const &key)
+{
+	std::vector<Rule> rules;
+	auto json = Settings::instance().get(key);
+	if (!json.empty()) {
+		try {
+			auto stored = nlohmann::json::parse(json);
+			if (stored.is_array()) {
+				for (auto const &item : stored) {
+					if (item.is_object() && item.contains("Input") && item["Input"].is_string()) {
+						Rule rule;
+						rule.inputName = String(item["Input"].get<std::string>());
+						rule.inputChannel = item.value("InputChannel", 0);
+						rule.messageTypes = item.value("Messages", kAllMessages);
+						rule.outputName = String(item.value("Output", std::string()));
+						rule.outputChannel = item.value("OutputChannel", 0);
+						rules.push_back(rule);
+					}
+				}
+			}
+		}
+		catch (nlohmann::json::exception &e) {
+			spdlog::error("MIDI routing rules corrupt in settings file, not loading. Error is {}", e.what());
+		}
+	}
+	setRules(rules);
+}
+
+void MidiRouter::saveToSettings(std::string const &key) const
+{
+	auto result = nlohmann::json::array();
+	for (auto const &rule : rules_) {
+		result.push_back({
+			{ "Input", rule.inputName.toStdString() },
+			{ "InputChannel", rule.inputChannel },
+			{ "Messages", rule.messageTypes },
+			{ "Output", rule.outputName.toStdString() },
+			{ "OutputChannel", rule.outputChannel } });
+	}
+	Settings::instance().set(key, result.dump());
+}
+
+void MidiRouter::changeListenerCallback(ChangeBroadcaster* source)
+{
+	ignoreUnused(source);
+	// Rules to the current synth need to be redirected
+	compile(true);
+}
+
+void MidiRouter::midiDevicesChanged(MidiDeviceWatcher::Changes const &changes)
+{
+	if (rules_.empty()) {
+		return;
+	}
+	if (changes.inputsChanged()) {
+		// The inputs might have been closed and opened again, and a new one can get the address of one gone. So the recognized
+		// pointers are dropped and the inputs are matched by name again
+		compile(false);
+	}
+	else if (changes.outputsChanged()) {
+		// Rules naming an output that just came or went are resolved again
+		compile(true);
+	}
+}
+
+void MidiRouter::compile(bool keepRecognizedInputs)
+{
+	auto table = std::make_shared<Table>();
+	auto currentSynth = UIModel::currentSynth();
+	auto currentLocation = currentSynth ? midikraft::Capability::hasCapability<midikraft::MidiLocationCapability>(currentSynth) : nullptr;
+	auto &watcher = MidiDeviceWatcher::instance();
+	auto outputs = watcher.hasListed() ? watcher.outputs() : MidiOutput::getAvailableDevices();
+
+	for (auto const &rule : rules_) {
+		// Resolve the output
+		MidiDeviceInfo output;
+		int outputChannel = rule.outputChannel;
+		if (rule.outputName.isEmpty()) {
+			if (!currentLocation) {
+				continue;
+			}
+			output = currentLocation->midiOutput();
+			if (outputChannel == 0) {
+				outputChannel = currentLocation->channel().toOneBasedInt();
+			}
+		}
+		else {
+			bool found = false;
+			for (auto const &device : outputs) {
+				if (device.name == rule.outputName) {
+					output = device;
+					found = true;
+					break;
+				}
+			}
+			if (!found) {
+				spdlog::debug("MIDI route from {} skipped, output {} not available", rule.inputName, rule.outputName);
+				continue;
+			}
+		}
+
+		CompiledInput *input = nullptr;
+		for (auto &existing : table->inputs) {
+			if (existing->name == rule.inputName) {
+				input = existing.get();
+			}
+		}
+		if (!input) {
+			table->inputs.push_back(std::make_unique<CompiledInput>());
+			input = table->inputs.back().get();
+			input->name = rule.inputName;
+		}
+
+		auto &producer = producers_[rule.inputName + "\n" + output.identifier];
+		if (!producer) {
+			producer = MidiOutputScheduler::forOutput(output).createProducer(MidiOutputScheduler::Lane::Realtime);
+		}
+		input->rules.push_back({ rule.inputChannel, rule.messageTypes, outputChannel, producer });
+	}
+
+	// The inputs already recognized stay recognized, as long as the devices didn't change
+	auto previous = std::atomic_load(&table_);
+	if (previous && keepRecognizedInputs) {
+		for (auto &input : table->inputs) {
+			for (auto const &old : previous->inputs) {
+				if (old->name == input->name) {
+					input->source = old->source.load();
+				}
+			}
+		}
+	}
+	std::atomic_store(&table_, table);
+}
+
+uint32 MidiRouter::messageType(MidiMessage const &message)
+{
+	static const uint32 kChannelMessageTypes[8] = { kNotes, kNotes, kPolyAftertouch, kControllers, kProgramChanges, kChannelAftertouch, kPitchBend, 0 };
+	auto status = message.getRawData()[0];
+	if (status < 0x80) {
+		return 0;
+	}
+	if (status < 0xf0) {
+		return kChannelMessageTypes[(status >> 4) - 8];
+	}
+	return status == 0xf0 ? kSysex : kSystem;
+}
+
+void MidiRouter::route(MidiInput *source, MidiMessage const &message)
+{
+	TraceScope trace("Route MIDI", "midi");
+	auto table = std::atomic_load(&table_);
+	if (!table || !source || message.getRawDataSize() < 1) {
+		return;
+	}
+
+	// Recognize the input by pointer, names are only compared until an input has been seen once
+	CompiledInput *input = nullptr;
+	for (auto const &candidate : table->inputs) {
+		if (candidate->source == source) {
+			input = candidate.get();
+			break;
+		}
+	}
+	if (!input) {
+		if (table->lastIgnored == source) {
+			return;
+		}
+		auto name = source->getName();
+		for (auto const &candidate : table->inputs) {
+			if (candidate->source == nullptr && candidate->name == name) {
+				candidate->source = source;
+				input = candidate.get();
+				break;
+			}
+		}
+		if (!input) {
+			table->lastIgnored = source;
+			return;
+		}
+	}
+
+	auto type = messageType(message);
+	int channel = message.getChannel();
+	for (auto const &rule : input->rules) {
+		if ((rule.messageTypes & type) == 0 || (rule.inputChannel != 0 && channel != 0 && channel != rule.inputChannel)) {
+			continue;
+		}
+		// Short messages are stored inline by MidiMessage, so the copy does not allocate
+		MidiMessage forwarded(message);
+		if (channel != 0 && rule.outputChannel != 0) {
+			forwarded.setChannel(rule.outputChannel);
+		}
+		if (!rule.producer->enqueue(forwarded)) {
+			spdlog::warn("MIDI output queue full, dropped message routed from {}", input->name);
+		}
+	}
+}
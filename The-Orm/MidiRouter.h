@@ -0,0 +1,86 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include "MidiController.h"
+#include "MidiOutputScheduler.h"
+#include "MidiDeviceWatcher.h"
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <vector>
+
+// Forwards messages from MIDI inputs to outputs according to a list of rules. The rules are compiled on the message thread
+// into a table that the MIDI callback picks up with an atomic swap, so changing rules never blocks the callback, and
+// the callback neither locks nor allocates for short messages.
+// Every rule names its input device. JUCE calls back from one thread per input, so each input gets its own producer
+// into the output schedulers.
+class MidiRouter : private ChangeListener, private MidiDeviceWatcher::Listener {
+public:
+	// Bits of the message type filter
+	static const uint32 kNotes = 1;
+	static const uint32 kPolyAftertouch = 2;
+	static const uint32 kControllers = 4;
+	static const uint32 kProgramChanges = 8;
+	static const uint32 kChannelAftertouch = 16;
+	static const uint32 kPitchBend = 32;
+	static const uint32 kSysex = 64;
+	static const uint32 kSystem = 128;
+	static const uint32 kAllMessages = 255;
+
+	struct Rule {
+		String inputName;
+		int inputChannel = 0; // One based, 0 accepts all channels
+		uint32 messageTypes = kAllMessages;
+		String outputName; // Empty means the current synth
+		int outputChannel = 0; // One based. 0 keeps the channel, or uses the synth's channel when routing to the current synth
+	};
+
+	MidiRouter();
+	virtual ~MidiRouter() override;
+
+	// Call on the message thread
+	void setRules(std::vector<Rule> const &rules);
+	std::vector<Rule> rules() const;
+
+	// Persistence as a JSON array in the settings under the given key
+	void loadFromSettings(std::string const &key);
+	void saveToSettings(std::string const &key) const;
+
+private:
+	struct CompiledRule {
+		int inputChannel;
+		uint32 messageTypes;
+		int outputChannel;
+		std::shared_ptr<MidiOutputScheduler::Producer> producer;
+	};
+
+	struct CompiledInput {
+		String name;
+		std::atomic<MidiInput *> source { nullptr }; // Remembered after the first name match, forgotten when the inputs change. Never dereferenced
+		std::vector<CompiledRule> rules;
+	};
+
+	struct Table {
+		std::vector<std::unique_ptr<CompiledInput>> inputs;
+		std::atomic<MidiInput *> lastIgnored { nullptr };
+	};
+
+	void changeListenerCallback(ChangeBroadcaster* source) override;
+	void midiDevicesChanged(MidiDeviceWatcher::Changes const &changes) override;
+	void compile(bool keepRecognizedInputs);
+	void route(MidiInput *source, MidiMessage const &message);
+	static uint32 messageType(MidiMessage const &message);
+
+	std::vector<Rule> rules_;
+	std::shared_ptr<Table> table_; // Only accessed with std::atomic_load and std::atomic_store
+	std::map<String, std::shared_ptr<MidiOutputScheduler::Producer>> producers_; // By input and output, message thread only
+	midikraft::MidiController::HandlerHandle routerCallback_ = midikraft::MidiController::makeNoneHandle();
+};
@@ -0,0 +1,214 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "MidiTrafficLog.h"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+
+namespace {
+
+	// Bytes of a sysex message shown when truncating, enough to see manufacturer, device and command
+	constexpr int kTruncatedSysexBytes = 24;
+
+	constexpr int kRefreshIntervalMs = 100;
+
+}
+
+MidiTrafficRing::MidiTrafficRing(size_t capacity) : capacity_(std::max(capacity, (size_t) 1))
+{
+	entries_.reserve(capacity_);
+}
+
+void MidiTrafficRing::record(MidiMessage const &message, String const &source, bool isOut)
+{
+	// Copy outside of the lock, so the other MIDI thread does not wait for the allocation of a large sysex
+	Entry entry{ Time::currentTimeMillis(), message, source, isOut };
+	std::lock_guard<std::mutex> lock(lock_);
+	if (entries_.size() < capacity_) {
+		entries_.push_back(std::move(entry));
+	}
+	else {
+		entries_[next_] = std::move(entry);
+		next_ = (next_ + 1) % capacity_;
+	}
+	recorded_++;
+}
+
+void MidiTrafficRing::clear()
+{
+	std::lock_guard<std::mutex> lock(lock_);
+	entries_.clear();
+	next_ = 0;
+	recorded_++;
+}
+
+size_t MidiTrafficRing::size() const
+{
+	std::lock_guard<std::mutex> lock(lock_);
+	return entries_.size();
+}
+
+uint64 MidiTrafficRing::recorded() const
+{
+	std::lock_guard<std::mutex> lock(lock_);
+	return recorded_;
+}
+
+bool MidiTrafficRing::entry(size_t index, Entry &outEntry) const
+{
+	std::lock_guard<std::mutex> lock(lock_);
+	if (index >= entries_.size()) {
+		return false;
+	}
+	outEntry = entries_[(next_ + index) % entries_.size()];
+	return true;
+}
+
+std::vector<MidiMessage> MidiTrafficRing::sysexMessages() const
+{
+	std::lock_guard<std::mutex> lock(lock_);
+	std::vector<MidiMessage> result;
+	for (size_t i = 0; i < entries_.size(); i++) {
+		auto const &entry = entries_[(next_ + i) % entries_.size()];
+		if (entry.message.isSysEx()) {
+			result.push_back(entry.message);
+		}
+	}
+	return result;
+}
+
+MidiTrafficLog::MidiTrafficLog(size_t capacity) : ring_(capacity), buttons_(1201, LambdaButtonStrip::Direction::Horizontal)
+{
+	list_.setModel(this);
+	list_.setRowHeight(18);
+	addAndMakeVisible(list_);
+
+	truncateSysex_.setButtonText("Truncate sysex");
+	truncateSysex_.setToggleState(true, dontSendNotification);
+	truncateSysex_.onClick = [this]() { list_.repaint(); };
+	addAndMakeVisible(truncateSysex_);
+
+	LambdaButtonStrip::TButtonMap buttons = {
+		{ "clearMidiLog", { "Clear", [this]() {
+			ring_.clear();
+		}}},
+		{ "captureMidiLog", { "Capture sysex to .syx", [this]() {
+			captureSysex();
+		}}}
+	};
+	buttons_.setButtonDefinitions(buttons);
+	addAndMakeVisible(buttons_);
+
+	startTimer(kRefreshIntervalMs);
+}
+
+MidiTrafficLog::~MidiTrafficLog()
+{
+	stopTimer();
+}
+
+void MidiTrafficLog::addMessageToList(MidiMessage const &message, String const &source, bool isOut)
+{
+	ring_.record(message, source, isOut);
+}
+
+void MidiTrafficLog::resized()
+{
+	auto area = getLocalBounds();
+	auto bottomRow = area.removeFromBottom(40).reduced(0, 8);
+	truncateSysex_.setBounds(bottomRow.removeFromLeft(160));
+	buttons_.setBounds(bottomRow);
+	list_.setBounds(area);
+}
+
+int MidiTrafficLog::getNumRows()
+{
+	return (int) ring_.size();
+}
+
+void MidiTrafficLog::paintListBoxItem(int rowNumber, Graphics &g, int width, int height, bool rowIsSelected)
+{
+	if (rowNumber < 0) return;
+	MidiTrafficRing::Entry entry;
+	if (!ring_.entry((size_t) rowNumber, entry)) return;
+
+	auto &lookAndFeel = LookAndFeel::getDefaultLookAndFeel();
+	if (rowIsSelected) {
+		g.fillAll(lookAndFeel.findColour(TextEditor::highlightColourId));
+	}
+	auto textColour = lookAndFeel.findColour(ListBox::textColourId);
+	g.setColour(entry.isOut ? textColour : textColour.interpolatedWith(Colours::lightgreen, 0.5f));
+	g.setFont(Font(Font::getDefaultMonospacedFontName(), (float) height * 0.7f, Font::plain));
+	g.drawText(describe(entry), 4, 0, width - 8, height, Justification::centredLeft, true);
+}
+
+void MidiTrafficLog::timerCallback()
+{
+	auto recorded = ring_.recorded();
+	if (recorded == shownRecorded_) {
+		return;
+	}
+	shownRecorded_ = recorded;
+
+	// Follow the new messages only if the user has not scrolled up to look at older ones
+	auto viewport = list_.getViewport();
+	bool atEnd = viewport == nullptr || viewport->getViewedComponent() == nullptr
+		|| viewport->getViewPositionY() + viewport->getViewHeight() >= viewport->getViewedComponent()->getHeight() - list_.getRowHeight();
+	list_.updateContent();
+	list_.repaint();
+	if (atEnd && getNumRows() > 0) {
+		list_.scrollToEnsureRowIsOnscreen(getNumRows() - 1);
+	}
+}
+
+String MidiTrafficLog::describe(MidiTrafficRing::Entry const &entry) const
+{
+	String text = Time(entry.timestampMs).formatted("%H:%M:%S") + String::formatted(".%03d ", (int) (entry.timestampMs % 1000));
+	text += entry.isOut ? "OUT " : "IN  ";
+	text += entry.source + ": ";
+	if (entry.message.isSysEx()) {
+		auto size = entry.message.getRawDataSize();
+		if (truncateSysex_.getToggleState() && size > kTruncatedSysexBytes) {
+			text += String::toHexString(entry.message.getRawData(), kTruncatedSysexBytes, 1) + String::formatted(" ... (%d bytes)", size);
+		}
+		else {
+			text += String::toHexString(entry.message.getRawData(), size, 1);
+		}
+	}
+	else {
+		text += entry.message.getDescription();
+	}
+	return text;
+}
+
+void MidiTrafficLog::captureSysex()
+{
+	auto messages = ring_.sysexMessages();
+	if (messages.empty()) {
+		AlertWindow::showMessageBox(AlertWindow::InfoIcon, "No sysex in the log", "The MIDI log contains no sysex messages to capture");
+		return;
+	}
+	FileChooser syxChooser("Please enter the name of the sysex file to capture the logged sysex messages to...", File::getSpecialLocation(File::userDocumentsDirectory), "*.syx");
+	if (syxChooser.browseForFileToSave(true)) {
+		auto file = syxChooser.getResult();
+		file.deleteFile();
+		FileOutputStream out(file);
+		bool ok = out.openedOk();
+		for (auto const &message : messages) {
+			if (!ok) break;
+			ok = out.write(message.getRawData(), (size_t) message.getRawDataSize());
+		}
+		out.flush();
+		if (ok) {
+			spdlog::info("Captured {} sysex messages from the MIDI log to {}", messages.size(), file.getFullPathName().toStdString());
+		}
+		else {
+			spdlog::error("Failed to write the sysex messages to {}", file.getFullPathName().toStdString());
+		}
+	}
+}
@@ -0,0 +1,73 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include "LambdaButtonStrip.h"
+
+#include <mutex>
+#include <vector>
+
+// The most recent MIDI messages in and out, stored raw with their timestamp. Recording copies the message and takes a short lock,
+// so it is cheap enough to be called from the MIDI threads for every message of a bank transfer. Formatting is left to the viewer.
+class MidiTrafficRing {
+public:
+	struct Entry {
+		int64 timestampMs = 0;
+		MidiMessage message;
+		String source;
+		bool isOut = false;
+	};
+
+	explicit MidiTrafficRing(size_t capacity);
+
+	void record(MidiMessage const &message, String const &source, bool isOut);
+	void clear();
+
+	size_t size() const;
+	// Changes with every message recorded, also when the ring is full
+	uint64 recorded() const;
+	// Index 0 is the oldest entry still in the ring
+	bool entry(size_t index, Entry &outEntry) const;
+	// All sysex messages still in the ring, oldest first
+	std::vector<MidiMessage> sysexMessages() const;
+
+private:
+	mutable std::mutex lock_;
+	std::vector<Entry> entries_;
+	size_t capacity_;
+	size_t next_ = 0; // Where the next entry goes once the ring is full
+	uint64 recorded_ = 0;
+};
+
+// The MIDI log tab. A virtualized list over the ring, only the rows on screen are formatted into text, optionally showing just the
+// start of long sysex messages. The sysex in the ring can be captured into a .syx file.
+class MidiTrafficLog : public Component, private ListBoxModel, private Timer {
+public:
+	explicit MidiTrafficLog(size_t capacity = 20000);
+	~MidiTrafficLog() override;
+
+	// Thread safe
+	void addMessageToList(MidiMessage const &message, String const &source, bool isOut);
+
+	void resized() override;
+
+private:
+	int getNumRows() override;
+	void paintListBoxItem(int rowNumber, Graphics &g, int width, int height, bool rowIsSelected) override;
+	void timerCallback() override;
+
+	void captureSysex();
+	String describe(MidiTrafficRing::Entry const &entry) const;
+
+	MidiTrafficRing ring_;
+	uint64 shownRecorded_ = 0;
+	ListBox list_;
+	ToggleButton truncateSysex_;
+	LambdaButtonStrip buttons_;
+};
@@ -0,0 +1,173 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "NearDuplicateFinder.h"
+
+#include "ParallelFor.h"
+#include "Synth.h"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <map>
+#include <numeric>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace {
+
+	// With 8 bands, two patches differing in up to 7 bytes still share at least one identical band
+	constexpr size_t kNumberOfBands = 8;
+	// Buckets larger than this are typically long runs of zeros shared by everything, they carry no information
+	constexpr size_t kMaxBucketSize = 2000;
+
+	uint64 fnv1a(uint64 hash, uint8 const *data, size_t size) {
+		for (size_t i = 0; i < size; i++) {
+			hash ^= data[i];
+			hash *= 0x100000001b3ULL;
+		}
+		return hash;
+	}
+
+	uint64 fnv1a(uint64 hash, uint64 value) {
+		return fnv1a(hash, reinterpret_cast<uint8 const *>(&value), sizeof(value));
+	}
+
+	constexpr uint64 kFnvOffset = 0xcbf29ce484222325ULL;
+
+	struct UnionFind {
+		explicit UnionFind(size_t size) : parent(size) {
+			std::iota(parent.begin(), parent.end(), 0);
+		}
+
+		size_t find(size_t x) {
+			while (parent[x] != x) {
+				parent[x] = parent[parent[x]];
+				x = parent[x];
+			}
+			return x;
+		}
+
+		void join(size_t a, size_t b) {
+			a = find(a);
+			b = find(b);
+			if (a != b) {
+				parent[std::max(a, b)] = std::min(a, b);
+			}
+		}
+
+		std::vector<size_t> parent;
+	};
+
+}
+
+size_t NearDuplicateFinder::maxDifferingBytes(size_t dataSize)
+{
+	// One changed parameter can take up to two bytes in a nibbled format, larger patches tolerate proportionally more. But no more than
+	// the bands guarantee to find, else pairs with many differences would be found by chance only
+	return std::min(kNumberOfBands - 1, std::max((size_t) 2, dataSize / 50));
+}
+
+std::vector<NearDuplicateFinder::Cluster> NearDuplicateFinder::findClusters(std::vector<midikraft::PatchHolder> const &patches, std::function<bool(double)> progress)
+{
+	// Phase 1 - extract the voice relevant data of all patches in parallel
+	std::vector<std::vector<uint8>> data(patches.size());
+	bool completed = parallelFor(patches.size(), [&](size_t i) {
+		auto const &patch = patches[i];
+		if (patch.patch() && patch.synth()) {
+			// Returned by value, so take it over instead of copying it once more
+			data[i] = patch.synth()->filterVoiceRelevantData(patch.patch());
+		}
+	}, progress, 0.0, 0.4);
+	if (!completed) {
+		return {};
+	}
+
+	// Phase 2 - bucket by band hash. The key includes the synth, the data length and the band index, so only comparable patches meet
+	std::unordered_map<uint64, std::vector<uint32>> buckets;
+	for (size_t i = 0; i < patches.size(); i++) {
+		size_t length = data[i].size();
+		if (length == 0) {
+			continue;
+		}
+		auto synthName = patches[i].synth()->getName();
+		uint64 prefix = fnv1a(fnv1a(kFnvOffset, reinterpret_cast<uint8 const *>(synthName.data()), synthName.size()), (uint64) length);
+		size_t bands = std::min(kNumberOfBands, length);
+		for (size_t band = 0; band < bands; band++) {
+			size_t start = band * length / bands;
+			size_t end = (band + 1) * length / bands;
+			uint64 key = fnv1a(fnv1a(prefix, (uint64) band), data[i].data() + start, end - start);
+			buckets[key].push_back((uint32) i);
+		}
+	}
+	if (!progress(0.5)) {
+		return {};
+	}
+
+	std::unordered_set<uint64> seen;
+	std::vector<std::pair<uint32, uint32>> candidates;
+	size_t skippedBuckets = 0;
+	for (auto const &bucket : buckets) {
+		auto const &members = bucket.second;
+		if (members.size() < 2) {
+			continue;
+		}
+		if (members.size() > kMaxBucketSize) {
+			skippedBuckets++;
+			continue;
+		}
+		for (size_t a = 0; a < members.size(); a++) {
+			for (size_t b = a + 1; b < members.size(); b++) {
+				uint64 pair = (((uint64) members[a]) << 32) | members[b];
+				if (seen.insert(pair).second) {
+					candidates.emplace_back(members[a], members[b]);
+				}
+			}
+		}
+	}
+	if (skippedBuckets > 0) {
+		spdlog::debug("Near duplicate search skipped {} buckets with more than {} patches", skippedBuckets, kMaxBucketSize);
+	}
+
+	// Phase 3 - verify the candidates by counting differing bytes. The bucket key guarantees the data lengths are equal
+	std::vector<uint8> verified(candidates.size(), 0);
+	completed = parallelFor(candidates.size(), [&](size_t c) {
+		auto const &first = data[candidates[c].first];
+		auto const &second = data[candidates[c].second];
+		size_t limit = maxDifferingBytes(first.size());
+		size_t differing = 0;
+		for (size_t i = 0; i < first.size() && differing <= limit; i++) {
+			if (first[i] != second[i]) {
+				differing++;
+			}
+		}
+		verified[c] = differing <= limit ? 1 : 0;
+	}, progress, 0.5, 1.0);
+	if (!completed) {
+		return {};
+	}
+
+	UnionFind clusters(patches.size());
+	for (size_t c = 0; c < candidates.size(); c++) {
+		if (verified[c]) {
+			clusters.join(candidates[c].first, candidates[c].second);
+		}
+	}
+
+	std::map<size_t, Cluster> byRoot;
+	for (size_t i = 0; i < patches.size(); i++) {
+		byRoot[clusters.find(i)].push_back(patches[i]);
+	}
+
+	std::vector<Cluster> result;
+	for (auto &cluster : byRoot) {
+		if (cluster.second.size() > 1) {
+			result.push_back(std::move(cluster.second));
+		}
+	}
+	std::stable_sort(result.begin(), result.end(), [](Cluster const &a, Cluster const &b) { return a.size() > b.size(); });
+	return result;
+}
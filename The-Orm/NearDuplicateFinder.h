@@ -0,0 +1,31 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include "PatchHolder.h"
+
+#include <functional>
+#include <vector>
+
+// Batch search for patches that are almost, but not exactly the same, e.g. the same sound downloaded in two banks
+// with a one byte difference. The voice relevant data of each patch is cut into bands, and patches sharing at least
+// one identical band of the same synth and data length become candidates. Candidates are verified by counting the
+// differing bytes, and the verified pairs are joined into clusters. All expensive phases run on every core.
+class NearDuplicateFinder {
+public:
+	using Cluster = std::vector<midikraft::PatchHolder>;
+
+	// The progress function is called on the calling thread with values from 0 to 1, return false from it to abort.
+	// Clusters are returned largest first, an aborted search returns no clusters
+	static std::vector<Cluster> findClusters(std::vector<midikraft::PatchHolder> const &patches, std::function<bool(double)> progress);
+
+	// Two patches with data of this size are near duplicates if no more than this number of bytes differ: 2% of the size,
+	// but at least 2 and at most 7 bytes
+	static size_t maxDifferingBytes(size_t dataSize);
+};
@@ -0,0 +1,432 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "NetworkMidi.h"
+
+#include "Metrics.h"
+#include "Settings.h"
+
+#include <spdlog/spdlog.h>
+#include "SpdLogJuce.h"
+
+#include <fmt/format.h>
+
+namespace {
+
+	constexpr int kFrameHeaderBytes = 5;
+	constexpr uint32 kMaxFrameBytes = 16 * 1024 * 1024; // Anything larger is a broken stream
+	constexpr int kConnectTimeoutMs = 2000;
+	constexpr int kReconnectIntervalMs = 5000;
+	constexpr int kPollIntervalMs = 100;
+
+	const std::string kNetworkMidiHostsSetting{ "NetworkMidiHosts" };
+
+	MidiDeviceInfo findDevice(Array<MidiDeviceInfo> const &devices, String const &name) {
+		for (auto const &device : devices) {
+			if (device.name == name || device.identifier == name) {
+				return device;
+			}
+		}
+		return {};
+	}
+
+}
+
+NetworkMidiConnection::Writer::Writer(NetworkMidiConnection &connection) : Thread("Network MIDI writer " + connection.name_), connection_(connection)
+{
+}
+
+void NetworkMidiConnection::Writer::run()
+{
+	while (!threadShouldExit() && connection_.isConnected()) {
+		connection_.wakeWriter_.wait(kPingIntervalMs);
+		connection_.writeQueued();
+	}
+}
+
+NetworkMidiConnection::NetworkMidiConnection(std::unique_ptr<StreamingSocket> socket, String const &name, TMessageHandler onMessage) :
+	Thread("Network MIDI reader " + name), name_(name), socket_(std::move(socket)), onMessage_(onMessage),
+	sysex_([this](uint8 const *data, size_t size) { onMessage_(MidiMessage(data, (int) size)); }, [this](MidiMessage const &message) { onMessage_(message); })
+{
+	writer_ = std::make_unique<Writer>(*this);
+	writer_->startThread(8);
+	startThread(8);
+}
+
+NetworkMidiConnection::~NetworkMidiConnection()
+{
+	connected_ = false;
+	signalThreadShouldExit();
+	writer_->signalThreadShouldExit();
+	wakeWriter_.signal();
+	socket_->close();
+	writer_->stopThread(1000);
+	stopThread(1000);
+}
+
+void NetworkMidiConnection::send(MidiMessage const &message)
+{
+	{
+		ScopedLock lock(queueLock_);
+		queue_.push_back(message);
+	}
+	wakeWriter_.signal();
+}
+
+bool NetworkMidiConnection::isConnected() const
+{
+	return connected_;
+}
+
+double NetworkMidiConnection::roundTripMs() const
+{
+	return roundTripMs_;
+}
+
+void NetworkMidiConnection::writeQueued()
+{
+	std::vector<MidiMessage> messages;
+	std::vector<std::vector<uint8>> pongs;
+	{
+		ScopedLock lock(queueLock_);
+		messages.swap(queue_);
+		pongs.swap(pongs_);
+	}
+
+	// Pongs go first, so the time measured includes as little of the queue as possible
+	for (auto const &pong : pongs) {
+		writeFrame(FrameType::Pong, pong.data(), pong.size());
+	}
+
+	auto now = Time::getMillisecondCounterHiRes();
+	if (now - lastPingMs_ >= kPingIntervalMs) {
+		lastPingMs_ = now;
+		writeFrame(FrameType::Ping, &now, sizeof(now));
+	}
+
+	// Everything queued since the last write goes out in as few frames as possible, keeping the order
+	MemoryOutputStream batch;
+	auto flush = [this, &batch]() {
+		if (batch.getDataSize() > 0) {
+			writeFrame(FrameType::Batch, batch.getData(), batch.getDataSize());
+			batch.reset();
+		}
+	};
+	for (auto const &message : messages) {
+		auto size = (size_t) message.getRawDataSize();
+		if (size > kSysexChunkBytes) {
+			flush();
+			auto data = message.getRawData();
+			for (size_t offset = 0; offset < size; offset += kSysexChunkBytes) {
+				auto length = std::min(kSysexChunkBytes, size - offset);
+				MemoryOutputStream chunk;
+				chunk.writeByte(offset + length == size ? 1 : 0);
+				chunk.write(data + offset, length);
+				writeFrame(FrameType::SysexChunk, chunk.getData(), chunk.getDataSize());
+			}
+			continue;
+		}
+		if (batch.getDataSize() + 2 + size > kMaxBatchBytes) {
+			flush();
+		}
+		batch.writeShort((short) size);
+		batch.write(message.getRawData(), size);
+	}
+	flush();
+	if (!messages.empty()) {
+		Metrics::instance().counter("midi.network.messages_sent").add(messages.size());
+	}
+}
+
+bool NetworkMidiConnection::writeFrame(FrameType type, void const *data, size_t size)
+{
+	uint8 header[kFrameHeaderBytes];
+	header[0] = (uint8) type;
+	ByteOrder::writeLittleEndianInt(header + 1, (uint32) size);
+	if (!connected_ || socket_->write(header, kFrameHeaderBytes) != kFrameHeaderBytes || (size > 0 && socket_->write(data, (int) size) != (int) size)) {
+		disconnected();
+		return false;
+	}
+	Metrics::instance().counter("midi.network.frames_sent").add();
+	return true;
+}
+
+bool NetworkMidiConnection::readFully(void *destination, int size)
+{
+	int done = 0;
+	while (done < size) {
+		if (threadShouldExit()) {
+			return false;
+		}
+		int ready = socket_->waitUntilReady(true, kPollIntervalMs);
+		if (ready < 0) {
+			return false;
+		}
+		if (ready == 0) {
+			continue;
+		}
+		int read = socket_->read(static_cast<char *>(destination) + done, size - done, false);
+		if (read <= 0) {
+			// Ready but nothing to read means the other side closed the connection
+			return false;
+		}
+		done += read;
+	}
+	return true;
+}
+
+void NetworkMidiConnection::run()
+{
+	while (!threadShouldExit() && connected_) {
+		uint8 header[kFrameHeaderBytes];
+		if (!readFully(header, kFrameHeaderBytes)) {
+			break;
+		}
+		auto size = ByteOrder::littleEndianInt(header + 1);
+		if (size > kMaxFrameBytes) {
+			spdlog::error("Network MIDI {}: received a frame of {} bytes, closing the connection", name_, size);
+			break;
+		}
+		frame_.resize(size);
+		if (size > 0 && !readFully(frame_.data(), (int) size)) {
+			break;
+		}
+		handleFrame((FrameType) header[0], frame_.data(), frame_.size());
+	}
+	disconnected();
+}
+
+void NetworkMidiConnection::handleFrame(FrameType type, uint8 const *data, size_t size)
+{
+	switch (type) {
+	case FrameType::Batch: {
+		size_t offset = 0;
+		while (offset + 2 <= size) {
+			auto length = (size_t) ByteOrder::littleEndianShort(data + offset);
+			offset += 2;
+			if (length == 0 || offset + length > size) {
+				break;
+			}
+			onMessage_(MidiMessage(data + offset, (int) length));
+			offset += length;
+		}
+		break;
+	}
+	case FrameType::SysexChunk:
+		if (size > 1) {
+			sysex_.push(data + 1, size - 1);
+		}
+		if (size > 0 && data[0] == 1 && sysex_.isCollecting()) {
+			spdlog::warn("Network MIDI {}: the last chunk of a sysex message did not end it, dropping the message", name_);
+			sysex_.reset();
+		}
+		break;
+	case FrameType::Ping:
+		// The writing thread sends it back as soon as it wakes up
+		{
+			ScopedLock lock(queueLock_);
+			pongs_.emplace_back(data, data + size);
+		}
+		wakeWriter_.signal();
+		break;
+	case FrameType::Pong:
+		if (size == sizeof(double)) {
+			double sent;
+			memcpy(&sent, data, sizeof(sent));
+			auto sample = Time::getMillisecondCounterHiRes() - sent;
+			auto previous = roundTripMs_.load();
+			roundTripMs_ = previous > 0.0 ? previous * 0.8 + sample * 0.2 : sample;
+			Metrics::instance().histogram("midi.network.round_trip").record((int64) (sample * 1000.0));
+		}
+		break;
+	default:
+		spdlog::warn("Network MIDI {}: ignoring frame of unknown type {}", name_, (int) type);
+		break;
+	}
+}
+
+void NetworkMidiConnection::disconnected()
+{
+	if (connected_.exchange(false)) {
+		spdlog::info("Network MIDI {}: connection closed", name_);
+	}
+	wakeWriter_.signal();
+}
+
+// Connects to one server and keeps the connection up, behind a virtual MIDI input and output
+class NetworkMidi::Client : private Thread, private MidiInputCallback {
+public:
+	Client(String const &host, int port) : Thread("Network MIDI " + host), host_(host), port_(port), portName_("Network " + host + ":" + String(port))
+	{
+		virtualOutput_ = MidiOutput::createNewDevice(portName_);
+		// A virtual input is something we receive from, so this is where the program sends to the remote synths
+		virtualInput_ = MidiInput::createNewDevice(portName_, this);
+		if (!virtualOutput_ || !virtualInput_) {
+			spdlog::error("Could not create the virtual MIDI ports for {}, this platform might not support them", portName_);
+			return;
+		}
+		virtualInput_->start();
+		startThread();
+	}
+
+	~Client() override
+	{
+		signalThreadShouldExit();
+		notify();
+		stopThread(kConnectTimeoutMs + 1000);
+		if (virtualInput_) {
+			virtualInput_->stop();
+		}
+		ScopedLock lock(connectionLock_);
+		connection_.reset();
+	}
+
+	String portName() const { return portName_; }
+
+	double roundTripMs() const {
+		ScopedLock lock(connectionLock_);
+		return connection_ && connection_->isConnected() ? connection_->roundTripMs() : 0.0;
+	}
+
+private:
+	void run() override {
+		while (!threadShouldExit()) {
+			bool connected;
+			{
+				ScopedLock lock(connectionLock_);
+				connected = connection_ && connection_->isConnected();
+			}
+			if (!connected) {
+				auto socket = std::make_unique<StreamingSocket>();
+				if (socket->connect(host_, port_, kConnectTimeoutMs)) {
+					spdlog::info("Network MIDI connected to {}", portName_);
+					auto output = virtualOutput_.get();
+					auto connection = std::make_unique<NetworkMidiConnection>(std::move(socket), portName_, [output](MidiMessage const &message) {
+						output->sendMessageNow(message);
+					});
+					ScopedLock lock(connectionLock_);
+					connection_ = std::move(connection);
+				}
+			}
+			wait(kReconnectIntervalMs);
+		}
+	}
+
+	void handleIncomingMidiMessage(MidiInput *source, MidiMessage const &message) override {
+		ignoreUnused(source);
+		ScopedLock lock(connectionLock_);
+		if (connection_ && connection_->isConnected()) {
+			connection_->send(message);
+		}
+	}
+
+	String host_;
+	int port_;
+	String portName_;
+	std::unique_ptr<MidiOutput> virtualOutput_;
+	std::unique_ptr<MidiInput> virtualInput_;
+	mutable CriticalSection connectionLock_;
+	std::unique_ptr<NetworkMidiConnection> connection_;
+};
+
+std::vector<std::unique_ptr<NetworkMidi::Client>> NetworkMidi::sClients_;
+
+void NetworkMidi::startClients()
+{
+	StringArray hosts;
+	hosts.addTokens(String(Settings::instance().get(kNetworkMidiHostsSetting, "")), ",", "");
+	hosts.trim();
+	hosts.removeEmptyStrings();
+	for (auto const &entry : hosts) {
+		auto host = entry.upToLastOccurrenceOf(":", false, false);
+		int port = entry.contains(":") ? entry.fromLastOccurrenceOf(":", false, false).getIntValue() : kDefaultPort;
+		if (host.isEmpty() || port <= 0) {
+			spdlog::warn("Ignoring network MIDI host '{}', expected host:port", entry);
+			continue;
+		}
+		sClients_.push_back(std::make_unique<Client>(host, port));
+	}
+}
+
+void NetworkMidi::shutdown()
+{
+	sClients_.clear();
+}
+
+double NetworkMidi::roundTripMs(String const &portName)
+{
+	for (auto const &client : sClients_) {
+		if (client->portName() == portName) {
+			return client->roundTripMs();
+		}
+	}
+	return 0.0;
+}
+
+int NetworkMidi::serve(int tcpPort, String const &outputName, String const &inputName, std::function<void(std::string const &)> print)
+{
+	auto outputDevice = findDevice(MidiOutput::getAvailableDevices(), outputName);
+	auto output = MidiOutput::openDevice(outputDevice.identifier);
+	if (!output) {
+		print(fmt::format("Could not open MIDI output {}", outputName.toStdString()));
+		return 1;
+	}
+
+	// The input forwards to whichever client is connected at the moment
+	struct Forwarder : public MidiInputCallback {
+		void handleIncomingMidiMessage(MidiInput *source, MidiMessage const &message) override {
+			ignoreUnused(source);
+			ScopedLock lock(connectionLock);
+			if (connection) {
+				connection->send(message);
+			}
+		}
+
+		CriticalSection connectionLock;
+		NetworkMidiConnection *connection = nullptr;
+	} forwarder;
+	std::unique_ptr<MidiInput> input;
+	if (inputName.isNotEmpty()) {
+		auto inputDevice = findDevice(MidiInput::getAvailableDevices(), inputName);
+		input = MidiInput::openDevice(inputDevice.identifier, &forwarder);
+		if (!input) {
+			print(fmt::format("Could not open MIDI input {}", inputName.toStdString()));
+			return 1;
+		}
+		input->start();
+	}
+
+	StreamingSocket listener;
+	if (!listener.createListener(tcpPort)) {
+		print(fmt::format("Could not listen on TCP port {}", tcpPort));
+		return 1;
+	}
+	print(fmt::format("Serving MIDI output {} and input {} on TCP port {}", outputDevice.name.toStdString(), inputName.toStdString(), tcpPort));
+	while (true) {
+		std::unique_ptr<StreamingSocket> socket(listener.waitForNextConnection());
+		if (!socket) {
+			continue;
+		}
+		auto peer = socket->getHostName();
+		print(fmt::format("Client {} connected", peer.toStdString()));
+		auto rawOutput = output.get();
+		NetworkMidiConnection connection(std::move(socket), peer, [rawOutput](MidiMessage const &message) {
+			rawOutput->sendMessageNow(message);
+		});
+		{
+			ScopedLock lock(forwarder.connectionLock);
+			forwarder.connection = &connection;
+		}
+		while (connection.isConnected()) {
+			Thread::sleep(kPollIntervalMs);
+		}
+		{
+			ScopedLock lock(forwarder.connectionLock);
+			forwarder.connection = nullptr;
+		}
+		print(fmt::format("Client {} disconnected", peer.toStdString()));
+	}
+}
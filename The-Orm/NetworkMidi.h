@@ -0,0 +1,104 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include "SysexReassembler.h"
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+// MIDI over one TCP connection, in frames of a type byte and a 32 bit length. Short messages and small sysex queued
+// while the last frame was written go out together in one batch frame, so a bank request of many small messages costs
+// one packet instead of one per message. Large sysex is cut into chunk frames, and pings measure the round trip time.
+// TCP already delivers everything in order, so there are no acknowledgements or resends on top
+class NetworkMidiConnection : private Thread {
+public:
+	typedef std::function<void(MidiMessage const &)> TMessageHandler;
+
+	// onMessage is called on the reading thread
+	NetworkMidiConnection(std::unique_ptr<StreamingSocket> socket, String const &name, TMessageHandler onMessage);
+	~NetworkMidiConnection() override;
+
+	// Can be called from any thread, the message is queued for the writing thread
+	void send(MidiMessage const &message);
+
+	bool isConnected() const;
+	// Smoothed, 0 until the first ping came back
+	double roundTripMs() const;
+
+	static constexpr size_t kMaxBatchBytes = 1400; // Fits into one ethernet packet
+	static constexpr size_t kSysexChunkBytes = 4096;
+	static constexpr int kPingIntervalMs = 1000;
+
+private:
+	enum class FrameType : uint8 {
+		Batch = 1,      // Messages with a 16 bit length each
+		SysexChunk = 2, // A flag byte telling if this is the last chunk, then the bytes
+		Ping = 3,       // The sender's time stamp as a double
+		Pong = 4        // The ping's payload sent back
+	};
+
+	class Writer : public Thread {
+	public:
+		explicit Writer(NetworkMidiConnection &connection);
+		void run() override;
+
+	private:
+		NetworkMidiConnection &connection_;
+	};
+
+	void run() override;
+	void writeQueued();
+	bool writeFrame(FrameType type, void const *data, size_t size);
+	bool readFully(void *destination, int size);
+	void handleFrame(FrameType type, uint8 const *data, size_t size);
+	void disconnected();
+
+	String name_;
+	std::unique_ptr<StreamingSocket> socket_;
+	TMessageHandler onMessage_;
+	std::atomic<bool> connected_ { true };
+	std::atomic<double> roundTripMs_ { 0.0 };
+
+	CriticalSection queueLock_;
+	std::vector<MidiMessage> queue_;
+	std::vector<std::vector<uint8>> pongs_; // Ping payloads to send back, queued by the reading thread
+	WaitableEvent wakeWriter_;
+	// Writing thread only, it is the only one writing to the socket
+	double lastPingMs_ = 0.0;
+	// Reading thread only, both keep their capacity from frame to frame
+	std::vector<uint8> frame_;
+	SysexReassembler sysex_;
+
+	std::unique_ptr<Writer> writer_;
+};
+
+// Synths attached to another computer. On the computer with the synths, "KnobKraftOrm --midi-server" serves a pair
+// of its MIDI ports. Each server listed in the NetworkMidiHosts setting (host:port, comma separated) shows up here
+// as a virtual MIDI input and output named "Network host:port", which can be used as any other port
+class NetworkMidi {
+public:
+	static void startClients();
+	static void shutdown();
+
+	// Of the server behind the port with this name, 0 if it is no network port or not connected
+	static double roundTripMs(String const &portName);
+
+	// Runs until the process is killed, forwarding between the connected client and the given local ports
+	static int serve(int tcpPort, String const &outputName, String const &inputName, std::function<void(std::string const &)> print);
+
+	static constexpr int kDefaultPort = 21928;
+
+private:
+	class Client;
+	static std::vector<std::unique_ptr<Client>> sClients_;
+};
@@ -13,12 +13,12 @@
 	return { 14.0f };
 }*/
 
-/*void OrmLookAndFeel::drawButtonText(Graphics &g, TextButton &button, bool shouldDrawButtonAsHighlighted, bool shouldDrawButtonAsDown)
+void OrmLookAndFeel::drawButtonText(Graphics &g, TextButton &button, bool shouldDrawButtonAsHighlighted, bool shouldDrawButtonAsDown)
 {
 	ignoreUnused(shouldDrawButtonAsHighlighted, shouldDrawButtonAsDown);
 
+	// Same metrics as LookAndFeel_V2::drawButtonText
 	Font font(getTextButtonFont(button, button.getHeight()));
-	g.setFont(font);
 	g.setColour(button.findColour(button.getToggleState() ? TextButton::textColourOnId
 		: TextButton::textColourOffId)
 		.withMultipliedAlpha(button.isEnabled() ? 1.0f : 0.5f));
@@ -32,8 +32,58 @@
 	const int textWidth = button.getWidth() - leftIndent - rightIndent;
 
 	if (textWidth > 0) {
-		g.drawText(button.getButtonText(),
-			leftIndent, yIndent, textWidth, button.getHeight() - yIndent * 2,
-			Justification::centred, true);
+		drawFittedText(g, button.getButtonText(), font, { leftIndent, yIndent, textWidth, button.getHeight() - yIndent * 2 }, Justification::centred, 2, 0.0f);
 	}
-}*/
+}
+
+void OrmLookAndFeel::drawLabel(Graphics &g, Label &label)
+{
+	// Same as LookAndFeel_V2::drawLabel
+	g.fillAll(label.findColour(Label::backgroundColourId));
+
+	if (!label.isBeingEdited()) {
+		auto alpha = label.isEnabled() ? 1.0f : 0.5f;
+		const Font font(getLabelFont(label));
+
+		g.setColour(label.findColour(Label::textColourId).withMultipliedAlpha(alpha));
+
+		auto textArea = getLabelBorderSize(label).subtractedFrom(label.getLocalBounds());
+		drawFittedText(g, label.getText(), font, textArea, label.getJustificationType(),
+			jmax(1, (int) ((float) textArea.getHeight() / font.getHeight())), label.getMinimumHorizontalScale());
+
+		g.setColour(label.findColour(Label::outlineColourId).withMultipliedAlpha(alpha));
+	}
+	else if (label.isEnabled()) {
+		g.setColour(label.findColour(Label::outlineColourId));
+	}
+
+	g.drawRect(label.getLocalBounds());
+}
+
+void OrmLookAndFeel::drawFittedText(Graphics &g, String const &text, Font const &font, Rectangle<int> area, Justification justification, int maximumNumberOfLines, float minimumHorizontalScale)
+{
+	if (text.isEmpty() || area.isEmpty() || !g.getClipBounds().intersects(area)) {
+		return;
+	}
+
+	auto key = (text + "\n" + font.toString() + ":" + String(font.getHorizontalScale()) + ":" + String(font.getExtraKerningFactor())
+		+ "\n" + area.toString() + ":" + String(justification.getFlags()) + ":" + String(maximumNumberOfLines) + ":" + String(minimumHorizontalScale)).toStdString();
+	auto found = layoutByKey_.find(key);
+	if (found != layoutByKey_.end()) {
+		layouts_.splice(layouts_.begin(), layouts_, found->second);
+	}
+	else {
+		// This is what Graphics::drawFittedText does on every call
+		GlyphArrangement arrangement;
+		arrangement.addFittedText(font, text, (float) area.getX(), (float) area.getY(), (float) area.getWidth(), (float) area.getHeight(),
+			justification, maximumNumberOfLines, minimumHorizontalScale);
+		layouts_.emplace_front(key, std::move(arrangement));
+		layoutByKey_[key] = layouts_.begin();
+		if (layouts_.size() > kMaxLayouts) {
+			layoutByKey_.erase(layouts_.back().first);
+			layouts_.pop_back();
+		}
+	}
+	g.setFont(font);
+	layouts_.front().second.draw(g);
+}
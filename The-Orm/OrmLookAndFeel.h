@@ -8,9 +8,26 @@
 
 #include "JuceHeader.h"
 
+#include <list>
+#include <string>
+#include <unordered_map>
+
+// Draws button and label texts like LookAndFeel_V4, but keeps the laid out glyphs by text, font and bounds. Repainting
+// the patch grid, e.g. for the glow while dragging, then only draws the glyphs again instead of shaping all texts anew.
+// A new patch or a new size gives a new key, so nothing needs to be invalidated explicitly. Only used on the message thread
 class OrmLookAndFeel : public LookAndFeel_V4 {
 public:
 	//Font getTextButtonFont(TextButton&, int buttonHeight) override;
-	//void drawButtonText(Graphics&, TextButton&, bool shouldDrawButtonAsHighlighted, bool shouldDrawButtonAsDown) override;
+	void drawButtonText(Graphics&, TextButton&, bool shouldDrawButtonAsHighlighted, bool shouldDrawButtonAsDown) override;
+	void drawLabel(Graphics&, Label&) override;
+
+	static constexpr size_t kMaxLayouts = 1024;
+
+private:
+	void drawFittedText(Graphics &g, String const &text, Font const &font, Rectangle<int> area, Justification justification, int maximumNumberOfLines, float minimumHorizontalScale);
+
+	typedef std::list<std::pair<std::string, GlyphArrangement>> TLayouts;
+	TLayouts layouts_; // Most recently drawn first
+	std::unordered_map<std::string, TLayouts::iterator> layoutByKey_;
 };
 
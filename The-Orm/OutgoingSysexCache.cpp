@@ -0,0 +1,161 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "OutgoingSysexCache.h"
+
+#include "MemoryReport.h"
+
+#include "Capability.h"
+#include "EditBufferCapability.h"
+#include "MidiLocationCapability.h"
+#include "Patch.h"
+
+#include <fmt/format.h>
+
+OutgoingSysexCache::OutgoingSysexCache(size_t maxEntries) : maxEntries_(std::max(maxEntries, (size_t) 1))
+{
+	memoryProvider_ = MemoryReport::instance().addProvider("outgoing_sysex_cache", [this]() {
+		MemoryReport::Usage usage;
+		usage.bytes = memoryUsage(usage.objects);
+		return usage;
+	});
+}
+
+OutgoingSysexCache::~OutgoingSysexCache()
+{
+	MemoryReport::instance().removeProvider(memoryProvider_);
+	pool_.removeAllJobs(true, 10000);
+}
+
+std::string OutgoingSysexCache::keyOf(midikraft::PatchHolder const &patch)
+{
+	auto synth = patch.smartSynth();
+	if (!synth || !patch.patch()) {
+		return {};
+	}
+	int channel = 0;
+	if (auto location = midikraft::Capability::hasCapability<midikraft::MidiLocationCapability>(synth)) {
+		channel = location->channel().isValid() ? location->channel().toZeroBasedInt() : -1;
+	}
+	// FNV-1a over the bytes, an MD5 would cost more than a lookup is worth
+	auto const &data = patch.patch()->data();
+	uint64 hash = 14695981039346656037ull;
+	for (auto byte : data) {
+		hash = (hash ^ byte) * 1099511628211ull;
+	}
+	return fmt::format("{}|{}|{}|{:016x}", synth->getName(), channel, data.size(), hash);
+}
+
+std::vector<MidiMessage> OutgoingSysexCache::convert(midikraft::PatchHolder const &patch)
+{
+	auto synth = patch.smartSynth();
+	if (!synth || !patch.patch()) {
+		return {};
+	}
+	// patchToSysex only knows patches, other data files like tunings have their own layout
+	auto editBuffer = midikraft::Capability::hasCapability<midikraft::EditBufferCapability>(synth);
+	if (editBuffer && std::dynamic_pointer_cast<midikraft::Patch>(patch.patch())) {
+		return editBuffer->patchToSysex(patch.patch());
+	}
+	return synth->dataFileToSysex(patch.patch(), nullptr);
+}
+
+bool OutgoingSysexCache::lookup(std::string const &key, std::vector<MidiMessage> &outMessages)
+{
+	ScopedLock lock(lock_);
+	auto found = index_.find(key);
+	if (found == index_.end()) {
+		return false;
+	}
+	entries_.splice(entries_.begin(), entries_, found->second);
+	outMessages = found->second->messages;
+	return true;
+}
+
+void OutgoingSysexCache::store(std::string const &key, std::vector<MidiMessage> const &messages)
+{
+	ScopedLock lock(lock_);
+	auto found = index_.find(key);
+	if (found != index_.end()) {
+		entries_.erase(found->second);
+		index_.erase(found);
+	}
+	entries_.push_front({ key, messages });
+	index_[key] = entries_.begin();
+	while (entries_.size() > maxEntries_) {
+		index_.erase(entries_.back().key);
+		entries_.pop_back();
+	}
+}
+
+std::vector<MidiMessage> OutgoingSysexCache::editBufferMessages(midikraft::PatchHolder const &patch)
+{
+	auto key = keyOf(patch);
+	if (key.empty()) {
+		return {};
+	}
+	std::vector<MidiMessage> messages;
+	if (lookup(key, messages)) {
+		return messages;
+	}
+	messages = convert(patch);
+	if (!messages.empty()) {
+		store(key, messages);
+	}
+	return messages;
+}
+
+void OutgoingSysexCache::warm(std::vector<midikraft::PatchHolder> const &patches)
+{
+	// Only the page shown last is worth converting
+	pool_.removeAllJobs(false, 0);
+	pool_.addJob([this, patches]() {
+		for (auto const &patch : patches) {
+			if (pool_.getNumJobs() > 1) {
+				// A newer page is waiting
+				return;
+			}
+			auto key = keyOf(patch);
+			std::vector<MidiMessage> cached;
+			if (key.empty() || lookup(key, cached)) {
+				continue;
+			}
+			auto messages = convert(patch);
+			if (!messages.empty()) {
+				store(key, messages);
+			}
+		}
+	});
+}
+
+void OutgoingSysexCache::forgetSynth(std::string const &synthName)
+{
+	auto prefix = synthName + "|";
+	ScopedLock lock(lock_);
+	for (auto it = entries_.begin(); it != entries_.end();) {
+		if (it->key.compare(0, prefix.size(), prefix) == 0) {
+			index_.erase(it->key);
+			it = entries_.erase(it);
+		}
+		else {
+			it++;
+		}
+	}
+}
+
+size_t OutgoingSysexCache::memoryUsage(size_t &outEntries) const
+{
+	ScopedLock lock(lock_);
+	size_t bytes = 0;
+	for (auto const &entry : entries_) {
+		bytes += entry.key.size() + sizeof(Entry);
+		for (auto const &message : entry.messages) {
+			bytes += sizeof(MidiMessage) + (size_t) message.getRawDataSize();
+		}
+	}
+	outEntries = entries_.size();
+	return bytes;
+}
@@ -0,0 +1,52 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include "PatchHolder.h"
+
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// The messages that send a patch into the edit buffer of its synth, kept so that clicking through the patches does not convert each
+// one again, which for adaptations means calling into Python. Entries are keyed by the synth, its MIDI channel and the bytes of the
+// patch, so a renamed patch or a changed channel simply makes a new entry. The least recently used entries are dropped.
+class OutgoingSysexCache {
+public:
+	explicit OutgoingSysexCache(size_t maxEntries = 512);
+	~OutgoingSysexCache();
+
+	// Converts now if not cached. Patches go into the edit buffer if the synth has one, all other data through dataFileToSysex
+	std::vector<MidiMessage> editBufferMessages(midikraft::PatchHolder const &patch);
+	// Converts the patches not cached yet on a background thread, replacing what an earlier call still had to do
+	void warm(std::vector<midikraft::PatchHolder> const &patches);
+	// Drops all entries of that synth, e.g. because its adaptation was reloaded
+	void forgetSynth(std::string const &synthName);
+
+	size_t memoryUsage(size_t &outEntries) const;
+
+private:
+	struct Entry {
+		std::string key;
+		std::vector<MidiMessage> messages;
+	};
+
+	static std::string keyOf(midikraft::PatchHolder const &patch);
+	static std::vector<MidiMessage> convert(midikraft::PatchHolder const &patch);
+	bool lookup(std::string const &key, std::vector<MidiMessage> &outMessages);
+	void store(std::string const &key, std::vector<MidiMessage> const &messages);
+
+	size_t maxEntries_;
+	CriticalSection lock_;
+	std::list<Entry> entries_; // Most recently used first
+	std::unordered_map<std::string, std::list<Entry>::iterator> index_;
+	int memoryProvider_;
+	ThreadPool pool_{ 1 }; // Declared last so the running job finishes before the entries go away
+};
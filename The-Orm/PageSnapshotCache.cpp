@@ -0,0 +1,50 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "PageSnapshotCache.h"
+
+#include "PatchCountCache.h"
+
+#include <algorithm>
+
+PageSnapshotCache::PageSnapshotCache(size_t maxPages) : maxPages_(std::max(maxPages, (size_t) 1))
+{
+}
+
+std::string PageSnapshotCache::keyOf(midikraft::PatchFilter const &filter, int skip, int limit)
+{
+	return PatchCountCache::keyOf(filter) + "|" + std::to_string((int) filter.orderBy) + "|" + std::to_string(skip) + ":" + std::to_string(limit);
+}
+
+bool PageSnapshotCache::find(std::string const &key, DatabaseVersion::Stamp const &stamp, std::vector<midikraft::PatchHolder> &outPage)
+{
+	ScopedLock lock(lock_);
+	auto found = std::find_if(snapshots_.begin(), snapshots_.end(), [&key](Snapshot const &snapshot) { return snapshot.key == key; });
+	if (found == snapshots_.end()) {
+		return false;
+	}
+	if (found->stamp != stamp) {
+		// Something was written since, this will be loaded again anyway
+		snapshots_.erase(found);
+		return false;
+	}
+	snapshots_.splice(snapshots_.begin(), snapshots_, found);
+	outPage = snapshots_.front().page;
+	return true;
+}
+
+void PageSnapshotCache::store(std::string const &key, DatabaseVersion::Stamp const &stamp, std::vector<midikraft::PatchHolder> const &page)
+{
+	if (!stamp.isValid()) {
+		return;
+	}
+	ScopedLock lock(lock_);
+	snapshots_.remove_if([&key](Snapshot const &snapshot) { return snapshot.key == key; });
+	snapshots_.push_front({ key, stamp, page });
+	while (snapshots_.size() > maxPages_) {
+		snapshots_.pop_back();
+	}
+}
@@ -0,0 +1,41 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include "PatchHolder.h"
+#include "PatchDatabase.h"
+#include "DatabaseVersion.h"
+
+#include <list>
+#include <string>
+#include <vector>
+
+// The pages of the last few filters shown, so flipping between two imports or lists in the tree shows the patches without asking the
+// database again. A page is only handed out while nothing has been committed since it was loaded, so it is never outdated.
+class PageSnapshotCache {
+public:
+	explicit PageSnapshotCache(size_t maxPages = 8);
+
+	static std::string keyOf(midikraft::PatchFilter const &filter, int skip, int limit);
+
+	bool find(std::string const &key, DatabaseVersion::Stamp const &stamp, std::vector<midikraft::PatchHolder> &outPage);
+	// The stamp must have been taken before the page was requested
+	void store(std::string const &key, DatabaseVersion::Stamp const &stamp, std::vector<midikraft::PatchHolder> const &page);
+
+private:
+	struct Snapshot {
+		std::string key;
+		DatabaseVersion::Stamp stamp;
+		std::vector<midikraft::PatchHolder> page;
+	};
+
+	size_t maxPages_;
+	CriticalSection lock_;
+	std::list<Snapshot> snapshots_; // Most recently used first
+};
@@ -0,0 +1,46 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "ParallelFor.h"
+
+#include <algorithm>
+#include <atomic>
+
+bool parallelFor(size_t count, std::function<void(size_t)> body, std::function<bool(double)> const &progress, double from, double to, int maxThreads)
+{
+	if (count == 0) {
+		return true;
+	}
+
+	std::atomic<size_t> next(0);
+	std::atomic<size_t> done(0);
+	std::atomic<bool> aborted(false);
+	int numThreads = std::min(SystemStats::getNumCpus(), (int) count);
+	if (maxThreads > 0) {
+		numThreads = std::min(numThreads, maxThreads);
+	}
+	numThreads = std::max(1, numThreads);
+	{
+		ThreadPool pool(numThreads);
+		for (int i = 0; i < numThreads; i++) {
+			pool.addJob([&]() {
+				size_t index;
+				while (!aborted && (index = next++) < count) {
+					body(index);
+					done++;
+				}
+				return ThreadPoolJob::jobHasFinished;
+			});
+		}
+		while (pool.getNumJobs() > 0) {
+			if (!aborted && !progress(from + (to - from) * done / (double) count)) {
+				aborted = true;
+			}
+			Thread::sleep(20);
+		}
+	}
+	return !aborted;
+}
@@ -0,0 +1,17 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include <functional>
+
+// Runs body(i) for all i in [0, count) on one thread per core. The calling thread waits and reports the share done,
+// mapped into [from, to], to the progress function every few milliseconds. Return false from progress to abort, then
+// no further indexes are started and the function returns false once the running ones are done. maxThreads limits the
+// number of threads below the number of cores, 0 means no limit
+bool parallelFor(size_t count, std::function<void(size_t)> body, std::function<bool(double)> const &progress, double from = 0.0, double to = 1.0, int maxThreads = 0);
@@ -0,0 +1,221 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "ParallelThumbnailRecorder.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+	// Levels are linear sample values. The onset needs to stand out of the noise before the note, the release needs to fall
+	// back to it, with these as the lower limits for a very quiet input
+	constexpr float kMinOnsetLevel = 0.003f; // About -50 dBFS
+	constexpr float kOnsetOverNoise = 4.0f;
+	constexpr float kMinReleaseLevel = 0.001f; // -60 dBFS
+	constexpr double kReleaseHoldSeconds = 0.3;
+	constexpr double kMinLengthSeconds = 0.2;
+	constexpr double kReleaseTailSeconds = 0.05; // Of the quiet part at the end, keep a little
+
+}
+
+ParallelThumbnailRecorder::ParallelThumbnailRecorder(int maxChannels)
+{
+	for (int i = 0; i < maxChannels; i++) {
+		channels_.push_back(std::make_unique<Channel>());
+		channels_.back()->index = i;
+	}
+}
+
+int ParallelThumbnailRecorder::numInputChannels() const
+{
+	return std::min(numInputChannels_.load(), (int) channels_.size());
+}
+
+bool ParallelThumbnailRecorder::nextStateChange(int &outChannel)
+{
+	auto read = stateChanges_.read(1);
+	if (read.blockSize1 == 0) {
+		return false;
+	}
+	outChannel = changedChannels_[(size_t) read.startIndex1];
+	return true;
+}
+
+bool ParallelThumbnailRecorder::arm(int channel, double maxSeconds)
+{
+	auto sampleRate = sampleRate_.load();
+	if (channel < 0 || channel >= numInputChannels() || sampleRate <= 0.0) {
+		return false;
+	}
+	auto current = state(channel);
+	if (current != State::Idle && current != State::Done) {
+		return false;
+	}
+	auto &c = *channels_[(size_t) channel];
+	c.stopRequested = false;
+	c.buffer.setSize(1, (int) (maxSeconds * sampleRate), false, false, true);
+	c.length = 0;
+	c.noisePeak = 0.0f;
+	c.quietSamples = 0;
+	c.truncated = false;
+	// Publishes the buffer to the audio thread
+	c.state.store((int) State::Armed, std::memory_order_release);
+	return true;
+}
+
+void ParallelThumbnailRecorder::disarm(int channel)
+{
+	if (channel >= 0 && channel < (int) channels_.size()) {
+		channels_[(size_t) channel]->stopRequested = true;
+	}
+}
+
+ParallelThumbnailRecorder::State ParallelThumbnailRecorder::state(int channel) const
+{
+	if (channel < 0 || channel >= (int) channels_.size()) {
+		return State::Idle;
+	}
+	return (State) channels_[(size_t) channel]->state.load(std::memory_order_acquire);
+}
+
+double ParallelThumbnailRecorder::onsetTimeMs(int channel) const
+{
+	return channel >= 0 && channel < (int) channels_.size() ? channels_[(size_t) channel]->onsetMs.load() : 0.0;
+}
+
+bool ParallelThumbnailRecorder::truncated(int channel) const
+{
+	return state(channel) == State::Done && channels_[(size_t) channel]->truncated;
+}
+
+bool ParallelThumbnailRecorder::writeWav(int channel, File const &file)
+{
+	if (state(channel) != State::Done) {
+		return false;
+	}
+	auto &c = *channels_[(size_t) channel];
+	file.deleteFile();
+	bool ok = false;
+	auto stream = file.createOutputStream();
+	if (stream) {
+		WavAudioFormat wav;
+		std::unique_ptr<AudioFormatWriter> writer(wav.createWriterFor(stream.get(), sampleRate_.load(), 1, 16, {}, 0));
+		if (writer) {
+			// The writer owns the stream now
+			stream.release();
+			ok = writer->writeFromAudioSampleBuffer(c.buffer, 0, c.length);
+		}
+	}
+	c.state = (int) State::Idle;
+	return ok;
+}
+
+void ParallelThumbnailRecorder::discard(int channel)
+{
+	if (state(channel) == State::Done) {
+		channels_[(size_t) channel]->state = (int) State::Idle;
+	}
+}
+
+void ParallelThumbnailRecorder::audioDeviceIOCallback(const float **inputChannelData, int numInputChannels, float **outputChannelData, int numOutputChannels, int numSamples)
+{
+	for (int i = 0; i < numOutputChannels; i++) {
+		if (outputChannelData[i]) {
+			FloatVectorOperations::clear(outputChannelData[i], numSamples);
+		}
+	}
+	numInputChannels_ = numInputChannels;
+	for (int i = 0; i < numInputChannels && i < (int) channels_.size(); i++) {
+		if (inputChannelData[i]) {
+			process(*channels_[(size_t) i], inputChannelData[i], numSamples);
+		}
+	}
+}
+
+void ParallelThumbnailRecorder::process(Channel &channel, float const *samples, int numSamples)
+{
+	auto state = (State) channel.state.load(std::memory_order_acquire);
+	if (state != State::Armed && state != State::Recording) {
+		return;
+	}
+	if (channel.stopRequested.load()) {
+		changeState(channel, State::Done);
+		return;
+	}
+
+	// The peak is all an armed channel needs, and findMinAndMax is vectorized
+	auto range = FloatVectorOperations::findMinAndMax(samples, numSamples);
+	float peak = std::max(range.getEnd(), -range.getStart());
+
+	auto sampleRate = sampleRate_.load();
+	if (state == State::Armed) {
+		float onsetLevel = std::max(kMinOnsetLevel, channel.noisePeak * kOnsetOverNoise);
+		if (peak < onsetLevel) {
+			channel.noisePeak = std::max(channel.noisePeak, peak);
+			return;
+		}
+		// Start the recording at the first sample above the onset level, not at the start of the block
+		int onset = 0;
+		while (onset < numSamples && std::abs(samples[onset]) < onsetLevel) {
+			onset++;
+		}
+		channel.onsetMs = Time::getMillisecondCounterHiRes() - 1000.0 * (numSamples - onset) / std::max(1.0, sampleRate);
+		changeState(channel, State::Recording);
+		samples += onset;
+		numSamples -= onset;
+	}
+
+	float sumOfSquares = 0.0f;
+	for (int i = 0; i < numSamples; i++) {
+		sumOfSquares += samples[i] * samples[i];
+	}
+
+	int toCopy = std::min(numSamples, channel.buffer.getNumSamples() - channel.length);
+	channel.buffer.copyFrom(0, channel.length, samples, toCopy);
+	channel.length += toCopy;
+	if (toCopy < numSamples) {
+		channel.truncated = true;
+		changeState(channel, State::Done);
+		return;
+	}
+
+	float rms = std::sqrt(sumOfSquares / (float) std::max(1, numSamples));
+	if (rms < std::max(kMinReleaseLevel, channel.noisePeak)) {
+		channel.quietSamples += numSamples;
+	}
+	else {
+		channel.quietSamples = 0;
+	}
+	if (channel.quietSamples >= (int) (kReleaseHoldSeconds * sampleRate) && channel.length >= (int) (kMinLengthSeconds * sampleRate)) {
+		// Released, drop most of the silence at the end
+		channel.length = std::max((int) (kMinLengthSeconds * sampleRate), channel.length - channel.quietSamples + (int) (kReleaseTailSeconds * sampleRate));
+		changeState(channel, State::Done);
+	}
+}
+
+void ParallelThumbnailRecorder::changeState(Channel &channel, State newState)
+{
+	channel.state.store((int) newState, std::memory_order_release);
+	auto write = stateChanges_.write(1);
+	if (write.blockSize1 > 0) {
+		changedChannels_[(size_t) write.startIndex1] = channel.index;
+	}
+}
+
+void ParallelThumbnailRecorder::audioDeviceAboutToStart(AudioIODevice *device)
+{
+	sampleRate_ = device->getCurrentSampleRate();
+	numInputChannels_ = device->getActiveInputChannels().countNumberOfSetBits();
+}
+
+void ParallelThumbnailRecorder::audioDeviceStopped()
+{
+	sampleRate_ = 0.0;
+	for (auto &channel : channels_) {
+		channel->state = (int) State::Idle;
+	}
+}
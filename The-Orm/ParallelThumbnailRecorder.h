@@ -0,0 +1,73 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+// Records the sample notes of several synths at once, each on its own input channel of the audio device. Per channel a recording is
+// armed, starts with the onset of the note and ends with its release, so neither the silence before nor after the note costs time.
+// The audio callback neither allocates nor locks, the buffers are prepared when arming. Channels are the active input channels of the
+// device in order, arm, poll and write from one worker thread.
+class ParallelThumbnailRecorder : public AudioIODeviceCallback {
+public:
+	enum class State { Idle, Armed, Recording, Done };
+
+	explicit ParallelThumbnailRecorder(int maxChannels = 16);
+
+	int numInputChannels() const;
+
+	// Pops the next channel that moved on from Armed or Recording, in the order the audio thread saw them. Lock-free, the audio thread
+	// pushes and one worker polls, waking a thread up would take a lock on the audio thread. Changes beyond kMaxStateChanges
+	// unread ones are dropped, state() is always current
+	bool nextStateChange(int &outChannel);
+	static constexpr int kMaxStateChanges = 64;
+
+	// Returns false if the device is not running, there is no such channel or the channel is still busy
+	bool arm(int channel, double maxSeconds);
+	// Stops a running recording, the channel becomes Done with whatever was recorded so far
+	void disarm(int channel);
+	State state(int channel) const;
+	// The Time::getMillisecondCounterHiRes() when the onset was detected, valid from Recording on
+	double onsetTimeMs(int channel) const;
+	// The recording hit its maximum length, e.g. a drone that never releases
+	bool truncated(int channel) const;
+	// When Done, writes the recording and makes the channel Idle again
+	bool writeWav(int channel, File const &file);
+	// When Done, drops the recording and makes the channel Idle again
+	void discard(int channel);
+
+	void audioDeviceIOCallback(const float **inputChannelData, int numInputChannels, float **outputChannelData, int numOutputChannels, int numSamples) override;
+	void audioDeviceAboutToStart(AudioIODevice *device) override;
+	void audioDeviceStopped() override;
+
+private:
+	struct Channel {
+		int index = 0;
+		std::atomic<int> state{ (int) State::Idle }; // Only the audio thread leaves Armed and Recording, so it owns the buffer then
+		std::atomic<bool> stopRequested{ false };
+		AudioBuffer<float> buffer;
+		int length = 0;
+		float noisePeak = 0.0f; // Loudest block before the onset
+		int quietSamples = 0;
+		bool truncated = false;
+		std::atomic<double> onsetMs{ 0.0 };
+	};
+
+	void process(Channel &channel, float const *samples, int numSamples);
+	void changeState(Channel &channel, State newState);
+
+	std::vector<std::unique_ptr<Channel>> channels_;
+	std::atomic<double> sampleRate_{ 0.0 };
+	std::atomic<int> numInputChannels_{ 0 };
+	AbstractFifo stateChanges_{ kMaxStateChanges };
+	std::array<int, kMaxStateChanges> changedChannels_{};
+};
@@ -0,0 +1,139 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "ParameterChangeCoalescer.h"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+
+namespace {
+
+	// NRPN and RPN parameter number controllers, MSB and LSB
+	constexpr int kNrpnMsb = 99;
+	constexpr int kNrpnLsb = 98;
+	constexpr int kRpnMsb = 101;
+	constexpr int kRpnLsb = 100;
+
+}
+
+ParameterChangeCoalescer::ParameterChangeCoalescer(int frameMs) : frameMs_(frameMs)
+{
+}
+
+ParameterChangeCoalescer::~ParameterChangeCoalescer()
+{
+	// The last value of every parameter is delivered, also when the editor closes within a frame. The owning component goes away
+	// with the main window, before the MIDI outputs are shut down
+	stopTimer();
+	flush();
+}
+
+void ParameterChangeCoalescer::post(midikraft::Synth *synth, juce::MidiDeviceInfo const &output, std::string const &parameter, std::vector<MidiMessage> const &messages)
+{
+	if (!synth || messages.empty()) {
+		return;
+	}
+
+	if (!isTimerRunning()) {
+		// Quiet before, send right away for the lowest latency and open a new frame
+		send(synth, output, messages);
+		startTimer(frameMs_);
+		return;
+	}
+
+	auto key = std::make_pair(output.identifier, parameter);
+	auto found = pending_.find(key);
+	if (found != pending_.end()) {
+		found->second.messages = messages;
+		superseded_++;
+	}
+	else {
+		pending_.emplace(key, Change{ synth, output, messages, order_++ });
+	}
+}
+
+void ParameterChangeCoalescer::flush()
+{
+	if (pending_.empty()) {
+		return;
+	}
+
+	std::vector<Change const *> changes;
+	for (auto const &change : pending_) {
+		changes.push_back(&change.second);
+	}
+	std::sort(changes.begin(), changes.end(), [](Change const *a, Change const *b) {
+		if (a->output.identifier != b->output.identifier) {
+			return a->output.identifier < b->output.identifier;
+		}
+		return a->order < b->order;
+	});
+
+	// One block per output, so the NRPN elision can see consecutive changes
+	std::vector<MidiMessage> block;
+	for (size_t i = 0; i < changes.size(); i++) {
+		block.insert(block.end(), changes[i]->messages.begin(), changes[i]->messages.end());
+		if (i + 1 == changes.size() || changes[i + 1]->output.identifier != changes[i]->output.identifier) {
+			send(changes[i]->synth, changes[i]->output, block);
+			block.clear();
+		}
+	}
+	pending_.clear();
+
+	if (superseded_ > 0) {
+		spdlog::trace("Dropped {} superseded parameter changes", superseded_);
+		superseded_ = 0;
+	}
+}
+
+void ParameterChangeCoalescer::timerCallback()
+{
+	if (pending_.empty()) {
+		// A full frame without changes, the next one can go out immediately again
+		stopTimer();
+		return;
+	}
+	flush();
+}
+
+void ParameterChangeCoalescer::send(midikraft::Synth *synth, juce::MidiDeviceInfo const &output, std::vector<MidiMessage> const &messages)
+{
+	synth->sendBlockOfMessagesToSynth(output, elideRepeatedNrpnSelection(messages));
+}
+
+std::vector<MidiMessage> ParameterChangeCoalescer::elideRepeatedNrpnSelection(std::vector<MidiMessage> const &messages)
+{
+	// Currently selected parameter number controller values per channel, -1 is unknown
+	int selection[16][4];
+	std::fill(&selection[0][0], &selection[0][0] + 16 * 4, -1);
+
+	std::vector<MidiMessage> result;
+	result.reserve(messages.size());
+	for (auto const &message : messages) {
+		if (message.isController()) {
+			int number = message.getControllerNumber();
+			int slot = number == kNrpnMsb ? 0 : number == kNrpnLsb ? 1 : number == kRpnMsb ? 2 : number == kRpnLsb ? 3 : -1;
+			if (slot != -1) {
+				int &selected = selection[message.getChannel() - 1][slot];
+				if (selected == message.getControllerValue()) {
+					continue;
+				}
+				selected = message.getControllerValue();
+				if (slot == 0 || slot == 2) {
+					// Some synths reset the LSB with a new MSB, so always follow up with it
+					selection[message.getChannel() - 1][slot + 1] = -1;
+				}
+				// Selecting an NRPN deselects the RPN and vice versa
+				int other = slot < 2 ? 2 : 0;
+				selection[message.getChannel() - 1][other] = -1;
+				selection[message.getChannel() - 1][other + 1] = -1;
+			}
+		}
+		result.push_back(message);
+	}
+	return result;
+}
@@ -0,0 +1,50 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include "Synth.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+// Throttles live parameter edits, so a fast knob turn does not overflow slow synths. The first change after a quiet frame is sent
+// immediately, further changes within the frame are collected and only the latest value of each parameter is sent when the frame ends.
+// Superseded values are dropped, but the last value of every parameter is always delivered. Message thread only.
+class ParameterChangeCoalescer : private Timer {
+public:
+	explicit ParameterChangeCoalescer(int frameMs = 20);
+	~ParameterChangeCoalescer() override;
+
+	// The messages set the parameter to its new value, replacing any change of the same parameter not sent yet
+	void post(midikraft::Synth *synth, juce::MidiDeviceInfo const &output, std::string const &parameter, std::vector<MidiMessage> const &messages);
+
+	// Sends all pending changes now
+	void flush();
+
+	// Drops NRPN parameter selections repeating the one already active on the channel, these make up half of the traffic of an
+	// NRPN stream. Only applied within one block, as other senders might have changed the selection in between
+	static std::vector<MidiMessage> elideRepeatedNrpnSelection(std::vector<MidiMessage> const &messages);
+
+private:
+	struct Change {
+		midikraft::Synth *synth;
+		juce::MidiDeviceInfo output;
+		std::vector<MidiMessage> messages;
+		uint64 order; // Changes are sent in the order their parameter was first touched
+	};
+
+	void timerCallback() override;
+	void send(midikraft::Synth *synth, juce::MidiDeviceInfo const &output, std::vector<MidiMessage> const &messages);
+
+	int frameMs_;
+	std::map<std::pair<String, std::string>, Change> pending_; // By output identifier and parameter
+	uint64 order_ = 0;
+	uint64 superseded_ = 0;
+};
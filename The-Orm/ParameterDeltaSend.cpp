@@ -0,0 +1,113 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "ParameterDeltaSend.h"
+
+#include "Capability.h"
+#include "DetailedParametersCapability.h"
+#include "SynthParameterDefinition.h"
+#include "Settings.h"
+
+namespace {
+	size_t bytesOf(std::vector<MidiMessage> const &messages) {
+		size_t result = 0;
+		for (auto const &message : messages) {
+			result += (size_t)message.getRawDataSize();
+		}
+		return result;
+	}
+}
+
+bool ParameterDeltaSend::deltaMessages(midikraft::PatchHolder const &target, std::vector<MidiMessage> const &fullDump, std::vector<MidiMessage> &outMessages) const
+{
+	auto synth = target.smartSynth();
+	if (!enabled() || !synth || !target.patch()) {
+		return false;
+	}
+	auto last = lastSent_.find(synth->getName());
+	if (last == lastSent_.end() || !last->second.patch()) {
+		return false;
+	}
+	auto detailedParameters = midikraft::Capability::hasCapability<midikraft::DetailedParametersCapability>(target.patch());
+	auto const &from = last->second.patch()->data();
+	auto const &to = target.patch()->data();
+	if (!detailedParameters || from.size() != to.size()) {
+		return false;
+	}
+
+	std::vector<MidiMessage> delta;
+	std::vector<bool> covered(to.size(), false);
+	size_t fullSize = bytesOf(fullDump);
+	for (auto const &param : detailedParameters->allParameterDefinitions()) {
+		auto intParam = midikraft::Capability::hasCapability<midikraft::SynthIntParameterCapability>(param);
+		auto liveEdit = midikraft::Capability::hasCapability<midikraft::SynthParameterLiveEditCapability>(param);
+		if (!intParam || !liveEdit) {
+			continue;
+		}
+		if (auto layered = midikraft::Capability::hasCapability<midikraft::SynthMultiLayerParameterCapability>(param)) {
+			if (layered->getSourceLayer() != layered->getTargetLayer()) {
+				// Set up for copying between layers, the bytes read are not those written
+				return false;
+			}
+		}
+		int first = intParam->sysexIndex();
+		int end = first;
+		if (auto vectorParam = midikraft::Capability::hasCapability<midikraft::SynthVectorParameterCapability>(param)) {
+			end = vectorParam->endSysexIndex();
+		}
+		if (first < 0 || end >= (int)to.size()) {
+			continue;
+		}
+		bool differs = false;
+		for (int i = first; i <= end; i++) {
+			covered[(size_t)i] = true;
+			differs = differs || from[(size_t)i] != to[(size_t)i];
+		}
+		if (differs) {
+			auto messages = liveEdit->setValueMessages(target.patch(), synth.get());
+			if (messages.empty()) {
+				return false;
+			}
+			delta.insert(delta.end(), messages.begin(), messages.end());
+			if (bytesOf(delta) >= fullSize) {
+				return false;
+			}
+		}
+	}
+
+	// A difference outside of the parameters, like the name or the second layer, needs the full dump
+	for (size_t i = 0; i < to.size(); i++) {
+		if (from[i] != to[i] && !covered[i]) {
+			return false;
+		}
+	}
+	outMessages = std::move(delta);
+	return true;
+}
+
+void ParameterDeltaSend::sent(midikraft::PatchHolder const &patch)
+{
+	if (patch.smartSynth()) {
+		lastSent_[patch.smartSynth()->getName()] = patch;
+	}
+}
+
+void ParameterDeltaSend::forget(std::shared_ptr<midikraft::Synth> synth)
+{
+	if (synth) {
+		lastSent_.erase(synth->getName());
+	}
+}
+
+bool ParameterDeltaSend::enabled()
+{
+	return Settings::instance().get("ParameterDeltaSend", "0") == "1";
+}
+
+void ParameterDeltaSend::setEnabled(bool enabled)
+{
+	Settings::instance().set("ParameterDeltaSend", enabled ? "1" : "0");
+}
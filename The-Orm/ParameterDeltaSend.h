@@ -0,0 +1,33 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include "PatchHolder.h"
+
+#include <map>
+
+// Switching between similar patches of a synth with live editable parameters, like the NRPNs of the Rev2, can send
+// only the parameters differing from the patch last sent into the edit buffer instead of the full dump. The delta is
+// only used when it is shorter than the dump and every byte in which the patches differ belongs to such a parameter,
+// so the synth ends up with the same sound. Off by default, as edits made on the synth itself are not known here
+class ParameterDeltaSend {
+public:
+	// The messages turning the patch last sent to the target's synth into the target, false if the full dump should go out
+	bool deltaMessages(midikraft::PatchHolder const &target, std::vector<MidiMessage> const &fullDump, std::vector<MidiMessage> &outMessages) const;
+	// Call whenever a patch went into the edit buffer of its synth, by dump or by delta
+	void sent(midikraft::PatchHolder const &patch);
+	// The edit buffer of the synth is not known anymore, e.g. after a program change
+	void forget(std::shared_ptr<midikraft::Synth> synth);
+
+	static bool enabled();
+	static void setEnabled(bool enabled);
+
+private:
+	std::map<std::string, midikraft::PatchHolder> lastSent_; // By synth name
+};
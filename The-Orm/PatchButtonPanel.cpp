@@ -8,10 +8,14 @@
 
 #include "Patch.h"
 #include "UIModel.h"
+#include "PatchStateStore.h"
 
 #include "ColourHelpers.h"
 #include "LayoutConstants.h"
 #include "Settings.h"
+#include "SettingsWriteQueue.h"
+#include "MemoryReport.h"
+#include "Tracer.h"
 
 #include <algorithm>
 #include <fmt/format.h>
@@ -30,8 +34,8 @@ PatchButtonPanel::PatchButtonPanel(std::function<void(midikraft::PatchHolder &)>
 
 	// Load the last size of the slider position
 	if (UIModel::currentSynth()) {
-		auto sliderX = Settings::instance().get(settingName(SliderAxis::X_AXIS), 8);
-		auto sliderY = Settings::instance().get(settingName(SliderAxis::Y_AXIS), 8);
+		auto sliderX = SettingsWriteQueue::instance().get(settingName(SliderAxis::X_AXIS), 8);
+		auto sliderY = SettingsWriteQueue::instance().get(settingName(SliderAxis::Y_AXIS), 8);
 		if (sliderX != 0) {
 			gridWidth_ = sliderX;
 			gridSizeSliderX_.setValue(sliderX, dontSendNotification);
@@ -52,6 +56,7 @@ PatchButtonPanel::PatchButtonPanel(std::function<void(midikraft::PatchHolder &)>
 
 	patchButtons_ = std::make_unique<PatchButtonGrid<PatchHolderButton>>(gridWidth_, gridHeight_, [this](int index) { buttonClicked(index, true); });
 	addAndMakeVisible(patchButtons_.get());
+	patchButtons_->addMouseListener(this, true); // For the right click on the buttons
 
 	addAndMakeVisible(pageUp_); 
 	pageUp_.setButtonText(">");
@@ -63,14 +68,14 @@ PatchButtonPanel::PatchButtonPanel(std::function<void(midikraft::PatchHolder &)>
 	gridSizeSliderX_.onValueChange = [this]() {
 		int newX = (int) gridSizeSliderX_.getValue();
 		if (UIModel::currentSynth()) {
-			Settings::instance().set(settingName(SliderAxis::X_AXIS), String(newX).toStdString());
+			SettingsWriteQueue::instance().set(settingName(SliderAxis::X_AXIS), String(newX).toStdString());
 		}
 		this->changeGridSize(newX, gridHeight_);
 	};
 	gridSizeSliderY_.onValueChange = [this]() {
 		int newY = (int)gridSizeSliderY_.getValue();
 		if (UIModel::currentSynth()) {
-			Settings::instance().set(settingName(SliderAxis::Y_AXIS), String(newY).toStdString());
+			SettingsWriteQueue::instance().set(settingName(SliderAxis::Y_AXIS), String(newY).toStdString());
 		}
 		this->changeGridSize(gridWidth_, newY);
 	};
@@ -97,16 +102,50 @@ PatchButtonPanel::PatchButtonPanel(std::function<void(midikraft::PatchHolder &)>
 		pageNumbers_.add(std::move(b));
 	}
 
-	UIModel::instance()->currentSynth_.addChangeListener(this);
-	UIModel::instance()->thumbnails_.addChangeListener(this);
-	UIModel::instance()->multiMode_.addChangeListener(this);
+	UIModel::instance()->modelChanges_.addListener(this);
+
+	// The shown page and the cached pages share most of their patches, so the copies are counted as holders, and the data only once
+	auto &memory = MemoryReport::instance();
+	memoryProviders_.push_back(memory.addProvider("patch_holders_in_views", [this]() {
+		MemoryReport::Usage usage;
+		usage.objects = patches_.size();
+		for (auto const &page : pageCache_) {
+			usage.objects += page.patches.size();
+		}
+		usage.bytes = usage.objects * sizeof(midikraft::PatchHolder);
+		return usage;
+	}));
+	memoryProviders_.push_back(memory.addProvider("datafile_payloads_in_views", [this]() {
+		MemoryReport::Usage usage;
+		std::set<midikraft::DataFile const *> counted;
+		auto add = [&](std::vector<midikraft::PatchHolder> const &patches) {
+			for (auto const &patch : patches) {
+				auto data = patch.patch();
+				if (data && counted.insert(data.get()).second) {
+					usage.bytes += data->data().size();
+					usage.objects++;
+				}
+			}
+		};
+		add(patches_);
+		for (auto const &page : pageCache_) {
+			add(page.patches);
+		}
+		return usage;
+	}));
+	memoryProviders_.push_back(memory.addProvider("decoded_thumbnails", [this]() {
+		MemoryReport::Usage usage;
+		usage.objects = thumbnailLoader_.decodedCount();
+		return usage;
+	}, false));
 }
 
 PatchButtonPanel::~PatchButtonPanel()
 {
-	UIModel::instance()->currentSynth_.removeChangeListener(this);
-	UIModel::instance()->thumbnails_.removeChangeListener(this);
-	UIModel::instance()->multiMode_.removeChangeListener(this);
+	for (auto provider : memoryProviders_) {
+		MemoryReport::instance().removeProvider(provider);
+	}
+	UIModel::instance()->modelChanges_.removeListener(this);
 }
 
 std::string PatchButtonPanel::settingName(SliderAxis axis)
@@ -128,8 +167,8 @@ std::string PatchButtonPanel::settingName(SliderAxis axis)
 void PatchButtonPanel::refreshGridSize()
 {
 	if (UIModel::currentSynth()) {
-		int newX = Settings::instance().get(settingName(SliderAxis::X_AXIS), 8);
-		int newY = Settings::instance().get(settingName(SliderAxis::Y_AXIS), 8);
+		int newX = SettingsWriteQueue::instance().get(settingName(SliderAxis::X_AXIS), 8);
+		int newY = SettingsWriteQueue::instance().get(settingName(SliderAxis::Y_AXIS), 8);
 		changeGridSize(newX, newY);
 		gridSizeSliderX_.setValue(newX, dontSendNotification);
 		gridSizeSliderY_.setValue(newY, dontSendNotification);
@@ -146,13 +185,30 @@ void PatchButtonPanel::setPatchLoader(TPageLoader pageGetter)
 
 void PatchButtonPanel::setTotalCount(int totalCount)
 {
+	invalidatePageCache();
 	pageBase_ = pageNumber_ = 0;
 	totalSize_ = totalCount;
 	numPages_ = totalCount / pageSize_;
 	if (totalCount % pageSize_ != 0) numPages_++;
 }
 
+void PatchButtonPanel::updateTotalCount(int totalCount)
+{
+	totalSize_ = totalCount;
+	numPages_ = totalCount / pageSize_;
+	if (totalCount % pageSize_ != 0) numPages_++;
+	if (pageNumber_ >= numPages_) {
+		pageBase_ = pageNumber_ = 0;
+	}
+	setupPageButtons();
+}
+
 void PatchButtonPanel::changeGridSize(int newWidth, int newHeight) {
+	if (patchButtons_ && newWidth == gridWidth_ && newHeight == gridHeight_) {
+		// Most synth switches keep the size, the buttons there are rebound by the next refresh
+		return;
+	}
+
 	// Remove old patch grid
 	removeChildComponent(patchButtons_.get());
 
@@ -164,6 +220,8 @@ void PatchButtonPanel::changeGridSize(int newWidth, int newHeight) {
 	if (totalSize_ % pageSize_ != 0) numPages_++;
 	patchButtons_ = std::make_unique<PatchButtonGrid<PatchHolderButton>>(gridWidth_, gridHeight_, [this](int index) { buttonClicked(index, true); });
 	addAndMakeVisible(patchButtons_.get());
+	patchButtons_->addMouseListener(this, true); // For the right click on the buttons
+	thumbnailMd5_.clear(); // New buttons, none has a thumbnail yet
 
 	resized();
 	refresh(true, indexOfActive());
@@ -211,6 +269,9 @@ void PatchButtonPanel::setupPageButtons() {
 
 void PatchButtonPanel::setPatches(std::vector<midikraft::PatchHolder> const &patches, int autoSelectTarget /* = -1 */) {
 	patches_ = patches;
+	if (onPatchesShown) {
+		onPatchesShown(patches_);
+	}
 	// This is never an async refresh, as we might be just processing the result of an async operation, and then we'd go into a loop
 	refresh(false);
 	if (autoSelectTarget != -1) {
@@ -229,44 +290,70 @@ String PatchButtonPanel::createNameOfThubnailCacheFile(midikraft::PatchHolder co
 	return thumbnailCache.getFullPathName();
 }
 
-File PatchButtonPanel::findPrehearFile(midikraft::PatchHolder const &patch) {
+void PatchButtonPanel::refreshThumbnail(int i) {
 	// Check we are not too early or there is no patch to lookup
-	if (!UIModel::currentSynth()) return File();
-	if (!patch.patch()) return File();
-
-	// First check the cache
-	File thumbnailCache(createNameOfThubnailCacheFile(patch));
-	if (thumbnailCache.existsAsFile()) {
-		return thumbnailCache;
+	if (!UIModel::currentSynth() || !patches_[i].patch()) {
+		patchButtons_->buttonWithIndex(i)->clearThumbnailFile();
+		return;
 	}
-
-	File prehear = UIModel::getPrehearDirectory().getChildFile(patch.md5() + ".wav");
-	if (prehear.existsAsFile()) {
-		return prehear;
+	auto md5 = patches_[i].md5();
+	File thumbnailCache(createNameOfThubnailCacheFile(patches_[i]));
+	File prehear = UIModel::getPrehearDirectory().getChildFile(md5 + ".wav");
+	ThumbnailLoader::Result known;
+	Component::SafePointer<PatchButtonPanel> safeThis(this);
+	if (thumbnailLoader_.resolve(md5, thumbnailCache, prehear, known, [safeThis, i, md5](ThumbnailLoader::Result result) {
+		// Fill in when ready, unless the button shows something else by now
+		if (safeThis && i < (int) safeThis->patches_.size() && safeThis->patches_[i].md5() == md5) {
+			safeThis->applyThumbnail(i, result);
+		}
+	})) {
+		applyThumbnail(i, known);
 	}
-	return File();
 }
 
-void PatchButtonPanel::refreshThumbnail(int i) {
-	File thumbnail = findPrehearFile(patches_[i]);
-	if (thumbnail.existsAsFile()) {
-		if (thumbnail.getFileExtension() == ".wav") {
-			patchButtons_->buttonWithIndex(i)->setThumbnailFile(thumbnail.getFullPathName().toStdString(), createNameOfThubnailCacheFile(patches_[i]).toStdString());
-		}
-		else {
-			patchButtons_->buttonWithIndex(i)->setThumbnailFromCache(Thumbnail::loadCacheInfo(thumbnail));
-		}
-	}
-	else {
-		patchButtons_->buttonWithIndex(i)->clearThumbnailFile();
+void PatchButtonPanel::applyThumbnail(int i, ThumbnailLoader::Result const &result)
+{
+	if (i >= (int) patchButtons_->size()) return;
+	auto button = patchButtons_->buttonWithIndex(i);
+	switch (result.kind) {
+	case ThumbnailLoader::Result::Kind::WavFile:
+		button->setThumbnailFile(result.wavFile.getFullPathName().toStdString(), createNameOfThubnailCacheFile(patches_[i]).toStdString());
+		break;
+	case ThumbnailLoader::Result::Kind::CacheInfo:
+		button->setThumbnailFromCache(*result.cacheInfo);
+		break;
+	case ThumbnailLoader::Result::Kind::None:
+		button->clearThumbnailFile();
+		break;
 	}
 }
 
 void PatchButtonPanel::refresh(bool async, int autoSelectTarget /* = -1 */) {
+	TraceScope trace("PatchButtonPanel::refresh", "ui");
 	if (pageLoader_ && async) {
+		std::vector<midikraft::PatchHolder> cached;
+		if (findCachedPage(pageBase_, pageSize_, cached)) {
+			// Read ahead already got this one, no need to wait
+			setPatches(cached, autoSelectTarget);
+			prefetchAround(pageBase_);
+			return;
+		}
 		// If a page loader was set, we will query the current page
-		pageLoader_(pageBase_, pageSize_, [this, autoSelectTarget](std::vector<midikraft::PatchHolder> const &patches) {
- 			setPatches(patches, autoSelectTarget);
+		int base = pageBase_;
+		int size = pageSize_;
+		int generation = cacheGeneration_;
+		pagesInFlight_.insert(base);
+		pageLoader_(base, size, [this, base, size, generation, autoSelectTarget](std::vector<midikraft::PatchHolder> const &patches) {
+			if (generation != cacheGeneration_) {
+				// Result for an older filter, the new one is on its way
+				return;
+			}
+			pagesInFlight_.erase(base);
+			storeCachedPage(base, size, patches);
+			if (base == pageBase_ && size == pageSize_) {
+				setPatches(patches, autoSelectTarget);
+				prefetchAround(base);
+			}
 		});
 		return;
 	}
@@ -275,6 +362,9 @@ void PatchButtonPanel::refresh(bool async, int autoSelectTarget /* = -1 */) {
 
 	// Now set the button text and colors
 	int active = indexOfActive();
+	if (thumbnailMd5_.size() != patchButtons_->size()) {
+		thumbnailMd5_.assign(patchButtons_->size(), "");
+	}
 	for (size_t i = 0; i < std::max(patchButtons_->size(), patches_.size()); i++) {
 		if (i < patchButtons_->size()) {
 			auto button = patchButtons_->buttonWithIndex((int) i);
@@ -286,14 +376,26 @@ void PatchButtonPanel::refresh(bool async, int autoSelectTarget /* = -1 */) {
 						);
 				}
 				button->setPatchHolder(&patches_[i], static_cast<int>(i) == active, displayMode);
-				refreshThumbnail((int)i);
+				// Looking for thumbnails hits the disk, only do that when the button shows a different patch than before
+				if (thumbnailMd5_[i] != patches_[i].md5()) {
+					refreshThumbnail((int)i);
+					thumbnailMd5_[i] = patches_[i].md5();
+				}
 			}
 			else {
 				button->setPatchHolder(nullptr, false, PatchButtonInfo::CenterName);
-				button->clearThumbnailFile();
+				button->setMarked(false);
+				if (!thumbnailMd5_[i].empty()) {
+					button->clearThumbnailFile();
+					thumbnailMd5_[i].clear();
+				}
 			}
 		}
 	}
+	// The marks stay across pages, and setPatchHolder() reset the drag info
+	if (!markedPatches_.empty()) {
+		refreshMarks();
+	}
 }
 
 void PatchButtonPanel::resized()
@@ -328,6 +430,21 @@ void PatchButtonPanel::resized()
 
 void PatchButtonPanel::buttonClicked(int buttonIndex, bool triggerHandler) {
 	if (buttonIndex >= 0 && buttonIndex < (int) patches_.size()) {
+		if (triggerHandler && ModifierKeys::currentModifiers.isPopupMenu()) {
+			// The menu is opened by mouseUp(), the click neither selects nor drops the marks
+			return;
+		}
+		if (triggerHandler && ModifierKeys::currentModifiers.isCommandDown()) {
+			toggleMarked(buttonIndex);
+			return;
+		}
+		if (triggerHandler && ModifierKeys::currentModifiers.isShiftDown()) {
+			markRange(buttonIndex);
+			return;
+		}
+		if (triggerHandler && !markedPatches_.empty()) {
+			clearMarkedPatches();
+		}
 		int active = indexOfActive();
 		if (active != -1) {
 			patchButtons_->buttonWithIndex(active)->setActive(false);
@@ -341,6 +458,83 @@ void PatchButtonPanel::buttonClicked(int buttonIndex, bool triggerHandler) {
 	}
 }
 
+void PatchButtonPanel::toggleMarked(int buttonIndex)
+{
+	auto md5 = patches_[buttonIndex].md5();
+	auto found = std::find_if(markedPatches_.begin(), markedPatches_.end(), [&md5](MarkedPatch const &marked) { return marked.patch.md5() == md5; });
+	if (found != markedPatches_.end()) {
+		markedPatches_.erase(found);
+	}
+	else {
+		markedPatches_.push_back({ patches_[buttonIndex], patches_[buttonIndex].createDragInfoString() });
+	}
+	markAnchorMd5_ = md5;
+	refreshMarks();
+}
+
+void PatchButtonPanel::markRange(int buttonIndex)
+{
+	auto anchor = std::find_if(patches_.begin(), patches_.end(), [this](midikraft::PatchHolder const &patch) { return patch.md5() == markAnchorMd5_; });
+	if (markAnchorMd5_.empty() || anchor == patches_.end()) {
+		// Nothing marked on this page to start from, shift-click then marks just this one
+		toggleMarked(buttonIndex);
+		return;
+	}
+	int from = std::min((int) (anchor - patches_.begin()), buttonIndex);
+	int to = std::max((int) (anchor - patches_.begin()), buttonIndex);
+	for (int i = from; i <= to; i++) {
+		auto md5 = patches_[i].md5();
+		if (std::none_of(markedPatches_.begin(), markedPatches_.end(), [&md5](MarkedPatch const &marked) { return marked.patch.md5() == md5; })) {
+			markedPatches_.push_back({ patches_[i], patches_[i].createDragInfoString() });
+		}
+	}
+	refreshMarks();
+}
+
+void PatchButtonPanel::clearMarkedPatches()
+{
+	markedPatches_.clear();
+	markAnchorMd5_.clear();
+	refreshMarks();
+}
+
+std::vector<midikraft::PatchHolder> PatchButtonPanel::markedPatches() const
+{
+	std::vector<midikraft::PatchHolder> result;
+	for (auto const &marked : markedPatches_) {
+		result.push_back(marked.patch);
+	}
+	return result;
+}
+
+void PatchButtonPanel::mouseUp(const MouseEvent& event)
+{
+	if (event.mods.isPopupMenu() && !markedPatches_.empty() && onMarkedPatchesMenu) {
+		onMarkedPatchesMenu(markedPatches());
+	}
+}
+
+void PatchButtonPanel::refreshMarks()
+{
+	// All marked buttons carry the same payload listing every marked patch
+	std::string multiDragInfo;
+	if (!markedPatches_.empty()) {
+		nlohmann::json patches = nlohmann::json::array();
+		for (auto const &marked : markedPatches_) {
+			patches.push_back(midikraft::PatchHolder::dragInfoFromString(marked.dragInfo));
+		}
+		nlohmann::json dragInfo{ { "drag_type", "PATCHES" }, { "patches", patches } };
+		multiDragInfo = dragInfo.dump(-1, ' ', true, nlohmann::detail::error_handler_t::replace);
+	}
+	for (size_t i = 0; i < std::min(patchButtons_->size(), patches_.size()); i++) {
+		auto button = patchButtons_->buttonWithIndex((int)i);
+		auto md5 = patches_[i].md5();
+		bool isMarked = std::any_of(markedPatches_.begin(), markedPatches_.end(), [&md5](MarkedPatch const &marked) { return marked.patch.md5() == md5; });
+		button->setMarked(isMarked);
+		button->setButtonDragInfo(isMarked ? multiDragInfo : patches_[i].createDragInfoString());
+	}
+}
+
 void PatchButtonPanel::buttonClicked(Button* button)
 {
 	if (button == &pageUp_) {
@@ -378,15 +572,144 @@ void PatchButtonPanel::jumpToPage(int pagenumber) {
 	}
 }
 
-void PatchButtonPanel::changeListenerCallback(ChangeBroadcaster* source)
+void PatchButtonPanel::invalidatePageCache()
+{
+	cacheGeneration_++;
+	pageCache_.clear();
+	pagesInFlight_.clear();
+}
+
+bool PatchButtonPanel::findCachedPage(int base, int size, std::vector<midikraft::PatchHolder> &outPatches)
+{
+	for (auto page = pageCache_.begin(); page != pageCache_.end(); page++) {
+		if (page->base == base && page->size == size) {
+			// Move to front for LRU
+			pageCache_.splice(pageCache_.begin(), pageCache_, page);
+			outPatches = pageCache_.front().patches;
+			return true;
+		}
+	}
+	return false;
+}
+
+void PatchButtonPanel::patchChanged(midikraft::PatchHolder const &patch)
+{
+	auto md5 = patch.md5();
+	for (auto &shown : patches_) {
+		if (shown.md5() == md5) shown = patch;
+	}
+	for (auto &page : pageCache_) {
+		for (auto &cached : page.patches) {
+			if (cached.md5() == md5) cached = patch;
+		}
+	}
+	for (auto &marked : markedPatches_) {
+		if (marked.patch.md5() == md5) marked.patch = patch;
+	}
+	PatchStateStore::instance().publish(patch, ColourHelpers::getUIColour(this, LookAndFeel_V4::ColourScheme::widgetBackground));
+}
+
+void PatchButtonPanel::patchesChanged(std::vector<midikraft::PatchHolder> const &patches)
 {
-	if (source == &UIModel::instance()->thumbnails_) {
+	std::map<std::string, midikraft::PatchHolder const *> byMd5;
+	for (auto const &patch : patches) {
+		byMd5[patch.md5()] = &patch;
+	}
+	auto update = [&byMd5](midikraft::PatchHolder &held) {
+		auto found = byMd5.find(held.md5());
+		if (found != byMd5.end()) held = *found->second;
+	};
+	for (auto &shown : patches_) {
+		update(shown);
+	}
+	for (auto &page : pageCache_) {
+		for (auto &cached : page.patches) {
+			update(cached);
+		}
+	}
+	for (auto &marked : markedPatches_) {
+		update(marked.patch);
+	}
+	auto background = ColourHelpers::getUIColour(this, LookAndFeel_V4::ColourScheme::widgetBackground);
+	for (auto const &patch : patches) {
+		PatchStateStore::instance().publish(patch, background);
+	}
+}
+
+void PatchButtonPanel::storeCachedPage(int base, int size, std::vector<midikraft::PatchHolder> const &patches)
+{
+	pageCache_.remove_if([base, size](CachedPage const &page) { return page.base == base && page.size == size; });
+	pageCache_.push_front({ base, size, patches });
+	while (pageCache_.size() > kMaxCachedPages) {
+		pageCache_.pop_back();
+	}
+}
+
+void PatchButtonPanel::prefetchAround(int base)
+{
+	if (!pageLoader_) return;
+	for (int distance = 1; distance <= kReadAheadPages; distance++) {
+		for (int direction : { 1, -1 }) {
+			int prefetchBase = base + direction * distance * pageSize_;
+			if (prefetchBase < 0 || prefetchBase >= totalSize_) continue;
+			if (pagesInFlight_.count(prefetchBase)) continue;
+			bool cached = false;
+			for (auto const &page : pageCache_) {
+				if (page.base == prefetchBase && page.size == pageSize_) {
+					cached = true;
+					break;
+				}
+			}
+			if (cached) continue;
+			int size = pageSize_;
+			int generation = cacheGeneration_;
+			pagesInFlight_.insert(prefetchBase);
+			pageLoader_(prefetchBase, size, [this, prefetchBase, size, generation](std::vector<midikraft::PatchHolder> const &patches) {
+				if (generation != cacheGeneration_) return;
+				pagesInFlight_.erase(prefetchBase);
+				storeCachedPage(prefetchBase, size, patches);
+			});
+		}
+	}
+}
+
+void PatchButtonPanel::scrollRows(int rows) {
+	if (gridWidth_ <= 0 || totalSize_ <= 0) return;
+	// The last position still showing a full grid, aligned to rows
+	int totalRows = (totalSize_ + gridWidth_ - 1) / gridWidth_;
+	int lastBase = std::max(0, totalRows - gridHeight_) * gridWidth_;
+	int newBase = std::max(0, std::min(lastBase, pageBase_ + rows * gridWidth_));
+	if (newBase != pageBase_) {
+		pageBase_ = newBase;
+		pageNumber_ = pageBase_ / pageSize_;
+		setupPageButtons();
+		refresh(true);
+	}
+}
+
+void PatchButtonPanel::mouseWheelMove(const MouseEvent& event, const MouseWheelDetails& wheel)
+{
+	ignoreUnused(event);
+	// Roughly one row per notch of a classic mouse wheel, trackpads deliver smaller steps that add up
+	const float kWheelDeltaPerRow = 0.12f;
+	wheelAccumulator_ -= wheel.deltaY;
+	int rows = (int) (wheelAccumulator_ / kWheelDeltaPerRow);
+	if (rows != 0) {
+		wheelAccumulator_ -= rows * kWheelDeltaPerRow;
+		scrollRows(rows);
+	}
+}
+
+void PatchButtonPanel::modelChanged(int aspects)
+{
+	if (aspects & ModelChanges::Thumbnails) {
 		// Some Thumbnail has changed, most likely it is visible...
+		thumbnailLoader_.invalidate();
 		for (size_t i = 0; i < std::min(patchButtons_->size(), patches_.size()); i++) {
 			refreshThumbnail((int)i);
 		}
 	}
-	else if (source == &UIModel::instance()->currentSynth_ || source == &UIModel::instance()->multiMode_) {
+	if (aspects & (ModelChanges::CurrentSynth | ModelChanges::MultiMode)) {
 		refreshGridSize();
 	}
 }
@@ -419,6 +742,39 @@ void PatchButtonPanel::selectNext()
 	}
 }
 
+bool PatchButtonPanel::patchNextToActive(int direction, midikraft::PatchHolder &outPatch)
+{
+	int active = indexOfActive();
+	if (active == -1) {
+		return false;
+	}
+	std::vector<midikraft::PatchHolder> neighbourPage;
+	if (direction > 0) {
+		if (active + 1 < static_cast<int>(patchButtons_->size())) {
+			if (active + 1 < static_cast<int>(patches_.size())) {
+				outPatch = patches_[(size_t) active + 1];
+				return true;
+			}
+			return false;
+		}
+		if (pageBase_ + pageSize_ < totalSize_ && findCachedPage(pageBase_ + pageSize_, pageSize_, neighbourPage) && !neighbourPage.empty()) {
+			outPatch = neighbourPage.front();
+			return true;
+		}
+	}
+	else {
+		if (active - 1 >= 0) {
+			outPatch = patches_[(size_t) active - 1];
+			return true;
+		}
+		if (pageBase_ - pageSize_ >= 0 && findCachedPage(pageBase_ - pageSize_, pageSize_, neighbourPage) && !neighbourPage.empty()) {
+			outPatch = neighbourPage.back();
+			return true;
+		}
+	}
+	return false;
+}
+
 void PatchButtonPanel::selectFirst()
 {
 	pageBase_ = 0;
@@ -10,12 +10,17 @@
 
 #include "PatchHolderButton.h"
 #include "PatchButtonGrid.h"
+#include "ThumbnailLoader.h"
+#include "UIModel.h"
 
 #include "MidiController.h"
 #include "Synth.h"
 
+#include <list>
+#include <set>
+
 class PatchButtonPanel : public Component,
-	private Button::Listener, private ChangeListener
+	private Button::Listener, private ModelChanges::Listener
 {
 public:
 	typedef std::function<void(int, int, std::function<void(std::vector<midikraft::PatchHolder>)>)> TPageLoader;
@@ -24,11 +29,18 @@ public:
 	virtual ~PatchButtonPanel() override;
 
 	void setPatchLoader(TPageLoader pageGetter);
+	// Starts a new result set, this also drops all cached pages
 	void setTotalCount(int totalCount);
+	// Same, but stays on the current page if it still exists, for counts that become known later
+	void updateTotalCount(int totalCount);
 	void changeGridSize(int newWidth, int newHeight);
 	void setPatches(std::vector<midikraft::PatchHolder> const& patches, int autoSelectTarget = -1);
 	
 	void refresh(bool async, int autoSelectTarget = -1);
+	// Call when patches shown might have changed in the database, so the next refresh does not use cached pages
+	void invalidatePageCache();
+	// A single patch was edited, update the copies held here and the buttons showing it without a refresh
+	void patchChanged(midikraft::PatchHolder const &patch);
 
 	void resized() override;
 
@@ -39,25 +51,60 @@ public:
 	void selectPrevious();
 	void selectNext();
 	void selectFirst();
+	// The patch selectNext() (direction 1) or selectPrevious() (-1) would select, also from the cached neighbour pages
+	bool patchNextToActive(int direction, midikraft::PatchHolder &outPatch);
 	void pageUp(bool selectNext);
 	void pageDown(bool selectLast);
 
 	void jumpToPage(int pagenumber);
+	// Continuous scrolling, moves the visible window by whole rows across page boundaries
+	void scrollRows(int rows);
+
+	void mouseWheelMove(const MouseEvent& event, const MouseWheelDetails& wheel) override;
+	void mouseUp(const MouseEvent& event) override;
+
+	// Command-click marks patches, shift-click marks the range from the last marked one. Dragging any marked button then drags all of them
+	void clearMarkedPatches();
+	// In the order they were marked, also those of other pages
+	std::vector<midikraft::PatchHolder> markedPatches() const;
+	// Many patches were edited at once, e.g. by a batch action on the marked ones. Like patchChanged(), but in one pass
+	void patchesChanged(std::vector<midikraft::PatchHolder> const &patches);
+
+	// Right click while patches are marked, to offer actions for all of them
+	std::function<void(std::vector<midikraft::PatchHolder> const &)> onMarkedPatchesMenu;
+
+	// Called with the patches of every page shown
+	std::function<void(std::vector<midikraft::PatchHolder> const &)> onPatchesShown;
 
 private:
 	enum class SliderAxis {
 		X_AXIS, Y_AXIS
 	};
 
-	void changeListenerCallback(ChangeBroadcaster* source) override;
+	void modelChanged(int aspects) override;
 	std::string settingName(SliderAxis axis);
 	void refreshGridSize();
 
 	String createNameOfThubnailCacheFile(midikraft::PatchHolder const &patch);
-	File findPrehearFile(midikraft::PatchHolder const &patch);
 	void refreshThumbnail(int i);
 	int indexOfActive() const;
 	void setupPageButtons();
+	void toggleMarked(int buttonIndex);
+	void markRange(int buttonIndex);
+	void refreshMarks();
+
+	// Page cache, holds the last used pages and reads ahead around the current one
+	struct CachedPage {
+		int base;
+		int size;
+		std::vector<midikraft::PatchHolder> patches;
+	};
+	bool findCachedPage(int base, int size, std::vector<midikraft::PatchHolder> &outPatches);
+	void storeCachedPage(int base, int size, std::vector<midikraft::PatchHolder> const &patches);
+	void prefetchAround(int base);
+
+	static constexpr int kReadAheadPages = 2;
+	static constexpr size_t kMaxCachedPages = 9;
 
 	std::string settingPrefix_;
 	std::vector<midikraft::PatchHolder> patches_;
@@ -66,6 +113,20 @@ private:
 	TPageLoader pageLoader_;
 
 	std::string activePatchMd5_;
+	struct MarkedPatch {
+		midikraft::PatchHolder patch;
+		std::string dragInfo;
+	};
+	std::vector<MarkedPatch> markedPatches_; // In the order they were marked
+	std::string markAnchorMd5_; // The patch marked last, where a shift-click range starts
+	std::vector<std::string> thumbnailMd5_; // Per button, the patch its thumbnail was looked up for
+	float wheelAccumulator_ = 0.0f;
+	std::list<CachedPage> pageCache_; // Most recently used first
+	std::set<int> pagesInFlight_;
+	int cacheGeneration_ = 0;
+	void applyThumbnail(int i, ThumbnailLoader::Result const &result);
+	ThumbnailLoader thumbnailLoader_;
+	std::vector<int> memoryProviders_; // Handles of the MemoryReport
 
 	TextButton pageUp_, pageDown_;
 	OwnedArray<TextButton> pageNumbers_;
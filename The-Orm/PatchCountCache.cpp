@@ -0,0 +1,59 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "PatchCountCache.h"
+
+namespace {
+
+	// Short enough that nothing surprising shows, long enough for paging and the repaints of the header
+	constexpr uint32 kMaxAgeMs = 10000;
+	constexpr size_t kMaxEntries = 64;
+
+}
+
+PatchCountCache::PatchCountCache(DatabaseVersion &version) : version_(version)
+{
+}
+
+int PatchCountCache::count(midikraft::PatchFilter const &filter, std::function<int()> counter)
+{
+	auto key = keyOf(filter);
+	auto stamp = version_.current();
+	{
+		ScopedLock lock(lock_);
+		auto found = entries_.find(key);
+		if (found != entries_.end() && found->second.stamp == stamp && Time::getMillisecondCounter() - found->second.storedAt < kMaxAgeMs) {
+			return found->second.count;
+		}
+	}
+	// Count outside of the lock, this is the expensive part
+	int result = counter();
+	if (stamp.isValid()) {
+		ScopedLock lock(lock_);
+		if (entries_.size() >= kMaxEntries) {
+			entries_.clear();
+		}
+		entries_[key] = { result, stamp, Time::getMillisecondCounter() };
+	}
+	return result;
+}
+
+std::string PatchCountCache::keyOf(midikraft::PatchFilter const &filter)
+{
+	// All fields that change the WHERE clause, orderBy doesn't change the count
+	std::string key;
+	for (auto const &synth : filter.synths) {
+		key += synth.first + "\x1f";
+	}
+	key += "|" + filter.importID + "|" + filter.listID + "|" + filter.name + "|";
+	key += std::to_string(filter.onlyFaves) + std::to_string(filter.onlySpecifcType) + ":" + std::to_string(filter.typeID) + ":";
+	key += std::to_string(filter.showHidden) + std::to_string(filter.showUndecided) + std::to_string(filter.onlyUntagged);
+	key += std::to_string(filter.andCategories) + std::to_string(filter.onlyDuplicateNames) + "|";
+	for (auto const &category : filter.categories) {
+		key += category.category() + "\x1f";
+	}
+	return key;
+}
@@ -0,0 +1,40 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include "PatchDatabase.h"
+#include "DatabaseVersion.h"
+
+#include <functional>
+#include <map>
+#include <string>
+
+// Remembers the patch counts of the last filters for a few seconds, so paging through the grid doesn't run the same COUNT(*)
+// again and again. A count is only reused while nothing has been committed to the database since it was taken.
+class PatchCountCache {
+public:
+	explicit PatchCountCache(DatabaseVersion &version);
+
+	// Returns the cached count of the filter, or calls counter and remembers its result
+	int count(midikraft::PatchFilter const &filter, std::function<int()> counter);
+
+	// All fields that change the WHERE clause of a filter, orderBy is not part of it
+	static std::string keyOf(midikraft::PatchFilter const &filter);
+
+private:
+	struct Entry {
+		int count;
+		DatabaseVersion::Stamp stamp;
+		uint32 storedAt;
+	};
+
+	DatabaseVersion &version_;
+	CriticalSection lock_;
+	std::map<std::string, Entry> entries_;
+};
@@ -6,6 +6,8 @@
 
 #include "PatchDiff.h"
 
+#include "PatchTextRenderer.h"
+
 #include "Synth.h"
 #include "PatchHolder.h"
 #include "Patch.h"
@@ -15,6 +17,7 @@
 #include "DetailedParametersCapability.h"
 
 #include <algorithm>
+#include <cstring>
 #include <fmt/format.h>
 // Turn off warning on unknown pragmas for VC++
 #pragma warning(push)
@@ -34,13 +37,13 @@ public:
 
 	virtual int readNextToken(CodeDocument::Iterator& source) override
 	{
-		// Determine if this is the start of a diff region
-		for (auto range : ranges_) {
-			if (source.getPosition() == range.getStart()) {
-				// Hit! Consume enough characters to move ahead
-				for (int i = 0; i < range.getLength(); i++) source.skip();
-				return DIFF;
-			}
+		// Determine if this is the start of a diff region, the ranges are sorted by their start
+		int position = source.getPosition();
+		auto range = std::lower_bound(ranges_.begin(), ranges_.end(), position, [](Range<int> const &r, int pos) { return r.getStart() < pos; });
+		if (range != ranges_.end() && range->getStart() == position) {
+			// Hit! Consume enough characters to move ahead
+			for (int i = 0; i < range->getLength(); i++) source.skip();
+			return DIFF;
 		}
 		// No hit, advance iterator
 		source.skip();
@@ -83,7 +86,7 @@ private:
 };
 
 PatchDiff::PatchDiff(midikraft::Synth *activeSynth, midikraft::PatchHolder const &patch1, midikraft::PatchHolder const &patch2) : activeSynth_(activeSynth), p1_(patch1), p2_(patch2),
-	p1Document_(new CodeDocument), p2Document_(new CodeDocument)
+	p1Document_(new CodeDocument), p2Document_(new CodeDocument), diffGeneration_(0), diffPool_(1)
 {
 	// Create more components, with more complex bootstrapping
 	tokenizer1_.reset(new DiffTokenizer());
@@ -142,6 +145,7 @@ PatchDiff::PatchDiff(midikraft::Synth *activeSynth, midikraft::PatchHolder const
 
 PatchDiff::~PatchDiff()
 {
+	diffPool_.removeAllJobs(true, 5000);
 }
 
 void PatchDiff::resized()
@@ -197,15 +201,46 @@ void PatchDiff::fillDocuments()
 	else {
 		doc1 = makeTextDocument(&p1_);
 		doc2 = makeTextDocument(&p2_);
-		std::vector<Range<int>> diffRanges1 = diffFromText(doc1, doc2);
-		std::vector<Range<int>> diffRanges2 = diffFromText(doc2, doc1);
-		tokenizer1_->setRangeList(diffRanges1);
-		tokenizer2_->setRangeList(diffRanges2);
+		// Show the texts right away, the highlighting follows from the background
+		std::vector<Range<int>> noRanges;
+		tokenizer1_->setRangeList(noRanges);
+		tokenizer2_->setRangeList(noRanges);
+	}
+	int generation = ++diffGeneration_;
+
+	// Setup view. The highlighting of the unchanged lines changes with the ranges, so their tokens are renewed as well
+	PatchTextRenderer::updateDocument(*p1Document_, doc1);
+	PatchTextRenderer::updateDocument(*p2Document_, doc2);
+	p1Editor_->retokenise(0, -1);
+	p2Editor_->retokenise(0, -1);
+
+	if (!showHexDiff_) {
+		Component::SafePointer<PatchDiff> safeThis(this);
+		diffPool_.addJob([safeThis, generation, text1 = doc1.toStdString(), text2 = doc2.toStdString()]() {
+			diffFromText(text1, text2, [safeThis, generation](std::vector<Range<int>> const &ranges1, std::vector<Range<int>> const &ranges2) {
+				MessageManager::callAsync([safeThis, generation, ranges1, ranges2]() {
+					if (safeThis) {
+						safeThis->showDiffRanges(generation, ranges1, ranges2);
+					}
+				});
+			});
+		});
 	}
+}
 
-	// Setup view
-	p1Document_->replaceAllContent(doc1);
-	p2Document_->replaceAllContent(doc2);
+void PatchDiff::showDiffRanges(int generation, std::vector<Range<int>> const &ranges1, std::vector<Range<int>> const &ranges2)
+{
+	if (generation != diffGeneration_) {
+		return;
+	}
+	auto copy1 = ranges1;
+	auto copy2 = ranges2;
+	tokenizer1_->setRangeList(copy1);
+	tokenizer2_->setRangeList(copy2);
+	p1Editor_->retokenise(0, -1);
+	p2Editor_->retokenise(0, -1);
+	p1Editor_->repaint();
+	p2Editor_->repaint();
 }
 
 int PatchDiff::positionInHexDocument(int positionInBinary) {
@@ -219,53 +254,129 @@ int PatchDiff::positionInHexDocument(int positionInBinary) {
 
 String PatchDiff::makeHexDocument(midikraft::PatchHolder *patch)
 {
-	String result;
-	std::vector<uint8> binaryData = patch->patch()->data();
-
-	uint8 *line = binaryData.data();
-	int consumed = 0;
-	while (consumed < (int) binaryData.size()) {
-		uint8 posLSB = consumed & 0xff;
-		uint8 posMSB = (consumed >> 8) & 0xff;
-		result += String::toHexString(&posMSB, 1, 1) + String::toHexString(&posLSB, 1, 1) + " ";
-		int lineLength = std::min(8, ((int) binaryData.size()) - consumed);
-		String hex = String::toHexString(line, lineLength, 1);
-		result += hex;
-		result += "\n";
-
-		line += lineLength;
-		consumed += lineLength;
-	}
-
-	return result;
+	return String(PatchTextRenderer::hexDump(patch->patch()->data()));
 }
 
 String PatchDiff::makeTextDocument(midikraft::PatchHolder *patch) {
 	auto realPatch = std::dynamic_pointer_cast<midikraft::Patch>(patch->patch());
 	if (realPatch) {
-		return patchToTextRaw(realPatch, false);
+		return String(PatchTextRenderer::parametersToText(realPatch, false));
 	}
 	else {
 		return "makeTextDocument not implemented yet";
 	}
 }
 
-std::vector<Range<int>> PatchDiff::diffFromText(String &doc1, String &doc2) {
-	dtl::Diff< char, std::string> difference(doc1.toStdString(), doc2.toStdString());
-	difference.compose();
+namespace {
+	struct DiffLine {
+		int start;
+		std::string text;
+	};
 
-	// Diff calculation for highlighting
-	std::vector<Range<int>> diffRanges;
+	std::vector<DiffLine> splitLines(std::string const &doc) {
+		std::vector<DiffLine> lines;
+		size_t start = 0;
+		while (start < doc.size()) {
+			size_t end = doc.find('\n', start);
+			if (end == std::string::npos) end = doc.size();
+			lines.push_back({ (int) start, doc.substr(start, end - start) });
+			start = end + 1;
+		}
+		return lines;
+	}
 
-	// Loop over edit script and create highlighting ranges
-	auto editScript = difference.getSes();
-	for (auto edit : editScript.getSequence()) {
-	if (edit.second.type == dtl::SES_DELETE) {
-			diffRanges.push_back(Range<int>((int) (edit.second.beforeIdx - 1), (int) edit.second.beforeIdx));
+	void addRange(std::vector<Range<int>> &ranges, int start, int end) {
+		if (end <= start) return;
+		if (!ranges.empty() && ranges.back().getEnd() == start) {
+			ranges.back() = ranges.back().withEnd(end);
+		}
+		else {
+			ranges.emplace_back(start, end);
 		}
 	}
+}
 
-	return diffRanges;
+void PatchDiff::diffFromText(std::string const &doc1, std::string const &doc2, std::function<void(std::vector<Range<int>> const &, std::vector<Range<int>> const &)> progress) {
+	// One parameter per line, so diff the lines first. That is small even for patches with a thousand parameters
+	auto lines1 = splitLines(doc1);
+	auto lines2 = splitLines(doc2);
+	std::vector<std::string> text1, text2;
+	for (auto const &line : lines1) text1.push_back(line.text);
+	for (auto const &line : lines2) text2.push_back(line.text);
+	dtl::Diff<std::string, std::vector<std::string>> lineDifference(text1, text2);
+	lineDifference.compose();
+
+	// Collect the changed lines, a block of deleted lines followed by added lines is a block of modified lines
+	std::vector<std::pair<std::vector<size_t>, std::vector<size_t>>> blocks;
+	bool inBlock = false;
+	for (auto edit : lineDifference.getSes().getSequence()) {
+		if (edit.second.type == dtl::SES_COMMON) {
+			inBlock = false;
+			continue;
+		}
+		if (!inBlock) {
+			blocks.emplace_back();
+			inBlock = true;
+		}
+		if (edit.second.type == dtl::SES_DELETE) {
+			blocks.back().first.push_back((size_t) edit.second.beforeIdx - 1);
+		}
+		else {
+			blocks.back().second.push_back((size_t) edit.second.afterIdx - 1);
+		}
+	}
+
+	// Progress: highlight the changed lines as a whole
+	std::vector<Range<int>> ranges1, ranges2;
+	for (auto const &block : blocks) {
+		for (auto line : block.first) addRange(ranges1, lines1[line].start, lines1[line].start + (int) lines1[line].text.size());
+		for (auto line : block.second) addRange(ranges2, lines2[line].start, lines2[line].start + (int) lines2[line].text.size());
+	}
+	std::sort(ranges1.begin(), ranges1.end(), [](Range<int> const &a, Range<int> const &b) { return a.getStart() < b.getStart(); });
+	std::sort(ranges2.begin(), ranges2.end(), [](Range<int> const &a, Range<int> const &b) { return a.getStart() < b.getStart(); });
+	progress(ranges1, ranges2);
+
+	// Refine: pair the modified lines and diff them character by character, lines without partner stay highlighted completely
+	ranges1.clear();
+	ranges2.clear();
+	for (auto const &block : blocks) {
+		size_t paired = std::min(block.first.size(), block.second.size());
+		for (size_t i = 0; i < block.first.size(); i++) {
+			auto const &line1 = lines1[block.first[i]];
+			if (i >= paired) {
+				addRange(ranges1, line1.start, line1.start + (int) line1.text.size());
+				continue;
+			}
+			auto const &line2 = lines2[block.second[i]];
+			dtl::Diff<char, std::string> charDifference(line1.text, line2.text);
+			charDifference.compose();
+			for (auto edit : charDifference.getSes().getSequence()) {
+				if (edit.second.type == dtl::SES_DELETE) {
+					int pos = line1.start + (int) edit.second.beforeIdx - 1;
+					addRange(ranges1, pos, pos + 1);
+				}
+			}
+		}
+		for (size_t i = 0; i < block.second.size(); i++) {
+			auto const &line2 = lines2[block.second[i]];
+			if (i >= paired) {
+				addRange(ranges2, line2.start, line2.start + (int) line2.text.size());
+				continue;
+			}
+			auto const &line1 = lines1[block.first[i]];
+			dtl::Diff<char, std::string> charDifference(line1.text, line2.text);
+			charDifference.compose();
+			for (auto edit : charDifference.getSes().getSequence()) {
+				if (edit.second.type == dtl::SES_ADD) {
+					int pos = line2.start + (int) edit.second.afterIdx - 1;
+					addRange(ranges2, pos, pos + 1);
+				}
+			}
+		}
+	}
+	std::sort(ranges1.begin(), ranges1.end(), [](Range<int> const &a, Range<int> const &b) { return a.getStart() < b.getStart(); });
+	std::sort(ranges2.begin(), ranges2.end(), [](Range<int> const &a, Range<int> const &b) { return a.getStart() < b.getStart(); });
+	progress(ranges1, ranges2);
 }
 
 std::vector<Range<int>> PatchDiff::diffFromData(std::shared_ptr<midikraft::DataFile> patch1, std::shared_ptr<midikraft::DataFile> patch2) {
@@ -276,7 +387,13 @@ std::vector<Range<int>> PatchDiff::diffFromData(std::shared_ptr<midikraft::DataF
 	std::vector<uint8> const &doc1 = activeSynth_->filterVoiceRelevantData(patch1);
 	std::vector<uint8> const &doc2 = activeSynth_->filterVoiceRelevantData(patch2);
 
-	for (int i = 0; i < (int) std::min(doc1.size(), doc2.size()); i++) {
+	int length = (int) std::min(doc1.size(), doc2.size());
+	for (int i = 0; i < length; i++) {
+		if (!diff && i % 8 == 0 && i + 8 <= length && std::memcmp(doc1.data() + i, doc2.data() + i, 8) == 0) {
+			// Most lines of a hex dump are equal, skip them as a whole
+			i += 7;
+			continue;
+		}
 		if (doc1[i] != doc2[i]) {
 			if (!diff) {
 				diff = true;
@@ -299,40 +416,3 @@ std::vector<Range<int>> PatchDiff::diffFromData(std::shared_ptr<midikraft::DataF
 	}
 	return diffRanges;
 }
-
-std::string PatchDiff::patchToTextRaw(std::shared_ptr<midikraft::Patch> patch, bool onlyActive)
-{
-	std::string result;
-
-	int numLayers = 1;
-	auto layers = midikraft::Capability::hasCapability<midikraft::LayeredPatchCapability>(patch);
-	if (layers) {
-		numLayers = layers->numberOfLayers();
-	}
-
-	auto parameterDetails = midikraft::Capability::hasCapability<midikraft::DetailedParametersCapability>(patch);
-
-	if (parameterDetails) {
-		for (int layer = 0; layer < numLayers; layer++) {
-			if (layers) {
-				if (layer > 0) result += "\n";
-				result = result + fmt::format("Layer: {}\n", layers->layerName(layer));
-			}
-			for (auto param : parameterDetails->allParameterDefinitions()) {
-				if (layers) {
-					auto multiLayerParam = midikraft::Capability::hasCapability<midikraft::SynthMultiLayerParameterCapability>(param);
-					jassert(multiLayerParam);
-					if (multiLayerParam) {
-						multiLayerParam->setSourceLayer(layer);
-					}
-				}
-				auto activeCheck = midikraft::Capability::hasCapability<midikraft::SynthParameterActiveDetectionCapability>(param);
-				if (!onlyActive || !activeCheck || !(activeCheck->isActive(patch.get()))) {
-					result = result + fmt::format("{}: {}\n", param->description(), param->valueInPatchToText(*patch));
-				}
-			}
-		}
-	}
-	return result;
-}
-
@@ -25,12 +25,14 @@ public:
 
 private:
 	void fillDocuments();
+	void showDiffRanges(int generation, std::vector<Range<int>> const &ranges1, std::vector<Range<int>> const &ranges2);
 	static int positionInHexDocument(int positionInBinary);
 	String makeHexDocument(midikraft::PatchHolder *patch);
 	String makeTextDocument(midikraft::PatchHolder *patch);
-	std::vector<Range<int>> diffFromText(String &doc1, String &doc2);
+	// Diffs line by line first and reports the changed lines, then refines the changed lines character by character
+	static void diffFromText(std::string const &doc1, std::string const &doc2,
+		std::function<void(std::vector<Range<int>> const &, std::vector<Range<int>> const &)> progress);
 	std::vector<Range<int>> diffFromData(std::shared_ptr<midikraft::DataFile> patch1, std::shared_ptr<midikraft::DataFile> patch2);
-	std::string patchToTextRaw(std::shared_ptr<midikraft::Patch> patch, bool onlyActive);
 
 	midikraft::Synth *activeSynth_;
 	midikraft::PatchHolder p1_, p2_;
@@ -46,6 +48,8 @@ private:
 	TextButton hexBased_, textBased_;
 
 	bool showHexDiff_;
+	int diffGeneration_; // The text diff runs in the background, results of an older mode are dropped
+	ThreadPool diffPool_;
 
 	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PatchDiff)
 };
@@ -0,0 +1,44 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "PatchHandleStore.h"
+
+std::string PatchHandleStore::keyOf(midikraft::PatchHolder const &patch)
+{
+	// The md5 is only unique per synth
+	return (patch.synth() ? patch.synth()->getName() : std::string()) + "\n" + patch.md5();
+}
+
+PatchHandleStore::Handle PatchHandleStore::intern(midikraft::PatchHolder const &patch)
+{
+	auto key = keyOf(patch);
+	auto found = handleByKey_.find(key);
+	if (found != handleByKey_.end()) {
+		patches_[found->second] = patch;
+		return found->second;
+	}
+	Handle handle = (Handle) patches_.size();
+	patches_.push_back(patch);
+	handleByKey_.emplace(std::move(key), handle);
+	return handle;
+}
+
+midikraft::PatchHolder const &PatchHandleStore::patch(Handle handle) const
+{
+	jassert(handle < patches_.size());
+	return patches_[handle];
+}
+
+size_t PatchHandleStore::size() const
+{
+	return patches_.size();
+}
+
+void PatchHandleStore::clear()
+{
+	patches_.clear();
+	handleByKey_.clear();
+}
@@ -0,0 +1,36 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include "PatchHolder.h"
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Keeps one PatchHolder per patch of the library for the views that need to hold on to large parts of it, which refer to them by
+// 32 bit handles. Interning a patch again returns the same handle and replaces the stored holder, so all views see the newest metadata.
+// Handles stay valid until clear(). Message thread only.
+class PatchHandleStore {
+public:
+	typedef uint32 Handle;
+
+	Handle intern(midikraft::PatchHolder const &patch);
+	midikraft::PatchHolder const &patch(Handle handle) const;
+
+	size_t size() const;
+	// Invalidates all handles, only call this when nobody holds any
+	void clear();
+
+private:
+	static std::string keyOf(midikraft::PatchHolder const &patch);
+
+	std::vector<midikraft::PatchHolder> patches_;
+	std::unordered_map<std::string, Handle> handleByKey_; // Synth name and md5
+};
@@ -10,6 +10,7 @@
 #include "LayeredPatchCapability.h"
 
 #include "UIModel.h"
+#include "PatchStateStore.h"
 
 Colour PatchHolderButton::buttonColourForPatch(midikraft::PatchHolder &patch, Component *componentForDefaultBackground) {
 	Colour color = ColourHelpers::getUIColour(componentForDefaultBackground, LookAndFeel_V4::ColourScheme::widgetBackground);
@@ -41,6 +42,22 @@ void PatchHolderButton::setDirty(bool isDirty)
 	setGlow(false);
 }
 
+void PatchHolderButton::setDiffersInSynth(bool differs)
+{
+	if (differs != differsInSynth_) {
+		differsInSynth_ = differs;
+		setGlow(false);
+	}
+}
+
+void PatchHolderButton::setMarked(bool isMarked)
+{
+	if (isMarked != isMarked_) {
+		isMarked_ = isMarked;
+		setGlow(false);
+	}
+}
+
 void PatchHolderButton::setGlow(bool shouldGlow)
 {
 	if (shouldGlow) {
@@ -53,6 +70,14 @@ void PatchHolderButton::setGlow(bool shouldGlow)
 			glow.setGlowProperties(4.0, Colours::darkred);
 			setComponentEffect(&glow);
 		}
+		else if (differsInSynth_) {
+			glow.setGlowProperties(4.0, Colours::orange);
+			setComponentEffect(&glow);
+		}
+		else if (isMarked_) {
+			glow.setGlowProperties(4.0, Colours::lightskyblue);
+			setComponentEffect(&glow);
+		}
 		else {
 			// Neither
 			setComponentEffect(nullptr);
@@ -73,9 +98,7 @@ void PatchHolderButton::itemDragExit(const SourceDetails& dragSourceDetails)
 }
 
 juce::ValueTree PatchHolderButton::createValueTwin(midikraft::PatchHolder* patch) {
-	//TODO - this might cause memory growth if we never clear the cache. Can we somehow count how many buttons reference these ephemeral values?
-	auto cache = Data::instance().getEphemeral().getOrCreateChildWithName(EPROPERTY_PATCH_CACHE, nullptr);
-	return cache.getOrCreateChildWithName(juce::Identifier(patch->md5()), nullptr);
+	return PatchStateStore::nodeFor(patch->md5());
 }
 
 void PatchHolderButton::rebindButton(ValueTree patchValue) {
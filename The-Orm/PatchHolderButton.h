@@ -29,7 +29,11 @@ public:
 	PatchHolderButton(int id, bool isToggle, std::function<void(int)> clickHandler);
 
 	void setDirty(bool isDirty);
+	// The synth holds another patch in this slot than the bank shown
+	void setDiffersInSynth(bool differs);
 	void setGlow(bool glow);
+	// Part of a multi selection for dragging
+	void setMarked(bool isMarked);
 
 	// Need to visualize the drag
 	virtual void itemDragEnter(const SourceDetails& dragSourceDetails) override;
@@ -48,6 +52,8 @@ private:
 	static juce::ValueTree emptyButtonValues_;
 
 	bool isDirty_;
+	bool isMarked_ = false;
+	bool differsInSynth_ = false;
 	GlowEffect glow;
 	juce::Value number_;
 };
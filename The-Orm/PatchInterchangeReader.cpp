@@ -0,0 +1,214 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "PatchInterchangeReader.h"
+
+#include "PatchInterchangeFormat.h"
+
+#include <fmt/format.h>
+#include <nlohmann/json.hpp>
+
+#include <fstream>
+
+namespace {
+
+	// Builds the DOM of the top level members of the file, except for the patch array. Its elements are built one by one
+	// and handed out in chunks
+	class ChunkingSax : public nlohmann::json_sax<nlohmann::json> {
+	public:
+		typedef std::function<bool(nlohmann::json const &header, std::string const &arrayKey, std::vector<nlohmann::json> &patches)> TFlush;
+
+		ChunkingSax(size_t chunkSize, TFlush flush) : chunkSize_(std::max(chunkSize, (size_t) 1)), flush_(std::move(flush)) {
+		}
+
+		bool null() override { return value(nullptr); }
+		bool boolean(bool val) override { return value(val); }
+		bool number_integer(number_integer_t val) override { return value(val); }
+		bool number_unsigned(number_unsigned_t val) override { return value(val); }
+		bool number_float(number_float_t val, const string_t &) override { return value(val); }
+		bool string(string_t &val) override { return value(val); }
+		bool binary(binary_t &val) override { return value(nlohmann::json::binary(val)); }
+
+		bool start_object(std::size_t) override {
+			if (depth_++ == 0) {
+				// The top level object itself
+				return true;
+			}
+			return open(nlohmann::json::object());
+		}
+
+		bool key(string_t &val) override {
+			if (depth_ == 1) {
+				topKey_ = val;
+			}
+			else {
+				key_ = val;
+			}
+			return true;
+		}
+
+		bool end_object() override {
+			if (--depth_ == 0) {
+				return true;
+			}
+			return close();
+		}
+
+		bool start_array(std::size_t) override {
+			if (depth_++ == 1 && arrayKey_.empty()) {
+				// The first array at the top level holds the patches
+				arrayKey_ = topKey_;
+				inPatches_ = true;
+				return true;
+			}
+			return open(nlohmann::json::array());
+		}
+
+		bool end_array() override {
+			if (--depth_ == 1 && inPatches_) {
+				inPatches_ = false;
+				return true;
+			}
+			return close();
+		}
+
+		bool parse_error(std::size_t position, const std::string &, const nlohmann::detail::exception &ex) override {
+			error_ = fmt::format("Parse error at byte {}: {}", position, ex.what());
+			return false;
+		}
+
+		bool finish() {
+			if (!patches_.empty()) {
+				return flush_(header_, arrayKey_, patches_);
+			}
+			return true;
+		}
+
+		std::string const &error() const { return error_; }
+		bool stopped() const { return stopped_; }
+
+	private:
+		// Places a value at the current position, which is either a member of the header, an element of the patch array, or inside one of those
+		bool value(nlohmann::json &&val) {
+			if (!stack_.empty()) {
+				auto top = stack_.back();
+				if (top->is_array()) {
+					top->push_back(std::move(val));
+				}
+				else {
+					(*top)[key_] = std::move(val);
+				}
+				return true;
+			}
+			if (inPatches_) {
+				patches_.push_back(std::move(val));
+				return patchDone();
+			}
+			header_[topKey_] = std::move(val);
+			return true;
+		}
+
+		bool open(nlohmann::json &&container) {
+			if (stack_.empty()) {
+				if (inPatches_) {
+					patches_.push_back(std::move(container));
+					stack_.push_back(&patches_.back());
+				}
+				else {
+					header_[topKey_] = std::move(container);
+					stack_.push_back(&header_[topKey_]);
+				}
+				return true;
+			}
+			// The containers on the stack get no new elements until the innermost one is closed, so the pointers stay valid
+			auto top = stack_.back();
+			if (top->is_array()) {
+				top->push_back(std::move(container));
+				stack_.push_back(&top->back());
+			}
+			else {
+				(*top)[key_] = std::move(container);
+				stack_.push_back(&(*top)[key_]);
+			}
+			return true;
+		}
+
+		bool close() {
+			stack_.pop_back();
+			if (stack_.empty() && inPatches_) {
+				return patchDone();
+			}
+			return true;
+		}
+
+		bool patchDone() {
+			if (patches_.size() >= chunkSize_) {
+				if (!flush_(header_, arrayKey_, patches_)) {
+					stopped_ = true;
+					return false;
+				}
+				patches_.clear();
+			}
+			return true;
+		}
+
+		size_t chunkSize_;
+		TFlush flush_;
+		int depth_ = 0;
+		std::string topKey_;
+		std::string key_;
+		std::string arrayKey_;
+		bool inPatches_ = false;
+		nlohmann::json header_ = nlohmann::json::object();
+		std::vector<nlohmann::json> patches_; // Completed patches of the current chunk, and the one being built last
+		std::vector<nlohmann::json *> stack_;
+		std::string error_;
+		bool stopped_ = false;
+	};
+
+}
+
+bool PatchInterchangeReader::load(std::map<std::string, std::shared_ptr<midikraft::Synth>> const &synths, File const &file, std::shared_ptr<midikraft::AutomaticCategory> detector,
+	size_t chunkSize, TChunkHandler const &onChunk, std::string &outError)
+{
+	std::ifstream input(file.getFullPathName().toStdString(), std::ios::binary);
+	if (!input.is_open()) {
+		outError = fmt::format("Can't open {}", file.getFullPathName().toStdString());
+		return false;
+	}
+
+	std::string conversionError;
+	ChunkingSax sax(chunkSize, [&](nlohmann::json const &header, std::string const &arrayKey, std::vector<nlohmann::json> &patches) {
+		// Let the regular loader convert the chunk, as if it was a file of its own
+		nlohmann::json chunk = header;
+		chunk[arrayKey] = nlohmann::json::array();
+		for (auto &patch : patches) {
+			chunk[arrayKey].push_back(std::move(patch));
+		}
+		try {
+			auto loaded = midikraft::PatchInterchangeFormat::fromJson(synths, chunk, detector);
+			return onChunk(loaded);
+		}
+		catch (std::exception &e) {
+			conversionError = e.what();
+			return false;
+		}
+	});
+
+	bool parsed = nlohmann::json::sax_parse(input, &sax);
+	if (parsed) {
+		parsed = sax.finish();
+	}
+	if (!conversionError.empty()) {
+		outError = conversionError;
+		return false;
+	}
+	if (!parsed && !sax.stopped()) {
+		outError = sax.error().empty() ? "Unexpected end of file" : sax.error();
+		return false;
+	}
+	return true;
+}
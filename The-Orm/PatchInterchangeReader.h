@@ -0,0 +1,32 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include "PatchHolder.h"
+#include "AutomaticCategory.h"
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Reads a patch interchange file of any size chunk by chunk. The file is parsed with a SAX parser, only the patches of the
+// current chunk are kept as JSON, and each chunk is converted in memory by PatchInterchangeFormat::fromJson(), which load()
+// runs on the parsed file, so the result is the same as loading the whole file. The members next to the patch array are passed
+// on with every chunk, they need to come before the patch array in the file, as they do in the files KnobKraft writes.
+class PatchInterchangeReader {
+public:
+	typedef std::function<bool(std::vector<midikraft::PatchHolder> &patches)> TChunkHandler;
+
+	// Calls the handler for every chunkSize patches, it can return false to stop reading. Returns false with the error set
+	// if the file could not be read, the chunks handed out before are valid nevertheless
+	static bool load(std::map<std::string, std::shared_ptr<midikraft::Synth>> const &synths, File const &file, std::shared_ptr<midikraft::AutomaticCategory> detector,
+		size_t chunkSize, TChunkHandler const &onChunk, std::string &outError);
+};
@@ -0,0 +1,115 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "PatchInterchangeWriter.h"
+
+#include "PatchInterchangeFormat.h"
+
+#include <nlohmann/json.hpp>
+#include <spdlog/spdlog.h>
+#include "SpdLogJuce.h"
+
+PatchInterchangeWriter::PatchInterchangeWriter(File const &output) : output_(output)
+{
+}
+
+PatchInterchangeWriter::~PatchInterchangeWriter()
+{
+	if (stream_) {
+		// Not finished, don't leave a truncated file behind
+		stream_.reset();
+		output_.deleteFile();
+	}
+}
+
+size_t PatchInterchangeWriter::patchesWritten() const
+{
+	return written_;
+}
+
+bool PatchInterchangeWriter::append(std::vector<midikraft::PatchHolder> const &patches)
+{
+	if (failed_) {
+		return false;
+	}
+	if (patches.empty()) {
+		return true;
+	}
+	if (!writeChunk(midikraft::PatchInterchangeFormat::toJson(patches))) {
+		failed_ = true;
+		return false;
+	}
+	written_ += patches.size();
+	return true;
+}
+
+bool PatchInterchangeWriter::writeChunk(nlohmann::json const &chunk)
+{
+	if (!chunk.is_object()) {
+		spdlog::error("Unexpected patch interchange chunk for {}", output_.getFullPathName());
+		return false;
+	}
+
+	if (!stream_) {
+		// The first chunk decides the layout, the one array member holds the patches
+		for (auto const &member : chunk.items()) {
+			if (member.value().is_array()) {
+				if (!arrayKey_.empty()) {
+					spdlog::error("Unexpected patch interchange chunk for {}, more than one array", output_.getFullPathName());
+					return false;
+				}
+				arrayKey_ = member.key();
+			}
+		}
+		if (arrayKey_.empty()) {
+			spdlog::error("Unexpected patch interchange chunk for {}, no patch array", output_.getFullPathName());
+			return false;
+		}
+		output_.deleteFile();
+		stream_ = std::make_unique<FileOutputStream>(output_);
+		if (stream_->failedToOpen()) {
+			spdlog::error("Can't open {} for writing", output_.getFullPathName());
+			stream_.reset();
+			return false;
+		}
+		std::string head = "{";
+		for (auto const &member : chunk.items()) {
+			if (member.key() != arrayKey_) {
+				head += nlohmann::json(member.key()).dump() + ":" + member.value().dump(-1, ' ', false, nlohmann::detail::error_handler_t::replace) + ",";
+			}
+		}
+		head += nlohmann::json(arrayKey_).dump() + ":[";
+		stream_->writeText(head, false, false, nullptr);
+	}
+	else if (!chunk.contains(arrayKey_) || !chunk[arrayKey_].is_array()) {
+		spdlog::error("Unexpected patch interchange chunk for {}, no patch array", output_.getFullPathName());
+		return false;
+	}
+
+	for (auto const &patch : chunk[arrayKey_]) {
+		if (!firstPatch_) {
+			stream_->writeText(",", false, false, nullptr);
+		}
+		firstPatch_ = false;
+		stream_->writeText(patch.dump(-1, ' ', false, nlohmann::detail::error_handler_t::replace), false, false, nullptr);
+	}
+	return !stream_->getStatus().failed();
+}
+
+bool PatchInterchangeWriter::finish()
+{
+	if (!stream_) {
+		return !failed_;
+	}
+	stream_->writeText("]}", false, false, nullptr);
+	stream_->flush();
+	bool ok = !failed_ && !stream_->getStatus().failed();
+	stream_.reset();
+	if (!ok) {
+		output_.deleteFile();
+	}
+	return ok;
+}
@@ -0,0 +1,44 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include "PatchHolder.h"
+
+#include <nlohmann/json_fwd.hpp>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+// Writes a patch interchange file of any size chunk by chunk, so only the patches of the current chunk are in memory.
+// Each chunk is serialized in memory by PatchInterchangeFormat::toJson(), which builds what save() writes, so the format stays
+// exactly the same. Its patch array is then appended to the output, and all other members are taken from the first chunk.
+// Nothing is written if no patch was appended.
+class PatchInterchangeWriter {
+public:
+	explicit PatchInterchangeWriter(File const &output);
+	~PatchInterchangeWriter();
+
+	// Returns false if the chunk could not be written, the output is incomplete then
+	bool append(std::vector<midikraft::PatchHolder> const &patches);
+	// Closes the patch array and the file, returns false if anything failed on the way
+	bool finish();
+
+	size_t patchesWritten() const;
+
+private:
+	bool writeChunk(nlohmann::json const &chunk);
+
+	File output_;
+	std::unique_ptr<FileOutputStream> stream_;
+	std::string arrayKey_;
+	bool firstPatch_ = true;
+	size_t written_ = 0;
+	bool failed_ = false;
+};
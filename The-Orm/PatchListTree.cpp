@@ -7,11 +7,14 @@
 #include "PatchListTree.h"
 
 #include "CreateListDialog.h"
+#include "DragInfoCache.h"
 
 #include "UIModel.h"
 #include "Logger.h"
 #include "ColourHelpers.h"
 #include "HasBanksCapability.h"
+#include "Tracer.h"
+#include "LayoutConstants.h"
 
 #include <spdlog/spdlog.h>
 #include "SpdLogJuce.h"
@@ -67,6 +70,23 @@ PatchListTree::PatchListTree(midikraft::PatchDatabase& db, std::vector<midikraft
 	treeView_->setOpenCloseButtonsVisible(true);
 	addAndMakeVisible(*treeView_);
 
+	searchBox_.setTextToShowWhenEmpty("Find list, bank or import", Colours::grey);
+	searchBox_.onTextChange = [this]() {
+		updateSearchResults();
+	};
+	searchBox_.onReturnKey = [this]() {
+		if (!results_.empty()) {
+			openSearchResult(results_.front());
+		}
+	};
+	searchBox_.onEscapeKey = [this]() {
+		searchBox_.clear();
+		updateSearchResults();
+	};
+	addAndMakeVisible(searchBox_);
+	searchResults_.setModel(this);
+	addChildComponent(searchResults_);
+
 	// Build data structure to load patch lists
 	for (auto synth : synths) {
 		synths_[synth.getName()] = synth.synth();
@@ -80,6 +100,7 @@ PatchListTree::PatchListTree(midikraft::PatchDatabase& db, std::vector<midikraft
 			onImportListSelected("");
 	};
 	allPatchesItem_->onGenerateChildren = [this]() {
+		TraceScope trace("Generate library tree", "tree");
 		std::vector<TreeViewItem*> result;
 		for (auto activeSynth : UIModel::instance()->synthList_.activeSynths()) {
 			std::string synthName = activeSynth->getName();
@@ -105,6 +126,7 @@ PatchListTree::PatchListTree(midikraft::PatchDatabase& db, std::vector<midikraft
 
 	userListsItem_ = new TreeViewNode("User lists", "userlists");
 	userListsItem_->onGenerateChildren = [this]() {
+		TraceScope trace("Generate user lists", "tree");
 		std::vector<TreeViewItem*> result;
 		auto userLists = db_.allPatchLists();
 		userLists = sortLists<midikraft::ListInfo>(userLists, [](const midikraft::ListInfo& info) { return info.name;  });
@@ -119,7 +141,7 @@ PatchListTree::PatchListTree(midikraft::PatchDatabase& db, std::vector<midikraft
 				if (list) {
 					db_.putPatchList(list);
 					spdlog::info("Create new user list named {}", list->name());
-					regenerateUserLists();
+					userListAdded({ list->id(), list->name() });
 					// This doesn't make any sense, as the list will be empty and you need to browse the library to add stuff into the list?
 					//selectItemByPath({ "userlists", list->id() });
 				}
@@ -132,8 +154,7 @@ PatchListTree::PatchListTree(midikraft::PatchDatabase& db, std::vector<midikraft
 		userListsItem_->toggleOpenness();
 	};
 	userListsItem_->acceptsItem = [](juce::var dropItem) {
-		String dropItemString = dropItem;
-		auto infos = midikraft::PatchHolder::dragInfoFromString(dropItemString.toStdString());
+		auto const &infos = DragInfoCache::parse(dropItem);
 		return midikraft::PatchHolder::dragItemIsList(infos);
 	};
 	userListsItem_->onItemDropped = [this](juce::var dropItem, int) {
@@ -145,7 +166,7 @@ PatchListTree::PatchListTree(midikraft::PatchDatabase& db, std::vector<midikraft
 			auto copyOfList = std::make_shared<midikraft::PatchList>(fmt::format("Copy of {}", loaded_list->name()));
 			copyOfList->setPatches(loaded_list->patches());
 			db_.putPatchList(copyOfList);
-			refreshAllUserLists();
+			userListAdded({ copyOfList->id(), copyOfList->name() });
 		}
 	};
 
@@ -181,6 +202,7 @@ PatchListTree::~PatchListTree()
 }
 
 void PatchListTree::regenerateUserLists() {
+	invalidateSearchIndex();
 	// Need to refresh user lists
 	TreeViewNode* node = dynamic_cast<TreeViewNode*>(userListsItem_);
 	if (node) {
@@ -192,6 +214,7 @@ void PatchListTree::regenerateUserLists() {
 }
 
 void PatchListTree::regenerateImportLists() {
+	invalidateSearchIndex();
 	// Need to refresh user lists
 	TreeViewNode* node = dynamic_cast<TreeViewNode*>(allPatchesItem_);
 	if (node) {
@@ -205,11 +228,14 @@ void PatchListTree::regenerateImportLists() {
 void PatchListTree::resized()
 {
 	auto area = getLocalBounds();
+	searchBox_.setBounds(area.removeFromTop(LAYOUT_LINE_HEIGHT));
 	treeView_->setBounds(area);
+	searchResults_.setBounds(area);
 }
 
 void PatchListTree::refreshAllUserLists()
 {
+	invalidateSearchIndex();
 	MessageManager::callAsync([this]() {
 		userListsItem_->regenerate();
 		selectAllIfNothingIsSelected();
@@ -228,8 +254,103 @@ void PatchListTree::refreshUserList(std::string list_id)
 	}
 }
 
+void PatchListTree::userListAdded(midikraft::ListInfo const &list)
+{
+	invalidateSearchIndex();
+	MessageManager::callAsync([this, list]() {
+		if (userLists_.find(list.id) != userLists_.end()) {
+			userListRenamed(list);
+			return;
+		}
+		// Insert sorted, the last item is the "Add new list" node
+		int position = 0;
+		int numberOfLists = userListsItem_->getNumSubItems() - 1;
+		while (position < numberOfLists) {
+			auto existing = dynamic_cast<TreeViewNode*>(userListsItem_->getSubItem(position));
+			if (existing && String(list.name).compareNatural(existing->text()) < 0) {
+				break;
+			}
+			position++;
+		}
+		userListsItem_->addSubItem(newTreeViewItemForPatchList(list), position);
+	});
+}
+
+void PatchListTree::userListRenamed(midikraft::ListInfo const &list)
+{
+	invalidateSearchIndex();
+	auto found = userLists_.find(list.id);
+	if (found == userLists_.end()) {
+		userListAdded(list);
+		return;
+	}
+	// The list info is captured by the callbacks of the node and its children, so replace the node in place
+	auto oldNode = found->second;
+	MessageManager::callAsync([this, list, oldNode]() {
+		auto current = userLists_.find(list.id);
+		if (current == userLists_.end() || current->second != oldNode) return;
+		for (int i = 0; i < userListsItem_->getNumSubItems(); i++) {
+			if (userListsItem_->getSubItem(i) == oldNode) {
+				bool wasOpen = oldNode->isOpen();
+				bool wasSelected = oldNode->isSelected();
+				userListsItem_->removeSubItem(i, true);
+				listEntries_.erase(list.id);
+				auto node = newTreeViewItemForPatchList(list);
+				userListsItem_->addSubItem(node, i);
+				if (wasOpen) node->setOpen(true);
+				if (wasSelected) node->setSelected(true, true, dontSendNotification);
+				return;
+			}
+		}
+	});
+}
+
+void PatchListTree::userListDeleted(std::string const &list_id)
+{
+	invalidateSearchIndex();
+	auto found = userLists_.find(list_id);
+	if (found == userLists_.end()) {
+		return;
+	}
+	auto oldNode = found->second;
+	userLists_.erase(found);
+	listEntries_.erase(list_id);
+	MessageManager::callAsync([this, oldNode]() {
+		for (int i = 0; i < userListsItem_->getNumSubItems(); i++) {
+			if (userListsItem_->getSubItem(i) == oldNode) {
+				userListsItem_->removeSubItem(i, true);
+				break;
+			}
+		}
+		selectAllIfNothingIsSelected();
+	});
+}
+
+void PatchListTree::patchRemovedFromList(std::string const &list_id, int order_num)
+{
+	auto entries = listEntries_.find(list_id);
+	auto node = userLists_.find(list_id);
+	if (entries == listEntries_.end() || node == userLists_.end()) {
+		// Not opened yet, it will be read when it is
+		return;
+	}
+	auto &list = *entries->second;
+	if (order_num < 0 || order_num >= (int) list.size()) {
+		refreshUserList(list_id);
+		return;
+	}
+	list.erase(list.begin() + order_num);
+	for (size_t i = (size_t) order_num; i < list.size(); i++) {
+		list[i].orderNum = (int) i;
+	}
+	MessageManager::callAsync([this, list_id, name = node->second->text().toStdString()]() {
+		rebuildPatchListChildren({ list_id, name });
+	});
+}
+
 void PatchListTree::refreshAllImports()
 {
+	invalidateSearchIndex();
 	MessageManager::callAsync([this]() {
 		allPatchesItem_->regenerate();
 		});
@@ -242,7 +363,7 @@ void PatchListTree::selectAllIfNothingIsSelected()
 	}
 }
 
-void PatchListTree::selectItemByPath(std::vector<std::string> const& path)
+bool PatchListTree::selectItemByPath(std::vector<std::string> const& path)
 {
 	auto node = treeView_->getRootItem();
 	TreeViewNode* child = nullptr;
@@ -262,7 +383,7 @@ void PatchListTree::selectItemByPath(std::vector<std::string> const& path)
 		}
 		if (!level_found) {
 			spdlog::warn("Did not find item in tree: {}", path[index]);
-			return;
+			return false;
 		}
 		else {
 			index++;
@@ -270,35 +391,176 @@ void PatchListTree::selectItemByPath(std::vector<std::string> const& path)
 	}
 	if (node) {
 		node->setSelected(true, true);
+		return true;
 	}
-	else {
-		selectAllIfNothingIsSelected();
-	}
+	selectAllIfNothingIsSelected();
+	return false;
 }
 
-TreeViewItem* PatchListTree::newTreeViewItemForPatch(midikraft::ListInfo list, midikraft::PatchHolder patchHolder, int index) {
-	auto node = new TreeViewNode(patchHolder.name(), patchHolder.md5());
+namespace {
+	// Placeholder at the end of a partially filled list, fetching the next chunk once it is scrolled into view
+	class MorePatchesNode : public TreeViewNode {
+	public:
+		MorePatchesNode(String const &text) : TreeViewNode(text, "") {}
+
+		void setOnVisible(std::function<void()> onVisible) {
+			onVisible_ = onVisible;
+		}
+
+		void paintItem(Graphics& g, int width, int height) override {
+			TreeViewNode::paintItem(g, width, height);
+			if (onVisible_) {
+				auto callback = onVisible_;
+				onVisible_ = nullptr;
+				// Not while painting, this node is replaced by the next chunk
+				MessageManager::callAsync(callback);
+			}
+		}
+
+	private:
+		std::function<void()> onVisible_;
+	};
+}
+
+TreeViewItem* PatchListTree::newTreeViewItemForPatch(midikraft::ListInfo list, PatchListEntry const &entry) {
+	auto node = new TreeViewNode(entry.name, entry.md5);
 	//TODO - this doesn't work. The TreeView from JUCE has no handlers for selected or clicked that do not fire if a drag is started, so 
 	// you can do either the one thing or the other.
-	node->onSelected = [this, patchHolder](String md5) {
+	node->onSelected = [this, entry](String md5) {
         juce::ignoreUnused(md5);
-		if (onPatchSelected)
-			onPatchSelected(patchHolder);
+		if (!onPatchSelected || synths_.find(entry.synthName) == synths_.end())
+			return;
+		auto synth = synths_[entry.synthName].lock();
+		std::vector<midikraft::PatchHolder> patch;
+		if (synth && db_.getSinglePatch(synth, entry.md5, patch) && patch.size() == 1) {
+			onPatchSelected(patch[0]);
+		}
 	};
-	node->onItemDragged = [patchHolder, list, index]() {
+	node->onItemDragged = [entry, list]() {
 		nlohmann::json dragInfo{ { "drag_type", "PATCH_IN_LIST"},
 			{ "list_id", list.id},
 			{ "list_name", list.name},
-			{ "order_num", index },
-			{ "synth", patchHolder.smartSynth()->getName()},
-			{ "data_type", patchHolder.patch()->dataTypeID()},
-			{ "md5", patchHolder.md5()},
-			{ "patch_name", patchHolder.name() } };
+			{ "order_num", entry.orderNum },
+			{ "synth", entry.synthName},
+			{ "data_type", entry.dataType},
+			{ "md5", entry.md5},
+			{ "patch_name", entry.name } };
 		return var(dragInfo.dump(-1, ' ', true, nlohmann::detail::error_handler_t::replace));
 	};
 	return node;
 }
 
+bool PatchListTree::isMultiPatchDrag(nlohmann::json const &infos) {
+	return infos.is_object() && infos.contains("drag_type") && infos["drag_type"] == "PATCHES" && infos.contains("patches") && infos["patches"].is_array();
+}
+
+void PatchListTree::addPatchesToList(midikraft::ListInfo const &list, std::vector<midikraft::PatchHolder> const &patches, int insertIndex) {
+	if (patches.size() > 1 && insertIndex >= 0) {
+		// Each insert in front of other entries moves all of them, so splice the block in and store the list once
+		auto stored = db_.getPatchList(list, synths_);
+		if (stored && insertIndex < (int) stored->patches().size()) {
+			auto combined = stored->patches();
+			combined.insert(combined.begin() + insertIndex, patches.begin(), patches.end());
+			stored->setPatches(combined);
+			db_.putPatchList(stored);
+			spdlog::info("Added {} patches to list {}", patches.size(), list.name);
+			insertIntoListEntries(list.id, patches, insertIndex);
+			return;
+		}
+	}
+	int position = insertIndex;
+	for (auto const &patch : patches) {
+		db_.addPatchToList(list, patch, position);
+		if (position >= 0) position++;
+	}
+	spdlog::info("Added {} patches to list {}", patches.size(), list.name);
+	insertIntoListEntries(list.id, patches, insertIndex);
+}
+
+void PatchListTree::insertIntoListEntries(std::string const &list_id, std::vector<midikraft::PatchHolder> const &patches, int insertIndex) {
+	auto found = listEntries_.find(list_id);
+	if (found == listEntries_.end()) {
+		return;
+	}
+	auto &entries = *found->second;
+	size_t position = (insertIndex < 0 || (size_t) insertIndex > entries.size()) ? entries.size() : (size_t) insertIndex;
+	std::vector<PatchListEntry> added;
+	for (auto const &patch : patches) {
+		added.push_back({ patch.smartSynth()->getName(), patch.patch()->dataTypeID(), patch.md5(), patch.name(), 0 });
+	}
+	entries.insert(entries.begin() + (std::ptrdiff_t) position, added.begin(), added.end());
+	for (size_t i = position; i < entries.size(); i++) {
+		entries[i].orderNum = (int) i;
+	}
+}
+
+void PatchListTree::rebuildPatchListChildren(midikraft::ListInfo list) {
+	auto node = userLists_.find(list.id);
+	auto entries = listEntries_.find(list.id);
+	if (node == userLists_.end() || entries == listEntries_.end()) {
+		return;
+	}
+	// Refill the children from the entries we have instead of reading the list again, keeping which one was selected
+	auto parent = node->second;
+	int selected = -1;
+	for (int i = 0; i < parent->getNumSubItems(); i++) {
+		if (parent->getSubItem(i)->isSelected()) {
+			selected = i;
+			break;
+		}
+	}
+	parent->clearSubItems();
+	std::vector<TreeViewItem*> items;
+	appendPatchListChunk(list, entries->second, 0, items);
+	for (auto item : items) {
+		parent->addSubItem(item);
+	}
+	if (selected >= 0 && selected < parent->getNumSubItems()) {
+		parent->getSubItem(selected)->setSelected(true, true, dontSendNotification);
+	}
+}
+
+void PatchListTree::appendPatchListChunk(midikraft::ListInfo list, std::shared_ptr<std::vector<PatchListEntry>> entries, size_t start, std::vector<TreeViewItem*> &outItems) {
+	size_t end = std::min(entries->size(), start + kPatchListChunkSize);
+	for (size_t i = start; i < end; i++) {
+		outItems.push_back(newTreeViewItemForPatch(list, (*entries)[i]));
+	}
+	if (end < entries->size()) {
+		auto more = new MorePatchesNode(fmt::format("{} more...", entries->size() - end));
+		TreeViewItem* placeholder = more;
+		// The list node might have been regenerated in the meantime, then the placeholder is gone
+		more->setOnVisible([this, list, entries, end, placeholder]() {
+			auto listNode = userLists_.find(list.id);
+			if (listNode == userLists_.end()) return;
+			auto parent = listNode->second;
+			int last = parent->getNumSubItems() - 1;
+			if (last < 0 || parent->getSubItem(last) != placeholder) return;
+			std::vector<TreeViewItem*> next;
+			appendPatchListChunk(list, entries, end, next);
+			parent->removeSubItem(last, true);
+			for (auto item : next) {
+				parent->addSubItem(item);
+			}
+		});
+		outItems.push_back(more);
+	}
+}
+
+size_t PatchListTree::numberOfBanks(std::shared_ptr<midikraft::Synth> synth)
+{
+	auto bankDescriptor = midikraft::Capability::hasCapability<midikraft::HasBankDescriptorsCapability>(synth);
+	if (bankDescriptor)
+	{
+		return bankDescriptor->bankDescriptors().size();
+	}
+	auto hasBanks = midikraft::Capability::hasCapability<midikraft::HasBanksCapability>(synth);
+	if (hasBanks)
+	{
+		return (size_t) hasBanks->numberOfBanks();
+	}
+	return 0;
+}
+
 TreeViewItem* PatchListTree::newTreeViewItemForSynthBanks(std::shared_ptr<midikraft::SimpleDiscoverableDevice> device) {
 	std::string synthName = device->getName();
 	auto synthBanksNode = new TreeViewNode("In synth", "banks-" + synthName);
@@ -308,22 +570,10 @@ TreeViewItem* PatchListTree::newTreeViewItemForSynthBanks(std::shared_ptr<midikr
 			synthBanksNode->toggleOpenness();
 		};
 		synthBanksNode->onGenerateChildren = [this, synth, synthName] {
+			TraceScope trace("Generate synth banks", "tree");
 			std::vector<TreeViewItem*> result;
 
-			//TODO this should be moved into a helper static function
-			size_t numberOfBanks = 0;
-			auto bankDescriptor = midikraft::Capability::hasCapability<midikraft::HasBankDescriptorsCapability>(synth);
-			if (bankDescriptor)
-			{
-				numberOfBanks = bankDescriptor->bankDescriptors().size();
-			}
-			else {
-				auto hasBanks = midikraft::Capability::hasCapability<midikraft::HasBanksCapability>(synth);
-				if (hasBanks)
-				{
-					numberOfBanks = hasBanks->numberOfBanks();
-				}
-			}
+			size_t banksInSynth = PatchListTree::numberOfBanks(synth);
 
 			// Build a set of IDs of Banks that already are synced
 			auto alreadyLoadedBanks = db_.allSynthBanks(synth);
@@ -331,7 +581,7 @@ TreeViewItem* PatchListTree::newTreeViewItemForSynthBanks(std::shared_ptr<midikr
 			std::transform(alreadyLoadedBanks.begin(), alreadyLoadedBanks.end(),
 				std::inserter(loadedIds, loadedIds.begin()), [](midikraft::ListInfo info) { return info.id; });
 
-			for (int i = 0; i < (int) numberOfBanks; i++) {
+			for (int i = 0; i < (int) banksInSynth; i++) {
 				int sizeOfBank = midikraft::SynthBank::numberOfPatchesInBank(synth, i);
 				auto bank_id = midikraft::ActiveSynthBank::makeId(synth, MidiBankNumber::fromZeroBase(i, sizeOfBank));
 				auto bank_name = midikraft::SynthBank::friendlyBankName(synth, MidiBankNumber::fromZeroBase(i, sizeOfBank));
@@ -365,6 +615,7 @@ TreeViewItem* PatchListTree::newTreeViewItemForStoredBanks(std::shared_ptr<midik
 	auto synth = std::dynamic_pointer_cast<midikraft::Synth>(device);
 	if (synth) {
 		synthBanksNode->onGenerateChildren = [this, synth, synthName, synthBanksNode] {
+			TraceScope trace("Generate user banks", "tree");
 			std::vector<TreeViewItem*> result;
 			auto userLists = db_.allUserBanks(synth);
 			userLists = sortLists<midikraft::ListInfo>(userLists, [](const midikraft::ListInfo& info) { return info.name;  });
@@ -399,9 +650,8 @@ TreeViewItem* PatchListTree::newTreeViewItemForStoredBanks(std::shared_ptr<midik
 			synthBanksNode->toggleOpenness();
 		};
 		synthBanksNode->acceptsItem = [](juce::var dropItem) {
-			String dropItemString = dropItem;
-			auto infos = midikraft::PatchHolder::dragInfoFromString(dropItemString.toStdString());
-			return midikraft::PatchHolder::dragItemIsList(infos) && infos["list_sub_type"] == "synth bank";
+			auto const &infos = DragInfoCache::parse(dropItem);
+			return midikraft::PatchHolder::dragItemIsList(infos) && infos.contains("list_sub_type") && infos["list_sub_type"] == "synth bank";
 		};
 		synthBanksNode->onItemDropped = [this](juce::var dropItem, int) {
 			String dropItemString = dropItem;
@@ -434,22 +684,16 @@ TreeViewItem* PatchListTree::newTreeViewItemForStoredBanks(std::shared_ptr<midik
 TreeViewItem* PatchListTree::newTreeViewItemForImports(std::shared_ptr<midikraft::SimpleDiscoverableDevice> synth) {
 	std::string synthName = synth->getName();
 	auto importsForSynth = new TreeViewNode("By import", "imports-" + synthName);
-	importsForSynth->onGenerateChildren = [this, synthName]() {
+	// Owned by the generator, so it goes away with the node
+	auto alive = std::make_shared<bool>(true);
+	importsForSynth->onGenerateChildren = [this, synthName, importsForSynth, alive]() {
+		TraceScope trace("Generate imports", "tree");
 		auto importList = db_.getImportsList(UIModel::instance()->synthList_.synthByName(synthName).synth().get());
 		shortenImportNames(importList);
-		importList = sortLists<midikraft::ImportInfo>(importList, [](const midikraft::ImportInfo& import) { return import.name;  });
+		auto sorted = std::make_shared<std::vector<midikraft::ImportInfo>>(sortLists<midikraft::ImportInfo>(importList, [](const midikraft::ImportInfo& import) { return import.name;  }));
+		// Hundreds of imports would stall opening the synth, so the nodes are created a chunk at a time when scrolled to
 		std::vector<TreeViewItem*> result;
-		for (auto const& import : importList) {
-			auto node = new TreeViewNode(import.name, import.id, true);
-			node->onSelected = [this, synthName](String id) {
-				UIModel::instance()->currentSynth_.changeCurrentSynth(UIModel::instance()->synthList_.synthByName(synthName).synth());
-				UIModel::instance()->multiMode_.setMultiSynthMode(false);
-				if (onImportListSelected)
-					onImportListSelected(id);
-			};
-			node->textValue.addListener(new ImportNameListener(db_, import.id));
-			result.push_back(node);
-		}
+		appendImportChunk(synthName, importsForSynth, alive, sorted, 0, result);
 		return result;
 	};
 	importsForSynth->onSingleClick = [importsForSynth](String) {
@@ -458,6 +702,42 @@ TreeViewItem* PatchListTree::newTreeViewItemForImports(std::shared_ptr<midikraft
 	return importsForSynth;
 }
 
+TreeViewItem* PatchListTree::newTreeViewItemForImport(std::string const &synthName, midikraft::ImportInfo const &import) {
+	auto node = new TreeViewNode(import.name, import.id, true);
+	node->onSelected = [this, synthName](String id) {
+		UIModel::instance()->currentSynth_.changeCurrentSynth(UIModel::instance()->synthList_.synthByName(synthName).synth());
+		UIModel::instance()->multiMode_.setMultiSynthMode(false);
+		if (onImportListSelected)
+			onImportListSelected(id);
+	};
+	node->textValue.addListener(new ImportNameListener(db_, import.id));
+	return node;
+}
+
+void PatchListTree::appendImportChunk(std::string const &synthName, TreeViewNode *parent, std::weak_ptr<bool> parentAlive, std::shared_ptr<std::vector<midikraft::ImportInfo>> imports, size_t start, std::vector<TreeViewItem*> &outItems) {
+	size_t end = std::min(imports->size(), start + kImportChunkSize);
+	for (size_t i = start; i < end; i++) {
+		outItems.push_back(newTreeViewItemForImport(synthName, (*imports)[i]));
+	}
+	if (end < imports->size()) {
+		auto more = new MorePatchesNode(fmt::format("{} more imports...", imports->size() - end));
+		TreeViewItem* placeholder = more;
+		// The imports node might have been closed or regenerated in the meantime, then the placeholder is gone
+		more->setOnVisible([this, synthName, parent, parentAlive, imports, end, placeholder]() {
+			if (parentAlive.expired()) return;
+			int last = parent->getNumSubItems() - 1;
+			if (last < 0 || parent->getSubItem(last) != placeholder) return;
+			std::vector<TreeViewItem*> next;
+			appendImportChunk(synthName, parent, parentAlive, imports, end, next);
+			parent->removeSubItem(last, true);
+			for (auto item : next) {
+				parent->addSubItem(item);
+			}
+		});
+		outItems.push_back(more);
+	}
+}
+
 TreeViewItem* PatchListTree::newTreeViewItemForUserBank(std::shared_ptr<midikraft::Synth> synth, TreeViewNode *parent, midikraft::ListInfo list) {
 	auto node = new TreeViewNode(list.name, list.id);
 	userLists_[list.id] = node;
@@ -485,6 +765,7 @@ TreeViewItem* PatchListTree::newTreeViewItemForUserBank(std::shared_ptr<midikraf
 				if (new_list) {
 					db_.putPatchList(new_list);
 					spdlog::info("Renamed bank from {} to {}", oldname, new_list->name());
+					invalidateSearchIndex();
 					MessageManager::callAsync([parent]() {
 						parent->regenerate();
 						});
@@ -493,6 +774,7 @@ TreeViewItem* PatchListTree::newTreeViewItemForUserBank(std::shared_ptr<midikraf
 				if (new_list) {
 					db_.deletePatchlist(midikraft::ListInfo({ new_list->id(), new_list->name() }));
 					spdlog::info("Deleted user bank {}", new_list->name());
+					invalidateSearchIndex();
 					MessageManager::callAsync([parent]() {
 						parent->regenerate();
 						});
@@ -506,14 +788,19 @@ TreeViewItem* PatchListTree::newTreeViewItemForPatchList(midikraft::ListInfo lis
 	auto node = new TreeViewNode(list.name, list.id);
 	userLists_[list.id] = node;
 	node->onGenerateChildren = [this, list]() {
+		TraceScope trace("Generate list", "tree");
+		// Keep only what the tree nodes display, and create them chunk by chunk while scrolling
+		auto entries = std::make_shared<std::vector<PatchListEntry>>();
 		auto patchList = db_.getPatchList(list, synths_);
-		std::vector<TreeViewItem*> result;
 		if (patchList) {
 			int index = 0;
-			for (auto patch : patchList->patches()) {
-				result.push_back(newTreeViewItemForPatch(list, patch, index++));
+			for (auto const &patch : patchList->patches()) {
+				entries->push_back({ patch.smartSynth()->getName(), patch.patch()->dataTypeID(), patch.md5(), patch.name(), index++ });
 			}
 		}
+		listEntries_[list.id] = entries;
+		std::vector<TreeViewItem*> result;
+		appendPatchListChunk(list, entries, 0, result);
 		return result;
 	};
 	node->onSelected = [this, list](String clicked) {
@@ -523,14 +810,32 @@ TreeViewItem* PatchListTree::newTreeViewItemForPatchList(midikraft::ListInfo lis
 			onUserListSelected(list.id);
 	};
 	node->acceptsItem = [list](juce::var dropItem) {
-		String dropItemString = dropItem;
-		auto infos = midikraft::PatchHolder::dragInfoFromString(dropItemString.toStdString());
-		return midikraft::PatchHolder::dragItemIsPatch(infos) || (midikraft::PatchHolder::dragItemIsList(infos) && infos["list_id"] != list.id);
+		auto const &infos = DragInfoCache::parse(dropItem);
+		return midikraft::PatchHolder::dragItemIsPatch(infos) || isMultiPatchDrag(infos) || (midikraft::PatchHolder::dragItemIsList(infos) && (!infos.contains("list_id") || infos["list_id"] != list.id));
 	};
 	node->onItemDropped = [this, list, node](juce::var dropItem, int insertIndex) {
 		String dropItemString = dropItem;
 		auto infos = midikraft::PatchHolder::dragInfoFromString(dropItemString.toStdString());
-		if (midikraft::PatchHolder::dragItemIsPatch(infos)) {
+		if (isMultiPatchDrag(infos)) {
+			// Several marked patches at once, look them all up first and then add them as one block
+			std::vector<midikraft::PatchHolder> patches;
+			for (auto const &patchInfo : infos["patches"]) {
+				if (!(patchInfo.contains("synth") && patchInfo["synth"].is_string() && patchInfo.contains("md5") && patchInfo["md5"].is_string())) {
+					continue;
+				}
+				std::string synthname = patchInfo["synth"];
+				if (synths_.find(synthname) == synths_.end()) {
+					spdlog::error("Synth unknown during drop operation: {}", synthname);
+					continue;
+				}
+				std::vector<midikraft::PatchHolder> patch;
+				if (db_.getSinglePatch(synths_[synthname].lock(), patchInfo["md5"], patch) && patch.size() == 1) {
+					patches.push_back(patch[0]);
+				}
+			}
+			addPatchesToList(list, patches, insertIndex);
+		}
+		else if (midikraft::PatchHolder::dragItemIsPatch(infos)) {
 			int position = insertIndex;
 			ignoreUnused(position);
 			if (!(infos.contains("synth") && infos["synth"].is_string() && infos.contains("md5") && infos["md5"].is_string())) {
@@ -551,11 +856,14 @@ TreeViewItem* PatchListTree::newTreeViewItemForPatchList(midikraft::ListInfo lis
 				if (infos.contains("list_id") && infos["list_id"] == list.id && infos.contains("order_num")) {
 					// Special case - this is a patch reference from the same list, this is effectively just a reordering operation!
 					db_.movePatchInList(list, patch[0], infos["order_num"], insertIndex);
+					// The database decides where exactly it ends up, so read this one list again
+					listEntries_.erase(list.id);
 				}
 				else {
 					// Simple case - new patch (or patch reference) added to list
 					db_.addPatchToList(list, patch[0], insertIndex);
 					spdlog::info("Patch {} added to list {}", patch[0].name(), list.name);
+					insertIntoListEntries(list.id, { patch[0] }, insertIndex);
 				}
 			}
 			else {
@@ -569,18 +877,20 @@ TreeViewItem* PatchListTree::newTreeViewItemForPatchList(midikraft::ListInfo lis
 				if (AlertWindow::showOkCancelBox(AlertWindow::AlertIconType::QuestionIcon, "Add list to list?"
 					, fmt::format("This will add all {} patches of the list '{}' to the list '{}' at the given position. Continue?", loaded_list->patches().size(), infos["list_name"], list.name
 					))) {
-					for (auto& patch : loaded_list->patches()) {
-						db_.addPatchToList(list, patch, insertIndex++);
-						spdlog::info("Patch {} added to list {}", patch.name(), list.name);
-					}
+					addPatchesToList(list, loaded_list->patches(), insertIndex);
 				}
 			}
 			else {
 				spdlog::error("Program error - dropped list does not contain name and id!");
 			}
 		}
-		MessageManager::callAsync([node]() {
-			node->regenerate();
+		MessageManager::callAsync([this, list, node]() {
+			if (listEntries_.find(list.id) != listEntries_.end()) {
+				rebuildPatchListChildren(list);
+			}
+			else {
+				node->regenerate();
+			}
 			node->setOpenness(TreeViewItem::Openness::opennessOpen);
 			});
 		if (onUserListChanged) {
@@ -602,13 +912,13 @@ TreeViewItem* PatchListTree::newTreeViewItemForPatchList(midikraft::ListInfo lis
 				if (new_list) {
 					db_.putPatchList(new_list);
 					spdlog::info("Renamed list from {} to {}", oldname, new_list->name());
-					regenerateUserLists();
+					userListRenamed({ new_list->id(), new_list->name() });
 				}
 			}, [this](std::shared_ptr<midikraft::PatchList> new_list) {
 				if (new_list) {
 					db_.deletePatchlist(midikraft::ListInfo({ new_list->id(), new_list->name() }));
 					spdlog::info("Deleted list {}", new_list->name());
-					regenerateUserLists();
+					userListDeleted(new_list->id());
 				}
 			});
 	};
@@ -658,6 +968,7 @@ void PatchListTree::changeListenerCallback(ChangeBroadcaster* source)
 		}
 	}
 	else if (source == &UIModel::instance()->importListChanged_) {
+		invalidateSearchIndex();
 		// Did we have a previous synth/state? Then store it!
 		/*if (!previousSynthName_.empty()) {
 			synthSpecificTreeState_[previousSynthName_].reset(treeView_->getOpennessState(true).release());
@@ -698,6 +1009,7 @@ void PatchListTree::changeListenerCallback(ChangeBroadcaster* source)
 		}*/
 	}
 	else if (dynamic_cast<CurrentSynthList*>(source)) {
+		invalidateSearchIndex();
 		// List of synths changed - we need to regenerate the imports list and the library subtrees!
 		MessageManager::callAsync([this]() {
 			allPatchesItem_->regenerate();
@@ -705,6 +1017,7 @@ void PatchListTree::changeListenerCallback(ChangeBroadcaster* source)
 			});
 	}
 	else if (source == &UIModel::instance()->databaseChanged) {
+		invalidateSearchIndex();
 		MessageManager::callAsync([this]() {
 			allPatchesItem_->regenerate();
 			userListsItem_->regenerate();
@@ -712,3 +1025,136 @@ void PatchListTree::changeListenerCallback(ChangeBroadcaster* source)
 			});
 	}
 }
+
+void PatchListTree::invalidateSearchIndex()
+{
+	searchIndexValid_ = false;
+	MessageManager::callAsync([this]() {
+		if (searchResults_.isVisible()) {
+			updateSearchResults();
+		}
+	});
+}
+
+void PatchListTree::rebuildSearchIndex()
+{
+	TraceScope trace("Build library search index", "tree");
+	searchIndex_.clear();
+	for (auto const &list : db_.allPatchLists()) {
+		searchIndex_.add({ LibraryTreeIndex::Kind::UserList, list.name, "", { "userlists", list.id } });
+	}
+	// Only the synths the tree shows
+	for (auto const &device : UIModel::instance()->synthList_.activeSynths()) {
+		std::string synthName = device->getName();
+		std::string library = "library-" + synthName;
+		auto synth = std::dynamic_pointer_cast<midikraft::Synth>(device);
+		if (synth) {
+			size_t banksInSynth = numberOfBanks(synth);
+			for (int i = 0; i < (int) banksInSynth; i++) {
+				int sizeOfBank = midikraft::SynthBank::numberOfPatchesInBank(synth, i);
+				auto bankNumber = MidiBankNumber::fromZeroBase(i, sizeOfBank);
+				auto bank_id = midikraft::ActiveSynthBank::makeId(synth, bankNumber);
+				searchIndex_.add({ LibraryTreeIndex::Kind::SynthBank, midikraft::SynthBank::friendlyBankName(synth, bankNumber), synthName, { "allpatches", library, "banks-" + synthName, bank_id }, i, sizeOfBank });
+			}
+			for (auto const &list : db_.allUserBanks(synth)) {
+				searchIndex_.add({ LibraryTreeIndex::Kind::UserBank, list.name, synthName, { "allpatches", library, "stored-banks-" + synthName, list.id } });
+			}
+		}
+		auto imports = db_.getImportsList(UIModel::instance()->synthList_.synthByName(synthName).synth().get());
+		shortenImportNames(imports);
+		for (auto const &import : imports) {
+			searchIndex_.add({ LibraryTreeIndex::Kind::Import, import.name, synthName, { "allpatches", library, "imports-" + synthName, import.id } });
+		}
+	}
+	searchIndexValid_ = true;
+}
+
+void PatchListTree::updateSearchResults()
+{
+	bool searching = searchBox_.getText().trim().isNotEmpty();
+	if (searching) {
+		if (!searchIndexValid_) {
+			rebuildSearchIndex();
+		}
+		results_ = searchIndex_.search(searchBox_.getText().toStdString(), kMaxSearchResults);
+	}
+	else {
+		results_.clear();
+	}
+	searchResults_.updateContent();
+	searchResults_.repaint();
+	searchResults_.setVisible(searching);
+	treeView_->setVisible(!searching);
+}
+
+void PatchListTree::openSearchResult(LibraryTreeIndex::Entry const &entry)
+{
+	searchBox_.clear();
+	updateSearchResults();
+	// Only the nodes on the path are opened
+	if (selectItemByPath(entry.path)) {
+		return;
+	}
+	// Imports behind the chunks created so far have no node yet, do what selecting one would do
+	auto synth = synths_.find(entry.synthName) != synths_.end() ? synths_[entry.synthName].lock() : nullptr;
+	switch (entry.kind) {
+	case LibraryTreeIndex::Kind::UserList:
+		UIModel::instance()->multiMode_.setMultiSynthMode(true);
+		if (onUserListSelected)
+			onUserListSelected(entry.path.back());
+		break;
+	case LibraryTreeIndex::Kind::UserBank:
+		UIModel::instance()->multiMode_.setMultiSynthMode(false);
+		if (onUserBankSelected && synth)
+			onUserBankSelected(synth, entry.path.back());
+		break;
+	case LibraryTreeIndex::Kind::SynthBank:
+		if (onSynthBankSelected && synth)
+			onSynthBankSelected(synth, MidiBankNumber::fromZeroBase(entry.bankNumber, entry.bankSize));
+		break;
+	case LibraryTreeIndex::Kind::Import:
+		UIModel::instance()->currentSynth_.changeCurrentSynth(UIModel::instance()->synthList_.synthByName(entry.synthName).synth());
+		UIModel::instance()->multiMode_.setMultiSynthMode(false);
+		if (onImportListSelected)
+			onImportListSelected(entry.path.back());
+		break;
+	}
+}
+
+int PatchListTree::getNumRows()
+{
+	return (int) results_.size();
+}
+
+void PatchListTree::paintListBoxItem(int rowNumber, Graphics& g, int width, int height, bool rowIsSelected)
+{
+	if (rowNumber < 0 || rowNumber >= (int) results_.size()) return;
+	auto &lookAndFeel = LookAndFeel::getDefaultLookAndFeel();
+	if (rowIsSelected) {
+		g.fillAll(lookAndFeel.findColour(TextEditor::highlightColourId));
+	}
+	g.setColour(lookAndFeel.findColour(ListBox::textColourId));
+	g.drawText(LibraryTreeIndex::describe(results_[(size_t) rowNumber]), 4, 0, width - 8, height, Justification::centredLeft, true);
+}
+
+void PatchListTree::listBoxItemClicked(int row, MouseEvent const &event)
+{
+	ignoreUnused(event);
+	openSearchResultLater(row);
+}
+
+void PatchListTree::returnKeyPressed(int lastRowSelected)
+{
+	openSearchResultLater(lastRowSelected);
+}
+
+void PatchListTree::openSearchResultLater(int row)
+{
+	if (row >= 0 && row < (int) results_.size()) {
+		// Not from within the list box, opening the result empties it
+		auto entry = results_[(size_t) row];
+		MessageManager::callAsync([this, entry]() {
+			openSearchResult(entry);
+		});
+	}
+}
@@ -12,7 +12,9 @@
 #include "SynthHolder.h"
 #include "TreeViewNode.h"
 
-class PatchListTree : public Component, private ChangeListener {
+#include "LibraryTreeIndex.h"
+
+class PatchListTree : public Component, private ChangeListener, private ListBoxModel {
 public:
 	typedef std::function<void(String)> TSelectionHandler;
 	typedef std::function<void(std::shared_ptr<midikraft::Synth>, MidiBankNumber)> TBankSelectionHandler;
@@ -36,8 +38,18 @@ public:
 	void refreshUserList(std::string list_id);
 	void refreshAllImports();
 
+	// Incremental updates after changes of a single list, these keep the open and selection state of the tree
+	void userListAdded(midikraft::ListInfo const &list);
+	void userListRenamed(midikraft::ListInfo const &list);
+	void userListDeleted(std::string const &list_id);
+	void patchRemovedFromList(std::string const &list_id, int order_num);
+
 	void selectAllIfNothingIsSelected();
-	void selectItemByPath(std::vector<std::string> const& path);
+	// Opens the nodes on the way, returns false if one of them was not found
+	bool selectItemByPath(std::vector<std::string> const& path);
+
+	// Banks the synth has, or the number of bank descriptors it provides
+	static size_t numberOfBanks(std::shared_ptr<midikraft::Synth> synth);
 
 	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PatchListTree)
 	
@@ -50,23 +62,60 @@ private:
 	bool isUserListSelected() const;
 	std::list<std::string> pathOfSelectedItem() const;
 
-	TreeViewItem* newTreeViewItemForPatch(midikraft::ListInfo list, midikraft::PatchHolder patchHolder, int index);
+	// Just what a tree node of a patch in a list shows and drags, the full patch is loaded from the database when selected
+	struct PatchListEntry {
+		std::string synthName;
+		int dataType;
+		std::string md5;
+		std::string name;
+		int orderNum;
+	};
+	static constexpr size_t kPatchListChunkSize = 100;
+	static constexpr size_t kImportChunkSize = 100;
+
+	TreeViewItem* newTreeViewItemForPatch(midikraft::ListInfo list, PatchListEntry const &entry);
+	static bool isMultiPatchDrag(nlohmann::json const &infos);
+	void addPatchesToList(midikraft::ListInfo const &list, std::vector<midikraft::PatchHolder> const &patches, int insertIndex);
+	void insertIntoListEntries(std::string const &list_id, std::vector<midikraft::PatchHolder> const &patches, int insertIndex);
+	void rebuildPatchListChildren(midikraft::ListInfo list);
+	void appendPatchListChunk(midikraft::ListInfo list, std::shared_ptr<std::vector<PatchListEntry>> entries, size_t start, std::vector<TreeViewItem*> &outItems);
 	TreeViewItem* newTreeViewItemForSynthBanks(std::shared_ptr<midikraft::SimpleDiscoverableDevice> synth);
 	TreeViewItem* newTreeViewItemForStoredBanks(std::shared_ptr<midikraft::SimpleDiscoverableDevice> synth);
 	TreeViewItem* newTreeViewItemForImports(std::shared_ptr<midikraft::SimpleDiscoverableDevice> synth);
+	TreeViewItem* newTreeViewItemForImport(std::string const &synthName, midikraft::ImportInfo const &import);
+	// parentAlive expires with the node the imports are shown under
+	void appendImportChunk(std::string const &synthName, TreeViewNode *parent, std::weak_ptr<bool> parentAlive, std::shared_ptr<std::vector<midikraft::ImportInfo>> imports, size_t start, std::vector<TreeViewItem*> &outItems);
 	TreeViewItem* newTreeViewItemForUserBank(std::shared_ptr<midikraft::Synth> synth, TreeViewNode* parent, midikraft::ListInfo list);
 	TreeViewItem* newTreeViewItemForPatchList(midikraft::ListInfo list);
 
 	void changeListenerCallback(ChangeBroadcaster* source) override;
 
+	// The search box shows its results instead of the tree, choosing one reveals it in the tree
+	void invalidateSearchIndex();
+	void rebuildSearchIndex();
+	void updateSearchResults();
+	void openSearchResult(LibraryTreeIndex::Entry const &entry);
+	void openSearchResultLater(int row);
+	int getNumRows() override;
+	void paintListBoxItem(int rowNumber, Graphics& g, int width, int height, bool rowIsSelected) override;
+	void listBoxItemClicked(int row, MouseEvent const &event) override;
+	void returnKeyPressed(int lastRowSelected) override;
+	static constexpr size_t kMaxSearchResults = 200;
+
 	std::map<std::string, std::weak_ptr<midikraft::Synth>> synths_; // The database needs this to load patch lists
 	//std::map<std::string, std::unique_ptr<XmlElement>> synthSpecificTreeState_;
 
 	midikraft::PatchDatabase& db_;
 
 	std::unique_ptr<TreeView> treeView_;
+	TextEditor searchBox_;
+	ListBox searchResults_;
+	LibraryTreeIndex searchIndex_; // Built on the first search after a change
+	bool searchIndexValid_ = false;
+	std::vector<LibraryTreeIndex::Entry> results_;
 	TreeViewNode* allPatchesItem_;
 	TreeViewNode* userListsItem_;
 	std::map<std::string, TreeViewNode*> userLists_;
+	std::map<std::string, std::shared_ptr<std::vector<PatchListEntry>>> listEntries_; // Of the lists that have been opened
 };
 
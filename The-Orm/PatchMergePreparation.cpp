@@ -0,0 +1,110 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "PatchMergePreparation.h"
+
+#include "ParallelFor.h"
+#include "GenericAdaptation.h"
+#include "Metrics.h"
+
+#include <spdlog/spdlog.h>
+
+#include <map>
+#include <string>
+#include <unordered_map>
+
+namespace {
+	constexpr size_t kPythonBatchSize = 256;
+}
+
+bool PatchMergePreparation::prepare(std::vector<midikraft::PatchHolder> &patches, std::shared_ptr<midikraft::AutomaticCategory> categorizer, std::function<bool(double)> const &progress)
+{
+	double split = 0.0;
+	if (categorizer) {
+		split = 0.5;
+		bool completed = parallelFor(patches.size(), [&](size_t i) {
+			patches[i].autoCategorizeAgain(categorizer);
+		}, progress, 0.0, split);
+		if (!completed) {
+			return false;
+		}
+	}
+	return calculateFingerprints(patches, progress, split, 1.0);
+}
+
+void PatchMergePreparation::autoCategorize(std::vector<midikraft::PatchHolder> &patches, std::shared_ptr<midikraft::AutomaticCategory> categorizer)
+{
+	parallelFor(patches.size(), [&](size_t i) {
+		patches[i].autoCategorizeAgain(categorizer);
+	}, [](double) { return true; });
+}
+
+int PatchMergePreparation::mergeWithoutDuplicates(midikraft::PatchDatabase &database, std::vector<midikraft::PatchHolder> &patches, std::vector<midikraft::PatchHolder> &outNewPatches,
+	midikraft::ProgressHandler *progressHandler, unsigned updateChoice)
+{
+	auto firsts = firstOccurrences(patches);
+	if (firsts.size() == patches.size()) {
+		return database.mergePatchesIntoDatabase(patches, outNewPatches, progressHandler, updateChoice);
+	}
+
+	spdlog::debug("Merging {} distinct patches, {} more were repeats within the batch", firsts.size(), patches.size() - firsts.size());
+	Metrics::instance().counter("merge.batch_repeats").add(patches.size() - firsts.size());
+	std::vector<midikraft::PatchHolder> distinct;
+	distinct.reserve(firsts.size());
+	for (auto position : firsts) {
+		distinct.push_back(patches[position]);
+	}
+	auto result = database.mergePatchesIntoDatabase(distinct, outNewPatches, progressHandler, updateChoice);
+	for (size_t i = 0; i < firsts.size(); i++) {
+		patches[firsts[i]] = std::move(distinct[i]);
+	}
+	return result;
+}
+
+std::vector<size_t> PatchMergePreparation::firstOccurrences(std::vector<midikraft::PatchHolder> const &patches)
+{
+	// The hash of the key sorts out nearly all distinct patches, equal hashes are confirmed by comparing the md5 itself
+	std::unordered_map<std::string, size_t> seen;
+	seen.reserve(patches.size());
+	std::vector<size_t> result;
+	result.reserve(patches.size());
+	for (size_t i = 0; i < patches.size(); i++) {
+		auto const &patch = patches[i];
+		auto key = (patch.smartSynth() ? patch.smartSynth()->getName() : std::string()) + ":" + patch.md5();
+		if (seen.emplace(std::move(key), i).second) {
+			result.push_back(i);
+		}
+	}
+	return result;
+}
+
+bool PatchMergePreparation::calculateFingerprints(std::vector<midikraft::PatchHolder> const &patches, std::function<bool(double)> const &progress, double from, double to)
+{
+	// Native fingerprints are cheap C++, only the adaptations are worth the effort of batching
+	std::map<std::shared_ptr<knobkraft::GenericAdaptation>, midikraft::TPatchVector> byAdaptation;
+	size_t total = 0;
+	for (auto const &patch : patches) {
+		auto adaptation = std::dynamic_pointer_cast<knobkraft::GenericAdaptation>(patch.smartSynth());
+		if (adaptation && patch.patch()) {
+			byAdaptation[adaptation].push_back(patch.patch());
+			total++;
+		}
+	}
+
+	size_t done = 0;
+	for (auto const &adaptation : byAdaptation) {
+		auto const &dataFiles = adaptation.second;
+		for (size_t start = 0; start < dataFiles.size(); start += kPythonBatchSize) {
+			midikraft::TPatchVector batch(dataFiles.begin() + (long) start, dataFiles.begin() + (long) std::min(dataFiles.size(), start + kPythonBatchSize));
+			adaptation.first->calculateFingerprints(batch);
+			done += batch.size();
+			if (!progress(from + (to - from) * done / (double) total)) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
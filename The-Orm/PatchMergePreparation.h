@@ -0,0 +1,39 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include "PatchHolder.h"
+#include "PatchDatabase.h"
+#include "AutomaticCategory.h"
+#include "ProgressHandler.h"
+
+#include <functional>
+#include <vector>
+
+// The per patch work before PatchDatabase::mergePatchesIntoDatabase, done in bulk ahead of the database pass.
+// Auto categorization runs on all cores. The fingerprints needed by the database to find existing patches are calculated
+// for Python adaptations in few large calls, so the merge itself finds them in the adaptation's result cache.
+// Patches found several times in one batch, like the init patch in every bank of a backup, go to the database only once.
+class PatchMergePreparation {
+public:
+	// Pass a categorizer to also categorize the patches again. Progress is reported with values from 0 to 1, return false to abort
+	static bool prepare(std::vector<midikraft::PatchHolder> &patches, std::shared_ptr<midikraft::AutomaticCategory> categorizer, std::function<bool(double)> const &progress);
+
+	static void autoCategorize(std::vector<midikraft::PatchHolder> &patches, std::shared_ptr<midikraft::AutomaticCategory> categorizer);
+
+	// mergePatchesIntoDatabase with only the first occurrence of each distinct patch, call after prepare so the fingerprints are known.
+	// The first occurrences get back what the merge made of them, the repeats keep their own copy, so every place of the batch stays filled
+	static int mergeWithoutDuplicates(midikraft::PatchDatabase &database, std::vector<midikraft::PatchHolder> &patches, std::vector<midikraft::PatchHolder> &outNewPatches,
+		midikraft::ProgressHandler *progressHandler, unsigned updateChoice);
+	// The positions of the first occurrence of each distinct patch, by synth and fingerprint, in the order of the batch
+	static std::vector<size_t> firstOccurrences(std::vector<midikraft::PatchHolder> const &patches);
+
+private:
+	static bool calculateFingerprints(std::vector<midikraft::PatchHolder> const &patches, std::function<bool(double)> const &progress, double from, double to);
+};
@@ -31,25 +31,34 @@ void PatchPerSynthList::resized()
 
 void PatchPerSynthList::setPatches(std::vector<midikraft::PatchHolder> const &patches)
 {
-	patchButtons_.clear();
-	buttonForSynth_.clear();
-	int i = 0;
-	for (auto patch : patches) {
-		patchButtons_.push_back(std::make_shared<PatchHolderButton>(i++, false, [](int) {
+	// Switching patches quickly calls this all the time, so the buttons there are rebound and only the difference is created or removed
+	bool countChanged = patches.size() != patchButtons_.size();
+	while (patchButtons_.size() > patches.size()) {
+		removeChildComponent(patchButtons_.back().get());
+		patchButtons_.pop_back();
+	}
+	while (patchButtons_.size() < patches.size()) {
+		patchButtons_.push_back(std::make_shared<PatchHolderButton>((int) patchButtons_.size(), false, [](int) {
 		}));
+		addAndMakeVisible(*patchButtons_.back());
+	}
+	buttonForSynth_.clear();
+	for (size_t i = 0; i < patches.size(); i++) {
+		auto patch = patches[i];
 		if (patch.patch() && patch.synth()) {
-			patchButtons_.back()->setPatchHolder(&patch, false, PatchHolderButton::getCurrentInfoForSynth(patch.synth()->getName()));
+			patchButtons_[i]->setPatchHolder(&patch, false, PatchHolderButton::getCurrentInfoForSynth(patch.synth()->getName()));
 		}
 		else {
 			// No patch, reset button
-			patchButtons_.back()->setPatchHolder(nullptr, false, PatchButtonInfo::CenterName);
+			patchButtons_[i]->setPatchHolder(nullptr, false, PatchButtonInfo::CenterName);
 		}
-		addAndMakeVisible(*patchButtons_.back());
 		if (patch.synth()) {
-			buttonForSynth_[patch.synth()->getName()] = patchButtons_.back();
+			buttonForSynth_[patch.synth()->getName()] = patchButtons_[i];
 		}
 	}
-	resized();
+	if (countChanged) {
+		resized();
+	}
 }
 
 void PatchPerSynthList::changeListenerCallback(ChangeBroadcaster* source)
@@ -76,7 +76,7 @@ PatchSearchComponent::PatchSearchComponent(PatchView* patchView, PatchButtonPane
         multiModeFilter_({}),
         patchView_(patchView),
         patchButtons_(patchButtons),
-        textSearch_([this]() { updateCurrentFilter(); patchView_->retrieveFirstPageFromDatabase();  }),
+        textSearch_([this]() { textSearchChanged(); }),
         categoryFilters_({}, [this](CategoryButtons::Category) { updateCurrentFilter(); patchView_->retrieveFirstPageFromDatabase(); }, true, true),
         database_(database)
 {
@@ -131,18 +131,12 @@ PatchSearchComponent::PatchSearchComponent(PatchView* patchView, PatchButtonPane
 	// Need to initialize multiModeFilter, else we get weird search results
 	multiModeFilter_ = midikraft::PatchFilter({});
 
-	UIModel::instance()->currentSynth_.addChangeListener(this);
-	UIModel::instance()->multiMode_.addChangeListener(this);
-	UIModel::instance()->synthList_.addChangeListener(this);
-	UIModel::instance()->categoriesChanged.addChangeListener(this);
+	UIModel::instance()->modelChanges_.addListener(this);
 }
 
 PatchSearchComponent::~PatchSearchComponent()
 {
-	UIModel::instance()->categoriesChanged.removeChangeListener(this);
-	UIModel::instance()->currentSynth_.removeChangeListener(this);
-	UIModel::instance()->multiMode_.removeChangeListener(this);
-	UIModel::instance()->synthList_.removeChangeListener(this);
+	UIModel::instance()->modelChanges_.removeListener(this);
 }
 
 std::string PatchSearchComponent::currentSynthNameWithMulti() {
@@ -243,6 +237,15 @@ midikraft::PatchFilter PatchSearchComponent::getFilter()
 	return buildFilter();
 }
 
+void PatchSearchComponent::textSearchChanged()
+{
+	// Results of queries for intermediate text are dropped by the PatchView anyway, so don't even start them
+	typeAheadDebounce_.callDebounced([this]() {
+		updateCurrentFilter();
+		patchView_->retrieveFirstPageFromDatabase(true);
+	}, kTypeAheadDebounceMS);
+}
+
 void PatchSearchComponent::updateCurrentFilter()
 {
 	if (!isInMultiSynthMode()) {
@@ -261,13 +264,12 @@ void PatchSearchComponent::updateCurrentFilter()
 midikraft::PatchFilter PatchSearchComponent::buildFilter() const
 {
 	// Transform into real category
+	categoryIndex_.update(database_.getCategories());
 	std::set<midikraft::Category> catSelected;
-	for (auto c : categoryFilters_.selectedCategories()) {
-		for (auto dc : database_.getCategories()) {
-			if (dc.category() == c.category) {
-				catSelected.emplace(dc);
-				break;
-			}
+	for (auto const &c : categoryFilters_.selectedCategories()) {
+		auto category = categoryIndex_.byName(c.category);
+		if (category) {
+			catSelected.insert(*category);
 		}
 	}
 	bool typeSelected = false;
@@ -277,7 +279,7 @@ midikraft::PatchFilter PatchSearchComponent::buildFilter() const
 		filterType = advancedFilters_->dataTypeSelector_.getSelectedId() - 2;
 	}*/
 	std::string nameFilter = "";
-	if (!textSearch_.searchText().startsWith("!")) {
+	if (!textSearch_.searchText().startsWith("!") && !textSearch_.searchText().startsWith("~")) {
 		nameFilter = textSearch_.searchText().toStdString();
 	}
 	std::map<std::string, std::weak_ptr<midikraft::Synth>> synthMap;
@@ -308,9 +310,15 @@ midikraft::PatchFilter PatchSearchComponent::buildFilter() const
 	return filter;
 }
 
-void PatchSearchComponent::changeListenerCallback(ChangeBroadcaster* source)
+void PatchSearchComponent::modelChanged(int aspects)
 {
-	if (dynamic_cast<CurrentSynth*>(source) || dynamic_cast<CurrentMultiMode*>(source)) {
+	bool requery = false;
+	if (aspects & ModelChanges::SynthList) {
+		// First, so a switch to multi mode in the same action already filters for the new list
+		multiModeFilter_.synths = allSynthsMap();
+		requery = isInMultiSynthMode();
+	}
+	if (aspects & (ModelChanges::CurrentSynth | ModelChanges::MultiMode)) {
 		auto currentSynth = UIModel::instance()->currentSynth_.smartSynth();
         std::string synthName = "none";
         if (currentSynth) {
@@ -346,17 +354,13 @@ void PatchSearchComponent::changeListenerCallback(ChangeBroadcaster* source)
 			}
 			loadFilter(synthSpecificFilter_.at(synthName));
 		}
-
-		patchView_->retrieveFirstPageFromDatabase();
-		resized();
+		requery = true;
 	}
-	else if (dynamic_cast<CurrentSynthList*>(source)) {
-		multiModeFilter_.synths = allSynthsMap();
-		if (isInMultiSynthMode())
-			patchView_->retrieveFirstPageFromDatabase();
-	}
-	else if (source == &UIModel::instance()->categoriesChanged) {
+	else if (aspects & ModelChanges::Categories) {
 		categoryFilters_.setCategories(patchView_->predefinedCategories());
+		requery = true;
+	}
+	if (requery) {
 		patchView_->retrieveFirstPageFromDatabase();
 		resized();
 	}
@@ -7,12 +7,15 @@
 #pragma once
 
 #include "PatchView.h"
+#include "UIModel.h"
 
 #include "TextSearchBox.h"
+#include "DebounceTimer.h"
+#include "CategoryBitIndex.h"
 
 class AdvancedFilterPanel;
 
-class PatchSearchComponent : public Component, private ChangeListener
+class PatchSearchComponent : public Component, private ModelChanges::Listener
 {
 public:
 	PatchSearchComponent(PatchView* patchView, PatchButtonPanel* patchButtons, midikraft::PatchDatabase& database);
@@ -25,16 +28,21 @@ public:
 	
 	midikraft::PatchFilter getFilter();
 
-	void changeListenerCallback(ChangeBroadcaster* source) override;
+	// A synth switch also changing the multi mode or the synth list reloads the filter and queries the first page only once
+	void modelChanged(int aspects) override;
 
 	void rebuildDataTypeFilterBox();
 
 	String advancedTextSearch() const;
+
+	// Time the user has to pause typing before a new query is started
+	static constexpr int kTypeAheadDebounceMS = 150;
 	
 private:
 	std::string currentSynthNameWithMulti();
 	static bool isInMultiSynthMode();
 	void updateCurrentFilter(); 
+	void textSearchChanged();
 	midikraft::PatchFilter buildFilter() const;
 
 	std::map<std::string, midikraft::PatchFilter> synthSpecificFilter_; // We store one filter per synth
@@ -51,8 +59,10 @@ private:
 	ToggleButton onlyDuplicates_;
 	ToggleButton andCategories_;
 	ComboBox buttonDisplayType_;
+	DebounceTimer typeAheadDebounce_; // Only query once the user pauses typing
 
 	midikraft::PatchDatabase& database_;
+	mutable CategoryBitIndex categoryIndex_; // Brought up to date with the database whenever a filter is built
 };
 
 
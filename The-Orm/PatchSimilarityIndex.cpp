@@ -0,0 +1,176 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "PatchSimilarityIndex.h"
+
+#include "Capability.h"
+#include "DetailedParametersCapability.h"
+#include "LayeredPatchCapability.h"
+
+#include <algorithm>
+#include <limits>
+
+PatchSimilarityIndex::PatchSimilarityIndex(PatchHandleStore &store) : store_(store)
+{
+}
+
+void PatchSimilarityIndex::clear()
+{
+	tables_.clear();
+}
+
+bool PatchSimilarityIndex::hasSynth(std::string const &synthName) const
+{
+	return tables_.find(synthName) != tables_.end();
+}
+
+std::vector<float> PatchSimilarityIndex::features(midikraft::PatchHolder const &patch)
+{
+	std::vector<float> result;
+	if (!patch.patch() || !patch.synth()) {
+		return result;
+	}
+
+	auto parameterDetails = midikraft::Capability::hasCapability<midikraft::DetailedParametersCapability>(patch.patch());
+	if (parameterDetails) {
+		int numLayers = 1;
+		auto layers = midikraft::Capability::hasCapability<midikraft::LayeredPatchCapability>(patch.patch());
+		if (layers) {
+			numLayers = layers->numberOfLayers();
+		}
+		auto parameters = parameterDetails->allParameterDefinitions();
+		for (int layer = 0; layer < numLayers; layer++) {
+			for (auto param : parameters) {
+				if (layers) {
+					auto multiLayerParam = midikraft::Capability::hasCapability<midikraft::SynthMultiLayerParameterCapability>(param);
+					if (multiLayerParam) {
+						multiLayerParam->setSourceLayer(layer);
+					}
+				}
+				// Keep one dimension per parameter even if it has no value, so the vectors of a synth line up
+				int value = 0;
+				auto intParam = midikraft::Capability::hasCapability<midikraft::SynthIntParameterCapability>(param);
+				if (intParam && !intParam->valueInPatch(*patch.patch(), value)) {
+					value = 0;
+				}
+				result.push_back((float) value);
+			}
+		}
+	}
+	else {
+		auto data = patch.synth()->filterVoiceRelevantData(patch.patch());
+		result.assign(data.begin(), data.end());
+	}
+	return result;
+}
+
+void PatchSimilarityIndex::add(std::vector<midikraft::PatchHolder> const &patches)
+{
+	for (auto const &patch : patches) {
+		auto vector = features(patch);
+		if (vector.empty()) {
+			continue;
+		}
+		auto &table = tables_[patch.synth()->getName()];
+		if (table.dimensions == 0) {
+			table.dimensions = vector.size();
+			table.minimum = vector;
+			table.maximum = vector;
+		}
+		// Data of differing length is padded or cut to the size of the first patch seen
+		vector.resize(table.dimensions, 0.0f);
+
+		size_t row;
+		auto existing = table.rowByMd5.find(patch.md5());
+		if (existing != table.rowByMd5.end()) {
+			row = existing->second;
+			table.patches[row] = store_.intern(patch);
+		}
+		else {
+			row = table.patches.size();
+			table.patches.push_back(store_.intern(patch));
+			table.values.resize(table.values.size() + table.dimensions);
+			table.rowByMd5[patch.md5()] = row;
+		}
+		std::copy(vector.begin(), vector.end(), table.values.begin() + (std::ptrdiff_t) (row * table.dimensions));
+		for (size_t d = 0; d < table.dimensions; d++) {
+			table.minimum[d] = std::min(table.minimum[d], vector[d]);
+			table.maximum[d] = std::max(table.maximum[d], vector[d]);
+		}
+	}
+	for (auto &table : tables_) {
+		updateWeights(table.second);
+	}
+}
+
+void PatchSimilarityIndex::updateWeights(SynthTable &table)
+{
+	table.weights.resize(table.dimensions);
+	for (size_t d = 0; d < table.dimensions; d++) {
+		float range = table.maximum[d] - table.minimum[d];
+		table.weights[d] = range > 0.0f ? 1.0f / (range * range) : 0.0f;
+	}
+}
+
+float PatchSimilarityIndex::weightedDistance(float const *a, float const *b, float const *weights, size_t dimensions)
+{
+	// Four independent sums, so the compiler can keep this in vector registers
+	float sum0 = 0.0f, sum1 = 0.0f, sum2 = 0.0f, sum3 = 0.0f;
+	size_t d = 0;
+	for (; d + 4 <= dimensions; d += 4) {
+		float d0 = a[d] - b[d];
+		float d1 = a[d + 1] - b[d + 1];
+		float d2 = a[d + 2] - b[d + 2];
+		float d3 = a[d + 3] - b[d + 3];
+		sum0 += d0 * d0 * weights[d];
+		sum1 += d1 * d1 * weights[d + 1];
+		sum2 += d2 * d2 * weights[d + 2];
+		sum3 += d3 * d3 * weights[d + 3];
+	}
+	for (; d < dimensions; d++) {
+		float diff = a[d] - b[d];
+		sum0 += diff * diff * weights[d];
+	}
+	return (sum0 + sum1) + (sum2 + sum3);
+}
+
+std::vector<std::pair<midikraft::PatchHolder, float>> PatchSimilarityIndex::nearest(midikraft::PatchHolder const &patch, size_t k) const
+{
+	std::vector<std::pair<midikraft::PatchHolder, float>> result;
+	if (!patch.synth()) {
+		return result;
+	}
+	auto found = tables_.find(patch.synth()->getName());
+	if (found == tables_.end() || found->second.dimensions == 0) {
+		return result;
+	}
+	auto const &table = found->second;
+	auto query = features(patch);
+	query.resize(table.dimensions, 0.0f);
+
+	std::vector<std::pair<float, size_t>> distances;
+	distances.reserve(table.patches.size());
+	for (size_t row = 0; row < table.patches.size(); row++) {
+		if (store_.patch(table.patches[row]).md5() == patch.md5()) continue;
+		distances.emplace_back(weightedDistance(query.data(), table.values.data() + row * table.dimensions, table.weights.data(), table.dimensions), row);
+	}
+	size_t count = std::min(k, distances.size());
+	std::partial_sort(distances.begin(), distances.begin() + (std::ptrdiff_t) count, distances.end());
+	for (size_t i = 0; i < count; i++) {
+		result.emplace_back(store_.patch(table.patches[distances[i].second]), distances[i].first);
+	}
+	return result;
+}
+
+std::vector<midikraft::PatchHolder> PatchSimilarityIndex::nearDuplicates(midikraft::PatchHolder const &patch, float maxDistance) const
+{
+	std::vector<midikraft::PatchHolder> result;
+	for (auto const &candidate : nearest(patch, std::numeric_limits<size_t>::max())) {
+		if (candidate.second > maxDistance) break;
+		result.push_back(candidate.first);
+	}
+	return result;
+}
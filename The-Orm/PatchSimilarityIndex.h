@@ -0,0 +1,55 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include "PatchHolder.h"
+#include "PatchHandleStore.h"
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+// In memory nearest neighbour index over numeric feature vectors of patches, one table per synth.
+// The features are the integer parameter values if the synth has detailed parameters, else the voice relevant bytes
+// of the patch data. Each dimension is scaled by the value range found in the library, so all parameters weigh the same.
+class PatchSimilarityIndex {
+public:
+	// The patches are kept in the store, the index only holds their handles
+	explicit PatchSimilarityIndex(PatchHandleStore &store);
+
+	void clear();
+	bool hasSynth(std::string const &synthName) const;
+
+	// Patches already in the index are replaced
+	void add(std::vector<midikraft::PatchHolder> const &patches);
+
+	// The k patches of the same synth closest to the given one, closest first, with their distance. The patch itself is not included
+	std::vector<std::pair<midikraft::PatchHolder, float>> nearest(midikraft::PatchHolder const &patch, size_t k) const;
+	// Patches closer than maxDistance, candidates for duplicates of the given one
+	std::vector<midikraft::PatchHolder> nearDuplicates(midikraft::PatchHolder const &patch, float maxDistance) const;
+
+	static std::vector<float> features(midikraft::PatchHolder const &patch);
+
+private:
+	struct SynthTable {
+		size_t dimensions = 0;
+		std::vector<float> values; // One row of dimensions floats per patch
+		std::vector<float> minimum, maximum;
+		std::vector<float> weights; // 1/range^2 per dimension, 0 for constant dimensions
+		std::vector<PatchHandleStore::Handle> patches;
+		std::map<std::string, size_t> rowByMd5;
+	};
+
+	static void updateWeights(SynthTable &table);
+	static float weightedDistance(float const *a, float const *b, float const *weights, size_t dimensions);
+
+	PatchHandleStore &store_;
+	std::map<std::string, SynthTable> tables_;
+};
@@ -0,0 +1,48 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "PatchStateStore.h"
+
+#include "UIModel.h"
+
+PatchStateStore &PatchStateStore::instance()
+{
+	static PatchStateStore sInstance;
+	return sInstance;
+}
+
+juce::ValueTree PatchStateStore::nodeFor(std::string const &md5)
+{
+	//TODO - this might cause memory growth if we never clear the cache. Can we somehow count how many buttons reference these ephemeral values?
+	auto cache = Data::instance().getEphemeral().getOrCreateChildWithName(EPROPERTY_PATCH_CACHE, nullptr);
+	return cache.getOrCreateChildWithName(juce::Identifier(md5), nullptr);
+}
+
+void PatchStateStore::publish(midikraft::PatchHolder const &patch, Colour const &defaultColour)
+{
+	Colour colour = defaultColour;
+	auto cats = patch.categories();
+	if (!cats.empty()) {
+		colour = cats.cbegin()->color();
+	}
+	pending_[patch.md5()] = { patch.isFavorite(), patch.isHidden(), colour.toString() };
+	if (!isTimerRunning()) {
+		startTimer(kFrameIntervalMS);
+	}
+}
+
+void PatchStateStore::timerCallback()
+{
+	stopTimer();
+	auto changes = std::move(pending_);
+	pending_.clear();
+	for (auto const &change : changes) {
+		auto node = nodeFor(change.first);
+		node.setProperty(EPROPERTY_PATCH_FAVORITE, change.second.favorite, nullptr);
+		node.setProperty(EPROPERTY_PATCH_HIDDEN, change.second.hidden, nullptr);
+		node.setProperty(EPROPERTY_PATCH_COLOR, change.second.colour, nullptr);
+	}
+}
@@ -0,0 +1,40 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include "PatchHolder.h"
+
+#include <map>
+#include <string>
+
+// The displayed state of all loaded patches, one ValueTree node per md5 in the ephemeral data. All PatchHolderButtons
+// showing a patch bind to its node, so publishing a change of a patch updates exactly the buttons showing it, wherever they are.
+// Changes are collected and applied together once per frame.
+class PatchStateStore : private Timer {
+public:
+	static PatchStateStore &instance();
+
+	static juce::ValueTree nodeFor(std::string const &md5);
+
+	// Call after favorite, hidden or categories of a patch changed
+	void publish(midikraft::PatchHolder const &patch, Colour const &defaultColour);
+
+	static constexpr int kFrameIntervalMS = 16;
+
+private:
+	struct PatchState {
+		bool favorite;
+		bool hidden;
+		String colour;
+	};
+
+	void timerCallback() override;
+
+	std::map<std::string, PatchState> pending_;
+};
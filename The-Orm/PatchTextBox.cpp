@@ -6,6 +6,8 @@
 
 #include "PatchTextBox.h"
 
+#include "PatchTextRenderer.h"
+
 #include "Capability.h"
 #include "DetailedParametersCapability.h"
 #include "LayeredPatchCapability.h"
@@ -74,7 +76,7 @@ void PatchTextBox::refreshText() {
 		text = makeTextDocument(patch_);
 		break;
 	}
-	document_->replaceAllContent(text);
+	PatchTextRenderer::updateDocument(*document_, text);
 }
 
 void PatchTextBox::resized()
@@ -93,25 +95,7 @@ String PatchTextBox::makeHexDocument(std::shared_ptr<midikraft::PatchHolder> pat
 	if (!patch || !patch->patch())
 		return "No patch active";
 
-	String result;
-	std::vector<uint8> binaryData = patch->patch()->data();
-
-	uint8 *line = binaryData.data();
-	int consumed = 0;
-	while (consumed < (int)binaryData.size()) {
-		uint8 posLSB = consumed & 0xff;
-		uint8 posMSB = (consumed >> 8) & 0xff;
-		result += String::toHexString(&posMSB, 1, 1) + String::toHexString(&posLSB, 1, 1) + " ";
-		int lineLength = std::min(8, ((int)binaryData.size()) - consumed);
-		String hex = String::toHexString(line, lineLength, 1);
-		result += hex;
-		result += "\n";
-
-		line += lineLength;
-		consumed += lineLength;
-	}
-
-	return result;
+	return String(PatchTextRenderer::hexDump(patch->patch()->data()));
 }
 
 String PatchTextBox::makeTextDocument(std::shared_ptr<midikraft::PatchHolder> patch) {
@@ -120,46 +104,10 @@ String PatchTextBox::makeTextDocument(std::shared_ptr<midikraft::PatchHolder> pa
 
 	auto realPatch = std::dynamic_pointer_cast<midikraft::Patch>(patch->patch());
 	if (realPatch) {
-		return patchToTextRaw(realPatch, false);
+		return String(PatchTextRenderer::parametersToText(realPatch, false));
 	}
 	else {
 		return "makeTextDocument not implemented yet";
 	}
 }
 
-std::string PatchTextBox::patchToTextRaw(std::shared_ptr<midikraft::Patch> patch, bool onlyActive)
-{
-	std::string result;
-
-	int numLayers = 1;
-	auto layers = midikraft::Capability::hasCapability<midikraft::LayeredPatchCapability>(patch);
-	if (layers) {
-		numLayers = layers->numberOfLayers();
-	}
-
-	auto parameterDetails = midikraft::Capability::hasCapability<midikraft::DetailedParametersCapability>(patch);
-
-	if (parameterDetails) {
-		for (int layer = 0; layer < numLayers; layer++) {
-			if (layers) {
-				if (layer > 0) result += "\n";
-				result = result + fmt::format("Layer: {}\n", layers->layerName(layer));
-			}
-			for (auto param : parameterDetails->allParameterDefinitions()) {
-				if (layers) {
-					auto multiLayerParam = midikraft::Capability::hasCapability<midikraft::SynthMultiLayerParameterCapability>(param);
-					jassert(multiLayerParam);
-					if (multiLayerParam) {
-						multiLayerParam->setSourceLayer(layer);
-					}
-				}
-				auto activeCheck = midikraft::Capability::hasCapability<midikraft::SynthParameterActiveDetectionCapability>(param);
-				if (!onlyActive || !activeCheck || !(activeCheck->isActive(patch.get()))) {
-					result = result + fmt::format("{}: {}\n",param->description(), param->valueInPatchToText(*patch));
-				}
-			}
-		}
-	}
-	return result;
-}
-
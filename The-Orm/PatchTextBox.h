@@ -23,7 +23,6 @@ public:
 
 	static String makeHexDocument(std::shared_ptr<midikraft::PatchHolder> patch);
 	static String makeTextDocument(std::shared_ptr<midikraft::PatchHolder> patch);
-	static std::string patchToTextRaw(std::shared_ptr<midikraft::Patch> patch, bool onlyActive);
 
 private:
 	void refreshText();
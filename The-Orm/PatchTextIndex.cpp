@@ -0,0 +1,209 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "PatchTextIndex.h"
+
+#include "PatchTextRenderer.h"
+
+#include <algorithm>
+#include <cctype>
+#include <map>
+#include <set>
+
+PatchTextIndex::PatchTextIndex(PatchHandleStore &store) : store_(store)
+{
+}
+
+void PatchTextIndex::clear()
+{
+	entries_.clear();
+	entryByMd5_.clear();
+	postings_.clear();
+}
+
+bool PatchTextIndex::isEmpty() const
+{
+	return entries_.empty();
+}
+
+std::string PatchTextIndex::indexText(midikraft::PatchHolder const &patch, bool withParameterText)
+{
+	std::string text = patch.name();
+	if (patch.sourceInfo() && patch.synth()) {
+		text += "\n" + patch.sourceInfo()->toDisplayString(patch.synth(), false);
+	}
+	for (auto const &category : patch.categories()) {
+		text += "\n" + category.category();
+	}
+	if (withParameterText) {
+		auto realPatch = std::dynamic_pointer_cast<midikraft::Patch>(patch.patch());
+		if (realPatch) {
+			text += "\n" + PatchTextRenderer::parametersToText(realPatch, false);
+		}
+	}
+	std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return (char) std::tolower(c); });
+	return text;
+}
+
+void PatchTextIndex::add(midikraft::PatchHolder const &patch, bool withParameterText)
+{
+	auto found = entryByMd5_.find(patch.md5());
+	if (found != entryByMd5_.end()) {
+		// Postings are append only, the old entry is just skipped from now on
+		entries_[found->second].removed = true;
+	}
+	uint32 index = (uint32) entries_.size();
+	entries_.push_back({ store_.intern(patch), indexText(patch, withParameterText), false });
+	entryByMd5_[patch.md5()] = index;
+
+	std::set<uint32> seen;
+	for (auto const &word : words(entries_.back().text)) {
+		for (auto trigram : trigrams(word)) {
+			if (seen.insert(trigram).second) {
+				postings_[trigram].push_back(index);
+			}
+		}
+	}
+}
+
+void PatchTextIndex::add(std::vector<midikraft::PatchHolder> const &patches, bool withParameterText)
+{
+	entries_.reserve(entries_.size() + patches.size());
+	for (auto const &patch : patches) {
+		add(patch, withParameterText);
+	}
+}
+
+void PatchTextIndex::remove(std::string const &md5)
+{
+	auto found = entryByMd5_.find(md5);
+	if (found != entryByMd5_.end()) {
+		entries_[found->second].removed = true;
+		entryByMd5_.erase(found);
+	}
+}
+
+std::vector<std::string> PatchTextIndex::words(std::string const &text)
+{
+	std::vector<std::string> result;
+	std::string current;
+	for (char c : text) {
+		if (std::isalnum((unsigned char) c)) {
+			current.push_back((char) std::tolower((unsigned char) c));
+		}
+		else if (!current.empty()) {
+			result.push_back(current);
+			current.clear();
+		}
+	}
+	if (!current.empty()) {
+		result.push_back(current);
+	}
+	return result;
+}
+
+std::vector<uint32> PatchTextIndex::trigrams(std::string const &word)
+{
+	std::vector<uint32> result;
+	for (size_t i = 0; i + 3 <= word.size(); i++) {
+		result.push_back(((uint32) (uint8) word[i] << 16) | ((uint32) (uint8) word[i + 1] << 8) | (uint32) (uint8) word[i + 2]);
+	}
+	std::sort(result.begin(), result.end());
+	result.erase(std::unique(result.begin(), result.end()), result.end());
+	return result;
+}
+
+bool PatchTextIndex::hasWordWithPrefix(std::string const &text, std::string const &prefix)
+{
+	size_t pos = text.find(prefix);
+	while (pos != std::string::npos) {
+		if (pos == 0 || !std::isalnum((unsigned char) text[pos - 1])) {
+			return true;
+		}
+		pos = text.find(prefix, pos + 1);
+	}
+	return false;
+}
+
+std::vector<midikraft::PatchHolder> PatchTextIndex::search(std::string const &query) const
+{
+	auto queryWords = words(query);
+	if (queryWords.empty()) {
+		return {};
+	}
+
+	std::map<uint32, int> score;
+	bool first = true;
+	for (auto const &word : queryWords) {
+		std::map<uint32, int> wordScore;
+		auto wordTrigrams = trigrams(word);
+		if (!wordTrigrams.empty()) {
+			// Fuzzy, most of the trigrams need to be there
+			for (auto trigram : wordTrigrams) {
+				auto posting = postings_.find(trigram);
+				if (posting != postings_.end()) {
+					for (auto index : posting->second) {
+						wordScore[index]++;
+					}
+				}
+			}
+			int needed = std::max(1, (int) (wordTrigrams.size() * 2 + 2) / 3);
+			for (auto it = wordScore.begin(); it != wordScore.end();) {
+				it = it->second < needed ? wordScore.erase(it) : std::next(it);
+			}
+		}
+		else {
+			// Too short for trigrams, check the candidates we have or everything
+			if (first) {
+				for (uint32 index = 0; index < (uint32) entries_.size(); index++) {
+					wordScore[index] = 0;
+				}
+			}
+			else {
+				wordScore = score;
+			}
+			for (auto it = wordScore.begin(); it != wordScore.end();) {
+				it = hasWordWithPrefix(entries_[it->first].text, word) ? std::next(it) : wordScore.erase(it);
+			}
+		}
+		for (auto &candidate : wordScore) {
+			// Real prefix matches rank before fuzzy ones
+			if (hasWordWithPrefix(entries_[candidate.first].text, word)) {
+				candidate.second += 3;
+			}
+		}
+
+		// All words must match
+		if (first) {
+			score = wordScore;
+			first = false;
+		}
+		else {
+			std::map<uint32, int> remaining;
+			for (auto const &candidate : wordScore) {
+				auto existing = score.find(candidate.first);
+				if (existing != score.end()) {
+					remaining[candidate.first] = existing->second + candidate.second;
+				}
+			}
+			score = remaining;
+		}
+	}
+
+	std::vector<std::pair<uint32, int>> ranked;
+	for (auto const &candidate : score) {
+		if (!entries_[candidate.first].removed) {
+			ranked.emplace_back(candidate.first, candidate.second);
+		}
+	}
+	std::stable_sort(ranked.begin(), ranked.end(), [](std::pair<uint32, int> const &a, std::pair<uint32, int> const &b) { return a.second > b.second; });
+	std::vector<midikraft::PatchHolder> result;
+	result.reserve(ranked.size());
+	for (auto const &match : ranked) {
+		result.push_back(store_.patch(entries_[match.first].patch));
+	}
+	return result;
+}
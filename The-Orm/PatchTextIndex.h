@@ -0,0 +1,55 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include "PatchHolder.h"
+#include "PatchHandleStore.h"
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// In memory trigram index over the patch name, the import name, the categories and optionally the parameter text of patches.
+// Every word of a query needs to match, either as prefix of a word in the text or, for words of 3 characters or more,
+// fuzzy by sharing most of its trigrams. This allows searches like "osc1 saw" or slightly misspelled names.
+class PatchTextIndex {
+public:
+	// The patches are kept in the store, the index only holds their handles
+	explicit PatchTextIndex(PatchHandleStore &store);
+
+	void clear();
+	bool isEmpty() const;
+
+	// Adding a patch that is already in the index replaces its entry
+	void add(midikraft::PatchHolder const &patch, bool withParameterText);
+	void add(std::vector<midikraft::PatchHolder> const &patches, bool withParameterText);
+	// Deleted patches are no longer found, unknown md5s are ignored
+	void remove(std::string const &md5);
+
+	// Best matches first, patches with the same score in the order they were added
+	std::vector<midikraft::PatchHolder> search(std::string const &query) const;
+
+	static std::string indexText(midikraft::PatchHolder const &patch, bool withParameterText);
+
+private:
+	struct Entry {
+		PatchHandleStore::Handle patch;
+		std::string text;
+		bool removed;
+	};
+
+	static std::vector<std::string> words(std::string const &text);
+	static std::vector<uint32> trigrams(std::string const &word);
+	static bool hasWordWithPrefix(std::string const &text, std::string const &prefix);
+
+	PatchHandleStore &store_;
+	std::vector<Entry> entries_;
+	std::unordered_map<std::string, size_t> entryByMd5_;
+	std::unordered_map<uint32, std::vector<uint32>> postings_; // Trigram to entry indexes, ascending
+};
@@ -0,0 +1,118 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "PatchTextRenderer.h"
+
+#include "Capability.h"
+#include "DetailedParametersCapability.h"
+#include "LayeredPatchCapability.h"
+
+#include <algorithm>
+#include <iterator>
+
+std::string PatchTextRenderer::parametersToText(std::shared_ptr<midikraft::Patch> patch, bool onlyActive)
+{
+	fmt::memory_buffer buffer;
+	appendParameters(buffer, patch, onlyActive);
+	return fmt::to_string(buffer);
+}
+
+void PatchTextRenderer::appendParameters(fmt::memory_buffer &buffer, std::shared_ptr<midikraft::Patch> patch, bool onlyActive)
+{
+	auto parameterDetails = midikraft::Capability::hasCapability<midikraft::DetailedParametersCapability>(patch);
+	if (!parameterDetails) {
+		return;
+	}
+
+	int numLayers = 1;
+	auto layers = midikraft::Capability::hasCapability<midikraft::LayeredPatchCapability>(patch);
+	if (layers) {
+		numLayers = layers->numberOfLayers();
+	}
+
+	// Look up the capabilities of each parameter definition once, not once per layer
+	struct ResolvedParameter {
+		std::shared_ptr<midikraft::SynthParameterDefinition> param;
+		std::shared_ptr<midikraft::SynthMultiLayerParameterCapability> multiLayer;
+		std::shared_ptr<midikraft::SynthParameterActiveDetectionCapability> activeCheck;
+	};
+	std::vector<ResolvedParameter> parameters;
+	for (auto param : parameterDetails->allParameterDefinitions()) {
+		parameters.push_back({ param
+			, layers ? midikraft::Capability::hasCapability<midikraft::SynthMultiLayerParameterCapability>(param) : nullptr
+			, midikraft::Capability::hasCapability<midikraft::SynthParameterActiveDetectionCapability>(param) });
+	}
+	buffer.reserve(buffer.size() + parameters.size() * (size_t) numLayers * 32);
+
+	auto out = std::back_inserter(buffer);
+	for (int layer = 0; layer < numLayers; layer++) {
+		if (layers) {
+			if (layer > 0) fmt::format_to(out, "\n");
+			fmt::format_to(out, "Layer: {}\n", layers->layerName(layer));
+		}
+		for (auto const &resolved : parameters) {
+			if (layers) {
+				jassert(resolved.multiLayer);
+				if (resolved.multiLayer) {
+					resolved.multiLayer->setSourceLayer(layer);
+				}
+			}
+			if (!onlyActive || !resolved.activeCheck || !(resolved.activeCheck->isActive(patch.get()))) {
+				fmt::format_to(out, "{}: {}\n", resolved.param->description(), resolved.param->valueInPatchToText(*patch));
+			}
+		}
+	}
+}
+
+std::string PatchTextRenderer::hexDump(std::vector<uint8> const &data)
+{
+	static const char kHexDigits[] = "0123456789abcdef";
+	std::string result;
+	// "aaaa " plus three characters per byte, the last one of the line is a newline instead of a space
+	result.reserve((data.size() / 8 + 1) * 5 + data.size() * 3);
+	size_t consumed = 0;
+	while (consumed < data.size()) {
+		result += kHexDigits[(consumed >> 12) & 0x0f];
+		result += kHexDigits[(consumed >> 8) & 0x0f];
+		result += kHexDigits[(consumed >> 4) & 0x0f];
+		result += kHexDigits[consumed & 0x0f];
+		result += ' ';
+		size_t lineLength = std::min((size_t) 8, data.size() - consumed);
+		for (size_t i = 0; i < lineLength; i++) {
+			if (i > 0) result += ' ';
+			result += kHexDigits[data[consumed + i] >> 4];
+			result += kHexDigits[data[consumed + i] & 0x0f];
+		}
+		result += '\n';
+		consumed += lineLength;
+	}
+	return result;
+}
+
+void PatchTextRenderer::updateDocument(CodeDocument &document, String const &text)
+{
+	String old = document.getAllContent();
+	auto a = old.toUTF32();
+	auto b = text.toUTF32();
+	int lengthA = old.length();
+	int lengthB = text.length();
+	int shorter = std::min(lengthA, lengthB);
+
+	// Common lines at the start
+	int prefix = 0;
+	while (prefix < shorter && a[prefix] == b[prefix]) prefix++;
+	if (prefix == lengthA && lengthA == lengthB) {
+		return;
+	}
+	while (prefix > 0 && a[prefix - 1] != '\n') prefix--;
+
+	// Common lines at the end, not overlapping the start
+	int suffix = 0;
+	while (suffix < shorter - prefix && a[lengthA - 1 - suffix] == b[lengthB - 1 - suffix]) suffix++;
+	while (suffix > 0 && suffix < lengthA && a[lengthA - 1 - suffix] != '\n') suffix--;
+
+	document.replaceSection(prefix, lengthA - suffix, text.substring(prefix, lengthB - suffix));
+}
@@ -0,0 +1,29 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include "Patch.h"
+
+#include <fmt/format.h>
+
+// Text renderings of patches, shared by the patch text box, the diff dialog and the search index
+class PatchTextRenderer {
+public:
+	// One line "description: value" per parameter, and per layer for layered patches
+	static std::string parametersToText(std::shared_ptr<midikraft::Patch> patch, bool onlyActive);
+	// Same, appending to a buffer that can be reused for many patches
+	static void appendParameters(fmt::memory_buffer &buffer, std::shared_ptr<midikraft::Patch> patch, bool onlyActive);
+
+	// Four hex digits of address, then up to 8 bytes per line
+	static std::string hexDump(std::vector<uint8> const &data);
+
+	// Brings the document to the new text by replacing only the block of lines that differ, so the editor showing it keeps
+	// the layout and the tokens of the rest. Moving between patches of the same synth mostly changes a few lines
+	static void updateDocument(CodeDocument &document, String const &text);
+};
@@ -14,6 +14,21 @@
 #include "ImportFromSynthDialog.h"
 #include "AutomaticCategory.h"
 #include "PatchDiff.h"
+#include "NearDuplicateFinder.h"
+#include "ParallelFor.h"
+#include "PatchMergePreparation.h"
+#include "BackgroundMergeQueue.h"
+#include "MetadataWriteQueue.h"
+#include "DatabaseMaintenance.h"
+#include "DatabaseVerifier.h"
+#include "BackupJournal.h"
+#include "BankDownloadScheduler.h"
+#include "RomBankCache.h"
+#include "DatabaseBackup.h"
+#include "SysexFileStream.h"
+#include "Metrics.h"
+#include "Tracer.h"
+#include "TransferStrategy.h"
 #include "LayeredPatchCapability.h"
 #include "LayerCapability.h"
 #include "Logger.h"
@@ -21,7 +36,7 @@
 #include "AutoDetection.h"
 #include "DataFileLoadCapability.h"
 #include "StoredPatchNameCapability.h"
-#include "ScriptedQuery.h"
+#include "ProgramDumpCapability.h"
 #include "LibrarianProgressWindow.h"
 
 #include "GenericAdaptation.h" //TODO For the Python runtime. That should probably go to its own place, as Python now is used for more than the GenericAdaptation
@@ -29,10 +44,17 @@
 #include "I18NHelper.h"
 
 #include <fmt/format.h>
+#include <atomic>
+#include <deque>
+#include <set>
 #include "PatchInterchangeFormat.h"
+#include "PatchInterchangeReader.h"
+#include "PatchInterchangeWriter.h"
 #include "Settings.h"
 #include "ReceiveManualDumpWindow.h"
 #include "ExportDialog.h"
+#include "SysexExportJob.h"
+#include "Setlist.h"
 #include "BulkRenameDialog.h"
 #include "SynthBank.h"
 
@@ -47,9 +69,37 @@ PatchView::PatchView(midikraft::PatchDatabase &database, std::vector<midikraft::
          patchListTree_(database, synths)
         , rightSideTab_(juce::TabbedButtonBar::TabsAtTop)
         , librarian_(synths)
+        , scriptedSearch_([this](int skip, int limit, ScriptedSearch::TPageCallback callback) {
+			auto reader = readers_.reader();
+			reader->getPatchesAsync(currentFilter(), [callback, reader](midikraft::PatchFilter const filter, std::vector<midikraft::PatchHolder> const &newPatches) {
+				ignoreUnused(filter, reader); // The connection must live until the result has arrived
+				callback(newPatches);
+			}, skip, limit);
+		})
+        , textIndex_(patchStore_)
+        , textIndexValid_(false)
+        , textIndexGeneration_(0)
+        , similarityIndex_(patchStore_)
         , synths_(synths)
+        , filterGeneration_(0)
         , database_(database)
+        , readers_(database)
+        , databaseVersion_(database)
+        , counts_(databaseVersion_)
 {
+	mergeQueue_ = std::make_unique<BackgroundMergeQueue>(database_);
+	metadataQueue_ = std::make_unique<MetadataWriteQueue>(database_, [safeThis = Component::SafePointer<PatchView>(this)]() {
+		// Favorite, hidden and the categories are all part of the filter, the patches edited might not belong in the grid anymore
+		if (safeThis) {
+			safeThis->refreshAfterMetadataWrite();
+		}
+	}, [](std::vector<midikraft::PatchHolder> const &failed) {
+		AlertWindow::showMessageBoxAsync(AlertWindow::WarningIcon, "Changes not stored",
+			fmt::format("The changes of {} patches, starting with {}, could not be stored in the database. Please check the log for details.", failed.size(), failed.front().name()));
+	});
+	verifier_ = std::make_unique<DatabaseVerifier>(database_, synths_);
+	maintenance_ = std::make_unique<DatabaseMaintenance>(database_);
+
 	patchListTree_.onSynthBankSelected = [this](std::shared_ptr<midikraft::Synth> synth, MidiBankNumber bank) {
 		setSynthBankFilter(synth, bank);
 		showBank();
@@ -78,11 +128,18 @@ PatchView::PatchView(midikraft::PatchDatabase &database, std::vector<midikraft::
 			selectPatch(patch, true);
 		}
 	});
+	patchButtons_->onMarkedPatchesMenu = [this](std::vector<midikraft::PatchHolder> const &marked) {
+		showMarkedPatchesMenu(marked);
+	};
+	patchButtons_->onPatchesShown = [this](std::vector<midikraft::PatchHolder> const &patches) {
+		// Auditioning by clicking through the grid then finds every patch converted
+		outgoingSysex_.warm(patches);
+	};
 
 	currentPatchDisplay_ = std::make_unique<CurrentPatchDisplay>(database_, predefinedCategories(),
 		[this](std::shared_ptr<midikraft::PatchHolder> favoritePatch) {
-		database_.putPatch(*favoritePatch);
-		patchButtons_->refresh(true);
+		metadataQueue_->put(*favoritePatch);
+		patchButtons_->patchChanged(*favoritePatch);
 	}
 	);
 	currentPatchDisplay_->onCurrentPatchClicked = [this](std::shared_ptr<midikraft::PatchHolder> patch) {
@@ -90,6 +147,16 @@ PatchView::PatchView(midikraft::PatchDatabase &database, std::vector<midikraft::
 			selectPatch(*patch, true);
 		}
 	};
+	currentPatchDisplay_->onShowSimilar = [this](std::shared_ptr<midikraft::PatchHolder> patch) {
+		if (patch) {
+			showSimilarPatches(*patch);
+		}
+	};
+	currentPatchDisplay_->onShowSoundsLike = [this](std::shared_ptr<midikraft::PatchHolder> patch) {
+		if (patch) {
+			showPatchesSoundingLike(*patch);
+		}
+	};
 
 	synthBank_ = std::make_unique<SynthBankPanel>(database_, this);
 
@@ -138,16 +205,22 @@ PatchView::PatchView(midikraft::PatchDatabase &database, std::vector<midikraft::
 	addAndMakeVisible(recycleBin_);
 
 	patchButtons_->setPatchLoader([this](int skip, int limit, std::function<void(std::vector< midikraft::PatchHolder>)> callback) {
-		loadPage(skip, limit, currentFilter(), callback);
+		loadCurrentPage(skip, limit, callback);
 	});
 
 	// Register for updates
 	UIModel::instance()->currentPatch_.addChangeListener(this);
+	UIModel::instance()->adaptationReloads_.addChangeListener(this);
+	UIModel::instance()->databaseChanged.addChangeListener(this);
 }
 
 PatchView::~PatchView()
 {
+	mergeQueue_.reset();
+	metadataQueue_.reset();
 	UIModel::instance()->currentPatch_.removeChangeListener(this);
+	UIModel::instance()->adaptationReloads_.removeChangeListener(this);
+	UIModel::instance()->databaseChanged.removeChangeListener(this);
 	BulkRenameDialog::release();
 }
 
@@ -160,6 +233,32 @@ void PatchView::changeListenerCallback(ChangeBroadcaster* source)
 	if (dynamic_cast<CurrentPatch *>(source)) {
 		currentPatchDisplay_->setCurrentPatch(std::make_shared<midikraft::PatchHolder>(UIModel::currentPatch()));
 	}
+	else if (source == &UIModel::instance()->adaptationReloads_) {
+		// The new code might convert differently
+		for (auto const &synthName : UIModel::instance()->adaptationReloads_.takeReloadedSynths()) {
+			outgoingSysex_.forgetSynth(synthName);
+		}
+		preparedNext_.reset();
+		preparedPrevious_.reset();
+		schedulePrepareNeighbours();
+		patchButtons_->refresh(false);
+	}
+	else if (source == &UIModel::instance()->databaseChanged) {
+		// None of the patches held belong to the new database
+		similarityQueryActive_ = false;
+		similarPatches_.clear();
+		textIndexGeneration_++;
+		textIndexValid_ = false;
+		releaseIndexes();
+	}
+}
+
+void PatchView::releaseIndexes()
+{
+	textIndex_.clear();
+	similarityIndex_.clear();
+	// Nobody holds a handle anymore
+	patchStore_.clear();
 }
 
 std::vector<CategoryButtons::Category> PatchView::predefinedCategories()
@@ -174,14 +273,172 @@ std::vector<CategoryButtons::Category> PatchView::predefinedCategories()
 }
 
 int PatchView::getTotalCount() {
-	return database_.getPatchesCount(currentFilter());
+	if (similarityQueryActive_) {
+		return (int) similarPatches_.size();
+	}
+	if (isScriptedQueryActive() && scriptedSearch_.isComplete()) {
+		return scriptedSearch_.matchesFound();
+	}
+	if (isTextIndexQueryActive() && textIndexValid_) {
+		return (int) textIndex_.search(patchSearch_->advancedTextSearch().substring(1).toStdString()).size();
+	}
+	auto filter = currentFilter();
+	return counts_.count(filter, [this, &filter]() {
+		TraceScope trace("Count patches", "database");
+		static auto &countLatency = Metrics::instance().histogram("database.count");
+		MetricsTimer timing(countLatency);
+		return readers_.reader()->getPatchesCount(filter);
+	});
+}
+
+bool PatchView::isTextIndexQueryActive() {
+	// Tilde start searches words in name, import, categories and parameters, allowing typos
+	return patchSearch_->advancedTextSearch().startsWith("~");
+}
+
+void PatchView::loadFromTextIndex(int skip, int limit, std::function<void(std::vector<midikraft::PatchHolder>)> callback)
+{
+	auto query = patchSearch_->advancedTextSearch().substring(1).toStdString();
+	auto serve = [this, skip, limit, query, callback]() {
+		auto matches = textIndex_.search(query);
+		patchButtons_->updateTotalCount((int) matches.size());
+		std::vector<midikraft::PatchHolder> page;
+		for (size_t i = (size_t) std::max(0, skip); i < matches.size() && (limit < 0 || i < (size_t) (skip + limit)); i++) {
+			page.push_back(matches[i]);
+		}
+		callback(page);
+	};
+	if (textIndexValid_) {
+		serve();
+		return;
+	}
+	// Index everything the rest of the filter lets through, this is only redone when something else than the text changes
+	int generation = textIndexGeneration_;
+	loadPage(0, -1, currentFilter(), [this, generation, serve](std::vector<midikraft::PatchHolder> patches) {
+		if (generation != textIndexGeneration_) {
+			return;
+		}
+		if (!textIndexValid_) {
+			// Reloading the list starts a new store, else it would keep every patch any earlier filter let through
+			releaseIndexes();
+			textIndex_.add(patches, true);
+			textIndexValid_ = true;
+		}
+		serve();
+	});
+}
+
+bool PatchView::isScriptedQueryActive() {
+	// Bang start indicates python predicate to evaluate instead of just a name query!
+	return patchSearch_->advancedTextSearch().startsWith("!") && knobkraft::GenericAdaptation::hasPython();
+}
+
+void PatchView::showSimilarPatches(midikraft::PatchHolder const &patch)
+{
+	auto synth = patch.smartSynth();
+	if (!synth || !patch.patch()) {
+		return;
+	}
+	filterGeneration_++;
+	similarityQueryActive_ = true;
+	similarTo_ = patch;
+	similarPatches_.clear();
+	if (similarityIndex_.hasSynth(synth->getName())) {
+		showSimilarResult();
+		return;
+	}
+	// Index the whole library of that synth once
+	midikraft::PatchFilter filter({ synth });
+	filter.turnOnAll();
+	filter.importID = "";
+	filter.listID = "";
+	int generation = filterGeneration_;
+	loadPage(0, -1, filter, [this, generation](std::vector<midikraft::PatchHolder> patches) {
+		similarityIndex_.add(patches);
+		if (generation == filterGeneration_ && similarityQueryActive_) {
+			showSimilarResult();
+		}
+	});
+}
+
+void PatchView::showPatchesSoundingLike(midikraft::PatchHolder const &patch)
+{
+	if (!patch.patch()) {
+		return;
+	}
+	filterGeneration_++;
+	similarityQueryActive_ = true;
+	similarTo_ = patch;
+	similarPatches_.clear();
+	int generation = filterGeneration_;
+	soundIndex_.update([this, generation]() {
+		if (generation == filterGeneration_ && similarityQueryActive_) {
+			showSoundsLikeResult();
+		}
+	});
+}
+
+void PatchView::showSimilarResult()
+{
+	similarPatches_.clear();
+	for (auto const &match : similarityIndex_.nearest(similarTo_, kNumberOfSimilarPatches)) {
+		similarPatches_.push_back(match.first);
+	}
+	spdlog::info("Showing the {} patches closest to {}", similarPatches_.size(), similarTo_.name());
+	displaySimilarPatches();
+}
+
+void PatchView::showSoundsLikeResult()
+{
+	similarPatches_.clear();
+	if (!soundIndex_.hasFingerprint(similarTo_.md5())) {
+		spdlog::info("There is no prehear recording of {} to compare with, please record one first", similarTo_.name());
+	}
+	// The recordings are only known by md5, so ask every synth for the patch
+	for (auto const &match : soundIndex_.nearest(similarTo_.md5(), kNumberOfSimilarPatches)) {
+		for (auto synth : synths_) {
+			std::vector<midikraft::PatchHolder> found;
+			if (synth.synth() && database_.getSinglePatch(synth.synth(), match.first, found) && found.size() == 1) {
+				similarPatches_.push_back(found[0]);
+				break;
+			}
+		}
+	}
+	spdlog::info("Showing the {} patches sounding closest to {}", similarPatches_.size(), similarTo_.name());
+	displaySimilarPatches();
+}
+
+void PatchView::displaySimilarPatches()
+{
+	patchButtons_->setTotalCount((int) similarPatches_.size());
+	patchButtons_->refresh(true);
+	Data::instance().getEphemeral().setProperty(EPROPERTY_LIBRARY_PATCH_LIST, juce::Uuid().toString(), nullptr);
 }
 
-void PatchView::retrieveFirstPageFromDatabase() {
-	// First, we need to find out how many patches there are (for the paging control)
+void PatchView::retrieveFirstPageFromDatabase(bool onlyTextChanged) {
+	filterGeneration_++;
+	// Any new filter ends showing similar patches
+	similarityQueryActive_ = false;
+	if (!onlyTextChanged) {
+		textIndexGeneration_++;
+		textIndexValid_ = false;
+	}
+	bool scripted = isScriptedQueryActive();
+	if (scripted) {
+		// Cancels whatever the previous query still had in flight
+		scriptedSearch_.restart(patchSearch_->advancedTextSearch().substring(1).toStdString(), PageSnapshotCache::keyOf(currentFilter(), 0, -1), databaseVersion_.current());
+	}
+	// First, we need to find out how many patches there are (for the paging control). For a scripted query, this is the upper bound
 	int total = getTotalCount();
 	patchButtons_->setTotalCount(total);
 	patchButtons_->refresh(true); // This kicks of loading the first page
+	if (scripted) {
+		// Keep filtering in the background to get the real count
+		scriptedSearch_.countAll([this](int matches) {
+			patchButtons_->updateTotalCount(matches);
+			Data::instance().getEphemeral().setProperty(EPROPERTY_LIBRARY_PATCH_LIST, juce::Uuid().toString(), nullptr);
+		});
+	}
 	Data::instance().getEphemeral().setProperty(EPROPERTY_LIBRARY_PATCH_LIST, juce::Uuid().toString(), nullptr);
 }
 
@@ -211,18 +468,154 @@ void PatchView::favoriteCurrentPatch()
 
 void PatchView::selectPreviousPatch()
 {
-	patchButtons_->selectPrevious();
+	switchToNeighbour(-1);
 }
 
 void PatchView::selectNextPatch()
 {
-	patchButtons_->selectNext();
+	switchToNeighbour(1);
+}
+
+void PatchView::switchToNeighbour(int direction)
+{
+	auto &prepared = direction > 0 ? preparedNext_ : preparedPrevious_;
+	midikraft::PatchHolder neighbour;
+	bool sent = false;
+	if (prepared && UIModel::currentSynth() && patchButtons_->patchNextToActive(direction, neighbour) && neighbour.md5() == prepared->md5) {
+		// The sound changes first, the UI follows
+		prepared->synth->sendBlockOfMessagesToSynth(prepared->output, prepared->messages);
+		// Might have been a program change, the next delta has to start from a full dump
+		deltaSend_.forget(prepared->synth);
+		sentPreparedMd5_ = prepared->md5;
+		sent = true;
+	}
+	if (direction > 0) {
+		patchButtons_->selectNext();
+	}
+	else {
+		patchButtons_->selectPrevious();
+	}
+	if (sent && !sentPreparedMd5_.empty()) {
+		// The neighbour was on the next page, which selects without the handler. Still show what is playing now
+		sentPreparedMd5_.clear();
+		selectPatch(neighbour, false);
+	}
+}
+
+void PatchView::schedulePrepareNeighbours()
+{
+	// After the switch is done, so preparing never delays it
+	if (preparePending_) return;
+	preparePending_ = true;
+	Component::SafePointer<PatchView> safeThis(this);
+	MessageManager::callAsync([safeThis]() {
+		if (safeThis) {
+			safeThis->preparePending_ = false;
+			safeThis->prepareNeighbours();
+		}
+	});
+}
+
+void PatchView::prepareNeighbours()
+{
+	for (int direction : { 1, -1 }) {
+		auto &prepared = direction > 0 ? preparedNext_ : preparedPrevious_;
+		midikraft::PatchHolder neighbour;
+		if (!patchButtons_->patchNextToActive(direction, neighbour)) {
+			prepared.reset();
+			continue;
+		}
+		if (prepared && prepared->md5 == neighbour.md5()) {
+			continue;
+		}
+		auto next = std::make_unique<PreparedSwitch>();
+		if (prepareSwitch(neighbour, *next)) {
+			prepared = std::move(next);
+		}
+		else {
+			prepared.reset();
+		}
+	}
+}
+
+bool PatchView::prepareSwitch(midikraft::PatchHolder &patch, PreparedSwitch &outSwitch)
+{
+	// Same choice as selectPatch: a program change if the patch is known to be resident in the synth, else the edit buffer
+	if (!patch.patch() || !patch.smartSynth()) {
+		return false;
+	}
+	auto synth = patch.smartSynth();
+	auto midiLocation = midikraft::Capability::hasCapability<midikraft::MidiLocationCapability>(synth);
+	if (!midiLocation) {
+		return false;
+	}
+	outSwitch.md5 = patch.md5();
+	outSwitch.synth = synth;
+	outSwitch.output = midiLocation->midiOutput();
+	outSwitch.messages.clear();
+	auto program = MidiProgramNumber::fromZeroBase(0);
+	if (residentProgramChange(patch, outSwitch.messages, program)) {
+		return true;
+	}
+	// Only synths with an edit buffer can be prepared, everything else goes the regular way at the key press
+	outSwitch.messages = outgoingSysex_.editBufferMessages(patch);
+	return !outSwitch.messages.empty();
+}
+
+bool PatchView::residentProgramChange(midikraft::PatchHolder const &patch, std::vector<MidiMessage> &outMessages, MidiProgramNumber &outProgram)
+{
+	auto synth = patch.smartSynth();
+	auto midiLocation = midikraft::Capability::hasCapability<midikraft::MidiLocationCapability>(synth);
+	if (!programChangeAudition() || !patch.patch() || !midiLocation || !midiLocation->channel().isValid()) {
+		return false;
+	}
+	for (auto const &inSynth : database_.getBankPositions(synth, patch.md5())) {
+		auto bankNumberToSelect = inSynth.isBankKnown() ? inSynth.bank() : patch.bankNumber();
+		// A comparison with the synth might have found the slot overwritten since the bank was stored
+		if (bankNumberToSelect.isValid()) {
+			auto differences = synthDifferences_.find(midikraft::ActiveSynthBank::makeId(synth, bankNumberToSelect));
+			if (differences != synthDifferences_.end() && differences->second.count(inSynth.toZeroBasedDiscardingBank()) > 0) {
+				continue;
+			}
+		}
+		outMessages.clear();
+		if (auto bankDescriptors = midikraft::Capability::hasCapability<midikraft::HasBankDescriptorsCapability>(synth)) {
+			outMessages = bankDescriptors->bankSelectMessages(bankNumberToSelect);
+		}
+		else if (auto banks = midikraft::Capability::hasCapability<midikraft::HasBanksCapability>(synth)) {
+			outMessages = banks->bankSelectMessages(bankNumberToSelect);
+		}
+		outMessages.push_back(MidiMessage::programChange(midiLocation->channel().toOneBasedInt(), inSynth.toZeroBasedDiscardingBank()));
+		outProgram = inSynth;
+		return true;
+	}
+	return false;
+}
+
+bool PatchView::programChangeAudition()
+{
+	return Settings::instance().get("ProgramChangeAudition", "1") == "1";
+}
+
+void PatchView::setProgramChangeAudition(bool enabled)
+{
+	Settings::instance().set("ProgramChangeAudition", enabled ? "1" : "0");
 }
 
 void PatchView::loadPage(int skip, int limit, midikraft::PatchFilter const& filter, std::function<void(std::vector<midikraft::PatchHolder>)> callback) {
 	// Kick off loading from the database (could be Internet?)
-	database_.getPatchesAsync(filter, [this, callback](midikraft::PatchFilter const filter, std::vector<midikraft::PatchHolder> const &newPatches) {
-        ignoreUnused(filter);
+	auto requested = Tracer::nowMicros();
+	auto reader = readers_.reader();
+	reader->getPatchesAsync(filter, [this, callback, requested, reader](midikraft::PatchFilter const filter, std::vector<midikraft::PatchHolder> const &newPatches) {
+        ignoreUnused(filter, reader); // The connection must live until the result has arrived
+		// From the request until the result arrived, including the wait for the database thread
+		static auto &pageLatency = Metrics::instance().histogram("database.load_page");
+		static auto &patchesLoaded = Metrics::instance().counter("patches.loaded");
+		pageLatency.record(Tracer::nowMicros() - requested);
+		patchesLoaded.add(newPatches.size());
+		if (Tracer::enabled()) {
+			Tracer::instance().complete("Load page", "database", requested, Tracer::nowMicros() - requested);
+		}
 		// Discard the result when there is a newer filter - another thread will be working on a better result!
 		/*if (currentFilter() != filter)
 			return;*/
@@ -231,9 +624,8 @@ void PatchView::loadPage(int skip, int limit, midikraft::PatchFilter const& filt
 		String advancedQuery = patchSearch_->advancedTextSearch();
 		if (advancedQuery.startsWith("!") && knobkraft::GenericAdaptation::hasPython()) {
 			// Bang start indicates python predicate to evaluate instead of just a name query!
-			ScriptedQuery query;
 			// Drop the first character (!)
-			auto filteredPatches = query.filterByPredicate(advancedQuery.substring(1).toStdString(), newPatches);
+			auto filteredPatches = scriptedQuery_.filterByPredicate(advancedQuery.substring(1).toStdString(), newPatches);
 			callback(filteredPatches);
 		}
 		else {
@@ -242,6 +634,41 @@ void PatchView::loadPage(int skip, int limit, midikraft::PatchFilter const& filt
 	}, skip, limit);
 }
 
+void PatchView::loadCurrentPage(int skip, int limit, std::function<void(std::vector<midikraft::PatchHolder>)> callback)
+{
+	if (similarityQueryActive_) {
+		std::vector<midikraft::PatchHolder> page;
+		for (size_t i = (size_t) std::max(0, skip); i < similarPatches_.size() && (limit < 0 || i < (size_t) (skip + limit)); i++) {
+			page.push_back(similarPatches_[i]);
+		}
+		callback(page);
+	}
+	else if (isScriptedQueryActive()) {
+		scriptedSearch_.loadPage(skip, limit, callback);
+	}
+	else if (isTextIndexQueryActive()) {
+		loadFromTextIndex(skip, limit, callback);
+	}
+	else {
+		auto filter = currentFilter();
+		auto key = PageSnapshotCache::keyOf(filter, skip, limit);
+		auto stamp = databaseVersion_.current();
+		std::vector<midikraft::PatchHolder> snapshot;
+		if (pages_.find(key, stamp, snapshot)) {
+			callback(snapshot);
+			return;
+		}
+		// While typing, every keystroke starts new queries. Results of a query that was overtaken are dropped instead of being shown
+		int generation = filterGeneration_;
+		loadPage(skip, limit, filter, [this, generation, callback, key, stamp](std::vector<midikraft::PatchHolder> patches) {
+			pages_.store(key, stamp, patches);
+			if (generation == filterGeneration_) {
+				callback(patches);
+			}
+		});
+	}
+}
+
 void PatchView::resized()
 {
 	Rectangle<int> area(getLocalBounds());
@@ -287,80 +714,140 @@ void PatchView::showPatchDiffDialog() {
 
 void PatchView::saveCurrentPatchCategories() {
 	if (currentPatchDisplay_->getCurrentPatch()->patch()) {
-		database_.putPatch(*currentPatchDisplay_->getCurrentPatch());
-		patchButtons_->refresh(false);
+		metadataQueue_->put(*currentPatchDisplay_->getCurrentPatch());
+		patchButtons_->patchChanged(*currentPatchDisplay_->getCurrentPatch());
 	}
 }
 
-void PatchView::loadSynthBankFromDatabase(std::shared_ptr<midikraft::Synth> synth, MidiBankNumber bank, std::string const& bankId)
+void PatchView::refreshAfterMetadataWrite()
+{
+	if (similarityQueryActive_) {
+		// The similar patches are a fixed list, not a filter
+		return;
+	}
+	if (isScriptedQueryActive() || isTextIndexQueryActive()) {
+		// These keep their own results, start them over
+		retrieveFirstPageFromDatabase();
+		return;
+	}
+	// Stay on the page shown, but query it and the count again
+	patchButtons_->updateTotalCount(getTotalCount());
+	patchButtons_->invalidatePageCache();
+	patchButtons_->refresh(true);
+}
+
+void PatchView::flushMetadataEdits()
+{
+	metadataQueue_->flush();
+}
+
+void PatchView::showMarkedPatchesMenu(std::vector<midikraft::PatchHolder> const &marked)
 {
-	loadPage(0, -1, bankFilter(synth, bankId), [this, synth, bank, bankId](std::vector<midikraft::PatchHolder> patches) {
-		spdlog::info("Bank of {} patches retrieved from database", patches.size());
-
-		// We need to patch the patches' position, so they represent the bank loaded and not their original position on import whenever that was!
-		//TODO - this should possible go into the PatchDatabase code. But it is a load option?
-		int i = 0;
-		for (auto& patch : patches) {
-			patch.setBank(bank);
-			patch.setPatchNumber(MidiProgramNumber::fromZeroBaseWithBank(bank, i++));
-		}
-
-		// Load the bank info from the database as well for the timestamp
-		std::map<std::string, std::weak_ptr<midikraft::Synth>> synths;
-		synths[synth->getName()] = synth;
-		midikraft::ListInfo info;
-		info.id = bankId; 
-		info.name = ""; // Don't care for the name
-		auto fullInfo = database_.getPatchList(info, synths);
-		if (fullInfo) {
-			auto bankList = std::dynamic_pointer_cast<midikraft::SynthBank>(fullInfo);
-			if (bankList) {
-				synthBank_->setBank(bankList, PatchButtonInfo::DefaultDisplay);
-			} 
+	enum { kFavorite = 1, kUnfavorite, kHide, kUnhide, kAddCategory = 100, kRemoveCategory = 200 };
+	auto categories = database_.getCategories();
+	PopupMenu addCategory, removeCategory;
+	for (size_t i = 0; i < categories.size(); i++) {
+		if (categories[i].def()->isActive) {
+			addCategory.addItem(kAddCategory + (int) i, categories[i].category());
+			removeCategory.addItem(kRemoveCategory + (int) i, categories[i].category());
 		}
-		else {
-			spdlog::error("Program Error: Invalid synth bank, not stored in database. Can't load into panel");
-			return;
+	}
+	PopupMenu menu;
+	menu.addSectionHeader(fmt::format("{} marked patches", marked.size()));
+	menu.addItem(kFavorite, "Favorite");
+	menu.addItem(kUnfavorite, "Remove favorite");
+	menu.addItem(kHide, "Hide");
+	menu.addItem(kUnhide, "Unhide");
+	menu.addSeparator();
+	menu.addSubMenu("Add category", addCategory);
+	menu.addSubMenu("Remove category", removeCategory);
+	menu.showMenuAsync(PopupMenu::Options(), [this, marked, categories](int chosen) {
+		if (chosen == kFavorite || chosen == kUnfavorite) {
+			editPatches(marked, [chosen](midikraft::PatchHolder &patch) { patch.setFavorite(midikraft::Favorite(chosen == kFavorite)); });
+		}
+		else if (chosen == kHide || chosen == kUnhide) {
+			editPatches(marked, [chosen](midikraft::PatchHolder &patch) { patch.setHidden(chosen == kHide); });
+		}
+		else if (chosen >= kAddCategory && chosen < kAddCategory + (int) categories.size()) {
+			auto category = categories[(size_t) (chosen - kAddCategory)];
+			editPatches(marked, [category](midikraft::PatchHolder &patch) { patch.setCategory(category, true); patch.setUserDecision(category); });
+		}
+		else if (chosen >= kRemoveCategory && chosen < kRemoveCategory + (int) categories.size()) {
+			auto category = categories[(size_t) (chosen - kRemoveCategory)];
+			editPatches(marked, [category](midikraft::PatchHolder &patch) { patch.setCategory(category, false); patch.setUserDecision(category); });
 		}
 	});
 }
 
+void PatchView::editPatches(std::vector<midikraft::PatchHolder> patches, std::function<void(midikraft::PatchHolder &)> edit)
+{
+	for (auto &patch : patches) {
+		edit(patch);
+	}
+	// All edits go into the same background write, and the grid is updated once for all of them
+	metadataQueue_->put(patches);
+	patchButtons_->patchesChanged(patches);
+	auto current = currentPatchDisplay_->getCurrentPatch();
+	if (current && current->patch()) {
+		for (auto const &patch : patches) {
+			if (patch.md5() == current->md5()) {
+				currentPatchDisplay_->setCurrentPatch(std::make_shared<midikraft::PatchHolder>(patch));
+				break;
+			}
+		}
+	}
+	spdlog::info("Changed {} patches", patches.size());
+}
+
+void PatchView::loadSynthBankFromDatabase(std::shared_ptr<midikraft::Synth> synth, MidiBankNumber bank, std::string const& bankId)
+{
+	ignoreUnused(bank);
+	// One query for the bank info with the timestamp and all of its patches in position - loading the patches through
+	// the bank filter as well would read every patch of the bank twice
+	std::map<std::string, std::weak_ptr<midikraft::Synth>> synths;
+	synths[synth->getName()] = synth;
+	midikraft::ListInfo info;
+	info.id = bankId;
+	info.name = ""; // Don't care for the name
+	auto fullInfo = database_.getPatchList(info, synths);
+	if (fullInfo) {
+		auto bankList = std::dynamic_pointer_cast<midikraft::SynthBank>(fullInfo);
+		if (bankList) {
+			spdlog::info("Bank of {} patches retrieved from database", bankList->patches().size());
+			synthBank_->setBank(bankList, PatchButtonInfo::DefaultDisplay);
+		}
+	}
+	else {
+		spdlog::error("Program Error: Invalid synth bank, not stored in database. Can't load into panel");
+	}
+}
+
 void PatchView::retrieveBankFromSynth(std::shared_ptr<midikraft::Synth> synth, MidiBankNumber bank, std::function<void()> finishedHandler)
 {
+	if (fillRomBankFromCache(synth, bank, [this, finishedHandler, synth, bank]() {
+		loadSynthBankFromDatabase(synth, bank, midikraft::ActiveSynthBank::makeId(synth, bank));
+		if (finishedHandler) {
+			finishedHandler();
+		}
+	})) {
+		return;
+	}
+
 	auto device = std::dynamic_pointer_cast<midikraft::DiscoverableDevice>(synth);
 	auto location = midikraft::Capability::hasCapability<midikraft::MidiLocationCapability>(synth);
 	if (location) {
 		if (location->channel().isValid() && device->wasDetected()) {
 			// We can offer to download the bank from the synth, or rather just do it!
-			auto progressWindow = std::make_shared<LibrarianProgressWindow>(librarian_, "Import patches from Synth");
 			if (synth /*&& device->wasDetected()*/) {
 				midikraft::MidiController::instance()->enableMidiInput(location->midiInput());
-				progressWindow->launchThread();
-				progressWindow->setMessage(fmt::format("Importing {} from {}...", midikraft::SynthBank::friendlyBankName(synth, bank), synth->getName()));
-				librarian_.startDownloadingAllPatches(
-					midikraft::MidiController::instance()->getMidiOutput(location->midiOutput()),
-					synth,
-					bank,
-					progressWindow.get(), [this, progressWindow, finishedHandler, synth, bank](std::vector<midikraft::PatchHolder> patchesLoaded) {
-						progressWindow->signalThreadShouldExit();
-						MessageManager::callAsync([this, patchesLoaded, finishedHandler, synth, bank]() {
-							spdlog::info("Retrieved {} patches from synth", patchesLoaded.size());
-							// First make sure all patches are stored in the database
-							auto enhanced = autoCategorize(patchesLoaded);
-							mergeNewPatches(enhanced); //This is actually async!, should be reflected in the name. Maybe I should open a progress dialog here?
-							// Then store the list of them in the database
-							auto retrievedBank = std::make_shared<midikraft::ActiveSynthBank>(synth, bank, juce::Time::getCurrentTime());
-							retrievedBank->setPatches(patchesLoaded);
-							database_.putPatchList(retrievedBank);
-							// We need to mark something as "active in synth" together with position in the patch_in_list table, so we now when we can program change to the patch
-							// instead of sending the sysex
-							patchListTree_.refreshAllUserLists();
-							loadSynthBankFromDatabase(synth, bank, midikraft::ActiveSynthBank::makeId(synth, bank));
-							if (finishedHandler) {
-								finishedHandler();
-							}
-							});
+				downloadBanksPipelined(synth, { bank }, [this, finishedHandler, synth](MidiBankNumber bank, std::vector<midikraft::PatchHolder> patchesLoaded) {
+					storeRetrievedBank(synth, bank, patchesLoaded, [this, finishedHandler, synth, bank]() {
+						loadSynthBankFromDatabase(synth, bank, midikraft::ActiveSynthBank::makeId(synth, bank));
+						if (finishedHandler) {
+							finishedHandler();
+						}
 					});
+				});
 			}
 		}
 		else {
@@ -372,7 +859,200 @@ void PatchView::retrieveBankFromSynth(std::shared_ptr<midikraft::Synth> synth, M
 	}
 }
 
-void PatchView::sendBankToSynth(std::shared_ptr<midikraft::SynthBank> bankToSend, bool ignoreDirty, std::function<void()> finishedHandler)
+void PatchView::storeRetrievedBank(std::shared_ptr<midikraft::Synth> synth, MidiBankNumber bank, std::vector<midikraft::PatchHolder> const &patchesLoaded, std::function<void()> stored)
+{
+	spdlog::info("Retrieved {} patches from synth", patchesLoaded.size());
+	// First make sure all patches are stored in the database, the list of them can only be stored afterwards
+	Component::SafePointer<PatchView> safeThis(this);
+	mergeQueue_->add(patchesLoaded, [safeThis, patchesLoaded, stored, synth, bank](std::vector<midikraft::PatchHolder> outNewPatches) {
+		if (!safeThis) {
+			return;
+		}
+		auto self = safeThis.getComponent();
+		self->showMergedPatches(outNewPatches);
+		auto retrievedBank = std::make_shared<midikraft::ActiveSynthBank>(synth, bank, juce::Time::getCurrentTime());
+		retrievedBank->setPatches(patchesLoaded);
+		self->database_.putPatchList(retrievedBank);
+		RomBankCache::remember(synth, bank, patchesLoaded);
+		// The stored bank is now what the synth has
+		self->synthDifferences_.erase(retrievedBank->id());
+		// We need to mark something as "active in synth" together with position in the patch_in_list table, so we now when we can program change to the patch
+		// instead of sending the sysex
+		self->patchListTree_.refreshAllUserLists();
+		if (stored) {
+			stored();
+		}
+	});
+}
+
+bool PatchView::fillRomBankFromCache(std::shared_ptr<midikraft::Synth> synth, MidiBankNumber bank, std::function<void()> stored)
+{
+	if (!RomBankCache::isRomBank(synth, bank)) {
+		return false;
+	}
+	if (RomBankCache::storedListIsCurrent(synth, bank, retrieveListFromDatabase({ midikraft::ActiveSynthBank::makeId(synth, bank), "" }))) {
+		spdlog::info("{} is a ROM bank already downloaded, not requesting it again", midikraft::SynthBank::friendlyBankName(synth, bank));
+		if (stored) {
+			stored();
+		}
+		return true;
+	}
+	auto shipped = RomBankCache::shippedPatches(synth, bank, database_.getCategorizer());
+	if (!shipped.empty()) {
+		spdlog::info("Filling the ROM bank {} from the content shipped with the adaptation", midikraft::SynthBank::friendlyBankName(synth, bank));
+		storeRetrievedBank(synth, bank, shipped, stored);
+		return true;
+	}
+	return false;
+}
+
+void PatchView::retrieveAllBanksFromAllSynths()
+{
+	auto jobs = BankDownloadScheduler::allBanksOfDetectedSynths(synths_);
+	if (jobs.empty()) {
+		AlertWindow::showMessageBox(AlertWindow::InfoIcon, "No synth detected", "None of the active synths is detected and able to send its banks. Use the MIDI setup to make sure you have connectivity and a green bar!");
+		return;
+	}
+	// Banks already stored by an interrupted backup are not downloaded again
+	auto journal = std::make_shared<BackupJournal>();
+	auto alreadyStored = journal->banksStored(jobs);
+	if (alreadyStored > 0 && AlertWindow::showOkCancelBox(AlertWindow::QuestionIcon, "Continue interrupted backup?",
+		fmt::format("The backup started {} stored {} of {} banks before it was interrupted. Continue with the {} banks still missing, or start over?",
+			journal->startedAt(), alreadyStored, jobs.size(), jobs.size() - alreadyStored), "Continue", "Start over")) {
+		jobs = journal->continueWith(jobs);
+	}
+	else {
+		journal->start(jobs);
+	}
+	// ROM banks known already need no transfer
+	std::vector<BankDownloadScheduler::Job> toDownload;
+	for (auto const &job : jobs) {
+		auto synth = job.synth;
+		auto bank = job.bank;
+		if (!fillRomBankFromCache(synth, bank, [journal, synth, bank]() { journal->bankStored(synth, bank); })) {
+			toDownload.push_back(job);
+		}
+	}
+	jobs = toDownload;
+	if (jobs.empty()) {
+		spdlog::info("All banks were filled from cached ROM banks, nothing to download");
+		return;
+	}
+	BankDownloadScheduler scheduler(synths_, jobs, [this, journal](std::shared_ptr<midikraft::Synth> synth, MidiBankNumber bank, std::vector<midikraft::PatchHolder> patchesLoaded) {
+		storeRetrievedBank(synth, bank, patchesLoaded, [journal, synth, bank]() {
+			journal->bankStored(synth, bank);
+		});
+	});
+	scheduler.runThread();
+	if (scheduler.banksFailed() > 0) {
+		spdlog::warn("Downloaded {} banks, {} banks could not be retrieved", scheduler.banksLoaded(), scheduler.banksFailed());
+	}
+	else {
+		spdlog::info("Downloaded {} banks from all synths", scheduler.banksLoaded());
+	}
+}
+
+class DifferentialBankSend : public ThreadWithProgressWindow {
+public:
+	DifferentialBankSend(std::shared_ptr<midikraft::SynthBank> bank, std::vector<int> const &positions) :
+		ThreadWithProgressWindow("Sending changed programs to synth", true, true), bank_(bank), positions_(positions) {
+	}
+
+	void run() override {
+		auto synth = bank_->synth();
+		auto location = midikraft::Capability::hasCapability<midikraft::MidiLocationCapability>(synth);
+		auto programDump = midikraft::Capability::hasCapability<midikraft::ProgramDumpCabability>(synth);
+		auto patches = bank_->patches();
+		for (size_t i = 0; i < positions_.size(); i++) {
+			if (threadShouldExit()) {
+				return;
+			}
+			int position = positions_[i];
+			auto const &patch = patches[(size_t)position];
+			setStatusMessage(fmt::format("Sending {} to {}", patch.name(), synth->friendlyProgramName(MidiProgramNumber::fromZeroBaseWithBank(bank_->bankNumber(), position))));
+			auto messages = programDump->patchToProgramDumpSysex(patch.patch(), MidiProgramNumber::fromZeroBaseWithBank(bank_->bankNumber(), position));
+			synth->sendBlockOfMessagesToSynth(location->midiOutput(), messages);
+			setProgress((i + 1) / (double)positions_.size());
+		}
+		completed_ = true;
+	}
+
+	bool completed() const { return completed_; }
+
+private:
+	std::shared_ptr<midikraft::SynthBank> bank_;
+	std::vector<int> positions_;
+	bool completed_ = false;
+};
+
+bool PatchView::sendChangedProgramsOnly(std::shared_ptr<midikraft::SynthBank> bankToSend, bool dirtyFlagsMatchSynth, std::function<void()> finishedHandler)
+{
+	auto synth = bankToSend->synth();
+	if (!midikraft::Capability::hasCapability<midikraft::ProgramDumpCabability>(synth)) {
+		// Only a full bank dump is possible
+		return false;
+	}
+
+	// Compare against what we last retrieved from or sent to the synth, and what a comparison found changed in the synth since
+	auto bankId = midikraft::ActiveSynthBank::makeId(synth, bankToSend->bankNumber());
+	auto lastKnown = retrieveListFromDatabase({ bankId, "" });
+	auto inSynth = differencesFromSynth(bankToSend);
+	auto patches = bankToSend->patches();
+	std::vector<int> changed;
+	for (int i = 0; i < (int)patches.size(); i++) {
+		bool dirty = dirtyFlagsMatchSynth && bankToSend->isPositionDirty(i);
+		bool differs;
+		if (inSynth.count(i) > 0) {
+			differs = true;
+		}
+		else if (lastKnown && i < (int)lastKnown->patches().size()) {
+			differs = lastKnown->patches()[(size_t)i].md5() != patches[(size_t)i].md5() || dirty;
+		}
+		else {
+			// Nothing stored for this position, send it unless the dirty flags say it is unchanged in the synth
+			differs = !dirtyFlagsMatchSynth || dirty;
+		}
+		if (differs) {
+			changed.push_back(i);
+		}
+	}
+
+	if (!changed.empty()) {
+		if (TransferStrategy::chooseBankUpload(synth, changed.size(), patches.size()) == TransferStrategy::BankUpload::WholeBank) {
+			spdlog::info("Sending the whole bank, {} of {} programs differ from the last known state of the synth", changed.size(), patches.size());
+			return false;
+		}
+		spdlog::info("Sending {} of {} programs that differ from the last known state of the synth", changed.size(), patches.size());
+		DifferentialBankSend sender(bankToSend, changed);
+		auto started = Time::getMillisecondCounterHiRes();
+		sender.runThread();
+		if (sender.completed()) {
+			TransferStrategy::recordUpload(synth, TransferStrategy::BankUpload::ChangedPrograms, changed.size(), (Time::getMillisecondCounterHiRes() - started) / 1000.0);
+		}
+		else {
+			AlertWindow::showMessageBox(juce::AlertWindow::AlertIconType::WarningIcon, "Incomplete bank update", "The bank update did not finish, you might or not have a partial bank transferred!");
+			return true;
+		}
+	}
+	else {
+		spdlog::info("All programs of the bank are already in the synth, nothing to send");
+	}
+	synthDifferences_.erase(bankId);
+
+	if (!std::dynamic_pointer_cast<midikraft::ActiveSynthBank>(bankToSend)) {
+		// A user bank was sent, remember what the synth contains now
+		auto synced = std::make_shared<midikraft::ActiveSynthBank>(synth, bankToSend->bankNumber(), juce::Time::getCurrentTime());
+		synced->setPatches(patches);
+		database_.putPatchList(synced);
+	}
+	bankToSend->clearDirty();
+	if (finishedHandler) {
+		finishedHandler();
+	}
+	return true;
+}
+
+void PatchView::sendBankToSynth(std::shared_ptr<midikraft::SynthBank> bankToSend, bool dirtyFlagsMatchSynth, std::function<void()> finishedHandler)
 {
 	if (!bankToSend) return;
 
@@ -380,14 +1060,20 @@ void PatchView::sendBankToSynth(std::shared_ptr<midikraft::SynthBank> bankToSend
 	auto location = midikraft::Capability::hasCapability<midikraft::MidiLocationCapability>(bankToSend->synth());
 	if (location) {
 		if (location->channel().isValid() && device->wasDetected()) {
+			if (sendChangedProgramsOnly(bankToSend, dirtyFlagsMatchSynth, finishedHandler)) {
+				return;
+			}
 			auto progressWindow = std::make_shared<LibrarianProgressWindow>(librarian_, "Sending bank to Synth");
 			progressWindow->setMessage("Starting send");
 			if (bankToSend->synth() /*&& device->wasDetected()*/) {
 				midikraft::MidiController::instance()->enableMidiInput(location->midiInput());
 				progressWindow->launchThread();
-				librarian_.sendBankToSynth(*bankToSend, ignoreDirty, progressWindow.get(), [bankToSend, finishedHandler, progressWindow](bool completed) {
+				auto started = Time::getMillisecondCounterHiRes();
+				librarian_.sendBankToSynth(*bankToSend, !dirtyFlagsMatchSynth, progressWindow.get(), [this, bankToSend, finishedHandler, progressWindow, started](bool completed) {
 					progressWindow->signalThreadShouldExit();
 					if (completed) {
+						TransferStrategy::recordUpload(bankToSend->synth(), TransferStrategy::BankUpload::WholeBank, bankToSend->patches().size(), (Time::getMillisecondCounterHiRes() - started) / 1000.0);
+						synthDifferences_.erase(midikraft::ActiveSynthBank::makeId(bankToSend->synth(), bankToSend->bankNumber()));
 						bankToSend->clearDirty();
 						if (finishedHandler) {
 							finishedHandler();
@@ -408,18 +1094,66 @@ void PatchView::sendBankToSynth(std::shared_ptr<midikraft::SynthBank> bankToSend
 	}
 }
 
-void PatchView::setSynthBankFilter(std::shared_ptr<midikraft::Synth> synth, MidiBankNumber bank) {
-	auto bankId = midikraft::ActiveSynthBank::makeId(synth, bank);
-	// Check if this synth bank has ever been loaded
-	std::map<std::string, std::weak_ptr<midikraft::Synth>> synths;
-	synths[synth->getName()] = synth;
-	if (database_.doesListExist(bankId)) {
-		// It does, so we can safely load and display it
-		loadSynthBankFromDatabase(synth, bank, bankId);
-	}
-	else {
-		// No, first time ever - offer the user to download from the synth if connected
-		retrieveBankFromSynth(synth, bank, [this, synth]() {
+void PatchView::compareBankWithSynth(std::shared_ptr<midikraft::SynthBank> bank, std::function<void()> compared)
+{
+	if (!bank) return;
+
+	auto synth = bank->synth();
+	auto device = std::dynamic_pointer_cast<midikraft::DiscoverableDevice>(synth);
+	auto location = midikraft::Capability::hasCapability<midikraft::MidiLocationCapability>(synth);
+	if (!location || !device || !location->channel().isValid() || !device->wasDetected()) {
+		AlertWindow::showMessageBox(juce::AlertWindow::AlertIconType::InfoIcon, "Synth not connected", "To compare a bank with the synth, make sure the synth is connected and detected correctly. Use the MIDI setup to make sure you have connectivity and a green bar!");
+		return;
+	}
+
+	midikraft::MidiController::instance()->enableMidiInput(location->midiInput());
+	downloadBanksPipelined(synth, { bank->bankNumber() }, [this, bank, compared](MidiBankNumber, std::vector<midikraft::PatchHolder> patchesLoaded) {
+		// One pass over the download, placing each fingerprint by its program number
+		auto stored = bank->patches();
+		std::vector<std::string> inSynth(stored.size());
+		for (auto const &patch : patchesLoaded) {
+			auto position = patch.patchNumber().toZeroBasedDiscardingBank();
+			if (position >= 0 && position < (int)inSynth.size()) {
+				inSynth[(size_t)position] = patch.md5();
+			}
+		}
+		std::set<int> differing;
+		for (size_t i = 0; i < stored.size(); i++) {
+			if (stored[i].md5() != inSynth[i]) {
+				differing.insert((int)i);
+			}
+		}
+		spdlog::info("{} of {} programs in the synth differ from the stored bank {}", differing.size(), stored.size(), midikraft::SynthBank::friendlyBankName(bank->synth(), bank->bankNumber()));
+		synthDifferences_[midikraft::ActiveSynthBank::makeId(bank->synth(), bank->bankNumber())] = differing;
+		if (compared) {
+			compared();
+		}
+	});
+}
+
+std::set<int> PatchView::differencesFromSynth(std::shared_ptr<midikraft::SynthBank> bank) const
+{
+	if (bank) {
+		auto found = synthDifferences_.find(midikraft::ActiveSynthBank::makeId(bank->synth(), bank->bankNumber()));
+		if (found != synthDifferences_.end()) {
+			return found->second;
+		}
+	}
+	return {};
+}
+
+void PatchView::setSynthBankFilter(std::shared_ptr<midikraft::Synth> synth, MidiBankNumber bank) {
+	auto bankId = midikraft::ActiveSynthBank::makeId(synth, bank);
+	// Check if this synth bank has ever been loaded
+	std::map<std::string, std::weak_ptr<midikraft::Synth>> synths;
+	synths[synth->getName()] = synth;
+	if (database_.doesListExist(bankId)) {
+		// It does, so we can safely load and display it
+		loadSynthBankFromDatabase(synth, bank, bankId);
+	}
+	else {
+		// No, first time ever - offer the user to download from the synth if connected
+		retrieveBankFromSynth(synth, bank, [this, synth]() {
 			// After it has been loaded successfully, make sure to select it in the tree 
 			std::string synthName = synth->getName();
 			patchListTree_.selectItemByPath({ "allpatches", "library-" + synthName, "banks-" + synthName});
@@ -464,14 +1198,20 @@ void PatchView::deleteSomething(nlohmann::json const& infos)
 				auto [deleted, hidden] = database_.deletePatches(infos["synth"], { infos["md5"] });
 				if (deleted > 0) {
 					spdlog::info("Deleted patch {} from database", patchName);
+					textIndex_.remove(infos["md5"].get<std::string>());
 				}
 				else if (hidden > 0 ) {
 					spdlog::warn("Could not delete patch {} from database as it is referred to be at least one bank definition. Removed it from user lists and set it to hidden instead!", patchName);
+					// Hidden might still pass the filter, build the index again on the next ~ search
+					textIndexGeneration_++;
+					textIndexValid_ = false;
 				} 
 				else {
 					spdlog::error("Program error, could not delete patch");
 				}
 				patchListTree_.refreshAllUserLists();
+				similarityIndex_.clear();
+				patchButtons_->invalidatePageCache();
 				patchButtons_->refresh(true);
 			}
 			return;
@@ -483,7 +1223,7 @@ void PatchView::deleteSomething(nlohmann::json const& infos)
 			std::string list_name = infos["list_name"];
 			database_.removePatchFromList(list_id, infos["synth"], infos["md5"], infos["order_num"]);
 			spdlog::info("Removed patch {} from list {}", patch_name,  list_name);
-			patchListTree_.refreshUserList(list_id);
+			patchListTree_.patchRemovedFromList(list_id, infos["order_num"]);
 			if (listFilterID_ == list_id) {
 				retrieveFirstPageFromDatabase();
 			}
@@ -498,7 +1238,7 @@ void PatchView::deleteSomething(nlohmann::json const& infos)
 				spdlog::info("Deleted list {}", list_name);
 				if (listFilterID_ == list_id) {
 				}
-				patchListTree_.refreshAllUserLists();
+				patchListTree_.userListDeleted(list_id);
 			}
 			return;
 		}
@@ -510,25 +1250,18 @@ void PatchView::retrievePatches() {
 	auto activeSynth = UIModel::instance()->currentSynth_.smartSynth();
 	auto device = std::dynamic_pointer_cast<midikraft::DiscoverableDevice>(activeSynth);
 	auto midiLocation = midikraft::Capability::hasCapability<midikraft::MidiLocationCapability>(activeSynth);
-	std::shared_ptr<ProgressHandlerWindow> progressWindow = std::make_shared<LibrarianProgressWindow>(librarian_, "Import patches from Synth");
 	if (activeSynth /*&& device->wasDetected()*/) {
 		midikraft::MidiController::instance()->enableMidiInput(midiLocation->midiInput());
 		importDialog_ = std::make_unique<ImportFromSynthDialog>(activeSynth,
-			[this, progressWindow, activeSynth, midiLocation](std::vector<MidiBankNumber> bankNo) {
-			if (!bankNo.empty()) {
-				progressWindow->launchThread();
-				librarian_.startDownloadingAllPatches(
-					midikraft::MidiController::instance()->getMidiOutput(midiLocation->midiOutput()),
-					activeSynth,
-					bankNo,
-					progressWindow.get(), [this, progressWindow](std::vector<midikraft::PatchHolder> patchesLoaded) {
-					progressWindow->signalThreadShouldExit();
-					MessageManager::callAsync([this, patchesLoaded]() {
-						auto enhanced = autoCategorize(patchesLoaded);
-						mergeNewPatches(enhanced);
-					});
+			[this, activeSynth](std::vector<MidiBankNumber> bankNo) {
+			// Each bank is stored and shown while the next one is downloading
+			downloadBanksPipelined(activeSynth, bankNo, [this](MidiBankNumber, std::vector<midikraft::PatchHolder> patchesLoaded) {
+				mergeQueue_->add(patchesLoaded, [safeThis = Component::SafePointer<PatchView>(this)](std::vector<midikraft::PatchHolder> outNewPatches) {
+					if (safeThis) {
+						safeThis->showMergedPatches(outNewPatches);
+					}
 				});
-			}
+			});
 		}
 		);
 		DialogWindow::LaunchOptions launcher;
@@ -544,12 +1277,35 @@ void PatchView::retrievePatches() {
 	}
 }
 
-std::vector<midikraft::PatchHolder> PatchView::autoCategorize(std::vector<midikraft::PatchHolder> const &patches) {
-	std::vector<midikraft::PatchHolder> result;
-	for (auto p : patches) {
-		p.autoCategorizeAgain(database_.getCategorizer());
-		result.push_back(p);
+void PatchView::downloadBanksPipelined(std::shared_ptr<midikraft::Synth> synth, std::vector<MidiBankNumber> banks, std::function<void(MidiBankNumber, std::vector<midikraft::PatchHolder>)> bankLoaded)
+{
+	auto location = midikraft::Capability::hasCapability<midikraft::MidiLocationCapability>(synth);
+	if (banks.empty() || !location) {
+		return;
 	}
+
+	auto bank = banks.front();
+	std::vector<MidiBankNumber> remaining(banks.begin() + 1, banks.end());
+	auto progressWindow = std::make_shared<LibrarianProgressWindow>(librarian_, "Import patches from Synth");
+	progressWindow->launchThread();
+	progressWindow->setMessage(fmt::format("Importing {} from {}...", midikraft::SynthBank::friendlyBankName(synth, bank), synth->getName()));
+	librarian_.startDownloadingAllPatches(
+		midikraft::MidiController::instance()->getMidiOutput(location->midiOutput()),
+		synth,
+		bank,
+		progressWindow.get(), [this, progressWindow, synth, bank, remaining, bankLoaded](std::vector<midikraft::PatchHolder> patchesLoaded) {
+			progressWindow->signalThreadShouldExit();
+			MessageManager::callAsync([this, synth, bank, remaining, bankLoaded, patchesLoaded]() {
+				// Request the next bank right away, this one is merged in the background meanwhile
+				downloadBanksPipelined(synth, remaining, bankLoaded);
+				bankLoaded(bank, patchesLoaded);
+			});
+		});
+}
+
+std::vector<midikraft::PatchHolder> PatchView::autoCategorize(std::vector<midikraft::PatchHolder> const &patches) {
+	std::vector<midikraft::PatchHolder> result = patches;
+	PatchMergePreparation::autoCategorize(result, database_.getCategorizer());
 	return result;
 }
 
@@ -587,16 +1343,70 @@ void PatchView::retrieveEditBuffer()
 	}
 }
 
+class BulkRenameJob : public ThreadWithProgressWindow {
+public:
+	BulkRenameJob(midikraft::PatchDatabase &db, std::vector<midikraft::PatchHolder> patches, std::vector<std::string> newNames)
+		: ThreadWithProgressWindow("Renaming patches...", true, true), db_(db), patches_(std::move(patches)), newNames_(std::move(newNames)) {
+	}
+
+	// Renaming goes through the adaptation for each patch, so this is done in batches with one database merge each
+	virtual void run() override {
+		std::vector<size_t> toRename;
+		for (size_t i = 0; i < std::min(patches_.size(), newNames_.size()); i++) {
+			if (patches_[i].name() != newNames_[i]) {
+				toRename.push_back(i);
+			}
+		}
+		for (size_t start = 0; start < toRename.size(); start += kBatchSize) {
+			if (threadShouldExit())
+				break;
+			std::vector<midikraft::PatchHolder> batch;
+			for (size_t j = start; j < std::min(toRename.size(), start + kBatchSize); j++) {
+				auto patch = patches_[toRename[j]];
+				patch.setName(newNames_[toRename[j]]);
+				batch.push_back(patch);
+			}
+			std::vector<midikraft::PatchHolder> newPatches;
+			renamed_ += db_.mergePatchesIntoDatabase(batch, newPatches, nullptr, midikraft::PatchDatabase::UPDATE_NAME);
+			setProgress((start + batch.size()) / (double) toRename.size());
+		}
+	}
+
+	size_t renamed() const { return renamed_; }
+
+private:
+	static constexpr size_t kBatchSize = 100;
+
+	midikraft::PatchDatabase &db_;
+	std::vector<midikraft::PatchHolder> patches_;
+	std::vector<std::string> newNames_;
+	size_t renamed_ = 0;
+};
+
 void PatchView::bulkRenamePatches()
 {
-	loadPage(0, 512, currentFilter(), [this](std::vector<midikraft::PatchHolder> patches) {
-		BulkRenameDialog::show(patches, this, [this](std::vector<midikraft::PatchHolder> renamed) {
-			std::vector<midikraft::PatchHolder> newPatches_;
-			size_t numChanged = database_.mergePatchesIntoDatabase(renamed, newPatches_, nullptr, midikraft::PatchDatabase::UPDATE_NAME);
-			spdlog::info("Renamed {} patches in the database!", numChanged);
-			retrieveFirstPageFromDatabase();
+	bulkRenamePage(currentFilter(), 0, totalNumberOfPatches());
+}
+
+void PatchView::bulkRenamePage(midikraft::PatchFilter const &filter, int skip, int total)
+{
+	// One page per dialog, so neither the query nor the dialog ever holds the whole library
+	loadPage(skip, kBulkRenamePageSize, filter, [this, filter, skip, total](std::vector<midikraft::PatchHolder> patches) {
+		BulkRenameDialog::showNames(patches, this, [this, patches, filter, skip, total](std::vector<std::string> newNames) {
+			// Start the job once the dialog is gone
+			MessageManager::callAsync([this, patches, newNames, filter, skip, total]() {
+				BulkRenameJob job(database_, patches, newNames);
+				job.runThread();
+				spdlog::info("Renamed {} patches in the database!", job.renamed());
+				retrieveFirstPageFromDatabase();
+				int next = skip + kBulkRenamePageSize;
+				if (next < total && AlertWindow::showOkCancelBox(AlertWindow::QuestionIcon, "Continue renaming?",
+					fmt::format("Continue with patches {} to {} of {}?", next + 1, std::min(next + kBulkRenamePageSize, total), total))) {
+					bulkRenamePage(filter, next, total);
+				}
 			});
 		});
+	});
 }
 
 void PatchView::deletePatches()
@@ -608,6 +1418,9 @@ void PatchView::deletePatches()
 		if (AlertWindow::showOkCancelBox(AlertWindow::WarningIcon, "Do you know what you are doing?",
 			"Are you sure?", "Yes", "No")) {
 			int deleted = database_.deletePatches(currentFilter());
+			similarityIndex_.clear();
+			textIndexGeneration_++;
+			textIndexValid_ = false;
 			AlertWindow::showMessageBox(AlertWindow::InfoIcon, "Patches deleted", fmt::format("{} patches deleted from database", deleted));
 			UIModel::instance()->importListChanged_.sendChangeMessage();
 			retrieveFirstPageFromDatabase();
@@ -615,6 +1428,69 @@ void PatchView::deletePatches()
 	}
 }
 
+class ReindexPreparation : public ThreadWithProgressWindow {
+public:
+	ReindexPreparation(midikraft::PatchDatabase &db, std::shared_ptr<midikraft::Synth> synth, midikraft::PatchFilter const &filter)
+		: ThreadWithProgressWindow("Calculating new fingerprints...", true, true), db_(db), synth_(synth), filter_(filter) {
+	}
+
+	virtual void run() override {
+		auto patches = db_.getPatches(filter_, 0, -1);
+		if (threadShouldExit())
+			return;
+		totalPatches_ = patches.size();
+
+		std::vector<std::string> fingerprints(patches.size());
+		auto adaptation = std::dynamic_pointer_cast<knobkraft::GenericAdaptation>(synth_);
+		if (adaptation) {
+			// Python runs under the GIL anyway, so instead of threads we make few large calls. The results land in the
+			// adaptation's result cache, where the database finds them during the actual reindexing
+			for (size_t start = 0; start < patches.size(); start += kPythonBatchSize) {
+				if (threadShouldExit())
+					return;
+				midikraft::TPatchVector batch;
+				for (size_t i = start; i < std::min(patches.size(), start + kPythonBatchSize); i++) {
+					batch.push_back(patches[i].patch());
+				}
+				auto batchFingerprints = adaptation->calculateFingerprints(batch);
+				std::copy(batchFingerprints.begin(), batchFingerprints.end(), fingerprints.begin() + (long) start);
+				setProgress((start + batch.size()) / (double) patches.size());
+			}
+		}
+		else {
+			bool completed = parallelFor(patches.size(), [&](size_t i) {
+				if (patches[i].patch()) {
+					fingerprints[i] = synth_->calculateFingerprint(patches[i].patch());
+				}
+			}, [this](double progress) {
+				setProgress(progress);
+				return !threadShouldExit();
+			});
+			if (!completed)
+				return;
+		}
+
+		std::set<std::string> distinct(fingerprints.begin(), fingerprints.end());
+		distinct.erase(std::string());
+		expectedCount_ = distinct.size();
+		completed_ = true;
+	}
+
+	bool completed() const { return completed_; }
+	size_t totalPatches() const { return totalPatches_; }
+	size_t expectedCount() const { return expectedCount_; }
+
+private:
+	static constexpr size_t kPythonBatchSize = 256;
+
+	midikraft::PatchDatabase &db_;
+	std::shared_ptr<midikraft::Synth> synth_;
+	midikraft::PatchFilter filter_;
+	bool completed_ = false;
+	size_t totalPatches_ = 0;
+	size_t expectedCount_ = 0;
+};
+
 void PatchView::reindexPatches() {
 	// We do reindex all patches of the currently selected synth. It does not make sense to reindex less than that.
 	auto currentSynth = UIModel::instance()->currentSynth_.smartSynth();
@@ -622,13 +1498,25 @@ void PatchView::reindexPatches() {
 	midikraft::PatchFilter filter({ currentSynth });
 	filter.turnOnAll(); // Make sure we also reindex hidden entries
 
-	int totalAffected = database_.getPatchesCount(filter);
+	// Calculate the new fingerprints up front on all cores, this tells the user what to expect before anything is changed
+	ReindexPreparation preparation(database_, currentSynth, filter);
+	preparation.runThread();
+	if (!preparation.completed()) return;
+
+	int totalAffected = (int) preparation.totalPatches();
 	if (AlertWindow::showOkCancelBox(AlertWindow::QuestionIcon, fmt::format("Do you want to reindex all {} patches for synth {}?", totalAffected, currentSynth->getName()),
-		fmt::format("This will reindex the {} patches with the current fingerprinting algorithm.\n\n"
+		fmt::format("This will reindex the {} patches with the current fingerprinting algorithm. With the new fingerprints, {} distinct patches will remain.\n\n"
 			"Hopefully this will get rid of duplicates properly, but if there are duplicates under multiple names you'll end up with a somewhat random result which name is chosen for the de-duplicated patch.\n",
-			totalAffected))) {
-		std::string backupName = database_.makeDatabaseBackup("-before-reindexing");
-		spdlog::info("Created database backup at {}", backupName);
+			totalAffected, preparation.expectedCount()))) {
+		File databaseFile(database_.getCurrentDatabaseFileName());
+		File backupFile = DatabaseBackup::backupFileFor(databaseFile, "-before-reindexing");
+		DatabaseBackup backup(databaseFile, backupFile);
+		backup.runThread();
+		if (!backup.succeeded()) {
+			AlertWindow::showMessageBox(AlertWindow::WarningIcon, "Reindexing cancelled", "Could not create a backup of the database before reindexing: " + backup.error());
+			return;
+		}
+		spdlog::info("Created database backup at {}", backupFile.getFullPathName());
 		int countAfterReindexing = database_.reindexPatches(filter);
 		if (countAfterReindexing != -1) {
 			// No error, display user info
@@ -649,9 +1537,214 @@ void PatchView::reindexPatches() {
 	}
 }
 
+void PatchView::repairDatabase() {
+	auto findings = verifier_->findings();
+	std::set<std::string> staleSynths;
+	size_t unreadable = 0;
+	size_t stale = 0;
+	size_t orphaned = 0;
+	for (auto const &finding : findings) {
+		switch (finding.problem) {
+		case DatabaseVerifier::Problem::MissingData:
+		case DatabaseVerifier::Problem::UndecodableData:
+			spdlog::warn("Patch {} of synth {} has data that can't be read", finding.name, finding.synth);
+			unreadable++;
+			break;
+		case DatabaseVerifier::Problem::StaleFingerprint:
+			staleSynths.insert(finding.synth);
+			stale++;
+			break;
+		case DatabaseVerifier::Problem::OrphanedListEntry:
+			orphaned++;
+			break;
+		}
+	}
+	if (stale == 0 && orphaned == 0) {
+		if (unreadable > 0) {
+			AlertWindow::showMessageBox(AlertWindow::WarningIcon, "Nothing to repair",
+				fmt::format("{} patches have data that can't be read any more, there is nothing to restore them from. Their names are in the log, you might want to delete them.", unreadable));
+		}
+		else {
+			AlertWindow::showMessageBox(AlertWindow::InfoIcon, "Nothing to repair",
+				fmt::format("The background check has looked at {} patches so far and found no problems.", verifier_->patchesChecked()));
+		}
+		return;
+	}
+
+	std::string message;
+	if (stale > 0) {
+		message += fmt::format("{} patches are stored under an outdated fingerprint, all patches of the synths affected will be reindexed.\n\n", stale);
+	}
+	if (orphaned > 0) {
+		message += fmt::format("{} entries of user lists refer to patches not in the database any more, they will be removed from the lists.\n\n", orphaned);
+	}
+	if (unreadable > 0) {
+		message += fmt::format("{} patches have data that can't be read, these can't be repaired. Their names are in the log.\n", unreadable);
+	}
+	if (!AlertWindow::showOkCancelBox(AlertWindow::QuestionIcon, "Repair database?", message)) {
+		return;
+	}
+
+	File databaseFile(database_.getCurrentDatabaseFileName());
+	File backupFile = DatabaseBackup::backupFileFor(databaseFile, "-before-repair");
+	DatabaseBackup backup(databaseFile, backupFile);
+	backup.runThread();
+	if (!backup.succeeded()) {
+		AlertWindow::showMessageBox(AlertWindow::WarningIcon, "Repair cancelled", "Could not create a backup of the database before repairing: " + backup.error());
+		return;
+	}
+	spdlog::info("Created database backup at {}", backupFile.getFullPathName());
+
+	bool ok = true;
+	if (orphaned > 0) {
+		std::string error;
+		if (DatabaseVerifier::removeOrphanedListEntries(databaseFile, findings, error)) {
+			// The lists are cached in the tree, have them loaded again
+			UIModel::instance()->databaseChanged.sendChangeMessage();
+		}
+		else {
+			spdlog::error("Repairing the lists failed: {}", error);
+			ok = false;
+		}
+	}
+	for (auto const &holder : synths_) {
+		auto synth = holder.smartSynth();
+		if (synth && staleSynths.count(synth->getName()) != 0) {
+			midikraft::PatchFilter filter({ synth });
+			filter.turnOnAll();
+			if (database_.reindexPatches(filter) == -1) {
+				spdlog::error("Reindexing the patches of {} failed", synth->getName());
+				ok = false;
+			}
+		}
+	}
+	if (ok) {
+		AlertWindow::showMessageBox(AlertWindow::InfoIcon, "Database repaired", "The problems found were repaired, the database will be checked again in the background.");
+	}
+	else {
+		AlertWindow::showMessageBox(AlertWindow::WarningIcon, "Error repairing the database", "Not everything could be repaired. View the log for more details, the backup is at " + backupFile.getFullPathName().toStdString());
+	}
+	verifier_->recheck();
+	retrieveFirstPageFromDatabase();
+}
+
+class DatabaseCompaction : public ThreadWithProgressWindow {
+public:
+	explicit DatabaseCompaction(File file) : ThreadWithProgressWindow("Compacting database...", true, false), file_(file) {
+	}
+
+	virtual void run() override {
+		// A VACUUM can't report progress
+		setProgress(-1.0);
+		succeeded_ = DatabaseMaintenance::compact(file_, error_);
+	}
+
+	bool succeeded() const { return succeeded_; }
+	std::string error() const { return error_; }
+
+private:
+	File file_;
+	bool succeeded_ = false;
+	std::string error_;
+};
+
+void PatchView::compactDatabase() {
+	File databaseFile(database_.getCurrentDatabaseFileName());
+	if (!AlertWindow::showOkCancelBox(AlertWindow::QuestionIcon, "Compact database?",
+		fmt::format("This rewrites the whole database file {} ({}) once, which can take a while for a large library. "
+			"Afterwards the space of deleted patches is given back to the disk automatically while the app is idle.", databaseFile.getFileName().toStdString(), File::descriptionOfSizeInBytes(databaseFile.getSize()).toStdString()))) {
+		return;
+	}
+	flushMetadataEdits();
+	DatabaseCompaction compaction(databaseFile);
+	compaction.runThread();
+	if (compaction.succeeded()) {
+		AlertWindow::showMessageBox(AlertWindow::InfoIcon, "Database compacted", fmt::format("The database file now has {}.", File::descriptionOfSizeInBytes(databaseFile.getSize()).toStdString()));
+	}
+	else {
+		AlertWindow::showMessageBox(AlertWindow::WarningIcon, "Error compacting the database", "The database could not be compacted: " + compaction.error());
+	}
+}
+
+class NearDuplicateSearch : public ThreadWithProgressWindow {
+public:
+	NearDuplicateSearch(midikraft::PatchDatabase &db, midikraft::PatchFilter const &filter)
+		: ThreadWithProgressWindow("Searching for near duplicates...", true, true), db_(db), filter_(filter) {
+	}
+
+	virtual void run() override {
+		setStatusMessage("Loading patches from database...");
+		auto patches = db_.getPatches(filter_, 0, -1);
+		if (threadShouldExit())
+			return;
+		setStatusMessage(fmt::format("Comparing {} patches...", patches.size()));
+		clusters_ = NearDuplicateFinder::findClusters(patches, [this](double progress) {
+			setProgress(progress);
+			return !threadShouldExit();
+		});
+	}
+
+	std::vector<NearDuplicateFinder::Cluster> const &clusters() const {
+		return clusters_;
+	}
+
+private:
+	midikraft::PatchDatabase &db_;
+	midikraft::PatchFilter filter_;
+	std::vector<NearDuplicateFinder::Cluster> clusters_;
+};
+
+void PatchView::findNearDuplicates() {
+	// Near duplicates can only exist within one synth, but we look at all synths in one go as the passes are cheap
+	std::vector<std::shared_ptr<midikraft::Synth>> allSynths;
+	for (auto &synth : UIModel::instance()->synthList_.allSynths()) {
+		if (synth.synth()) {
+			allSynths.push_back(synth.synth());
+		}
+	}
+	if (allSynths.empty()) return;
+	midikraft::PatchFilter filter(allSynths);
+	filter.turnOnAll(); // Hidden patches are the most likely to be duplicates
+
+	NearDuplicateSearch search(database_, filter);
+	if (!search.runThread()) {
+		return;
+	}
+
+	auto const &clusters = search.clusters();
+	if (clusters.empty()) {
+		AlertWindow::showMessageBox(AlertWindow::InfoIcon, "No near duplicates found", "No patches were found that differ in at most 2% of their voice data, and in no more than 7 bytes.");
+		return;
+	}
+
+	size_t numberOfPatches = 0;
+	for (auto const &cluster : clusters) {
+		numberOfPatches += cluster.size();
+		StringArray names;
+		for (auto const &patch : cluster) {
+			names.add(patch.name());
+		}
+		spdlog::info("Near duplicates for {}: {}", cluster.front().synth()->getName(), names.joinIntoString(", ").toStdString());
+	}
+
+	if (AlertWindow::showOkCancelBox(AlertWindow::QuestionIcon, "Near duplicates found",
+		fmt::format("Found {} groups of near duplicates containing {} patches in total, see the log for the details.\n\n"
+			"Do you want to create a user list with all of them, grouped together, to review them?", clusters.size(), numberOfPatches))) {
+		auto list = std::make_shared<midikraft::PatchList>(fmt::format("Near duplicates {}", Time::getCurrentTime().formatted("%Y-%m-%d %H:%M").toStdString()));
+		std::vector<midikraft::PatchHolder> patches;
+		for (auto const &cluster : clusters) {
+			patches.insert(patches.end(), cluster.begin(), cluster.end());
+		}
+		list->setPatches(patches);
+		database_.putPatchList(list);
+		patchListTree_.userListAdded({ list->id(), list->name() });
+	}
+}
+
 int PatchView::totalNumberOfPatches()
 {
-	return database_.getPatchesCount(currentFilter());
+	auto filter = currentFilter();
+	return counts_.count(filter, [this, &filter]() { return readers_.reader()->getPatchesCount(filter); });
 }
 
 void PatchView::selectFirstPatch()
@@ -659,6 +1752,11 @@ void PatchView::selectFirstPatch()
 	patchButtons_->selectFirst();
 }
 
+void PatchView::loadPatchesOfCurrentFilter(std::function<void(std::vector<midikraft::PatchHolder>)> callback)
+{
+	loadPage(0, -1, currentFilter(), callback);
+}
+
 midikraft::PatchFilter PatchView::currentFilter()
 {
 	auto filter = patchSearch_->getFilter();
@@ -692,7 +1790,14 @@ public:
 			spdlog::warn("No patches contained in data, nothing to upload.");
 		}
 		else {
-			auto numberNew = database_.mergePatchesIntoDatabase(patchesLoaded_, outNewPatches, this, midikraft::PatchDatabase::UPDATE_NAME | midikraft::PatchDatabase::UPDATE_CATEGORIES | midikraft::PatchDatabase::UPDATE_FAVORITE);
+			// Have the fingerprints ready before the database looks up every patch
+			setMessage("Calculating fingerprints...");
+			PatchMergePreparation::prepare(patchesLoaded_, nullptr, [this](double progress) {
+				setProgress(progress);
+				return !threadShouldExit();
+			});
+			setMessage("Merging new patches into database...");
+			auto numberNew = PatchMergePreparation::mergeWithoutDuplicates(database_, patchesLoaded_, outNewPatches, this, midikraft::PatchDatabase::UPDATE_NAME | midikraft::PatchDatabase::UPDATE_CATEGORIES | midikraft::PatchDatabase::UPDATE_FAVORITE);
 			if (numberNew > 0) {
 				spdlog::info("Retrieved {} new or changed patches from the synth, uploaded to database", numberNew);
 				finished_(outNewPatches);
@@ -721,19 +1826,21 @@ void PatchView::receiveManualDump() {
 
 	if (synthToReceiveFrom) {
 		// We need to start a listener thread, and display a waiting dialog box with an end button all the while...
-		ReceiveManualDumpWindow receiveDumpBox(UIModel::instance()->currentSynth_.smartSynth());
+		// The patches are decoded while the dump is still arriving and stored in the background
+		auto detector = database_.getCategorizer();
+		ReceiveManualDumpWindow receiveDumpBox(synthToReceiveFrom, [this, synthToReceiveFrom, detector](std::vector<MidiMessage> const &messages) {
+			// Try to load via Librarian
+			return librarian_.loadSysexPatchesManualDump(synthToReceiveFrom, messages, detector);
+		}, [this](std::vector<midikraft::PatchHolder> const &patches) {
+			mergeQueue_->add(autoCategorize(patches), [safeThis = Component::SafePointer<PatchView>(this)](std::vector<midikraft::PatchHolder> outNewPatches) {
+				if (safeThis) {
+					safeThis->showMergedPatches(outNewPatches);
+				}
+			});
+		});
 
 		receiveDumpBox.runThread();
-
-		auto messagesReceived = receiveDumpBox.result();
-		if (messagesReceived.size() > 0) {
-			// Try to load via Librarian
-			auto patches = librarian_.loadSysexPatchesManualDump(synthToReceiveFrom, messagesReceived, database_.getCategorizer());
-			if (patches.size() > 0) {
-				auto enhanced = autoCategorize(patches);
-				mergeNewPatches(enhanced);
-			}
-		}
+		spdlog::info("Manual dump finished, {} patches received", receiveDumpBox.patchesFound());
 	}
 }
 
@@ -758,13 +1865,87 @@ void PatchView::loadPatches() {
 	}
 }
 
+class StreamingSysexImport : public ThreadWithProgressWindow {
+public:
+	StreamingSysexImport(File file, std::shared_ptr<midikraft::Synth> synth, midikraft::PatchDatabase &db, std::shared_ptr<midikraft::AutomaticCategory> detector)
+		: ThreadWithProgressWindow("Importing sysex file...", true, true), file_(file), synth_(synth), db_(db), detector_(detector) {
+	}
+
+	// The file is processed in chunks of messages, so the memory needed does not depend on the size of the file. As a patch can consist
+	// of several messages, each chunk repeats the last messages of the one before. Patches found twice are deduplicated by the database
+	virtual void run() override {
+		SysexFileStream stream(file_);
+		if (!stream.isOpen()) {
+			error_ = fmt::format("Could not open file {}", file_.getFullPathName().toStdString());
+			return;
+		}
+
+		std::vector<MidiMessage> messages;
+		int programPlace = 0;
+		while (!threadShouldExit()) {
+			size_t keep = std::min(messages.size(), kOverlapMessages);
+			messages.erase(messages.begin(), messages.end() - (long) keep);
+			if (!stream.nextChunk(kMessagesPerChunk, messages))
+				break;
+
+			std::vector<midikraft::PatchHolder> patches;
+			for (auto const &dataFile : synth_->loadSysex(messages)) {
+				auto source = std::make_shared<midikraft::FromFileSource>(file_.getFileName().toStdString(), file_.getFullPathName().toStdString(), MidiProgramNumber::fromZeroBase(programPlace++));
+				patches.emplace_back(synth_, source, dataFile, detector_);
+			}
+			if (!patches.empty()) {
+				PatchMergePreparation::prepare(patches, nullptr, [this](double) { return !threadShouldExit(); });
+				std::vector<midikraft::PatchHolder> outNewPatches;
+				newPatches_ += PatchMergePreparation::mergeWithoutDuplicates(db_, patches, outNewPatches, nullptr, midikraft::PatchDatabase::UPDATE_NAME | midikraft::PatchDatabase::UPDATE_CATEGORIES | midikraft::PatchDatabase::UPDATE_FAVORITE);
+			}
+			setProgress(stream.progress());
+		}
+	}
+
+	std::string const &error() const { return error_; }
+	size_t newPatches() const { return newPatches_; }
+
+private:
+	static constexpr size_t kMessagesPerChunk = 2048;
+	static constexpr size_t kOverlapMessages = 64;
+
+	File file_;
+	std::shared_ptr<midikraft::Synth> synth_;
+	midikraft::PatchDatabase &db_;
+	std::shared_ptr<midikraft::AutomaticCategory> detector_;
+	std::string error_;
+	size_t newPatches_ = 0;
+};
+
+void PatchView::loadLargeSysexFile() {
+	auto synth = UIModel::instance()->currentSynth_.smartSynth();
+	if (!synth) return;
+
+	File lastPath(Settings::instance().get("lastLargeSysexPath", File::getSpecialLocation(File::userDocumentsDirectory).getFullPathName().toStdString()));
+	FileChooser sysexChooser(fmt::format("Please select a sysex file with patches for the {}...", synth->getName()), lastPath, "*.syx");
+	if (!sysexChooser.browseForFileToOpen())
+		return;
+	Settings::instance().set("lastLargeSysexPath", sysexChooser.getResult().getFullPathName().toStdString());
+
+	StreamingSysexImport import(sysexChooser.getResult(), synth, database_, database_.getCategorizer());
+	import.runThread();
+	if (!import.error().empty()) {
+		AlertWindow::showMessageBox(AlertWindow::WarningIcon, "Error importing sysex file", import.error());
+		return;
+	}
+	AlertWindow::showMessageBox(AlertWindow::InfoIcon, "Sysex file imported", fmt::format("Imported {} new patches into the database", import.newPatches()));
+	patchListTree_.refreshAllImports();
+	retrieveFirstPageFromDatabase();
+}
+
 class BulkImportPIP : public ThreadWithProgressWindow {
 public:
 	BulkImportPIP(File directory, midikraft::PatchDatabase &db, std::shared_ptr<midikraft::AutomaticCategory> detector) 
 		: ThreadWithProgressWindow("Importing patch archives...", true, true), directory_(directory), db_(db), detector_(detector) {
 	}
 
-	virtual void run() {
+	// The thread of the progress window is the only one writing to the database, a pool of parsers feeds it with decoded files
+	virtual void run() override {
 		std::map<std::string, std::shared_ptr<midikraft::Synth>> synths;
 		for (auto synth : UIModel::instance()->synthList_.allSynths()) {
 			synths[synth.getName()] = synth.synth();
@@ -772,29 +1953,134 @@ public:
 
 		Array<File> pips;
 		directory_.findChildFiles(pips, File::TypesOfFileToFind::findFiles, false, "*.json");
-		double count = 0.0;
-		for (auto const &pip : pips) {
-			if (threadShouldExit())
-				break;
+		totalFiles_ = pips.size();
+		if (pips.isEmpty())
+			return;
 
-			if (pip.existsAsFile()) {
-				auto patches = midikraft::PatchInterchangeFormat::load(synths, pip.getFullPathName().toStdString(), detector_);
-				std::vector<midikraft::PatchHolder> outNewPatches;
-				auto numberNew = db_.mergePatchesIntoDatabase(patches, outNewPatches, nullptr, midikraft::PatchDatabase::UPDATE_NAME | midikraft::PatchDatabase::UPDATE_CATEGORIES | midikraft::PatchDatabase::UPDATE_FAVORITE);
-				if (numberNew > 0) {
-					spdlog::info("Loaded {} additional patches from file {}", numberNew, pip.getFullPathName());
+		std::atomic<int> nextFile(0);
+		std::atomic<bool> stopParsing(false);
+		int numParsers = std::max(1, std::min(SystemStats::getNumCpus(), pips.size()));
+		ThreadPool parsers(numParsers);
+		for (int p = 0; p < numParsers; p++) {
+			parsers.addJob([&]() {
+				int index;
+				while (!stopParsing && (index = nextFile++) < pips.size()) {
+					// Bound the memory used by files waiting for the writer
+					while (!stopParsing && queueLength() >= kMaxFilesWaiting) {
+						spaceAvailable_.wait(50);
+					}
+					// Large archives are handed to the writer in chunks, so no file needs to fit into memory at once
+					auto queueChunk = [this](ParsedFile &&chunk) {
+						{
+							ScopedLock lock(queueLock_);
+							parsed_.push_back(std::move(chunk));
+						}
+						fileAvailable_.signal();
+					};
+					std::string error;
+					PatchInterchangeReader::load(synths, pips[index], detector_, kPatchesPerChunk, [&](std::vector<midikraft::PatchHolder> &patches) {
+						PatchMergePreparation::prepare(patches, nullptr, [&stopParsing](double) { return !stopParsing; });
+						queueChunk(ParsedFile{ pips[index], std::move(patches), {}, false });
+						while (!stopParsing && queueLength() >= kMaxFilesWaiting) {
+							spaceAvailable_.wait(50);
+						}
+						return !stopParsing;
+					}, error);
+					queueChunk(ParsedFile{ pips[index], {}, error, true });
+				}
+				return ThreadPoolJob::jobHasFinished;
+			});
+		}
+
+		int filesDone = 0;
+		while (filesDone < pips.size() && !threadShouldExit()) {
+			std::deque<ParsedFile> ready;
+			{
+				ScopedLock lock(queueLock_);
+				ready.swap(parsed_);
+			}
+			if (ready.empty()) {
+				fileAvailable_.wait(50);
+				continue;
+			}
+			spaceAvailable_.signal();
+			for (auto &file : ready) {
+				mergeFile(file);
+				if (file.lastChunk) {
+					filesDone++;
+					setProgress(filesDone / (double) pips.size());
 				}
 			}
+		}
+		stopParsing = true;
+		spaceAvailable_.signal();
+	}
 
-			count += 1.0;
-			setProgress(count / pips.size());
+	String summary() const {
+		String result = fmt::format("Imported {} new patches from {} of {} files.", newPatches_, filesImported_, totalFiles_);
+		if (!failedFiles_.isEmpty()) {
+			result += fmt::format("\n\n{} files could not be imported:\n", failedFiles_.size()) + failedFiles_.joinIntoString("\n");
 		}
+		return result;
 	}
 
 private:
+	struct ParsedFile {
+		File file;
+		std::vector<midikraft::PatchHolder> patches;
+		std::string error;
+		bool lastChunk; // Carries no patches, only the outcome of the file
+	};
+
+	static constexpr size_t kMaxFilesWaiting = 16;
+	static constexpr size_t kPatchesPerChunk = 500;
+
+	size_t queueLength() {
+		ScopedLock lock(queueLock_);
+		return parsed_.size();
+	}
+
+	void mergeFile(ParsedFile &file) {
+		if (file.lastChunk) {
+			if (!file.error.empty()) {
+				spdlog::error("Failed to load patch archive {}: {}", file.file.getFullPathName(), file.error);
+				failedFiles_.add(file.file.getFileName() + ": " + file.error);
+			}
+			else if (failedMerges_.find(file.file.getFullPathName()) == failedMerges_.end()) {
+				filesImported_++;
+			}
+			return;
+		}
+		try {
+			std::vector<midikraft::PatchHolder> outNewPatches;
+			auto numberNew = db_.mergePatchesIntoDatabase(file.patches, outNewPatches, nullptr, midikraft::PatchDatabase::UPDATE_NAME | midikraft::PatchDatabase::UPDATE_CATEGORIES | midikraft::PatchDatabase::UPDATE_FAVORITE);
+			if (numberNew > 0) {
+				spdlog::info("Loaded {} additional patches from file {}", numberNew, file.file.getFullPathName());
+				newPatches_ += numberNew;
+			}
+		}
+		catch (std::exception &e) {
+			spdlog::error("Failed to store patches of archive {}: {}", file.file.getFullPathName(), e.what());
+			if (failedMerges_.insert(file.file.getFullPathName()).second) {
+				failedFiles_.add(file.file.getFileName() + ": " + e.what());
+			}
+		}
+	}
+
 	File directory_;
 	midikraft::PatchDatabase& db_;
 	std::shared_ptr<midikraft::AutomaticCategory> detector_;
+
+	CriticalSection queueLock_;
+	std::deque<ParsedFile> parsed_;
+	WaitableEvent fileAvailable_;
+	WaitableEvent spaceAvailable_;
+
+	int totalFiles_ = 0;
+	int filesImported_ = 0;
+	size_t newPatches_ = 0;
+	StringArray failedFiles_;
+	std::set<String> failedMerges_; // Files with a chunk the database refused
 };
 
 void PatchView::bulkImportPIP(File directory) {
@@ -802,18 +2088,64 @@ void PatchView::bulkImportPIP(File directory) {
 
 	bulk.runThread();
 
+	AlertWindow::showMessageBox(AlertWindow::InfoIcon, "Bulk import finished", bulk.summary());
 	retrieveFirstPageFromDatabase();
 }
 
 void PatchView::exportPatches()
 {
-	loadPage(0, -1, currentFilter(), [this](std::vector<midikraft::PatchHolder> patches) {
-		ExportDialog::showExportDialog(this, [this, patches](midikraft::Librarian::ExportParameters params) {
-			librarian_.saveSysexPatchesToDisk(params, patches);
+	auto filter = currentFilter();
+	ExportDialog::showExportDialog(this, [this, filter](midikraft::Librarian::ExportParameters params) {
+		if (!SysexExportJob::canExport(params)) {
+			loadPage(0, -1, filter, [this, params](std::vector<midikraft::PatchHolder> patches) {
+				librarian_.saveSysexPatchesToDisk(params, patches);
+			});
+			return;
+		}
+		File destination;
+		if (!SysexExportJob::chooseDestination(params, destination)) {
+			return;
+		}
+		auto job = std::make_shared<SysexExportJob>(File(database_.getCurrentDatabaseFileName()), filter, params, destination);
+		BackgroundJobs::instance().add(job, {}, [job, destination](BackgroundJob::State state) {
+			if (state == BackgroundJob::State::Succeeded) {
+				spdlog::info("Exported {} patches to {}", job->patchesWritten(), destination.getFullPathName());
+			}
+			else if (state == BackgroundJob::State::Failed) {
+				AlertWindow::showMessageBox(AlertWindow::WarningIcon, "Export failed", "The patches could not all be exported to " + destination.getFullPathName() + ", check the log for details");
+			}
 		});
 	});
 }
 
+void PatchView::armSetlist()
+{
+	auto list = retrieveListFromDatabase({ listFilterID_, "" });
+	if (!list || list->patches().empty()) {
+		AlertWindow::showMessageBox(AlertWindow::InfoIcon, "No list selected", "To arm a setlist, select the user list with the patches in the order you want to play them in the Library tree first.");
+		return;
+	}
+	Component::SafePointer<PatchView> safeThis(this);
+	Setlist::instance().arm(list, [list](bool armed) {
+		if (!armed) {
+			spdlog::warn("Setlist {} was not armed", list->name());
+		}
+	}, [safeThis](midikraft::PatchHolder const &patch) {
+		if (safeThis) {
+			// The setlist replaced the edit buffer with its pinned messages, a delta from what we sent last would be wrong
+			safeThis->deltaSend_.forget(patch.smartSynth());
+			// Already playing, only show it
+			auto copy = patch;
+			safeThis->selectPatch(copy, false);
+		}
+	});
+}
+
+void PatchView::disarmSetlist()
+{
+	Setlist::instance().disarm();
+}
+
 void PatchView::updateLastPath() {
 	if (lastPathForPIF_.empty()) {
 		// Read from settings
@@ -825,42 +2157,106 @@ void PatchView::updateLastPath() {
 	}
 }
 
+class StreamingPIFExport : public ThreadWithProgressWindow {
+public:
+	StreamingPIFExport(File file, midikraft::PatchDatabase &db, midikraft::PatchFilter const &filter)
+		: ThreadWithProgressWindow("Creating patch interchange file...", true, true), file_(file), db_(db), filter_(filter) {
+	}
+
+	// Pages through the database, so the export of a large library never holds more than one page of patches
+	virtual void run() override {
+		int total = db_.getPatchesCount(filter_);
+		PatchInterchangeWriter writer(file_);
+		for (int skip = 0; skip < total; skip += kPatchesPerPage) {
+			if (threadShouldExit()) {
+				return;
+			}
+			auto page = db_.getPatches(filter_, skip, kPatchesPerPage);
+			if (page.empty()) {
+				break;
+			}
+			if (!writer.append(page)) {
+				error_ = "Failed to write the file";
+				return;
+			}
+			setProgress((skip + page.size()) / (double) total);
+		}
+		if (!writer.finish()) {
+			error_ = "Failed to write the file";
+		}
+		written_ = writer.patchesWritten();
+	}
+
+	std::string const &error() const { return error_; }
+	size_t written() const { return written_; }
+
+private:
+	static constexpr int kPatchesPerPage = 500;
+
+	File file_;
+	midikraft::PatchDatabase &db_;
+	midikraft::PatchFilter filter_;
+	std::string error_;
+	size_t written_ = 0;
+};
+
 void PatchView::createPatchInterchangeFile()
 {
-	loadPage(0, -1, currentFilter(), [this](std::vector<midikraft::PatchHolder> patches) {
-		updateLastPath();
-		FileChooser pifChooser("Please enter the name of the Patch Interchange Format file to create...", File(lastPathForPIF_), "*.json");
-		if (pifChooser.browseForFileToSave(true)) {
-			midikraft::PatchInterchangeFormat::save(patches, pifChooser.getResult().getFullPathName().toStdString());
-			lastPathForPIF_ = pifChooser.getResult().getFullPathName().toStdString();
-			Settings::instance().set("lastPatchInterchangePath", lastPathForPIF_);
-		}
-	});
+	updateLastPath();
+	FileChooser pifChooser("Please enter the name of the Patch Interchange Format file to create...", File(lastPathForPIF_), "*.json");
+	if (!pifChooser.browseForFileToSave(true))
+		return;
+	lastPathForPIF_ = pifChooser.getResult().getFullPathName().toStdString();
+	Settings::instance().set("lastPatchInterchangePath", lastPathForPIF_);
+
+	StreamingPIFExport pifExport(pifChooser.getResult(), database_, currentFilter());
+	pifExport.runThread();
+	if (!pifExport.error().empty()) {
+		AlertWindow::showMessageBox(AlertWindow::WarningIcon, "Error creating patch interchange file", pifExport.error());
+	}
 }
 
 void PatchView::mergeNewPatches(std::vector<midikraft::PatchHolder> patchesLoaded) {
 	MergeManyPatchFiles backgroundThread(database_, patchesLoaded, [this](std::vector<midikraft::PatchHolder> outNewPatches) {
 		// Back to UI thread
 		MessageManager::callAsync([this, outNewPatches]() {
-			if (outNewPatches.size() > 0) {
-				patchListTree_.refreshAllImports();
-				// Select this import
-				auto info = outNewPatches[0].sourceInfo(); //TODO this will break should I change the logic in the PatchDatabase, this is a mere convention
-				if (info) {
-					auto name = UIModel::currentSynth()->getName();
-					if (midikraft::SourceInfo::isEditBufferImport(info)) {
-						patchListTree_.selectItemByPath({ "allpatches", "library-" + name, "imports-" + name, "EditBufferImport" });
-					}
-					else {
-						patchListTree_.selectItemByPath({ "allpatches", "library-" + name, "imports-" + name, info->md5(UIModel::currentSynth())});
-					}
-				}
-			}
+			showMergedPatches(outNewPatches);
 		});
 	});
 	backgroundThread.runThread();
 }
 
+void PatchView::showMergedPatches(std::vector<midikraft::PatchHolder> const &outNewPatches)
+{
+	static auto &patchesImported = Metrics::instance().counter("patches.imported");
+	patchesImported.add(outNewPatches.size());
+	if (outNewPatches.size() > 0) {
+		// Not all new patches need to pass the current filter, so a ~ search builds its index again from the filtered query
+		textIndexGeneration_++;
+		textIndexValid_ = false;
+	}
+	// Only extend synths already indexed, the others are indexed completely on first use
+	std::vector<midikraft::PatchHolder> forSimilarity;
+	std::copy_if(outNewPatches.begin(), outNewPatches.end(), std::back_inserter(forSimilarity), [this](midikraft::PatchHolder const &patch) {
+		return patch.synth() && similarityIndex_.hasSynth(patch.synth()->getName());
+	});
+	similarityIndex_.add(forSimilarity);
+	if (outNewPatches.size() > 0) {
+		patchListTree_.refreshAllImports();
+		// Select this import
+		auto info = outNewPatches[0].sourceInfo(); //TODO this will break should I change the logic in the PatchDatabase, this is a mere convention
+		if (info) {
+			auto name = UIModel::currentSynth()->getName();
+			if (midikraft::SourceInfo::isEditBufferImport(info)) {
+				patchListTree_.selectItemByPath({ "allpatches", "library-" + name, "imports-" + name, "EditBufferImport" });
+			}
+			else {
+				patchListTree_.selectItemByPath({ "allpatches", "library-" + name, "imports-" + name, info->md5(UIModel::currentSynth())});
+			}
+		}
+	}
+}
+
 void PatchView::selectPatch(midikraft::PatchHolder &patch, bool alsoSendToSynth)
 {
 	auto layers = midikraft::Capability::hasCapability<midikraft::LayeredPatchCapability>(patch.patch());
@@ -873,41 +2269,25 @@ void PatchView::selectPatch(midikraft::PatchHolder &patch, bool alsoSendToSynth)
 
 		UIModel::instance()->currentPatch_.changeCurrentPatch(patch);
 		currentLayer_ = 0;
+		schedulePrepareNeighbours();
 
-		if (alsoSendToSynth) {
-			auto alreadyInSynth = database_.getBankPositions(patch.smartSynth(), patch.md5());
-			for (auto inSynth : alreadyInSynth) {
-				if (inSynth.bank().isValid()) {
-					spdlog::debug("Patch is already in synth in bank {} at position {}", inSynth.bank().toZeroBased(), inSynth.toZeroBasedDiscardingBank());
-				}
-				else
-				{
-					spdlog::debug("Patch is already in synth in unknown bank at position {}", inSynth.toZeroBasedDiscardingBank());
-				}
-			}
+		if (alsoSendToSynth && !sentPreparedMd5_.empty() && sentPreparedMd5_ == patch.md5()) {
+			// A macro already sent the prepared patch
+			sentPreparedMd5_.clear();
+			spdlog::info("Sent prepared patch {} to {}", patch.name(), patch.synth()->getName());
+		}
+		else if (alsoSendToSynth) {
+			std::vector<MidiMessage> selectPatch;
+			auto program = MidiProgramNumber::fromZeroBase(0);
 			auto midiLocation = midikraft::Capability::hasCapability<midikraft::MidiLocationCapability>(patch.smartSynth());
-			if (midiLocation && midiLocation->channel().isValid() && alreadyInSynth.size() > 0) {
-				auto bankNumberToSelect = patch.bankNumber();
-				if (alreadyInSynth[0].isBankKnown()) {
-					bankNumberToSelect = alreadyInSynth[0].bank();
-				}
+			if (residentProgramChange(patch, selectPatch, program)) {
 				// We can get away with just a bank select and program change
-				std::vector<juce::MidiMessage> selectPatch;
-				if (auto bankDescriptors = midikraft::Capability::hasCapability<midikraft::HasBankDescriptorsCapability>(patch.smartSynth())) {
-					auto bankSelect = bankDescriptors->bankSelectMessages(bankNumberToSelect);
-					std::copy(bankSelect.cbegin(), bankSelect.cend(), std::back_inserter(selectPatch));
-				}
-				else if (auto banks = midikraft::Capability::hasCapability<midikraft::HasBanksCapability>(patch.smartSynth())) {
-					auto bankSelect = banks->bankSelectMessages(bankNumberToSelect);
-					std::copy(bankSelect.cbegin(), bankSelect.cend(), std::back_inserter(selectPatch));
-				}
-				selectPatch.push_back(MidiMessage::programChange(midiLocation->channel().toOneBasedInt(), alreadyInSynth[0].toZeroBasedDiscardingBank()));
 				patch.smartSynth()->sendBlockOfMessagesToSynth(midiLocation->midiOutput(), selectPatch);
-				spdlog::info("Sending program change to {}: program {} {}. {}"
+				deltaSend_.forget(patch.smartSynth());
+				spdlog::info("Sending program change to {}: program {} {}"
 					, patch.smartSynth()->getName()
-					, patch.smartSynth()->friendlyProgramAndBankName(bankNumberToSelect, alreadyInSynth[0])
-					, alreadyInSynth[0].isBankKnown() ? "[known bank]" : "[bank not known!]"
-					, alreadyInSynth.size() > 1 ? fmt::format("Patch is in {} different positions.", alreadyInSynth.size()): "");
+					, patch.smartSynth()->friendlyProgramAndBankName(program.isBankKnown() ? program.bank() : patch.bankNumber(), program)
+					, program.isBankKnown() ? "[known bank]" : "[bank not known!]");
 			}
 			else {
 				// Send out to Synth into edit buffer
@@ -915,7 +2295,20 @@ void PatchView::selectPatch(midikraft::PatchHolder &patch, bool alsoSendToSynth)
 					auto patchName = patch.name();
 					string_trim(patchName);
 					spdlog::info("Sending patch {} to {}", patchName, patch.synth()->getName());
-					patch.synth()->sendDataFileToSynth(patch.patch(), nullptr);
+					auto messages = midiLocation ? outgoingSysex_.editBufferMessages(patch) : std::vector<MidiMessage>();
+					std::vector<MidiMessage> delta;
+					bool isPatch = std::dynamic_pointer_cast<midikraft::Patch>(patch.patch()) != nullptr;
+					if (!messages.empty() && isPatch && deltaSend_.deltaMessages(patch, messages, delta)) {
+						spdlog::debug("Sending only the changed parameters, {} messages instead of the edit buffer dump", delta.size());
+						patch.synth()->sendBlockOfMessagesToSynth(midiLocation->midiOutput(), delta);
+					}
+					else if (!messages.empty()) {
+						patch.synth()->sendBlockOfMessagesToSynth(midiLocation->midiOutput(), messages);
+					}
+					else {
+						patch.synth()->sendDataFileToSynth(patch.patch(), nullptr);
+					}
+					deltaSend_.sent(patch);
 				}
 				else {
 					spdlog::info("Empty patch slot selected, can't send to synth");
@@ -27,12 +27,28 @@
 #include "PatchDatabase.h"
 #include "PatchHolder.h"
 #include "AutomaticCategory.h"
+#include "OutgoingSysexCache.h"
+#include "ParameterDeltaSend.h"
 
 #include "ImportFromSynthDialog.h"
 #include "SynthBankPanel.h"
+#include "DatabaseReaders.h"
+#include "DatabaseVersion.h"
+#include "PatchCountCache.h"
+#include "PageSnapshotCache.h"
+#include "ScriptedQuery.h"
+#include "PatchHandleStore.h"
+#include "PatchTextIndex.h"
+#include "PatchSimilarityIndex.h"
+#include "SoundFingerprintIndex.h"
 
 #include <map>
+#include <set>
 
+class BackgroundMergeQueue;
+class DatabaseMaintenance;
+class DatabaseVerifier;
+class MetadataWriteQueue;
 class PatchDiff;
 class PatchSearchComponent;
 
@@ -49,13 +65,24 @@ public:
 	// React on synth or patch changed
 	virtual void changeListenerCallback(ChangeBroadcaster* source) override;
 
-	void retrieveFirstPageFromDatabase();
+	// Pass true if only the search text changed, then the patches indexed for a ~ search are still good
+	void retrieveFirstPageFromDatabase(bool onlyTextChanged = false);
 	std::shared_ptr<midikraft::PatchList> retrieveListFromDatabase(midikraft::ListInfo const& info);
 	void loadSynthBankFromDatabase(std::shared_ptr<midikraft::Synth> synth, MidiBankNumber bank, std::string const& bankId);
 	void retrieveBankFromSynth(std::shared_ptr<midikraft::Synth> synth, MidiBankNumber bank, std::function<void()> finishedHandler);
-	void sendBankToSynth(std::shared_ptr<midikraft::SynthBank> bankToSend, bool ignoreDirty, std::function<void()> finishedHandler);
+	// dirtyFlagsMatchSynth is true for a bank read from the synth, whose dirty positions are the ones edited since. For a user bank
+	// the dirty flags say nothing about the synth, so every position not known to be the same in the synth is sent
+	void sendBankToSynth(std::shared_ptr<midikraft::SynthBank> bankToSend, bool dirtyFlagsMatchSynth, std::function<void()> finishedHandler);
+	// Downloads the bank without storing it and compares it slot by slot with the given one
+	void compareBankWithSynth(std::shared_ptr<midikraft::SynthBank> bank, std::function<void()> compared);
+	// The slots the last comparison found different in the synth, until they are sent or the bank is imported again
+	std::set<int> differencesFromSynth(std::shared_ptr<midikraft::SynthBank> bank) const;
 	void selectPatch(midikraft::PatchHolder& patch, bool alsoSendToSynth);
 
+	// Selecting a patch known to sit unchanged in a slot of the synth sends only bank select and program change, on by default
+	static bool programChangeAudition();
+	static void setProgramChangeAudition(bool enabled);
+
 	// Macro controls triggered by the MidiKeyboard
 	void hideCurrentPatch();
 	void favoriteCurrentPatch();
@@ -65,25 +92,43 @@ public:
 
 	// Protected functions that are potentially dangerous and are only called via the main menu
 	void retrievePatches();
+	void retrieveAllBanksFromAllSynths();
 	void bulkRenamePatches();
 	void receiveManualDump();
 	void deletePatches();
 	void reindexPatches();
+	void repairDatabase();
+	void compactDatabase();
+	void findNearDuplicates();
 	void loadPatches();
+	void loadLargeSysexFile();
 	void exportPatches();
 	void createPatchInterchangeFile();
 	void showPatchDiffDialog();
+	// Live use: the user list currently shown is played by program changes and the next/previous macros
+	void armSetlist();
+	void disarmSetlist();
 
 	// Additional functions for the auto thumbnailer
 	int totalNumberOfPatches();
 	void selectFirstPatch();
+	// All patches matching the current filter, message thread only
+	void loadPatchesOfCurrentFilter(std::function<void(std::vector<midikraft::PatchHolder>)> callback);
 
 	// Hand through from PatchSearch
 	midikraft::PatchFilter currentFilter();
 
+	// Shows the patches of the same synth closest to the given one, until the next filter change
+	void showSimilarPatches(midikraft::PatchHolder const &patch);
+	// Same for the patches of all synths whose prehear recording sounds closest to the one of the given patch
+	void showPatchesSoundingLike(midikraft::PatchHolder const &patch);
+
 	// Special functions
 	void bulkImportPIP(File directory);
 
+	// Favorite, hide, category and name edits are written in the background, call before the database file is switched
+	void flushMetadataEdits();
+
 private:
 	friend class PatchSearchComponent;
 	friend class SimplePatchGrid;
@@ -92,6 +137,14 @@ private:
 
 	int getTotalCount();
 	void loadPage(int skip, int limit, midikraft::PatchFilter const& filter, std::function<void(std::vector<midikraft::PatchHolder>)> callback);
+	// Page loader for the patch grids, this streams through the scripted search when a ! query is active
+	void loadCurrentPage(int skip, int limit, std::function<void(std::vector<midikraft::PatchHolder>)> callback);
+	bool isScriptedQueryActive();
+	bool isTextIndexQueryActive();
+	void loadFromTextIndex(int skip, int limit, std::function<void(std::vector<midikraft::PatchHolder>)> callback);
+	void showSimilarResult();
+	void showSoundsLikeResult();
+	void displaySimilarPatches();
 
 	// New for bank management
 	midikraft::PatchFilter bankFilter(std::shared_ptr<midikraft::Synth> synth, std::string const& listID);
@@ -101,16 +154,51 @@ private:
 	void updateLastPath();
 
 	void mergeNewPatches(std::vector<midikraft::PatchHolder> patchesLoaded);
+	void showMergedPatches(std::vector<midikraft::PatchHolder> const &outNewPatches);
+	// Sends only the programs differing from the last known synth state, returns false if the whole bank should go instead,
+	// because the synth can only receive full banks or the TransferStrategy measured that to be faster
+	bool sendChangedProgramsOnly(std::shared_ptr<midikraft::SynthBank> bankToSend, bool dirtyFlagsMatchSynth, std::function<void()> finishedHandler);
+	// For ROM banks downloaded before or shipped with the adaptation, true if stored is called without a transfer
+	bool fillRomBankFromCache(std::shared_ptr<midikraft::Synth> synth, MidiBankNumber bank, std::function<void()> stored);
+	// Merges the patches in the background, then stores them as the bank's list
+	void storeRetrievedBank(std::shared_ptr<midikraft::Synth> synth, MidiBankNumber bank, std::vector<midikraft::PatchHolder> const &patchesLoaded, std::function<void()> stored);
+	// Downloads the banks one after the other, handing each to bankLoaded on the message thread as soon as it is complete
+	void downloadBanksPipelined(std::shared_ptr<midikraft::Synth> synth, std::vector<MidiBankNumber> banks, std::function<void(MidiBankNumber, std::vector<midikraft::PatchHolder>)> bankLoaded);
 	
 	void saveCurrentPatchCategories();
+	// The edits of the metadata queue are in the database, the filter might now show other patches
+	void refreshAfterMetadataWrite();
+	// Empties the text and similarity indexes and the patches they held. The similarity index is built again on its next use
+	void releaseIndexes();
+	// The batch actions offered for the patches marked in the grid
+	void showMarkedPatchesMenu(std::vector<midikraft::PatchHolder> const &marked);
+	void editPatches(std::vector<midikraft::PatchHolder> patches, std::function<void(midikraft::PatchHolder &)> edit);
 	void setSynthBankFilter(std::shared_ptr<midikraft::Synth> synth, MidiBankNumber bank);
 	void setUserBankFilter(std::shared_ptr<midikraft::Synth> synth, std::string const& listId);
 	void setImportListFilter(String filter);
 	void setUserListFilter(String filter);
 	void deleteSomething(nlohmann::json const &infos);
+	// Shows one page of the filter result for renaming, then offers the next one
+	void bulkRenamePage(midikraft::PatchFilter const &filter, int skip, int total);
+	static constexpr int kBulkRenamePageSize = 512;
 
 	void showBank();
 
+	// Live performance: the patches before and after the current one are kept ready to send, so the next/previous macros only
+	// send bytes instead of querying the bank positions and converting the patch at the key press
+	struct PreparedSwitch {
+		std::string md5;
+		std::shared_ptr<midikraft::Synth> synth;
+		juce::MidiDeviceInfo output;
+		std::vector<MidiMessage> messages;
+	};
+	void switchToNeighbour(int direction);
+	void schedulePrepareNeighbours();
+	void prepareNeighbours();
+	bool prepareSwitch(midikraft::PatchHolder &patch, PreparedSwitch &outSwitch);
+	// The messages selecting the patch in a synth slot holding it, false if there is none or the audition mode is off
+	bool residentProgramChange(midikraft::PatchHolder const &patch, std::vector<MidiMessage> &outMessages, MidiProgramNumber &outProgram);
+
 	PatchListTree patchListTree_;
 	std::string sourceFilterID_; // This is the old "import" combo box in new
 	std::string listFilterID_;
@@ -121,20 +209,48 @@ private:
 
 	Label patchLabel_;
 	std::unique_ptr<PatchSearchComponent> patchSearch_;
+	OutgoingSysexCache outgoingSysex_; // Warmed by the patch buttons, so declared before them
 	std::unique_ptr<PatchButtonPanel> patchButtons_;
 	std::unique_ptr<CurrentPatchDisplay> currentPatchDisplay_;
 	std::unique_ptr<SynthBankPanel> synthBank_;
 	std::unique_ptr<ImportFromSynthDialog> importDialog_;
 	std::unique_ptr<PatchDiff> diffDialog_;
+	std::unique_ptr<BackgroundMergeQueue> mergeQueue_; // Stores downloaded banks while the next one is retrieved
+	std::unique_ptr<MetadataWriteQueue> metadataQueue_; // Stores the edits of the current patch display shortly after the click
+	std::unique_ptr<DatabaseVerifier> verifier_; // Looks for broken patches and list entries while the app is idle
+	std::unique_ptr<DatabaseMaintenance> maintenance_; // Statistics and incremental vacuum while the app is idle
+	std::map<std::string, std::set<int>> synthDifferences_; // By the id of the synth bank, filled by compareBankWithSynth
 
 	midikraft::Librarian librarian_;
+	ScriptedQuery scriptedQuery_; // Keeps the compiled predicate while paging
+	ScriptedSearch scriptedSearch_;
+	PatchHandleStore patchStore_; // The patches held by the text and similarity indexes, each only once
+	PatchTextIndex textIndex_; // Patches of the current filter for ~ searches, built on first use
+	bool textIndexValid_;
+	int textIndexGeneration_;
+	PatchSimilarityIndex similarityIndex_; // Built per synth on first use
+	SoundFingerprintIndex soundIndex_; // Brought up to date with the prehear recordings on every use
+	bool similarityQueryActive_ = false;
+	midikraft::PatchHolder similarTo_;
+	std::vector<midikraft::PatchHolder> similarPatches_;
+	static constexpr size_t kNumberOfSimilarPatches = 64;
 
 	std::vector<midikraft::SynthHolder> synths_;
 	int currentLayer_;
+	int filterGeneration_; // Incremented with every new filter, to recognize outdated page results
 
 	midikraft::PatchHolder compareTarget_;
+	std::unique_ptr<PreparedSwitch> preparedNext_;
+	std::unique_ptr<PreparedSwitch> preparedPrevious_;
+	std::string sentPreparedMd5_; // Set while a prepared switch is selected, so selectPatch does not send again
+	ParameterDeltaSend deltaSend_; // Knows what went into the edit buffers last
+	bool preparePending_ = false;
 
 	midikraft::PatchDatabase &database_;
+	DatabaseReaders readers_; // Page loads and counts go here, so they don't wait for imports on database_
+	DatabaseVersion databaseVersion_;
+	PatchCountCache counts_; // The grid asks for the count of the same filter with every page
+	PageSnapshotCache pages_; // Flipping back to a list or import just shown needs no query
 	
 	std::string lastPathForPIF_;
 
@@ -9,9 +9,14 @@
 #include "MidiController.h"
 
 #include "Capability.h"
+#include "DataFileLoadCapability.h"
 
-ReceiveManualDumpWindow::ReceiveManualDumpWindow(std::shared_ptr<midikraft::Synth> synth) : 
+#include <fmt/format.h>
+
+ReceiveManualDumpWindow::ReceiveManualDumpWindow(std::shared_ptr<midikraft::Synth> synth, TDecoder decoder, TPatchHandler onPatches) :
 	ThreadWithProgressWindow("Waiting for sysex messages from " + synth->getName() +"...", false, true, 1000, "Stop"), synth_(synth)
+	, decoder_(decoder), onPatches_(onPatches),
+	reassembler_([this](uint8 const *data, size_t size) { arrived(data, size); }, [this](MidiMessage const &message) { arrived(message.getRawData(), (size_t) message.getRawDataSize()); })
 {
 	// Create a MIDI log view with a decent size
 	midiLog_ = std::make_unique<MidiLogView>(false, true);
@@ -23,6 +28,8 @@ ReceiveManualDumpWindow::ReceiveManualDumpWindow(std::shared_ptr<midikraft::Synt
 
 void ReceiveManualDumpWindow::run()
 {
+	importSource_ = std::make_shared<midikraft::FromSynthSource>(Time::getCurrentTime());
+
 	// Determine which MIDI port to listen to
 	auto locationCap = midikraft::Capability::hasCapability<midikraft::MidiLocationCapability>(synth_);
 	
@@ -30,19 +37,119 @@ void ReceiveManualDumpWindow::run()
 	midikraft::MidiController::instance()->addMessageHandler(incomingHandler, [this, locationCap](MidiInput *source, MidiMessage const &received) {
 		// Just capture all messages incoming from the devices' input port. That might be too many...
 		if (!locationCap || locationCap->midiInput().name == source->getName()) {
-			midiLog_->addMessageToList(received, source->getName(), false);
-			receivedMessages_.push_back(received);
+			if (messagesReceived_++ < kMessagesLogged) {
+				midiLog_->addMessageToList(received, source->getName(), false);
+			}
+			reassembler_.push(received);
 		}
 	});
 
-	do {
-	} while (!threadShouldExit());
+	uint32 lastMessage = Time::getMillisecondCounter();
+	size_t undecoded = 0; // Messages arrived since the last decode
+	while (!threadShouldExit()) {
+		messageArrived_.wait(kQuietMs / 4);
+		size_t arrived;
+		{
+			ScopedLock lock(pendingLock_);
+			arrived = pending_.size();
+			unprocessed_.takeAll(pending_);
+		}
+		if (arrived > 0) {
+			lastMessage = Time::getMillisecondCounter();
+			undecoded += arrived;
+		}
+		if (undecoded >= kMessagesPerChunk || (undecoded > 0 && Time::getMillisecondCounter() - lastMessage > (uint32) kQuietMs)) {
+			decode();
+			undecoded = 0;
+		}
+		setStatusMessage(statusText());
+	}
 	// Don't forget to unregister!
 	midikraft::MidiController::instance()->removeMessageHandler(incomingHandler);
 	incomingHandler = midikraft::MidiController::makeNoneHandle();
+
+	// The handler is gone, what has arrived until now is all there is
+	{
+		ScopedLock lock(pendingLock_);
+		unprocessed_.takeAll(pending_);
+	}
+	if (!unprocessed_.empty()) {
+		decode();
+	}
+}
+
+void ReceiveManualDumpWindow::decode()
+{
+	// The decoders take MidiMessages, so the chunk is turned into those only now, on this thread
+	auto messages = unprocessed_.messages();
+	auto patches = decoder_ ? decoder_(messages) : std::vector<midikraft::PatchHolder>();
+	std::vector<midikraft::PatchHolder> newPatches;
+	for (auto &patch : patches) {
+		if (seen_.insert(patch.md5()).second) {
+			patch.setSourceInfo(importSource_);
+			countPerType_[patch.patch() ? patch.patch()->dataTypeID() : 0]++;
+			newPatches.push_back(patch);
+		}
+	}
+	if (!newPatches.empty() && onPatches_) {
+		onPatches_(newPatches);
+	}
+
+	// Keep the messages after the last complete patch, they might be the beginning of a dump continued in the next chunk,
+	// or the synth paused in the middle of one
+	if (!patches.empty()) {
+		unprocessed_.dropFront(completedPrefix(messages, patches.size()));
+	}
+	if (unprocessed_.size() > kMaxCarriedMessages) {
+		unprocessed_.dropFront(unprocessed_.size() - kMaxCarriedMessages);
+	}
+}
+
+size_t ReceiveManualDumpWindow::completedPrefix(std::vector<MidiMessage> const &messages, size_t patchCount) const
+{
+	// Decoding a longer prefix never finds fewer patches, so search for the shortest one finding all of them
+	size_t low = 1;
+	size_t high = messages.size();
+	while (low < high) {
+		size_t middle = low + (high - low) / 2;
+		std::vector<MidiMessage> prefix(messages.begin(), messages.begin() + (std::ptrdiff_t) middle);
+		if (decoder_(prefix).size() >= patchCount) {
+			high = middle;
+		}
+		else {
+			low = middle + 1;
+		}
+	}
+	return high;
+}
+
+void ReceiveManualDumpWindow::arrived(uint8 const *data, size_t size)
+{
+	{
+		ScopedLock lock(pendingLock_);
+		pending_.append(data, size);
+	}
+	messageArrived_.signal();
+}
+
+String ReceiveManualDumpWindow::statusText() const
+{
+	if (countPerType_.empty()) {
+		return fmt::format("Received {} messages, no patch found yet", messagesReceived_.load());
+	}
+	auto dataFileCap = midikraft::Capability::hasCapability<midikraft::DataFileLoadCapability>(synth_);
+	StringArray counts;
+	for (auto const &count : countPerType_) {
+		std::string typeName = "Patch";
+		if (dataFileCap && count.first >= 0 && count.first < (int) dataFileCap->dataTypeNames().size()) {
+			typeName = dataFileCap->dataTypeNames()[(size_t) count.first].name;
+		}
+		counts.add(fmt::format("{} {}", count.second, typeName));
+	}
+	return fmt::format("Received {} messages, found ", messagesReceived_.load()) + counts.joinIntoString(", ");
 }
 
-std::vector<juce::MidiMessage> ReceiveManualDumpWindow::result() const
+size_t ReceiveManualDumpWindow::patchesFound() const
 {
-	return receivedMessages_;
+	return seen_.size();
 }
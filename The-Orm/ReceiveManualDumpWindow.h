@@ -9,22 +9,58 @@
 #include "JuceHeader.h"
 
 #include "Synth.h"
+#include "PatchHolder.h"
 #include "MidiLogView.h"
+#include "SysexArena.h"
+#include "SysexReassembler.h"
 
+#include <atomic>
+#include <functional>
+#include <map>
+#include <set>
 
+// Captures a dump triggered by the user on the synth. The messages are decoded on the window's thread while they arrive, and the
+// patches found are handed on right away, so neither the messages nor the patches of a long capture pile up in memory.
+// Messages after the last complete patch of a chunk are carried into the next one, and all patches of the capture share one
+// import. The window shows how many patches of each data type have been found so far.
 class ReceiveManualDumpWindow : public ThreadWithProgressWindow {
 public:
-	ReceiveManualDumpWindow(std::shared_ptr<midikraft::Synth> synth);
+	// Turns the messages of a chunk into patches, called on the window's thread
+	typedef std::function<std::vector<midikraft::PatchHolder>(std::vector<MidiMessage> const &)> TDecoder;
+	// Gets each patch only once, called on the window's thread
+	typedef std::function<void(std::vector<midikraft::PatchHolder> const &)> TPatchHandler;
+
+	ReceiveManualDumpWindow(std::shared_ptr<midikraft::Synth> synth, TDecoder decoder, TPatchHandler onPatches);
 
 	virtual void run() override;
 
-	std::vector<MidiMessage> result() const;
+	size_t patchesFound() const;
 
 private:
+	void arrived(uint8 const *data, size_t size);
+	void decode();
+	// The number of messages at the front it took the decoder to find patchCount patches, the rest belongs to unfinished dumps
+	size_t completedPrefix(std::vector<MidiMessage> const &messages, size_t patchCount) const;
+	String statusText() const;
+
+	static constexpr size_t kMessagesPerChunk = 1024;
+	static constexpr size_t kMaxCarriedMessages = 16 * kMessagesPerChunk; // Above this, what doesn't decode is not a dump in progress
+	static constexpr int kQuietMs = 1000; // No messages for this long, the synth has sent everything it was asked for
+	static constexpr size_t kMessagesLogged = 500; // The log keeps every message, so it only shows the beginning of long captures
+
 	std::shared_ptr<midikraft::Synth> synth_;
+	TDecoder decoder_;
+	TPatchHandler onPatches_;
 	std::unique_ptr<MidiLogView> midiLog_;
 
-	std::vector<MidiMessage> receivedMessages_;
-};
-
+	CriticalSection pendingLock_;
+	SysexArena pending_; // Filled by the MIDI thread, which does not allocate anymore once the arena has grown to the largest burst
+	SysexReassembler reassembler_; // MIDI thread only, some interfaces deliver long dumps in pieces
+	WaitableEvent messageArrived_;
+	std::atomic<size_t> messagesReceived_ { 0 };
 
+	SysexArena unprocessed_;
+	std::shared_ptr<midikraft::SourceInfo> importSource_; // One for the whole capture, else each chunk would become an import of its own
+	std::set<std::string> seen_; // md5s handed on, the synth might send the same patch twice
+	std::map<int, size_t> countPerType_;
+};
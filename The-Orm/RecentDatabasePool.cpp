@@ -0,0 +1,110 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "RecentDatabasePool.h"
+
+#include <spdlog/spdlog.h>
+#include "SpdLogJuce.h"
+
+#include <algorithm>
+
+RecentDatabasePool::RecentDatabasePool(TSynthSource synths, size_t maxDatabases, int pageSize) : synths_(std::move(synths)), maxDatabases_(std::max(maxDatabases, (size_t) 1)), pageSize_(pageSize)
+{
+	startTimer(kValidationIntervalMs);
+}
+
+RecentDatabasePool::~RecentDatabasePool()
+{
+	stopTimer();
+	pool_.removeAllJobs(true, 10000);
+}
+
+void RecentDatabasePool::warm(File const &database)
+{
+	if (!database.existsAsFile()) {
+		return;
+	}
+	{
+		ScopedLock lock(lock_);
+		auto found = std::find_if(entries_.begin(), entries_.end(), [&database](std::shared_ptr<Entry> const &entry) { return entry->file == database; });
+		if (found != entries_.end()) {
+			// Already pooled, only move it to the front
+			auto entry = *found;
+			entries_.erase(found);
+			entries_.insert(entries_.begin(), entry);
+			return;
+		}
+		auto entry = std::make_shared<Entry>();
+		entry->file = database;
+		entries_.insert(entries_.begin(), entry);
+		if (entries_.size() > maxDatabases_) {
+			// A warming still running for it finds no entry when done
+			entries_.pop_back();
+		}
+	}
+	startWarming(database);
+}
+
+void RecentDatabasePool::forget(File const &database)
+{
+	ScopedLock lock(lock_);
+	entries_.erase(std::remove_if(entries_.begin(), entries_.end(), [&database](std::shared_ptr<Entry> const &entry) {
+		return entry->file == database;
+	}), entries_.end());
+}
+
+void RecentDatabasePool::timerCallback()
+{
+	// A pooled file might have been changed by another instance of the Orm, or replaced from a backup
+	std::vector<File> changed;
+	{
+		ScopedLock lock(lock_);
+		for (auto const &entry : entries_) {
+			if (!entry->warming && entry->file.getLastModificationTime() != entry->modified) {
+				changed.push_back(entry->file);
+			}
+		}
+	}
+	for (auto const &file : changed) {
+		startWarming(file);
+	}
+}
+
+void RecentDatabasePool::startWarming(File const &database)
+{
+	{
+		ScopedLock lock(lock_);
+		for (auto const &entry : entries_) {
+			if (entry->file == database) {
+				entry->warming = true;
+			}
+		}
+	}
+	// The synths are looked up on the message thread, the queries then run on the pool's thread
+	auto synths = synths_();
+	pool_.addJob([this, database, synths]() {
+		Time modified = database.getLastModificationTime();
+		try {
+			midikraft::PatchDatabase connection(database.getFullPathName().toStdString(), midikraft::PatchDatabase::OpenMode::READ_ONLY);
+			connection.getCategories();
+			midikraft::PatchFilter filter(synths);
+			connection.getPatchesCount(filter);
+			connection.getPatches(filter, 0, pageSize_);
+		}
+		catch (std::exception &e) {
+			spdlog::warn("Could not prepare recent database {}: {}", database.getFullPathName(), e.what());
+		}
+
+		ScopedLock lock(lock_);
+		for (auto const &entry : entries_) {
+			if (entry->file == database) {
+				entry->modified = modified;
+				entry->warming = false;
+				break;
+			}
+		}
+	});
+}
@@ -0,0 +1,52 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include "PatchDatabase.h"
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Runs the queries the UI needs after a switch on the most recently used database files in the background, on a short lived
+// read-only connection: the categories, the patch count, and the first page. Switching to one of these files then finds the
+// file in the caches. The files are checked periodically, and a file modified since it was warmed is warmed again.
+// The SQLite connections serving the open database are the DatabaseReaders, this pool only warms the files
+class RecentDatabasePool : private Timer {
+public:
+	typedef std::function<std::vector<std::shared_ptr<midikraft::Synth>>()> TSynthSource;
+
+	explicit RecentDatabasePool(TSynthSource synths, size_t maxDatabases = 3, int pageSize = 100);
+	~RecentDatabasePool() override;
+
+	// Warms the file, making it the most recent one. The least recently used file is dropped if the pool is full
+	void warm(File const &database);
+	// Stops keeping the file warm, e.g. because it is now the one opened for writing
+	void forget(File const &database);
+
+private:
+	struct Entry {
+		File file;
+		Time modified; // The time the file had when it was warmed last
+		bool warming = false;
+	};
+
+	void timerCallback() override;
+	void startWarming(File const &database);
+
+	static constexpr int kValidationIntervalMs = 30000;
+
+	TSynthSource synths_;
+	size_t maxDatabases_;
+	int pageSize_;
+	CriticalSection lock_;
+	std::vector<std::shared_ptr<Entry>> entries_; // Most recent first
+	ThreadPool pool_{ 1 }; // Declared last so the running job finishes before the entries go away
+};
@@ -16,10 +16,9 @@
 #include "SpdLogJuce.h"
 
 RecordingView::RecordingView(PatchView &patchView) :
-    patchView_(patchView)
-    , deviceSelector_(deviceManager_, 1, 2, 1, 1, false, false, true, false)
-    , recorder_(File::getCurrentWorkingDirectory(), "knobkraft-audio-log", RecordingType::WAV)
-    , midiSender_(48000)
+    Thread("SampleNoteWriter")
+    , patchView_(patchView)
+    , deviceSelector_(deviceManager_, 1, kMaxInputChannels, 1, 1, false, false, true, false)
     , buttons_(1111, LambdaButtonStrip::Direction::Horizontal)
 {
 	addAndMakeVisible(deviceSelector_);
@@ -38,6 +37,7 @@ RecordingView::RecordingView(PatchView &patchView) :
 	if (!audioError.isEmpty()) {
 		spdlog::error("Error initializing audio device manager: {}", audioError);
 	}
+	startThread();
 	deviceManager_.addAudioCallback(&recorder_);
 
 	addAndMakeVisible(thumbnail_);
@@ -61,6 +61,7 @@ RecordingView::~RecordingView()
 {
 	thumbnail_.removeChangeListener(this);
 	stopAudio();
+	stopThread(1000);
 
 	// Save the selected Audio device for the next startup
 	auto xml = deviceManager_.createStateXml();
@@ -90,34 +91,94 @@ void RecordingView::sampleNote() {
 
 	auto patchMD5 = UIModel::currentPatch().md5();
 
-	std::string filename = UIModel::getPrehearDirectory().getChildFile(patchMD5 + ".wav").getFullPathName().toStdString();
-
 	// Ok, what we'll do is to 
-	// a) start the recorder to listen for audio coming in
+	// a) arm the recorder to start with the onset of the note and stop with its release
 	// b) send a MIDI note to the current synth
-	// register a callback that the recorder will call when the signal is done, and then refresh the Thumbnail
-	recorder_.startRecording(filename ,true, [this]() {
-		String recorder_filename = recorder_.getFilename();
-		thumbnail_.loadFromFile(recorder_filename.toStdString(), "");
-		UIModel::instance()->thumbnails_.sendChangeMessage();
-	});
+	// The writer thread then stores the file and refreshes the Thumbnail. A channel still armed never heard the last note, it simply
+	// records this one instead
+	if (recorder_.state(0) != ParallelThumbnailRecorder::State::Armed && !recorder_.arm(0, kMaxSampleSeconds)) {
+		spdlog::warn("Can't record the sample note, the audio input is not running or still busy with the last note");
+		return;
+	}
+	{
+		ScopedLock lock(lock_);
+		sampleFile_ = UIModel::getPrehearDirectory().getChildFile(patchMD5 + ".wav");
+	}
 
 	auto device = std::dynamic_pointer_cast<midikraft::DiscoverableDevice>(UIModel::instance()->currentSynth_.smartSynth());
 	if (device->wasDetected()) {
-		auto location = midikraft::Capability::hasCapability<midikraft::MidiLocationCapability>(UIModel::instance()->currentSynth_.smartSynth());
-		auto noteNumber = MidiNote(440.0).noteNumber();
-		if (location) {
-			auto noteOn = MidiMessage::noteOn(location->channel().toOneBasedInt(), noteNumber, (uint8)127);
-			auto noteOff = MidiMessage::noteOff(location->channel().toOneBasedInt(), noteNumber);
-			midiSender_.addMessageToBuffer(location->midiOutput(), noteOn, 0.0);
-			midiSender_.addMessageToBuffer(location->midiOutput(), noteOff, 0.5);
-		}
+		sendSampleNote(UIModel::instance()->currentSynth_.smartSynth());
 	}
 }
 
+bool RecordingView::sendSampleNote(std::shared_ptr<midikraft::Synth> synth)
+{
+	auto location = midikraft::Capability::hasCapability<midikraft::MidiLocationCapability>(synth);
+	if (!location) {
+		return false;
+	}
+	auto noteNumber = MidiNote(440.0).noteNumber();
+	auto noteOn = MidiMessage::noteOn(location->channel().toOneBasedInt(), noteNumber, (uint8)127);
+	auto noteOff = MidiMessage::noteOff(location->channel().toOneBasedInt(), noteNumber);
+	auto &sender = midiSenders_[location->midiOutput().identifier];
+	if (!sender) {
+		sender = MidiOutputScheduler::forOutput(location->midiOutput()).createProducer(MidiOutputScheduler::Lane::Realtime, 16);
+	}
+	auto now = Time::getMillisecondCounterHiRes();
+	if (!sender->enqueue(noteOn, now) || !sender->enqueue(noteOff, now + 500.0)) {
+		spdlog::warn("MIDI output queue full, could not play the sample note");
+		return false;
+	}
+	return true;
+}
+
+void RecordingView::addAudioCallback(AudioIODeviceCallback *callback)
+{
+	deviceManager_.addAudioCallback(callback);
+}
+
+void RecordingView::removeAudioCallback(AudioIODeviceCallback *callback)
+{
+	deviceManager_.removeAudioCallback(callback);
+}
+
 bool RecordingView::hasDetectedSignal() const
 {
-	return recorder_.hasDetectedSignal();
+	auto state = recorder_.state(0);
+	return state == ParallelThumbnailRecorder::State::Recording || state == ParallelThumbnailRecorder::State::Done;
+}
+
+void RecordingView::run()
+{
+	while (!threadShouldExit()) {
+		wait(kPollMs);
+		int channel;
+		bool released = false;
+		while (recorder_.nextStateChange(channel)) {
+			released = released || (channel == 0 && recorder_.state(0) == ParallelThumbnailRecorder::State::Done);
+		}
+		if (!released || threadShouldExit()) {
+			continue;
+		}
+		File file;
+		{
+			ScopedLock lock(lock_);
+			file = sampleFile_;
+		}
+		if (recorder_.truncated(0)) {
+			spdlog::warn("The sample note did not end within {} seconds, keeping only that", kMaxSampleSeconds);
+		}
+		if (!recorder_.writeWav(0, file)) {
+			spdlog::error("Could not write the sample note to {}", file.getFullPathName().toStdString());
+			continue;
+		}
+		MessageManager::callAsync([safeThis = Component::SafePointer<RecordingView>(this), file]() {
+			if (safeThis) {
+				safeThis->thumbnail_.loadFromFile(file.getFullPathName().toStdString(), "");
+				UIModel::instance()->thumbnails_.sendChangeMessage();
+			}
+		});
+	}
 }
 
 void RecordingView::changeListenerCallback(ChangeBroadcaster* source)
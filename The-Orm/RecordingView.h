@@ -8,15 +8,18 @@
 
 #include "JuceHeader.h"
 
-#include "AudioRecorder.h"
+#include "ParallelThumbnailRecorder.h"
 #include "Thumbnail.h"
-#include "TimedMidiSender.h"
+#include "MidiOutputScheduler.h"
 
 #include "LambdaButtonStrip.h"
 
 #include "PatchView.h"
 
-class RecordingView : public Component, private ChangeListener {
+#include <map>
+#include <memory>
+
+class RecordingView : public Component, private ChangeListener, private Thread {
 public:
 	RecordingView(PatchView &patchView);
 	~RecordingView() override;
@@ -28,8 +31,20 @@ public:
 	void sampleNote();
 	bool hasDetectedSignal() const;
 
+	// For the auto thumbnailer, which records several synths at once, each on its own input channel
+	void addAudioCallback(AudioIODeviceCallback *callback);
+	void removeAudioCallback(AudioIODeviceCallback *callback);
+	// Plays the sample note on the synth, message thread only. Returns false if the note could not be scheduled
+	bool sendSampleNote(std::shared_ptr<midikraft::Synth> synth);
+
+	static constexpr int kMaxInputChannels = 16;
+	static constexpr double kMaxSampleSeconds = 10.0;
+
 private:
 	void changeListenerCallback(ChangeBroadcaster* source) override;
+	// Writes the sample note once the recorder reports its release, so the file is never touched on the audio thread
+	void run() override;
+	static constexpr int kPollMs = 20;
 
 	PatchView &patchView_;
 
@@ -37,8 +52,10 @@ private:
 	AudioDeviceSelectorComponent deviceSelector_;
 	AudioSourcePlayer audioSource_;
 
-	AudioRecorder recorder_;
-	midikraft::TimedMidiSender midiSender_;
+	ParallelThumbnailRecorder recorder_{ 1 }; // Records the first input channel from the onset to the release of the note
+	CriticalSection lock_;
+	File sampleFile_; // Where the note being recorded goes
+	std::map<String, std::shared_ptr<MidiOutputScheduler::Producer>> midiSenders_; // Per output, only used on the message thread
 
 	LambdaButtonStrip buttons_;
 	Thumbnail thumbnail_;
@@ -0,0 +1,112 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "RomBankCache.h"
+
+#include "Capability.h"
+#include "DetectionCache.h"
+#include "GenericAdaptation.h"
+#include "HasBanksCapability.h"
+#include "Settings.h"
+#include "Sysex.h"
+#include "SynthBank.h"
+
+#include <fmt/format.h>
+#include <spdlog/spdlog.h>
+#include "SpdLogJuce.h"
+
+bool RomBankCache::isRomBank(std::shared_ptr<midikraft::Synth> synth, MidiBankNumber bank)
+{
+	auto descriptors = midikraft::Capability::hasCapability<midikraft::HasBankDescriptorsCapability>(synth);
+	if (!descriptors || !bank.isValid()) {
+		return false;
+	}
+	for (auto const &descriptor : descriptors->bankDescriptors()) {
+		if (descriptor.bank.toZeroBased() == bank.toZeroBased()) {
+			return descriptor.isROM;
+		}
+	}
+	return false;
+}
+
+bool RomBankCache::storedListIsCurrent(std::shared_ptr<midikraft::Synth> synth, MidiBankNumber bank, std::shared_ptr<midikraft::PatchList> stored)
+{
+	if (!stored || !isRomBank(synth, bank)) {
+		return false;
+	}
+	auto expected = Settings::instance().get(settingsKey(synth, bank));
+	auto patches = stored->patches();
+	return !expected.empty() && (int)patches.size() == midikraft::SynthBank::numberOfPatchesInBank(synth, bank.toZeroBased()) && contentFingerprint(patches) == expected;
+}
+
+std::vector<midikraft::PatchHolder> RomBankCache::shippedPatches(std::shared_ptr<midikraft::Synth> synth, MidiBankNumber bank, std::shared_ptr<midikraft::AutomaticCategory> detector)
+{
+	std::vector<midikraft::PatchHolder> result;
+	if (!isRomBank(synth, bank)) {
+		return result;
+	}
+	auto file = knobkraft::GenericAdaptation::getAdaptationDirectory().getChildFile("rom").getChildFile(synth->getName()).getChildFile(fmt::format("bank {}.syx", bank.toOneBased()));
+	if (!file.existsAsFile()) {
+		return result;
+	}
+	midikraft::TPatchVector loaded;
+	try {
+		loaded = synth->loadSysex(Sysex::loadSysex(file.getFullPathName().toStdString()));
+	}
+	catch (std::exception &e) {
+		spdlog::warn("Failed to load the shipped ROM bank {}: {}", file.getFullPathName(), e.what());
+		return result;
+	}
+	if ((int)loaded.size() != midikraft::SynthBank::numberOfPatchesInBank(synth, bank.toZeroBased())) {
+		spdlog::warn("Shipped ROM bank {} has {} patches instead of a full bank, ignoring it", file.getFullPathName(), loaded.size());
+		return result;
+	}
+	int place = 0;
+	for (auto const &dataFile : loaded) {
+		auto source = std::make_shared<midikraft::FromFileSource>(file.getFileName().toStdString(), file.getFullPathName().toStdString(), MidiProgramNumber::fromZeroBaseWithBank(bank, place++));
+		result.emplace_back(synth, source, dataFile, detector);
+	}
+	return result;
+}
+
+void RomBankCache::remember(std::shared_ptr<midikraft::Synth> synth, MidiBankNumber bank, std::vector<midikraft::PatchHolder> const &patches)
+{
+	if (!isRomBank(synth, bank) || (int)patches.size() != midikraft::SynthBank::numberOfPatchesInBank(synth, bank.toZeroBased())) {
+		return;
+	}
+	Settings::instance().set(settingsKey(synth, bank), contentFingerprint(patches));
+}
+
+void RomBankCache::forget(std::shared_ptr<midikraft::Synth> synth)
+{
+	auto descriptors = midikraft::Capability::hasCapability<midikraft::HasBankDescriptorsCapability>(synth);
+	if (!descriptors) {
+		return;
+	}
+	for (auto const &descriptor : descriptors->bankDescriptors()) {
+		if (descriptor.isROM) {
+			Settings::instance().set(settingsKey(synth, descriptor.bank), "");
+		}
+	}
+}
+
+std::string RomBankCache::settingsKey(std::shared_ptr<midikraft::Synth> synth, MidiBankNumber bank)
+{
+	std::string firmware;
+	if (auto device = std::dynamic_pointer_cast<midikraft::SimpleDiscoverableDevice>(synth)) {
+		firmware = DetectionCache::replyFingerprint(*device);
+	}
+	return fmt::format("RomBank {} {} {}", synth->getName(), bank.toZeroBased(), firmware);
+}
+
+std::string RomBankCache::contentFingerprint(std::vector<midikraft::PatchHolder> const &patches)
+{
+	MemoryOutputStream fingerprints;
+	for (auto const &patch : patches) {
+		fingerprints << String(patch.md5());
+	}
+	return MD5(fingerprints.getData(), fingerprints.getDataSize()).toHexString().toStdString();
+}
@@ -0,0 +1,43 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include "AutomaticCategory.h"
+#include "MidiBankNumber.h"
+#include "PatchHolder.h"
+#include "PatchList.h"
+#include "Synth.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+// ROM banks never change, so they need to be downloaded only once per firmware. After a download the fingerprint of the
+// bank's content is remembered under the synth, the bank and the detection reply the synth answered with, which carries
+// the firmware version for most synths. As long as the stored bank list still has that content it is the ROM bank and
+// the download can be skipped. Adaptations can also ship ROM banks as "rom/<synth name>/bank <n>.syx" in the adaptation
+// directory, these are used for ROM banks never downloaded
+class RomBankCache {
+public:
+	static bool isRomBank(std::shared_ptr<midikraft::Synth> synth, MidiBankNumber bank);
+
+	// True if stored is the list of this ROM bank as downloaded with the current firmware
+	static bool storedListIsCurrent(std::shared_ptr<midikraft::Synth> synth, MidiBankNumber bank, std::shared_ptr<midikraft::PatchList> stored);
+	// The shipped content of the ROM bank, empty if there is none or it does not fill the bank
+	static std::vector<midikraft::PatchHolder> shippedPatches(std::shared_ptr<midikraft::Synth> synth, MidiBankNumber bank, std::shared_ptr<midikraft::AutomaticCategory> detector);
+
+	// Call after a complete download of the bank, does nothing for non ROM banks
+	static void remember(std::shared_ptr<midikraft::Synth> synth, MidiBankNumber bank, std::vector<midikraft::PatchHolder> const &patches);
+	// The ROM banks of this synth are downloaded again the next time
+	static void forget(std::shared_ptr<midikraft::Synth> synth);
+
+private:
+	static std::string settingsKey(std::shared_ptr<midikraft::Synth> synth, MidiBankNumber bank);
+	static std::string contentFingerprint(std::vector<midikraft::PatchHolder> const &patches);
+};
@@ -6,57 +6,414 @@
 
 #include "ScriptedQuery.h"
 
+#include "JuceHeader.h"
+
 #include "embedded_module.h"
 #include "PyTschirpPatch.h"
 
+#include "Capability.h"
+#include "DetailedParametersCapability.h"
+#include "LayeredPatchCapability.h"
+
 #include "Logger.h"
 
 #include <pybind11/embed.h>
+#include <pybind11/stl.h>
 #include <spdlog/spdlog.h>
 
+#include <algorithm>
+#include <iterator>
+
 namespace py = pybind11;
 using namespace pybind11::literals;
 
-std::vector<midikraft::PatchHolder> ScriptedQuery::filterByPredicate(std::string const &pythonPredicate, std::vector<midikraft::PatchHolder> const &input) const
+ScriptedQuery::~ScriptedQuery()
+{
+	// The Python objects must not be released without the GIL
+	if (Py_IsInitialized()) {
+		py::gil_scoped_acquire acquire;
+		code_ = py::object();
+		locals_ = py::object();
+	}
+	else {
+		code_.release();
+		locals_.release();
+	}
+}
+
+ScriptedQuery::Evaluation::~Evaluation()
+{
+	if (Py_IsInitialized()) {
+		py::gil_scoped_acquire acquire;
+		code = py::object();
+		locals = py::object();
+	}
+	else {
+		code.release();
+		locals.release();
+	}
+}
+
+bool ScriptedQuery::prepare(std::string const &pythonPredicate, Evaluation &outEvaluation) const
+{
+	if (code_ && compiledPredicate_ == pythonPredicate) {
+		outEvaluation.code = code_;
+		outEvaluation.locals = locals_.attr("copy")();
+		outEvaluation.vectorized = vectorized_;
+		outEvaluation.columnar = columnar_;
+		return true;
+	}
+	try {
+		// Python may hand the GIL to another thread while compiling, so everything is built in the evaluation first
+		outEvaluation.code = py::module::import("builtins").attr("compile")(pythonPredicate, "<scripted query>", "eval");
+		// A predicate mentioning patches or columns is evaluated once over the whole list
+		outEvaluation.vectorized = false;
+		outEvaluation.columnar = false;
+		for (auto name : outEvaluation.code.attr("co_names")) {
+			if (name.cast<std::string>() == "patches") {
+				outEvaluation.vectorized = true;
+			}
+			else if (name.cast<std::string>() == "columns") {
+				outEvaluation.columnar = true;
+			}
+		}
+		// The locals are built from the pytschirpee module once, the calls work on copies
+		auto pytschirpee = py::module::import("pytschirpee");
+		py::object locals = py::dict(**pytschirpee.attr("__dict__"));
+		outEvaluation.locals = locals.attr("copy")();
+		// Now keep it for the next call
+		code_ = outEvaluation.code;
+		locals_ = locals;
+		vectorized_ = outEvaluation.vectorized;
+		columnar_ = outEvaluation.columnar;
+		compiledPredicate_ = pythonPredicate;
+		return true;
+	}
+	catch (py::error_already_set &e) {
+		spdlog::error("Error with scripted query: {}", e.what());
+		return false;
+	}
+}
+
+bool ScriptedQuery::evaluateSingle(Evaluation &evaluation, midikraft::PatchHolder const &patch, bool &outMatches) const
+{
+	// Make sure that we have a PyTschirp object with the name of the synth, once per synth is enough
+	auto synthName = patch.synth()->getName();
+	if (synthsPrepared_.find(synthName) == synthsPrepared_.end()) {
+		findPyTschirpModuleForSynth(synthName);
+		synthsPrepared_.insert(synthName);
+	}
+
+	// Create the patch in question using the PyTschirpPatch class
+	PyTschirp pythonPatch(patch.patch(), patch.smartSynth());
+	evaluation.locals["p"] = py::cast(pythonPatch);
+
+	// Run the query
+	try {
+		auto queryResult = py::reinterpret_steal<py::object>(PyEval_EvalCode(evaluation.code.ptr(), py::globals().ptr(), evaluation.locals.ptr()));
+		if (!queryResult) {
+			throw py::error_already_set();
+		}
+		if (py::isinstance<py::bool_>(queryResult)) {
+			outMatches = queryResult.cast<bool>();
+			return true;
+		}
+		// Abort with an error message
+		spdlog::error("Error with scripted query - expression did not return True or False but {}", (std::string) py::str(queryResult));
+	}
+	catch (py::error_already_set &e) {
+		spdlog::error("Error with scripted query: {}", e.what());
+	}
+	return false;
+}
+
+ScriptedQuery::TColumns ScriptedQuery::decodeColumns(std::vector<midikraft::PatchHolder> const &input)
+{
+	TColumns columns;
+	for (size_t i = 0; i < input.size(); i++) {
+		auto const &patch = input[i];
+		auto parameterDetails = patch.patch() ? midikraft::Capability::hasCapability<midikraft::DetailedParametersCapability>(patch.patch()) : nullptr;
+		if (!parameterDetails) {
+			continue;
+		}
+		bool layered = midikraft::Capability::hasCapability<midikraft::LayeredPatchCapability>(patch.patch()) != nullptr;
+		for (auto param : parameterDetails->allParameterDefinitions()) {
+			if (layered) {
+				// Like the PyTschirp attributes, the columns show the first layer
+				auto multiLayerParam = midikraft::Capability::hasCapability<midikraft::SynthMultiLayerParameterCapability>(param);
+				if (multiLayerParam) {
+					multiLayerParam->setSourceLayer(0);
+				}
+			}
+			auto intParam = midikraft::Capability::hasCapability<midikraft::SynthIntParameterCapability>(param);
+			int value = 0;
+			if (intParam && intParam->valueInPatch(*patch.patch(), value)) {
+				auto &column = columns[param->name()];
+				column.resize(input.size());
+				column[i] = value;
+			}
+		}
+	}
+	return columns;
+}
+
+std::vector<midikraft::PatchHolder> ScriptedQuery::filterVectorized(Evaluation &evaluation, std::vector<midikraft::PatchHolder> const &input, py::object columns, bool *outFailed) const
+{
+	if (evaluation.vectorized) {
+		py::list patches;
+		for (auto const &patch : input) {
+			auto synthName = patch.synth()->getName();
+			if (synthsPrepared_.find(synthName) == synthsPrepared_.end()) {
+				findPyTschirpModuleForSynth(synthName);
+				synthsPrepared_.insert(synthName);
+			}
+			patches.append(py::cast(PyTschirp(patch.patch(), patch.smartSynth())));
+		}
+		evaluation.locals["patches"] = patches;
+	}
+	if (evaluation.columnar) {
+		evaluation.locals["columns"] = columns;
+	}
+	try {
+		auto queryResult = py::reinterpret_steal<py::object>(PyEval_EvalCode(evaluation.code.ptr(), py::globals().ptr(), evaluation.locals.ptr()));
+		if (!queryResult) {
+			throw py::error_already_set();
+		}
+		auto matches = queryResult.cast<std::vector<bool>>();
+		if (matches.size() != input.size()) {
+			spdlog::error("Error with scripted query - expression returned {} values for {} patches", matches.size(), input.size());
+			if (outFailed) *outFailed = true;
+			return input;
+		}
+		std::vector<midikraft::PatchHolder> result;
+		for (size_t i = 0; i < input.size(); i++) {
+			if (matches[i]) {
+				result.push_back(input[i]);
+			}
+		}
+		return result;
+	}
+	catch (py::error_already_set &e) {
+		spdlog::error("Error with scripted query: {}", e.what());
+	}
+	catch (py::cast_error &) {
+		spdlog::error("Error with scripted query - expression using patches did not return a list of True or False");
+	}
+	if (outFailed) *outFailed = true;
+	return input;
+}
+
+std::vector<midikraft::PatchHolder> ScriptedQuery::filterByPredicate(std::string const &pythonPredicate, std::vector<midikraft::PatchHolder> const &input, bool *outFailed) const
 {
 	if (pythonPredicate.empty()) {
 		return input;
 	}
 
+	Evaluation evaluation;
+	bool columnar;
+	{
+		py::gil_scoped_acquire acquire;
+		if (!prepare(pythonPredicate, evaluation)) {
+			if (outFailed) *outFailed = true;
+			return input;
+		}
+		if (evaluation.vectorized && !evaluation.columnar) {
+			return filterVectorized(evaluation, input, py::none(), outFailed);
+		}
+		columnar = evaluation.columnar;
+	}
+	if (columnar) {
+		// Decode the parameters of all patches first, then cross into Python only once for the whole batch. Another thread might
+		// have prepared a different predicate meanwhile, which is why this continues with the evaluation prepared above
+		auto columns = decodeColumns(input);
+		py::gil_scoped_acquire acquire;
+		return filterVectorized(evaluation, input, py::cast(columns), outFailed);
+	}
+
 	std::vector<midikraft::PatchHolder> result;
+	for (size_t chunkStart = 0; chunkStart < input.size(); chunkStart += kChunkSize) {
+		py::gil_scoped_acquire acquire;
+		size_t chunkEnd = std::min(input.size(), chunkStart + kChunkSize);
+		for (size_t i = chunkStart; i < chunkEnd; i++) {
+			bool matches = false;
+			if (!evaluateSingle(evaluation, input[i], matches)) {
+				if (outFailed) *outFailed = true;
+				return input;
+			}
+			if (matches) {
+				result.push_back(input[i]);
+			}
+		}
+	}
+	return result;
+}
 
-	for (const auto& patch : input) {
-		// Make sure that we have a PyTschirp object with the name of the synth
-		std::string pythonClassName = findPyTschirpModuleForSynth(patch.synth()->getName());
+bool ScriptedQuery::usesWholeList(std::string const &pythonPredicate) const
+{
+	if (pythonPredicate.empty()) {
+		return false;
+	}
+	Evaluation evaluation;
+	py::gil_scoped_acquire acquire;
+	return prepare(pythonPredicate, evaluation) && (evaluation.vectorized || evaluation.columnar);
+}
 
-		// Run some python code!
-		auto pytschirpee = py::module::import("pytschirpee");
+ScriptedSearch::ScriptedSearch(TSourceLoader source) : source_(source), failed_(false), wholeList_(false), sourceOffset_(0), exhausted_(true), pulling_(false), generation_(0), alive_(std::make_shared<bool>(true))
+{
+}
+
+void ScriptedSearch::restart(std::string const &pythonPredicate, std::string const &sourceKey, DatabaseVersion::Stamp const &stamp)
+{
+	generation_++;
+	predicate_ = pythonPredicate;
+	cacheKey_ = ScriptedQueryCache::keyOf(pythonPredicate, sourceKey);
+	stamp_ = stamp;
+	failed_ = false;
+	wholeList_ = query_.usesWholeList(pythonPredicate);
+	matches_.clear();
+	waiters_.clear();
+	sourceOffset_ = 0;
+	pulling_ = false;
+	cache_.begin(cacheKey_, stamp);
+	// Nothing committed since the last complete run, the source need not be read at all
+	exhausted_ = cache_.findComplete(cacheKey_, stamp, matches_);
+}
+
+void ScriptedSearch::loadPage(int skip, int limit, std::function<void(std::vector<midikraft::PatchHolder>)> callback)
+{
+	size_t start = (size_t) std::max(0, skip);
+	size_t needed = limit < 0 ? std::numeric_limits<size_t>::max() : start + (size_t) limit;
+	waiters_.push_back({ needed, [this, start, needed, callback]() {
+		std::vector<midikraft::PatchHolder> page;
+		for (size_t i = start; i < std::min(needed, matches_.size()); i++) {
+			page.push_back(matches_[i]);
+		}
+		callback(page);
+	} });
+	pump();
+}
+
+void ScriptedSearch::countAll(std::function<void(int)> callback)
+{
+	waiters_.push_back({ std::numeric_limits<size_t>::max(), [this, callback]() {
+		callback((int) matches_.size());
+	} });
+	pump();
+}
+
+bool ScriptedSearch::isComplete() const
+{
+	return exhausted_;
+}
 
-		// Create the patch in question using the PyTschirpPatch class
-		PyTschirp pythonPatch(patch.patch(), patch.smartSynth());
+int ScriptedSearch::matchesFound() const
+{
+	return (int) matches_.size();
+}
 
-		// Define the object to operate on
-		py::object obj = py::cast(pythonPatch);
-		auto locals = py::dict("p"_a = obj, **pytschirpee.attr("__dict__"));
+void ScriptedSearch::pump()
+{
+	// Serve everybody we have enough matches for. Delivering can add new waiters, so take them out first
+	std::vector<Waiter> ready;
+	for (auto waiter = waiters_.begin(); waiter != waiters_.end();) {
+		if (exhausted_ || matches_.size() >= waiter->matchesNeeded) {
+			ready.push_back(*waiter);
+			waiter = waiters_.erase(waiter);
+		}
+		else {
+			waiter++;
+		}
+	}
+	for (auto const &waiter : ready) {
+		waiter.deliver();
+	}
+
+	if (waiters_.empty() || pulling_ || exhausted_) {
+		return;
+	}
 
-		// Run the query
-		try {
-			auto queryResult = py::eval(pythonPredicate, py::globals(), locals);
-			if (py::isinstance<py::bool_>(queryResult)) {
-				if (py::bool_(queryResult)) {
-					result.push_back(patch);
+	// Need more, pull the next page from the source
+	pulling_ = true;
+	int generation = generation_;
+	std::weak_ptr<bool> alive = alive_;
+	source_(sourceOffset_, kSourcePageSize, [this, generation, alive](std::vector<midikraft::PatchHolder> const &patches) {
+		MessageManager::callAsync([this, generation, alive, patches]() {
+			if (alive.expired() || generation != generation_) {
+				// Either we are gone, or the search text changed meanwhile
+				return;
+			}
+			pulling_ = false;
+			sourceOffset_ += (int) patches.size();
+			auto found = filter(patches);
+			std::copy(found.begin(), found.end(), std::back_inserter(matches_));
+			if ((int) patches.size() < kSourcePageSize) {
+				exhausted_ = true;
+				if (!failed_) {
+					cache_.storeComplete(cacheKey_, stamp_, matches_);
 				}
 			}
-			else {
-				// Abort with an error message
-				spdlog::error("Error with scripted query - expression did not return True or False but {}", (std::string) py::str(queryResult));
-				return input;
+			pump();
+		});
+	});
+}
+
+std::vector<midikraft::PatchHolder> ScriptedSearch::filter(std::vector<midikraft::PatchHolder> const &patches)
+{
+	if (wholeList_) {
+		// A verdict is only valid together with the patches it was made with, evaluating a subset would change them
+		bool failed = false;
+		auto found = query_.filterByPredicate(predicate_, patches, &failed);
+		failed_ = failed_ || failed;
+		return found;
+	}
+
+	// 0 and 1 are the verdicts from the cache, -1 needs Python
+	std::vector<int> verdicts(patches.size(), -1);
+	std::vector<midikraft::PatchHolder> unknown;
+	for (size_t i = 0; i < patches.size(); i++) {
+		bool matches = false;
+		if (cache_.verdict(cacheKey_, patches[i], matches)) {
+			verdicts[i] = matches ? 1 : 0;
+		}
+		else {
+			unknown.push_back(patches[i]);
+		}
+	}
+	if (unknown.empty()) {
+		std::vector<midikraft::PatchHolder> result;
+		for (size_t i = 0; i < patches.size(); i++) {
+			if (verdicts[i] == 1) {
+				result.push_back(patches[i]);
 			}
 		}
-		catch (py::error_already_set &e) {
-			spdlog::error("Error with scripted query: {}", e.what());
-			return input;
+		return result;
+	}
+
+	bool failed = false;
+	auto found = query_.filterByPredicate(predicate_, unknown, &failed);
+	if (failed) {
+		// Like the query itself, show everything of this page unfiltered, and keep none of it
+		failed_ = true;
+		return patches;
+	}
+	// The matches come in the order of the unknown patches, so one pass over both finds them
+	std::vector<midikraft::PatchHolder> result;
+	size_t next = 0;
+	size_t unknownIndex = 0;
+	for (size_t i = 0; i < patches.size(); i++) {
+		if (verdicts[i] == -1) {
+			bool matches = next < found.size() && found[next].md5() == unknown[unknownIndex].md5() && found[next].synth() == unknown[unknownIndex].synth();
+			if (matches) {
+				next++;
+			}
+			cache_.remember(cacheKey_, patches[i], matches);
+			unknownIndex++;
+			verdicts[i] = matches ? 1 : 0;
+		}
+		if (verdicts[i] == 1) {
+			result.push_back(patches[i]);
 		}
 	}
 	return result;
 }
+
@@ -7,9 +7,114 @@
 #pragma once
 
 #include "PatchHolder.h"
+#include "ScriptedQueryCache.h"
 
+#include <pybind11/pybind11.h>
+
+#include <functional>
+#include <limits>
+#include <map>
+#include <memory>
+#include <optional>
+#include <set>
+
+// Evaluates a Python expression as filter over patches. The expression can either use p for a single patch and return True or False,
+// or, in vectorized mode, use patches for the whole list and return a list of True/False values, one per patch.
+// An expression using columns gets the decoded parameters of all patches as dict from parameter name to a list of values,
+// one per patch and None where a patch has no such parameter, e.g. [c > 100 for c in columns["Cutoff"]]
 class ScriptedQuery {
 public:
-	std::vector<midikraft::PatchHolder> filterByPredicate(std::string const &pythonPredicate, std::vector<midikraft::PatchHolder> const &input) const;
+	ScriptedQuery() = default;
+	~ScriptedQuery();
+
+	// If the predicate fails, the input is returned unfiltered and outFailed is set
+	std::vector<midikraft::PatchHolder> filterByPredicate(std::string const &pythonPredicate, std::vector<midikraft::PatchHolder> const &input, bool *outFailed = nullptr) const;
+	// True if the predicate uses patches or columns, so the verdict on one patch depends on the others evaluated with it
+	bool usesWholeList(std::string const &pythonPredicate) const;
+
+	// Number of patches evaluated per acquisition of the GIL, in between other threads get a chance to run Python
+	static constexpr size_t kChunkSize = 256;
+
+private:
+	// The compiled predicate and the locals of one call. Every call gets its own, so another thread running a query while the GIL
+	// is released between two chunks can't rebind p or swap the code underneath this one
+	struct Evaluation {
+		~Evaluation();
+		pybind11::object code;
+		pybind11::object locals;
+		bool vectorized = false;
+		bool columnar = false;
+	};
+
+	// Compiles the predicate if it changed since the last call, and gives the caller its own locals. Requires the GIL
+	bool prepare(std::string const &pythonPredicate, Evaluation &outEvaluation) const;
+	// Returns false if the predicate failed for this patch, requires the GIL
+	bool evaluateSingle(Evaluation &evaluation, midikraft::PatchHolder const &patch, bool &outMatches) const;
+	// Requires the GIL. The evaluation is passed in, as the columns are decoded without the GIL after prepare()
+	std::vector<midikraft::PatchHolder> filterVectorized(Evaluation &evaluation, std::vector<midikraft::PatchHolder> const &input, pybind11::object columns, bool *outFailed) const;
+
+	typedef std::map<std::string, std::vector<std::optional<int>>> TColumns;
+	// Pure C++, so this runs without the GIL
+	static TColumns decodeColumns(std::vector<midikraft::PatchHolder> const &input);
+
+	// Kept across calls, so paging through a query result compiles the expression only once. Only the code object is shared with
+	// the calls, the locals are copied for each, and the flags travel with them
+	mutable std::string compiledPredicate_;
+	mutable pybind11::object code_;
+	mutable pybind11::object locals_;
+	mutable bool vectorized_ = false;
+	mutable bool columnar_ = false;
+	mutable std::set<std::string> synthsPrepared_;
 };
 
+// Streaming stage that applies a ScriptedQuery behind a page loader, e.g. the database. Pages of the source are pulled and filtered
+// until enough matches for the requested page are found, so the first results show up right away. All state is only touched on the
+// message thread, source results are posted back to it. Results and verdicts are kept in a ScriptedQueryCache across restarts.
+class ScriptedSearch {
+public:
+	typedef std::function<void(std::vector<midikraft::PatchHolder> const &)> TPageCallback;
+	typedef std::function<void(int skip, int limit, TPageCallback callback)> TSourceLoader;
+
+	ScriptedSearch(TSourceLoader source);
+
+	// Starts over with a new predicate, anything still in flight for the previous one is discarded. The source key names the
+	// filter behind the source, the stamp must be taken now, before the source is asked for anything
+	void restart(std::string const &pythonPredicate, std::string const &sourceKey, DatabaseVersion::Stamp const &stamp);
+
+	// Delivers the matches [skip, skip + limit), limit -1 for all
+	void loadPage(int skip, int limit, std::function<void(std::vector<midikraft::PatchHolder>)> callback);
+	// Keeps filtering until the source is exhausted and then reports the number of matches
+	void countAll(std::function<void(int)> callback);
+
+	bool isComplete() const;
+	int matchesFound() const;
+
+	// Number of patches requested from the source per round trip
+	static constexpr int kSourcePageSize = 256;
+
+private:
+	struct Waiter {
+		size_t matchesNeeded;
+		std::function<void()> deliver;
+	};
+
+	void pump();
+	// Evaluates only the patches without a verdict in the cache. Predicates over the whole list always get the complete page
+	std::vector<midikraft::PatchHolder> filter(std::vector<midikraft::PatchHolder> const &patches);
+
+	TSourceLoader source_;
+	ScriptedQuery query_;
+	std::string predicate_;
+	ScriptedQueryCache cache_;
+	std::string cacheKey_;
+	DatabaseVersion::Stamp stamp_;
+	bool failed_; // The predicate failed for some patches, the result must not be kept
+	bool wholeList_; // The predicate uses patches or columns, which is why there are no verdicts per patch
+	std::vector<midikraft::PatchHolder> matches_;
+	std::vector<Waiter> waiters_;
+	int sourceOffset_;
+	bool exhausted_;
+	bool pulling_;
+	int generation_;
+	std::shared_ptr<bool> alive_; // Posted callbacks check this, so they don't touch us after destruction
+};
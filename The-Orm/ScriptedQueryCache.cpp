@@ -0,0 +1,88 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "ScriptedQueryCache.h"
+
+#include <algorithm>
+
+ScriptedQueryCache::ScriptedQueryCache(size_t maxQueries) : maxQueries_(std::max(maxQueries, (size_t) 1))
+{
+}
+
+std::string ScriptedQueryCache::keyOf(std::string const &pythonPredicate, std::string const &sourceKey)
+{
+	// Leading and trailing blanks make no difference to the expression
+	return String(pythonPredicate).trim().toStdString() + "\n" + sourceKey;
+}
+
+ScriptedQueryCache::Query &ScriptedQueryCache::query(std::string const &key)
+{
+	for (auto it = queries_.begin(); it != queries_.end(); it++) {
+		if (it->key == key) {
+			queries_.splice(queries_.begin(), queries_, it);
+			return queries_.front();
+		}
+	}
+	queries_.emplace_front();
+	queries_.front().key = key;
+	while (queries_.size() > maxQueries_) {
+		queries_.pop_back();
+	}
+	return queries_.front();
+}
+
+void ScriptedQueryCache::begin(std::string const &key, DatabaseVersion::Stamp const &stamp)
+{
+	auto &entry = query(key);
+	if (entry.epoch != stamp.epoch) {
+		entry.epoch = stamp.epoch;
+		entry.verdicts.clear();
+		entry.matches.clear();
+		entry.completeStamp = DatabaseVersion::Stamp();
+	}
+}
+
+bool ScriptedQueryCache::findComplete(std::string const &key, DatabaseVersion::Stamp const &stamp, std::vector<midikraft::PatchHolder> &outMatches)
+{
+	auto &entry = query(key);
+	if (entry.completeStamp == stamp) {
+		outMatches = entry.matches;
+		return true;
+	}
+	return false;
+}
+
+void ScriptedQueryCache::storeComplete(std::string const &key, DatabaseVersion::Stamp const &stamp, std::vector<midikraft::PatchHolder> const &matches)
+{
+	auto &entry = query(key);
+	entry.completeStamp = stamp;
+	entry.matches = matches;
+}
+
+bool ScriptedQueryCache::verdict(std::string const &key, midikraft::PatchHolder const &patch, bool &outMatches)
+{
+	auto &entry = query(key);
+	auto found = entry.verdicts.find(stateOf(patch));
+	if (found == entry.verdicts.end()) {
+		return false;
+	}
+	outMatches = found->second;
+	return true;
+}
+
+void ScriptedQueryCache::remember(std::string const &key, midikraft::PatchHolder const &patch, bool matches)
+{
+	query(key).verdicts[stateOf(patch)] = matches;
+}
+
+std::string ScriptedQueryCache::stateOf(midikraft::PatchHolder const &patch)
+{
+	std::string result = (patch.synth() ? patch.synth()->getName() : "") + ":" + patch.md5() + ":" + patch.name() + (patch.isFavorite() ? "|F" : "|") + (patch.isHidden() ? "H|" : "|");
+	for (auto const &category : patch.categories()) {
+		result += category.category() + ",";
+	}
+	return result;
+}
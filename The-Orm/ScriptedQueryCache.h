@@ -0,0 +1,55 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include "PatchHolder.h"
+#include "DatabaseVersion.h"
+
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// What a scripted query found for the last few predicates, each together with the filter it ran behind. As long as nothing was
+// committed since, the complete result is handed out again, and paging or coming back to the search needs no Python at all.
+// After a commit the source is read again, but only the patches whose data or metadata changed since their verdict are evaluated.
+// Only used on the message thread.
+class ScriptedQueryCache {
+public:
+	explicit ScriptedQueryCache(size_t maxQueries = 4);
+
+	// A predicate and the key of the filter it is applied to
+	static std::string keyOf(std::string const &pythonPredicate, std::string const &sourceKey);
+
+	// Call when starting the query, a new epoch drops the verdicts that were made for another database
+	void begin(std::string const &key, DatabaseVersion::Stamp const &stamp);
+
+	bool findComplete(std::string const &key, DatabaseVersion::Stamp const &stamp, std::vector<midikraft::PatchHolder> &outMatches);
+	// The stamp must have been taken before the first page of the source was requested
+	void storeComplete(std::string const &key, DatabaseVersion::Stamp const &stamp, std::vector<midikraft::PatchHolder> const &matches);
+
+	// False if the patch in this state has not been evaluated yet
+	bool verdict(std::string const &key, midikraft::PatchHolder const &patch, bool &outMatches);
+	void remember(std::string const &key, midikraft::PatchHolder const &patch, bool matches);
+
+private:
+	struct Query {
+		std::string key;
+		int epoch = 0;
+		DatabaseVersion::Stamp completeStamp; // Invalid while there is no complete result
+		std::vector<midikraft::PatchHolder> matches;
+		std::unordered_map<std::string, bool> verdicts; // By synth, md5 and everything the user can edit
+	};
+
+	Query &query(std::string const &key);
+	static std::string stateOf(midikraft::PatchHolder const &patch);
+
+	size_t maxQueries_;
+	std::list<Query> queries_; // Most recently used first
+};
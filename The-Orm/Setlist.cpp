@@ -0,0 +1,161 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "Setlist.h"
+
+#include "BackgroundJobs.h"
+#include "Metrics.h"
+
+#include "MidiController.h"
+#include "Capability.h"
+#include "EditBufferCapability.h"
+#include "MidiLocationCapability.h"
+#include "Patch.h"
+
+#include <spdlog/spdlog.h>
+
+std::unique_ptr<Setlist> Setlist::sInstance_;
+
+Setlist::Setlist() : alive_(std::make_shared<bool>(true))
+{
+}
+
+Setlist::~Setlist()
+{
+	*alive_ = false;
+}
+
+Setlist &Setlist::instance()
+{
+	if (!sInstance_) {
+		sInstance_.reset(new Setlist());
+	}
+	return *sInstance_;
+}
+
+void Setlist::shutdown()
+{
+	sInstance_.reset();
+}
+
+void Setlist::arm(std::shared_ptr<midikraft::PatchList> list, std::function<void(bool)> armed, std::function<void(midikraft::PatchHolder const &)> selected)
+{
+	if (!list) {
+		return;
+	}
+	auto result = std::make_shared<Armed>();
+	result->name = list->name();
+	auto patches = list->patches();
+	std::weak_ptr<bool> alive = alive_;
+	BackgroundJobs::instance().add("Arming setlist " + String(list->name()), 10, [result, patches](std::function<bool(double)> const &progress) {
+		// Python adaptations convert on this thread one after the other, same as any other user of the interpreter
+		for (size_t i = 0; i < patches.size(); i++) {
+			Entry entry;
+			entry.patch = patches[i];
+			if (auto location = midikraft::Capability::hasCapability<midikraft::MidiLocationCapability>(patches[i].smartSynth())) {
+				entry.output = location->midiOutput();
+				entry.messages = convert(patches[i]);
+			}
+			if (entry.messages.empty()) {
+				spdlog::warn("Setlist position {}: patch {} can't be sent to its synth, it will be skipped", i + 1, patches[i].name());
+			}
+			result->entries.push_back(std::move(entry));
+			if (!progress((i + 1) / (double)patches.size())) {
+				return false;
+			}
+		}
+		return true;
+	}, {}, [this, alive, result, armed, selected](BackgroundJob::State state) {
+		if (alive.expired() || !*alive.lock()) {
+			return;
+		}
+		bool succeeded = state == BackgroundJob::State::Succeeded;
+		if (succeeded) {
+			selected_ = selected;
+			position_ = -1;
+			std::atomic_store(&armed_, std::shared_ptr<Armed const>(result));
+			spdlog::info("Setlist {} armed with {} patches, program changes and the next/previous macros now play its positions", result->name, result->entries.size());
+		}
+		if (armed) {
+			armed(succeeded);
+		}
+	});
+}
+
+void Setlist::disarm()
+{
+	if (std::atomic_exchange(&armed_, std::shared_ptr<Armed const>())) {
+		spdlog::info("Setlist disarmed");
+	}
+}
+
+bool Setlist::isArmed() const
+{
+	return std::atomic_load(&armed_) != nullptr;
+}
+
+std::string Setlist::name() const
+{
+	auto armed = std::atomic_load(&armed_);
+	return armed ? armed->name : std::string();
+}
+
+bool Setlist::selectPosition(int position)
+{
+	auto armed = std::atomic_load(&armed_);
+	if (!armed) {
+		return false;
+	}
+	if (position >= 0 && position < (int)armed->entries.size()) {
+		send(armed, position);
+	}
+	return true;
+}
+
+bool Setlist::step(int direction)
+{
+	auto armed = std::atomic_load(&armed_);
+	if (!armed) {
+		return false;
+	}
+	int position = std::max(0, std::min(position_.load() + direction, (int)armed->entries.size() - 1));
+	if (position >= 0) {
+		send(armed, position);
+	}
+	return true;
+}
+
+std::vector<MidiMessage> Setlist::convert(midikraft::PatchHolder const &patch)
+{
+	if (!patch.patch() || !patch.smartSynth()) {
+		return {};
+	}
+	// Only real patches go into the edit buffer, other data files like tunings are sent the way their synth wants them
+	auto editBuffer = midikraft::Capability::hasCapability<midikraft::EditBufferCapability>(patch.smartSynth());
+	if (editBuffer && std::dynamic_pointer_cast<midikraft::Patch>(patch.patch())) {
+		return editBuffer->patchToSysex(patch.patch());
+	}
+	return patch.smartSynth()->dataFileToSysex(patch.patch(), nullptr);
+}
+
+void Setlist::send(std::shared_ptr<Armed const> const &armed, int position)
+{
+	static auto &switchTime = Metrics::instance().histogram("setlist.switch");
+	auto const &entry = armed->entries[(size_t)position];
+	position_ = position;
+	if (!entry.messages.empty()) {
+		MetricsTimer timer(switchTime);
+		midikraft::MidiController::instance()->getMidiOutput(entry.output)->sendBlockOfMessagesFullSpeed(entry.messages);
+	}
+	// The UI follows when it gets to it, and learns that the edit buffer changed behind its back
+	std::weak_ptr<bool> alive = alive_;
+	auto patch = entry.patch;
+	MessageManager::callAsync([this, alive, patch]() {
+		if (!alive.expired() && *alive.lock() && selected_) {
+			selected_(patch);
+		}
+	});
+}
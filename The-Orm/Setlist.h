@@ -0,0 +1,64 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include "PatchHolder.h"
+#include "PatchList.h"
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+
+// A user list armed for playing live. Arming converts every patch of the list into the messages for its synth once,
+// afterwards program changes and the next/previous macros coming in from the master keyboard are answered directly on
+// the MIDI thread from these pinned messages, without database, Python or UI work before the bytes go out. The patches
+// are sent at full speed, the throttling a synth might do for regular sends is not applied
+class Setlist {
+public:
+	struct Entry {
+		midikraft::PatchHolder patch;
+		juce::MidiDeviceInfo output;
+		std::vector<MidiMessage> messages; // Empty if the patch could not be converted
+	};
+
+	~Setlist();
+
+	// Call on the message thread before the MIDI handlers use it
+	static Setlist &instance();
+	static void shutdown();
+
+	// Message thread. The conversion runs as background job, armed is called with the outcome. Selected is called on
+	// the message thread after each switch, to show the patch playing now. Its synth's edit buffer was replaced by then,
+	// so whoever tracks what went into it must forget that there
+	void arm(std::shared_ptr<midikraft::PatchList> list, std::function<void(bool)> armed, std::function<void(midikraft::PatchHolder const &)> selected);
+	void disarm();
+	bool isArmed() const;
+	std::string name() const;
+
+	// MIDI thread. Send the entry at this position or the one next to the last sent, false if nothing is armed
+	bool selectPosition(int position);
+	bool step(int direction);
+
+private:
+	struct Armed {
+		std::string name;
+		std::vector<Entry> entries;
+	};
+
+	Setlist();
+	static std::vector<MidiMessage> convert(midikraft::PatchHolder const &patch);
+	void send(std::shared_ptr<Armed const> const &armed, int position);
+
+	std::shared_ptr<Armed const> armed_; // Read with std::atomic_load, so the MIDI thread never waits
+	std::atomic<int> position_ { -1 };
+	std::function<void(midikraft::PatchHolder const &)> selected_; // Message thread only
+	std::shared_ptr<bool> alive_;
+	static std::unique_ptr<Setlist> sInstance_;
+};
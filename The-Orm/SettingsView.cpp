@@ -13,6 +13,8 @@
 
 #include "GlobalSettingsCapability.h"
 
+#include "DSI.h"
+
 
 SettingsView::SettingsView(std::vector<midikraft::SynthHolder> const &synths) : synths_(synths), librarian_(synths),
 buttonStrip_(3001, LambdaButtonStrip::Direction::Horizontal)
@@ -26,6 +28,7 @@ buttonStrip_(3001, LambdaButtonStrip::Direction::Horizontal)
 	addAndMakeVisible(buttonStrip_);
 	addAndMakeVisible(propertyEditor_);
 	addAndMakeVisible(errorMessageInstead_);
+	addAndMakeVisible(metricsPanel_);
 
 	UIModel::instance()->currentSynth_.addChangeListener(this);
 }
@@ -39,6 +42,7 @@ void SettingsView::resized()
 {
 	auto area = getLocalBounds();
 	buttonStrip_.setBounds(area.removeFromBottom(60).reduced(8));
+	metricsPanel_.setBounds(area.removeFromRight(std::min(area.getWidth() / 2, 600)).reduced(10));
 	auto editorArea = area.reduced(10);
 	if (errorMessageInstead_.getText().isNotEmpty()) {
 		int width = std::min(area.getWidth(), 600);
@@ -62,6 +66,7 @@ void SettingsView::changeListenerCallback(ChangeBroadcaster* source)
 		propertyEditor_.setProperties(gsc->getGlobalSettings());
 		errorMessageInstead_.setText("", dontSendNotification);
 		resized();
+		loadGlobalsIfStale();
 	}
 	else {
 		propertyEditor_.clear();
@@ -75,6 +80,29 @@ void SettingsView::changeListenerCallback(ChangeBroadcaster* source)
 	}
 }
 
+void SettingsView::visibilityChanged()
+{
+	loadGlobalsIfStale();
+}
+
+void SettingsView::loadGlobalsIfStale()
+{
+	if (!isShowing()) {
+		// Switching synths on another tab must not download anything
+		return;
+	}
+	auto dsiSynth = std::dynamic_pointer_cast<midikraft::DSISynth>(UIModel::instance()->currentSynth_.smartSynth());
+	if (dsiSynth && dsiSynth->wasDetected() && dsiSynth->globalSettingsAreStale()) {
+		auto now = Time::getMillisecondCounter();
+		auto requested = autoLoadRequestedMs_.find(dsiSynth->getName());
+		if (requested != autoLoadRequestedMs_.end() && now - requested->second < kAutoLoadRetryMs) {
+			return;
+		}
+		autoLoadRequestedMs_[dsiSynth->getName()] = now;
+		loadGlobals();
+	}
+}
+
 void SettingsView::loadGlobals() {
 	auto synth = UIModel::instance()->currentSynth_.smartSynth();
 	auto midiLocation = midikraft::Capability::hasCapability<midikraft::MidiLocationCapability>(synth);
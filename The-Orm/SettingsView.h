@@ -11,10 +11,13 @@
 #include "LambdaButtonStrip.h"
 #include "PropertyEditor.h"
 #include "InfoText.h"
+#include "MetricsPanel.h"
 
 #include "SynthHolder.h"
 #include "Librarian.h"
 
+#include <map>
+
 class SettingsView : public Component,
 	private ChangeListener
 {
@@ -25,9 +28,14 @@ public:
 	void loadGlobals();
 
 	virtual void resized() override;
+	virtual void visibilityChanged() override;
 
 private:
 	void changeListenerCallback(ChangeBroadcaster* source) override;
+	// Fetches the globals only if the synth keeps a cache of them and it is out of date, else what is known is shown
+	void loadGlobalsIfStale();
+
+	static constexpr uint32 kAutoLoadRetryMs = 30000;
 
 	std::vector<midikraft::SynthHolder> synths_;
 	midikraft::Librarian librarian_;
@@ -35,6 +43,8 @@ private:
 	PropertyEditor propertyEditor_;
 	InfoText errorMessageInstead_;
 	LambdaButtonStrip buttonStrip_;
+	MetricsPanel metricsPanel_;
+	std::map<std::string, uint32> autoLoadRequestedMs_; // Per synth, so a synth that does not answer is not asked on every visit
 
 	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SettingsView)
 };
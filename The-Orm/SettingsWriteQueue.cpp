@@ -0,0 +1,149 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "SettingsWriteQueue.h"
+
+#include "Settings.h"
+
+#include <spdlog/spdlog.h>
+
+std::unique_ptr<SettingsWriteQueue> SettingsWriteQueue::sInstance_;
+
+SettingsWriteQueue::SettingsWriteQueue() : Thread("SettingsWriteQueue")
+{
+	startThread();
+}
+
+SettingsWriteQueue::~SettingsWriteQueue()
+{
+	signalThreadShouldExit();
+	changeAvailable_.signal();
+	stopThread(5000);
+	// Nothing gets lost on shutdown
+	writePending();
+}
+
+SettingsWriteQueue &SettingsWriteQueue::instance()
+{
+	if (!sInstance_) {
+		sInstance_.reset(new SettingsWriteQueue());
+	}
+	return *sInstance_;
+}
+
+void SettingsWriteQueue::shutdown()
+{
+	// The instance stays, so a late change neither brings the thread back nor gets lost
+	if (sInstance_) {
+		sInstance_->stopQueueing();
+	}
+}
+
+void SettingsWriteQueue::stopQueueing()
+{
+	signalThreadShouldExit();
+	changeAvailable_.signal();
+	stopThread(5000);
+	{
+		ScopedLock lock(queueLock_);
+		writeThrough_ = true;
+	}
+	writePending();
+}
+
+void SettingsWriteQueue::set(std::string const &key, std::string const &value)
+{
+	{
+		ScopedLock lock(queueLock_);
+		if (!writeThrough_) {
+			pending_[key] = value;
+			changeAvailable_.signal();
+			return;
+		}
+	}
+	Settings::instance().set(key, value);
+}
+
+std::string SettingsWriteQueue::get(std::string const &key, std::string const &defaultValue)
+{
+	{
+		ScopedLock lock(queueLock_);
+		auto found = pending_.find(key);
+		if (found != pending_.end()) {
+			return found->second;
+		}
+	}
+	return Settings::instance().get(key, defaultValue);
+}
+
+int SettingsWriteQueue::get(std::string const &key, int defaultValue)
+{
+	{
+		ScopedLock lock(queueLock_);
+		auto found = pending_.find(key);
+		if (found != pending_.end()) {
+			return String(found->second).getIntValue();
+		}
+	}
+	return Settings::instance().get(key, defaultValue);
+}
+
+bool SettingsWriteQueue::keyIsSet(std::string const &key)
+{
+	{
+		ScopedLock lock(queueLock_);
+		if (pending_.find(key) != pending_.end()) {
+			return true;
+		}
+	}
+	return Settings::instance().keyIsSet(key);
+}
+
+void SettingsWriteQueue::flush()
+{
+	writePending();
+}
+
+void SettingsWriteQueue::run()
+{
+	while (!threadShouldExit()) {
+		if (!changeAvailable_.wait(1000)) {
+			continue;
+		}
+		// Every further change restarts the wait, so a drag is written once it ends
+		while (!threadShouldExit() && changeAvailable_.wait(kQuietMs)) {
+		}
+		writePending();
+	}
+}
+
+void SettingsWriteQueue::writePending()
+{
+	ScopedLock writing(writeLock_);
+	std::map<std::string, std::string> changes;
+	{
+		ScopedLock lock(queueLock_);
+		changes = pending_;
+	}
+	if (changes.empty()) {
+		return;
+	}
+	for (auto const &change : changes) {
+		Settings::instance().set(change.first, change.second);
+	}
+	{
+		// Only now the Settings have the values, until then the readers got them from pending_. Keep what changed again meanwhile
+		ScopedLock lock(queueLock_);
+		for (auto const &change : changes) {
+			auto found = pending_.find(change.first);
+			if (found != pending_.end() && found->second == change.second) {
+				pending_.erase(found);
+			}
+		}
+	}
+	Settings::instance().flush();
+	spdlog::debug("Stored {} changed settings", changes.size());
+}
@@ -0,0 +1,51 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include <map>
+#include <string>
+
+// Collects the settings that change while the user drags a slider or resizes a window, and hands them to the Settings
+// on a background thread once nothing changed for a moment. Only the last value of each key is written, and the settings
+// file is stored once per burst instead of once per change. Reads through here see the pending values right away.
+class SettingsWriteQueue : private Thread {
+public:
+	static SettingsWriteQueue &instance();
+	// Writes everything pending and stops the thread, call before the Settings are closed. Changes made after this are written
+	// through to the Settings right away
+	static void shutdown();
+
+	void set(std::string const &key, std::string const &value);
+	// The pending value if there is one, else what the Settings have stored
+	std::string get(std::string const &key, std::string const &defaultValue = "");
+	int get(std::string const &key, int defaultValue);
+	bool keyIsSet(std::string const &key);
+
+	// Writes everything pending before returning
+	void flush();
+
+	// How long the settings must stay unchanged before they are written
+	static constexpr int kQuietMs = 1000;
+
+private:
+	SettingsWriteQueue();
+	~SettingsWriteQueue() override;
+
+	void run() override;
+	void writePending();
+	void stopQueueing();
+
+	CriticalSection queueLock_;
+	std::map<std::string, std::string> pending_;
+	bool writeThrough_ = false; // Set by shutdown(), guarded by queueLock_
+	CriticalSection writeLock_; // Held while writing, so flush() can wait for a write in progress
+	WaitableEvent changeAvailable_;
+
+	static std::unique_ptr<SettingsWriteQueue> sInstance_;
+};
@@ -9,6 +9,7 @@
 #include "Synth.h"
 #include "MidiChannelPropertyEditor.h"
 #include "SoundExpanderCapability.h"
+#include "ProgramDumpCapability.h"
 #include "Logger.h"
 #include "AutoDetection.h"
 #include "Settings.h"
@@ -16,15 +17,18 @@
 #include "CreateNewAdaptationDialog.h"
 #include "AutoDetectProgressWindow.h"
 #include "LoopDetection.h"
+#include "TransferStrategy.h"
 
 
 #include "UIModel.h"
 
 #include "ColourHelpers.h"
 
+#include <fmt/format.h>
 #include <spdlog/spdlog.h>
 #include "SpdLogJuce.h"
 #include <algorithm>
+#include <map>
 
 class MidiChannelPropertyEditorWithOldDevices : public MidiDevicePropertyEditor {
 public:
@@ -54,6 +58,21 @@ public:
 const char *kSetupHint1 = "In case the auto-detection fails, setup the MIDI channel and MIDI interface below to get your synths detected.\n\n"
 	"This can *not* be used to change the synth's channel, but rather in case the autodetection fails you can manually enter the correct channel here.";
 const char *kSetupHint2 = "First please select at least one synth to use, then turn it on and press auto-detect to detect if a working bi-directional connection can be made.\n\n";
+const char *kBankUpload = "Bank upload";
+
+static std::string withRate(std::string const &text, double patchesPerSecond) {
+	return patchesPerSecond > 0.0 ? fmt::format("{} ({:.1f} patches/s)", text, patchesPerSecond) : text;
+}
+
+static std::map<int, std::string> bankUploadLookup(std::shared_ptr<midikraft::Synth> synth) {
+	// Downloads are planned by the Librarian, their rate is just shown along
+	auto automatic = TransferStrategy::downloadRate(synth) > 0.0 ? fmt::format("Automatic, fastest measured (downloads {:.1f} patches/s)", TransferStrategy::downloadRate(synth)) : "Automatic, fastest measured";
+	return {
+		{ (int)TransferStrategy::BankUpload::Automatic, automatic },
+		{ (int)TransferStrategy::BankUpload::ChangedPrograms, withRate("Changed programs only", TransferStrategy::uploadRate(synth, TransferStrategy::BankUpload::ChangedPrograms)) },
+		{ (int)TransferStrategy::BankUpload::WholeBank, withRate("Always the whole bank", TransferStrategy::uploadRate(synth, TransferStrategy::BankUpload::WholeBank)) }
+	};
+}
 
 
 SetupView::SetupView(midikraft::AutoDetection *autoDetection /*, HueLightControl *lights*/) :
@@ -90,12 +109,13 @@ SetupView::SetupView(midikraft::AutoDetection *autoDetection /*, HueLightControl
 	};
 	autoConfigureButton_.setButtonText("Auto-Detect");
 
-	midikraft::MidiController::instance()->addChangeListener(this);
+	MidiDeviceWatcher::instance().addListener(this);
 
 	UIModel::instance()->currentSynth_.addChangeListener(this);
 }
 
 SetupView::~SetupView() {
+	MidiDeviceWatcher::instance().removeListener(this);
 	UIModel::instance()->currentSynth_.removeChangeListener(this);
 }
 
@@ -128,10 +148,14 @@ void SetupView::rebuildSetupColumn() {
 	for (auto &synth: sortedSynthList_) {
 		if (!UIModel::instance()->synthList_.isSynthActive(synth.device())) continue;
 		auto sectionName = synth.getName();
-		// For each synth, we need 3 properties, and we need to listen to changes: 
+		// For each synth, we need 3 properties plus the bank upload choice where there is one, and we need to listen to changes: 
 		properties_.push_back(std::make_shared<MidiChannelPropertyEditorWithOldDevices>("Sent to device", sectionName, false));
 		properties_.push_back(std::make_shared<MidiChannelPropertyEditorWithOldDevices>("Receive from device", sectionName, true));
 		properties_.push_back(std::make_shared<MidiChannelPropertyEditor>("MIDI channel", sectionName));
+		if (midikraft::Capability::hasCapability<midikraft::ProgramDumpCabability>(synth.synth())) {
+			// Only these have a choice, show what was measured so far
+			properties_.push_back(std::make_shared<TypedNamedValue>(kBankUpload, sectionName, (int)TransferStrategy::BankUpload::Automatic, bankUploadLookup(synth.synth())));
+		}
 	}
 	// We need to know if any of these are clicked
 	for (auto prop : properties_) prop->value().addListener(this);
@@ -173,6 +197,9 @@ void SetupView::refreshData() {
 		else {
 			setValueWithoutListeners(properties_[prop++]->value(), synth.device()->channel().toOneBasedInt());
 		}
+		if (prop < properties_.size() && properties_[prop]->name() == kBankUpload && properties_[prop]->sectionName() == String(synth.getName())) {
+			setValueWithoutListeners(properties_[prop++]->value(), (int)TransferStrategy::override(synth.synth()));
+		}
 	}
 }
 
@@ -210,6 +237,9 @@ void SetupView::valueChanged(Value& value)
 				else if (prop->name() == "MIDI channel") {
 					synthFound.device()->setChannel(MidiChannel::fromOneBase(value.getValue()));
 				}
+				else if (prop->name() == kBankUpload) {
+					TransferStrategy::setOverride(synthFound.synth(), (TransferStrategy::BankUpload)(int)value.getValue());
+				}
 				else if (prop->name() == "Activated") {
 					UIModel::instance()->synthList_.setSynthActive(synthFound.device().get(), value.getValue());
 					auto activeKey = String(synthFound.getName()) + String("-activated");
@@ -234,15 +264,10 @@ void SetupView::valueChanged(Value& value)
 
 void SetupView::changeListenerCallback(ChangeBroadcaster* source)
 {
-	if (source == midikraft::MidiController::instance()) {
-		// Refresh setup list on the right side
-		rebuildSetupColumn();
-	}
-	else {
-		// Refresh left side
-		refreshSynthActiveness();
-		refreshData();
-	}
+	ignoreUnused(source);
+	// Refresh left side
+	refreshSynthActiveness();
+	refreshData();
 	/*// Find out which of the color selectors sent this message
 	for (int i = 0; i < colours_.size(); i++) {
 		if (colours_[i] == source) {
@@ -255,6 +280,13 @@ void SetupView::changeListenerCallback(ChangeBroadcaster* source)
 	}*/
 }
 
+void SetupView::midiDevicesChanged(MidiDeviceWatcher::Changes const &changes)
+{
+	ignoreUnused(changes);
+	// Refresh setup list on the right side
+	rebuildSetupColumn();
+}
+
 void SetupView::quickConfigure()
 {
 	auto currentSynths = UIModel::instance()->synthList_.activeSynths();
@@ -12,6 +12,7 @@
 #include "PropertyEditor.h"
 #include "InfoText.h"
 #include "DebounceTimer.h"
+#include "MidiDeviceWatcher.h"
 
 #include "AutoDetection.h"
 #include "SynthHolder.h"
@@ -20,7 +21,7 @@
 
 
 class SetupView : public Component,
-	private ChangeListener, private Value::Listener
+	private ChangeListener, private Value::Listener, private MidiDeviceWatcher::Listener
 {
 public:
 	SetupView(midikraft::AutoDetection *autoDetection /*, HueLightControl *lights*/);
@@ -40,6 +41,7 @@ private:
 
 	virtual void valueChanged(Value& value) override;
 	virtual void changeListenerCallback(ChangeBroadcaster* source) override;
+	void midiDevicesChanged(MidiDeviceWatcher::Changes const &changes) override;
 	void setValueWithoutListeners(Value &value, int newValue);
 	
 	std::shared_ptr<midikraft::SimpleDiscoverableDevice> findSynthForName(juce::String const &synthName) const;
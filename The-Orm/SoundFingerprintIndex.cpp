@@ -0,0 +1,257 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "SoundFingerprintIndex.h"
+
+#include "ParallelFor.h"
+#include "UIModel.h"
+
+#include <spdlog/spdlog.h>
+#include "SpdLogJuce.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+	const char *kFingerprintCacheMagic = "KnobKraftSoundFingerprints1";
+
+	double toMel(double hz) {
+		return 2595.0 * std::log10(1.0 + hz / 700.0);
+	}
+
+	double fromMel(double mel) {
+		return 700.0 * (std::pow(10.0, mel / 2595.0) - 1.0);
+	}
+
+}
+
+SoundFingerprintIndex::SoundFingerprintIndex() : loaded_(false), running_(false), stopping_(false), alive_(std::make_shared<bool>(true))
+{
+}
+
+SoundFingerprintIndex::~SoundFingerprintIndex()
+{
+	stopping_ = true;
+	pool_.removeAllJobs(true, 5000);
+}
+
+void SoundFingerprintIndex::update(std::function<void()> onDone)
+{
+	waiting_.push_back(onDone);
+	if (running_) {
+		// The running update reports to everybody waiting
+		return;
+	}
+	running_ = true;
+	std::weak_ptr<bool> alive = alive_;
+	pool_.addJob([this, alive]() {
+		loadIfNeeded();
+		// Find the recordings without an up to date fingerprint
+		std::vector<std::pair<File, int64>> todo;
+		for (auto const &entry : RangedDirectoryIterator(UIModel::getPrehearDirectory(), false, "*.wav")) {
+			auto md5 = entry.getFile().getFileNameWithoutExtension().toStdString();
+			int64 modified = entry.getModificationTime().toMilliseconds();
+			ScopedLock lock(lock_);
+			auto known = fingerprints_.find(md5);
+			if (known == fingerprints_.end() || known->second.modified != modified) {
+				todo.emplace_back(entry.getFile(), modified);
+			}
+		}
+		if (!todo.empty()) {
+			spdlog::debug("Computing the sound fingerprints of {} recordings", todo.size());
+			parallelFor(todo.size(), [this, &todo](size_t i) {
+				auto features = analyse(todo[i].first);
+				ScopedLock lock(lock_);
+				// Unreadable or silent recordings get an empty entry, so they are not tried again until they change
+				fingerprints_[todo[i].first.getFileNameWithoutExtension().toStdString()] = { todo[i].second, features };
+			}, [this](double) { return !stopping_.load(); });
+			save();
+		}
+		MessageManager::callAsync([this, alive]() {
+			if (alive.expired()) {
+				return;
+			}
+			running_ = false;
+			auto waiting = std::move(waiting_);
+			waiting_.clear();
+			for (auto const &done : waiting) {
+				if (done) {
+					done();
+				}
+			}
+		});
+	});
+}
+
+bool SoundFingerprintIndex::hasFingerprint(std::string const &md5) const
+{
+	ScopedLock lock(lock_);
+	auto found = fingerprints_.find(md5);
+	return found != fingerprints_.end() && !found->second.features.empty();
+}
+
+std::vector<std::pair<std::string, float>> SoundFingerprintIndex::nearest(std::string const &md5, size_t k) const
+{
+	std::vector<std::pair<std::string, float>> result;
+	ScopedLock lock(lock_);
+	auto self = fingerprints_.find(md5);
+	if (self == fingerprints_.end() || self->second.features.empty()) {
+		return result;
+	}
+	auto const &features = self->second.features;
+	for (auto const &other : fingerprints_) {
+		if (other.first == md5 || other.second.features.size() != features.size()) {
+			continue;
+		}
+		float distance = 0.0f;
+		for (size_t i = 0; i < features.size(); i++) {
+			float d = features[i] - other.second.features[i];
+			distance += d * d;
+		}
+		result.emplace_back(other.first, std::sqrt(distance));
+	}
+	size_t top = std::min(k, result.size());
+	std::partial_sort(result.begin(), result.begin() + (long) top, result.end(), [](auto const &a, auto const &b) {
+		return a.second < b.second;
+	});
+	result.resize(top);
+	return result;
+}
+
+std::vector<float> SoundFingerprintIndex::analyse(File const &recording)
+{
+	AudioFormatManager formats;
+	formats.registerBasicFormats();
+	std::unique_ptr<AudioFormatReader> reader(formats.createReaderFor(recording));
+	if (!reader || reader->lengthInSamples <= 0 || reader->sampleRate <= 0.0) {
+		return {};
+	}
+
+	// Mix down the beginning of the recording to mono
+	constexpr int fftSize = 1 << kFFTOrder;
+	int numSamples = (int) std::min(reader->lengthInSamples, (int64) (reader->sampleRate * kSecondsAnalysed));
+	AudioBuffer<float> buffer((int) reader->numChannels, numSamples);
+	reader->read(&buffer, 0, numSamples, 0, true, true);
+	std::vector<float> mono((size_t) std::max(numSamples, fftSize), 0.0f);
+	for (int channel = 0; channel < buffer.getNumChannels(); channel++) {
+		FloatVectorOperations::add(mono.data(), buffer.getReadPointer(channel), numSamples);
+	}
+
+	// FFT bins belonging to each band, from 50 Hz up to 12 kHz or the Nyquist frequency
+	double binWidth = reader->sampleRate / fftSize;
+	double lowMel = toMel(50.0);
+	double highMel = toMel(std::min(12000.0, reader->sampleRate / 2.0));
+	std::vector<int> bandEdges;
+	for (int band = 0; band <= kNumberOfBands; band++) {
+		auto hz = fromMel(lowMel + (highMel - lowMel) * band / kNumberOfBands);
+		bandEdges.push_back(std::clamp((int) std::round(hz / binWidth), 1, fftSize / 2));
+	}
+
+	dsp::FFT fft(kFFTOrder);
+	dsp::WindowingFunction<float> window((size_t) fftSize, dsp::WindowingFunction<float>::hann, false);
+	std::vector<float> frame((size_t) fftSize * 2);
+	std::vector<double> sum(kNumberOfBands, 0.0);
+	std::vector<double> sumOfSquares(kNumberOfBands, 0.0);
+	int frames = 0;
+	for (size_t start = 0; start + fftSize <= mono.size(); start += fftSize / 2) {
+		std::fill(frame.begin(), frame.end(), 0.0f);
+		std::copy(mono.begin() + (long) start, mono.begin() + (long) (start + fftSize), frame.begin());
+		if (FloatVectorOperations::findMaximum(frame.data(), fftSize) < 1e-4f && FloatVectorOperations::findMinimum(frame.data(), fftSize) > -1e-4f) {
+			// Silence before the note or after the release says nothing about the sound
+			continue;
+		}
+		window.multiplyWithWindowingTable(frame.data(), (size_t) fftSize);
+		fft.performFrequencyOnlyForwardTransform(frame.data());
+		for (int band = 0; band < kNumberOfBands; band++) {
+			double energy = 0.0;
+			for (int bin = bandEdges[band]; bin < std::max(bandEdges[band] + 1, bandEdges[band + 1]); bin++) {
+				energy += (double) frame[(size_t) bin] * frame[(size_t) bin];
+			}
+			double logEnergy = std::log(energy + 1e-9);
+			sum[band] += logEnergy;
+			sumOfSquares[band] += logEnergy * logEnergy;
+		}
+		frames++;
+	}
+	if (frames == 0) {
+		return {};
+	}
+
+	std::vector<float> result;
+	double loudness = 0.0;
+	for (int band = 0; band < kNumberOfBands; band++) {
+		loudness += sum[band] / frames;
+	}
+	loudness /= kNumberOfBands;
+	for (int band = 0; band < kNumberOfBands; band++) {
+		result.push_back((float) (sum[band] / frames - loudness));
+	}
+	for (int band = 0; band < kNumberOfBands; band++) {
+		double mean = sum[band] / frames;
+		result.push_back((float) std::sqrt(std::max(0.0, sumOfSquares[band] / frames - mean * mean)));
+	}
+	return result;
+}
+
+void SoundFingerprintIndex::loadIfNeeded()
+{
+	ScopedLock lock(lock_);
+	if (loaded_) {
+		return;
+	}
+	loaded_ = true;
+	auto file = cacheFile();
+	if (!file.existsAsFile()) {
+		return;
+	}
+	FileInputStream in(file);
+	if (in.failedToOpen() || in.readString() != kFingerprintCacheMagic) {
+		return;
+	}
+	int count = in.readInt();
+	for (int i = 0; i < count && !in.isExhausted(); i++) {
+		auto md5 = in.readString().toStdString();
+		Entry entry;
+		entry.modified = in.readInt64();
+		int dimensions = in.readInt();
+		for (int d = 0; d < dimensions && !in.isExhausted(); d++) {
+			entry.features.push_back(in.readFloat());
+		}
+		fingerprints_[md5] = entry;
+	}
+}
+
+void SoundFingerprintIndex::save()
+{
+	ScopedLock lock(lock_);
+	auto file = cacheFile();
+	TemporaryFile temp(file);
+	{
+		FileOutputStream out(temp.getFile());
+		if (out.failedToOpen()) {
+			spdlog::warn("Could not write sound fingerprint file {}", file.getFullPathName());
+			return;
+		}
+		out.writeString(kFingerprintCacheMagic);
+		out.writeInt((int) fingerprints_.size());
+		for (auto const &entry : fingerprints_) {
+			out.writeString(entry.first);
+			out.writeInt64(entry.second.modified);
+			out.writeInt((int) entry.second.features.size());
+			for (auto value : entry.second.features) {
+				out.writeFloat(value);
+			}
+		}
+		out.flush();
+	}
+	temp.overwriteTargetFileWithTemporary();
+}
+
+File SoundFingerprintIndex::cacheFile()
+{
+	return UIModel::getPrehearDirectory().getChildFile("fingerprints.cache");
+}
@@ -0,0 +1,60 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include <atomic>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Spectral fingerprints of the prehear recordings, to find patches that sound alike no matter which synth they are for.
+// A recording is reduced to the mean and the variation over time of its log energy in bands spaced evenly on the mel scale.
+// The overall loudness is taken out of the means, so a quieter recording of the same sound still matches.
+// Fingerprints are computed on background threads and kept in a cache file next to the recordings.
+class SoundFingerprintIndex {
+public:
+	SoundFingerprintIndex();
+	~SoundFingerprintIndex();
+
+	// Analyses all recordings that are new or changed in the background, onDone is called on the message thread
+	void update(std::function<void()> onDone);
+
+	bool hasFingerprint(std::string const &md5) const;
+	// The md5s of the k recordings closest to the given one, closest first, with their distance. The recording itself is not included
+	std::vector<std::pair<std::string, float>> nearest(std::string const &md5, size_t k) const;
+
+	// Empty if the file can't be read or is silent
+	static std::vector<float> analyse(File const &recording);
+
+	static constexpr int kNumberOfBands = 24;
+	static constexpr int kFFTOrder = 11;
+	static constexpr double kSecondsAnalysed = 3.0;
+
+private:
+	struct Entry {
+		int64 modified; // Of the recording the fingerprint was computed from
+		std::vector<float> features;
+	};
+
+	void loadIfNeeded();
+	void save();
+	static File cacheFile();
+
+	mutable CriticalSection lock_;
+	std::map<std::string, Entry> fingerprints_;
+	bool loaded_;
+	bool running_; // Message thread only, like waiting_
+	std::atomic<bool> stopping_;
+	std::vector<std::function<void()>> waiting_;
+	std::shared_ptr<bool> alive_; // Posted callbacks check this, so they don't touch us after destruction
+	ThreadPool pool_{ 1 }; // Declared last so the running jobs finish before the entries go away
+};
@@ -0,0 +1,43 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "StartupProfile.h"
+
+#include <spdlog/spdlog.h>
+
+StartupProfile &StartupProfile::instance()
+{
+	static StartupProfile profile;
+	return profile;
+}
+
+StartupProfile::StartupProfile() : launchMs_(Time::getMillisecondCounterHiRes()), lastMs_(launchMs_)
+{
+}
+
+void StartupProfile::phaseDone(std::string const &phase)
+{
+	double now = Time::getMillisecondCounterHiRes();
+	phases_.emplace_back(phase, now - lastMs_);
+	lastMs_ = now;
+}
+
+void StartupProfile::markInteractive()
+{
+	interactiveMs_ = Time::getMillisecondCounterHiRes() - launchMs_;
+}
+
+void StartupProfile::logSummary()
+{
+	if (logged_) {
+		return;
+	}
+	logged_ = true;
+	for (auto const &phase : phases_) {
+		spdlog::info("Startup phase {}: {:.0f} ms", phase.first, phase.second);
+	}
+	spdlog::info("Startup took {:.0f} ms until the window was interactive, {:.0f} ms including the deferred initialization", interactiveMs_, lastMs_ - launchMs_);
+}
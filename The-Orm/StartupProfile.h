@@ -0,0 +1,36 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+// Measures the phases of the startup. The log window does not exist for the first phases, so they are collected and logged
+// as one summary once the main window is interactive. Message thread only.
+class StartupProfile {
+public:
+	static StartupProfile &instance();
+
+	// Ends the phase running since the previous call, or since the launch
+	void phaseDone(std::string const &phase);
+	// The window is usable from here on, all phases after this one run deferred
+	void markInteractive();
+	// Logs the phases and the time to interactive, only the first call logs
+	void logSummary();
+
+private:
+	StartupProfile();
+
+	double launchMs_;
+	double lastMs_;
+	double interactiveMs_ = 0.0;
+	std::vector<std::pair<std::string, double>> phases_;
+	bool logged_ = false;
+};
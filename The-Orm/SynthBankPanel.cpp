@@ -35,6 +35,19 @@ SynthBankPanel::SynthBankPanel(midikraft::PatchDatabase& patchDatabase, PatchVie
 		}
 	};
 
+	compareButton_.setButtonText("Compare with synth");
+	compareButton_.onClick = [this]() {
+		if (patchView_ && synthBank_) {
+			auto compared = synthBank_;
+			patchView_->compareBankWithSynth(compared, [this, compared]() {
+				if (synthBank_ == compared) {
+					refreshHeader();
+					bankList_->setDifferences(patchView_->differencesFromSynth(synthBank_));
+				}
+			});
+		}
+	};
+
 	saveButton_.setButtonText("Save to database");
 	saveButton_.onClick = [this]() {
 		patchDatabase_.putPatchList(synthBank_);
@@ -46,13 +59,13 @@ SynthBankPanel::SynthBankPanel(midikraft::PatchDatabase& patchDatabase, PatchVie
 	sendButton_.onClick = [this]() {
 		if (patchView_ && synthBank_) {
 			if (isUserBank()) {
-				patchView_->sendBankToSynth(synthBank_, true,  []() {
+				patchView_->sendBankToSynth(synthBank_, false, []() {
 					spdlog::info("Bank sent successfully!");
 				});
 			} 
 			else
 			{
-				patchView_->sendBankToSynth(synthBank_, false, [this]() {
+				patchView_->sendBankToSynth(synthBank_, true, [this]() {
 					// Save it in the database now that we have successfully sent it to the synth
 					patchDatabase_.putPatchList(synthBank_);
 					// Mark the bank as not modified
@@ -68,7 +81,7 @@ SynthBankPanel::SynthBankPanel(midikraft::PatchDatabase& patchDatabase, PatchVie
 			std::vector<midikraft::PatchHolder> result;
 			if (patchDatabase_.getSinglePatch(synthBank_->synth(), md5, result)) {
 				synthBank_->changePatchAtPosition(programPlace, result[0]);
-				refresh();
+				slotsChanged(programPlace.toZeroBasedDiscardingBank(), 1);
 			}
 			else {
 				spdlog::error("Program error - dropped patch that cannot be found in the database");
@@ -81,7 +94,7 @@ SynthBankPanel::SynthBankPanel(midikraft::PatchDatabase& patchDatabase, PatchVie
 				if (list) {
 					// Insert the list into the bank...
 					synthBank_->copyListToPosition(program, *list);
-					refresh();
+					slotsChanged(program.toZeroBasedDiscardingBank(), (int) list->patches().size());
 				}
 			}
 		}
@@ -107,6 +120,7 @@ SynthBankPanel::SynthBankPanel(midikraft::PatchDatabase& patchDatabase, PatchVie
 	addAndMakeVisible(synthName_);
 	addAndMakeVisible(bankNameAndDate_);
 	addAndMakeVisible(resyncButton_);
+	addAndMakeVisible(compareButton_);
 	addAndMakeVisible(saveButton_);
 	addAndMakeVisible(sendButton_);
 	addAndMakeVisible(modified_);
@@ -138,6 +152,18 @@ void SynthBankPanel::setBank(std::shared_ptr<midikraft::SynthBank> synthBank, Pa
 }
 
 void SynthBankPanel::refresh() {
+	refreshHeader();
+	bankList_->setPatches(synthBank_, buttonMode_);
+	bankList_->setDifferences(patchView_ ? patchView_->differencesFromSynth(synthBank_) : std::set<int>());
+}
+
+void SynthBankPanel::slotsChanged(int firstSlot, int numSlots)
+{
+	refreshHeader();
+	bankList_->refreshRows(firstSlot, numSlots);
+}
+
+void SynthBankPanel::refreshHeader() {
 	synthName_.setText(synthBank_->synth()->getName(), dontSendNotification);
 	if (auto activeBank = std::dynamic_pointer_cast<midikraft::ActiveSynthBank>(synthBank_))
 	{
@@ -156,8 +182,12 @@ void SynthBankPanel::refresh() {
 	{
 		bankNameAndDate_.setText(fmt::format("Bank '{}' loading into '{}'", synthBank_->name(), synthBank_->targetBankName()), dontSendNotification);
 	}
-	bankList_->setPatches(synthBank_, buttonMode_);
-	modified_.setText(synthBank_->isDirty() ? "modified" : "", dontSendNotification);
+	auto differing = patchView_ ? patchView_->differencesFromSynth(synthBank_).size() : 0;
+	std::string modifiedText = synthBank_->isDirty() ? "modified" : "";
+	if (differing > 0) {
+		modifiedText += fmt::format("{}{} slots differ in the synth", modifiedText.empty() ? "" : ", ", differing);
+	}
+	modified_.setText(modifiedText, dontSendNotification);
 	showInfoIfRequired();
 }
 
@@ -174,7 +204,9 @@ void SynthBankPanel::resized()
 	auto upperButton = headerRightSide.removeFromTop(LAYOUT_BUTTON_HEIGHT);
 	resyncButton_.setBounds(upperButton);
 	saveButton_.setBounds(upperButton);
-	sendButton_.setBounds(headerRightSide.removeFromTop(LAYOUT_BUTTON_HEIGHT + LAYOUT_INSET_NORMAL).withTrimmedTop(LAYOUT_INSET_NORMAL));
+	auto lowerButton = headerRightSide.removeFromTop(LAYOUT_BUTTON_HEIGHT + LAYOUT_INSET_NORMAL).withTrimmedTop(LAYOUT_INSET_NORMAL);
+	sendButton_.setBounds(lowerButton);
+	compareButton_.setBounds(header.removeFromRight(LAYOUT_BUTTON_WIDTH + LAYOUT_INSET_NORMAL).withTrimmedLeft(LAYOUT_INSET_NORMAL).withY(lowerButton.getY()).withHeight(lowerButton.getHeight()));
 	synthName_.setBounds(header.removeFromTop(LAYOUT_LARGE_LINE_HEIGHT));
 	bankNameAndDate_.setBounds(header.removeFromTop(LAYOUT_TEXT_LINE_HEIGHT));
 	modified_.setBounds(header.removeFromTop(LAYOUT_TEXT_LINE_HEIGHT));
@@ -200,6 +232,7 @@ void SynthBankPanel::showInfoIfRequired() {
 	modified_.setVisible(showBank);
 	bool isUser = isUserBank();
 	resyncButton_.setVisible(showBank && !isUser);
+	compareButton_.setVisible(showBank && !isUser);
 	saveButton_.setVisible(showBank && isUser && synthBank_->isDirty());
 	sendButton_.setVisible(showBank && synthBank_->isWritable());
 }
\ No newline at end of file
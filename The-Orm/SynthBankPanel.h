@@ -29,6 +29,9 @@ private:
 	virtual void changeListenerCallback(ChangeBroadcaster* source) override;
 
 	void refresh();
+	// The patches in these slots of the bank have been changed, refresh only them
+	void slotsChanged(int firstSlot, int numSlots);
+	void refreshHeader();
 	bool isUserBank();
 	void showInfoIfRequired();
 
@@ -41,6 +44,7 @@ private:
 	Label bankNameAndDate_;
 	Label modified_;
 	TextButton resyncButton_;
+	TextButton compareButton_;
 	TextButton saveButton_;
 	TextButton sendButton_;
 	std::unique_ptr<VerticalPatchButtonList> bankList_;
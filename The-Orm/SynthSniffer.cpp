@@ -0,0 +1,118 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "SynthSniffer.h"
+
+#include "GenericAdaptation.h"
+
+#include <set>
+
+SynthSniffer::SynthSniffer(std::vector<std::shared_ptr<midikraft::Synth>> const &synths)
+{
+	nodes_.emplace_back();
+	for (auto const &synth : synths) {
+		auto adaptation = std::dynamic_pointer_cast<knobkraft::GenericAdaptation>(synth);
+		if (!adaptation) {
+			native_.push_back(synth);
+			continue;
+		}
+		auto headers = adaptation->sysexPrefilter().headers();
+		if (headers.empty()) {
+			undecided_.push_back(synth);
+			continue;
+		}
+		synths_.push_back(synth);
+		for (auto const &header : headers) {
+			insert(header, synths_.size() - 1);
+		}
+	}
+}
+
+size_t SynthSniffer::child(size_t node, int headerByte)
+{
+	if (headerByte == knobkraft::SysexPrefilter::kAnyByte) {
+		if (nodes_[node].wildcard == 0) {
+			nodes_[node].wildcard = nodes_.size();
+			nodes_.emplace_back();
+		}
+		return nodes_[node].wildcard;
+	}
+	auto value = (uint8) headerByte;
+	auto found = nodes_[node].children.find(value);
+	if (found != nodes_[node].children.end()) {
+		return found->second;
+	}
+	size_t created = nodes_.size();
+	nodes_[node].children[value] = created;
+	nodes_.emplace_back();
+	return created;
+}
+
+void SynthSniffer::insert(std::vector<int> const &header, size_t synth)
+{
+	size_t node = 0;
+	for (auto headerByte : header) {
+		node = child(node, headerByte);
+	}
+	nodes_[node].synths.push_back(synth);
+}
+
+std::vector<std::shared_ptr<midikraft::Synth>> SynthSniffer::candidates(MidiMessage const &message) const
+{
+	std::vector<std::shared_ptr<midikraft::Synth>> result;
+	if (!message.isSysEx()) {
+		return result;
+	}
+	auto data = message.getSysExData();
+	auto size = (size_t) message.getSysExDataSize();
+
+	// Walk all paths matching the message, they only fork where a header has a wildcard
+	std::set<size_t> found;
+	std::vector<std::pair<size_t, size_t>> open{ { 0, 0 } }; // Node and the index of the next byte
+	while (!open.empty()) {
+		auto [node, position] = open.back();
+		open.pop_back();
+		found.insert(nodes_[node].synths.begin(), nodes_[node].synths.end());
+		if (position >= size) {
+			continue;
+		}
+		auto exact = nodes_[node].children.find(data[position]);
+		if (exact != nodes_[node].children.end()) {
+			open.emplace_back(exact->second, position + 1);
+		}
+		if (nodes_[node].wildcard != 0) {
+			open.emplace_back(nodes_[node].wildcard, position + 1);
+		}
+	}
+	for (auto index : found) {
+		result.push_back(synths_[index]);
+	}
+	for (auto const &synth : native_) {
+		if (synth->isOwnSysex(message)) {
+			result.push_back(synth);
+		}
+	}
+	return result;
+}
+
+std::vector<std::shared_ptr<midikraft::Synth>> const &SynthSniffer::undecided() const
+{
+	return undecided_;
+}
+
+std::map<std::string, std::vector<MidiMessage>> SynthSniffer::partition(std::vector<MidiMessage> const &messages) const
+{
+	std::map<std::string, std::vector<MidiMessage>> result;
+	for (auto const &message : messages) {
+		for (auto const &synth : candidates(message)) {
+			result[synth->getName()].push_back(message);
+		}
+	}
+	for (auto const &synth : undecided_) {
+		result[synth->getName()] = messages;
+	}
+	return result;
+}
@@ -0,0 +1,48 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include "Synth.h"
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Finds the synths a sysex message might belong to without asking every adaptation in Python. The declared sysex headers
+// of all adaptations are put into one trie, so a message is looked up in the length of its header however many adaptations
+// there are. The built-in synths answer with their own isOwnSysex() in C++. Adaptations that declare no headers can't
+// be indexed, they are reported as undecided and need to look at the messages themselves.
+// Build it again after adaptations have been reloaded. Lookups don't change the index and can run on any number of threads.
+class SynthSniffer {
+public:
+	explicit SynthSniffer(std::vector<std::shared_ptr<midikraft::Synth>> const &synths);
+
+	// The indexed synths that might own the message, nothing for messages that are not sysex
+	std::vector<std::shared_ptr<midikraft::Synth>> candidates(MidiMessage const &message) const;
+	std::vector<std::shared_ptr<midikraft::Synth>> const &undecided() const;
+
+	// The messages each candidate synth should load, in the order of the file. The undecided synths get all messages
+	std::map<std::string, std::vector<MidiMessage>> partition(std::vector<MidiMessage> const &messages) const;
+
+private:
+	struct Node {
+		std::map<uint8, size_t> children;
+		size_t wildcard = 0; // Child for a header byte that matches every value, 0 if none as the root is never a child
+		std::vector<size_t> synths; // Indexes into synths_ of the headers ending here
+	};
+
+	void insert(std::vector<int> const &header, size_t synth);
+	size_t child(size_t node, int headerByte);
+
+	std::vector<std::shared_ptr<midikraft::Synth>> synths_;
+	std::vector<Node> nodes_;
+	std::vector<std::shared_ptr<midikraft::Synth>> native_;
+	std::vector<std::shared_ptr<midikraft::Synth>> undecided_;
+};
@@ -0,0 +1,86 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "SysexArena.h"
+
+void SysexArena::append(uint8 const *data, size_t size)
+{
+	entries_.push_back({ bytes_.size(), size });
+	bytes_.insert(bytes_.end(), data, data + size);
+}
+
+void SysexArena::append(MidiMessage const &message)
+{
+	append(message.getRawData(), (size_t) message.getRawDataSize());
+}
+
+void SysexArena::takeAll(SysexArena &other)
+{
+	if (empty()) {
+		// The common case of draining a pending arena, just trade the buffers
+		std::swap(bytes_, other.bytes_);
+		std::swap(entries_, other.entries_);
+	}
+	else {
+		size_t base = bytes_.size();
+		bytes_.insert(bytes_.end(), other.bytes_.begin(), other.bytes_.end());
+		for (auto const &entry : other.entries_) {
+			entries_.push_back({ base + entry.offset, entry.size });
+		}
+	}
+	other.clear();
+}
+
+void SysexArena::dropFront(size_t count)
+{
+	if (count >= entries_.size()) {
+		clear();
+		return;
+	}
+	size_t cut = entries_[count].offset;
+	bytes_.erase(bytes_.begin(), bytes_.begin() + (std::ptrdiff_t) cut);
+	entries_.erase(entries_.begin(), entries_.begin() + (std::ptrdiff_t) count);
+	for (auto &entry : entries_) {
+		entry.offset -= cut;
+	}
+}
+
+void SysexArena::clear()
+{
+	bytes_.clear();
+	entries_.clear();
+}
+
+size_t SysexArena::size() const
+{
+	return entries_.size();
+}
+
+bool SysexArena::empty() const
+{
+	return entries_.empty();
+}
+
+size_t SysexArena::bytes() const
+{
+	return bytes_.size();
+}
+
+SysexArena::View SysexArena::view(size_t index) const
+{
+	auto const &entry = entries_[index];
+	return { bytes_.data() + entry.offset, entry.size };
+}
+
+std::vector<MidiMessage> SysexArena::messages() const
+{
+	std::vector<MidiMessage> result;
+	result.reserve(entries_.size());
+	for (auto const &entry : entries_) {
+		result.emplace_back(bytes_.data() + entry.offset, (int) entry.size);
+	}
+	return result;
+}
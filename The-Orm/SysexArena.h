@@ -0,0 +1,48 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include <vector>
+
+// Keeps the messages of one download in a single byte buffer, instead of one heap block per MidiMessage. Messages are
+// appended and read back as views into that buffer, and clear() keeps the capacity, so a capture that is drained and
+// refilled stops allocating once the buffers have grown to the largest burst. Views are only valid until the next change.
+// Not thread safe, guard it like any other container
+class SysexArena {
+public:
+	struct View {
+		uint8 const *data;
+		size_t size;
+	};
+
+	void append(uint8 const *data, size_t size);
+	void append(MidiMessage const &message);
+	// Moves all messages of other to the end of this arena, other is empty afterwards but keeps its capacity
+	void takeAll(SysexArena &other);
+	// Drops the first count messages, the remaining ones move to the front
+	void dropFront(size_t count);
+	void clear();
+
+	size_t size() const;
+	bool empty() const;
+	size_t bytes() const;
+	View view(size_t index) const;
+
+	// For APIs taking MidiMessages, this is the only place the bytes are copied again
+	std::vector<MidiMessage> messages() const;
+
+private:
+	struct Entry {
+		size_t offset;
+		size_t size;
+	};
+
+	std::vector<uint8> bytes_;
+	std::vector<Entry> entries_;
+};
@@ -0,0 +1,221 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "SysexExportJob.h"
+
+#include "ParallelFor.h"
+#include "Settings.h"
+
+#include "Capability.h"
+#include "EditBufferCapability.h"
+#include "Patch.h"
+#include "ProgramDumpCapability.h"
+#include "GenericAdaptation.h"
+
+#include <spdlog/spdlog.h>
+#include "SpdLogJuce.h"
+
+#include <fmt/format.h>
+
+namespace {
+	// Share of the progress bar for the pages when the zip file is built afterwards
+	constexpr double kZipPagesShare = 0.8;
+}
+
+SysexExportJob::SysexExportJob(File const &database, midikraft::PatchFilter const &filter, midikraft::Librarian::ExportParameters params, File destination) :
+	BackgroundJob("Exporting patches to " + destination.getFileName()), databaseFile_(database), filter_(filter), params_(params), destination_(destination)
+{
+}
+
+size_t SysexExportJob::patchesWritten() const
+{
+	return written_;
+}
+
+size_t SysexExportJob::patchesSkipped() const
+{
+	return skipped_;
+}
+
+bool SysexExportJob::canExport(midikraft::Librarian::ExportParameters const &params)
+{
+	return params.fileOption != midikraft::Librarian::MID_FILE;
+}
+
+bool SysexExportJob::chooseDestination(midikraft::Librarian::ExportParameters const &params, File &outDestination)
+{
+	File lastPath(Settings::instance().get("lastExportPath", File::getSpecialLocation(File::userDocumentsDirectory).getFullPathName().toStdString()));
+	if (params.fileOption == midikraft::Librarian::MANY_FILES) {
+		FileChooser chooser("Please select the directory to export the patches to...", lastPath);
+		if (!chooser.browseForDirectory()) {
+			return false;
+		}
+		outDestination = chooser.getResult();
+	}
+	else {
+		bool zipped = params.fileOption == midikraft::Librarian::ZIPPED_FILES;
+		FileChooser chooser(zipped ? "Please enter the name of the zip file to create..." : "Please enter the name of the sysex file to create...", lastPath, zipped ? "*.zip" : "*.syx");
+		if (!chooser.browseForFileToSave(true)) {
+			return false;
+		}
+		outDestination = chooser.getResult();
+	}
+	Settings::instance().set("lastExportPath", (outDestination.isDirectory() ? outDestination : outDestination.getParentDirectory()).getFullPathName().toStdString());
+	return true;
+}
+
+bool SysexExportJob::run()
+{
+	try {
+		database_ = std::make_unique<midikraft::PatchDatabase>(databaseFile_.getFullPathName().toStdString(), midikraft::PatchDatabase::OpenMode::READ_ONLY);
+	}
+	catch (std::exception &e) {
+		spdlog::error("Failed to open {} for the export: {}", databaseFile_.getFullPathName(), e.what());
+		return false;
+	}
+	switch (params_.fileOption) {
+	case midikraft::Librarian::ONE_FILE: {
+		destination_.deleteFile();
+		FileOutputStream oneFile(destination_, kWriteBufferBytes);
+		if (!oneFile.openedOk()) {
+			spdlog::error("Failed to open {} for writing", destination_.getFullPathName());
+			return false;
+		}
+		return exportPages(&oneFile, {}, 1.0) && oneFile.getStatus().wasOk();
+	}
+	case midikraft::Librarian::ZIPPED_FILES: {
+		auto directory = File::getSpecialLocation(File::tempDirectory).getNonexistentChildFile("KnobKraftExport", "", false);
+		if (!directory.createDirectory()) {
+			spdlog::error("Failed to create temporary directory {}", directory.getFullPathName());
+			return false;
+		}
+		bool completed = exportPages(nullptr, directory, kZipPagesShare) && zipDirectory(directory);
+		directory.deleteRecursively();
+		return completed;
+	}
+	default:
+		return exportPages(nullptr, destination_, 1.0);
+	}
+}
+
+bool SysexExportJob::exportPages(FileOutputStream *oneFile, File const &directory, double progressTo)
+{
+	setStatus("Counting patches");
+	int total = database_->getPatchesCount(filter_);
+	for (int skip = 0; skip < total; skip += kPatchesPerPage) {
+		if (shouldExit()) {
+			return false;
+		}
+		auto page = database_->getPatches(filter_, skip, kPatchesPerPage);
+		if (page.empty()) {
+			break;
+		}
+
+		std::vector<size_t> native;
+		std::vector<size_t> python;
+		for (size_t i = 0; i < page.size(); i++) {
+			(std::dynamic_pointer_cast<knobkraft::GenericAdaptation>(page[i].smartSynth()) ? python : native).push_back(i);
+		}
+		std::vector<std::vector<MidiMessage>> sysex(page.size());
+		if (!parallelFor(native.size(), [this, &page, &native, &sysex](size_t i) {
+			sysex[native[i]] = convert(page[native[i]]);
+		}, [this](double) { return !shouldExit(); })) {
+			return false;
+		}
+		for (auto i : python) {
+			if (shouldExit()) {
+				return false;
+			}
+			sysex[i] = convert(page[i]);
+		}
+
+		for (size_t i = 0; i < page.size(); i++) {
+			if (sysex[i].empty()) {
+				skipped_++;
+				continue;
+			}
+			if (!writePatch(page[i], sysex[i], oneFile, directory)) {
+				return false;
+			}
+			written_++;
+		}
+		setProgress(progressTo * (skip + page.size()) / (double)total);
+		setStatus(fmt::format("{} of {} patches exported", written_.load(), total));
+	}
+	if (skipped_ > 0) {
+		spdlog::warn("{} patches could not be converted into sysex and were not exported", skipped_.load());
+	}
+	return true;
+}
+
+std::vector<MidiMessage> SysexExportJob::convert(midikraft::PatchHolder const &patch) const
+{
+	auto synth = patch.smartSynth();
+	if (!synth || !patch.patch()) {
+		return {};
+	}
+	try {
+		// The capabilities only know patches, other data types and synths without them convert through the synth itself
+		if (std::dynamic_pointer_cast<midikraft::Patch>(patch.patch())) {
+			auto programDump = midikraft::Capability::hasCapability<midikraft::ProgramDumpCabability>(synth);
+			auto editBuffer = midikraft::Capability::hasCapability<midikraft::EditBufferCapability>(synth);
+			if (programDump && (params_.formatOption == midikraft::Librarian::PROGRAM_DUMPS || !editBuffer)) {
+				return programDump->patchToProgramDumpSysex(patch.patch(), patch.patchNumber());
+			}
+			if (editBuffer) {
+				return editBuffer->patchToSysex(patch.patch());
+			}
+		}
+		return synth->dataFileToSysex(patch.patch(), nullptr);
+	}
+	catch (std::exception &e) {
+		spdlog::error("Failed to convert patch {} into sysex: {}", patch.name(), e.what());
+	}
+	return {};
+}
+
+bool SysexExportJob::writePatch(midikraft::PatchHolder const &patch, std::vector<MidiMessage> const &messages, FileOutputStream *oneFile, File const &directory)
+{
+	OutputStream *out = oneFile;
+	if (!out) {
+		buffer_.reset();
+		out = &buffer_;
+	}
+	for (auto const &message : messages) {
+		if (!out->write(message.getRawData(), (size_t)message.getRawDataSize())) {
+			spdlog::error("Failed to write to {}", destination_.getFullPathName());
+			return false;
+		}
+	}
+	if (!oneFile) {
+		auto file = directory.getNonexistentChildFile(File::createLegalFileName(patch.name()), ".syx", false);
+		if (!file.replaceWithData(buffer_.getData(), buffer_.getDataSize())) {
+			spdlog::error("Failed to write {}", file.getFullPathName());
+			return false;
+		}
+	}
+	return true;
+}
+
+bool SysexExportJob::zipDirectory(File const &directory)
+{
+	setStatus("Creating zip file");
+	// The builder reads each file only while writing the zip, so the patches are not all in memory at once
+	ZipFile::Builder builder;
+	for (auto const &file : directory.findChildFiles(File::findFiles, false, "*.syx")) {
+		builder.addFile(file, 9, file.getFileName());
+	}
+	destination_.deleteFile();
+	FileOutputStream out(destination_, kWriteBufferBytes);
+	if (!out.openedOk()) {
+		spdlog::error("Failed to open {} for writing", destination_.getFullPathName());
+		return false;
+	}
+	double zipProgress = 0.0;
+	bool written = builder.writeToStream(out, &zipProgress);
+	setProgress(1.0);
+	return written && out.getStatus().wasOk();
+}
@@ -0,0 +1,51 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include "BackgroundJobs.h"
+#include "Librarian.h"
+#include "PatchDatabase.h"
+
+// Exports the patches of a filter as sysex, page by page, so a large library is never held in memory at once. The
+// patches of a page are converted before the page is written: those of C++ synths on all cores, those of Python
+// adaptations in one run on the job thread, as they all need the interpreter anyway. Single files go through a write
+// buffer, a zip file is built from the separate files written into a temporary directory. The job reads through its own
+// read-only connection to the database file, the connection of the UI is never touched from the job thread
+class SysexExportJob : public BackgroundJob {
+public:
+	SysexExportJob(File const &database, midikraft::PatchFilter const &filter, midikraft::Librarian::ExportParameters params, File destination);
+
+	virtual bool run() override;
+
+	size_t patchesWritten() const;
+	size_t patchesSkipped() const;
+
+	// MIDI files are left to the Librarian
+	static bool canExport(midikraft::Librarian::ExportParameters const &params);
+	// Asks for the file or, for separate files, the directory to write to
+	static bool chooseDestination(midikraft::Librarian::ExportParameters const &params, File &outDestination);
+
+	static constexpr int kPatchesPerPage = 500;
+	static constexpr size_t kWriteBufferBytes = 1 << 16;
+
+private:
+	bool exportPages(FileOutputStream *oneFile, File const &directory, double progressTo);
+	std::vector<MidiMessage> convert(midikraft::PatchHolder const &patch) const;
+	bool writePatch(midikraft::PatchHolder const &patch, std::vector<MidiMessage> const &messages, FileOutputStream *oneFile, File const &directory);
+	bool zipDirectory(File const &directory);
+
+	File databaseFile_;
+	std::unique_ptr<midikraft::PatchDatabase> database_; // Opened by run()
+	midikraft::PatchFilter filter_;
+	midikraft::Librarian::ExportParameters params_;
+	File destination_;
+	MemoryOutputStream buffer_; // Reused for each of the separate files
+	std::atomic<size_t> written_ { 0 };
+	std::atomic<size_t> skipped_ { 0 };
+};
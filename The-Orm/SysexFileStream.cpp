@@ -0,0 +1,65 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "SysexFileStream.h"
+
+#include <cstring>
+
+SysexFileStream::SysexFileStream(File const &file)
+{
+	mapping_ = std::make_unique<MemoryMappedFile>(file, MemoryMappedFile::readOnly);
+	if (mapping_->getData() != nullptr) {
+		data_ = static_cast<uint8 const *>(mapping_->getData());
+		size_ = mapping_->getSize();
+	}
+}
+
+bool SysexFileStream::isOpen() const
+{
+	return data_ != nullptr;
+}
+
+bool SysexFileStream::nextMessage(uint8 const *&outData, size_t &outSize)
+{
+	while (position_ < size_) {
+		auto start = static_cast<uint8 const *>(memchr(data_ + position_, 0xf0, size_ - position_));
+		if (!start) {
+			break;
+		}
+		size_t begin = (size_t) (start - data_);
+		// Any status byte ends the message, a proper one with F7, a broken one with the next F0 or anything else
+		size_t end = begin + 1;
+		while (end < size_ && (data_[end] & 0x80) == 0) {
+			end++;
+		}
+		if (end < size_ && data_[end] == 0xf7) {
+			outData = start;
+			outSize = end - begin + 1;
+			position_ = end + 1;
+			return true;
+		}
+		position_ = end;
+	}
+	position_ = size_;
+	return false;
+}
+
+bool SysexFileStream::nextChunk(size_t maxMessages, std::vector<MidiMessage> &outMessages)
+{
+	bool found = false;
+	uint8 const *message;
+	size_t size;
+	for (size_t i = 0; i < maxMessages && nextMessage(message, size); i++) {
+		outMessages.emplace_back(message, (int) size);
+		found = true;
+	}
+	return found;
+}
+
+double SysexFileStream::progress() const
+{
+	return size_ > 0 ? position_ / (double) size_ : 1.0;
+}
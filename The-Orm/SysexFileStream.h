@@ -0,0 +1,35 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include <memory>
+#include <vector>
+
+// Reads the sysex messages of a file of any size through a memory mapping, so the file is never loaded as a whole.
+// Messages are handed out as spans into the mapping, or in chunks of MidiMessages, so only one chunk is in memory at a time.
+// Bytes outside of F0 ... F7 and sysex messages with stray status bytes are skipped, as they would be by the JUCE parser
+class SysexFileStream {
+public:
+	explicit SysexFileStream(File const &file);
+
+	bool isOpen() const;
+
+	// The span is valid as long as this stream lives. Returns false at the end of the file
+	bool nextMessage(uint8 const *&outData, size_t &outSize);
+	// Appends up to maxMessages messages, returns false if there was no message left
+	bool nextChunk(size_t maxMessages, std::vector<MidiMessage> &outMessages);
+
+	double progress() const;
+
+private:
+	std::unique_ptr<MemoryMappedFile> mapping_;
+	uint8 const *data_ = nullptr;
+	size_t size_ = 0;
+	size_t position_ = 0;
+};
@@ -0,0 +1,107 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "SysexReassembler.h"
+
+#include <spdlog/spdlog.h>
+
+namespace {
+
+	constexpr uint8 kSysexStart = 0xf0;
+	constexpr uint8 kSysexEnd = 0xf7;
+	constexpr uint8 kFirstRealtime = 0xf8;
+	constexpr size_t kInitialCapacity = 4096; // Most single program dumps fit
+
+}
+
+SysexReassembler::SysexReassembler(TSysexHandler onSysex, TMessageHandler onMessage) : onSysex_(onSysex), onMessage_(onMessage)
+{
+	buffer_.reserve(kInitialCapacity);
+}
+
+void SysexReassembler::push(MidiMessage const &message)
+{
+	auto data = message.getRawData();
+	auto size = (size_t) message.getRawDataSize();
+	if (size == 0) {
+		return;
+	}
+	if (data[0] >= kFirstRealtime) {
+		onMessage_(message);
+	}
+	else if (data[0] == kSysexStart && data[size - 1] == kSysexEnd && !collecting_) {
+		// The usual case, nothing to put together
+		onSysex_(data, size);
+	}
+	else if (data[0] == kSysexStart || (collecting_ && data[0] < 0x80)) {
+		// A fragment, the first one or a continuation
+		push(data, size);
+	}
+	else {
+		if (collecting_) {
+			truncated();
+		}
+		onMessage_(message);
+	}
+}
+
+void SysexReassembler::push(uint8 const *data, size_t size)
+{
+	for (size_t i = 0; i < size; i++) {
+		auto byte = data[i];
+		if (byte >= kFirstRealtime) {
+			uint8 realtime[1] = { byte };
+			onMessage_(MidiMessage(realtime, 1));
+		}
+		else if (byte == kSysexStart) {
+			if (collecting_) {
+				truncated();
+			}
+			buffer_.clear();
+			buffer_.push_back(byte);
+			collecting_ = true;
+		}
+		else if (!collecting_) {
+			// Not inside a sysex, the raw stream only carries sysex
+			continue;
+		}
+		else if (byte == kSysexEnd) {
+			buffer_.push_back(byte);
+			collecting_ = false;
+			onSysex_(buffer_.data(), buffer_.size());
+			buffer_.clear();
+		}
+		else if (byte < 0x80) {
+			buffer_.push_back(byte);
+		}
+		else {
+			truncated();
+		}
+	}
+}
+
+void SysexReassembler::reset()
+{
+	collecting_ = false;
+	buffer_.clear();
+}
+
+bool SysexReassembler::isCollecting() const
+{
+	return collecting_;
+}
+
+size_t SysexReassembler::truncatedMessages() const
+{
+	return truncated_;
+}
+
+void SysexReassembler::truncated()
+{
+	spdlog::warn("Dropping a sysex message cut off after {} bytes", buffer_.size());
+	truncated_++;
+	reset();
+}
@@ -0,0 +1,45 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include <functional>
+#include <vector>
+
+// Puts long sysex back together that arrives in several pieces, as some USB interfaces and the network MIDI chunks deliver it.
+// Use one per input, from the one thread feeding it. The fragments are collected in a buffer that keeps its capacity, so a long
+// dump allocates only until the largest message fit once. Real-time messages in between are passed on right away without
+// disturbing the sysex, any other status byte ends an unfinished sysex, which is then dropped as truncated.
+class SysexReassembler {
+public:
+	// The bytes include F0 and F7 and are only valid during the call, copy them to keep them
+	typedef std::function<void(uint8 const *data, size_t size)> TSysexHandler;
+	// Everything that is not sysex
+	typedef std::function<void(MidiMessage const &message)> TMessageHandler;
+
+	SysexReassembler(TSysexHandler onSysex, TMessageHandler onMessage);
+
+	// A message as delivered by the MIDI input. Complete sysex is handed on without copying
+	void push(MidiMessage const &message);
+	// Raw sysex bytes, possibly with real-time bytes in between. Bytes outside of a sysex that are no real-time messages are ignored
+	void push(uint8 const *data, size_t size);
+	// Forget an unfinished sysex, e.g. when the input was closed
+	void reset();
+
+	bool isCollecting() const;
+	size_t truncatedMessages() const;
+
+private:
+	void truncated();
+
+	TSysexHandler onSysex_;
+	TMessageHandler onMessage_;
+	std::vector<uint8> buffer_;
+	bool collecting_ = false;
+	size_t truncated_ = 0;
+};
@@ -0,0 +1,138 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "ThumbnailLoader.h"
+
+#include "Metrics.h"
+#include "ThumbnailPack.h"
+#include "Tracer.h"
+#include "UIModel.h"
+
+ThumbnailLoader::ThumbnailLoader() : generation_(0), pool_(2),
+	hits_(Metrics::instance().counter("thumbnail.hits")), misses_(Metrics::instance().counter("thumbnail.misses"))
+{
+	// Only refers to the counters, which outlive this loader
+	Metrics::instance().setGauge("thumbnail.hit_rate", [hits = &hits_, misses = &misses_]() {
+		auto total = hits->value() + misses->value();
+		return total > 0 ? (double) hits->value() / (double) total : 0.0;
+	});
+
+	// Move the cache files of older versions into the pack, this runs only once per session
+	pool_.addJob([]() {
+		ThumbnailPack::instance().importLooseFiles(UIModel::getThumbnailDirectory());
+	});
+}
+
+ThumbnailLoader::~ThumbnailLoader()
+{
+	pool_.removeAllJobs(true, 2000);
+}
+
+bool ThumbnailLoader::resolve(std::string const &md5, File const &cacheFile, File const &prehearFile, Result &outResult, std::function<void(Result)> callback)
+{
+	int generation;
+	{
+		ScopedLock lock(lock_);
+		if (missing_.count(md5)) {
+			hits_.add();
+			outResult = Result();
+			return true;
+		}
+		auto found = decodedIndex_.find(md5);
+		if (found != decodedIndex_.end()) {
+			hits_.add();
+			decoded_.splice(decoded_.begin(), decoded_, found->second);
+			outResult = found->second->second;
+			return true;
+		}
+		generation = generation_;
+	}
+	misses_.add();
+
+	// The file system might be slow, go to the background
+	pool_.addJob([this, md5, cacheFile, prehearFile, generation, callback]() {
+		TraceScope trace("Load thumbnail", "thumbnail");
+		Result result;
+		auto &pack = ThumbnailPack::instance();
+		if (cacheFile.existsAsFile()) {
+			// Freshly written by a button, decode and move it into the pack
+			result.kind = Result::Kind::CacheInfo;
+			result.cacheInfo = std::make_shared<TCacheInfo>(Thumbnail::loadCacheInfo(cacheFile));
+			MemoryBlock content;
+			if (cacheFile.loadFileAsData(content) && pack.write(md5, content.getData(), content.getSize())) {
+				cacheFile.deleteFile();
+			}
+		}
+		else if (pack.contains(md5)) {
+			// The Thumbnail class only decodes from a file, so hand it a temporary copy of the packed data
+			MemoryBlock content;
+			if (pack.read(md5, content)) {
+				TemporaryFile temp(cacheFile);
+				if (temp.getFile().replaceWithData(content.getData(), content.getSize())) {
+					result.kind = Result::Kind::CacheInfo;
+					result.cacheInfo = std::make_shared<TCacheInfo>(Thumbnail::loadCacheInfo(temp.getFile()));
+				}
+			}
+		}
+		else if (prehearFile.existsAsFile()) {
+			result.kind = Result::Kind::WavFile;
+			result.wavFile = prehearFile;
+		}
+		{
+			ScopedLock lock(lock_);
+			if (generation == generation_) {
+				store(md5, result);
+			}
+		}
+		MessageManager::callAsync([callback, result]() {
+			callback(result);
+		});
+	});
+	return false;
+}
+
+void ThumbnailLoader::store(std::string const &md5, Result const &result)
+{
+	switch (result.kind) {
+	case Result::Kind::None:
+		if (missing_.size() >= kMaxKnownMissing) {
+			missing_.clear();
+		}
+		missing_.insert(md5);
+		break;
+	case Result::Kind::CacheInfo: {
+		auto existing = decodedIndex_.find(md5);
+		if (existing != decodedIndex_.end()) {
+			decoded_.erase(existing->second);
+		}
+		decoded_.emplace_front(md5, result);
+		decodedIndex_[md5] = decoded_.begin();
+		while (decoded_.size() > kMaxDecodedThumbnails) {
+			decodedIndex_.erase(decoded_.back().first);
+			decoded_.pop_back();
+		}
+		break;
+	}
+	case Result::Kind::WavFile:
+		// Not decoded yet, the button will create the cache file, so look again next time
+		break;
+	}
+}
+
+size_t ThumbnailLoader::decodedCount()
+{
+	ScopedLock lock(lock_);
+	return decoded_.size();
+}
+
+void ThumbnailLoader::invalidate()
+{
+	ScopedLock lock(lock_);
+	generation_++;
+	decoded_.clear();
+	decodedIndex_.clear();
+	missing_.clear();
+}
@@ -0,0 +1,60 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include "Thumbnail.h"
+#include "Metrics.h"
+
+#include <list>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+
+// Finds and decodes the thumbnails of patches on background threads, so a slow or network mounted thumbnail directory
+// does not block the UI. Decoded cache files are kept in memory, as well as which patches have no thumbnail at all.
+class ThumbnailLoader {
+public:
+	typedef decltype(Thumbnail::loadCacheInfo(File())) TCacheInfo;
+
+	struct Result {
+		enum class Kind { None, CacheInfo, WavFile };
+		Kind kind = Kind::None;
+		std::shared_ptr<TCacheInfo> cacheInfo; // For CacheInfo
+		File wavFile; // For WavFile, the button renders it and writes the cache file
+	};
+
+	ThumbnailLoader();
+	~ThumbnailLoader();
+
+	// Answers from memory if possible, and returns true then. Else the files are checked in the background and the
+	// callback is invoked on the message thread when done
+	bool resolve(std::string const &md5, File const &cacheFile, File const &prehearFile, Result &outResult, std::function<void(Result)> callback);
+
+	// Thumbnails have been created or changed, forget what we know
+	void invalidate();
+
+	// Number of decoded thumbnails held in memory
+	size_t decodedCount();
+
+	static constexpr size_t kMaxDecodedThumbnails = 512;
+	static constexpr size_t kMaxKnownMissing = 16384;
+
+private:
+	void store(std::string const &md5, Result const &result);
+
+	CriticalSection lock_;
+	std::list<std::pair<std::string, Result>> decoded_; // Most recently used first
+	std::map<std::string, std::list<std::pair<std::string, Result>>::iterator> decodedIndex_;
+	std::set<std::string> missing_;
+	int generation_;
+	ThreadPool pool_;
+	Metrics::Counter &hits_;
+	Metrics::Counter &misses_;
+};
@@ -0,0 +1,241 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "ThumbnailPack.h"
+
+#include "UIModel.h"
+
+#include <spdlog/spdlog.h>
+
+namespace {
+	const char kPackMagic[4] = { 'K', 'K', 'T', 'P' };
+	const uint32 kPackVersion = 1;
+	const uint32 kRecordMagic = 0x4b4b5243; // KKRC
+	const size_t kMd5Length = 32;
+	const int64 kHeaderSize = 8;
+	const int64 kRecordHeaderSize = 4 + (int64) kMd5Length + 1 + 4;
+	const uint8 kFlagRemoved = 1;
+}
+
+ThumbnailPack &ThumbnailPack::instance()
+{
+	static ThumbnailPack sInstance(UIModel::getThumbnailDirectory().getChildFile("thumbnails.kkpack"));
+	return sInstance;
+}
+
+ThumbnailPack::ThumbnailPack(File const &packFile) : packFile_(packFile), fileSize_(0), wasted_(0), importDone_(false)
+{
+	ScopedLock lock(lock_);
+	if (!load()) {
+		spdlog::warn("Thumbnail pack {} is damaged, starting a new one", packFile_.getFullPathName().toStdString());
+		packFile_.deleteFile();
+		index_.clear();
+		load();
+	}
+	if (wasted_ > (size_t) fileSize_ / 2 && fileSize_ > 1024 * 1024) {
+		compact();
+	}
+}
+
+bool ThumbnailPack::load()
+{
+	mapping_.reset();
+	index_.clear();
+	wasted_ = 0;
+	if (!packFile_.existsAsFile()) {
+		// Start a fresh pack
+		FileOutputStream out(packFile_);
+		if (!out.openedOk()) return false;
+		out.write(kPackMagic, 4);
+		out.writeInt((int) kPackVersion);
+		out.flush();
+		fileSize_ = kHeaderSize;
+		return true;
+	}
+
+	int64 pos = kHeaderSize;
+	int64 size;
+	{
+		MemoryMappedFile map(packFile_, MemoryMappedFile::readOnly);
+		auto data = static_cast<uint8 const *>(map.getData());
+		size = (int64) map.getSize();
+		if (!data || size < kHeaderSize || memcmp(data, kPackMagic, 4) != 0) {
+			return false;
+		}
+		while (pos + kRecordHeaderSize <= size) {
+			if ((uint32) ByteOrder::littleEndianInt(data + pos) != kRecordMagic) {
+				break;
+			}
+			std::string md5(reinterpret_cast<char const *>(data + pos + 4), kMd5Length);
+			uint8 flags = data[pos + 4 + kMd5Length];
+			uint32 length = (uint32) ByteOrder::littleEndianInt(data + pos + 4 + kMd5Length + 1);
+			int64 dataOffset = pos + kRecordHeaderSize;
+			if (dataOffset + length > size) {
+				// Torn write at the end, ignore the incomplete record
+				break;
+			}
+			auto existing = index_.find(md5);
+			if (existing != index_.end()) {
+				wasted_ += (size_t) (existing->second.length + kRecordHeaderSize);
+				index_.erase(existing);
+			}
+			if (flags & kFlagRemoved) {
+				wasted_ += (size_t) kRecordHeaderSize;
+			}
+			else {
+				index_[md5] = { dataOffset, length };
+			}
+			pos = dataOffset + length;
+		}
+	}
+	fileSize_ = pos;
+	if (pos < size) {
+		// Cut off whatever was not a valid record, so appending continues after the last good one. The file is not mapped anymore,
+		// which some systems require for truncating it
+		FileOutputStream out(packFile_);
+		if (out.openedOk()) {
+			out.setPosition(pos);
+			out.truncate();
+		}
+	}
+	return true;
+}
+
+void ThumbnailPack::ensureMapped() const
+{
+	if (!mapping_ || (int64) mapping_->getSize() < fileSize_) {
+		mapping_ = std::make_unique<MemoryMappedFile>(packFile_, MemoryMappedFile::readOnly);
+	}
+}
+
+bool ThumbnailPack::contains(std::string const &md5) const
+{
+	ScopedLock lock(lock_);
+	return index_.find(md5) != index_.end();
+}
+
+bool ThumbnailPack::read(std::string const &md5, MemoryBlock &outData) const
+{
+	ScopedLock lock(lock_);
+	auto found = index_.find(md5);
+	if (found == index_.end()) {
+		return false;
+	}
+	ensureMapped();
+	if (!mapping_->getData() || found->second.dataOffset + found->second.length > (int64) mapping_->getSize()) {
+		return false;
+	}
+	outData.replaceWith(static_cast<uint8 const *>(mapping_->getData()) + found->second.dataOffset, found->second.length);
+	return true;
+}
+
+bool ThumbnailPack::appendRecord(std::string const &md5, uint8 flags, void const *data, size_t size)
+{
+	if (md5.size() != kMd5Length) {
+		return false;
+	}
+	FileOutputStream out(packFile_);
+	if (!out.openedOk()) {
+		return false;
+	}
+	out.setPosition(fileSize_);
+	out.writeInt((int) kRecordMagic);
+	out.write(md5.data(), kMd5Length);
+	out.writeByte((char) flags);
+	out.writeInt((int) size);
+	if (size > 0) {
+		out.write(data, size);
+	}
+	out.flush();
+	if (out.getStatus().failed()) {
+		return false;
+	}
+	auto existing = index_.find(md5);
+	if (existing != index_.end()) {
+		wasted_ += (size_t) (existing->second.length + kRecordHeaderSize);
+		index_.erase(existing);
+	}
+	if (flags & kFlagRemoved) {
+		wasted_ += (size_t) kRecordHeaderSize;
+	}
+	else {
+		index_[md5] = { fileSize_ + kRecordHeaderSize, (uint32) size };
+	}
+	fileSize_ += kRecordHeaderSize + (int64) size;
+	return true;
+}
+
+bool ThumbnailPack::write(std::string const &md5, void const *data, size_t size)
+{
+	ScopedLock lock(lock_);
+	return appendRecord(md5, 0, data, size);
+}
+
+bool ThumbnailPack::remove(std::string const &md5)
+{
+	ScopedLock lock(lock_);
+	if (index_.find(md5) == index_.end()) {
+		return true;
+	}
+	return appendRecord(md5, kFlagRemoved, nullptr, 0);
+}
+
+size_t ThumbnailPack::wastedBytes() const
+{
+	ScopedLock lock(lock_);
+	return wasted_;
+}
+
+bool ThumbnailPack::compact()
+{
+	ScopedLock lock(lock_);
+	ensureMapped();
+	auto data = static_cast<uint8 const *>(mapping_->getData());
+	if (!data) {
+		return false;
+	}
+	TemporaryFile temp(packFile_);
+	{
+		FileOutputStream out(temp.getFile());
+		if (!out.openedOk()) return false;
+		out.write(kPackMagic, 4);
+		out.writeInt((int) kPackVersion);
+		for (auto const &entry : index_) {
+			out.writeInt((int) kRecordMagic);
+			out.write(entry.first.data(), kMd5Length);
+			out.writeByte(0);
+			out.writeInt((int) entry.second.length);
+			out.write(data + entry.second.dataOffset, entry.second.length);
+		}
+		out.flush();
+		if (out.getStatus().failed()) return false;
+	}
+	mapping_.reset();
+	if (!temp.overwriteTargetFileWithTemporary()) {
+		return false;
+	}
+	return load();
+}
+
+int ThumbnailPack::importLooseFiles(File const &directory)
+{
+	if (importDone_.exchange(true)) {
+		return 0;
+	}
+	int imported = 0;
+	for (auto const &entry : RangedDirectoryIterator(directory, false, "*.kkc", File::findFiles)) {
+		auto file = entry.getFile();
+		MemoryBlock content;
+		if (file.loadFileAsData(content) && write(file.getFileNameWithoutExtension().toStdString(), content.getData(), content.getSize())) {
+			file.deleteFile();
+			imported++;
+		}
+	}
+	if (imported > 0) {
+		spdlog::info("Moved {} thumbnail files into the thumbnail pack", imported);
+	}
+	return imported;
+}
@@ -0,0 +1,58 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <string>
+
+// Single append-only file holding the thumbnail cache data of all patches, keyed by the md5 of the patch. This replaces
+// one small .kkc file per patch in the thumbnail directory. Lookups are a map probe plus a pointer into the memory mapped pack.
+//
+// Layout: a file header followed by records of { magic, md5 (32 chars), flags, length, data }. Later records for the same
+// md5 supersede earlier ones, a record with the removed flag deletes the entry.
+class ThumbnailPack {
+public:
+	static ThumbnailPack &instance();
+
+	explicit ThumbnailPack(File const &packFile);
+
+	bool contains(std::string const &md5) const;
+	// Copy of the data, as the mapping can move when the pack grows
+	bool read(std::string const &md5, MemoryBlock &outData) const;
+	bool write(std::string const &md5, void const *data, size_t size);
+	bool remove(std::string const &md5);
+
+	// Rewrites the pack with only the live records
+	bool compact();
+	// Size of superseded and removed records
+	size_t wastedBytes() const;
+
+	// Moves existing .kkc files of the directory into the pack, once per session
+	int importLooseFiles(File const &directory);
+
+private:
+	struct Entry {
+		int64 dataOffset;
+		uint32 length;
+	};
+
+	bool load();
+	bool appendRecord(std::string const &md5, uint8 flags, void const *data, size_t size);
+	void ensureMapped() const;
+
+	File packFile_;
+	CriticalSection lock_;
+	std::map<std::string, Entry> index_;
+	int64 fileSize_;
+	size_t wasted_;
+	mutable std::unique_ptr<MemoryMappedFile> mapping_;
+	std::atomic<bool> importDone_;
+};
@@ -0,0 +1,95 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "Tracer.h"
+
+#include <nlohmann/json.hpp>
+
+#include <chrono>
+
+std::atomic<bool> Tracer::enabled_{ false };
+
+Tracer &Tracer::instance()
+{
+	static Tracer tracer;
+	return tracer;
+}
+
+int64 Tracer::nowMicros()
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Tracer::startCapture()
+{
+	// The buffers are not cleared, as other threads might be writing. The export skips everything older than the start instead
+	captureStartMicros_ = nowMicros();
+	enabled_ = true;
+}
+
+void Tracer::stopCapture()
+{
+	enabled_ = false;
+}
+
+void Tracer::complete(char const *name, char const *category, int64 startMicros, int64 durationMicros)
+{
+	auto &buffer = bufferOfThisThread();
+	uint64 index = buffer.written.load(std::memory_order_relaxed);
+	buffer.events[index % kEventsPerThread] = { name, category, startMicros, durationMicros };
+	buffer.written.store(index + 1, std::memory_order_release);
+}
+
+Tracer::ThreadBuffer &Tracer::bufferOfThisThread()
+{
+	thread_local ThreadBuffer *buffer = nullptr;
+	if (!buffer) {
+		auto created = std::make_unique<ThreadBuffer>();
+		if (MessageManager::existsAndIsCurrentThread()) {
+			created->threadName = "Message thread";
+		}
+		else if (auto thread = Thread::getCurrentThread()) {
+			created->threadName = thread->getThreadName().toStdString();
+		}
+		std::lock_guard<std::mutex> lock(buffersLock_);
+		created->threadId = (int) buffers_.size() + 1;
+		if (created->threadName.empty()) {
+			created->threadName = "Thread " + std::to_string(created->threadId);
+		}
+		buffer = created.get();
+		buffers_.push_back(std::move(created));
+	}
+	return *buffer;
+}
+
+int Tracer::exportChromeTrace(File const &file)
+{
+	int64 start = captureStartMicros_;
+	nlohmann::json events = nlohmann::json::array();
+	int count = 0;
+	{
+		std::lock_guard<std::mutex> lock(buffersLock_);
+		for (auto const &buffer : buffers_) {
+			events.push_back({ { "name", "thread_name" }, { "ph", "M" }, { "pid", 1 }, { "tid", buffer->threadId }, { "args", { { "name", buffer->threadName } } } });
+			// A thread still finishing an event might overwrite the oldest one while copying, so stop the capture before exporting
+			uint64 written = buffer->written.load(std::memory_order_acquire);
+			uint64 first = written > kEventsPerThread ? written - kEventsPerThread : 0;
+			for (uint64 i = first; i < written; i++) {
+				auto const &event = buffer->events[i % kEventsPerThread];
+				if (event.startMicros < start) {
+					continue;
+				}
+				events.push_back({ { "name", event.name }, { "cat", event.category }, { "ph", "X" }, { "pid", 1 }, { "tid", buffer->threadId },
+					{ "ts", event.startMicros - start }, { "dur", event.durationMicros } });
+				count++;
+			}
+		}
+	}
+	if (!file.replaceWithText(nlohmann::json({ { "traceEvents", events }, { "displayTimeUnit", "ms" } }).dump())) {
+		return -1;
+	}
+	return count;
+}
@@ -0,0 +1,81 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Collects timed events of the major pipelines while a capture is running, and exports them in the Chrome trace event format,
+// which chrome://tracing and Perfetto can open. Every thread writes into its own ring buffer without locking, the buffers
+// keep the last events of each thread. When no capture runs, recording costs a single relaxed atomic load.
+class Tracer {
+public:
+	static Tracer &instance();
+
+	static bool enabled() { return enabled_.load(std::memory_order_relaxed); }
+	static int64 nowMicros();
+
+	void startCapture();
+	void stopCapture();
+
+	// Names and categories need to be string literals, they are only stored as pointers
+	void complete(char const *name, char const *category, int64 startMicros, int64 durationMicros);
+
+	// Writes the events recorded since the last start of a capture, returns the number written or -1 if the file failed
+	int exportChromeTrace(File const &file);
+
+private:
+	struct Event {
+		char const *name;
+		char const *category;
+		int64 startMicros;
+		int64 durationMicros;
+	};
+
+	static constexpr size_t kEventsPerThread = 16384;
+
+	struct ThreadBuffer {
+		std::array<Event, kEventsPerThread> events;
+		std::atomic<uint64> written{ 0 };
+		int threadId;
+		std::string threadName;
+	};
+
+	ThreadBuffer &bufferOfThisThread();
+
+	static std::atomic<bool> enabled_;
+	std::atomic<int64> captureStartMicros_{ 0 };
+	std::mutex buffersLock_; // Only taken when a thread records its first event, and for the export
+	std::vector<std::unique_ptr<ThreadBuffer>> buffers_; // Never freed, a thread might end before the export
+};
+
+// Records the lifetime of the scope as one event, if a capture was running when it started
+class TraceScope {
+public:
+	TraceScope(char const *name, char const *category) : name_(Tracer::enabled() ? name : nullptr), category_(category), startMicros_(name_ ? Tracer::nowMicros() : 0) {
+	}
+
+	~TraceScope() {
+		if (name_) {
+			Tracer::instance().complete(name_, category_, startMicros_, Tracer::nowMicros() - startMicros_);
+		}
+	}
+
+	TraceScope(TraceScope const &) = delete;
+	TraceScope &operator=(TraceScope const &) = delete;
+
+private:
+	char const *name_;
+	char const *category_;
+	int64 startMicros_;
+};
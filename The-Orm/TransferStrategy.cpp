@@ -0,0 +1,118 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "TransferStrategy.h"
+
+#include "Capability.h"
+#include "MidiLocationCapability.h"
+#include "Settings.h"
+#include "SettingsWriteQueue.h"
+
+#include <fmt/format.h>
+#include <spdlog/spdlog.h>
+#include "SpdLogJuce.h"
+
+namespace {
+	// Transfers shorter than this are mostly latency, they say little about the rate
+	constexpr double kMinSecondsMeasured = 0.2;
+	// Weight of the newest measurement, so one slow transfer doesn't flip the choice
+	constexpr double kNewRateWeight = 0.3;
+}
+
+TransferStrategy::BankUpload TransferStrategy::chooseBankUpload(std::shared_ptr<midikraft::Synth> synth, size_t changedPrograms, size_t totalPrograms)
+{
+	auto fixed = override(synth);
+	if (fixed != BankUpload::Automatic) {
+		return fixed;
+	}
+	double programRate = uploadRate(synth, BankUpload::ChangedPrograms);
+	double bankRate = uploadRate(synth, BankUpload::WholeBank);
+	if (programRate <= 0.0 || bankRate <= 0.0) {
+		// Without both measurements nothing beats sending fewer patches. When all of them change anyway, use the
+		// chance to measure the whole bank
+		if (bankRate <= 0.0 && changedPrograms == totalPrograms) {
+			return BankUpload::WholeBank;
+		}
+		return BankUpload::ChangedPrograms;
+	}
+	double programSeconds = changedPrograms / programRate;
+	double bankSeconds = totalPrograms / bankRate;
+	return programSeconds <= bankSeconds ? BankUpload::ChangedPrograms : BankUpload::WholeBank;
+}
+
+void TransferStrategy::recordUpload(std::shared_ptr<midikraft::Synth> synth, BankUpload method, size_t patches, double seconds)
+{
+	if (method == BankUpload::Automatic) {
+		jassertfalse;
+		return;
+	}
+	record(rateSetting(synth, method == BankUpload::WholeBank ? "Upload bank" : "Upload programs"), patches, seconds);
+}
+
+void TransferStrategy::recordDownload(std::shared_ptr<midikraft::Synth> synth, size_t patches, double seconds)
+{
+	record(rateSetting(synth, "Download"), patches, seconds);
+}
+
+double TransferStrategy::uploadRate(std::shared_ptr<midikraft::Synth> synth, BankUpload method)
+{
+	if (method == BankUpload::Automatic) {
+		return 0.0;
+	}
+	return rate(rateSetting(synth, method == BankUpload::WholeBank ? "Upload bank" : "Upload programs"));
+}
+
+double TransferStrategy::downloadRate(std::shared_ptr<midikraft::Synth> synth)
+{
+	return rate(rateSetting(synth, "Download"));
+}
+
+TransferStrategy::BankUpload TransferStrategy::override(std::shared_ptr<midikraft::Synth> synth)
+{
+	if (!synth) {
+		return BankUpload::Automatic;
+	}
+	int stored = String(Settings::instance().get(fmt::format("BankUpload {}", synth->getName()), "1")).getIntValue();
+	switch (stored) {
+	case (int)BankUpload::ChangedPrograms: return BankUpload::ChangedPrograms;
+	case (int)BankUpload::WholeBank: return BankUpload::WholeBank;
+	default: return BankUpload::Automatic;
+	}
+}
+
+void TransferStrategy::setOverride(std::shared_ptr<midikraft::Synth> synth, BankUpload method)
+{
+	if (synth) {
+		Settings::instance().set(fmt::format("BankUpload {}", synth->getName()), std::to_string((int)method));
+	}
+}
+
+std::string TransferStrategy::rateSetting(std::shared_ptr<midikraft::Synth> synth, std::string const &method)
+{
+	// Per output, the same synth can be much slower behind a network MIDI server or a merger
+	std::string output;
+	if (auto location = midikraft::Capability::hasCapability<midikraft::MidiLocationCapability>(synth)) {
+		output = location->midiOutput().identifier.toStdString();
+	}
+	return fmt::format("TransferRate {} {} {}", method, synth ? synth->getName() : "", output);
+}
+
+void TransferStrategy::record(std::string const &setting, size_t patches, double seconds)
+{
+	if (patches == 0 || seconds < kMinSecondsMeasured) {
+		return;
+	}
+	double measured = patches / seconds;
+	double previous = rate(setting);
+	double smoothed = previous > 0.0 ? previous * (1.0 - kNewRateWeight) + measured * kNewRateWeight : measured;
+	spdlog::debug("{}: {:.1f} patches per second, now expecting {:.1f}", setting, measured, smoothed);
+	SettingsWriteQueue::instance().set(setting, fmt::format("{:.3f}", smoothed));
+}
+
+double TransferStrategy::rate(std::string const &setting)
+{
+	return String(SettingsWriteQueue::instance().get(setting, "0")).getDoubleValue();
+}
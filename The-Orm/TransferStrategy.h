@@ -0,0 +1,42 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "Synth.h"
+
+#include <memory>
+#include <string>
+
+// Remembers how many patches per second went to and came from each synth on its current output, and picks the
+// faster way to send a bank from that. Sending only the changed programs costs one program dump per change, sending
+// the whole bank costs all its patches but might be much faster per patch on synths that take a bank dump in one go.
+// Which one to use can also be fixed per synth in the MIDI setup. All functions are for the message thread
+class TransferStrategy {
+public:
+	enum class BankUpload {
+		Automatic = 1,       // Values as stored in the settings and shown in the setup
+		ChangedPrograms = 2,
+		WholeBank = 3
+	};
+
+	// Never returns Automatic. changedPrograms of totalPrograms differ from what the synth holds
+	static BankUpload chooseBankUpload(std::shared_ptr<midikraft::Synth> synth, size_t changedPrograms, size_t totalPrograms);
+
+	static void recordUpload(std::shared_ptr<midikraft::Synth> synth, BankUpload method, size_t patches, double seconds);
+	static void recordDownload(std::shared_ptr<midikraft::Synth> synth, size_t patches, double seconds);
+	// Smoothed over the last transfers, 0 if never measured
+	static double uploadRate(std::shared_ptr<midikraft::Synth> synth, BankUpload method);
+	static double downloadRate(std::shared_ptr<midikraft::Synth> synth);
+
+	static BankUpload override(std::shared_ptr<midikraft::Synth> synth);
+	static void setOverride(std::shared_ptr<midikraft::Synth> synth, BankUpload method);
+
+private:
+	static std::string rateSetting(std::shared_ptr<midikraft::Synth> synth, std::string const &method);
+	static void record(std::string const &setting, size_t patches, double seconds);
+	static double rate(std::string const &setting);
+};
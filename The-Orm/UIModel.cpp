@@ -9,6 +9,9 @@
 #include "FileHelpers.h"
 #include "Data.h"
 
+#include "GenericAdaptation.h"
+#include "LazyGenericAdaptation.h"
+
 void CurrentSynth::changeCurrentSynth(std::weak_ptr<midikraft::Synth> activeSynth)
 {
 	currentSynth_ = activeSynth;
@@ -54,6 +57,85 @@ void CurrentSession::changedSession()
 	sendChangeMessage();
 }
 
+ModelChanges::UpdateScope::UpdateScope()
+{
+	UIModel::instance()->modelChanges_.openScopes_++;
+}
+
+ModelChanges::UpdateScope::~UpdateScope()
+{
+	auto &changes = UIModel::instance()->modelChanges_;
+	if (--changes.openScopes_ == 0 && changes.pending_ != 0) {
+		changes.triggerAsyncUpdate();
+	}
+}
+
+void ModelChanges::addListener(Listener *listener)
+{
+	listeners_.add(listener);
+}
+
+void ModelChanges::removeListener(Listener *listener)
+{
+	listeners_.remove(listener);
+}
+
+void ModelChanges::watch(ChangeBroadcaster &broadcaster, Aspect aspect)
+{
+	watched_[&broadcaster] = aspect;
+	broadcaster.addChangeListener(this);
+}
+
+void ModelChanges::unwatch(ChangeBroadcaster &broadcaster)
+{
+	broadcaster.removeChangeListener(this);
+	watched_.erase(&broadcaster);
+}
+
+void ModelChanges::changeListenerCallback(ChangeBroadcaster* source)
+{
+	auto found = watched_.find(source);
+	if (found != watched_.end()) {
+		pending_ |= found->second;
+		// The broadcasters of one action were all posted before this, so they are collected by the time this is delivered
+		if (openScopes_ == 0) {
+			triggerAsyncUpdate();
+		}
+	}
+}
+
+void ModelChanges::handleAsyncUpdate()
+{
+	if (openScopes_ > 0 || pending_ == 0) {
+		return;
+	}
+	int aspects = pending_;
+	pending_ = 0;
+	listeners_.call([aspects](Listener &listener) { listener.modelChanged(aspects); });
+}
+
+UIModel::UIModel()
+{
+	modelChanges_.watch(currentSynth_, ModelChanges::CurrentSynth);
+	modelChanges_.watch(multiMode_, ModelChanges::MultiMode);
+	modelChanges_.watch(currentPatch_, ModelChanges::CurrentPatch);
+	modelChanges_.watch(synthList_, ModelChanges::SynthList);
+	modelChanges_.watch(thumbnails_, ModelChanges::Thumbnails);
+	modelChanges_.watch(categoriesChanged, ModelChanges::Categories);
+	modelChanges_.watch(databaseChanged, ModelChanges::Database);
+}
+
+UIModel::~UIModel()
+{
+	modelChanges_.unwatch(databaseChanged);
+	modelChanges_.unwatch(categoriesChanged);
+	modelChanges_.unwatch(thumbnails_);
+	modelChanges_.unwatch(synthList_);
+	modelChanges_.unwatch(currentPatch_);
+	modelChanges_.unwatch(multiMode_);
+	modelChanges_.unwatch(currentSynth_);
+}
+
 UIModel * UIModel::instance()
 {
 	if (instance_ == nullptr) {
@@ -114,67 +196,121 @@ std::unique_ptr<UIModel> UIModel::instance_;
 
 void CurrentSynthList::setSynthList(std::vector<midikraft::SynthHolder> const &synths)
 {
-	synths_.clear();
-	for (auto synth : synths) {
-		synths_.emplace_back(synth, true);
+	synths_ = synths;
+	names_.assign(synths_.size(), std::string());
+	active_.assign(synths_.size(), true);
+	indexByName_.clear();
+	indexByDevice_.clear();
+	for (size_t i = 0; i < synths_.size(); i++) {
+		indexSynth(i);
 	}
+	updateActiveSynths();
 	sendChangeMessage();
 }
 
-void CurrentSynthList::setSynthActive(midikraft::SimpleDiscoverableDevice *synth, bool isActive)
+void CurrentSynthList::indexSynth(size_t index)
 {
-	for (auto &s : synths_) {
-		if (!s.first.device()) continue;
-		if (s.first.device()->getName() == synth->getName()) {
-			s.second = isActive;
-			sendChangeMessage();
-			return;
+	auto const &holder = synths_[index];
+	if (holder.device()) {
+		names_[index] = holder.device()->getName();
+		indexByDevice_[holder.device().get()] = index;
+	}
+	else if (holder.synth()) {
+		names_[index] = holder.synth()->getName();
+	}
+	// Like the linear search before, the first synth of a name wins
+	indexByName_.emplace(names_[index], index);
+}
+
+void CurrentSynthList::updateActiveSynths()
+{
+	activeSynths_.clear();
+	for (size_t i = 0; i < synths_.size(); i++) {
+		if (active_[i] && synths_[i].device()) {
+			activeSynths_.push_back(synths_[i].device());
 		}
 	}
-	jassert(false);
 }
 
-std::vector<midikraft::SynthHolder> CurrentSynthList::allSynths()
+int CurrentSynthList::indexOf(midikraft::SimpleDiscoverableDevice *synth) const
 {
-	std::vector<midikraft::SynthHolder> result;
-	for (auto synth : synths_) {
-		result.push_back(synth.first);
+	if (!synth) return -1;
+	auto byDevice = indexByDevice_.find(synth);
+	if (byDevice != indexByDevice_.end()) {
+		return (int) byDevice->second;
 	}
-	return result;
+	// A different instance of the same synth, e.g. the lazy adaptation that was replaced on activation
+	auto byName = indexByName_.find(synth->getName());
+	if (byName != indexByName_.end() && synths_[byName->second].device()) {
+		return (int) byName->second;
+	}
+	return -1;
 }
 
-midikraft::SynthHolder CurrentSynthList::synthByName(std::string const &name)
+void CurrentSynthList::setSynthActive(midikraft::SimpleDiscoverableDevice *synth, bool isActive)
 {
-	for (auto synth : synths_) {
-		if (synth.first.device() && synth.first.device()->getName() == name) {
-			return synth.first;
-		}
-		else if (synth.first.synth() && synth.first.synth()->getName() == name) {
-			return synth.first;
+	int index = indexOf(synth);
+	if (index < 0) {
+		jassert(false);
+		return;
+	}
+	auto &holder = synths_[(size_t) index];
+	if (isActive) {
+		// Adaptations are only imported when they are activated for the first time
+		auto lazy = std::dynamic_pointer_cast<knobkraft::LazyGenericAdaptation>(holder.device());
+		if (lazy) {
+			auto adaptation = lazy->load();
+			if (adaptation) {
+				// The lazy instance might go away now, callers still holding it are found by name
+				indexByDevice_.erase(lazy.get());
+				holder = midikraft::SynthHolder(adaptation, holder.color());
+				if (holder.device()) {
+					indexByDevice_[holder.device().get()] = (size_t) index;
+				}
+			}
 		}
 	}
-	return midikraft::SynthHolder(nullptr);
+	active_[(size_t) index] = isActive;
+	updateActiveSynths();
+	sendChangeMessage();
 }
 
-std::vector<std::shared_ptr<midikraft::SimpleDiscoverableDevice>> CurrentSynthList::activeSynths()
+std::vector<midikraft::SynthHolder> const &CurrentSynthList::allSynths() const
 {
-	std::vector<std::shared_ptr<midikraft::SimpleDiscoverableDevice>> result;
-	for (auto synth : synths_) {
-		if (!synth.second) continue;
-		if (!synth.first.device()) continue;
-		result.push_back(synth.first.device());
-	}
-	return result;
+	return synths_;
 }
 
-bool CurrentSynthList::isSynthActive(std::shared_ptr<midikraft::SimpleDiscoverableDevice> synth)
+midikraft::SynthHolder CurrentSynthList::synthByName(std::string const &name) const
 {
-	for (auto s : activeSynths()) {
-		if (s->getName() == synth->getName()) {
-			return true;
-		}
+	auto found = indexByName_.find(name);
+	if (found != indexByName_.end()) {
+		return synths_[found->second];
 	}
-	return false;
+	return midikraft::SynthHolder(nullptr);
+}
+
+std::vector<std::shared_ptr<midikraft::SimpleDiscoverableDevice>> CurrentSynthList::activeSynths() const
+{
+	return activeSynths_;
+}
+
+bool CurrentSynthList::isSynthActive(std::shared_ptr<midikraft::SimpleDiscoverableDevice> synth) const
+{
+	int index = indexOf(synth.get());
+	return index >= 0 && active_[(size_t) index];
+}
+
+void AdaptationReloads::reloaded(std::string const &synthName)
+{
+	reloaded_.insert(synthName);
+	sendChangeMessage();
+}
+
+std::set<std::string> AdaptationReloads::takeReloadedSynths()
+{
+	std::set<std::string> result;
+	result.swap(reloaded_);
+	return result;
 }
 
 void CurrentMultiMode::setMultiSynthMode(bool multiMode)
@@ -17,6 +17,10 @@
 
 #include "Data.h"
 
+#include <map>
+#include <set>
+#include <unordered_map>
+
 juce::Identifier const PROPERTY_SYNTH_LIST {"SynthList"};
 juce::Identifier const PROPERTY_BUTTON_INFO_TYPE {"ButtonInfoType"};
 juce::Identifier const PROPERTY_WINDOW_LIST {"Windows"};
@@ -96,18 +100,30 @@ private:
 	std::vector<std::shared_ptr<midikraft::SessionPatch>> sessionPatches;
 };
 
+// The lookups are asked for constantly by the UI, so names are taken once when the list is set. For adaptations getName() is a call
+// into Python. Lookups by name or device are hashed, and the active synths are kept up to date instead of collected per call
 class CurrentSynthList : public ChangeBroadcaster {
 public:
 	void setSynthList(std::vector<midikraft::SynthHolder> const &synths);
 	void setSynthActive(midikraft::SimpleDiscoverableDevice *synth, bool isActive);
 
-	std::vector<midikraft::SynthHolder> allSynths();
-	midikraft::SynthHolder synthByName(std::string const &name);
-	std::vector<std::shared_ptr<midikraft::SimpleDiscoverableDevice>> activeSynths();
-	bool isSynthActive(std::shared_ptr<midikraft::SimpleDiscoverableDevice> synth);
+	// Valid until the next setSynthList() or setSynthActive()
+	std::vector<midikraft::SynthHolder> const &allSynths() const;
+	midikraft::SynthHolder synthByName(std::string const &name) const;
+	std::vector<std::shared_ptr<midikraft::SimpleDiscoverableDevice>> activeSynths() const;
+	bool isSynthActive(std::shared_ptr<midikraft::SimpleDiscoverableDevice> synth) const;
 
 private:
-	std::vector<std::pair<midikraft::SynthHolder, bool>> synths_;	
+	int indexOf(midikraft::SimpleDiscoverableDevice *synth) const;
+	void indexSynth(size_t index);
+	void updateActiveSynths();
+
+	std::vector<midikraft::SynthHolder> synths_;
+	std::vector<std::string> names_;
+	std::vector<bool> active_;
+	std::unordered_map<std::string, size_t> indexByName_;
+	std::unordered_map<midikraft::SimpleDiscoverableDevice *, size_t> indexByDevice_;
+	std::vector<std::shared_ptr<midikraft::SimpleDiscoverableDevice>> activeSynths_;
 };
 
 class ThumbnailChanges : public ChangeBroadcaster {
@@ -116,6 +132,63 @@ class ThumbnailChanges : public ChangeBroadcaster {
 class WindowTitleChanges : public ChangeBroadcaster {
 };
 
+// Listen to this to drop whatever was computed by the old module of a reloaded adaptation
+class AdaptationReloads : public ChangeBroadcaster {
+public:
+	void reloaded(std::string const &synthName);
+	// The synths reloaded since the last call, which forgets them. Change messages are coalesced, so a listener can't know
+	// which of them it is about
+	std::set<std::string> takeReloadedSynths();
+
+private:
+	std::set<std::string> reloaded_;
+};
+
+// One notification naming everything that changed in the model, for listeners that do expensive work for several aspects of it.
+// The individual broadcasters of a user action, e.g. switching the synth and leaving multi mode, become a single modelChanged() call.
+// An UpdateScope holds back the notification until the outermost scope ends, for changes that don't all happen in one message.
+class ModelChanges : private ChangeListener, private AsyncUpdater {
+public:
+	enum Aspect {
+		CurrentSynth = 1 << 0,
+		MultiMode = 1 << 1,
+		CurrentPatch = 1 << 2,
+		SynthList = 1 << 3,
+		Thumbnails = 1 << 4,
+		Categories = 1 << 5,
+		Database = 1 << 6
+	};
+
+	class Listener {
+	public:
+		virtual ~Listener() = default;
+		// Message thread, aspects is a combination of Aspect flags
+		virtual void modelChanged(int aspects) = 0;
+	};
+
+	class UpdateScope {
+	public:
+		UpdateScope();
+		~UpdateScope();
+		JUCE_DECLARE_NON_COPYABLE(UpdateScope)
+	};
+
+	void addListener(Listener *listener);
+	void removeListener(Listener *listener);
+
+	void watch(ChangeBroadcaster &broadcaster, Aspect aspect);
+	void unwatch(ChangeBroadcaster &broadcaster);
+
+private:
+	void changeListenerCallback(ChangeBroadcaster* source) override;
+	void handleAsyncUpdate() override;
+
+	ListenerList<Listener> listeners_;
+	std::map<ChangeBroadcaster *, Aspect> watched_;
+	int pending_ = 0;
+	int openScopes_ = 0;
+};
+
 class UIModel {
 public:
 	static UIModel *instance();
@@ -139,14 +212,18 @@ public:
 	CurrentSynthList synthList_;
 	ThumbnailChanges thumbnails_;
 	WindowTitleChanges windowTitle_;
+	AdaptationReloads adaptationReloads_;
 	ChangeBroadcaster categoriesChanged; // Listen to this to get notified of category list changes
 	ChangeBroadcaster databaseChanged; // Listen to this when you need to know a new database was opened
+	ModelChanges modelChanges_; // Listen to this to get one notification for all of the above that changed together
 
 	static ValueTree ensureSynthSpecificPropertyExists(std::string const& synthName, juce::Identifier const& property, var const& defaultValue);
 	static Value getSynthSpecificPropertyAsValue(std::string const& synthName, juce::Identifier const& property, var const& defaultValue);
 
+	~UIModel();
+
 private:
-	UIModel() = default;
+	UIModel();
 
 	static std::unique_ptr<UIModel> instance_;
 };
@@ -7,6 +7,7 @@
 #include "VerticalPatchButtonList.h"
 
 #include "PatchHolderButton.h"
+#include "DragInfoCache.h"
 #include "LayoutConstants.h"
 
 #include "UIModel.h"
@@ -26,21 +27,19 @@ public:
 	}
 
 	virtual void itemDragEnter(const SourceDetails& dragSourceDetails) override {
-		String dropItemString = dragSourceDetails.description;
-		auto infos = midikraft::PatchHolder::dragInfoFromString(dropItemString.toStdString());
+		auto const &infos = DragInfoCache::parse(dragSourceDetails.description);
 		if (midikraft::PatchHolder::dragItemIsPatch(infos)) {
 			PatchHolderButton::itemDragEnter(dragSourceDetails);
 		}
 		else if (midikraft::PatchHolder::dragItemIsList(infos)) {
 			if (dragHighlightHandler_) {
-				dragHighlightHandler_(0, infos["list_id"], infos["list_name"]);
+				dragHighlightHandler_(0, infos.value("list_id", std::string()), infos.value("list_name", std::string()));
 			}
 		}
 	}
 
 	virtual void itemDragExit(const SourceDetails& dragSourceDetails) override {
-		String dropItemString = dragSourceDetails.description;
-		auto infos = midikraft::PatchHolder::dragInfoFromString(dropItemString.toStdString());
+		auto const &infos = DragInfoCache::parse(dragSourceDetails.description);
 		if (midikraft::PatchHolder::dragItemIsPatch(infos)) {
 			PatchHolderButton::itemDragExit(dragSourceDetails);
 		} else if (midikraft::PatchHolder::dragItemIsList(infos)) {
@@ -71,16 +70,16 @@ public:
 		}
 	}
 
-	void setRow(int rowNo, midikraft::PatchHolder const &patch, bool dirty, PatchButtonInfo info) {
+	void setRow(int rowNo, midikraft::PatchHolder const &patch, bool dirty, bool differsInSynth, PatchButtonInfo info) {
 		// This changes the row to be displayed with this component (reusing components within a list box)
+		row_ = rowNo;
 		if (!button_) {
-			button_ = std::make_unique<PatchListButtonWithMultiDrag>(rowNo, false, clickHandler_, [this, rowNo](int zeroOrMinusOne, std::string const& list_id, std::string const& list_name) {
-				dragHighlightHandler_(zeroOrMinusOne == -1 ? -1 : rowNo, list_id, list_name);
+			button_ = std::make_unique<PatchListButtonWithMultiDrag>(rowNo, false, clickHandler_, [this](int zeroOrMinusOne, std::string const& list_id, std::string const& list_name) {
+				dragHighlightHandler_(zeroOrMinusOne == -1 ? -1 : row_, list_id, list_name);
 			});
 			addAndMakeVisible(*button_);
 			button_->acceptsItem = [this](juce::var dropItem) {
-				String dropItemString = dropItem;
-				auto infos = midikraft::PatchHolder::dragInfoFromString(dropItemString.toStdString());
+				auto const &infos = DragInfoCache::parse(dropItem);
 				return (midikraft::PatchHolder::dragItemIsPatch(infos) && infos.contains("synth") && infos["synth"] == thePatch_.synth()->getName())
 					|| midikraft::PatchHolder::dragItemIsList(infos);
 			};
@@ -109,6 +108,7 @@ public:
 		thePatch_ = patch; // Need a copy to keep the pointer alive
 		button_->setPatchHolder(&thePatch_, false, info);
 		button_->setDirty(dirty);
+		button_->setDiffersInSynth(differsInSynth);
 	}
 
 	void clearRow() {
@@ -138,6 +138,7 @@ private:
 	VerticalPatchButtonList::TListDropHandler listDropHandler_;
 	TDragHighlightHandler dragHighlightHandler_;
 	midikraft::PatchHolder thePatch_;
+	int row_ = 0; // Rows are reused by the ListBox, so this changes
 };
 
 
@@ -154,6 +155,16 @@ public:
 		, dragHighlightHandler_(dragHighlightHandler) {
 	}
 
+	// Show another bank or the changed content of the same one, the ListBox then rebinds only the visible rows
+	void setBank(std::shared_ptr<midikraft::SynthBank> bank, PatchButtonInfo info) {
+		bank_ = bank;
+		info_ = info;
+	}
+
+	void setDifferences(std::set<int> const &rows) {
+		differences_ = rows;
+	}
+
 	int getNumRows() override
 	{
 		return (int) bank_->patches().size();
@@ -172,13 +183,13 @@ public:
 			if (existingComponentToUpdate) {
 				auto existing = dynamic_cast<PatchButtonRow*>(existingComponentToUpdate);
 				if (existing) {
-					existing->setRow(rowNumber, bank_->patches()[rowNumber], bank_->isPositionDirty(rowNumber), info_);
+					existing->setRow(rowNumber, bank_->patches()[rowNumber], bank_->isPositionDirty(rowNumber), differences_.count(rowNumber) > 0, info_);
 					return existing;
 				}
 				throw std::runtime_error("This was not the correct row type, can't continue");
 			}
 			auto newComponent = new PatchButtonRow(onRowSelected_, patchChangeHandler_, listDropHandler_, dragHighlightHandler_);
-			newComponent->setRow(rowNumber, bank_->patches()[rowNumber], bank_->isPositionDirty(rowNumber), info_);
+			newComponent->setRow(rowNumber, bank_->patches()[rowNumber], bank_->isPositionDirty(rowNumber), differences_.count(rowNumber) > 0, info_);
 			return newComponent;
 		}
 		else {
@@ -201,6 +212,7 @@ private:
 	VerticalPatchButtonList::TListDropHandler listDropHandler_;
 	PatchButtonInfo info_;
 	TDragHighlightHandler dragHighlightHandler_;
+	std::set<int> differences_;
 };
 
 
@@ -213,6 +225,11 @@ VerticalPatchButtonList::VerticalPatchButtonList(std::function<void(MidiProgramN
 	list_.setRowHeight(LAYOUT_LARGE_LINE_SPACING);
 }
 
+VerticalPatchButtonList::~VerticalPatchButtonList()
+{
+	list_.setModel(nullptr);
+}
+
 void VerticalPatchButtonList::resized()
 {
 	auto bounds = getLocalBounds();
@@ -224,9 +241,41 @@ void VerticalPatchButtonList::refreshContent()
 	list_.updateContent();
 }
 
+void VerticalPatchButtonList::refreshRows(int firstRow, int numRows)
+{
+	if (!model_) {
+		return;
+	}
+	for (int row = std::max(0, firstRow); row < std::min(firstRow + numRows, model_->getNumRows()); row++) {
+		auto component = list_.getComponentForRowNumber(row);
+		if (component) {
+			model_->refreshComponentForRow(row, false, component);
+		}
+	}
+}
+
+void VerticalPatchButtonList::setDifferences(std::set<int> const &rows)
+{
+	if (model_) {
+		model_->setDifferences(rows);
+		refreshRows(0, model_->getNumRows());
+	}
+}
+
 void VerticalPatchButtonList::setPatches(std::shared_ptr<midikraft::SynthBank> bank, PatchButtonInfo info)
 {
-	list_.setModel(new PatchListModel(bank, [this](int row) {
+	if (bank != bank_) {
+		// New bank snapshot, the lists might count differently for its synth
+		listSizes_.clear();
+		bank_ = bank;
+	}
+	if (model_) {
+		model_->setBank(bank, info);
+		list_.updateContent();
+		list_.repaint();
+		return;
+	}
+	model_ = std::make_unique<PatchListModel>(bank, [this](int row) {
 		auto patchRow = dynamic_cast<PatchButtonRow *>(list_.getComponentForRowNumber(row));
 		if (patchRow) {
 			if (onPatchClicked) {
@@ -244,8 +293,8 @@ void VerticalPatchButtonList::setPatches(std::shared_ptr<midikraft::SynthBank> b
 	},
 		[this](MidiProgramNumber programPlace, std::string md5) {
 		if (dropHandler_) {
+			// The handler refreshes the rows it changed
 			dropHandler_(programPlace, md5);
-			list_.updateContent();
 		}
 	}
 	, [this](MidiProgramNumber program, std::string const&list_id, std::string const&list_name) {
@@ -254,10 +303,12 @@ void VerticalPatchButtonList::setPatches(std::shared_ptr<midikraft::SynthBank> b
 		}
 	}
 	, info
-	, [this, bank](int startrow, std::string const& list_id, std::string const& list_name) {
-		// This is a bit heavy, but the list itself has never been loaded...
-		int rowCount = listResolver_(list_id, list_name);;
-		for (int i = 0; i < list_.getModel()->getNumRows(); i++) {
+	, [this](int startrow, std::string const& list_id, std::string const& list_name) {
+		int rowCount = startrow == -1 ? 0 : resolveListSize(list_id, list_name);
+		// Only the visible rows have components
+		int firstRow = std::max(0, list_.getRowContainingPosition(0, 0));
+		int visibleRows = list_.getHeight() / std::max(1, list_.getRowHeight()) + 2;
+		for (int i = firstRow; i < std::min(firstRow + visibleRows, list_.getModel()->getNumRows()); i++) {
 			auto button = list_.getComponentForRowNumber(i);
 			if (button != nullptr) {
 				// This better be a PatchButton!
@@ -272,5 +323,18 @@ void VerticalPatchButtonList::setPatches(std::shared_ptr<midikraft::SynthBank> b
 				}
 			}
 		}
-	}));
+	});
+	list_.setModel(model_.get());
+}
+
+int VerticalPatchButtonList::resolveListSize(std::string const& list_id, std::string const& list_name)
+{
+	// The list itself has never been loaded, and dragging over the rows asks for it again and again
+	auto found = listSizes_.find(list_id);
+	if (found != listSizes_.end()) {
+		return found->second;
+	}
+	int size = listResolver_ ? listResolver_(list_id, list_name) : 1;
+	listSizes_[list_id] = size;
+	return size;
 }
@@ -11,11 +11,17 @@
 #include "PatchHolderButton.h"
 #include "SynthBank.h"
 
+#include <map>
+#include <set>
+
+class PatchListModel;
+
 class VerticalPatchButtonList : public Component {
 public:
 	typedef std::function<void(MidiProgramNumber, std::string const&, std::string const&)> TListDropHandler;
 
 	VerticalPatchButtonList(std::function<void(MidiProgramNumber, std::string)> dropHandler, TListDropHandler listDropHandler, std::function<int(std::string const&, std::string const&)> listResolver);
+	virtual ~VerticalPatchButtonList() override;
 
 	std::function<void(midikraft::PatchHolder&)> onPatchClicked;
 
@@ -23,10 +29,19 @@ public:
 
 	void setPatches(std::shared_ptr<midikraft::SynthBank> bank, PatchButtonInfo info);
 	void refreshContent();
+	// Rebinds only these rows of the bank, for when single slots have been changed. Rows not visible have no component and are skipped
+	void refreshRows(int firstRow, int numRows);
+	// Flags these rows as holding another patch in the synth
+	void setDifferences(std::set<int> const &rows);
 
 private:
+	int resolveListSize(std::string const& list_id, std::string const& list_name);
+
 	std::function<void(MidiProgramNumber, std::string)> dropHandler_;
 	TListDropHandler listDropHandler_;
 	ListBox list_;
 	std::function<int(std::string const&, std::string const&)> listResolver_;
+	std::unique_ptr<PatchListModel> model_;
+	std::shared_ptr<midikraft::SynthBank> bank_;
+	std::map<std::string, int> listSizes_; // Per bank shown, how many patches of each list are for its synth
 };
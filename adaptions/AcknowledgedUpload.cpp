@@ -0,0 +1,74 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "AcknowledgedUpload.h"
+
+#include "MidiController.h"
+
+#include <spdlog/spdlog.h>
+
+#include <atomic>
+#include <memory>
+
+namespace knobkraft {
+
+	namespace {
+
+		// Shared with the handler, which might still be called once after it has been removed
+		struct ReplyState {
+			WaitableEvent replied;
+			std::atomic<AcknowledgedUpload::Reply> reply { AcknowledgedUpload::Reply::None };
+		};
+
+	}
+
+	bool AcknowledgedUpload::send(juce::MidiDeviceInfo const &output, juce::MidiDeviceInfo const &input, std::vector<MidiMessage> const &buffer,
+		TReplyClassifier classify, int timeoutMs)
+	{
+		auto controller = midikraft::MidiController::instance();
+		auto state = std::make_shared<ReplyState>();
+		auto handler = midikraft::MidiController::makeOneHandle();
+		controller->enableMidiInput(input);
+		controller->addMessageHandler(handler, [state, classify, input](MidiInput *source, MidiMessage const &message) {
+			if (message.isSysEx() && (input.name.isEmpty() || source->getName() == input.name)) {
+				auto reply = classify(message);
+				if (reply != Reply::None) {
+					state->reply = reply;
+					state->replied.signal();
+				}
+			}
+		});
+
+		auto midiOut = controller->getMidiOutput(output);
+		bool accepted = true;
+		size_t timeouts = 0;
+		for (size_t i = 0; i < buffer.size() && accepted; i++) {
+			auto const &message = buffer[i];
+			if (!message.isSysEx()) {
+				midiOut->sendMessageNow(message);
+				continue;
+			}
+			state->replied.reset();
+			state->reply = Reply::None;
+			midiOut->sendMessageNow(message);
+			if (!state->replied.wait(timeoutMs)) {
+				timeouts++;
+				continue;
+			}
+			if (state->reply == Reply::Rejected) {
+				spdlog::error("Synth rejected message {} of {}, not sending the remaining messages", i + 1, buffer.size());
+				accepted = false;
+			}
+		}
+		controller->removeMessageHandler(handler);
+
+		if (timeouts > 0) {
+			spdlog::warn("No acknowledgement for {} of {} messages within {} ms, they were sent anyway", timeouts, buffer.size(), timeoutMs);
+		}
+		return accepted;
+	}
+
+}
@@ -0,0 +1,34 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include <functional>
+#include <vector>
+
+namespace knobkraft {
+
+	// Sends a block of messages to a synth that answers each sysex it has processed with an acknowledgement, waiting for that
+	// answer before the next sysex goes out. So a device that takes large uploads gets them as fast as it can store them, without
+	// a fixed delay that has to fit the worst case. If no answer comes within the timeout, the next message is sent anyway.
+	// A rejection stops the upload, the synth is not in a state to take the rest. Messages that are not sysex are not acknowledged
+	// and are sent right away. This blocks, call it from a background thread like all sending of blocks.
+	class AcknowledgedUpload {
+	public:
+		enum class Reply { None, Acknowledged, Rejected };
+		// Called on the MIDI thread for each sysex arriving from the synth's input while the upload runs
+		typedef std::function<Reply(MidiMessage const &message)> TReplyClassifier;
+
+		static constexpr int kAcknowledgementTimeoutMs = 3000;
+
+		// Returns false if the synth rejected a message
+		static bool send(juce::MidiDeviceInfo const &output, juce::MidiDeviceInfo const &input, std::vector<MidiMessage> const &buffer,
+			TReplyClassifier classify, int timeoutMs = kAcknowledgementTimeoutMs);
+	};
+
+}
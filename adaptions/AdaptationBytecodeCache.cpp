@@ -0,0 +1,76 @@
+/*
+   Copyright (c) 2020 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "AdaptationBytecodeCache.h"
+
+#include <spdlog/spdlog.h>
+#include "SpdLogJuce.h"
+
+namespace py = pybind11;
+
+namespace knobkraft {
+
+	py::object AdaptationBytecodeCache::compile(std::string const &moduleName, std::string const &source)
+	{
+		// The magic number changes with every bytecode format of the interpreter, so it goes into the key with the source
+		std::string magic = py::module::import("importlib.util").attr("MAGIC_NUMBER").cast<py::bytes>();
+		MemoryBlock keyData(source.data(), source.size());
+		keyData.append(magic.data(), magic.size());
+		auto key = MD5(keyData).toHexString().toStdString();
+
+		auto marshal = py::module::import("marshal");
+		auto file = cacheFile(moduleName, key);
+		if (file.existsAsFile()) {
+			MemoryBlock data;
+			if (file.loadFileAsData(data)) {
+				try {
+					return marshal.attr("loads")(py::bytes(static_cast<const char *>(data.getData()), data.getSize()));
+				}
+				catch (py::error_already_set &ex) {
+					spdlog::warn("Ignoring damaged bytecode cache file {}: {}", file.getFullPathName(), ex.what());
+				}
+			}
+		}
+
+		auto code = py::module::import("builtins").attr("compile")(source, moduleName, "exec");
+		std::string bytecode = marshal.attr("dumps")(code).cast<py::bytes>();
+		// Older versions of this module are of no use anymore
+		auto prefix = File::createLegalFileName(moduleName) + "-";
+		for (auto const &old : cacheDirectory().findChildFiles(File::findFiles, false, prefix + "*.pyc")) {
+			if (old.getFileNameWithoutExtension().length() == prefix.length() + (int) key.size()) {
+				old.deleteFile();
+			}
+		}
+		if (!file.replaceWithData(bytecode.data(), bytecode.size())) {
+			spdlog::warn("Could not write bytecode cache file {}", file.getFullPathName());
+		}
+		return code;
+	}
+
+	File AdaptationBytecodeCache::pycachePrefix()
+	{
+		auto directory = cacheDirectory().getChildFile("pycache");
+		if (!directory.exists()) {
+			directory.createDirectory();
+		}
+		return directory;
+	}
+
+	File AdaptationBytecodeCache::cacheDirectory()
+	{
+		auto cacheDirectory = File::getSpecialLocation(File::userApplicationDataDirectory).getChildFile("KnobKraftOrm").getChildFile("AdaptationBytecode");
+		if (!cacheDirectory.exists()) {
+			cacheDirectory.createDirectory();
+		}
+		return cacheDirectory;
+	}
+
+	File AdaptationBytecodeCache::cacheFile(std::string const &moduleName, std::string const &key)
+	{
+		return cacheDirectory().getChildFile(File::createLegalFileName(moduleName) + "-" + key + ".pyc");
+	}
+
+}
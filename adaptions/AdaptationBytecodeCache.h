@@ -0,0 +1,32 @@
+/*
+   Copyright (c) 2020 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include <string>
+#include <pybind11/pybind11.h>
+
+namespace knobkraft {
+
+	// Keeps the marshalled code objects of adaptations compiled from source strings in the application data directory,
+	// so the source is only parsed and compiled again when it or the interpreter version changes.
+	// Adaptations imported from files use the regular __pycache__ of Python, redirected here by the pycache prefix.
+	class AdaptationBytecodeCache {
+	public:
+		// Returns the code object for the source, to be run with exec(). Call with the GIL held
+		static pybind11::object compile(std::string const &moduleName, std::string const &source);
+
+		// Where Python should write the pyc files of imported modules, the install directory might not be writable
+		static File pycachePrefix();
+
+	private:
+		static File cacheDirectory();
+		static File cacheFile(std::string const &moduleName, std::string const &key);
+	};
+
+}
@@ -0,0 +1,114 @@
+/*
+   Copyright (c) 2020 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "AdaptationCallProfiler.h"
+
+#include <fmt/format.h>
+
+namespace knobkraft {
+
+	std::atomic<AdaptationCallProfiler::TCallObserver> AdaptationCallProfiler::callObserver_{ nullptr };
+
+	AdaptationCallProfiler::AdaptationCallProfiler(std::vector<const char *> const &functionNames) : functionNameLiterals_(functionNames)
+	{
+		functionNameLiterals_.push_back("(other)");
+		for (auto name : functionNameLiterals_) {
+			functionNames_.push_back(name);
+		}
+		counters_ = std::make_unique<Counters[]>(functionNames_.size());
+	}
+
+	void AdaptationCallProfiler::record(int functionIndex, int64 nanoseconds, size_t bytesIn, size_t bytesOut)
+	{
+		if (functionIndex < 0 || functionIndex >= (int) functionNames_.size()) {
+			functionIndex = (int) functionNames_.size() - 1;
+		}
+		auto &counters = counters_[(size_t) functionIndex];
+		uint64 duration = nanoseconds > 0 ? (uint64) nanoseconds : 0;
+		counters.calls.fetch_add(1, std::memory_order_relaxed);
+		counters.totalNanoseconds.fetch_add(duration, std::memory_order_relaxed);
+		counters.bytesIn.fetch_add(bytesIn, std::memory_order_relaxed);
+		counters.bytesOut.fetch_add(bytesOut, std::memory_order_relaxed);
+
+		// Bucket 0 is below a microsecond, bucket n is below 2^n microseconds
+		uint64 microseconds = duration / 1000;
+		size_t bucket = 0;
+		while (microseconds > 0 && bucket < kNumberOfBuckets - 1) {
+			microseconds >>= 1;
+			bucket++;
+		}
+		counters.histogram[bucket].fetch_add(1, std::memory_order_relaxed);
+
+		auto observer = callObserver_.load(std::memory_order_relaxed);
+		if (observer) {
+			observer(functionIndex, functionNameLiterals_[(size_t) functionIndex], nanoseconds);
+		}
+	}
+
+	void AdaptationCallProfiler::setCallObserver(TCallObserver observer)
+	{
+		callObserver_ = observer;
+	}
+
+	void AdaptationCallProfiler::reset()
+	{
+		for (size_t i = 0; i < functionNames_.size(); i++) {
+			auto &counters = counters_[i];
+			counters.calls = 0;
+			counters.totalNanoseconds = 0;
+			counters.bytesIn = 0;
+			counters.bytesOut = 0;
+			for (auto &bucket : counters.histogram) {
+				bucket = 0;
+			}
+		}
+	}
+
+	std::vector<AdaptationCallProfiler::FunctionStatistics> AdaptationCallProfiler::statistics() const
+	{
+		std::vector<FunctionStatistics> result;
+		for (size_t i = 0; i < functionNames_.size(); i++) {
+			auto const &counters = counters_[i];
+			uint64 calls = counters.calls.load(std::memory_order_relaxed);
+			if (calls == 0) continue;
+			FunctionStatistics stats;
+			stats.functionName = functionNames_[i];
+			stats.calls = calls;
+			stats.totalMilliseconds = counters.totalNanoseconds.load(std::memory_order_relaxed) / 1.0e6;
+			stats.p50Milliseconds = percentileMilliseconds(counters, calls, 0.5);
+			stats.p99Milliseconds = percentileMilliseconds(counters, calls, 0.99);
+			stats.bytesIn = counters.bytesIn.load(std::memory_order_relaxed);
+			stats.bytesOut = counters.bytesOut.load(std::memory_order_relaxed);
+			result.push_back(stats);
+		}
+		return result;
+	}
+
+	std::string AdaptationCallProfiler::toCsv(std::vector<FunctionStatistics> const &statistics)
+	{
+		std::string result = "function,calls,total_ms,p50_ms,p99_ms,bytes_in,bytes_out\n";
+		for (auto const &stats : statistics) {
+			result += fmt::format("{},{},{:.3f},{:.3f},{:.3f},{},{}\n", stats.functionName, stats.calls, stats.totalMilliseconds,
+				stats.p50Milliseconds, stats.p99Milliseconds, stats.bytesIn, stats.bytesOut);
+		}
+		return result;
+	}
+
+	double AdaptationCallProfiler::percentileMilliseconds(Counters const &counters, uint64 calls, double percentile)
+	{
+		// Report the upper bound of the bucket the percentile falls into
+		auto target = (uint64) (calls * percentile);
+		uint64 seen = 0;
+		for (size_t bucket = 0; bucket < kNumberOfBuckets; bucket++) {
+			seen += counters.histogram[bucket].load(std::memory_order_relaxed);
+			if (seen > target) {
+				return (double) (1ULL << bucket) / 1000.0;
+			}
+		}
+		return (double) (1ULL << (kNumberOfBuckets - 1)) / 1000.0;
+	}
+
+}
@@ -0,0 +1,68 @@
+/*
+   Copyright (c) 2020 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace knobkraft {
+
+	// Always-on statistics of the calls into an adaptation. Recording is only a handful of relaxed atomic increments,
+	// latencies are kept in a histogram with power of two buckets, so the percentiles are approximations with a factor 2 precision
+	class AdaptationCallProfiler {
+	public:
+		struct FunctionStatistics {
+			std::string functionName;
+			uint64 calls;
+			double totalMilliseconds;
+			double p50Milliseconds;
+			double p99Milliseconds;
+			uint64 bytesIn;
+			uint64 bytesOut;
+		};
+
+		// One slot per known function name (index into kAdapatationPythonFunctionNames), plus one for all others
+		explicit AdaptationCallProfiler(std::vector<const char *> const &functionNames);
+
+		void record(int functionIndex, int64 nanoseconds, size_t bytesIn, size_t bytesOut);
+		void reset();
+
+		// Optional observer of the calls of all adaptations, called right after each call returned, e.g. to trace them.
+		// The function index is the slot of the function, the same for all adaptations, so observers can resolve what they
+		// need per function once up front. The function name is a string literal
+		typedef void (*TCallObserver)(int functionIndex, char const *functionName, int64 nanoseconds);
+		static void setCallObserver(TCallObserver observer);
+
+		// Only functions that have been called at least once
+		std::vector<FunctionStatistics> statistics() const;
+		static std::string toCsv(std::vector<FunctionStatistics> const &statistics);
+
+	private:
+		static constexpr size_t kNumberOfBuckets = 32;
+
+		struct Counters {
+			std::atomic<uint64> calls{ 0 };
+			std::atomic<uint64> totalNanoseconds{ 0 };
+			std::atomic<uint64> bytesIn{ 0 };
+			std::atomic<uint64> bytesOut{ 0 };
+			std::array<std::atomic<uint64>, kNumberOfBuckets> histogram{};
+		};
+
+		static double percentileMilliseconds(Counters const &counters, uint64 calls, double percentile);
+
+		std::vector<std::string> functionNames_;
+		std::vector<const char *> functionNameLiterals_;
+		std::unique_ptr<Counters[]> counters_;
+		static std::atomic<TCallObserver> callObserver_;
+	};
+
+}
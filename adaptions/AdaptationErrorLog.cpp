@@ -0,0 +1,83 @@
+/*
+   Copyright (c) 2020 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "AdaptationErrorLog.h"
+
+#include <spdlog/spdlog.h>
+
+namespace knobkraft {
+
+	AdaptationErrorLog &AdaptationErrorLog::instance()
+	{
+		static AdaptationErrorLog sInstance;
+		return sInstance;
+	}
+
+	void AdaptationErrorLog::record(std::string const &adaptationName, std::string const &methodName, std::string const &message)
+	{
+		{
+			std::lock_guard<std::mutex> guard(lock_);
+			auto key = std::make_tuple(adaptationName, methodName, message);
+			auto found = indexOf_.find(key);
+			if (found != indexOf_.end()) {
+				entries_[found->second].count++;
+				return;
+			}
+			if (entries_.size() < kNumberOfSlots) {
+				indexOf_.emplace(key, entries_.size());
+				entries_.push_back({ adaptationName, methodName, message, 1 });
+			}
+			else {
+				// Table full, only count it. This is reported with the next flush
+				dropped_++;
+			}
+		}
+		scheduleFlush();
+	}
+
+	void AdaptationErrorLog::scheduleFlush()
+	{
+		// At most one pending post to the message thread per interval
+		if (flushScheduled_.exchange(true)) {
+			return;
+		}
+		bool posted = MessageManager::callAsync([this]() {
+			Timer::callAfterDelay(kFlushIntervalMS, [this]() {
+				flush();
+			});
+		});
+		if (!posted) {
+			flushScheduled_ = false;
+		}
+	}
+
+	void AdaptationErrorLog::flush()
+	{
+		// Clear the flag first, so errors arriving while we write schedule the next round
+		flushScheduled_ = false;
+		std::vector<Entry> entries;
+		int dropped;
+		{
+			std::lock_guard<std::mutex> guard(lock_);
+			entries.swap(entries_);
+			indexOf_.clear();
+			dropped = dropped_;
+			dropped_ = 0;
+		}
+		for (auto const &entry : entries) {
+			if (entry.count > 1) {
+				spdlog::error("Adaptation[{}]: Error calling {}: {} (repeated {} times)", entry.adaptationName, entry.methodName, entry.message, entry.count);
+			}
+			else {
+				spdlog::error("Adaptation[{}]: Error calling {}: {}", entry.adaptationName, entry.methodName, entry.message);
+			}
+		}
+		if (dropped > 0) {
+			spdlog::error("Adaptation: {} more errors were not shown, too many different errors at once", dropped);
+		}
+	}
+
+}
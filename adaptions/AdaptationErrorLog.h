@@ -0,0 +1,55 @@
+/*
+   Copyright (c) 2020 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace knobkraft {
+
+	// Collects errors reported by adaptations from any thread. Repeated errors with the same adaptation, method and message
+	// are coalesced into a count, and everything is written to spdlog on the message thread at a fixed cadence. This
+	// keeps a broken adaptation from flooding the message queue with one post per failed call.
+	class AdaptationErrorLog {
+	public:
+		static AdaptationErrorLog &instance();
+
+		// Can be called from any thread, holds the lock only to count the error
+		void record(std::string const &adaptationName, std::string const &methodName, std::string const &message);
+
+		// Writes and clears all pending entries. Called by the timer, and on shutdown
+		void flush();
+
+		static constexpr int kFlushIntervalMS = 1000;
+		static constexpr size_t kNumberOfSlots = 256; // Different errors kept until the next flush, more are only counted
+
+	private:
+		AdaptationErrorLog() = default;
+
+		void scheduleFlush();
+
+		struct Entry {
+			std::string adaptationName;
+			std::string methodName;
+			std::string message;
+			int count;
+		};
+
+		std::mutex lock_;
+		std::map<std::tuple<std::string, std::string, std::string>, size_t> indexOf_; // Into entries_, guarded by lock_
+		std::vector<Entry> entries_; // In the order they first occurred, guarded by lock_
+		int dropped_ = 0; // Guarded by lock_
+		std::atomic<bool> flushScheduled_{ false };
+	};
+
+}
@@ -0,0 +1,197 @@
+/*
+   Copyright (c) 2020 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "AdaptationRegistry.h"
+
+#include "GenericAdaptation.h"
+#include "Capability.h"
+#include "HasBanksCapability.h"
+
+#include <pybind11/embed.h>
+
+#include <spdlog/spdlog.h>
+#include "SpdLogJuce.h"
+
+namespace py = pybind11;
+
+namespace knobkraft {
+
+	const char *kAdaptationManifestMagic = "KnobKraftAdaptationManifest1";
+
+	std::unique_ptr<AdaptationRegistry> AdaptationRegistry::instance_;
+
+	AdaptationRegistry::AdaptationRegistry() : manifestDirty_(false)
+	{
+		loadManifest();
+	}
+
+	AdaptationRegistry *AdaptationRegistry::instance()
+	{
+		if (instance_ == nullptr) {
+			instance_.reset(new AdaptationRegistry());
+		}
+		return instance_.get();
+	}
+
+	void AdaptationRegistry::shutdown()
+	{
+		if (instance_) {
+			instance_->saveManifest();
+			py::gil_scoped_acquire acquire;
+			instance_.reset();
+		}
+	}
+
+	std::shared_ptr<GenericAdaptation> AdaptationRegistry::adaptationForFile(File const &pythonFile)
+	{
+		std::lock_guard<std::recursive_mutex> lock(lock_);
+		auto key = pythonFile.getFullPathName().toStdString();
+		auto found = loaded_.find(key);
+		if (found != loaded_.end()) {
+			return found->second;
+		}
+
+		std::shared_ptr<GenericAdaptation> adaptation;
+		try {
+			adaptation = std::make_shared<GenericAdaptation>(pythonFile.getFileNameWithoutExtension().toStdString());
+		}
+		catch (std::runtime_error &) {
+			spdlog::error("Unloading adaptation module {}", pythonFile.getFullPathName());
+		}
+		// Also remember failures, so we don't try to import a broken module over and over again
+		loaded_[key] = adaptation;
+		if (adaptation) {
+			manifest_[key] = createManifestEntry(pythonFile, hashFile(pythonFile), adaptation);
+			manifestDirty_ = true;
+		}
+		return adaptation;
+	}
+
+	std::shared_ptr<GenericAdaptation> AdaptationRegistry::loadedAdaptation(File const &pythonFile)
+	{
+		std::lock_guard<std::recursive_mutex> lock(lock_);
+		auto found = loaded_.find(pythonFile.getFullPathName().toStdString());
+		return found != loaded_.end() ? found->second : nullptr;
+	}
+
+	std::optional<AdaptationManifestEntry> AdaptationRegistry::manifestForFile(File const &pythonFile)
+	{
+		std::lock_guard<std::recursive_mutex> lock(lock_);
+		auto key = pythonFile.getFullPathName().toStdString();
+		auto found = manifest_.find(key);
+		if (found != manifest_.end() && found->second.fileHash == hashFile(pythonFile)) {
+			return found->second;
+		}
+		if (adaptationForFile(pythonFile)) {
+			return manifest_[key];
+		}
+		return {};
+	}
+
+	std::vector<File> AdaptationRegistry::adaptationFilesInDirectory(File const &directory)
+	{
+		std::vector<File> result;
+		if (directory.exists() && directory.isDirectory()) {
+			for (auto f : directory.findChildFiles(File::findFiles, false, "*.py")) {
+				if (!f.getFileName().startsWith("test_") && f.getFileName() != "conftest.py") {
+					result.push_back(f);
+				}
+			}
+		}
+		else {
+			spdlog::warn("Directory given '{}' does not exist or is not a directory", directory.getFullPathName());
+		}
+		return result;
+	}
+
+	AdaptationManifestEntry AdaptationRegistry::createManifestEntry(File const &pythonFile, std::string const &fileHash, std::shared_ptr<GenericAdaptation> adaptation) const
+	{
+		AdaptationManifestEntry entry;
+		entry.fileName = pythonFile.getFileName().toStdString();
+		entry.fileHash = fileHash;
+		entry.synthName = adaptation->getName();
+		entry.functionMask = adaptation->implementedFunctionMask();
+		entry.numberOfBanks = 0;
+		entry.numberOfPatchesPerBank = 0;
+		auto banks = midikraft::Capability::hasCapability<midikraft::HasBanksCapability>(adaptation);
+		if (banks) {
+			entry.numberOfBanks = banks->numberOfBanks();
+			entry.numberOfPatchesPerBank = banks->numberOfPatches();
+		}
+		return entry;
+	}
+
+	void AdaptationRegistry::saveManifest()
+	{
+		std::lock_guard<std::recursive_mutex> lock(lock_);
+		if (!manifestDirty_) {
+			return;
+		}
+		auto file = manifestFile();
+		TemporaryFile temp(file);
+		{
+			FileOutputStream out(temp.getFile());
+			if (out.failedToOpen()) {
+				spdlog::warn("Could not write adaptation manifest {}", file.getFullPathName());
+				return;
+			}
+			out.writeString(kAdaptationManifestMagic);
+			out.writeInt((int) manifest_.size());
+			for (auto const &entry : manifest_) {
+				out.writeString(entry.first);
+				out.writeString(entry.second.fileName);
+				out.writeString(entry.second.fileHash);
+				out.writeString(entry.second.synthName);
+				out.writeInt64((int64) entry.second.functionMask);
+				out.writeInt(entry.second.numberOfBanks);
+				out.writeInt(entry.second.numberOfPatchesPerBank);
+			}
+			out.flush();
+		}
+		if (temp.overwriteTargetFileWithTemporary()) {
+			manifestDirty_ = false;
+		}
+	}
+
+	void AdaptationRegistry::loadManifest()
+	{
+		auto file = manifestFile();
+		if (!file.existsAsFile()) {
+			return;
+		}
+		FileInputStream in(file);
+		if (in.failedToOpen() || in.readString().toStdString() != kAdaptationManifestMagic) {
+			return;
+		}
+		int count = in.readInt();
+		for (int i = 0; i < count && !in.isExhausted(); i++) {
+			auto key = in.readString().toStdString();
+			AdaptationManifestEntry entry;
+			entry.fileName = in.readString().toStdString();
+			entry.fileHash = in.readString().toStdString();
+			entry.synthName = in.readString().toStdString();
+			entry.functionMask = (uint64) in.readInt64();
+			entry.numberOfBanks = in.readInt();
+			entry.numberOfPatchesPerBank = in.readInt();
+			manifest_[key] = entry;
+		}
+	}
+
+	File AdaptationRegistry::manifestFile() const
+	{
+		auto cacheDirectory = File::getSpecialLocation(File::userApplicationDataDirectory).getChildFile("KnobKraftOrm").getChildFile("AdaptationCache");
+		if (!cacheDirectory.exists()) {
+			cacheDirectory.createDirectory();
+		}
+		return cacheDirectory.getChildFile("manifest.cache");
+	}
+
+	std::string AdaptationRegistry::hashFile(File const &file)
+	{
+		return MD5(file).toHexString().toStdString();
+	}
+
+}
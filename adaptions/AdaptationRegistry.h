@@ -0,0 +1,69 @@
+/*
+   Copyright (c) 2020 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace knobkraft {
+
+	class GenericAdaptation;
+
+	// What we know about an adaptation file without importing its Python module
+	struct AdaptationManifestEntry {
+		std::string fileName;
+		std::string fileHash;
+		std::string synthName;
+		uint64 functionMask;
+		int numberOfBanks;
+		int numberOfPatchesPerBank;
+	};
+
+	// Makes sure every adaptation module is imported at most once per session, and keeps a manifest with the metadata
+	// of each adaptation file keyed by the hash of the file. The manifest is persisted, so for unchanged files questions
+	// like "what is the synth name" can be answered without running any Python.
+	class AdaptationRegistry {
+	public:
+		static AdaptationRegistry *instance();
+		// Releases all adaptations and stores the manifest, call before shutting down Python
+		static void shutdown();
+
+		// Returns the adaptation implemented by this file, importing it on the first request only. nullptr if it fails to load
+		std::shared_ptr<GenericAdaptation> adaptationForFile(File const &pythonFile);
+		// Returns the adaptation only if it has been imported already, never imports
+		std::shared_ptr<GenericAdaptation> loadedAdaptation(File const &pythonFile);
+		// Returns the manifest of that file, importing the module only when the file changed since we last saw it
+		std::optional<AdaptationManifestEntry> manifestForFile(File const &pythonFile);
+
+		// All candidate adaptation modules in a directory, i.e. excluding tests and pytest configuration
+		static std::vector<File> adaptationFilesInDirectory(File const &directory);
+
+		void saveManifest();
+
+	private:
+		AdaptationRegistry();
+
+		AdaptationManifestEntry createManifestEntry(File const &pythonFile, std::string const &fileHash, std::shared_ptr<GenericAdaptation> adaptation) const;
+		void loadManifest();
+		File manifestFile() const;
+		static std::string hashFile(File const &file);
+
+		static std::unique_ptr<AdaptationRegistry> instance_;
+
+		std::recursive_mutex lock_;
+		std::map<std::string, std::shared_ptr<GenericAdaptation>> loaded_; // Keyed by full path name of the module file
+		std::map<std::string, AdaptationManifestEntry> manifest_; // Keyed by full path name of the module file
+		bool manifestDirty_;
+	};
+
+}
@@ -0,0 +1,178 @@
+/*
+   Copyright (c) 2020 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "AdaptationResultCache.h"
+
+#include <spdlog/spdlog.h>
+#include "SpdLogJuce.h"
+#include <fmt/format.h>
+
+namespace knobkraft {
+
+	const char *kAdaptationCacheMagic = "KnobKraftAdaptationCache1";
+
+	AdaptationResultCache::AdaptationResultCache() : loaded_(false), dirty_(false)
+	{
+	}
+
+	AdaptationResultCache::~AdaptationResultCache()
+	{
+		save();
+	}
+
+	void AdaptationResultCache::open(std::string const &adaptationName, std::string const &moduleVersion)
+	{
+		std::lock_guard<std::mutex> lock(lock_);
+		adaptationName_ = adaptationName;
+		moduleVersion_ = moduleVersion;
+		entries_.clear();
+		usage_.clear();
+		loaded_ = false;
+		dirty_ = false;
+	}
+
+	void AdaptationResultCache::invalidate(std::string const &moduleVersion)
+	{
+		std::lock_guard<std::mutex> lock(lock_);
+		moduleVersion_ = moduleVersion;
+		entries_.clear();
+		usage_.clear();
+		// Don't load the stale file anymore, and make sure it gets overwritten
+		loaded_ = true;
+		dirty_ = true;
+	}
+
+	bool AdaptationResultCache::lookup(Kind kind, std::string const &dataHash, int index, std::string &outValue)
+	{
+		std::lock_guard<std::mutex> lock(lock_);
+		loadIfNeeded();
+		auto found = entries_.find(makeKey(kind, dataHash, index));
+		if (found != entries_.end()) {
+			usage_.splice(usage_.begin(), usage_, found->second.used);
+			outValue = found->second.value;
+			return true;
+		}
+		return false;
+	}
+
+	void AdaptationResultCache::store(Kind kind, std::string const &dataHash, int index, std::string const &value)
+	{
+		std::lock_guard<std::mutex> lock(lock_);
+		loadIfNeeded();
+		auto key = makeKey(kind, dataHash, index);
+		auto found = entries_.find(key);
+		if (found == entries_.end() || found->second.value != value) {
+			put(key, value);
+			dirty_ = true;
+		}
+	}
+
+	void AdaptationResultCache::put(std::string const &key, std::string const &value)
+	{
+		auto inserted = entries_.try_emplace(key);
+		auto &entry = inserted.first->second;
+		entry.value = value;
+		if (inserted.second) {
+			usage_.push_front(&inserted.first->first);
+			entry.used = usage_.begin();
+			if (entries_.size() > kMaxEntries) {
+				entries_.erase(*usage_.back());
+				usage_.pop_back();
+			}
+		}
+		else {
+			usage_.splice(usage_.begin(), usage_, entry.used);
+		}
+	}
+
+	size_t AdaptationResultCache::memoryUsage(size_t &outEntries)
+	{
+		std::lock_guard<std::mutex> lock(lock_);
+		outEntries = entries_.size();
+		size_t bytes = 0;
+		for (auto const &entry : entries_) {
+			// Node of the map and the string buffers, short strings live inside the node but this is an estimate anyway
+			bytes += sizeof(entry) + 7 * sizeof(void *) + entry.first.capacity() + entry.second.value.capacity();
+		}
+		return bytes;
+	}
+
+	void AdaptationResultCache::save()
+	{
+		std::lock_guard<std::mutex> lock(lock_);
+		if (!dirty_ || adaptationName_.empty()) {
+			return;
+		}
+		auto file = cacheFile();
+		TemporaryFile temp(file);
+		{
+			FileOutputStream out(temp.getFile());
+			if (out.failedToOpen()) {
+				spdlog::warn("Could not write adaptation cache file {}", file.getFullPathName());
+				return;
+			}
+			out.writeString(kAdaptationCacheMagic);
+			out.writeString(moduleVersion_);
+			out.writeInt((int) entries_.size());
+			// The least recently used first, so loading restores the order
+			for (auto key = usage_.rbegin(); key != usage_.rend(); ++key) {
+				out.writeString(**key);
+				out.writeString(entries_.at(**key).value);
+			}
+			out.flush();
+		}
+		if (temp.overwriteTargetFileWithTemporary()) {
+			dirty_ = false;
+		}
+	}
+
+	std::string AdaptationResultCache::hashOf(std::vector<uint8> const &data)
+	{
+		return MD5(data.data(), data.size()).toHexString().toStdString();
+	}
+
+	void AdaptationResultCache::loadIfNeeded()
+	{
+		if (loaded_) {
+			return;
+		}
+		loaded_ = true;
+		auto file = cacheFile();
+		if (adaptationName_.empty() || !file.existsAsFile()) {
+			return;
+		}
+		FileInputStream in(file);
+		if (in.failedToOpen() || in.readString().toStdString() != kAdaptationCacheMagic) {
+			return;
+		}
+		if (in.readString().toStdString() != moduleVersion_) {
+			// The adaptation changed since the cache was written, forget everything
+			dirty_ = true;
+			return;
+		}
+		int count = in.readInt();
+		for (int i = 0; i < count && !in.isExhausted(); i++) {
+			auto key = in.readString().toStdString();
+			auto value = in.readString().toStdString();
+			put(key, value);
+		}
+	}
+
+	File AdaptationResultCache::cacheFile() const
+	{
+		auto cacheDirectory = File::getSpecialLocation(File::userApplicationDataDirectory).getChildFile("KnobKraftOrm").getChildFile("AdaptationCache");
+		if (!cacheDirectory.exists()) {
+			cacheDirectory.createDirectory();
+		}
+		return cacheDirectory.getChildFile(File::createLegalFileName(adaptationName_) + ".cache");
+	}
+
+	std::string AdaptationResultCache::makeKey(Kind kind, std::string const &dataHash, int index)
+	{
+		return fmt::format("{}:{}:{}", static_cast<int>(kind), index, dataHash);
+	}
+
+}
@@ -0,0 +1,74 @@
+/*
+   Copyright (c) 2020 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include <list>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace knobkraft {
+
+	// Memoizes the results of adaptation functions that depend only on the bytes of a patch, like the name or the fingerprint.
+	// Entries are keyed by the MD5 of the patch data, and the whole cache is tied to a version string of the adaptation module,
+	// so a changed or reloaded module starts afresh. The cache is stored per adaptation in the application data directory.
+	// It holds at most kMaxEntries, beyond that the least recently used entries are dropped.
+	class AdaptationResultCache {
+	public:
+		enum class Kind {
+			Name = 0,
+			Fingerprint = 1,
+			NumberOfLayers = 2,
+			LayerName = 3,
+			StoredTags = 4
+		};
+
+		AdaptationResultCache();
+		~AdaptationResultCache();
+
+		// Define which adaptation this cache belongs to. Nothing is read from disk until the first lookup
+		void open(std::string const &adaptationName, std::string const &moduleVersion);
+		// Drop all entries, e.g. because the module was reloaded
+		void invalidate(std::string const &moduleVersion);
+
+		bool lookup(Kind kind, std::string const &dataHash, int index, std::string &outValue);
+		void store(Kind kind, std::string const &dataHash, int index, std::string const &value);
+
+		// Write the cache to disk if anything was added since it was loaded
+		void save();
+
+		// Estimated bytes held by the entries in memory, does not load the cache
+		size_t memoryUsage(size_t &outEntries);
+
+		static std::string hashOf(std::vector<uint8> const &data);
+
+		static constexpr size_t kMaxEntries = 100000;
+
+	private:
+		struct Entry {
+			std::string value;
+			std::list<std::string const *>::iterator used; // Position in usage_
+		};
+
+		void loadIfNeeded();
+		File cacheFile() const;
+		static std::string makeKey(Kind kind, std::string const &dataHash, int index);
+		void put(std::string const &key, std::string const &value);
+
+		std::mutex lock_;
+		std::string adaptationName_;
+		std::string moduleVersion_;
+		std::map<std::string, Entry> entries_;
+		std::list<std::string const *> usage_; // Keys of entries_, the most recently used first
+		bool loaded_;
+		bool dirty_;
+	};
+
+}
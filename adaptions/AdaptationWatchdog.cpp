@@ -0,0 +1,145 @@
+/*
+   Copyright (c) 2020 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "AdaptationWatchdog.h"
+
+#include "Settings.h"
+
+#include <pybind11/pybind11.h>
+
+#include <spdlog/spdlog.h>
+#include "SpdLogJuce.h"
+
+#include <algorithm>
+
+namespace knobkraft {
+
+	std::unique_ptr<AdaptationWatchdog> AdaptationWatchdog::instance_;
+
+	namespace {
+		std::string functionKey(std::string const &adaptationName, std::string const &functionName) {
+			return adaptationName + "/" + functionName;
+		}
+	}
+
+	AdaptationWatchdog &AdaptationWatchdog::instance()
+	{
+		if (!instance_) {
+			instance_.reset(new AdaptationWatchdog());
+		}
+		return *instance_;
+	}
+
+	void AdaptationWatchdog::shutdown()
+	{
+		instance_.reset();
+	}
+
+	AdaptationWatchdog::AdaptationWatchdog() : Thread("AdaptationWatchdog")
+	{
+		budgetMs_ = std::max(1, String(Settings::instance().get("AdaptationCallBudgetMs", std::to_string(kDefaultBudgetMs))).getIntValue());
+		timeoutMs_ = std::max(0, String(Settings::instance().get("AdaptationCallTimeoutMs", std::to_string(kDefaultTimeoutMs))).getIntValue());
+		if (timeoutMs_ > 0) {
+			startThread();
+		}
+	}
+
+	AdaptationWatchdog::~AdaptationWatchdog()
+	{
+		stopThread(2 * kCheckIntervalMs);
+	}
+
+	AdaptationWatchdog::Call::Call(std::string const &adaptationName, std::string const &functionName) : adaptationName_(adaptationName), functionName_(functionName)
+	{
+		slot_ = AdaptationWatchdog::instance().begin(this);
+	}
+
+	AdaptationWatchdog::Call::~Call()
+	{
+		AdaptationWatchdog::instance().end(this);
+	}
+
+	bool AdaptationWatchdog::isDegraded(std::string const &adaptationName, std::string const &functionName)
+	{
+		ScopedLock lock(lock_);
+		return degraded_.find(functionKey(adaptationName, functionName)) != degraded_.end();
+	}
+
+	int AdaptationWatchdog::begin(Call const *call)
+	{
+		for (size_t i = 0; i < kSlots; i++) {
+			auto &slot = slots_[i];
+			Call const *free = nullptr;
+			if (slot.call.compare_exchange_strong(free, call)) {
+				slot.threadId = PyThread_get_thread_ident();
+				slot.interrupted = false;
+				// Set last, the watchdog only looks at slots with a start time
+				slot.startMs = std::max((uint32) 1, Time::getMillisecondCounter());
+				return (int) i;
+			}
+		}
+		return -1;
+	}
+
+	void AdaptationWatchdog::end(Call const *call)
+	{
+		if (call->slot_ < 0) {
+			return;
+		}
+		auto &slot = slots_[(size_t) call->slot_];
+		auto elapsed = Time::getMillisecondCounter() - slot.startMs.load();
+		if (slot.interrupted) {
+			// The call might have returned before Python delivered the exception, it must not hit the next call of this thread
+			PyThreadState_SetAsyncExc(slot.threadId, nullptr);
+		}
+		slot.startMs = 0;
+		slot.call = nullptr;
+		if (elapsed > (uint32) budgetMs_) {
+			countSlowCall(call);
+		}
+	}
+
+	void AdaptationWatchdog::countSlowCall(Call const *call)
+	{
+		ScopedLock lock(lock_);
+		auto key = functionKey(call->adaptationName_, call->functionName_);
+		if (++slowCalls_[key] == kSlowCallsUntilDegraded) {
+			degraded_.insert(key);
+			spdlog::warn("Adaptation {}: {} took more than {} ms for {} calls now, the adaptation should be fixed to keep the UI responsive",
+				call->adaptationName_, call->functionName_, budgetMs_, kSlowCallsUntilDegraded);
+		}
+	}
+
+	void AdaptationWatchdog::run()
+	{
+		while (!threadShouldExit()) {
+			wait(kCheckIntervalMs);
+			auto isOverdue = [this](Slot const &slot, uint32 now) {
+				auto startMs = slot.startMs.load();
+				return startMs != 0 && !slot.interrupted && now - startMs > (uint32) timeoutMs_;
+			};
+			auto now = Time::getMillisecondCounter();
+			bool anyOverdue = std::any_of(slots_.begin(), slots_.end(), [&](Slot const &slot) { return isOverdue(slot, now); });
+			if (!anyOverdue || threadShouldExit()) {
+				continue;
+			}
+			// Python hands the GIL over every few milliseconds even in an endless loop. While we hold it, a call still registered
+			// can't have returned, as the calling thread needs the GIL to end it, so its names can be read
+			auto state = PyGILState_Ensure();
+			now = Time::getMillisecondCounter();
+			for (auto &slot : slots_) {
+				auto call = slot.call.load();
+				if (call && isOverdue(slot, now)) {
+					slot.interrupted = true;
+					PyThreadState_SetAsyncExc(slot.threadId, PyExc_TimeoutError);
+					spdlog::error("Adaptation {}: interrupting {} after {} ms", call->adaptationName_, call->functionName_, timeoutMs_);
+				}
+			}
+			PyGILState_Release(state);
+		}
+	}
+
+}
@@ -0,0 +1,82 @@
+/*
+   Copyright (c) 2020 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include <array>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+
+namespace knobkraft {
+
+	// Measures every call into an adaptation against a time budget. A function that exceeds the budget again and again is marked
+	// degraded with a warning. A call still running after the much longer timeout is interrupted by raising a TimeoutError in its
+	// thread, so an endless loop in a third party adaptation can't freeze the message thread forever.
+	// Budget and timeout come from the settings AdaptationCallBudgetMs and AdaptationCallTimeoutMs, a timeout of 0 turns interrupting off.
+	// A running call occupies a slot with its start time as atomic, so calls don't take a lock unless they were over budget.
+	class AdaptationWatchdog : private Thread {
+	public:
+		static AdaptationWatchdog &instance();
+		// Stop watching before the interpreter goes away
+		static void shutdown();
+
+		// Registers a running call for its lifetime. Construct and destroy with the GIL held
+		class Call {
+		public:
+			// The names must outlive the call
+			Call(std::string const &adaptationName, std::string const &functionName);
+			~Call();
+
+		private:
+			friend class AdaptationWatchdog;
+			std::string const &adaptationName_;
+			std::string const &functionName_;
+			int slot_; // -1 when all slots are taken, the call is then not watched
+		};
+
+		bool isDegraded(std::string const &adaptationName, std::string const &functionName);
+
+		static constexpr int kDefaultBudgetMs = 250;
+		static constexpr int kDefaultTimeoutMs = 10000;
+		static constexpr int kSlowCallsUntilDegraded = 5;
+		static constexpr int kCheckIntervalMs = 100;
+		// More calls than this run at the same time only when adaptations call each other
+		static constexpr size_t kSlots = 32;
+
+		~AdaptationWatchdog() override;
+
+	private:
+		AdaptationWatchdog();
+
+		void run() override;
+
+		int begin(Call const *call);
+		void end(Call const *call);
+		void countSlowCall(Call const *call);
+
+		struct Slot {
+			std::atomic<Call const *> call { nullptr }; // Only dereferenced with the GIL held, calls begin and end with it held
+			std::atomic<unsigned long> threadId { 0 };
+			std::atomic<bool> interrupted { false };
+			std::atomic<uint32> startMs { 0 }; // 0 while the slot is free
+		};
+
+		std::array<Slot, kSlots> slots_;
+		CriticalSection lock_; // Guards the statistics of the slow calls only
+		std::map<std::string, int> slowCalls_; // Keyed by adaptation and function name
+		std::set<std::string> degraded_;
+		int budgetMs_;
+		int timeoutMs_;
+
+		static std::unique_ptr<AdaptationWatchdog> instance_;
+	};
+
+}
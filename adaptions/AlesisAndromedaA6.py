@@ -141,6 +141,14 @@ def isBankDumpFinished(messages):
     return count == numberOfPatchesPerBank()
 
 
+def bankDumpProgress(message, state):
+    # Incremental version of isBankDumpFinished(), only called with each new message. The state counts the dumps seen so far
+    count = state if state is not None else 0
+    if isPartOfBankDump(message):
+        count = count + 1
+    return count == numberOfPatchesPerBank(), count
+
+
 def extractPatchesFromBank(message):
     if isSingleProgramDump(message):
         return message
@@ -0,0 +1,60 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "BankDumpLayout.h"
+
+#include <algorithm>
+
+namespace knobkraft {
+
+	void BankDumpLayout::setLayout(std::shared_ptr<Layout const> layout)
+	{
+		std::atomic_store(&layout_, layout);
+	}
+
+	bool BankDumpLayout::isDeclared() const
+	{
+		return std::atomic_load(&layout_) != nullptr;
+	}
+
+	bool BankDumpLayout::extract(MidiMessage const &bank, std::vector<MidiMessage> &outProgramDumps) const
+	{
+		auto layout = std::atomic_load(&layout_);
+		if (!layout || layout->stride == 0) {
+			return false;
+		}
+		auto data = bank.getRawData();
+		auto size = (size_t) bank.getRawDataSize();
+		size_t available = size >= layout->header + layout->trailer ? (size - layout->header - layout->trailer) / layout->stride : 0;
+		size_t count = layout->count > 0 ? layout->count : available;
+		if (count > available) {
+			return false;
+		}
+		for (auto const &byte : layout->prefix) {
+			if (byte.fromBank && byte.offset >= size) {
+				return false;
+			}
+		}
+
+		// The prefix is the same for all voices, only the voice bytes are copied from the bank for each
+		std::vector<uint8> programDump;
+		programDump.reserve(layout->prefix.size() + layout->stride + layout->suffix.size());
+		for (auto const &byte : layout->prefix) {
+			programDump.push_back(byte.fromBank ? (uint8) (data[byte.offset] & byte.mask) : byte.value);
+		}
+		size_t voiceStart = programDump.size();
+		programDump.resize(voiceStart + layout->stride);
+		programDump.insert(programDump.end(), layout->suffix.begin(), layout->suffix.end());
+
+		outProgramDumps.reserve(outProgramDumps.size() + count);
+		for (size_t i = 0; i < count; i++) {
+			std::copy_n(data + layout->header + i * layout->stride, layout->stride, programDump.begin() + (std::ptrdiff_t) voiceStart);
+			outProgramDumps.emplace_back(programDump.data(), (int) programDump.size());
+		}
+		return true;
+	}
+
+}
@@ -0,0 +1,48 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include <memory>
+#include <vector>
+
+namespace knobkraft {
+
+	// Many implementations of extractPatchesFromBank() just cut the bank message into voices of a fixed size and put the
+	// same header in front of each. Adaptations can declare this as data, the bank is then cut here without calling Python.
+	// Like the SysexMatchers, the layout is replaced as a whole when the module is (re)loaded, and can be read from any thread.
+	class BankDumpLayout {
+	public:
+		struct PrefixByte {
+			bool fromBank;  // Copy the byte at offset of the bank message, else value is used as is
+			uint8 value;
+			size_t offset;
+			uint8 mask;     // And-ed with the copied byte, e.g. to keep only the channel
+		};
+
+		struct Layout {
+			size_t header = 0;   // Bytes before the first voice, the 0xf0 included
+			size_t stride = 0;   // Bytes per voice
+			size_t count = 0;    // 0 for as many voices as fit
+			size_t trailer = 1;  // Bytes after the last voice, usually just the 0xf7
+			std::vector<PrefixByte> prefix;
+			std::vector<uint8> suffix { 0xf7 };
+		};
+
+		// Pass nullptr if the module declares no layout
+		void setLayout(std::shared_ptr<Layout const> layout);
+		bool isDeclared() const;
+
+		// Return false if there is no layout or the bank is too short for the declared count, Python needs to be asked then
+		bool extract(MidiMessage const &bank, std::vector<MidiMessage> &outProgramDumps) const;
+
+	private:
+		std::shared_ptr<Layout const> layout_; // Only accessed with std::atomic_load and std::atomic_store
+	};
+
+}
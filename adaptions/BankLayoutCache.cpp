@@ -0,0 +1,122 @@
+/*
+   Copyright (c) 2022 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "BankLayoutCache.h"
+
+namespace knobkraft {
+
+	BankLayoutCache::BankLayoutCache() : generation_(0), programNamesFilled_(false)
+	{
+	}
+
+	template <typename T> T BankLayoutCache::memoize(std::optional<T> &slot, std::function<std::optional<T>()> const &compute, T const &fallback)
+	{
+		uint64 generation;
+		{
+			std::lock_guard<std::mutex> lock(lock_);
+			if (slot.has_value()) {
+				return *slot;
+			}
+			generation = generation_;
+		}
+		auto result = compute();
+		if (!result.has_value()) {
+			return fallback;
+		}
+		std::lock_guard<std::mutex> lock(lock_);
+		if (generation == generation_) {
+			slot = result;
+		}
+		return *result;
+	}
+
+	int BankLayoutCache::numberOfBanks(std::function<std::optional<int>()> const &compute, int fallback)
+	{
+		return memoize(numberOfBanks_, compute, fallback);
+	}
+
+	int BankLayoutCache::numberOfPatches(std::function<std::optional<int>()> const &compute, int fallback)
+	{
+		return memoize(numberOfPatches_, compute, fallback);
+	}
+
+	std::vector<midikraft::BankDescriptor> BankLayoutCache::bankDescriptors(std::function<std::optional<std::vector<midikraft::BankDescriptor>>()> const &compute)
+	{
+		return memoize(bankDescriptors_, compute, {});
+	}
+
+	std::string BankLayoutCache::friendlyBankName(int zeroBasedBank, std::function<std::optional<std::string>()> const &compute, std::string const &fallback)
+	{
+		uint64 generation;
+		{
+			std::lock_guard<std::mutex> lock(lock_);
+			auto found = bankNames_.find(zeroBasedBank);
+			if (found != bankNames_.end()) {
+				return found->second;
+			}
+			generation = generation_;
+		}
+		auto result = compute();
+		if (!result.has_value()) {
+			return fallback;
+		}
+		std::lock_guard<std::mutex> lock(lock_);
+		if (generation == generation_) {
+			bankNames_[zeroBasedBank] = *result;
+		}
+		return *result;
+	}
+
+	std::string BankLayoutCache::friendlyProgramName(int zeroBasedWithBank, std::function<TProgramNames()> const &fillAll,
+		std::function<std::optional<std::string>()> const &compute, std::string const &fallback)
+	{
+		uint64 generation;
+		bool filled;
+		{
+			std::lock_guard<std::mutex> lock(lock_);
+			auto found = programNames_.find(zeroBasedWithBank);
+			if (found != programNames_.end()) {
+				return found->second;
+			}
+			generation = generation_;
+			filled = programNamesFilled_;
+		}
+		if (!filled) {
+			auto all = fillAll();
+			std::lock_guard<std::mutex> lock(lock_);
+			if (generation == generation_) {
+				programNames_.insert(all.begin(), all.end());
+				programNamesFilled_ = true;
+				auto found = programNames_.find(zeroBasedWithBank);
+				if (found != programNames_.end()) {
+					return found->second;
+				}
+			}
+		}
+		auto result = compute();
+		if (!result.has_value()) {
+			return fallback;
+		}
+		std::lock_guard<std::mutex> lock(lock_);
+		if (generation == generation_) {
+			programNames_[zeroBasedWithBank] = *result;
+		}
+		return *result;
+	}
+
+	void BankLayoutCache::flush()
+	{
+		std::lock_guard<std::mutex> lock(lock_);
+		generation_++;
+		numberOfBanks_.reset();
+		numberOfPatches_.reset();
+		bankDescriptors_.reset();
+		bankNames_.clear();
+		programNames_.clear();
+		programNamesFilled_ = false;
+	}
+
+}
@@ -0,0 +1,57 @@
+/*
+   Copyright (c) 2022 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include "HasBanksCapability.h"
+
+#include <functional>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace knobkraft {
+
+	// The bank layout of an adaptation, i.e. the number and size of the banks, their names and the friendly names of all program slots.
+	// These never change while a module is loaded, but are asked for all the time by the tree, the bank panels and every patch button.
+	// Each value is computed once by the given function, which runs without the lock held and returns nothing on error, so errors
+	// are not memoized. Flush when the module is reloaded.
+	class BankLayoutCache {
+	public:
+		typedef std::map<int, std::string> TProgramNames; // Keyed by MidiProgramNumber::toZeroBasedWithBank()
+
+		BankLayoutCache();
+
+		int numberOfBanks(std::function<std::optional<int>()> const &compute, int fallback);
+		int numberOfPatches(std::function<std::optional<int>()> const &compute, int fallback);
+		std::vector<midikraft::BankDescriptor> bankDescriptors(std::function<std::optional<std::vector<midikraft::BankDescriptor>>()> const &compute);
+		std::string friendlyBankName(int zeroBasedBank, std::function<std::optional<std::string>()> const &compute, std::string const &fallback);
+
+		// The first miss fills the names of all program slots with fillAll, later misses, e.g. for a program without a known bank,
+		// compute only that one name
+		std::string friendlyProgramName(int zeroBasedWithBank, std::function<TProgramNames()> const &fillAll,
+			std::function<std::optional<std::string>()> const &compute, std::string const &fallback);
+
+		void flush();
+
+	private:
+		template <typename T> T memoize(std::optional<T> &slot, std::function<std::optional<T>()> const &compute, T const &fallback);
+
+		std::mutex lock_;
+		uint64 generation_; // Results computed before a flush are not stored
+		std::optional<int> numberOfBanks_;
+		std::optional<int> numberOfPatches_;
+		std::optional<std::vector<midikraft::BankDescriptor>> bankDescriptors_;
+		std::map<int, std::string> bankNames_;
+		TProgramNames programNames_;
+		bool programNamesFilled_;
+	};
+
+}
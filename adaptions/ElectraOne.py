@@ -103,10 +103,31 @@ def renamePatch(message, newName):
 
 def convertToEditBuffer(channel, message):
     if isEditBufferDump(message):
-        return message
+        # Presets edited by hand are often pretty printed, the whitespace is sent for nothing and makes the upload longer
+        try:
+            return jsonToPreset(presetToJson(message))
+        except json.JSONDecodeError:
+            # Send corrupted presets the way they are, maybe the Electra One knows what to do with them
+            return message
     raise Exception("This is not an Electra One preset dump - can't be converted")
 
 
+def isUploadAcknowledgement(message):
+    # The Electra One answers each upload with an ACK or NACK response once it has processed it, so the next preset can be sent right away
+    if (len(message) > 6
+            and message[0] == 0xf0
+            and message[1] == 0x00
+            and message[2] == 0x21
+            and message[3] == 0x45  # Electra manufacturer ID
+            and message[4] == 0x7e):  # Response
+        if message[5] == 0x01:  # ACK
+            return True
+        if message[5] == 0x00:  # NACK
+            return False
+    # Other responses, e.g. the event messages, are no answer to the upload
+    return None
+
+
 def presetToJson(message):
     jsonBlock = message[6:-1]
     jsonString = ''.join([chr(x) for x in jsonBlock])
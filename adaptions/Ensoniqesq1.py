@@ -117,11 +117,15 @@ def isBankDumpFinished(messages):
     return False
 
 
+# The same cutting as extractPatchesFromBank() below, declared so the Orm can do it without calling Python
+bankDumpLayout = {"header": 5, "stride": 204, "prefix": [0xf0, 0x0f, 0x02, (3, 0x0f), 0x01], "suffix": [0xf7]}
+
+
 def extractPatchesFromBank(message):
     # A bank dump consists of 8166 bytes: 5 in the header, 8160 (in 40 programs of 204), 1 in the footer.
     # Why is 'patch' mixed up with 'program' here?
     if isPartOfBankDump(message):
-        channel = message[2]
+        channel = message[3]
         data = message[5:-1]
         # After removing the sysex header and footer we are left with 40 programs of 204 bytes each
         data_pointer = 0
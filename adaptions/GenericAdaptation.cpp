@@ -12,8 +12,15 @@
 
 #include "PythonUtils.h"
 #include "Settings.h"
+#include "AcknowledgedUpload.h"
+#include "MessagePacer.h"
 
+#include "AdaptationBytecodeCache.h"
+#include "AdaptationErrorLog.h"
+#include "AdaptationRegistry.h"
+#include "NativeSysexModule.h"
 #include "GenericPatch.h"
+#include "MultiBufferMD5.h"
 #include "GenericEditBufferCapability.h"
 #include "GenericProgramDumpCapability.h"
 #include "GenericBankDumpCapability.h"
@@ -21,6 +28,9 @@
 #include "GenericHasBankDescriptorsCapability.h"
 
 #include <pybind11/stl.h>
+#include <algorithm>
+#include <cstring>
+#include <map>
 #include <memory>
 #include <spdlog/spdlog.h>
 #include "SpdLogJuce.h"
@@ -43,10 +53,12 @@ namespace knobkraft {
 		*kNeedsChannelSpecificDetection = "needsChannelSpecificDetection",
 		*kDeviceDetectWaitMilliseconds = "deviceDetectWaitMilliseconds",
 		*kNameFromDump = "nameFromDump",
+		*kNameFromDumps = "nameFromDumps",
 		*kRenamePatch = "renamePatch",
 		*kIsDefaultName = "isDefaultName",
 		*kIsEditBufferDump = "isEditBufferDump",
 		*kIsPartOfEditBufferDump = "isPartOfEditBufferDump",
+		*kEditBufferDumpProgress = "editBufferDumpProgress",
 		*kCreateEditBufferRequest = "createEditBufferRequest",
 		*kConvertToEditBuffer = "convertToEditBuffer",
 		*kIsSingleProgramDump = "isSingleProgramDump",
@@ -57,16 +69,24 @@ namespace knobkraft {
 		*kCreateBankDumpRequest = "createBankDumpRequest",
 		*kIsPartOfBankDump = "isPartOfBankDump",
 		*kIsBankDumpFinished = "isBankDumpFinished",
+		*kBankDumpProgress = "bankDumpProgress",
 		*kExtractPatchesFromBank = "extractPatchesFromBank",
 		*kNumberOfLayers = "numberOfLayers",
 		*kLayerName = "layerName",
 		*kSetLayerName = "setLayerName",
 		*kGeneralMessageDelay = "generalMessageDelay",
+		*kMessageBytesPerSecond = "messageBytesPerSecond",
+		*kIsUploadAcknowledgement = "isUploadAcknowledgement",
 		*kCalculateFingerprint = "calculateFingerprint",
+		*kCalculateFingerprints = "calculateFingerprints",
 		*kFriendlyBankName = "friendlyBankName",
 		*kFriendlyProgramName = "friendlyProgramName",
 		*kSetupHelp = "setupHelp",
-		*kGetStoredTags = "storedTags";
+		*kGetStoredTags = "storedTags",
+		*kMidiDataAsBytes = "midiDataAsBytes",
+		*kSysexHeaders = "sysexHeaders",
+		*kSysexMatchers = "sysexMatchers",
+		*kBankDumpLayout = "bankDumpLayout";
 
 	std::vector<const char *> kAdapatationPythonFunctionNames = {
 		kName,
@@ -79,10 +99,12 @@ namespace knobkraft {
 		kNeedsChannelSpecificDetection,
 		kDeviceDetectWaitMilliseconds,
 		kNameFromDump,
+		kNameFromDumps,
 		kIsDefaultName,
 		kRenamePatch,
 		kIsEditBufferDump,
 		kIsPartOfEditBufferDump,
+		kEditBufferDumpProgress,
 		kCreateEditBufferRequest,
 		kConvertToEditBuffer,
 		kIsSingleProgramDump,
@@ -93,12 +115,16 @@ namespace knobkraft {
 		kCreateBankDumpRequest,
 		kIsPartOfBankDump,
 		kIsBankDumpFinished,
+		kBankDumpProgress,
 		kExtractPatchesFromBank,
 		kNumberOfLayers,
 		kLayerName,
 		kSetLayerName,
 		kGeneralMessageDelay,
+		kMessageBytesPerSecond,
+		kIsUploadAcknowledgement,
 		kCalculateFingerprint,
+		kCalculateFingerprints,
 		kFriendlyBankName,
 		kFriendlyProgramName,
 		kSetupHelp,
@@ -126,7 +152,7 @@ namespace knobkraft {
 		using std::runtime_error::runtime_error;
 	};
 
-	GenericAdaptation::GenericAdaptation(std::string const &pythonModuleFilePath) : filepath_(pythonModuleFilePath)
+	GenericAdaptation::GenericAdaptation(std::string const &pythonModuleFilePath) : resolvedFunctionMask_(0), midiDataAsBytes_(false), filepath_(pythonModuleFilePath)
 	{
 		py::gil_scoped_acquire acquire;
 		editBufferCapabilityImpl_ = std::make_shared<GenericEditBufferCapability>(this);
@@ -134,6 +160,7 @@ namespace knobkraft {
 		bankDumpCapabilityImpl_ = std::make_shared<GenericBankDumpCapability>(this);
 		hasBanksCapabilityImpl_ = std::make_shared<GenericHasBanksCapability>(this);
 		hasBankDescriptorsCapabilityImpl_= std::make_shared<GenericHasBankDescriptorsCapability>(this);
+		patchCapabilitiesImpl_ = std::make_shared<GenericPatchCapabilities>(this);
 		try {
 			// Validate that the filename is a good idea
 			/*auto result = py::dict("filename"_a = pythonModuleFilePath);
@@ -147,7 +174,9 @@ namespace knobkraft {
 			}*/
 			adaptation_module = py::module::import(filepath_.c_str());
 			checkForPythonOutputAndLog();
+			resolvePythonFunctions();
 			adaptationName_ = getName(); //TODO - shouldn't call a virtual method here!
+			resultCache_.open(adaptationName_, moduleVersion());
 		}
 		catch (py::error_already_set &ex) {
 			spdlog::error("Adaptation: Failure loading python module {}: {}", pythonModuleFilePath, ex.what());
@@ -160,18 +189,27 @@ namespace knobkraft {
 		}
 	}
 
-	GenericAdaptation::GenericAdaptation(pybind11::module adaptationModule)
+	GenericAdaptation::GenericAdaptation(pybind11::module adaptationModule) : resolvedFunctionMask_(0), midiDataAsBytes_(false)
 	{
 		py::gil_scoped_acquire acquire;
 		editBufferCapabilityImpl_ = std::make_shared<GenericEditBufferCapability>(this);
 		programDumpCapabilityImpl_ = std::make_shared<GenericProgramDumpCapability>(this);
 		bankDumpCapabilityImpl_ = std::make_shared<GenericBankDumpCapability>(this);
-		adaptation_module = adaptationModule;		
+		patchCapabilitiesImpl_ = std::make_shared<GenericPatchCapabilities>(this);
+		adaptation_module = adaptationModule;
+		resolvePythonFunctions();
 	}
 
 	GenericAdaptation::~GenericAdaptation()
 	{
 		py::gil_scoped_acquire gil;
+		if (bankDumpCapabilityImpl_) {
+			bankDumpCapabilityImpl_->resetIncrementalState();
+		}
+		if (editBufferCapabilityImpl_) {
+			editBufferCapabilityImpl_->resetIncrementalState();
+		}
+		resolvedFunctions_.clear();
 		adaptation_module.release();
 	}
 
@@ -192,11 +230,15 @@ namespace knobkraft {
 				sys.modules[adaptation_name] = this_module
 			)", py::globals(), locals);
 			checkForPythonOutputAndLog();
-			py::exec(adaptationCode, adaptation_module.attr("__dict__")); // Now run the define statements in the code, creating the defines within the right namespace
+			// Now run the define statements in the code, creating the defines within the right namespace. The compiled code is cached on disk
+			auto code = AdaptationBytecodeCache::compile(moduleName, adaptationCode);
+			py::module::import("builtins").attr("exec")(code, adaptation_module.attr("__dict__"));
 			checkForPythonOutputAndLog();
 			auto newAdaptation = std::make_shared<GenericAdaptation>(py::cast<py::module>(adaptation_module));
 			//if (newAdaptation) newAdaptation->logNamespace();
 			newAdaptation->adaptationName_ = newAdaptation->getName();
+			newAdaptation->codeVersion_ = MD5(adaptationCode.data(), adaptationCode.size()).toHexString().toStdString();
+			newAdaptation->resultCache_.open(newAdaptation->adaptationName_, newAdaptation->codeVersion_);
 			return newAdaptation;
 		}
 		catch (py::error_already_set &ex) {
@@ -269,7 +311,9 @@ namespace knobkraft {
 		std::string command = "import sys\nsys.path.append(R\"" + getAdaptationDirectory().getFullPathName().toStdString() + "\")\n"
 				+ "sys.path.append(R\"" + pathToTheOrm.getFullPathName().toStdString() + "\")\n" // This is where Linux searches
 				+ "sys.path.append(R\"" + pathToTheOrm.getChildFile("adaptations").getFullPathName().toStdString() + "\")\n" // This is where we place the adaptation modules
-				+ "sys.path.append(R\"" + pathToTheOrm.getChildFile("python").getFullPathName().toStdString() + "\")\n"; // This is the path in the Mac DMG
+				+ "sys.path.append(R\"" + pathToTheOrm.getChildFile("python").getFullPathName().toStdString() + "\")\n" // This is the path in the Mac DMG
+				// The install directory is usually not writable, so the pyc files of the built-in adaptations would be compiled again with every start
+				+ "sys.pycache_prefix = R\"" + AdaptationBytecodeCache::pycachePrefix().getFullPathName().toStdString() + "\"\n";
 		py::exec(command);
 #ifdef __APPLE__
 		// For Apple (probably for Linux as well?) we need to append the path "python" to the python sys path, so it will find 
@@ -279,6 +323,7 @@ namespace knobkraft {
 		py::exec(command);
 #endif
 		checkForPythonOutputAndLog();
+		spdlog::debug("Native sysex helpers for adaptations available as module {}", nativeSysexModuleName());
 		sGenericAdaptationDontLockGIL = std::make_unique<py::gil_scoped_release>();
 		// From this point on, whenever you want to call into python you need to acquire the GIL 
 		// with:
@@ -288,6 +333,10 @@ namespace knobkraft {
 
 	void GenericAdaptation::shutdownGenericAdaptation()
 	{
+		// The registry keeps all adaptations alive, they need to go before the interpreter does
+		AdaptationRegistry::shutdown();
+		AdaptationWatchdog::shutdown();
+		AdaptationErrorLog::instance().flush();
 		// Remove the global release on Python, else the destruction code will fail!
 		{
 			py::gil_scoped_acquire acquire;
@@ -349,22 +398,12 @@ else {
 	std::vector<std::shared_ptr<GenericAdaptation>> GenericAdaptation::allAdaptationsInOneDirectory(std::string const& directory)
 	{
 		std::vector<std::shared_ptr<GenericAdaptation>> result;
-		File adaptationDirectory(directory);
-		if (adaptationDirectory.exists() && adaptationDirectory.isDirectory()) {
-			for (auto f : adaptationDirectory.findChildFiles(File::findFiles, false, "*.py")) {
-				try {
-					if (!f.getFileName().startsWith("test_") && f.getFileName() != "conftest.py") {
-						result.push_back(std::make_shared<GenericAdaptation>(f.getFileNameWithoutExtension().toStdString()));
-					}
-				}
-				catch (FatalAdaptationException&) {
-					spdlog::error("Unloading adaptation module {}", String(f.getFullPathName()));
-				}
+		for (auto const &f : AdaptationRegistry::adaptationFilesInDirectory(File(directory))) {
+			auto adaptation = AdaptationRegistry::instance()->adaptationForFile(f);
+			if (adaptation) {
+				result.push_back(adaptation);
 			}
 		}
-		else {
-			spdlog::warn("Directory given '{}' does not exist or is not a directory", directory);
-		}
 		return result;
 	}
 
@@ -386,24 +425,28 @@ else {
 			result = allAdaptationsInOneDirectory(adaptationDirectory.getFullPathName().toStdString());
 		}
 
-		// Then, load all adaptations in the directory of the current executable
+		// Then, load all adaptations in the directory of the current executable. The manifest tells us the synth name
+		// without importing, so built-ins overridden by a user adaptation are never loaded at all
+		auto registry = AdaptationRegistry::instance();
 		auto installDirectory = File::getSpecialLocation(File::SpecialLocationType::currentExecutableFile).getParentDirectory().getChildFile("adaptations");
-		auto builtIns = allAdaptationsInOneDirectory(installDirectory.getFullPathName().toStdString());
-		for (auto& builtin : builtIns)
-		{
-			if (std::none_of(result.begin(), result.end(), [&](std::shared_ptr<midikraft::SimpleDiscoverableDevice> device) { return device->getName() == builtin->getName(); }))
+		for (auto const &f : AdaptationRegistry::adaptationFilesInDirectory(installDirectory)) {
+			auto manifest = registry->manifestForFile(f);
+			if (!manifest.has_value()) {
+				continue;
+			}
+			if (std::none_of(result.begin(), result.end(), [&](std::shared_ptr<midikraft::SimpleDiscoverableDevice> device) { return device->getName() == manifest->synthName; }))
 			{
-				result.push_back(builtin);
+				auto builtin = registry->adaptationForFile(f);
+				if (builtin) {
+					result.push_back(builtin);
+				}
 			}
 			else
 			{
-				spdlog::warn("Overriding built-in adaptation {} (found in user directory {})", builtin->getName(), getAdaptationDirectory().getFullPathName().toStdString());
+				spdlog::warn("Overriding built-in adaptation {} (found in user directory {})", manifest->synthName, getAdaptationDirectory().getFullPathName().toStdString());
 			}
 		}
-		{
-			py::gil_scoped_acquire gil;
-			builtIns.clear();
-		}
+		registry->saveManifest();
 		return result;
 	}
 
@@ -411,26 +454,28 @@ else {
 	{
 		std::vector<std::string> result;
 		auto installDirectory = File::getSpecialLocation(File::SpecialLocationType::currentExecutableFile).getParentDirectory().getChildFile("adaptations");
-		auto builtIns = allAdaptationsInOneDirectory(installDirectory.getFullPathName().toStdString());
-		for (auto a : builtIns) {
-			result.push_back(a->getName());
+		for (auto const &f : AdaptationRegistry::adaptationFilesInDirectory(installDirectory)) {
+			auto manifest = AdaptationRegistry::instance()->manifestForFile(f);
+			if (manifest.has_value()) {
+				result.push_back(manifest->synthName);
+			}
 		}
 		return result;
 	}
 
 	bool GenericAdaptation::breakOut(std::string synthName)
 	{
-		// Find it
-		std::shared_ptr<GenericAdaptation> adaptation;
+		// Find it, the manifest knows which file implements which synth
+		File sourceFile;
 		auto installDirectory = File::getSpecialLocation(File::SpecialLocationType::currentExecutableFile).getParentDirectory().getChildFile("adaptations");
-		auto builtIns = allAdaptationsInOneDirectory(installDirectory.getFullPathName().toStdString());
-		for (auto a : builtIns) {
-			if (a->getName() == synthName) {
-				adaptation = a;
+		for (auto const &f : AdaptationRegistry::adaptationFilesInDirectory(installDirectory)) {
+			auto manifest = AdaptationRegistry::instance()->manifestForFile(f);
+			if (manifest.has_value() && manifest->synthName == synthName) {
+				sourceFile = f;
 				break;
 			}
 		}
-		if (!adaptation) {
+		if (sourceFile == File()) {
 			spdlog::error("Program error - could not find adaptation for synth {}", synthName);
 			return false;
 		}
@@ -438,9 +483,8 @@ else {
 		auto dir = GenericAdaptation::getAdaptationDirectory();
 
 		// Copy out source code
-		File sourceFile(adaptation->getSourceFilePath());
 		if (!sourceFile.existsAsFile()) {
-			spdlog::error("Program error - could not find source code for module to break out at {}", adaptation->getSourceFilePath());
+			spdlog::error("Program error - could not find source code for module to break out at {}", sourceFile.getFullPathName());
 			return false;
 		}
 		File target = dir.getChildFile(sourceFile.getFileName());
@@ -451,7 +495,7 @@ else {
 
 		if (!sourceFile.copyFileTo(target))
 		{
-			spdlog::error("Program error - could not copy {} to {}", adaptation->getSourceFilePath(), target.getFullPathName().toStdString());
+			spdlog::error("Program error - could not copy {} to {}", sourceFile.getFullPathName().toStdString(), target.getFullPathName().toStdString());
 			return false;
 		}
 		else 
@@ -461,7 +505,172 @@ else {
 	}
 
 
+	int GenericAdaptation::pythonFunctionIndex(std::string const &functionName)
+	{
+		static std::map<std::string, int> sFunctionIndex = []() {
+			std::map<std::string, int> index;
+			for (size_t i = 0; i < kAdapatationPythonFunctionNames.size(); i++) {
+				index[kAdapatationPythonFunctionNames[i]] = (int) i;
+			}
+			return index;
+		}();
+		auto found = sFunctionIndex.find(functionName);
+		return found != sFunctionIndex.end() ? found->second : -1;
+	}
+
+	void GenericAdaptation::resolvePythonFunctions()
+	{
+		py::gil_scoped_acquire acquire;
+		jassert(kAdapatationPythonFunctionNames.size() <= 64);
+		uint64 mask = 0;
+		resolvedFunctions_.clear();
+		resolvedFunctions_.resize(kAdapatationPythonFunctionNames.size());
+		if (adaptation_module) {
+			for (size_t i = 0; i < kAdapatationPythonFunctionNames.size(); i++) {
+				if (py::hasattr(adaptation_module, kAdapatationPythonFunctionNames[i])) {
+					resolvedFunctions_[i] = adaptation_module.attr(kAdapatationPythonFunctionNames[i]);
+					mask |= (1ULL << i);
+				}
+			}
+		}
+		resolvedFunctionMask_ = mask;
+
+		// This is a module attribute, not a function. Opt in to receive bytes instead of lists of ints
+		bool asBytes = false;
+		if (adaptation_module && py::hasattr(adaptation_module, kMidiDataAsBytes)) {
+			try {
+				asBytes = py::cast<bool>(adaptation_module.attr(kMidiDataAsBytes));
+			}
+			catch (py::cast_error &) {
+				spdlog::warn("Adaptation: module attribute {} must be True or False, ignoring", kMidiDataAsBytes);
+			}
+		}
+		midiDataAsBytes_ = asBytes;
+
+		// Also a module attribute - the headers of all sysex messages the adaptation wants to see, as a list of lists of bytes
+		std::vector<SysexPrefilter::THeader> headers;
+		if (adaptation_module && py::hasattr(adaptation_module, kSysexHeaders)) {
+			try {
+				for (auto const &header : py::cast<py::list>(adaptation_module.attr(kSysexHeaders))) {
+					SysexPrefilter::THeader bytes;
+					for (auto const &byte : py::cast<py::list>(header)) {
+						// None is the wildcard, e.g. for the device ID
+						bytes.push_back(byte.is_none() ? SysexPrefilter::kAnyByte : (py::cast<int>(byte) & 0x7f));
+					}
+					headers.push_back(bytes);
+				}
+			}
+			catch (py::cast_error &) {
+				spdlog::warn("Adaptation: module attribute {} must be a list of lists of bytes, ignoring", kSysexHeaders);
+				headers.clear();
+			}
+		}
+		sysexPrefilter_.setHeaders(headers);
+
+		// And the declared predicates, a dict from function name to byte conditions and length
+		std::map<std::string, SysexMatchers::Declaration> declarations;
+		if (adaptation_module && py::hasattr(adaptation_module, kSysexMatchers)) {
+			try {
+				for (auto const &item : py::cast<py::dict>(adaptation_module.attr(kSysexMatchers))) {
+					auto functionName = py::cast<std::string>(item.first);
+					if (functionName != kIsEditBufferDump && functionName != kIsSingleProgramDump && functionName != kIsPartOfBankDump) {
+						throw std::runtime_error(fmt::format("{} can't be declared, only {}, {} and {} can", functionName, kIsEditBufferDump, kIsSingleProgramDump, kIsPartOfBankDump));
+					}
+					auto spec = py::cast<py::dict>(item.second);
+					SysexMatchers::Declaration declaration;
+					if (spec.contains("bytes")) {
+						for (auto const &condition : py::cast<py::list>(spec["bytes"])) {
+							// A tuple (offset, value) or (offset, value, mask)
+							auto values = py::cast<std::vector<int>>(condition);
+							if (values.size() != 2 && values.size() != 3) {
+								throw std::runtime_error("byte conditions must be (offset, value) or (offset, value, mask)");
+							}
+							uint8 mask = values.size() == 3 ? (uint8) values[2] : 0xff;
+							declaration.bytes.push_back({ (size_t) values[0], (uint8) (values[1] & mask), mask });
+						}
+					}
+					if (spec.contains("length")) {
+						py::object length = spec["length"];
+						if (py::isinstance<py::int_>(length)) {
+							declaration.minLength = declaration.maxLength = py::cast<size_t>(length);
+						}
+						else {
+							// A pair (min, max), with None meaning no limit
+							auto bounds = py::cast<py::sequence>(length);
+							if (bounds.size() != 2) {
+								throw std::runtime_error("length must be a number or a pair (min, max)");
+							}
+							if (!bounds[0].is_none()) declaration.minLength = py::cast<size_t>(bounds[0]);
+							if (!bounds[1].is_none()) declaration.maxLength = py::cast<size_t>(bounds[1]);
+						}
+					}
+					declarations[functionName] = declaration;
+				}
+			}
+			catch (std::exception &ex) {
+				// This includes the pybind11 cast errors
+				spdlog::warn("Adaptation: module attribute {} is invalid, Python will be called instead: {}", kSysexMatchers, ex.what());
+				declarations.clear();
+			}
+		}
+		sysexMatchers_.setDeclarations(declarations);
+
+		// And how bank dumps are cut into program dumps, a dict with the sizes and the bytes around each voice
+		std::shared_ptr<BankDumpLayout::Layout const> layout;
+		if (adaptation_module && py::hasattr(adaptation_module, kBankDumpLayout)) {
+			try {
+				auto spec = py::cast<py::dict>(adaptation_module.attr(kBankDumpLayout));
+				auto declared = std::make_shared<BankDumpLayout::Layout>();
+				declared->header = py::cast<size_t>(spec["header"]);
+				declared->stride = py::cast<size_t>(spec["stride"]);
+				if (declared->stride == 0) {
+					throw std::runtime_error("stride must be at least 1");
+				}
+				if (spec.contains("count")) declared->count = py::cast<size_t>(spec["count"]);
+				if (spec.contains("trailer")) declared->trailer = py::cast<size_t>(spec["trailer"]);
+				if (spec.contains("prefix")) {
+					for (auto const &entry : py::cast<py::list>(spec["prefix"])) {
+						if (py::isinstance<py::int_>(entry)) {
+							declared->prefix.push_back({ false, (uint8) py::cast<int>(entry), 0, 0xff });
+						}
+						else {
+							// A tuple (offset,) or (offset, mask) copying a byte of the bank message
+							auto values = py::cast<std::vector<int>>(entry);
+							if (values.size() != 1 && values.size() != 2) {
+								throw std::runtime_error("prefix bytes must be a number, (offset,) or (offset, mask)");
+							}
+							declared->prefix.push_back({ true, 0, (size_t) values[0], values.size() == 2 ? (uint8) values[1] : (uint8) 0xff });
+						}
+					}
+				}
+				if (spec.contains("suffix")) {
+					declared->suffix.clear();
+					for (auto value : py::cast<std::vector<int>>(spec["suffix"])) {
+						declared->suffix.push_back((uint8) value);
+					}
+				}
+				layout = declared;
+			}
+			catch (std::exception &ex) {
+				// This includes the pybind11 cast errors
+				spdlog::warn("Adaptation: module attribute {} is invalid, Python will be called instead: {}", kBankDumpLayout, ex.what());
+				layout.reset();
+			}
+		}
+		bankDumpLayout_.setLayout(layout);
+	}
+
+	uint64 GenericAdaptation::implementedFunctionMask() const
+	{
+		return resolvedFunctionMask_.load();
+	}
+
 	bool GenericAdaptation::pythonModuleHasFunction(std::string const &functionName) const {
+		int index = pythonFunctionIndex(functionName);
+		if (index >= 0) {
+			return (resolvedFunctionMask_.load() & (1ULL << index)) != 0;
+		}
+		// Not one of the known functions, so we need to ask Python
 		py::gil_scoped_acquire acquire;
 		if (!adaptation_module) {
 			return false;
@@ -469,6 +678,21 @@ else {
 		return py::hasattr(*adaptation_module, functionName.c_str());
 	}
 
+	pybind11::object GenericAdaptation::pythonFunction(std::string const &functionName) const
+	{
+		int index = pythonFunctionIndex(functionName);
+		if (index >= 0) {
+			if ((resolvedFunctionMask_.load() & (1ULL << index)) != 0) {
+				return resolvedFunctions_[index];
+			}
+			return py::object();
+		}
+		if (adaptation_module && py::hasattr(*adaptation_module, functionName.c_str())) {
+			return adaptation_module.attr(functionName.c_str());
+		}
+		return py::object();
+	}
+
 	bool GenericAdaptation::isFromFile() const
 	{
 		return !filepath_.empty();
@@ -485,6 +709,14 @@ else {
 		py::gil_scoped_acquire acquire;
 		try {
 			adaptation_module.reload();
+			resolvePythonFunctions();
+			// All cached results might be different with the new code
+			resultCache_.invalidate(moduleVersion());
+			bankLayout_.flush();
+			editBufferCapabilityImpl_->resetIncrementalState();
+			if (bankDumpCapabilityImpl_) {
+				bankDumpCapabilityImpl_->resetIncrementalState();
+			}
 			logNamespace();
 		}
 		catch (py::error_already_set &ex) {
@@ -498,52 +730,159 @@ else {
 
 	std::shared_ptr<midikraft::DataFile> GenericAdaptation::patchFromPatchData(const Synth::PatchData &data, MidiProgramNumber place) const
 	{
-		py::gil_scoped_acquire acquire;
+		// No Python involved, so no need for the GIL here
 		ignoreUnused(place);
 		auto patch = std::make_shared<GenericPatch>(this, const_cast<py::module &>(adaptation_module), data, GenericPatch::PROGRAM_DUMP);
 		return patch;
 	}
 
+	namespace {
+
+		// Bump allocator for the patches created from one bank dump. The memory is released in one go when the last patch of the
+		// bank is gone, which is the usual life cycle for imported banks anyway
+		class PatchArena {
+		public:
+			explicit PatchArena(size_t bytesExpected) : blockSize_(std::max(bytesExpected, size_t(4096))), used_(0) {}
+
+			void *allocate(size_t bytes, size_t alignment) {
+				size_t offset = (used_ + alignment - 1) & ~(alignment - 1);
+				if (blocks_.empty() || offset + bytes > blockSize_) {
+					// Guessed wrong, just start another block
+					blocks_.push_back(std::make_unique<char[]>(std::max(bytes + alignment, blockSize_)));
+					used_ = 0;
+					offset = (alignment - (reinterpret_cast<uintptr_t>(blocks_.back().get()) % alignment)) % alignment;
+				}
+				used_ = offset + bytes;
+				return blocks_.back().get() + offset;
+			}
+
+		private:
+			std::vector<std::unique_ptr<char[]>> blocks_;
+			size_t blockSize_;
+			size_t used_;
+		};
+
+		template <typename T> class PatchArenaAllocator {
+		public:
+			typedef T value_type;
+
+			explicit PatchArenaAllocator(std::shared_ptr<PatchArena> arena) : arena_(arena) {}
+			template <typename U> PatchArenaAllocator(PatchArenaAllocator<U> const &other) : arena_(other.arena_) {}
+
+			T *allocate(size_t n) { return static_cast<T *>(arena_->allocate(n * sizeof(T), alignof(T))); }
+			void deallocate(T *, size_t) {}
+
+			template <typename U> bool operator==(PatchArenaAllocator<U> const &other) const { return arena_ == other.arena_; }
+			template <typename U> bool operator!=(PatchArenaAllocator<U> const &other) const { return arena_ != other.arena_; }
+
+			// Every control block holds a copy of the allocator, so the arena lives as long as any of its patches
+			std::shared_ptr<PatchArena> arena_;
+		};
+
+	}
+
+	midikraft::TPatchVector GenericAdaptation::patchesFromMessages(std::vector<MidiMessage> const &programDumps) const
+	{
+		// No Python involved, this only creates the C++ objects for all patches of a bank at once
+		midikraft::TPatchVector result;
+		result.reserve(programDumps.size());
+		auto arena = std::make_shared<PatchArena>(programDumps.size() * (sizeof(GenericPatch) + 64));
+		PatchArenaAllocator<GenericPatch> allocator(arena);
+		Synth::PatchData data;
+		for (auto const &programDump : programDumps) {
+			// Reuse the buffer, the patch makes its own copy anyway
+			data.assign(programDump.getRawData(), programDump.getRawData() + programDump.getRawDataSize());
+			result.push_back(std::allocate_shared<GenericPatch>(allocator, this, const_cast<py::module &>(adaptation_module), data, GenericPatch::PROGRAM_DUMP));
+		}
+		return result;
+	}
+
 	bool GenericAdaptation::isOwnSysex(MidiMessage const &message) const
 	{
-		py::gil_scoped_acquire acquire;
 		//TODO - if we delegate this to the python code, the "sniff synth" method of the Librarian can be used. But this is currently disabled anyway,
 		// even if I forgot why
-		ignoreUnused(message);
-		return false;
+		// Without the Python call we can still answer for adaptations that declared their headers
+		return sysexPrefilter_.isDeclared() && sysexPrefilter_.accepts(message);
 	}
 
+
 	void GenericAdaptation::sendBlockOfMessagesToSynth(juce::MidiDeviceInfo const &midiOutput, std::vector<MidiMessage> const& buffer)
 	{
-		py::gil_scoped_acquire acquire;
-		if (pythonModuleHasFunction(kGeneralMessageDelay)) {
+		if (pythonModuleHasFunction(kIsUploadAcknowledgement)) {
+			// The synth says when it is ready for the next message, no delay needed
+			AcknowledgedUpload::send(midiOutput, midiInput(), buffer, [this](MidiMessage const &message) { return uploadReply(message); });
+			return;
+		}
+		int delay = -1;
+		double bytesPerSecond = -1.0;
+		if (pythonModuleHasFunction(kMessageBytesPerSecond) || pythonModuleHasFunction(kGeneralMessageDelay)) {
+			// Only hold the GIL while asking Python, throttled sending can take seconds and other threads might need the interpreter
+			py::gil_scoped_acquire acquire;
+			char const *method = pythonModuleHasFunction(kMessageBytesPerSecond) ? kMessageBytesPerSecond : kGeneralMessageDelay;
 			try {
-				auto result = callMethod(kGeneralMessageDelay);
-				int delay = py::cast<int>(result);
-				// Be a bit careful with this device, do specify a delay when sending messages
-				midikraft::MidiController::instance()->getMidiOutput(midiOutput)->sendBlockOfMessagesThrottled(buffer, delay);
+				auto result = callMethod(method);
+				if (method == kMessageBytesPerSecond) {
+					bytesPerSecond = py::cast<double>(result);
+				}
+				else {
+					delay = py::cast<int>(result);
+				}
 			}
 			catch (py::error_already_set &ex) {
-				logAdaptationError(kGeneralMessageDelay, ex);
+				logAdaptationError(method, ex);
 				ex.restore();
+				return;
 			}
 			catch (std::exception &ex) {
-				logAdaptationError(kGeneralMessageDelay, ex);
+				logAdaptationError(method, ex);
+				return;
 			}
 		}
+		if (bytesPerSecond > 0.0) {
+			// Pace by size, a rate stored for this synth and port overrides the one of the adaptation
+			MessagePacer::sendPaced(midiOutput, buffer, MessagePacer::bytesPerSecond(getName(), midiOutput, bytesPerSecond));
+		}
+		else if (delay >= 0) {
+			// Be a bit careful with this device, do specify a delay when sending messages
+			midikraft::MidiController::instance()->getMidiOutput(midiOutput)->sendBlockOfMessagesThrottled(buffer, delay);
+		}
 		else {
 			// No special behavior - just send at full speed
 			midikraft::MidiController::instance()->getMidiOutput(midiOutput)->sendBlockOfMessagesFullSpeed(buffer);
 		}
 	}
 
-	std::string GenericAdaptation::friendlyProgramName(MidiProgramNumber programNo) const
+	AcknowledgedUpload::Reply GenericAdaptation::uploadReply(MidiMessage const &message) const
 	{
 		py::gil_scoped_acquire acquire;
-		if (pythonModuleHasFunction(kFriendlyProgramName)) {
+		try {
+			auto vector = messageToPython(message);
+			auto result = callMethod(kIsUploadAcknowledgement, vector);
+			if (result.is_none()) {
+				return AcknowledgedUpload::Reply::None;
+			}
+			return py::cast<bool>(result) ? AcknowledgedUpload::Reply::Acknowledged : AcknowledgedUpload::Reply::Rejected;
+		}
+		catch (py::error_already_set &ex) {
+			logAdaptationError(kIsUploadAcknowledgement, ex);
+			ex.restore();
+		}
+		catch (std::exception &ex) {
+			logAdaptationError(kIsUploadAcknowledgement, ex);
+		}
+		return AcknowledgedUpload::Reply::None;
+	}
+
+	std::string GenericAdaptation::friendlyProgramName(MidiProgramNumber programNo) const
+	{
+		if (!pythonModuleHasFunction(kFriendlyProgramName)) {
+			return Synth::friendlyProgramName(programNo);
+		}
+		int zerobased = programNo.toZeroBasedWithBank();
+		auto nameOf = [this](int program) -> std::optional<std::string> {
+			py::gil_scoped_acquire acquire;
 			try {
-				int zerobased = programNo.toZeroBasedWithBank();
-				auto result = callMethod(kFriendlyProgramName, zerobased);
+				auto result = callMethod(kFriendlyProgramName, program);
 				return py::cast<std::string>(result);
 			}
 			catch (py::error_already_set &ex) {
@@ -553,8 +892,42 @@ else {
 			catch (std::exception &ex) {
 				logAdaptationError(kFriendlyProgramName, ex);
 			}
-		}
-		return Synth::friendlyProgramName(programNo);
+			return {};
+		};
+		auto allSlots = [this, nameOf]() {
+			// Every patch button asks for this, so name all slots of the layout in one go while we hold the GIL anyway
+			std::vector<std::pair<MidiBankNumber, int>> banks;
+			midikraft::HasBankDescriptorsCapability *descriptors;
+			midikraft::HasBanksCapability *hasBanks;
+			if (hasCapability(&descriptors)) {
+				for (auto const &descriptor : descriptors->bankDescriptors()) {
+					banks.emplace_back(descriptor.bank, descriptor.size);
+				}
+			}
+			else if (hasCapability(&hasBanks)) {
+				int bankSize = hasBanks->numberOfPatches();
+				for (int bank = 0; bank < hasBanks->numberOfBanks(); bank++) {
+					banks.emplace_back(MidiBankNumber::fromZeroBase(bank, bankSize), bankSize);
+				}
+			}
+			BankLayoutCache::TProgramNames names;
+			py::gil_scoped_acquire acquire;
+			for (auto const &bank : banks) {
+				for (int i = 0; i < bank.second; i++) {
+					int program = MidiProgramNumber::fromZeroBaseWithBank(bank.first, i).toZeroBasedWithBank();
+					auto name = nameOf(program);
+					if (!name.has_value()) {
+						// Don't log the same error for a thousand slots
+						return names;
+					}
+					names[program] = *name;
+				}
+			}
+			return names;
+		};
+		return bankLayout_.friendlyProgramName(zerobased, allSlots, [nameOf, zerobased]() {
+			return nameOf(zerobased);
+		}, Synth::friendlyProgramName(programNo));
 	}
 
 	std::string GenericAdaptation::setupHelpText() const
@@ -583,8 +956,7 @@ else {
 		py::gil_scoped_acquire acquire;
 		try {
 			py::object result = callMethod(kCreateDeviceDetectMessage, channel);
-			std::vector<uint8> byteData = intVectorToByteVector(result.cast<std::vector<int>>());
-			return Sysex::vectorToMessages(byteData);
+			return pythonToMessages(result);
 		}
 		catch (py::error_already_set &ex) {
 			logAdaptationError(kCreateDeviceDetectMessage, ex);
@@ -623,7 +995,7 @@ else {
 	{
 		py::gil_scoped_acquire acquire;
 		try {
-			auto vector = messageToVector(message);
+			auto vector = messageToPython(message);
 			py::object result = callMethod(kChannelIfValidDeviceResponse, vector);
 			int intResult = result.cast<int>();
 			if (intResult >= 0 && intResult < 16) {
@@ -689,11 +1061,20 @@ else {
 			return Synth::calculateFingerprint(patch);
 		}
 		
+		auto hash = dataHash(*patch);
+		std::string cached;
+		if (resultCache_.lookup(AdaptationResultCache::Kind::Fingerprint, hash, 0, cached)) {
+			return cached;
+		}
+
 		try {
-			std::vector<int> data(patch->data().data(), patch->data().data() + patch->data().size());
+			auto const &patchData = patch->data();
+			auto data = dataToPython(patchData.data(), patchData.size());
 			py::object result = callMethod(kCalculateFingerprint, data);
-				return result.cast<std::string>();
-			}			
+			auto fingerprint = result.cast<std::string>();
+			resultCache_.store(AdaptationResultCache::Kind::Fingerprint, hash, 0, fingerprint);
+			return fingerprint;
+		}
 		catch (py::error_already_set &ex) {
 			logAdaptationError(kCalculateFingerprint, ex);
 			ex.restore();
@@ -704,6 +1085,430 @@ else {
 		return {};
 	}
 
+	std::vector<std::string> GenericAdaptation::calculateFingerprints(midikraft::TPatchVector const &patches) const
+	{
+		std::vector<std::string> result(patches.size());
+		if (patches.empty()) {
+			return result;
+		}
+		if (!pythonModuleHasFunction(kCalculateFingerprint)) {
+			// The default fingerprint is pure C++ and needs no GIL
+			for (size_t i = 0; i < patches.size(); i++) {
+				result[i] = Synth::calculateFingerprint(patches[i]);
+			}
+			return result;
+		}
+
+		auto hashes = dataHashes(patches);
+		std::vector<size_t> missing;
+		for (size_t i = 0; i < patches.size(); i++) {
+			if (!resultCache_.lookup(AdaptationResultCache::Kind::Fingerprint, hashes[i], 0, result[i])) {
+				missing.push_back(i);
+			}
+		}
+		if (missing.empty()) {
+			return result;
+		}
+
+		py::gil_scoped_acquire acquire;
+		if (pythonModuleHasFunction(kCalculateFingerprints)) {
+			try {
+				py::list dumps;
+				for (auto i : missing) {
+					auto const &patchData = patches[i]->data();
+					dumps.append(dataToPython(patchData.data(), patchData.size()));
+				}
+				py::object fingerprints = callMethod(kCalculateFingerprints, dumps);
+				auto fingerprintsFound = fingerprints.cast<std::vector<std::string>>();
+				if (fingerprintsFound.size() == missing.size()) {
+					for (size_t j = 0; j < missing.size(); j++) {
+						result[missing[j]] = fingerprintsFound[j];
+						resultCache_.store(AdaptationResultCache::Kind::Fingerprint, hashes[missing[j]], 0, fingerprintsFound[j]);
+					}
+					return result;
+				}
+				spdlog::error("Adaptation: {} returned {} fingerprints for {} patches, falling back to {}", kCalculateFingerprints, fingerprintsFound.size(), missing.size(), kCalculateFingerprint);
+			}
+			catch (py::error_already_set &ex) {
+				logAdaptationError(kCalculateFingerprints, ex);
+				ex.restore();
+			}
+			catch (std::exception &ex) {
+				logAdaptationError(kCalculateFingerprints, ex);
+			}
+		}
+
+		// One call per patch, but at least we hold the GIL only once
+		for (auto i : missing) {
+			try {
+				auto const &patchData = patches[i]->data();
+				auto data = dataToPython(patchData.data(), patchData.size());
+				result[i] = callMethod(kCalculateFingerprint, data).cast<std::string>();
+				resultCache_.store(AdaptationResultCache::Kind::Fingerprint, hashes[i], 0, result[i]);
+			}
+			catch (py::error_already_set &ex) {
+				logAdaptationError(kCalculateFingerprint, ex);
+				ex.restore();
+			}
+			catch (std::exception &ex) {
+				logAdaptationError(kCalculateFingerprint, ex);
+			}
+		}
+		return result;
+	}
+
+	pybind11::object GenericAdaptation::dataToPython(uint8 const *data, size_t size) const
+	{
+		if (midiDataAsBytes_) {
+			// Zero copy - the memoryview is only valid during the call, adaptations need to copy with bytes() if they want to keep it
+			return py::memoryview::from_memory(data, (py::ssize_t) size);
+		}
+		std::vector<int> v(data, data + size);
+		return py::cast(v);
+	}
+
+	pybind11::object GenericAdaptation::messageToPython(MidiMessage const &message) const
+	{
+		return dataToPython(message.getRawData(), (size_t) message.getRawDataSize());
+	}
+
+	pybind11::object GenericAdaptation::messageToOwnedPython(MidiMessage const &message) const
+	{
+		return ownedDataToPython(message.getRawData(), (size_t) message.getRawDataSize());
+	}
+
+	pybind11::object GenericAdaptation::ownedDataToPython(uint8 const *data, size_t size) const
+	{
+		if (midiDataAsBytes_) {
+			return py::bytes(reinterpret_cast<const char *>(data), size);
+		}
+		return dataToPython(data, size);
+	}
+
+	pybind11::object GenericAdaptation::messagesToPython(std::vector<MidiMessage> const &messages) const
+	{
+		if (midiDataAsBytes_) {
+			size_t total = 0;
+			for (auto const &m : messages) {
+				total += (size_t) m.getRawDataSize();
+			}
+			std::string buffer;
+			buffer.reserve(total);
+			for (auto const &m : messages) {
+				buffer.append(reinterpret_cast<const char *>(m.getRawData()), (size_t) m.getRawDataSize());
+			}
+			return py::bytes(buffer);
+		}
+		return py::cast(midiMessagesToVector(messages));
+	}
+
+	std::vector<uint8> GenericAdaptation::pythonToByteVector(pybind11::object const &result)
+	{
+		if (py::isinstance<py::buffer>(result)) {
+			// bytes, bytearray, memoryview - these can't contain values out of range, so we can copy directly
+			auto buffer = py::reinterpret_borrow<py::buffer>(result);
+			py::buffer_info info = buffer.request();
+			if (info.itemsize != 1 || info.ndim != 1) {
+				throw std::runtime_error("Adaptation: Buffer returned must be one-dimensional and contain bytes");
+			}
+			auto start = static_cast<uint8 const *>(info.ptr);
+			return std::vector<uint8>(start, start + info.size);
+		}
+		if (PyList_Check(result.ptr())) {
+			// Convert and range check in one go, without going through a std::vector<int> first
+			PyObject *list = result.ptr();
+			auto size = PyList_GET_SIZE(list);
+			std::vector<uint8> byteData((size_t) size);
+			for (Py_ssize_t i = 0; i < size; i++) {
+				long value = PyLong_AsLong(PyList_GET_ITEM(list, i));
+				if (value < 0 || value > 255) {
+					if (PyErr_Occurred()) {
+						throw py::error_already_set();
+					}
+					throw std::runtime_error("Adaptation: Value out of range in Midi Message");
+				}
+				byteData[(size_t) i] = (uint8) value;
+			}
+			return byteData;
+		}
+		return intVectorToByteVector(result.cast<std::vector<int>>());
+	}
+
+	std::vector<juce::MidiMessage> GenericAdaptation::pythonToMessages(pybind11::object const &result)
+	{
+		if (py::isinstance<py::buffer>(result)) {
+			// Split directly from the Python buffer, no intermediate copy
+			auto buffer = py::reinterpret_borrow<py::buffer>(result);
+			py::buffer_info info = buffer.request();
+			if (info.itemsize != 1 || info.ndim != 1) {
+				throw std::runtime_error("Adaptation: Buffer returned must be one-dimensional and contain bytes");
+			}
+			return bytesToMessages(static_cast<uint8 const *>(info.ptr), (size_t) info.size);
+		}
+		auto byteData = pythonToByteVector(result);
+		return bytesToMessages(byteData.data(), byteData.size());
+	}
+
+	std::vector<juce::MidiMessage> GenericAdaptation::bytesToMessages(uint8 const *data, size_t size)
+	{
+		std::vector<MidiMessage> result;
+		size_t pos = 0;
+		while (pos < size) {
+			if (data[pos] == 0xf0) {
+				// Sysex, which is what adaptations mostly return. memchr is vectorized by the C library
+				auto end = static_cast<uint8 const *>(memchr(data + pos + 1, 0xf7, size - pos - 1));
+				if (end) {
+					size_t length = (size_t) (end - (data + pos)) + 1;
+					// All bytes in between need to be 7 bit, written so the compiler can vectorize it
+					uint8 orOfAllBytes = 0;
+					for (size_t i = pos + 1; i < pos + length - 1; i++) {
+						orOfAllBytes |= data[i];
+					}
+					if ((orOfAllBytes & 0x80) == 0) {
+						result.emplace_back(data + pos, (int) length);
+						pos += length;
+						continue;
+					}
+				}
+			}
+			// Anything else, e.g. channel messages or broken sysex, is left to the JUCE parser
+			int bytesUsed = 0;
+			MidiMessage message(data + pos, (int) (size - pos), bytesUsed, 0);
+			if (bytesUsed <= 0) {
+				break;
+			}
+			result.push_back(message);
+			pos += (size_t) bytesUsed;
+		}
+		return result;
+	}
+
+	size_t pythonMarshalledSize(pybind11::handle object)
+	{
+		if (!object || object.is_none()) {
+			return 0;
+		}
+		PyObject *o = object.ptr();
+		if (PyBytes_Check(o)) {
+			return (size_t) PyBytes_GET_SIZE(o);
+		}
+		if (PyByteArray_Check(o)) {
+			return (size_t) PyByteArray_GET_SIZE(o);
+		}
+		if (PyMemoryView_Check(o)) {
+			return (size_t) PyMemoryView_GET_BUFFER(o)->len;
+		}
+		if (PyUnicode_Check(o)) {
+			return (size_t) PyUnicode_GET_LENGTH(o);
+		}
+		if (PyList_Check(o)) {
+			auto size = PyList_GET_SIZE(o);
+			if (size == 0) {
+				return 0;
+			}
+			if (PyLong_Check(PyList_GET_ITEM(o, 0))) {
+				// A list of ints is one byte of MIDI data per entry
+				return (size_t) size;
+			}
+			// List of messages or names
+			size_t result = 0;
+			for (Py_ssize_t i = 0; i < size; i++) {
+				result += pythonMarshalledSize(pybind11::handle(PyList_GET_ITEM(o, i)));
+			}
+			return result;
+		}
+		return 0;
+	}
+
+	GenericPatchCapabilities const &GenericAdaptation::patchCapabilities() const
+	{
+		return *patchCapabilitiesImpl_;
+	}
+
+	AdaptationCallProfiler &GenericAdaptation::callProfiler() const
+	{
+		return profiler_;
+	}
+
+	AdaptationResultCache &GenericAdaptation::resultCache() const
+	{
+		return resultCache_;
+	}
+
+	BankLayoutCache &GenericAdaptation::bankLayout() const
+	{
+		return bankLayout_;
+	}
+
+	SysexPrefilter const &GenericAdaptation::sysexPrefilter() const
+	{
+		return sysexPrefilter_;
+	}
+
+	SysexMatchers const &GenericAdaptation::sysexMatchers() const
+	{
+		return sysexMatchers_;
+	}
+
+	BankDumpLayout const &GenericAdaptation::bankDumpLayout() const
+	{
+		return bankDumpLayout_;
+	}
+
+	std::string GenericAdaptation::dataHash(midikraft::DataFile const &patch)
+	{
+		auto genericPatch = dynamic_cast<GenericPatch const *>(&patch);
+		if (genericPatch) {
+			return genericPatch->dataHash();
+		}
+		return AdaptationResultCache::hashOf(patch.data());
+	}
+
+	std::vector<std::string> GenericAdaptation::dataHashes(midikraft::TPatchVector const &patches)
+	{
+		std::vector<std::string> result(patches.size());
+		std::vector<size_t> missing;
+		std::vector<MultiBufferMD5::Buffer> buffers;
+		for (size_t i = 0; i < patches.size(); i++) {
+			auto genericPatch = std::dynamic_pointer_cast<GenericPatch>(patches[i]);
+			if (genericPatch && genericPatch->hasDataHash()) {
+				result[i] = genericPatch->dataHash();
+			}
+			else {
+				auto const &data = patches[i]->data();
+				missing.push_back(i);
+				buffers.push_back({ data.data(), data.size() });
+			}
+		}
+		if (missing.size() == 1) {
+			// Not worth the lanes
+			result[missing[0]] = dataHash(*patches[missing[0]]);
+			return result;
+		}
+		auto hashes = MultiBufferMD5::hexDigests(buffers);
+		for (size_t j = 0; j < missing.size(); j++) {
+			result[missing[j]] = hashes[j];
+			if (auto genericPatch = std::dynamic_pointer_cast<GenericPatch>(patches[missing[j]])) {
+				genericPatch->setDataHash(hashes[j]);
+			}
+		}
+		return result;
+	}
+
+	std::string GenericAdaptation::moduleVersion() const
+	{
+		if (!codeVersion_.empty()) {
+			return codeVersion_;
+		}
+		try {
+			File source(getSourceFilePath());
+			return fmt::format("{}:{}", source.getLastModificationTime().toMilliseconds(), source.getSize());
+		}
+		catch (std::exception &) {
+			return {};
+		}
+	}
+
+	std::vector<std::string> GenericAdaptation::nameFromDumps(midikraft::TPatchVector const &patches, std::vector<bool> *outFound) const
+	{
+		std::vector<std::string> result(patches.size(), "invalid");
+		std::vector<bool> found(patches.size(), false);
+		if (outFound) {
+			outFound->assign(patches.size(), false);
+		}
+		else {
+			outFound = &found;
+		}
+		if (patches.empty()) {
+			return result;
+		}
+
+		// Everything already in the result cache doesn't need to go to Python at all
+		auto hashes = dataHashes(patches);
+		std::vector<size_t> missing;
+		for (size_t i = 0; i < patches.size(); i++) {
+			if (resultCache_.lookup(AdaptationResultCache::Kind::Name, hashes[i], 0, result[i])) {
+				(*outFound)[i] = true;
+			}
+			else {
+				missing.push_back(i);
+			}
+		}
+		if (missing.empty()) {
+			return result;
+		}
+
+		py::gil_scoped_acquire acquire;
+		if (pythonModuleHasFunction(kNameFromDumps)) {
+			try {
+				py::list dumps;
+				for (auto i : missing) {
+					auto const &patchData = patches[i]->data();
+					dumps.append(dataToPython(patchData.data(), patchData.size()));
+				}
+				py::object names = callMethod(kNameFromDumps, dumps);
+				auto namesFound = names.cast<std::vector<std::string>>();
+				if (namesFound.size() == missing.size()) {
+					for (size_t j = 0; j < missing.size(); j++) {
+						result[missing[j]] = namesFound[j];
+						(*outFound)[missing[j]] = true;
+						resultCache_.store(AdaptationResultCache::Kind::Name, hashes[missing[j]], 0, namesFound[j]);
+					}
+					return result;
+				}
+				spdlog::error("Adaptation: {} returned {} names for {} patches, falling back to {}", kNameFromDumps, namesFound.size(), missing.size(), kNameFromDump);
+			}
+			catch (py::error_already_set &ex) {
+				logAdaptationError(kNameFromDumps, ex);
+				ex.restore();
+			}
+			catch (std::exception &ex) {
+				logAdaptationError(kNameFromDumps, ex);
+			}
+		}
+
+		if (!pythonModuleHasFunction(kNameFromDump)) {
+			for (auto i : missing) {
+				result[i] = "noname";
+			}
+			return result;
+		}
+		// One call per patch, but at least we hold the GIL only once
+		for (auto i : missing) {
+			try {
+				auto const &patchData = patches[i]->data();
+				auto data = dataToPython(patchData.data(), patchData.size());
+				result[i] = callMethod(kNameFromDump, data).cast<std::string>();
+				(*outFound)[i] = true;
+				resultCache_.store(AdaptationResultCache::Kind::Name, hashes[i], 0, result[i]);
+			}
+			catch (py::error_already_set &ex) {
+				logAdaptationError(kNameFromDump, ex);
+				ex.restore();
+			}
+			catch (std::exception &ex) {
+				logAdaptationError(kNameFromDump, ex);
+			}
+		}
+		return result;
+	}
+
+	void GenericAdaptation::primeNames(midikraft::TPatchVector const &patches) const
+	{
+		if (!pythonModuleHasFunction(kNameFromDumps) && !pythonModuleHasFunction(kNameFromDump)) {
+			return;
+		}
+		std::vector<bool> found;
+		auto names = nameFromDumps(patches, &found);
+		for (size_t i = 0; i < patches.size(); i++) {
+			auto genericPatch = std::dynamic_pointer_cast<GenericPatch>(patches[i]);
+			// A failed lookup is not remembered, the next name() asks the adaptation again
+			if (genericPatch && found[i]) {
+				genericPatch->setCachedName(names[i]);
+			}
+		}
+	}
+
 	std::vector<int> GenericAdaptation::messageToVector(MidiMessage const &message) {
 		return std::vector<int>(message.getRawData(), message.getRawData() + message.getRawDataSize());
 	}
@@ -718,15 +1523,16 @@ else {
 	}
 
 	std::vector<uint8> GenericAdaptation::intVectorToByteVector(std::vector<int> const& data) {
-		std::vector<uint8> byteData;
+		// Check the range for all values at once, then copy without branches
+		bool inRange = true;
 		for (int byte : data) {
-			if (byte >= 0 && byte < 256) {
-				byteData.push_back((uint8)byte);
-			}
-			else {
-				throw std::runtime_error("Adaptation: Value out of range in Midi Message");
-			}
+			inRange &= (byte >= 0) & (byte < 256);
+		}
+		if (!inRange) {
+			throw std::runtime_error("Adaptation: Value out of range in Midi Message");
 		}
+		std::vector<uint8> byteData(data.size());
+		std::transform(data.begin(), data.end(), byteData.begin(), [](int byte) { return (uint8) byte; });
 		return byteData;
 	}
 
@@ -738,14 +1544,12 @@ else {
 
 	std::vector<juce::MidiMessage> GenericAdaptation::vectorToMessages(std::vector<int> const& data)
 	{
-		//TODO this could be accelerated
 		auto byteData = intVectorToByteVector(data);
-		return Sysex::vectorToMessages(byteData);
+		return bytesToMessages(byteData.data(), byteData.size());
 	}
 
 	bool GenericAdaptation::hasCapability(midikraft::EditBufferCapability** outCapability) const
 	{
-		py::gil_scoped_acquire acquire;
 		if (pythonModuleHasFunction(kIsEditBufferDump)
 			&& pythonModuleHasFunction(kCreateEditBufferRequest)
 			&& pythonModuleHasFunction(kConvertToEditBuffer)) {
@@ -767,7 +1571,6 @@ else {
 
 	bool GenericAdaptation::hasCapability(midikraft::ProgramDumpCabability  **outCapability) const
 	{
-		py::gil_scoped_acquire acquire;
 		if (pythonModuleHasFunction(kIsSingleProgramDump)
 			&& pythonModuleHasFunction(kCreateProgramDumpRequest)
 			&& pythonModuleHasFunction(kConvertToProgramDump)) {
@@ -789,7 +1592,6 @@ else {
 
 	bool GenericAdaptation::hasCapability(midikraft::BankDumpCapability  **outCapability) const
 	{
-		py::gil_scoped_acquire acquire;
 		if (pythonModuleHasFunction(kCreateBankDumpRequest)
 			&& pythonModuleHasFunction(kExtractPatchesFromBank)
 			&& pythonModuleHasFunction(kIsPartOfBankDump)
@@ -812,7 +1614,6 @@ else {
 
 	bool GenericAdaptation::hasCapability(midikraft::HasBanksCapability** outCapability) const
 	{
-		py::gil_scoped_acquire acquire;
 		if (pythonModuleHasFunction(kNumberOfBanks)
 			&& pythonModuleHasFunction(kNumberOfPatchesPerBank))
 		{
@@ -834,7 +1635,6 @@ else {
 
 	bool GenericAdaptation::hasCapability(midikraft::HasBankDescriptorsCapability** outCapability) const
 	{
-		py::gil_scoped_acquire acquire;
 		if (pythonModuleHasFunction(kBankDescriptors))
 		{
 			*outCapability = dynamic_cast<midikraft::HasBankDescriptorsCapability*>(hasBankDescriptorsCapabilityImpl_.get());
@@ -855,11 +1655,8 @@ else {
 
 	void GenericAdaptation::logAdaptationError(const char *methodName, std::exception &ex) const
 	{
-		// This hoop is required to properly process Python created exceptions
-		std::string exceptionMessage = ex.what();
-		MessageManager::callAsync([this, methodName, exceptionMessage]() {
-			spdlog::error("Adaptation[{}]: Error calling {}: {}", adaptationName_, methodName, exceptionMessage);
-		});
+		// Errors are coalesced and logged from the message thread, a broken adaptation can fail thousands of times in a bulk import
+		AdaptationErrorLog::instance().record(adaptationName_, methodName, ex.what());
 	}
 
 }
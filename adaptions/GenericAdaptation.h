@@ -15,8 +15,20 @@
 #include "ProgramDumpCapability.h"
 #include "BankDumpCapability.h"
 
+#include "AcknowledgedUpload.h"
+#include "AdaptationCallProfiler.h"
+#include "AdaptationResultCache.h"
+#include "AdaptationWatchdog.h"
+#include "BankLayoutCache.h"
+#include "SysexMatchers.h"
+#include "BankDumpLayout.h"
+#include "SysexPrefilter.h"
+
 #include <pybind11/embed.h>
 #include <fmt/format.h>
+#include <atomic>
+#include <chrono>
+#include <type_traits>
 #include <spdlog/spdlog.h>
 
 namespace knobkraft {
@@ -27,22 +39,41 @@ namespace knobkraft {
 	class GenericBankDumpCapability;
 	class GenericHasBanksCapability;
 	class GenericHasBankDescriptorsCapability;
+	class GenericPatchCapabilities;
 	void checkForPythonOutputAndLog();
 
-	extern const char *kIsEditBufferDump, *kIsPartOfEditBufferDump, *kCreateEditBufferRequest, *kConvertToEditBuffer,
+	extern const char *kIsEditBufferDump, *kIsPartOfEditBufferDump, *kEditBufferDumpProgress, *kCreateEditBufferRequest, *kConvertToEditBuffer,
 		*kNumberOfBanks, * kNumberOfPatchesPerBank, * kBankDescriptors, * kFriendlyBankName, *kBankSelect, 
-		*kNameFromDump, *kRenamePatch, *kIsDefaultName,
+		*kNameFromDump, *kNameFromDumps, *kRenamePatch, *kIsDefaultName,
 		*kIsSingleProgramDump, *kIsPartOfSingleProgramDump, *kCreateProgramDumpRequest, *kConvertToProgramDump, *kNumberFromDump,
-		*kCreateBankDumpRequest, *kIsPartOfBankDump, *kIsBankDumpFinished, *kExtractPatchesFromBank,
+		*kCreateBankDumpRequest, *kIsPartOfBankDump, *kIsBankDumpFinished, *kBankDumpProgress, *kExtractPatchesFromBank,
 		*kNumberOfLayers,
 		*kLayerName,
 		*kSetLayerName,
-		*kGetStoredTags
+		*kGetStoredTags,
+		*kMidiDataAsBytes,
+		*kSysexHeaders,
+		*kSysexMatchers,
+		*kBankDumpLayout
 		;
 
 	extern std::vector<const char *> kAdapatationPythonFunctionNames;
 	extern std::vector<const char *> kMinimalRequiredFunctionNames;
 
+	// Rough number of bytes handed across the Python boundary, used for the call statistics
+	size_t pythonMarshalledSize(pybind11::handle object);
+	template <typename T> size_t pythonMarshalledSize(T const &value) {
+		if constexpr (std::is_base_of_v<pybind11::handle, T>) {
+			return pythonMarshalledSize(pybind11::handle(value));
+		}
+		else if constexpr (std::is_same_v<T, std::string>) {
+			return value.size();
+		}
+		else {
+			return 0;
+		}
+	}
+
 #ifndef DEFAULT_VISIBILITY
 #ifdef __GNUC__
 #define DEFAULT_VISIBILITY __attribute__((visibility("default")))
@@ -70,6 +101,8 @@ namespace knobkraft {
 
 		// Allow the Adaptation to implement a different fingerprint logic
 		virtual std::string calculateFingerprint(std::shared_ptr<midikraft::DataFile> patch) const override;
+		// Batch version, uses the optional calculateFingerprints() in one call and fills the result cache
+		std::vector<std::string> calculateFingerprints(midikraft::TPatchVector const &patches) const;
 
 		// Implement the methods needed for device detection
 		std::vector<juce::MidiMessage> deviceDetect(int channel) override;
@@ -80,14 +113,47 @@ namespace knobkraft {
 		// The following functions are implemented generically and current cannot be defined in Python
 		std::shared_ptr<midikraft::DataFile> patchFromPatchData(const Synth::PatchData &data, MidiProgramNumber place) const override;
 		bool isOwnSysex(MidiMessage const &message) const override;
+		// Bulk version of patchFromPatchData for all program dumps of a bank, allocating them together
+		midikraft::TPatchVector patchesFromMessages(std::vector<MidiMessage> const &programDumps) const;
 
 		// This generic synth method is overridden to allow throttling of messages for older synths like the Korg MS2000
 		virtual void sendBlockOfMessagesToSynth(juce::MidiDeviceInfo const &midiOutput, std::vector<MidiMessage> const& buffer) override;
 		virtual std::string friendlyProgramName(MidiProgramNumber programNo) const override;  //TODO this looks like a capability
 		virtual std::string setupHelpText() const override;
 
+		// Batch name extraction, uses the optional nameFromDumps() in one call and falls back to nameFromDump() per patch
+		// Patches whose name could not be found get "invalid" or "noname", outFound tells them apart from real names
+		std::vector<std::string> nameFromDumps(midikraft::TPatchVector const &patches, std::vector<bool> *outFound = nullptr) const;
+		// Resolve the names of freshly created patches in one go, so later name() calls need not go into Python again
+		void primeNames(midikraft::TPatchVector const &patches) const;
+
+		// The capability logic shared by all GenericPatches of this adaptation
+		GenericPatchCapabilities const &patchCapabilities() const;
+
+		// Statistics of all calls into the Python module, always on
+		AdaptationCallProfiler &callProfiler() const;
+		static int pythonFunctionIndex(std::string const &functionName);
+
+		// Results of pure functions of the patch data are memoized here, keyed by the hash of the data
+		AdaptationResultCache &resultCache() const;
+		static std::string dataHash(midikraft::DataFile const &patch);
+		// The same for many patches, those not hashed before are hashed together in one multi buffer pass
+		static std::vector<std::string> dataHashes(midikraft::TPatchVector const &patches);
+		// Bank sizes and names and the friendly program names, constant while the module is loaded
+		BankLayoutCache &bankLayout() const;
+		// The sysex headers declared by the module, checked before any predicate on incoming messages calls into Python
+		SysexPrefilter const &sysexPrefilter() const;
+		// Predicates the module declared as data instead of implementing them in Python
+		SysexMatchers const &sysexMatchers() const;
+		// The cutting of bank dumps into program dumps, if the module declared it instead of only implementing extractPatchesFromBank()
+		BankDumpLayout const &bankDumpLayout() const;
+
 		// Internal workings of the Generic Adaptation module
 		bool pythonModuleHasFunction(std::string const &functionName) const;
+		// One bit per entry of kAdapatationPythonFunctionNames, set if the module implements that function
+		uint64 implementedFunctionMask() const;
+		// Returns the resolved handle of the function, or an empty object if not implemented. Requires the GIL to be held.
+		pybind11::object pythonFunction(std::string const &functionName) const;
 		bool isFromFile() const;
 		std::string getSourceFilePath() const;
 		void reloadPython();
@@ -108,6 +174,20 @@ namespace knobkraft {
 		static std::vector<std::string> getAllBuiltinSynthNames();
 		static bool breakOut(std::string synthName);
 
+		// Conversion of MIDI data for calls into Python. Adaptations that set the module attribute midiDataAsBytes = True
+		// get read-only memoryview or bytes objects, all others get the classic list of ints
+		pybind11::object dataToPython(uint8 const *data, size_t size) const;
+		pybind11::object messageToPython(MidiMessage const &message) const;
+		// Same, but never a memoryview, for objects that are kept alive across calls
+		pybind11::object messageToOwnedPython(MidiMessage const &message) const;
+		pybind11::object ownedDataToPython(uint8 const *data, size_t size) const;
+		pybind11::object messagesToPython(std::vector<MidiMessage> const &messages) const;
+		// Conversion of results, this accepts lists of ints as well as bytes, bytearray and memoryview objects
+		static std::vector<uint8> pythonToByteVector(pybind11::object const &result);
+		static std::vector<MidiMessage> pythonToMessages(pybind11::object const &result);
+		// Single pass splitter of a byte stream into MIDI messages, sysex is taken directly from the span
+		static std::vector<MidiMessage> bytesToMessages(uint8 const *data, size_t size);
+
 		static std::vector<int> messageToVector(MidiMessage const &message);
 		static std::vector<int> midiMessagesToVector(std::vector<MidiMessage> const& message);
 		static std::vector<uint8> intVectorToByteVector(std::vector<int> const &data);
@@ -145,14 +225,27 @@ namespace knobkraft {
 		friend class GenericHasBankDescriptorsCapability;
 		std::shared_ptr<GenericHasBankDescriptorsCapability> hasBankDescriptorsCapabilityImpl_;
 
+		std::shared_ptr<GenericPatchCapabilities> patchCapabilitiesImpl_;
+
+		// Classifies a message arriving during an upload with the adaptation's isUploadAcknowledgement()
+		AcknowledgedUpload::Reply uploadReply(MidiMessage const &message) const;
+
 		template <typename ... Args> pybind11::object callMethod(std::string const &methodName, Args& ... args) const
 		{
 			if (!adaptation_module) {
 				return pybind11::none();
 			}
 			pybind11::gil_scoped_acquire acquire;
-			if (pybind11::hasattr(*adaptation_module, methodName.c_str())) {
-				auto result = adaptation_module.attr(methodName.c_str())(args...);
+			auto function = pythonFunction(methodName);
+			if (function) {
+				auto start = std::chrono::steady_clock::now();
+				pybind11::object result;
+				{
+					AdaptationWatchdog::Call watched(adaptationName_, methodName);
+					result = function(args...);
+				}
+				auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+				profiler_.record(pythonFunctionIndex(methodName), elapsed, (size_t(0) + ... + pythonMarshalledSize(args)), pythonMarshalledSize(result));
 				checkForPythonOutputAndLog();
 				return result;
 			}
@@ -166,9 +259,23 @@ namespace knobkraft {
 		static bool createCompiledAdaptationModule(std::string const &pythonModuleName, std::string const &adaptationCode, std::vector<std::shared_ptr<midikraft::SimpleDiscoverableDevice>> &outAddToThis);
 		void logNamespace();
 
+		// The function table is filled once after import and on reload, so capability checks need neither the GIL nor a hasattr() call
+		void resolvePythonFunctions();
+		std::string moduleVersion() const;
+
 		pybind11::module adaptation_module DEFAULT_VISIBILITY;
+		std::vector<pybind11::object> resolvedFunctions_ DEFAULT_VISIBILITY;
+		std::atomic<uint64> resolvedFunctionMask_;
+		std::atomic<bool> midiDataAsBytes_;
 		std::string filepath_;
 		std::string adaptationName_;
+		std::string codeVersion_; // Hash of the source for adaptations compiled from binary code, these have no file to look at
+		mutable AdaptationResultCache resultCache_;
+		mutable BankLayoutCache bankLayout_;
+		SysexPrefilter sysexPrefilter_;
+		SysexMatchers sysexMatchers_;
+		BankDumpLayout bankDumpLayout_;
+		mutable AdaptationCallProfiler profiler_{ kAdapatationPythonFunctionNames };
 	};
 
 }
@@ -25,8 +25,7 @@ namespace knobkraft {
 			int c = me_->channel().toZeroBasedInt();
 			int bank = bankNo.toZeroBased();
 			py::object result = me_->callMethod(kCreateBankDumpRequest, c, bank);
-			std::vector<uint8> byteData = GenericAdaptation::intVectorToByteVector(result.cast<std::vector<int>>());
-			return Sysex::vectorToMessages(byteData);
+			return GenericAdaptation::pythonToMessages(result);
 		}
 		catch (py::error_already_set &ex) {
 			me_->logAdaptationError(kCreateBankDumpRequest, ex);
@@ -40,9 +39,16 @@ namespace knobkraft {
 
 	bool GenericBankDumpCapability::isBankDump(const MidiMessage& message) const
 	{
+		if (!me_->sysexPrefilter().accepts(message)) {
+			return false;
+		}
+		bool matches;
+		if (me_->sysexMatchers().evaluate(kIsPartOfBankDump, message, matches)) {
+			return matches;
+		}
 		py::gil_scoped_acquire acquire;
 		try {
-			auto vector = me_->messageToVector(message);
+			auto vector = me_->messageToPython(message);
 			py::object result = me_->callMethod(kIsPartOfBankDump, vector);
 			return result.cast<bool>();
 		}
@@ -56,15 +62,63 @@ namespace knobkraft {
 		return false;
 	}
 
+	bool GenericBankDumpCapability::isNewBankDump(std::vector<MidiMessage> const &bankDump) const
+	{
+		if (bankDump.size() < messagesSeen_ || bankDump.empty()) {
+			return true;
+		}
+		auto const &first = bankDump.front();
+		return messagesSeen_ == 0 || firstMessage_.size() != (size_t) first.getRawDataSize()
+			|| !std::equal(firstMessage_.begin(), firstMessage_.end(), first.getRawData());
+	}
+
+	void GenericBankDumpCapability::resetIncrementalState() const
+	{
+		// Use empty handles, not None, so nothing needs the GIL when the capability is destroyed
+		marshalledMessages_ = py::object();
+		messagesSeen_ = 0;
+		firstMessage_.clear();
+		progressState_ = py::object();
+		progressFinished_ = false;
+	}
+
 	bool GenericBankDumpCapability::isBankDumpFinished(std::vector<MidiMessage> const &bankDump) const
 	{
 		py::gil_scoped_acquire acquire;
 		try {
-			std::vector<std::vector<int>> vector;
-			for (auto message : bankDump) {
-				vector.push_back(me_->messageToVector(message));
+			if (isNewBankDump(bankDump)) {
+				resetIncrementalState();
+				if (!bankDump.empty()) {
+					firstMessage_.assign(bankDump.front().getRawData(), bankDump.front().getRawData() + bankDump.front().getRawDataSize());
+				}
 			}
-			py::object result = me_->callMethod(kIsBankDumpFinished, vector);
+
+			if (me_->pythonModuleHasFunction(kBankDumpProgress)) {
+				// Incremental protocol - the adaptation only sees each message once, and keeps its own state
+				for (size_t i = messagesSeen_; i < bankDump.size() && !progressFinished_; i++) {
+					auto message = me_->messageToOwnedPython(bankDump[i]);
+					py::object state = progressState_ ? progressState_ : py::none();
+					py::tuple result = me_->callMethod(kBankDumpProgress, message, state);
+					if (result.size() != 2) {
+						throw std::runtime_error(fmt::format("{} must return a tuple (finished, state)", kBankDumpProgress));
+					}
+					progressFinished_ = result[0].cast<bool>();
+					progressState_ = result[1];
+				}
+				messagesSeen_ = bankDump.size();
+				return progressFinished_;
+			}
+
+			// Classic protocol - the adaptation gets all messages, but only the new ones are converted
+			if (!marshalledMessages_) {
+				marshalledMessages_ = py::list();
+			}
+			auto messages = py::reinterpret_borrow<py::list>(marshalledMessages_);
+			for (size_t i = messagesSeen_; i < bankDump.size(); i++) {
+				messages.append(me_->messageToOwnedPython(bankDump[i]));
+			}
+			messagesSeen_ = bankDump.size();
+			py::object result = me_->callMethod(kIsBankDumpFinished, messages);
 			return result.cast<bool>();
 		}
 		catch (py::error_already_set &ex) {
@@ -74,29 +128,33 @@ namespace knobkraft {
 		catch (std::exception &ex) {
 			me_->logAdaptationError(kIsBankDumpFinished, ex);
 		}
+		resetIncrementalState();
 		return false;
 	}
 
 	midikraft::TPatchVector GenericBankDumpCapability::patchesFromSysexBank(const MidiMessage& message) const
 	{
+		std::vector<MidiMessage> programDumps;
+		if (me_->bankDumpLayout().extract(message, programDumps)) {
+			// Cut along the declared layout, Python is only asked for the names not in the result cache
+			auto patchesFound = me_->patchesFromMessages(programDumps);
+			me_->primeNames(patchesFound);
+			return patchesFound;
+		}
+
 		py::gil_scoped_acquire acquire;
 		try {
-			std::vector<int> vector = me_->messageToVector(message);
+			auto vector = me_->messageToPython(message);
 			py::object result = me_->callMethod(kExtractPatchesFromBank, vector);
+			auto messages = GenericAdaptation::pythonToMessages(result);
 			midikraft::TPatchVector patchesFound;
-			std::vector<uint8> byteData = GenericAdaptation::intVectorToByteVector(result.cast<std::vector<int>>());
-			auto messages = Sysex::vectorToMessages(byteData);
-			int no = 0;
-			for (auto programDump : messages) {
-				std::vector<uint8> data(programDump.getRawData(), programDump.getRawData() + programDump.getRawDataSize());
-				auto patch = me_->patchFromPatchData(data, MidiProgramNumber::fromZeroBase(no++)); //TODO the no is ignored
-				if (patch) {
-					patchesFound.push_back(patch);
-				}
-				else {
-					spdlog::warn("Adaptation: Could not create patch from data returned from {}", kExtractPatchesFromBank);
-				}
+			{
+				// Creating the patches needs no Python, let other threads have the interpreter meanwhile
+				py::gil_scoped_release release;
+				patchesFound = me_->patchesFromMessages(messages);
 			}
+			// Resolve all names of the bank with a single call into the adaptation
+			me_->primeNames(patchesFound);
 			return patchesFound;
 		}
 		catch (py::error_already_set &ex) {
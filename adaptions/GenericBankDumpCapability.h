@@ -10,6 +10,8 @@
 
 #include "GenericAdaptation.h"
 
+#include <pybind11/embed.h>
+
 namespace knobkraft {
 
 	class GenericBankDumpCapability : public midikraft::BankDumpCapability {
@@ -21,8 +23,21 @@ namespace knobkraft {
 		bool isBankDumpFinished(std::vector<MidiMessage> const &bankDump) const override;
 		midikraft::TPatchVector patchesFromSysexBank(const MidiMessage& message) const override;
 
+		// Drop the Python objects kept between calls of isBankDumpFinished(). Requires the GIL
+		void resetIncrementalState() const;
+
 	private:
+		bool isNewBankDump(std::vector<MidiMessage> const &bankDump) const;
+
 		GenericAdaptation *me_;
+
+		// The accumulated bank dump only ever grows during one download, so we keep what has already been converted
+		// for Python instead of marshalling all messages again for every new message
+		mutable pybind11::object marshalledMessages_;
+		mutable size_t messagesSeen_ = 0;
+		mutable std::vector<uint8> firstMessage_;
+		mutable pybind11::object progressState_;
+		mutable bool progressFinished_ = false;
 	};
 
 }
@@ -14,6 +14,9 @@
 #include <pybind11/embed.h>
 #include <pybind11/stl.h>
 
+#include <cstring>
+#include <fmt/format.h>
+
 namespace py = pybind11;
 
 
@@ -27,7 +30,7 @@ namespace knobkraft {
 			int c = me_->channel().toZeroBasedInt();
 			py::object result = me_->callMethod(kCreateEditBufferRequest, c);
 			// These should be only one midi message...
-			return { GenericAdaptation::vectorToMessages(result.cast<std::vector<int>>()) };
+			return { GenericAdaptation::pythonToMessages(result) };
 		}
 		catch (py::error_already_set &ex) {
 			me_->logAdaptationError(kCreateEditBufferRequest, ex);
@@ -39,37 +42,106 @@ namespace knobkraft {
 		return {};
 	}
 
+	void GenericEditBufferCapability::resetIncrementalState() const
+	{
+		// Use an empty handle, not None, so nothing needs the GIL when the capability is destroyed
+		accumulatedData_.clear();
+		messagesSeen_ = 0;
+		progressState_ = py::object();
+		progressFinished_ = false;
+	}
+
+	bool GenericEditBufferCapability::isNewEditBufferDump(const std::vector<MidiMessage>& messages) const
+	{
+		if (messages.size() < messagesSeen_ || messages.empty() || messagesSeen_ == 0) {
+			return true;
+		}
+		// Comparing the bytes is much cheaper than marshalling them again, and tells a restarted dump from a continued one
+		size_t offset = 0;
+		for (size_t i = 0; i < messagesSeen_; i++) {
+			auto size = (size_t) messages[i].getRawDataSize();
+			if (offset + size > accumulatedData_.size() || std::memcmp(accumulatedData_.data() + offset, messages[i].getRawData(), size) != 0) {
+				return true;
+			}
+			offset += size;
+		}
+		return offset != accumulatedData_.size();
+	}
+
 	bool GenericEditBufferCapability::isEditBufferDump(const std::vector<MidiMessage>& message) const
 	{
+		if (!me_->sysexPrefilter().acceptsAll(message)) {
+			return false;
+		}
+		bool matches;
+		if (me_->sysexMatchers().evaluate(kIsEditBufferDump, message, matches)) {
+			return matches;
+		}
 		py::gil_scoped_acquire acquire;
+		auto functionName = me_->pythonModuleHasFunction(kEditBufferDumpProgress) ? kEditBufferDumpProgress : kIsEditBufferDump;
 		try {
-			auto vectorForm = GenericAdaptation::midiMessagesToVector(message);
+			if (isNewEditBufferDump(message)) {
+				resetIncrementalState();
+			}
+
+			if (functionName == kEditBufferDumpProgress) {
+				// Incremental protocol - the adaptation only sees each message once, and keeps its own state
+				for (size_t i = messagesSeen_; i < message.size(); i++) {
+					auto next = me_->messageToOwnedPython(message[i]);
+					py::object state = progressState_ ? progressState_ : py::none();
+					py::tuple result = me_->callMethod(kEditBufferDumpProgress, next, state);
+					if (result.size() != 2) {
+						throw std::runtime_error(fmt::format("{} must return a tuple (complete, state)", kEditBufferDumpProgress));
+					}
+					progressFinished_ = result[0].cast<bool>();
+					progressState_ = result[1];
+					accumulatedData_.insert(accumulatedData_.end(), message[i].getRawData(), message[i].getRawData() + message[i].getRawDataSize());
+					messagesSeen_ = i + 1;
+				}
+				return progressFinished_;
+			}
+
+			// Classic protocol - the adaptation gets all bytes received so far, but only the new messages are appended
+			for (size_t i = messagesSeen_; i < message.size(); i++) {
+				accumulatedData_.insert(accumulatedData_.end(), message[i].getRawData(), message[i].getRawData() + message[i].getRawDataSize());
+			}
+			messagesSeen_ = message.size();
+			auto vectorForm = me_->ownedDataToPython(accumulatedData_.data(), accumulatedData_.size());
 			py::object result = me_->callMethod(kIsEditBufferDump, vectorForm);
 			return result.cast<bool>();
 		}
 		catch (py::error_already_set &ex) {
-			me_->logAdaptationError(kIsEditBufferDump, ex);
+			me_->logAdaptationError(functionName, ex);
 			ex.restore();
 		}
 		catch (std::exception &ex) {
-			me_->logAdaptationError(kIsEditBufferDump, ex);
+			me_->logAdaptationError(functionName, ex);
 		}
+		resetIncrementalState();
 		return false;
 	}
 
 	midikraft::EditBufferCapability::HandshakeReply GenericEditBufferCapability::isMessagePartOfEditBuffer(const MidiMessage& message) const
 	{
+		// Messages that don't start with a declared header are not ours, no need to ask Python
+		if (!me_->sysexPrefilter().accepts(message)) {
+			return { false, {} };
+		}
+		bool matches;
+		if (!me_->pythonModuleHasFunction(kIsPartOfEditBufferDump) && me_->sysexMatchers().evaluate(kIsEditBufferDump, message, matches)) {
+			return { matches, {} };
+		}
 		py::gil_scoped_acquire acquire;
 		// This is an optional function that can be implemented for multi message edit buffers like in the DSI Evolver
 		if (me_->pythonModuleHasFunction(kIsPartOfEditBufferDump)) {
 			try {
-				auto vectorForm = me_->messageToVector(message);
+				auto vectorForm = me_->messageToPython(message);
 				py::object result = me_->callMethod(kIsPartOfEditBufferDump, vectorForm);
 				if (py::isinstance<py::tuple>(result)) {
 					// The reply is a tuple - let's hope it is a tuple of a bool and a list of MIDI messages as documented
 					auto result_tuple = py::cast<py::tuple>(result);
 					py::object replyBool = result_tuple[0];
-					auto byteData = GenericAdaptation::vectorToMessages(result_tuple[1].cast<std::vector<int>>());
+					auto byteData = GenericAdaptation::pythonToMessages(result_tuple[1]);
 					return { replyBool.cast<bool>(), byteData };
 				}
 				else {
@@ -86,15 +158,27 @@ namespace knobkraft {
 			return { false, {} };
 		}
 		else {
-			// Default implementation is to just to call isEditBuffer() with a single message vector
-			return { isEditBufferDump({ message }), {} };
+			// Default implementation is to just to call isEditBuffer() with a single message vector. This bypasses the
+			// accumulated state, which belongs to the dump the librarian is assembling
+			try {
+				auto vectorForm = me_->messageToOwnedPython(message);
+				py::object result = me_->callMethod(kIsEditBufferDump, vectorForm);
+				return { result.cast<bool>(), {} };
+			}
+			catch (py::error_already_set& ex) {
+				me_->logAdaptationError(kIsEditBufferDump, ex);
+				ex.restore();
+			}
+			catch (std::exception& ex) {
+				me_->logAdaptationError(kIsEditBufferDump, ex);
+			}
+			return { false, {} };
 		}
 	}
 
 	std::shared_ptr<midikraft::DataFile> GenericEditBufferCapability::patchFromSysex(const std::vector<MidiMessage>& message) const
 	{
-		py::gil_scoped_acquire acquire;
-		// For the Generic Adaptation, this is a nop, as we do not unpack the MidiMessage, but rather store the raw MidiMessage
+		// No Python involved, so no need for the GIL here. For the Generic Adaptation, this is a nop, as we do not unpack the MidiMessage, but rather store the raw MidiMessage
 		midikraft::Synth::PatchData data;
 		for (auto const& m : message) {
 			std::copy(m.getRawData(), m.getRawData() + m.getRawDataSize(), std::back_inserter(data));
@@ -106,11 +190,11 @@ namespace knobkraft {
 	{
 		py::gil_scoped_acquire acquire;
 		try {
-			auto data = patch->data();
+			auto const &patchData = patch->data();
+			auto data = me_->dataToPython(patchData.data(), patchData.size());
 			int c = me_->channel().toZeroBasedInt();
 			py::object result = me_->callMethod(kConvertToEditBuffer, c, data);
-			std::vector<uint8> byteData = GenericAdaptation::intVectorToByteVector(result.cast<std::vector<int>>());
-			return Sysex::vectorToMessages(byteData);
+			return GenericAdaptation::pythonToMessages(result);
 		}
 		catch (py::error_already_set &ex) {
 			me_->logAdaptationError(kConvertToEditBuffer, ex);
@@ -124,7 +208,6 @@ namespace knobkraft {
 
 	juce::MidiMessage GenericEditBufferCapability::saveEditBufferToProgram(int programNumber)
 	{
-		py::gil_scoped_acquire acquire;
 		ignoreUnused(programNumber);
 		return MidiMessage();
 	}
@@ -10,6 +10,8 @@
 
 #include "GenericAdaptation.h"
 
+#include <pybind11/embed.h>
+
 namespace knobkraft {
 
 	// EditBufferCapability
@@ -24,8 +26,20 @@ namespace knobkraft {
 		std::vector<MidiMessage> patchToSysex(std::shared_ptr<midikraft::DataFile> patch) const override;
 		MidiMessage saveEditBufferToProgram(int programNumber) override;
 
+		// Drop the Python objects kept between calls of isEditBufferDump(). Requires the GIL
+		void resetIncrementalState() const;
+
 	private:
+		bool isNewEditBufferDump(std::vector<MidiMessage> const &messages) const;
+
 		GenericAdaptation *me_;
+
+		// isEditBufferDump() is presented the growing list of messages received so far after every message, so we keep
+		// the bytes already seen instead of concatenating all messages again, and only the new messages are converted
+		mutable std::vector<uint8> accumulatedData_;
+		mutable size_t messagesSeen_ = 0;
+		mutable pybind11::object progressState_;
+		mutable bool progressFinished_ = false;
 	};
 
 
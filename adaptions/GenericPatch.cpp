@@ -7,6 +7,7 @@
 #include "GenericPatch.h"
 
 #include "GenericAdaptation.h"
+#include "AdaptationErrorLog.h"
 
 #include <pybind11/embed.h>
 #include <pybind11/stl.h>
@@ -16,256 +17,375 @@ namespace py = pybind11;
 #include <fmt/format.h>
 #include <spdlog/spdlog.h>
 
+#include <atomic>
+
 namespace knobkraft {
 
-	GenericPatch::GenericPatch(GenericAdaptation const *me, pybind11::module &adaptation_module, midikraft::Synth::PatchData const &data, DataType dataType) : midikraft::DataFile(dataType, data), me_(me), adaptation_(adaptation_module)
+	namespace {
+		std::atomic<size_t> sLiveInstances{ 0 };
+		std::atomic<size_t> sLiveBytes{ 0 };
+	}
+
+	GenericPatch::GenericPatch(GenericAdaptation const *me, pybind11::module &adaptation_module, midikraft::Synth::PatchData const &data, DataType dataType) : midikraft::DataFile(dataType, data), capabilityView_(this), me_(me), adaptation_(adaptation_module),
+		accountedBytes_(sizeof(GenericPatch) + data.size())
 	{
+		sLiveInstances.fetch_add(1, std::memory_order_relaxed);
+		sLiveBytes.fetch_add(accountedBytes_, std::memory_order_relaxed);
 	}
 
-	bool GenericPatch::pythonModuleHasFunction(std::string const &functionName) const
+	GenericPatch::~GenericPatch()
 	{
-		py::gil_scoped_acquire acquire;
-		if (!adaptation_) {
-			return false;
-		}
-		return py::hasattr(*adaptation_, functionName.c_str());
+		sLiveInstances.fetch_sub(1, std::memory_order_relaxed);
+		sLiveBytes.fetch_sub(accountedBytes_, std::memory_order_relaxed);
 	}
 
-	std::string GenericStoredPatchNameCapability::name() const
+	size_t GenericPatch::liveInstances()
 	{
-		py::gil_scoped_acquire acquire;
-		if (!me_.expired()) {
-			auto patch = me_.lock();
-			if (patch->pythonModuleHasFunction(kNameFromDump)) {
-				try {
-					std::vector<int> v(patch->data().data(), patch->data().data() + patch->data().size());
-					auto result = patch->callMethod(kNameFromDump, v);
-					checkForPythonOutputAndLog();
-					return result.cast<std::string>();
-				}
-				catch (py::error_already_set& ex) {
-					std::string errorMessage = fmt::format("Error calling {}: {}", kNameFromDump, ex.what());
-					ex.restore(); // Prevent a deadlock https://github.com/pybind/pybind11/issues/1490
-					spdlog::error(errorMessage);
-				}
-				catch (std::exception& ex) {
-					patch->logAdaptationError(kNameFromDump, ex);
-				}
-				return "invalid";
-			}
-			else
-			{
-				return "noname";
-			}
+		return sLiveInstances.load(std::memory_order_relaxed);
+	}
+
+	size_t GenericPatch::liveBytes()
+	{
+		return sLiveBytes.load(std::memory_order_relaxed);
+	}
+
+	GenericAdaptation const *GenericPatch::adaptation() const
+	{
+		return me_;
+	}
+
+	pybind11::object GenericPatch::dataToPython() const
+	{
+		return me_->dataToPython(data().data(), data().size());
+	}
+
+	void GenericPatch::setCachedName(std::string const &name)
+	{
+		cachedName_ = name;
+	}
+
+	void GenericPatch::dataChanged()
+	{
+		cachedName_.reset();
+		{
+			std::lock_guard<std::mutex> lock(dataHashLock_);
+			dataHash_.clear();
 		}
-		else {
-			return "invalid";
+		auto bytes = sizeof(GenericPatch) + data().size();
+		sLiveBytes.fetch_add(bytes, std::memory_order_relaxed);
+		sLiveBytes.fetch_sub(accountedBytes_, std::memory_order_relaxed);
+		accountedBytes_ = bytes;
+	}
+
+	std::optional<std::string> GenericPatch::cachedName() const
+	{
+		return cachedName_;
+	}
+
+	std::string GenericPatch::dataHash() const
+	{
+		std::lock_guard<std::mutex> lock(dataHashLock_);
+		if (dataHash_.empty()) {
+			dataHash_ = AdaptationResultCache::hashOf(data());
 		}
+		return dataHash_;
+	}
+
+	bool GenericPatch::hasDataHash() const
+	{
+		std::lock_guard<std::mutex> lock(dataHashLock_);
+		return !dataHash_.empty();
+	}
+
+	void GenericPatch::setDataHash(std::string const &hash) const
+	{
+		std::lock_guard<std::mutex> lock(dataHashLock_);
+		dataHash_ = hash;
+	}
+
+	bool GenericPatch::cachedResult(AdaptationResultCache::Kind kind, int index, std::string &outValue) const
+	{
+		return me_->resultCache().lookup(kind, dataHash(), index, outValue);
+	}
+
+	void GenericPatch::storeResult(AdaptationResultCache::Kind kind, int index, std::string const &value) const
+	{
+		me_->resultCache().store(kind, dataHash(), index, value);
+	}
+
+	bool GenericPatch::pythonModuleHasFunction(std::string const &functionName) const
+	{
+		// The adaptation keeps a resolved function table, no need to bother Python with this
+		return me_->pythonModuleHasFunction(functionName);
 	}
 
 	void GenericPatch::logAdaptationError(const char *methodName, std::exception &ex) const
 	{
-		// This hoop is required to properly process Python created exceptions
-		std::string exceptionMessage = ex.what();
-		std::string adaptionName = me_->getName();
-		std::string methodCopy(methodName, methodName + strlen(methodName));
-		MessageManager::callAsync([adaptionName, methodCopy, exceptionMessage]() {
-			spdlog::error("Adaptation[{}]: Error calling {}: {}", adaptionName, methodCopy, exceptionMessage);
-		});
+		AdaptationErrorLog::instance().record(me_->getName(), methodName, ex.what());
 	}
 
-	void GenericStoredPatchNameCapability::setName(std::string const &name)
+	std::string GenericPatchCapabilities::name(GenericPatch const &patch) const
 	{
+		auto cached = patch.cachedName();
+		if (cached.has_value()) {
+			return *cached;
+		}
+		std::string persisted;
+		if (patch.cachedResult(AdaptationResultCache::Kind::Name, 0, persisted)) {
+			const_cast<GenericPatch &>(patch).setCachedName(persisted);
+			return persisted;
+		}
+		if (!me_->pythonModuleHasFunction(kNameFromDump)) {
+			return "noname";
+		}
 		py::gil_scoped_acquire acquire;
-		if (!me_.expired()) {
-			// set name is an optional method - if it is not implemented, the name in the patch is never changed, the name displayed in the Librarian is
-			if (!me_.lock()->pythonModuleHasFunction(kRenamePatch)) return;
-
-			// Very well, then try to change the name in the patch data
-			try {
-				std::vector<int> v(me_.lock()->data().data(), me_.lock()->data().data() + me_.lock()->data().size());
-				py::object result = me_.lock()->callMethod(kRenamePatch, v, name);
-				auto intVector = result.cast<std::vector<int>>();
-				std::vector<uint8> byteData = GenericAdaptation::intVectorToByteVector(intVector);
-				me_.lock()->setData(byteData);
- 			}
-			catch (py::error_already_set &ex) {
-				if (!me_.expired())
-					me_.lock()->logAdaptationError(kRenamePatch, ex);
-				ex.restore();
-			}
-			catch (std::exception &ex) {
-				if (!me_.expired())
-					me_.lock()->logAdaptationError(kRenamePatch, ex);
-			}
-			catch (...) {
-				spdlog::error("Adaptation[unknown]: Uncaught exception in {} of Patch of GenericAdaptation", kRenamePatch);
-			}
+		try {
+			auto v = patch.dataToPython();
+			auto result = patch.callMethod(kNameFromDump, v);
+			checkForPythonOutputAndLog();
+			auto name = result.cast<std::string>();
+			patch.storeResult(AdaptationResultCache::Kind::Name, 0, name);
+			return name;
+		}
+		catch (py::error_already_set& ex) {
+			std::string errorMessage = fmt::format("Error calling {}: {}", kNameFromDump, ex.what());
+			ex.restore(); // Prevent a deadlock https://github.com/pybind/pybind11/issues/1490
+			spdlog::error(errorMessage);
 		}
+		catch (std::exception& ex) {
+			patch.logAdaptationError(kNameFromDump, ex);
+		}
+		return "invalid";
 	}
 
-	bool GenericDefaultNameCapability::isDefaultName(std::string const &patchName) const
+	void GenericPatchCapabilities::setName(GenericPatch &patch, std::string const &name) const
 	{
+		// set name is an optional method - if it is not implemented, the name in the patch is never changed, the name displayed in the Librarian is
+		if (!me_->pythonModuleHasFunction(kRenamePatch)) return;
+
+		// Very well, then try to change the name in the patch data
 		py::gil_scoped_acquire acquire;
-		if (!me_.expired()) {
-			auto patch = me_.lock();
-			try {
-				py::object result = patch->callMethod(kIsDefaultName, patchName);
-				return py::cast<bool>(result);
-			}
-			catch (py::error_already_set &ex) {
-				if (!me_.expired())
-					me_.lock()->logAdaptationError(kIsDefaultName, ex);
-				ex.restore();
-			}
-			catch (std::exception &ex) {
-				if (!me_.expired())
-					me_.lock()->logAdaptationError(kIsDefaultName, ex);
-			}
-			catch (...) {
-				spdlog::error("Uncaught exception in {} of Patch of GenericAdaptation", kIsDefaultName);
-			}
+		try {
+			auto v = patch.dataToPython();
+			py::object result = patch.callMethod(kRenamePatch, v, name);
+			std::vector<uint8> byteData = GenericAdaptation::pythonToByteVector(result);
+			patch.setData(byteData);
+			patch.dataChanged();
+		}
+		catch (py::error_already_set &ex) {
+			patch.logAdaptationError(kRenamePatch, ex);
+			ex.restore();
+		}
+		catch (std::exception &ex) {
+			patch.logAdaptationError(kRenamePatch, ex);
+		}
+		catch (...) {
+			spdlog::error("Adaptation[unknown]: Uncaught exception in {} of Patch of GenericAdaptation", kRenamePatch);
 		}
-		return false;
 	}
 
-	midikraft::LayeredPatchCapability::LayerMode GenericLayeredPatchCapability::layerMode() const
+	bool GenericPatchCapabilities::isDefaultName(GenericPatch const &patch, std::string const &patchName) const
 	{
-		//TODO not sure what the UI different is here
-		return LayeredPatchCapability::LayerMode::STACK;
+		py::gil_scoped_acquire acquire;
+		try {
+			py::object result = patch.callMethod(kIsDefaultName, patchName);
+			return py::cast<bool>(result);
+		}
+		catch (py::error_already_set &ex) {
+			patch.logAdaptationError(kIsDefaultName, ex);
+			ex.restore();
+		}
+		catch (std::exception &ex) {
+			patch.logAdaptationError(kIsDefaultName, ex);
+		}
+		catch (...) {
+			spdlog::error("Uncaught exception in {} of Patch of GenericAdaptation", kIsDefaultName);
+		}
+		return false;
 	}
 
-	int GenericLayeredPatchCapability::numberOfLayers() const
+	int GenericPatchCapabilities::numberOfLayers(GenericPatch const &patch) const
 	{
+		std::string cached;
+		if (patch.cachedResult(AdaptationResultCache::Kind::NumberOfLayers, 0, cached)) {
+			return std::stoi(cached);
+		}
 		py::gil_scoped_acquire acquire;
-		if (!me_.expired()) {
-			auto patch = me_.lock();
-			try {
-				std::vector<int> v(me_.lock()->data().data(), me_.lock()->data().data() + me_.lock()->data().size());
-				py::object result = patch->callMethod(kNumberOfLayers, v);
-				return py::cast<int>(result);
-			}
-			catch (py::error_already_set& ex) {
-				if (!me_.expired())
-					me_.lock()->logAdaptationError(kNumberOfLayers, ex);
-				ex.restore();
-			}
-			catch (std::exception& ex) {
-				if (!me_.expired())
-					me_.lock()->logAdaptationError(kNumberOfLayers, ex);
-			}
-			catch (...) {
-				spdlog::error("Uncaught exception in {} of Patch of GenericAdaptation", kNumberOfLayers);
-			}
+		try {
+			auto v = patch.dataToPython();
+			py::object result = patch.callMethod(kNumberOfLayers, v);
+			int layers = py::cast<int>(result);
+			patch.storeResult(AdaptationResultCache::Kind::NumberOfLayers, 0, std::to_string(layers));
+			return layers;
+		}
+		catch (py::error_already_set& ex) {
+			patch.logAdaptationError(kNumberOfLayers, ex);
+			ex.restore();
+		}
+		catch (std::exception& ex) {
+			patch.logAdaptationError(kNumberOfLayers, ex);
+		}
+		catch (...) {
+			spdlog::error("Uncaught exception in {} of Patch of GenericAdaptation", kNumberOfLayers);
 		}
 		return 1;
 	}
 
-	std::string GenericLayeredPatchCapability::layerName(int layerNo) const
+	std::string GenericPatchCapabilities::layerName(GenericPatch const &patch, int layerNo) const
 	{
+		std::string cached;
+		if (patch.cachedResult(AdaptationResultCache::Kind::LayerName, layerNo, cached)) {
+			return cached;
+		}
 		py::gil_scoped_acquire acquire;
-		if (!me_.expired()) {
-			auto patch = me_.lock();
-			try {
-				std::vector<int> v(me_.lock()->data().data(), me_.lock()->data().data() + me_.lock()->data().size());
-				py::object result = patch->callMethod(kLayerName, v, layerNo);
-				return py::cast<std::string>(result);
-			}
-			catch (py::error_already_set& ex) {
-				if (!me_.expired())
-					me_.lock()->logAdaptationError(kLayerName, ex);
-				ex.restore();
-			}
-			catch (std::exception& ex) {
-				if (!me_.expired())
-					me_.lock()->logAdaptationError(kLayerName, ex);
-			}
-			catch (...) {
-				spdlog::error("Uncaught exception in {} of Patch of GenericAdaptation",  kLayerName);
-			}
+		try {
+			auto v = patch.dataToPython();
+			py::object result = patch.callMethod(kLayerName, v, layerNo);
+			auto name = py::cast<std::string>(result);
+			patch.storeResult(AdaptationResultCache::Kind::LayerName, layerNo, name);
+			return name;
+		}
+		catch (py::error_already_set& ex) {
+			patch.logAdaptationError(kLayerName, ex);
+			ex.restore();
+		}
+		catch (std::exception& ex) {
+			patch.logAdaptationError(kLayerName, ex);
+		}
+		catch (...) {
+			spdlog::error("Uncaught exception in {} of Patch of GenericAdaptation",  kLayerName);
 		}
 		return "Invalid";
 	}
 
-	void GenericLayeredPatchCapability::setLayerName(int layerNo, std::string const& layerName)
+	void GenericPatchCapabilities::setLayerName(GenericPatch &patch, int layerNo, std::string const& layerName) const
 	{
-		if (me_.lock()->pythonModuleHasFunction(kSetLayerName)) {
-			py::gil_scoped_acquire acquire;
-			if (!me_.expired()) {
-				auto patch = me_.lock();
-				try {
-					std::vector<int> v(patch->data().data(), patch->data().data() + patch->data().size());
-					py::object result = patch->callMethod(kSetLayerName, v, layerNo, layerName);
-					auto intVector = result.cast<std::vector<int>>();
-					std::vector<uint8> byteData = GenericAdaptation::intVectorToByteVector(intVector);
-					patch->setData(byteData);
-				}
-				catch (py::error_already_set& ex) {
-					patch->logAdaptationError(kSetLayerName, ex);
-					ex.restore();
-				}
-				catch (std::exception& ex) {
-					if (!me_.expired())
-						me_.lock()->logAdaptationError(kSetLayerName, ex);
-				}
-				catch (...) {
-					spdlog::error("Uncaught exception in {} of Patch of GenericAdaptation", kSetLayerName);
-				}
-			}
-		}
-		else {
+		if (!me_->pythonModuleHasFunction(kSetLayerName)) {
 			spdlog::warn("Adaptation did not implement setLayerName(), can't rename layer");
+			return;
+		}
+		py::gil_scoped_acquire acquire;
+		try {
+			auto v = patch.dataToPython();
+			py::object result = patch.callMethod(kSetLayerName, v, layerNo, layerName);
+			std::vector<uint8> byteData = GenericAdaptation::pythonToByteVector(result);
+			patch.setData(byteData);
+			patch.dataChanged();
+		}
+		catch (py::error_already_set& ex) {
+			patch.logAdaptationError(kSetLayerName, ex);
+			ex.restore();
+		}
+		catch (std::exception& ex) {
+			patch.logAdaptationError(kSetLayerName, ex);
+		}
+		catch (...) {
+			spdlog::error("Uncaught exception in {} of Patch of GenericAdaptation", kSetLayerName);
 		}
 	}
 
-	bool GenericStoredTagCapability::setTags(std::set<midikraft::Tag> const& tags)
+	bool GenericPatchCapabilities::setTags(GenericPatch &patch, std::set<midikraft::Tag> const& tags) const
 	{
-		ignoreUnused(tags);
+		ignoreUnused(patch, tags);
 		spdlog::warn("Changing tags in the stored patch is not implemented yet!");
 		return false;
 	}
 
-	std::set<midikraft::Tag> GenericStoredTagCapability::tags() const
-	{
-		if (me_.lock()->pythonModuleHasFunction(kGetStoredTags)) {
-			py::gil_scoped_acquire acquire;
-			if (!me_.expired()) {
-				auto patch = me_.lock();
-				try {
-					std::vector<int> v(me_.lock()->data().data(), me_.lock()->data().data() + me_.lock()->data().size());
-					py::object result = patch->callMethod(kGetStoredTags, v);
-					auto tagsFound = result.cast<std::vector<std::string>>();
-					std::set<midikraft::Tag> resultSet;
-					for (auto const& tag : tagsFound)
-					{
-						resultSet.insert(tag);
-					}
-					return resultSet;
-				}
-				catch (py::error_already_set& ex)
-				{
-					if (!me_.expired())
-						me_.lock()->logAdaptationError(kGetStoredTags, ex);
-				}
-				catch (...) {
-					spdlog::error("Uncaught exception in {} of Patch of GenericAdaptation", kGetStoredTags);
+	std::set<midikraft::Tag> GenericPatchCapabilities::tags(GenericPatch const &patch) const
+	{
+		if (!me_->pythonModuleHasFunction(kGetStoredTags)) {
+			return {};
+		}
+		std::string cached;
+		if (patch.cachedResult(AdaptationResultCache::Kind::StoredTags, 0, cached)) {
+			// Tags are cached as one string, separated by newlines
+			std::set<midikraft::Tag> resultSet;
+			for (auto const &tag : StringArray::fromLines(cached)) {
+				if (tag.isNotEmpty()) {
+					resultSet.insert(tag.toStdString());
 				}
 			}
+			return resultSet;
+		}
+		py::gil_scoped_acquire acquire;
+		try {
+			auto v = patch.dataToPython();
+			py::object result = patch.callMethod(kGetStoredTags, v);
+			auto tagsFound = result.cast<std::vector<std::string>>();
+			std::set<midikraft::Tag> resultSet;
+			StringArray joined;
+			for (auto const& tag : tagsFound)
+			{
+				resultSet.insert(tag);
+				joined.add(tag);
+			}
+			patch.storeResult(AdaptationResultCache::Kind::StoredTags, 0, joined.joinIntoString("\n").toStdString());
+			return resultSet;
+		}
+		catch (py::error_already_set& ex)
+		{
+			patch.logAdaptationError(kGetStoredTags, ex);
+			ex.restore();
+		}
+		catch (...) {
+			spdlog::error("Uncaught exception in {} of Patch of GenericAdaptation", kGetStoredTags);
 		}
 		return {};
 	}
 
+	void GenericPatchCapabilityView::setName(std::string const &name)
+	{
+		patch_->adaptation()->patchCapabilities().setName(*patch_, name);
+	}
+
+	std::string GenericPatchCapabilityView::name() const
+	{
+		return patch_->adaptation()->patchCapabilities().name(*patch_);
+	}
+
+	bool GenericPatchCapabilityView::isDefaultName(std::string const &patchName) const
+	{
+		return patch_->adaptation()->patchCapabilities().isDefaultName(*patch_, patchName);
+	}
+
+	midikraft::LayeredPatchCapability::LayerMode GenericPatchCapabilityView::layerMode() const
+	{
+		//TODO not sure what the UI different is here
+		return LayeredPatchCapability::LayerMode::STACK;
+	}
+
+	int GenericPatchCapabilityView::numberOfLayers() const
+	{
+		return patch_->adaptation()->patchCapabilities().numberOfLayers(*patch_);
+	}
+
+	std::string GenericPatchCapabilityView::layerName(int layerNo) const
+	{
+		return patch_->adaptation()->patchCapabilities().layerName(*patch_, layerNo);
+	}
+
+	void GenericPatchCapabilityView::setLayerName(int layerNo, std::string const &layerName)
+	{
+		patch_->adaptation()->patchCapabilities().setLayerName(*patch_, layerNo, layerName);
+	}
+
+	bool GenericPatchCapabilityView::setTags(std::set<midikraft::Tag> const &tags)
+	{
+		return patch_->adaptation()->patchCapabilities().setTags(*patch_, tags);
+	}
+
+	std::set<midikraft::Tag> GenericPatchCapabilityView::tags() const
+	{
+		return patch_->adaptation()->patchCapabilities().tags(*patch_);
+	}
+
+	// The shared_ptr versions use the aliasing constructor, so the view keeps the patch alive and nothing is allocated
 
 	bool GenericPatch::hasCapability(std::shared_ptr<midikraft::StoredPatchNameCapability> &outCapability) const
 	{
 		midikraft::StoredPatchNameCapability *impl;
 		if (hasCapability(&impl)) {
-			if (!genericStoredPatchNameCapabilityImpl_) {
-				// Lazy init allowed despite const-ness of method. Smell.
-				GenericPatch *non_const = const_cast<GenericPatch *>(this);
-				non_const->genericStoredPatchNameCapabilityImpl_ = std::make_shared<GenericStoredPatchNameCapability>(non_const->shared_from_this());
-			}
-			outCapability = genericStoredPatchNameCapabilityImpl_;
+			outCapability = std::shared_ptr<midikraft::StoredPatchNameCapability>(const_cast<GenericPatch *>(this)->shared_from_this(), impl);
 			return true;
 		}
 		return false;
@@ -274,12 +394,7 @@ namespace knobkraft {
 	bool GenericPatch::hasCapability(midikraft::StoredPatchNameCapability **outCapability) const
 	{
 		if (pythonModuleHasFunction(kRenamePatch)) {
-			if (!genericStoredPatchNameCapabilityImpl_) {
-				// Lazy init allowed despite const-ness of method. Smell.
-				GenericPatch *non_const = const_cast<GenericPatch *>(this);
-				non_const->genericStoredPatchNameCapabilityImpl_ = std::make_shared<GenericStoredPatchNameCapability>(non_const->shared_from_this());
-			}
-			*outCapability = genericStoredPatchNameCapabilityImpl_.get();
+			*outCapability = &capabilityView_;
 			return true;
 		}
 		return false;
@@ -289,12 +404,7 @@ namespace knobkraft {
 	{
 		midikraft::DefaultNameCapability *impl;
 		if (hasCapability(&impl)) {
-			if (!genericDefaultNameCapabilityImp_) {
-				// Lazy init allowed despite const-ness of method. Smell.
-				GenericPatch *non_const = const_cast<GenericPatch *>(this);
-				non_const->genericDefaultNameCapabilityImp_ = std::make_shared<GenericDefaultNameCapability>(non_const->shared_from_this());
-			}
-			outCapability = genericDefaultNameCapabilityImp_;
+			outCapability = std::shared_ptr<midikraft::DefaultNameCapability>(const_cast<GenericPatch *>(this)->shared_from_this(), impl);
 			return true;
 		}
 		return false;
@@ -303,12 +413,7 @@ namespace knobkraft {
 	bool GenericPatch::hasCapability(midikraft::DefaultNameCapability **outCapability) const
 	{
 		if (pythonModuleHasFunction(kIsDefaultName)) {
-			if (!genericDefaultNameCapabilityImp_) {
-				// Lazy init allowed despite const-ness of method. Smell.
-				GenericPatch *non_const = const_cast<GenericPatch *>(this);
-				non_const->genericDefaultNameCapabilityImp_ = std::make_shared<GenericDefaultNameCapability>(non_const->shared_from_this());
-			}
-			*outCapability = genericDefaultNameCapabilityImp_.get();
+			*outCapability = &capabilityView_;
 			return true;
 		}
 		return false;
@@ -318,12 +423,7 @@ namespace knobkraft {
 	{
 		midikraft::LayeredPatchCapability* impl;
 		if (hasCapability(&impl)) {
-			if (!genericLayeredPatchCapabilityImpl_) {
-				// Lazy init allowed despite const-ness of method. Smell.
-				GenericPatch* non_const = const_cast<GenericPatch*>(this);
-				non_const->genericLayeredPatchCapabilityImpl_ = std::make_shared<GenericLayeredPatchCapability>(non_const->shared_from_this());
-			}
-			outCapability = genericLayeredPatchCapabilityImpl_;
+			outCapability = std::shared_ptr<midikraft::LayeredPatchCapability>(const_cast<GenericPatch *>(this)->shared_from_this(), impl);
 			return true;
 		}
 		return false;
@@ -332,12 +432,7 @@ namespace knobkraft {
 	bool GenericPatch::hasCapability(midikraft::LayeredPatchCapability** outCapability) const
 	{
 		if (pythonModuleHasFunction(kLayerName) && pythonModuleHasFunction(kNumberOfLayers)) {
-			if (!genericLayeredPatchCapabilityImpl_) {
-				// Lazy init allowed despite const-ness of method. Smell.
-				GenericPatch* non_const = const_cast<GenericPatch*>(this);
-				non_const->genericLayeredPatchCapabilityImpl_ = std::make_shared<GenericLayeredPatchCapability>(non_const->shared_from_this());
-			}
-			*outCapability = genericLayeredPatchCapabilityImpl_.get();
+			*outCapability = &capabilityView_;
 			return true;
 		}
 		return false;
@@ -347,12 +442,7 @@ namespace knobkraft {
 	{
 		midikraft::StoredTagCapability* impl;
 		if (hasCapability(&impl)) {
-			if (!genericStoredTagCapabilityImpl_) {
-				// Lazy init allowed despite const-ness of method. Smell.
-				GenericPatch* non_const = const_cast<GenericPatch*>(this);
-				non_const->genericStoredTagCapabilityImpl_ = std::make_shared<GenericStoredTagCapability>(non_const->shared_from_this());
-			}
-			outCapability = genericStoredTagCapabilityImpl_;
+			outCapability = std::shared_ptr<midikraft::StoredTagCapability>(const_cast<GenericPatch *>(this)->shared_from_this(), impl);
 			return true;
 		}
 		return false;
@@ -361,16 +451,10 @@ namespace knobkraft {
 	bool GenericPatch::hasCapability(midikraft::StoredTagCapability** outCapability) const
 	{
 		if (pythonModuleHasFunction(kGetStoredTags)) {
-			if (!genericStoredTagCapabilityImpl_) {
-				// Lazy init allowed despite const-ness of method. Smell.
-				GenericPatch* non_const = const_cast<GenericPatch*>(this);
-				non_const->genericStoredTagCapabilityImpl_ = std::make_shared<GenericStoredTagCapability>(non_const->shared_from_this());
-			}
-			*outCapability = genericStoredTagCapabilityImpl_.get();
+			*outCapability = &capabilityView_;
 			return true;
 		}
 		return false;
 	}
 
 }
-
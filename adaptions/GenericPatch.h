@@ -17,6 +17,9 @@
 
 #include <pybind11/embed.h>
 
+#include <mutex>
+#include <optional>
+
 #include <fmt/format.h>
 #include <spdlog/spdlog.h>
 
@@ -24,50 +27,51 @@ namespace knobkraft {
 
 	class GenericPatch;
 
-	class GenericStoredPatchNameCapability : public midikraft::StoredPatchNameCapability {
+	// The logic of the patch capabilities. This exists once per adaptation and gets the patch passed in, so the patches
+	// themselves need not allocate anything for their capabilities
+	class GenericPatchCapabilities {
 	public:
-		GenericStoredPatchNameCapability(std::shared_ptr<GenericPatch> me) : me_(me) {}
-        virtual ~GenericStoredPatchNameCapability() = default;
-		void setName(std::string const &name) override;
-		std::string name() const override;
+		GenericPatchCapabilities(GenericAdaptation const *me) : me_(me) {}
 
-	private:
-		std::weak_ptr<GenericPatch> me_;
-	};
+		// StoredPatchNameCapability
+		std::string name(GenericPatch const &patch) const;
+		void setName(GenericPatch &patch, std::string const &name) const;
 
-	class GenericDefaultNameCapability : public midikraft::DefaultNameCapability {
-	public:
-		GenericDefaultNameCapability(std::shared_ptr<GenericPatch> me) : me_(me) {}
-        virtual ~GenericDefaultNameCapability() = default;
-		virtual bool isDefaultName(std::string const &patchName) const override;
+		// DefaultNameCapability
+		bool isDefaultName(GenericPatch const &patch, std::string const &patchName) const;
 
-	private:
-		std::weak_ptr<GenericPatch> me_;
-	};
+		// LayeredPatchCapability
+		int numberOfLayers(GenericPatch const &patch) const;
+		std::string layerName(GenericPatch const &patch, int layerNo) const;
+		void setLayerName(GenericPatch &patch, int layerNo, std::string const &layerName) const;
 
-	class GenericLayeredPatchCapability : public midikraft::LayeredPatchCapability {
-	public:
-		GenericLayeredPatchCapability(std::shared_ptr<GenericPatch> me) : me_(me) {}
-        virtual ~GenericLayeredPatchCapability() = default;
-		virtual LayerMode layerMode() const override;
-		virtual int numberOfLayers() const override;
-		virtual std::string layerName(int layerNo) const override;
-		virtual void setLayerName(int layerNo, std::string const& layerName) override;
+		// StoredTagCapability
+		bool setTags(GenericPatch &patch, std::set<midikraft::Tag> const &tags) const;
+		std::set<midikraft::Tag> tags(GenericPatch const &patch) const;
 
 	private:
-		std::weak_ptr<GenericPatch> me_;
+		GenericAdaptation const *me_;
 	};
 
-	class GenericStoredTagCapability : public midikraft::StoredTagCapability
-	{
+	// Lightweight view handed out by GenericPatch::hasCapability(), embedded in the patch and forwarding to the adaptation's GenericPatchCapabilities
+	class GenericPatchCapabilityView : public midikraft::StoredPatchNameCapability, public midikraft::DefaultNameCapability,
+		public midikraft::LayeredPatchCapability, public midikraft::StoredTagCapability {
 	public:
-		GenericStoredTagCapability(std::shared_ptr<GenericPatch> me) : me_(me) {}
-        virtual ~GenericStoredTagCapability() = default;
-		virtual bool setTags(std::set<midikraft::Tag> const& tags) override;
-		virtual std::set<midikraft::Tag> tags() const override;
+		GenericPatchCapabilityView(GenericPatch *patch) : patch_(patch) {}
+		virtual ~GenericPatchCapabilityView() = default;
+
+		void setName(std::string const &name) override;
+		std::string name() const override;
+		bool isDefaultName(std::string const &patchName) const override;
+		LayerMode layerMode() const override;
+		int numberOfLayers() const override;
+		std::string layerName(int layerNo) const override;
+		void setLayerName(int layerNo, std::string const &layerName) override;
+		bool setTags(std::set<midikraft::Tag> const &tags) override;
+		std::set<midikraft::Tag> tags() const override;
 
 	private:
-		std::weak_ptr<GenericPatch> me_;
+		GenericPatch *patch_;
 	};
 
 	class GenericPatch : public midikraft::DataFile, public midikraft::RuntimeCapability<midikraft::StoredPatchNameCapability>
@@ -83,19 +87,48 @@ namespace knobkraft {
 		};
 
 		GenericPatch(GenericAdaptation const *me, pybind11::module &adaptation_module, midikraft::Synth::PatchData const &data, DataType dataType);
-        virtual ~GenericPatch() = default;
+		virtual ~GenericPatch() override;
+		// The capability view points back to this object, so no copies please
+		GenericPatch(GenericPatch const &) = delete;
+		GenericPatch &operator=(GenericPatch const &) = delete;
+
+		GenericAdaptation const *adaptation() const;
 
 		bool pythonModuleHasFunction(std::string const &functionName) const;
 
+		// Name cache, filled by batch name extraction and cleared whenever we modify the data
+		void setCachedName(std::string const &name);
+		std::optional<std::string> cachedName() const;
+		// MD5 of the patch data, the key into the adaptation's result cache. Safe to call from any thread
+		std::string dataHash() const;
+		// For hashing many patches together, see GenericAdaptation::dataHashes()
+		bool hasDataHash() const;
+		void setDataHash(std::string const &hash) const;
+		// Call this after modifying the data, so no stale name or hash is used
+		void dataChanged();
+
+		// Allocation accounting over the live patches of all adaptations, the object itself plus its data, for the memory report
+		static size_t liveInstances();
+		static size_t liveBytes();
+		// Lookup and store into the adaptation's result cache for this patch
+		bool cachedResult(AdaptationResultCache::Kind kind, int index, std::string &outValue) const;
+		void storeResult(AdaptationResultCache::Kind kind, int index, std::string const &value) const;
+		// The patch data in the form the adaptation asked for, only valid until the data is changed. Requires the GIL.
+		pybind11::object dataToPython() const;
+
 		template <typename ... Args>
 		pybind11::object callMethod(std::string const &methodName, Args& ... args) const {
 			pybind11::gil_scoped_acquire acquire;
 			if (!adaptation_) {
 				return pybind11::none();
 			}
-			if (pybind11::hasattr(*adaptation_, methodName.c_str())) {
+			auto function = me_->pythonFunction(methodName);
+			if (function) {
 				try {
-					auto result = adaptation_.attr(methodName.c_str())(args...);
+					auto start = std::chrono::steady_clock::now();
+					auto result = function(args...);
+					auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+					me_->callProfiler().record(GenericAdaptation::pythonFunctionIndex(methodName), elapsed, (size_t(0) + ... + pythonMarshalledSize(args)), pythonMarshalledSize(result));
 					checkForPythonOutputAndLog();
 					return result;
 				}
@@ -133,13 +166,14 @@ namespace knobkraft {
 		bool hasCapability(midikraft::StoredTagCapability** outCapability) const override;
 
 	private:
-		std::shared_ptr<GenericStoredPatchNameCapability> genericStoredPatchNameCapabilityImpl_;
-		std::shared_ptr<GenericDefaultNameCapability> genericDefaultNameCapabilityImp_;
-		std::shared_ptr<GenericLayeredPatchCapability> genericLayeredPatchCapabilityImpl_;
-		std::shared_ptr<GenericStoredTagCapability> genericStoredTagCapabilityImpl_;
+		mutable GenericPatchCapabilityView capabilityView_;
 
 		GenericAdaptation const *me_;
 		pybind11::module &adaptation_;
+		std::optional<std::string> cachedName_;
+		mutable std::mutex dataHashLock_; // The hash is filled lazily, by whichever thread asks first
+		mutable std::string dataHash_;
+		size_t accountedBytes_; // What this patch added to liveBytes(), updated by dataChanged()
 	};
 
 
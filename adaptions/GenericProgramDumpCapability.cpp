@@ -20,8 +20,7 @@ namespace knobkraft {
 
 	std::shared_ptr<midikraft::DataFile> GenericProgramDumpCapability::patchFromProgramDumpSysex(const std::vector<MidiMessage>& message) const
 	{
-		py::gil_scoped_acquire acquire;
-		// For the Generic Adaptation, this is a nop, as we do not unpack the MidiMessage, but rather store the raw MidiMessage
+		// No Python involved, so no need for the GIL here. For the Generic Adaptation, this is a nop, as we do not unpack the MidiMessage, but rather store the raw MidiMessage
 		midikraft::Synth::PatchData data;
 		for (auto const& m : message) {
 			std::copy(m.getRawData(), m.getRawData() + m.getRawDataSize(), std::back_inserter(data));
@@ -35,8 +34,7 @@ namespace knobkraft {
 		try {
 			int c = me_->channel().toZeroBasedInt();
 			py::object result = me_->callMethod(kCreateProgramDumpRequest, c, patchNo);
-			std::vector<uint8> byteData = GenericAdaptation::intVectorToByteVector(result.cast<std::vector<int>>());
-			return Sysex::vectorToMessages(byteData);
+			return GenericAdaptation::pythonToMessages(result);
 		}
 		catch (py::error_already_set &ex) {
 			me_->logAdaptationError(kCreateProgramDumpRequest, ex);
@@ -50,9 +48,16 @@ namespace knobkraft {
 
 	bool GenericProgramDumpCapability::isSingleProgramDump(const std::vector<MidiMessage>& message) const
 	{
+		if (!me_->sysexPrefilter().acceptsAll(message)) {
+			return false;
+		}
+		bool matches;
+		if (me_->sysexMatchers().evaluate(kIsSingleProgramDump, message, matches)) {
+			return matches;
+		}
 		py::gil_scoped_acquire acquire;
 		try {
-			auto vector = GenericAdaptation::midiMessagesToVector(message);
+			auto vector = me_->messagesToPython(message);
 			py::object result = me_->callMethod(kIsSingleProgramDump, vector);
 			return result.cast<bool>();
 		}
@@ -68,17 +73,24 @@ namespace knobkraft {
 
 	midikraft::ProgramDumpCabability::HandshakeReply GenericProgramDumpCapability::isMessagePartOfProgramDump(const MidiMessage& message) const
 	{
+		if (!me_->sysexPrefilter().accepts(message)) {
+			return { false, {} };
+		}
+		bool matches;
+		if (!me_->pythonModuleHasFunction(kIsPartOfSingleProgramDump) && me_->sysexMatchers().evaluate(kIsSingleProgramDump, message, matches)) {
+			return { matches, {} };
+		}
 		py::gil_scoped_acquire acquire;
 		// This is an optional function that can be implemented for multi message edit buffers like in the DSI Evolver
 		if (me_->pythonModuleHasFunction(kIsPartOfSingleProgramDump)) {
 			try {
-				auto vectorForm = me_->messageToVector(message);
+				auto vectorForm = me_->messageToPython(message);
 				py::object result = me_->callMethod(kIsPartOfSingleProgramDump, vectorForm);
 				if (py::isinstance<py::tuple>(result)) {
 					// The reply is a tuple - let's hope it is a tuple of a bool and a list of MIDI messages as documented
 					auto result_tuple = py::cast<py::tuple>(result);
 					py::object replyBool = result_tuple[0];
-					auto byteData = GenericAdaptation::vectorToMessages(result_tuple[1].cast<std::vector<int>>());
+					auto byteData = GenericAdaptation::pythonToMessages(result_tuple[1]);
 					return { replyBool.cast<bool>(), byteData };
 				}
 				else {
@@ -105,7 +117,7 @@ namespace knobkraft {
 		py::gil_scoped_acquire acquire;
 		if (me_->pythonModuleHasFunction("numberFromDump")) {
 			try {
-				auto vector = GenericAdaptation::midiMessagesToVector(message);
+				auto vector = me_->messagesToPython(message);
 				py::object result = me_->callMethod(kNumberFromDump, vector);
 				return MidiProgramNumber::fromZeroBase(result.cast<int>());
 			}
@@ -125,12 +137,12 @@ namespace knobkraft {
 		py::gil_scoped_acquire acquire;
 		try
 		{
-			auto data = patch->data();
+			auto const &patchData = patch->data();
+			auto data = me_->dataToPython(patchData.data(), patchData.size());
 			int c = me_->channel().toZeroBasedInt();
 			int programNo = programNumber.toZeroBasedWithBank();
 			py::object result = me_->callMethod(kConvertToProgramDump, c, data, programNo);
-			std::vector<uint8> byteData = GenericAdaptation::intVectorToByteVector(result.cast<std::vector<int>>());
-			return Sysex::vectorToMessages(byteData);
+			return GenericAdaptation::pythonToMessages(result);
 		}
 		catch (py::error_already_set &ex) {
 			me_->logAdaptationError(kConvertToProgramDump, ex);
@@ -4,6 +4,11 @@
 #   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
 #
 
+# The same check as isEditBufferDump() below, but evaluated by the Orm without calling Python
+sysexMatchers = {
+    "isEditBufferDump": {"bytes": [(0, 0xf0), (1, 0x42), (2, 0x30, 0xf0), (3, 0x04), (4, 0x40)], "length": (5, None)},
+}
+
 
 def name():
     return "Korg DW-6000"
@@ -0,0 +1,106 @@
+/*
+   Copyright (c) 2020 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "LazyGenericAdaptation.h"
+
+#include "GenericAdaptation.h"
+
+#include <set>
+
+#include <spdlog/spdlog.h>
+#include "SpdLogJuce.h"
+
+namespace knobkraft {
+
+	LazyGenericAdaptation::LazyGenericAdaptation(File const &pythonFile, AdaptationManifestEntry const &manifest) : pythonFile_(pythonFile), manifest_(manifest)
+	{
+	}
+
+	std::shared_ptr<GenericAdaptation> LazyGenericAdaptation::load() const
+	{
+		return AdaptationRegistry::instance()->adaptationForFile(pythonFile_);
+	}
+
+	AdaptationManifestEntry const &LazyGenericAdaptation::manifest() const
+	{
+		return manifest_;
+	}
+
+	std::string LazyGenericAdaptation::getName() const
+	{
+		return manifest_.synthName;
+	}
+
+	std::vector<juce::MidiMessage> LazyGenericAdaptation::deviceDetect(int channel)
+	{
+		auto adaptation = load();
+		return adaptation ? adaptation->deviceDetect(channel) : std::vector<juce::MidiMessage>();
+	}
+
+	int LazyGenericAdaptation::deviceDetectSleepMS()
+	{
+		auto adaptation = load();
+		return adaptation ? adaptation->deviceDetectSleepMS() : 200;
+	}
+
+	MidiChannel LazyGenericAdaptation::channelIfValidDeviceResponse(const MidiMessage &message)
+	{
+		auto adaptation = load();
+		return adaptation ? adaptation->channelIfValidDeviceResponse(message) : MidiChannel::invalidChannel();
+	}
+
+	bool LazyGenericAdaptation::needsChannelSpecificDetection()
+	{
+		auto adaptation = load();
+		return adaptation ? adaptation->needsChannelSpecificDetection() : true;
+	}
+
+	std::vector<std::shared_ptr<midikraft::SimpleDiscoverableDevice>> LazyGenericAdaptation::allAdaptations()
+	{
+		std::vector<std::shared_ptr<midikraft::SimpleDiscoverableDevice>> result;
+		if (!GenericAdaptation::hasPython()) {
+			// This will just log the reason
+			for (auto const &adaptation : GenericAdaptation::allAdaptations()) {
+				result.push_back(adaptation);
+			}
+			return result;
+		}
+
+		// User defined adaptations come first, so they override the built-in ones with the same synth name
+		auto registry = AdaptationRegistry::instance();
+		auto files = AdaptationRegistry::adaptationFilesInDirectory(GenericAdaptation::getAdaptationDirectory());
+		auto installDirectory = File::getSpecialLocation(File::SpecialLocationType::currentExecutableFile).getParentDirectory().getChildFile("adaptations");
+		size_t numberOfUserAdaptations = files.size();
+		for (auto const &f : AdaptationRegistry::adaptationFilesInDirectory(installDirectory)) {
+			files.push_back(f);
+		}
+
+		std::set<std::string> namesSeen;
+		for (size_t i = 0; i < files.size(); i++) {
+			auto manifest = registry->manifestForFile(files[i]);
+			if (!manifest.has_value()) {
+				continue;
+			}
+			if (namesSeen.find(manifest->synthName) != namesSeen.end()) {
+				if (i >= numberOfUserAdaptations) {
+					spdlog::warn("Overriding built-in adaptation {} (found in user directory {})", manifest->synthName, GenericAdaptation::getAdaptationDirectory().getFullPathName().toStdString());
+				}
+				continue;
+			}
+			namesSeen.insert(manifest->synthName);
+			auto loaded = registry->loadedAdaptation(files[i]);
+			if (loaded) {
+				result.push_back(loaded);
+			}
+			else {
+				result.push_back(std::make_shared<LazyGenericAdaptation>(files[i], *manifest));
+			}
+		}
+		registry->saveManifest();
+		return result;
+	}
+
+}
@@ -0,0 +1,47 @@
+/*
+   Copyright (c) 2020 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include "Synth.h"
+
+#include "AdaptationRegistry.h"
+
+namespace knobkraft {
+
+	class GenericAdaptation;
+
+	// Stand-in for an adaptation that has not been imported yet. It knows the name from the manifest, and only
+	// imports the Python module when the adaptation is really needed, i.e. when the synth is activated or detected.
+	class LazyGenericAdaptation : public midikraft::SimpleDiscoverableDevice {
+	public:
+		LazyGenericAdaptation(File const &pythonFile, AdaptationManifestEntry const &manifest);
+		virtual ~LazyGenericAdaptation() override = default;
+
+		// Imports the module on first call. Returns nullptr if the module fails to load
+		std::shared_ptr<GenericAdaptation> load() const;
+		AdaptationManifestEntry const &manifest() const;
+
+		std::string getName() const override;
+
+		// Detection needs the real adaptation, so these will import the module
+		std::vector<juce::MidiMessage> deviceDetect(int channel) override;
+		int deviceDetectSleepMS() override;
+		MidiChannel channelIfValidDeviceResponse(const MidiMessage &message) override;
+		bool needsChannelSpecificDetection() override;
+
+		// Same as GenericAdaptation::allAdaptations(), but only modules that changed since the last session or that are already
+		// loaded are returned as GenericAdaptation, all others are returned as LazyGenericAdaptation
+		static std::vector<std::shared_ptr<midikraft::SimpleDiscoverableDevice>> allAdaptations();
+
+	private:
+		File pythonFile_;
+		AdaptationManifestEntry manifest_;
+	};
+
+}
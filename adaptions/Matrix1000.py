@@ -7,6 +7,12 @@
 # Note that for real life usage the native C++ implementation of the Matrix1000 is more powerful and should be used
 # This is an example adaption to show how a fully working adaption can look like
 
+# The same checks as isEditBufferDump() and isSingleProgramDump() below, but evaluated by the Orm without calling Python
+sysexMatchers = {
+    "isEditBufferDump": {"bytes": [(0, 0xf0), (1, 0x10), (2, 0x06), (3, 0x0d)], "length": (4, None)},
+    "isSingleProgramDump": {"bytes": [(0, 0xf0), (1, 0x10), (2, 0x06), (3, 0x01)], "length": (4, None)},
+}
+
 
 def name():
     return "Matrix 1000 Adaptation"
@@ -0,0 +1,51 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "MessagePacer.h"
+
+#include "MidiController.h"
+#include "Settings.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace knobkraft {
+
+	std::string MessagePacer::settingsKey(std::string const &synthName, juce::MidiDeviceInfo const &port)
+	{
+		return "messageRate:" + synthName + ":" + port.name.toStdString();
+	}
+
+	double MessagePacer::bytesPerSecond(std::string const &synthName, juce::MidiDeviceInfo const &port, double defaultRate)
+	{
+		auto stored = String(Settings::instance().get(settingsKey(synthName, port), "")).getDoubleValue();
+		return stored > 0.0 ? stored : defaultRate;
+	}
+
+	void MessagePacer::setBytesPerSecond(std::string const &synthName, juce::MidiDeviceInfo const &port, double rate)
+	{
+		Settings::instance().set(settingsKey(synthName, port), String(rate).toStdString());
+	}
+
+	int MessagePacer::pauseAfter(size_t bytes, double bytesPerSecond)
+	{
+		double rate = bytesPerSecond > 0.0 ? std::min(bytesPerSecond, kMidiWireBytesPerSecond) : kMidiWireBytesPerSecond;
+		return (int) std::ceil(bytes * 1000.0 / rate);
+	}
+
+	void MessagePacer::sendPaced(juce::MidiDeviceInfo const &port, std::vector<MidiMessage> const &buffer, double bytesPerSecond)
+	{
+		auto output = midikraft::MidiController::instance()->getMidiOutput(port);
+		for (size_t i = 0; i < buffer.size(); i++) {
+			output->sendMessageNow(buffer[i]);
+			// Like generalMessageDelay, there is no need to wait after the last message
+			if (i + 1 < buffer.size()) {
+				Thread::sleep(pauseAfter((size_t) buffer[i].getRawDataSize(), bytesPerSecond));
+			}
+		}
+	}
+
+}
@@ -0,0 +1,38 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include <string>
+#include <vector>
+
+namespace knobkraft {
+
+	// Sends a block of MIDI messages paced by their size instead of with a fixed pause per message. After each message
+	// the pacer waits as long as the synth needs to digest that many bytes at the given rate, but never less than the
+	// message takes on a 31250 baud MIDI cable. The rate can be overridden per synth and output port in the settings,
+	// as the right value depends on the interface as much as on the synth.
+	class MessagePacer {
+	public:
+		// One byte of MIDI is 10 bits on the wire
+		static constexpr double kMidiWireBytesPerSecond = 31250.0 / 10.0;
+
+		// The rate to use for this synth on this port, the one from the settings if set, else the default given
+		static double bytesPerSecond(std::string const &synthName, juce::MidiDeviceInfo const &port, double defaultRate);
+		static void setBytesPerSecond(std::string const &synthName, juce::MidiDeviceInfo const &port, double rate);
+
+		// Milliseconds to wait after sending a message of this size
+		static int pauseAfter(size_t bytes, double bytesPerSecond);
+
+		static void sendPaced(juce::MidiDeviceInfo const &port, std::vector<MidiMessage> const &buffer, double bytesPerSecond);
+
+	private:
+		static std::string settingsKey(std::string const &synthName, juce::MidiDeviceInfo const &port);
+	};
+
+}
@@ -0,0 +1,180 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "MultiBufferMD5.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace knobkraft {
+
+	namespace {
+
+		constexpr uint32 kSines[64] = {
+			0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+			0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+			0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+			0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+			0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+			0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+			0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+			0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391
+		};
+
+		constexpr int kShifts[64] = {
+			7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22,
+			5, 9, 14, 20, 5, 9, 14, 20, 5, 9, 14, 20, 5, 9, 14, 20,
+			4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23,
+			6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21
+		};
+
+		// Number of 64 byte blocks after appending the 0x80 and the 64 bit length
+		size_t paddedBlocks(size_t size) {
+			return (size + 8) / 64 + 1;
+		}
+
+		// Block number block of the padded message, as 16 little endian words
+		void loadBlock(MultiBufferMD5::Buffer const &buffer, size_t block, uint32 *outWords) {
+			uint8 bytes[64];
+			size_t start = block * 64;
+			if (start + 64 <= buffer.size) {
+				std::memcpy(bytes, buffer.data + start, 64);
+			}
+			else {
+				std::memset(bytes, 0, 64);
+				if (start < buffer.size) {
+					std::memcpy(bytes, buffer.data + start, buffer.size - start);
+				}
+				if (start <= buffer.size) {
+					bytes[buffer.size - start] = 0x80;
+				}
+				if (block == paddedBlocks(buffer.size) - 1) {
+					uint64 bits = (uint64) buffer.size * 8;
+					for (int i = 0; i < 8; i++) {
+						bytes[56 + i] = (uint8) (bits >> (8 * i));
+					}
+				}
+			}
+			for (int i = 0; i < 16; i++) {
+				outWords[i] = (uint32) bytes[i * 4] | ((uint32) bytes[i * 4 + 1] << 8) | ((uint32) bytes[i * 4 + 2] << 16) | ((uint32) bytes[i * 4 + 3] << 24);
+			}
+		}
+
+	}
+
+	std::vector<std::string> MultiBufferMD5::hexDigests(std::vector<Buffer> const &buffers)
+	{
+		std::vector<std::string> result(buffers.size());
+		for (size_t start = 0; start < buffers.size(); start += kLanes) {
+			hashGroup(buffers.data() + start, std::min(kLanes, buffers.size() - start), result.data() + start);
+		}
+		return result;
+	}
+
+	void MultiBufferMD5::hashGroup(Buffer const *buffers, size_t count, std::string *outDigests)
+	{
+		// Unused lanes hash an empty buffer, which keeps the round loops free of branches
+		Buffer lanes[kLanes];
+		size_t blocks[kLanes];
+		size_t mostBlocks = 0;
+		for (size_t lane = 0; lane < kLanes; lane++) {
+			lanes[lane] = lane < count ? buffers[lane] : Buffer{ nullptr, 0 };
+			blocks[lane] = paddedBlocks(lanes[lane].size);
+			mostBlocks = std::max(mostBlocks, blocks[lane]);
+		}
+
+		uint32 a[kLanes], b[kLanes], c[kLanes], d[kLanes];
+		std::fill(a, a + kLanes, 0x67452301u);
+		std::fill(b, b + kLanes, 0xefcdab89u);
+		std::fill(c, c + kLanes, 0x98badcfeu);
+		std::fill(d, d + kLanes, 0x10325476u);
+
+		// Word i of all lanes next to each other
+		uint32 words[16][kLanes];
+		uint32 laneWords[16];
+		for (size_t block = 0; block < mostBlocks; block++) {
+			uint32 active[kLanes];
+			for (size_t lane = 0; lane < kLanes; lane++) {
+				active[lane] = block < blocks[lane] ? 0xffffffffu : 0u;
+				if (active[lane]) {
+					loadBlock(lanes[lane], block, laneWords);
+				}
+				else {
+					std::fill(laneWords, laneWords + 16, 0u);
+				}
+				for (int i = 0; i < 16; i++) {
+					words[i][lane] = laneWords[i];
+				}
+			}
+
+			uint32 aa[kLanes], bb[kLanes], cc[kLanes], dd[kLanes];
+			std::copy(a, a + kLanes, aa);
+			std::copy(b, b + kLanes, bb);
+			std::copy(c, c + kLanes, cc);
+			std::copy(d, d + kLanes, dd);
+			for (int i = 0; i < 64; i++) {
+				int word;
+				if (i < 16) {
+					word = i;
+				}
+				else if (i < 32) {
+					word = (5 * i + 1) % 16;
+				}
+				else if (i < 48) {
+					word = (3 * i + 5) % 16;
+				}
+				else {
+					word = (7 * i) % 16;
+				}
+				int shift = kShifts[i];
+				uint32 sine = kSines[i];
+				// The same operation for every lane, this is the loop that gets vectorized
+				for (size_t lane = 0; lane < kLanes; lane++) {
+					uint32 f;
+					if (i < 16) {
+						f = (bb[lane] & cc[lane]) | (~bb[lane] & dd[lane]);
+					}
+					else if (i < 32) {
+						f = (dd[lane] & bb[lane]) | (~dd[lane] & cc[lane]);
+					}
+					else if (i < 48) {
+						f = bb[lane] ^ cc[lane] ^ dd[lane];
+					}
+					else {
+						f = cc[lane] ^ (bb[lane] | ~dd[lane]);
+					}
+					uint32 sum = aa[lane] + f + sine + words[word][lane];
+					aa[lane] = dd[lane];
+					dd[lane] = cc[lane];
+					cc[lane] = bb[lane];
+					bb[lane] = bb[lane] + ((sum << shift) | (sum >> (32 - shift)));
+				}
+			}
+			// Lanes already done keep their state
+			for (size_t lane = 0; lane < kLanes; lane++) {
+				a[lane] += aa[lane] & active[lane];
+				b[lane] += bb[lane] & active[lane];
+				c[lane] += cc[lane] & active[lane];
+				d[lane] += dd[lane] & active[lane];
+			}
+		}
+
+		static char const *kHex = "0123456789abcdef";
+		for (size_t lane = 0; lane < count; lane++) {
+			std::string digest;
+			digest.reserve(32);
+			for (uint32 word : { a[lane], b[lane], c[lane], d[lane] }) {
+				for (int i = 0; i < 4; i++) {
+					uint8 byte = (uint8) (word >> (8 * i));
+					digest.push_back(kHex[byte >> 4]);
+					digest.push_back(kHex[byte & 0x0f]);
+				}
+			}
+			outDigests[lane] = digest;
+		}
+	}
+
+}
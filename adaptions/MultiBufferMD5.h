@@ -0,0 +1,35 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include <string>
+#include <vector>
+
+namespace knobkraft {
+
+	// MD5 of many buffers at once, giving the same hex digests as juce::MD5. The buffers are hashed in groups of kLanes,
+	// with the state of each buffer in its own slot of small arrays, so the compiler can run the rounds of all lanes in one
+	// go with SIMD instructions. Buffers of different length can be mixed, a lane that is done idles until its group is.
+	// For a single buffer use juce::MD5, this only pays off for batches
+	class MultiBufferMD5 {
+	public:
+		struct Buffer {
+			uint8 const *data;
+			size_t size;
+		};
+
+		static constexpr size_t kLanes = 8;
+
+		static std::vector<std::string> hexDigests(std::vector<Buffer> const &buffers);
+
+	private:
+		static void hashGroup(Buffer const *buffers, size_t count, std::string *outDigests);
+	};
+
+}
@@ -0,0 +1,94 @@
+/*
+   Copyright (c) 2022 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "NativeSysexModule.h"
+
+#include "SysexCodecs.h"
+
+#include <pybind11/embed.h>
+#include <pybind11/stl.h>
+
+#include <algorithm>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace py = pybind11;
+
+namespace knobkraft {
+
+	const char *nativeSysexModuleName()
+	{
+		return "knobkraft_native";
+	}
+
+	// These are the same algorithms as in knobkraft/sysex.py, roland/GenericRoland.py and sequential/GenericSequential.py,
+	// which use them transparently when running inside the Orm
+
+	static std::vector<int> unescapeSysexDSI(std::vector<int> const &sysex)
+	{
+		// 1 byte of most significant bits followed by up to 7 bytes of 7 bit data
+		std::vector<uint8_t> packed(sysex.begin(), sysex.end());
+		std::vector<uint8_t> data(midikraft::SysexCodecs::msbFirstUnpackedSize(packed.size()));
+		midikraft::SysexCodecs::unpackMsbFirst(packed.data(), packed.size(), data.data());
+		return std::vector<int>(data.begin(), data.end());
+	}
+
+	static std::vector<int> escapeSysexDSI(std::vector<int> const &data)
+	{
+		std::vector<uint8_t> unpacked(data.size());
+		std::transform(data.begin(), data.end(), unpacked.begin(), [](int value) { return (uint8_t)(value & 0xff); });
+		std::vector<uint8_t> packed(midikraft::SysexCodecs::msbFirstPackedSize(unpacked.size()));
+		midikraft::SysexCodecs::packMsbFirst(unpacked.data(), unpacked.size(), packed.data());
+		return std::vector<int>(packed.begin(), packed.end());
+	}
+
+	static int rolandChecksum(std::vector<int> const &dataBlock)
+	{
+		int sum = 0;
+		for (auto value : dataBlock) {
+			sum -= value;
+		}
+		return sum & 0x7f;
+	}
+
+	static std::vector<std::pair<size_t, size_t>> findSysexDelimiters(std::vector<int> const &messages, std::optional<size_t> maxNo)
+	{
+		std::vector<std::pair<size_t, size_t>> result;
+		size_t start = 0;
+		for (size_t read = 0; read < messages.size(); read++) {
+			if (messages[read] == 0xf0) {
+				start = read;
+			}
+			else if (messages[read] == 0xf7) {
+				result.emplace_back(start, read + 1);
+				if (maxNo.has_value() && result.size() >= *maxNo) {
+					break;
+				}
+			}
+		}
+		return result;
+	}
+
+	static std::vector<std::vector<int>> splitSysexMessage(std::vector<int> const &messages)
+	{
+		std::vector<std::vector<int>> result;
+		for (auto const &delimiters : findSysexDelimiters(messages, std::nullopt)) {
+			result.emplace_back(messages.begin() + (std::ptrdiff_t) delimiters.first, messages.begin() + (std::ptrdiff_t) delimiters.second);
+		}
+		return result;
+	}
+
+}
+
+PYBIND11_EMBEDDED_MODULE(knobkraft_native, m) {
+	m.doc() = "Native implementations of the sysex helpers of the knobkraft package, only available inside the KnobKraft Orm";
+	m.def("unescape_sysex_dsi", &knobkraft::unescapeSysexDSI, "Convert DSI style packed 7 bit data back to 8 bit");
+	m.def("escape_sysex_dsi", &knobkraft::escapeSysexDSI, "Pack 8 bit data into DSI style 7 bit data");
+	m.def("roland_checksum", &knobkraft::rolandChecksum, "Roland checksum over the data block");
+	m.def("find_sysex_delimiters", &knobkraft::findSysexDelimiters, "Find start and end index of all sysex messages", py::arg("messages"), py::arg("max_no") = py::none());
+	m.def("split_sysex_message", &knobkraft::splitSysexMessage, "Split a list of bytes into a list of sysex messages");
+}
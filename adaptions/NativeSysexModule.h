@@ -0,0 +1,15 @@
+/*
+   Copyright (c) 2022 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+namespace knobkraft {
+
+	// The native helpers are registered as the embedded Python module knobkraft_native. Calling this makes sure the
+	// linker keeps the registration when linking the static library
+	const char *nativeSysexModuleName();
+
+}
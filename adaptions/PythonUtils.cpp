@@ -9,13 +9,73 @@
 #include "Logger.h"
 #include "I18NHelper.h"
 
+#include <pybind11/embed.h>
+
+#include <algorithm>
+
+#include <fmt/format.h>
 #include <spdlog/spdlog.h>
 
 namespace py = pybind11;
 
-PyStdErrOutStreamRedirect::PyStdErrOutStreamRedirect()
+PYBIND11_EMBEDDED_MODULE(knobkraft_output, m) {
+	py::class_<PythonOutputBuffer, std::shared_ptr<PythonOutputBuffer>>(m, "OutputBuffer")
+		.def("write", &PythonOutputBuffer::write)
+		.def("flush", [](PythonOutputBuffer &) {})
+		.def("isatty", [](PythonOutputBuffer &) { return false; })
+		.def_property_readonly("encoding", [](PythonOutputBuffer &) { return "utf-8"; });
+}
+
+size_t PythonOutputBuffer::write(std::string const &text)
+{
+	size_t written = written_.load(std::memory_order_relaxed);
+	size_t space = kCapacity - (written - read_.load(std::memory_order_acquire));
+	size_t toCopy = std::min(space, text.size());
+	for (size_t i = 0; i < toCopy; i++) {
+		ring_[(written + i) % kCapacity] = text[i];
+	}
+	if (toCopy < text.size()) {
+		// Nobody picked up the output for a long time, drop the rest instead of blocking Python
+		lost_.fetch_add(text.size() - toCopy, std::memory_order_relaxed);
+	}
+	written_.store(written + toCopy, std::memory_order_release);
+	return text.size();
+}
+
+bool PythonOutputBuffer::hasOutput() const
+{
+	return written_.load(std::memory_order_acquire) != read_.load(std::memory_order_relaxed) || lost_.load(std::memory_order_relaxed) != 0;
+}
+
+std::string PythonOutputBuffer::take()
+{
+	size_t read = read_.load(std::memory_order_relaxed);
+	size_t written = written_.load(std::memory_order_acquire);
+	std::string result;
+	result.reserve(written - read);
+	for (size_t i = read; i < written; i++) {
+		result.push_back(ring_[i % kCapacity]);
+	}
+	read_.store(written, std::memory_order_release);
+	size_t lost = lost_.exchange(0, std::memory_order_relaxed);
+	if (lost > 0) {
+		result += fmt::format("\n[{} characters of output lost]", lost);
+	}
+	return result;
+}
+
+PyStdErrOutStreamRedirect::PyStdErrOutStreamRedirect() : stdoutBuffer_(std::make_shared<PythonOutputBuffer>()), stderrBuffer_(std::make_shared<PythonOutputBuffer>())
 {
-	clear();
+	py::gil_scoped_acquire acquire;
+	// Importing the embedded module registers the OutputBuffer type
+	py::module::import("knobkraft_output");
+	auto sysm = py::module::import("sys");
+	_stdout = sysm.attr("stdout");
+	_stderr = sysm.attr("stderr");
+	_stdout_buffer = py::cast(stdoutBuffer_);
+	_stderr_buffer = py::cast(stderrBuffer_);
+	sysm.attr("stdout") = _stdout_buffer;
+	sysm.attr("stderr") = _stderr_buffer;
 }
 
 PyStdErrOutStreamRedirect::~PyStdErrOutStreamRedirect()
@@ -28,42 +88,34 @@ PyStdErrOutStreamRedirect::~PyStdErrOutStreamRedirect()
 
 std::string PyStdErrOutStreamRedirect::stdoutString()
 {
-	py::gil_scoped_acquire acquire;
-	_stdout_buffer.attr("seek")(0);
-	return py::str(_stdout_buffer.attr("read")());
+	return stdoutBuffer_->take();
 }
 
 std::string PyStdErrOutStreamRedirect::stderrString()
 {
-	py::gil_scoped_acquire acquire;
-	_stderr_buffer.attr("seek")(0);
-	return py::str(_stderr_buffer.attr("read")());
+	return stderrBuffer_->take();
 }
 
 void PyStdErrOutStreamRedirect::clear()
 {	
-	py::gil_scoped_acquire acquire;
-	auto sysm = py::module::import("sys");
-	_stdout = sysm.attr("stdout");
-	_stderr = sysm.attr("stderr");
-	auto stringio = py::module::import("io").attr("StringIO");
-	_stdout_buffer = stringio();  // Other file like object can be used here as well, such as objects created by pybind11
-	_stderr_buffer = stringio();
-	sysm.attr("stdout") = _stdout_buffer;
-	sysm.attr("stderr") = _stderr_buffer;
+	stdoutBuffer_->take();
+	stderrBuffer_->take();
 }
 
 void PyStdErrOutStreamRedirect::flushToLogger(std::string const &logDomain)
 {
-	auto error = stderrString();
-	if (!error.empty()) {
-		spdlog::error("{}: {}", logDomain , error);
+	// This runs after every call into Python, so the common case of no output at all must not touch Python
+	if (stderrBuffer_->hasOutput()) {
+		auto error = stderrBuffer_->take();
+		if (!error.empty()) {
+			spdlog::error("{}: {}", logDomain, error);
+		}
 	}
-	auto output = stdoutString();
-	if (!output.empty()) {
+	if (stdoutBuffer_->hasOutput()) {
+		auto output = stdoutBuffer_->take();
 		string_trim_right(output);
-		spdlog::info("{}: {}", logDomain, output);
+		if (!output.empty()) {
+			spdlog::info("{}: {}", logDomain, output);
+		}
 	}
-	clear();
 }
-
@@ -6,6 +6,9 @@
 
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <memory>
 #include <string>
 #include <pybind11/pybind11.h>
 
@@ -17,6 +20,23 @@
 #endif
 #endif
 
+// File like object implemented in C++ that replaces sys.stdout or sys.stderr. Python calls write() with the GIL held,
+// so there is only ever one writer, and the reader can check for output with an atomic load without calling into Python
+class PythonOutputBuffer {
+public:
+	static constexpr size_t kCapacity = 65536;
+
+	size_t write(std::string const &text);
+	bool hasOutput() const;
+	std::string take();
+
+private:
+	std::array<char, kCapacity> ring_{};
+	std::atomic<size_t> written_{ 0 };
+	std::atomic<size_t> read_{ 0 };
+	std::atomic<size_t> lost_{ 0 };
+};
+
 class PyStdErrOutStreamRedirect {
 public:
 	PyStdErrOutStreamRedirect();
@@ -29,6 +49,8 @@ public:
 	void flushToLogger(std::string const &logDomain);
 
 private:
+	std::shared_ptr<PythonOutputBuffer> stdoutBuffer_;
+	std::shared_ptr<PythonOutputBuffer> stderrBuffer_;
 	pybind11::object _stdout DEFAULT_VISIBILITY;
 	pybind11::object _stderr DEFAULT_VISIBILITY;
 	pybind11::object _stdout_buffer DEFAULT_VISIBILITY;
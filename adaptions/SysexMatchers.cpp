@@ -0,0 +1,61 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "SysexMatchers.h"
+
+namespace knobkraft {
+
+	bool SysexMatchers::Declaration::matches(uint8 const *data, size_t size) const
+	{
+		if (size < minLength || size > maxLength) {
+			return false;
+		}
+		for (auto const &condition : bytes) {
+			if (condition.offset >= size || (data[condition.offset] & condition.mask) != condition.value) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	void SysexMatchers::setDeclarations(std::map<std::string, Declaration> const &declarations)
+	{
+		std::atomic_store(&declarations_, declarations.empty() ? std::shared_ptr<TDeclarations>() : std::make_shared<TDeclarations>(declarations));
+	}
+
+	bool SysexMatchers::isDeclared(std::string const &functionName) const
+	{
+		auto declarations = std::atomic_load(&declarations_);
+		return declarations && declarations->find(functionName) != declarations->end();
+	}
+
+	bool SysexMatchers::evaluate(std::string const &functionName, MidiMessage const &message, bool &outMatches) const
+	{
+		auto declarations = std::atomic_load(&declarations_);
+		if (!declarations) {
+			return false;
+		}
+		auto found = declarations->find(functionName);
+		if (found == declarations->end()) {
+			return false;
+		}
+		outMatches = found->second.matches(message.getRawData(), (size_t) message.getRawDataSize());
+		return true;
+	}
+
+	bool SysexMatchers::evaluate(std::string const &functionName, std::vector<MidiMessage> const &messages, bool &outMatches) const
+	{
+		if (messages.size() == 1) {
+			return evaluate(functionName, messages[0], outMatches);
+		}
+		if (!isDeclared(functionName)) {
+			return false;
+		}
+		outMatches = false;
+		return true;
+	}
+
+}
@@ -0,0 +1,51 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include <limits>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace knobkraft {
+
+	// Predicates like isEditBufferDump() are most often just a comparison of a few header bytes and the length. Adaptations can
+	// declare them as data, and these are then evaluated here without going to Python at all.
+	// Like the SysexPrefilter, the declarations are replaced as a whole when the module is (re)loaded, and can be read from any thread.
+	class SysexMatchers {
+	public:
+		struct ByteCondition {
+			size_t offset; // Index into the complete message, i.e. the 0xf0 is at offset 0
+			uint8 value;
+			uint8 mask; // The byte is and-ed with the mask before comparing, e.g. to ignore the channel in the lower nibble
+		};
+
+		struct Declaration {
+			std::vector<ByteCondition> bytes;
+			size_t minLength = 0;
+			size_t maxLength = std::numeric_limits<size_t>::max();
+
+			bool matches(uint8 const *data, size_t size) const;
+		};
+
+		void setDeclarations(std::map<std::string, Declaration> const &declarations);
+		bool isDeclared(std::string const &functionName) const;
+
+		// Return false if the function has no declaration and Python needs to be asked, else the result is in outMatches.
+		// Declarations describe single messages, so a list of several messages never matches
+		bool evaluate(std::string const &functionName, MidiMessage const &message, bool &outMatches) const;
+		bool evaluate(std::string const &functionName, std::vector<MidiMessage> const &messages, bool &outMatches) const;
+
+	private:
+		typedef std::map<std::string, Declaration> TDeclarations;
+		std::shared_ptr<TDeclarations> declarations_; // Only accessed with std::atomic_load and std::atomic_store
+	};
+
+}
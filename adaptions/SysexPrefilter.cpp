@@ -0,0 +1,74 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "SysexPrefilter.h"
+
+namespace knobkraft {
+
+	void SysexPrefilter::setHeaders(std::vector<THeader> const &headers)
+	{
+		std::atomic_store(&headers_, headers.empty() ? std::shared_ptr<std::vector<THeader>>() : std::make_shared<std::vector<THeader>>(headers));
+	}
+
+	void SysexPrefilter::clear()
+	{
+		std::atomic_store(&headers_, std::shared_ptr<std::vector<THeader>>());
+	}
+
+	bool SysexPrefilter::isDeclared() const
+	{
+		return std::atomic_load(&headers_) != nullptr;
+	}
+
+	std::vector<SysexPrefilter::THeader> SysexPrefilter::headers() const
+	{
+		auto headers = std::atomic_load(&headers_);
+		return headers ? *headers : std::vector<THeader>();
+	}
+
+	bool SysexPrefilter::matches(THeader const &header, uint8 const *data, int size)
+	{
+		if ((size_t) size < header.size()) {
+			return false;
+		}
+		for (size_t i = 0; i < header.size(); i++) {
+			if (header[i] != kAnyByte && header[i] != data[i]) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool SysexPrefilter::accepts(MidiMessage const &message) const
+	{
+		auto headers = std::atomic_load(&headers_);
+		if (!headers) {
+			return true;
+		}
+		if (!message.isSysEx()) {
+			return false;
+		}
+		auto data = message.getSysExData();
+		auto size = message.getSysExDataSize();
+		for (auto const &header : *headers) {
+			if (matches(header, data, size)) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	bool SysexPrefilter::acceptsAll(std::vector<MidiMessage> const &messages) const
+	{
+		for (auto const &message : messages) {
+			if (!accepts(message)) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+}
@@ -0,0 +1,43 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include <memory>
+#include <vector>
+
+namespace knobkraft {
+
+	// The declared sysex headers of an adaptation, e.g. manufacturer and model ID. Incoming messages that match none of them
+	// can't belong to the adaptation, so they are rejected without taking the GIL and calling into Python.
+	// The headers are replaced on the message thread when the module is (re)loaded, while the MIDI threads keep checking
+	// against the previous set, so accepts() neither locks nor allocates.
+	class SysexPrefilter {
+	public:
+		static constexpr int kAnyByte = -1;
+
+		// Each header is the list of bytes following the 0xf0, kAnyByte matches every value, e.g. a device ID
+		typedef std::vector<int> THeader;
+
+		void setHeaders(std::vector<THeader> const &headers);
+		void clear();
+		bool isDeclared() const;
+		// A copy of the headers declared, empty if none are
+		std::vector<THeader> headers() const;
+
+		// True if no headers are declared, or the message is sysex and starts with one of them
+		bool accepts(MidiMessage const &message) const;
+		bool acceptsAll(std::vector<MidiMessage> const &messages) const;
+
+	private:
+		static bool matches(THeader const &header, uint8 const *data, int size);
+
+		std::shared_ptr<std::vector<THeader>> headers_; // Only accessed with std::atomic_load and std::atomic_store, null if not declared
+	};
+
+}
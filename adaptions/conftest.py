@@ -5,9 +5,14 @@
 #
 
 import importlib.util
+import json
 import os
+import statistics
 import sys
 
+# An adaptation function this many times slower than the median of all adaptations is reported
+SLOWDOWN_FLAGGED = 100.0
+
 
 def load_adaptation(adaptation_file):
     # Dynamically load the adaptation and create the generic test suite all adaptations must undergo
@@ -21,6 +26,59 @@ def load_adaptation(adaptation_file):
 def pytest_addoption(parser):
     parser.addoption("--all", action="store_true", help="run all combinations")
     parser.addoption("--adaptation", help="specify adaptation to test")
+    parser.addoption("--benchmark", action="store_true", help="time the adaptation functions over their test data")
+    parser.addoption("--benchmark-report", default="adaptation_benchmark.json", help="file the benchmark report is written to")
+    parser.addoption("--record-sessions", help="directory test_transfer.py writes the MIDI sessions with the virtual synths to")
+
+
+def pytest_configure(config):
+    # Filled by test_performance.py, adaptation name -> function -> timing
+    config.benchmark_results = {}
+    # Filled by test_transfer.py, adaptation name -> transfer -> simulated seconds and bytes
+    config.transfer_results = {}
+
+
+def benchmark_report(results):
+    # Compare each function against the median speed of the same function over all adaptations
+    medians = {}
+    for function in {function for timings in results.values() for function in timings}:
+        speeds = [timings[function]["ops_per_second"] for timings in results.values() if "ops_per_second" in timings.get(function, {})]
+        if speeds:
+            medians[function] = statistics.median(speeds)
+    flagged = []
+    for name, timings in sorted(results.items()):
+        for function, timing in timings.items():
+            if "ops_per_second" not in timing:
+                continue
+            slowdown = medians[function] / timing["ops_per_second"] if timing["ops_per_second"] > 0 else float("inf")
+            timing["slowdown_to_median"] = slowdown
+            if slowdown >= SLOWDOWN_FLAGGED:
+                flagged.append({"adaptation": name, "function": function, "slowdown_to_median": slowdown})
+    return {"median_ops_per_second": medians, "adaptations": results, "flagged": flagged}
+
+
+def pytest_terminal_summary(terminalreporter, config):
+    if not config.getoption("benchmark") or not (config.benchmark_results or config.transfer_results):
+        return
+    report = benchmark_report(config.benchmark_results)
+    report["transfers"] = config.transfer_results
+    with open(config.getoption("benchmark_report"), "w") as report_file:
+        json.dump(report, report_file, indent=2)
+    terminalreporter.section("adaptation benchmark")
+    for name, timings in sorted(report["adaptations"].items()):
+        for function, timing in sorted(timings.items()):
+            if "error" in timing:
+                terminalreporter.write_line(f"{name:40} {function:24} failed: {timing['error']}", red=True)
+                continue
+            terminalreporter.write_line(f"{name:40} {function:24} {timing['ops_per_second']:12.0f} ops/s {timing['bytes_per_second'] / 1024:10.0f} kB/s")
+    for entry in report["flagged"]:
+        terminalreporter.write_line(f"SLOW: {entry['adaptation']} {entry['function']} is {entry['slowdown_to_median']:.0f} times slower than the median", red=True)
+    if config.transfer_results:
+        terminalreporter.section("transfer benchmark, simulated MIDI link")
+        for name, transfers in sorted(config.transfer_results.items()):
+            for transfer, timing in sorted(transfers.items()):
+                terminalreporter.write_line(f"{name:40} {transfer:28} {timing['seconds'] * 1000:10.1f} ms {timing['bytes']:10} bytes")
+    terminalreporter.write_line(f"Report written to {config.getoption('benchmark_report')}")
 
 
 def pytest_generate_tests(metafunc):
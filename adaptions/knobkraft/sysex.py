@@ -6,6 +6,13 @@
 from typing import List, Tuple
 import binascii
 
+try:
+    # When running inside the KnobKraft Orm, native implementations of the hot helpers are available.
+    # Outside, e.g. when running pytest, the pure Python implementations below are used
+    import knobkraft_native as native_sysex
+except ImportError:
+    native_sysex = None
+
 def load_sysex(filename, as_single_list=False):
     with open(filename, mode="rb") as midi_messages:
         content = midi_messages.read()
@@ -21,6 +28,8 @@ def load_sysex(filename, as_single_list=False):
 
 
 def splitSysexMessage(messages):
+    if native_sysex is not None and isinstance(messages, list):
+        return native_sysex.split_sysex_message(messages)
     result = []
     start = 0
     for read in range(len(messages)):
@@ -36,6 +45,8 @@ def stringToSyx(string):
 
 
 def findSysexDelimiters(messages, max_no=None) -> List[Tuple[int, int]]:
+    if native_sysex is not None and isinstance(messages, list):
+        return native_sysex.find_sysex_delimiters(messages, max_no)
     result = []
     start = 0
     for read in range(len(messages)):
@@ -70,6 +81,8 @@ def splitSysex(byte_list):
 
 def unescapeSysex_deepmind(sysex):
     # This implements the algorithm defined on page 141 of the Deepmind user manual. I think it is the same as DSI uses
+    if native_sysex is not None and isinstance(sysex, list):
+        return native_sysex.unescape_sysex_dsi(sysex)
     result = []
     dataIndex = 0
     while dataIndex < len(sysex):
@@ -83,3 +96,45 @@ def unescapeSysex_deepmind(sysex):
 
 
 
+
+
+def matchesSysexDeclaration(declaration, message) -> bool:
+    # The same evaluation of a declaration in the sysexMatchers module attribute as done by the Orm, for testing
+    length = declaration.get("length")
+    if isinstance(length, int):
+        if len(message) != length:
+            return False
+    elif length is not None:
+        if (length[0] is not None and len(message) < length[0]) or (length[1] is not None and len(message) > length[1]):
+            return False
+    for condition in declaration.get("bytes", []):
+        offset, value = condition[0], condition[1]
+        mask = condition[2] if len(condition) == 3 else 0xff
+        if offset >= len(message) or (message[offset] & mask) != (value & mask):
+            return False
+    return True
+
+
+def extractPatchesByLayout(layout, message):
+    # The same cutting of a bank message along the bankDumpLayout module attribute as done by the Orm, for testing
+    header = layout["header"]
+    stride = layout["stride"]
+    trailer = layout.get("trailer", 1)
+    suffix = list(layout.get("suffix", [0xf7]))
+    prefix = []
+    for entry in layout.get("prefix", []):
+        if isinstance(entry, int):
+            prefix.append(entry)
+        else:
+            # (offset, mask) copies a byte of the bank message, e.g. the channel
+            mask = entry[1] if len(entry) > 1 else 0xff
+            prefix.append(message[entry[0]] & mask)
+    available = (len(message) - header - trailer) // stride if len(message) >= header + trailer else 0
+    count = layout.get("count", available)
+    if count > available:
+        return None
+    result = []
+    for i in range(count):
+        start = header + i * stride
+        result += prefix + list(message[start:start + stride]) + suffix
+    return result
@@ -0,0 +1,120 @@
+#
+#   Copyright (c) 2022 Christof Ruch. All rights reserved.
+#
+#   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+#
+import json
+from typing import Dict, List, Tuple
+
+from .sysex import stringToSyx
+
+
+class MidiLink:
+    """Timing of a MIDI connection. A DIN cable runs at 31250 baud with 10 bits per byte, USB MIDI devices are often
+    throttled to the same rate by the synth. The latency is the time the synth needs before it starts answering a request"""
+
+    def __init__(self, baud=31250, latency_ms=20.0):
+        self.baud = baud
+        self.latency_ms = latency_ms
+
+    def wire_seconds(self, message) -> float:
+        return len(message) * 10.0 / self.baud
+
+    def latency_seconds(self) -> float:
+        return self.latency_ms / 1000.0
+
+    def to_dict(self):
+        return {"baud": self.baud, "latency_ms": self.latency_ms}
+
+
+class VirtualSynth:
+    """Stands in for a synth on a MIDI in/out pair. It answers the requests it knows with the replies it was given, and
+    ignores everything else, like a real synth would. Time is simulated, so a transfer takes the same number of seconds
+    on every run and machine. Both directions of the link are modelled separately: a request is only received when all
+    bytes sent before it went over the wire, and the replies queue up on the way back.
+
+    All traffic is recorded, session() returns it in the format from_session() replays."""
+
+    def __init__(self, name, replies: Dict[Tuple[int, ...], List[List[int]]], link=None):
+        self.name = name
+        self.replies = replies
+        self.link = link if link is not None else MidiLink()
+        self.now = 0.0
+        self.to_synth_free = 0.0
+        self.from_synth_free = 0.0
+        self.events = []
+
+    @staticmethod
+    def from_test_data(adaptation, test_data, link=None):
+        """Answers detection, edit buffer, program and bank requests with the fixtures from the test_data() of the adaptation"""
+        replies = {}
+        if hasattr(test_data, "detection_reply") and hasattr(adaptation, "createDeviceDetectMessage"):
+            # Only the detect message of its own channel is answered
+            channel_specific = adaptation.needsChannelSpecificDetection() if hasattr(adaptation, "needsChannelSpecificDetection") else True
+            detect_channel = test_data.detection_reply[1] if channel_specific else 0
+            replies[tuple(adaptation.createDeviceDetectMessage(detect_channel))] = [test_data.detection_reply[0]]
+        if "device_detect_call" in test_data.test_dict and "device_detect_reply" in test_data.test_dict:
+            replies[tuple(stringToSyx(test_data.test_dict["device_detect_call"]))] = [stringToSyx(test_data.test_dict["device_detect_reply"])]
+        # The other requests are answered for channel 0, like test_adaptations.py uses for them
+        channel = 0
+        programs = test_data.programs if hasattr(test_data, "programs") else []
+        if hasattr(adaptation, "createProgramDumpRequest"):
+            for program in programs:
+                if "number" in program and not program.get("is_edit_buffer", False):
+                    replies[tuple(adaptation.createProgramDumpRequest(channel, program["number"]))] = [program["message"]]
+        if hasattr(adaptation, "createEditBufferRequest"):
+            edit_buffers = [program["message"] for program in programs if hasattr(adaptation, "isEditBufferDump") and adaptation.isEditBufferDump(program["message"])]
+            if edit_buffers:
+                replies[tuple(adaptation.createEditBufferRequest(channel))] = [edit_buffers[0]]
+        if hasattr(adaptation, "createBankDumpRequest") and hasattr(adaptation, "isPartOfBankDump"):
+            bank = [message for message in test_data.all_messages if adaptation.isPartOfBankDump(message)]
+            if bank:
+                replies[tuple(adaptation.createBankDumpRequest(channel, 0))] = bank
+        return VirtualSynth(adaptation.name(), replies, link)
+
+    @staticmethod
+    def from_session(filename):
+        """Replays a recorded session. Each message sent to the synth is answered with the messages that came back
+        before the next one was sent"""
+        with open(filename) as session_file:
+            session = json.load(session_file)
+        replies = {}
+        request = None
+        for event in session["events"]:
+            message = stringToSyx(event["message"])
+            if event["direction"] == "to_synth":
+                request = tuple(message)
+                replies.setdefault(request, [])
+            elif request is not None:
+                replies[request].append(message)
+        link = MidiLink(**session["link"]) if "link" in session else None
+        return VirtualSynth(session.get("name", filename), {request: answer for request, answer in replies.items() if answer}, link)
+
+    def advance_to(self, time):
+        self.now = max(self.now, time)
+
+    def send(self, message) -> List[Tuple[float, List[int]]]:
+        """Sends a message now, and returns the replies with the time their last byte arrives"""
+        start = max(self.now, self.to_synth_free)
+        received = start + self.link.wire_seconds(message)
+        self.to_synth_free = received
+        self._record(start, "to_synth", message)
+        result = []
+        answer_start = max(received + self.link.latency_seconds(), self.from_synth_free)
+        for reply in self.replies.get(tuple(message), []):
+            self._record(answer_start, "from_synth", reply)
+            answer_start += self.link.wire_seconds(reply)
+            result.append((answer_start, reply))
+        if result:
+            self.from_synth_free = answer_start
+        return result
+
+    def session(self):
+        return {"name": self.name, "link": self.link.to_dict(), "events": self.events}
+
+    def save_session(self, filename):
+        with open(filename, "w") as session_file:
+            json.dump(self.session(), session_file, indent=1)
+
+    def _record(self, time, direction, message):
+        self.events.append({"time": time, "direction": direction, "message": bytes(message).hex(" ")})
@@ -254,6 +254,8 @@ class GenericRoland:
 
     @staticmethod
     def roland_checksum(data_block) -> int:
+        if knobkraft.native_sysex is not None and isinstance(data_block, list):
+            return knobkraft.native_sysex.roland_checksum(data_block)
         return sum([-x for x in data_block]) & 0x7f
 
     @knobkraft_api
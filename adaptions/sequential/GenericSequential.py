@@ -5,6 +5,8 @@
 #
 import hashlib
 
+import knobkraft
+
 
 # Documenting the Sequential/DSI device_IDs here for all sequential modules
 #
@@ -229,6 +231,8 @@ class GenericSequential:
 
     @staticmethod
     def unescapeSysex(sysex):
+        if knobkraft.native_sysex is not None and isinstance(sysex, list):
+            return knobkraft.native_sysex.unescape_sysex_dsi(sysex)
         result = []
         dataIndex = 0
         while dataIndex < len(sysex):
@@ -242,6 +246,8 @@ class GenericSequential:
 
     @staticmethod
     def escapeSysex(data):
+        if knobkraft.native_sysex is not None and isinstance(data, list):
+            return knobkraft.native_sysex.escape_sysex_dsi(data)
         result = []
         dataIndex = 0
         while dataIndex < len(data):
@@ -0,0 +1,31 @@
+#
+#   Copyright (c) 2022 Christof Ruch. All rights reserved.
+#
+#   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+#
+import ElectraOne
+
+
+def test_upload_sends_compact_json():
+    with open("testData/elektraOne-demo-preset.syx", mode="rb") as preset:
+        content = list(preset.read())
+    compact = ElectraOne.convertToEditBuffer(0, content)
+    assert ElectraOne.isEditBufferDump(compact)
+    assert len(compact) <= len(content)
+    assert ElectraOne.presetToJson(compact) == ElectraOne.presetToJson(content)
+    assert all(byte < 0x80 for byte in compact[1:-1])
+
+
+def test_corrupted_preset_is_sent_unchanged():
+    with open("testData/elektraOne-corrupted-preset.syx", mode="rb") as preset:
+        content = list(preset.read())
+    assert ElectraOne.convertToEditBuffer(0, content) == content
+
+
+def test_upload_acknowledgement():
+    assert ElectraOne.isUploadAcknowledgement([0xf0, 0x00, 0x21, 0x45, 0x7e, 0x01, 0x00, 0x00, 0xf7]) is True
+    assert ElectraOne.isUploadAcknowledgement([0xf0, 0x00, 0x21, 0x45, 0x7e, 0x00, 0x00, 0x00, 0xf7]) is False
+    # Event messages share the response prefix, but neither acknowledge nor refuse the upload
+    assert ElectraOne.isUploadAcknowledgement([0xf0, 0x00, 0x21, 0x45, 0x7e, 0x06, 0x00, 0x00, 0xf7]) is None
+    # Other Electra One messages, like a preset dump, are no answer to the upload
+    assert ElectraOne.isUploadAcknowledgement([0xf0, 0x00, 0x21, 0x45, 0x01, 0x00, 0x7b, 0x7d, 0xf7]) is None
@@ -0,0 +1,21 @@
+#
+#   Copyright (c) 2022 Christof Ruch. All rights reserved.
+#
+#   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+#
+import Ensoniqesq1
+import knobkraft
+
+
+def test_declared_bank_layout_agrees_with_python():
+    adaptation = Ensoniqesq1
+    program = knobkraft.load_sysex("testData/Radzic-ESQ1.syx")[0]
+    # Build an all program dump on channel 5 from 40 copies of the program's data
+    bank = [0xf0, 0x0f, 0x02, 0x05, 0x02] + program[5:-1] * 40 + [0xf7]
+    assert adaptation.isPartOfBankDump(bank)
+
+    extracted = adaptation.extractPatchesFromBank(bank)
+    assert knobkraft.extractPatchesByLayout(adaptation.bankDumpLayout, bank) == extracted
+    programs = knobkraft.splitSysex(extracted)
+    assert len(programs) == 40
+    assert all(adaptation.isSingleProgramDump(p) and p[3] == 0x05 for p in programs)
@@ -75,6 +75,15 @@ def test_extract_name(adaptation, test_data: TestData):
         pytest.skip(f"{adaptation.name} has not implemented nameFromDump")
 
 
+@skip_targets("test_data")
+def test_extract_names_batch(adaptation, test_data: TestData):
+    if hasattr(adaptation, "nameFromDumps") and test_data is not None:
+        messages = [program["message"] for program in test_data.programs]
+        assert adaptation.nameFromDumps(messages) == [program["name"] for program in test_data.programs]
+    else:
+        pytest.skip(f"{adaptation.name} has not implemented nameFromDumps")
+
+
 @skip_targets("test_data")
 def test_rename(adaptation, test_data: TestData):
     if hasattr(adaptation, "nameFromDump") and hasattr(adaptation, "renamePatch"):
@@ -201,6 +210,15 @@ def test_fingerprinting(adaptation, test_data: TestData):
         pytest.skip(f"{adaptation.name} has not implemented calculateFingerprint")
 
 
+@skip_targets("test_data")
+def test_fingerprinting_batch(adaptation, test_data: TestData):
+    if hasattr(adaptation, "calculateFingerprints") and test_data is not None:
+        messages = [program["message"] for program in test_data.programs]
+        assert adaptation.calculateFingerprints(messages) == [adaptation.calculateFingerprint(message) for message in messages]
+    else:
+        pytest.skip(f"{adaptation.name} has not implemented calculateFingerprints")
+
+
 @skip_targets("test_data")
 def test_device_detection(adaptation, test_data: TestData):
     found = False
@@ -230,3 +248,42 @@ def test_friendly_bank_name(adaptation, test_data: TestData):
         assert adaptation.friendlyBankName(bank_data[0]) == bank_data[1]
     else:
         pytest.skip(f"{adaptation.name} has not implemented friendly_bank_name")
+
+
+@skip_targets("test_data")
+def test_bank_dump_progress(adaptation, test_data: TestData):
+    if hasattr(adaptation, "bankDumpProgress") and hasattr(adaptation, "isBankDumpFinished"):
+        # The incremental protocol must agree with isBankDumpFinished() on every prefix of the messages
+        messages = [program["message"] for program in test_data.programs]
+        state = None
+        for i in range(len(messages)):
+            finished, state = adaptation.bankDumpProgress(messages[i], state)
+            assert finished == adaptation.isBankDumpFinished(messages[:i + 1])
+    else:
+        pytest.skip(f"{adaptation.name} has not implemented bankDumpProgress")
+
+
+@skip_targets("test_data")
+def test_declared_sysex_matchers(adaptation, test_data: TestData):
+    if hasattr(adaptation, "sysexMatchers"):
+        # The declarations replace the Python functions in the Orm, so they must agree on all test messages
+        messages = [program["message"] for program in test_data.programs] + test_data.all_messages
+        for function_name, declaration in adaptation.sysexMatchers.items():
+            assert function_name in ["isEditBufferDump", "isSingleProgramDump", "isPartOfBankDump"]
+            for message in messages:
+                assert knobkraft.matchesSysexDeclaration(declaration, message) == getattr(adaptation, function_name)(message)
+    else:
+        pytest.skip(f"{adaptation.name} has not declared sysexMatchers")
+
+
+@skip_targets("test_data")
+def test_declared_bank_dump_layout(adaptation, test_data: TestData):
+    if hasattr(adaptation, "bankDumpLayout"):
+        # The Orm cuts bank dumps along the declaration instead of calling extractPatchesFromBank()
+        banks = [message for message in test_data.all_messages if adaptation.isPartOfBankDump(message)]
+        if not banks:
+            pytest.skip(f"{adaptation.name} has no bank dumps in its test data")
+        for bank in banks:
+            assert knobkraft.extractPatchesByLayout(adaptation.bankDumpLayout, bank) == list(adaptation.extractPatchesFromBank(bank))
+    else:
+        pytest.skip(f"{adaptation.name} has not declared bankDumpLayout")
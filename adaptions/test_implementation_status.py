@@ -30,6 +30,8 @@ column_names = ["Synth name",
                 "numberFromDump",
                 "nameFromDump",
                 "generalMessageDelay",
+                "messageBytesPerSecond",
+                "isUploadAcknowledgement",
                 "renamePatch",
                 "isDefaultName",
                 "calculateFingerprint",
@@ -122,6 +124,8 @@ def test_implementation_status(adaptation, md_file):
               check(adaptation, "numberFromDump"),
               check(adaptation, "nameFromDump"),
               check(adaptation, "generalMessageDelay"),
+              check(adaptation, "messageBytesPerSecond"),
+              check(adaptation, "isUploadAcknowledgement"),
               check(adaptation, "renamePatch"),
               check(adaptation, "isDefaultName"),
               check(adaptation, "calculateFingerprint"),
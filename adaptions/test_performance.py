@@ -0,0 +1,77 @@
+#
+#   Copyright (c) 2022 Christof Ruch. All rights reserved.
+#
+#   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+#
+
+# Companion to test_adaptations.py timing the adaptation functions instead of checking them, e.g.
+#     pytest test_performance.py --all --benchmark --benchmark-report=report.json
+# The summary lists ops/s and kB/s per function and flags functions far slower than the median over all adaptations
+
+import time
+
+import pytest
+
+from test_adaptations import TestData, skip_targets, test_data  # noqa: F401 the fixture is used by name
+
+# Each function is called often enough to run at least this long, so the numbers are stable
+MIN_SECONDS = 0.05
+
+
+def _program_dumps(adaptation, test_data):
+    messages = [program["message"] for program in test_data.programs] if hasattr(test_data, "programs") else []
+    if hasattr(adaptation, "isSingleProgramDump"):
+        return [message for message in messages if adaptation.isSingleProgramDump(message)]
+    return messages
+
+
+# The adaptation functions timed, which messages of the test data they are called with, and how
+BENCHMARKS = {
+    "isPartOfBankDump": (lambda a, d: d.all_messages, lambda a, m: a.isPartOfBankDump(m)),
+    "isSingleProgramDump": (lambda a, d: d.all_messages, lambda a, m: a.isSingleProgramDump(m)),
+    "isEditBufferDump": (lambda a, d: d.all_messages, lambda a, m: a.isEditBufferDump(m)),
+    "nameFromDump": (lambda a, d: [program["message"] for program in d.programs], lambda a, m: a.nameFromDump(m)),
+    "numberFromDump": (lambda a, d: [program["message"] for program in d.programs], lambda a, m: a.numberFromDump(m)),
+    "calculateFingerprint": (lambda a, d: [program["message"] for program in d.programs], lambda a, m: a.calculateFingerprint(m)),
+    "convertToEditBuffer": (_program_dumps, lambda a, m: a.convertToEditBuffer(0x00, m)),
+    "convertToProgramDump": (_program_dumps, lambda a, m: a.convertToProgramDump(0x00, m, 11)),
+}
+
+
+def time_function(adaptation, messages, call):
+    """Returns (calls, bytes, seconds) for calling the function on all messages, repeated until MIN_SECONDS passed"""
+    calls = 0
+    byte_count = 0
+    size = sum(len(message) for message in messages)
+    start = time.perf_counter()
+    elapsed = 0.0
+    while elapsed < MIN_SECONDS:
+        for message in messages:
+            call(adaptation, message)
+        calls += len(messages)
+        byte_count += size
+        elapsed = time.perf_counter() - start
+    return calls, byte_count, elapsed
+
+
+@skip_targets("test_data")
+def test_benchmark(adaptation, test_data: TestData, request):
+    if not request.config.getoption("benchmark"):
+        pytest.skip("benchmark mode not requested, run with --benchmark")
+    if not hasattr(test_data, "programs"):
+        pytest.skip(f"{adaptation.name()} provides no programs in its test data")
+    results = {}
+    for function, (select, call) in BENCHMARKS.items():
+        if not hasattr(adaptation, function):
+            continue
+        messages = select(adaptation, test_data)
+        if not messages:
+            continue
+        try:
+            calls, byte_count, seconds = time_function(adaptation, messages, call)
+        except Exception as e:
+            results[function] = {"error": str(e)}
+            continue
+        results[function] = {"calls": calls, "bytes": byte_count, "seconds": seconds,
+                             "ops_per_second": calls / seconds, "bytes_per_second": byte_count / seconds}
+    request.config.benchmark_results[adaptation.name()] = results
@@ -0,0 +1,161 @@
+#
+#   Copyright (c) 2022 Christof Ruch. All rights reserved.
+#
+#   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+#
+
+# Companion to test_adaptations.py running detection, downloads and uploads against a virtual synth answering from the
+# test data, so they can be checked and timed without the hardware attached, e.g.
+#     pytest test_transfer.py --all --benchmark --record-sessions=sessions
+# With --benchmark the simulated seconds of each transfer are reported, --record-sessions writes the MIDI traffic of each
+# adaptation to a file that knobkraft.VirtualSynth.from_session() replays
+
+import os
+
+import pytest
+
+from knobkraft.virtual_synth import MidiLink, VirtualSynth
+from test_adaptations import TestData, skip_targets, test_data  # noqa: F401 the fixture is used by name
+
+
+def detect(adaptation, synth):
+    """Like the Orm, send the detect message for all channels at once, then wait once. Returns (channel, seconds)"""
+    wait_ms = adaptation.deviceDetectWaitMilliseconds() if hasattr(adaptation, "deviceDetectWaitMilliseconds") else 200
+    channel_specific = adaptation.needsChannelSpecificDetection() if hasattr(adaptation, "needsChannelSpecificDetection") else True
+    start = synth.now
+    replies = []
+    for channel in range(16 if channel_specific else 1):
+        replies += synth.send(adaptation.createDeviceDetectMessage(channel))
+    deadline = synth.to_synth_free + wait_ms / 1000.0
+    synth.advance_to(deadline)
+    for arrival, reply in replies:
+        if arrival <= deadline:
+            channel = adaptation.channelIfValidDeviceResponse(reply)
+            if channel != -1:
+                return channel, synth.now - start
+    return -1, synth.now - start
+
+
+def download(synth, requests, in_flight=1):
+    """Sends the requests, keeping at most in_flight unanswered. Returns (replies, seconds)"""
+    start = synth.now
+    received = []
+    pending = []
+    for request in requests:
+        if len(pending) >= in_flight:
+            synth.advance_to(pending.pop(0))
+        answer = synth.send(request)
+        if answer:
+            pending.append(answer[-1][0])
+            received += [message for _, message in answer]
+    for arrival in pending:
+        synth.advance_to(arrival)
+    return received, synth.now - start
+
+
+def upload(synth, messages):
+    """Sends all messages back to back. Returns the seconds until the last byte arrived at the synth"""
+    start = synth.now
+    for message in messages:
+        synth.send(message)
+    synth.advance_to(synth.to_synth_free)
+    return synth.now - start
+
+
+def program_requests(adaptation, test_data):
+    return [adaptation.createProgramDumpRequest(0x00, program["number"]) for program in test_data.programs
+            if "number" in program and not program.get("is_edit_buffer", False)]
+
+
+@pytest.fixture
+def synth(adaptation, test_data, request):
+    if test_data is None:
+        yield None
+        return
+    virtual_synth = VirtualSynth.from_test_data(adaptation, test_data, MidiLink())
+    yield virtual_synth
+    directory = request.config.getoption("record_sessions")
+    if directory and virtual_synth.events:
+        os.makedirs(directory, exist_ok=True)
+        virtual_synth.save_session(os.path.join(directory, f"{adaptation.name()} {request.node.originalname}.json"))
+
+
+def report(request, adaptation, transfer, seconds, byte_count):
+    if request.config.getoption("benchmark"):
+        request.config.transfer_results.setdefault(adaptation.name(), {})[transfer] = {"seconds": seconds, "bytes": byte_count}
+
+
+@skip_targets("test_data")
+def test_detect_virtual_synth(adaptation, test_data: TestData, synth, request):
+    if not hasattr(test_data, "detection_reply") or not hasattr(adaptation, "createDeviceDetectMessage"):
+        pytest.skip(f"{adaptation.name()} has no detection_reply in its test data")
+    channel, seconds = detect(adaptation, synth)
+    assert channel == test_data.detection_reply[1]
+    report(request, adaptation, "detect", seconds, len(test_data.detection_reply[0]))
+
+
+@skip_targets("test_data")
+def test_download_programs(adaptation, test_data: TestData, synth, request):
+    if not hasattr(adaptation, "createProgramDumpRequest") or not hasattr(test_data, "programs"):
+        pytest.skip(f"{adaptation.name()} has not implemented createProgramDumpRequest")
+    requests = program_requests(adaptation, test_data)
+    if not requests:
+        pytest.skip(f"{adaptation.name()} has no numbered programs in its test data")
+    received, seconds = download(synth, requests)
+    expected = [program["message"] for program in test_data.programs if "number" in program and not program.get("is_edit_buffer", False)]
+    assert received == expected
+    report(request, adaptation, "download_programs", seconds, sum(len(message) for message in received))
+
+    # The same requests with all of them in flight must not take longer, and give the same result
+    pipelined = VirtualSynth(synth.name, synth.replies, synth.link)
+    received_pipelined, seconds_pipelined = download(pipelined, requests, in_flight=len(requests))
+    assert received_pipelined == received
+    assert seconds_pipelined <= seconds
+    report(request, adaptation, "download_programs_pipelined", seconds_pipelined, sum(len(message) for message in received))
+
+
+@skip_targets("test_data")
+def test_download_bank(adaptation, test_data: TestData, synth, request):
+    if not hasattr(adaptation, "createBankDumpRequest") or not hasattr(adaptation, "isPartOfBankDump"):
+        pytest.skip(f"{adaptation.name()} has not implemented createBankDumpRequest")
+    bank = [message for message in test_data.all_messages if adaptation.isPartOfBankDump(message)]
+    if not bank:
+        pytest.skip(f"{adaptation.name()} has no bank dumps in its test data")
+    received, seconds = download(synth, [adaptation.createBankDumpRequest(0x00, 0)])
+    assert received == bank
+    if hasattr(adaptation, "isBankDumpFinished"):
+        assert adaptation.isBankDumpFinished(received)
+    report(request, adaptation, "download_bank", seconds, sum(len(message) for message in received))
+
+
+@skip_targets("test_data")
+def test_upload_programs(adaptation, test_data: TestData, synth, request):
+    if not hasattr(adaptation, "convertToProgramDump") or not hasattr(test_data, "programs"):
+        pytest.skip(f"{adaptation.name()} has not implemented convertToProgramDump")
+    if hasattr(adaptation, "isSingleProgramDump"):
+        programs = [program["message"] for program in test_data.programs if adaptation.isSingleProgramDump(program["message"])]
+    else:
+        programs = [program["message"] for program in test_data.programs]
+    if not programs:
+        pytest.skip(f"{adaptation.name()} has no program dumps in its test data")
+    messages = [adaptation.convertToProgramDump(0x00, program, 11) for program in programs]
+    seconds = upload(synth, messages)
+    byte_count = sum(len(message) for message in messages)
+    assert seconds == pytest.approx(byte_count * 10.0 / synth.link.baud)
+    report(request, adaptation, "upload_programs", seconds, byte_count)
+
+
+def test_replay_session(tmp_path):
+    # A recorded session answers the same requests again, with the replies that came back during the recording
+    recording = VirtualSynth("recorded", {(0xf0, 0x01, 0xf7): [[0xf0, 0x02, 0xf7], [0xf0, 0x03, 0xf7]]}, MidiLink(baud=31250, latency_ms=5.0))
+    recording.send([0xf0, 0x01, 0xf7])
+    recording.send([0xf0, 0x04, 0xf7])
+    recording.save_session(tmp_path / "session.json")
+
+    replay = VirtualSynth.from_session(tmp_path / "session.json")
+    assert replay.link.latency_ms == 5.0
+    answers = replay.send([0xf0, 0x01, 0xf7])
+    assert [message for _, message in answers] == [[0xf0, 0x02, 0xf7], [0xf0, 0x03, 0xf7]]
+    # 3 bytes out, 5 ms latency, then 6 bytes back, at 3125 bytes per second
+    assert answers[-1][0] == pytest.approx(3 / 3125 + 0.005 + 6 / 3125)
+    assert replay.send([0xf0, 0x04, 0xf7]) == []
@@ -13,6 +13,8 @@
 
 #include "fmt/format.h"
 
+#include <algorithm>
+
 namespace midikraft {
 
 	// Definition for the "unused" data bytes inside Page A and Page B of the Virus.
@@ -161,10 +163,8 @@ namespace midikraft {
 	bool Virus::isBankDumpFinished(std::vector<MidiMessage> const &bankDump) const
 	{
 		// Count the number of patch dumps in that stream
-		int found = 0;
-		for (auto message : bankDump) {
-			if (isSingleProgramDump({ message })) found++;
-		}
+		// Counting in place, wrapping each message into a vector for isSingleProgramDump() would copy all of them on every call
+		auto found = std::count_if(bankDump.cbegin(), bankDump.cend(), [this](MidiMessage const &message) { return isBankDump(message); });
 		return found == 128;
 	}
 
@@ -274,20 +274,18 @@ namespace midikraft {
 
 	std::vector<uint8> Virus::getPagesFromMessage(MidiMessage const &message, int dataStartIndex) const {
 		if (isOwnSysex(message)) {
-			// Extract the data block and check the checksum
-			std::vector<uint8> data;
+			// Check the checksum first, and only then extract the data block in one go
+			const uint8 *sysex = message.getSysExData();
 			int sum = 0;
 			for (int additionalChecksummed = -4; additionalChecksummed < 0; additionalChecksummed++) {
-				sum += message.getSysExData()[dataStartIndex + additionalChecksummed];
+				sum += sysex[dataStartIndex + additionalChecksummed];
 			}
 			for (int i = dataStartIndex; i < message.getSysExDataSize() - 1; i++) {
-				uint8 byte = message.getSysExData()[i];
-				sum += byte;
-				data.push_back(byte);
+				sum += sysex[i];
 			}
-			if ((sum & 0x7f) == message.getSysExData()[message.getSysExDataSize() - 1]) {
+			if ((sum & 0x7f) == sysex[message.getSysExDataSize() - 1]) {
 				// CRC passed, we have a real data package
-				return data;
+				return std::vector<uint8>(sysex + dataStartIndex, sysex + std::max(dataStartIndex, message.getSysExDataSize() - 1));
 			}
 			else {
 				// ouch
@@ -10,15 +10,17 @@
 #include "MidiHelpers.h"
 #include "Sysex.h"
 
+#include <algorithm>
+#include <cctype>
 #include <iostream>
 #include <fstream>
-#include <sstream>
 #include <iterator> 
+#include <memory>
 
 #include <fmt/format.h>
 #include <spdlog/spdlog.h>
 #include <map>
-#include <regex>
+#include <string_view>
 
 namespace {
 
@@ -47,6 +49,8 @@ namespace {
 
 namespace midikraft {
 
+	std::atomic<uint64> BCR2000::detectedMessageDrops_{ 0 };
+
 	std::map<int, std::string> errorNames = {
 		{ 0, "no error" },
 		{ 1, "unknown token" },
@@ -89,6 +93,31 @@ namespace midikraft {
 		SEND_TEXT = 0x78
 	};
 
+	// If the message is the BCL line "<command> <number>", return the number, else -1
+	static int bclCommandArgument(MidiMessage const &message, std::string const &command) {
+		if (!BCR2000::isSysexFromBCR2000(message) || message.getSysExDataSize() < 8 || message.getSysExData()[5] != SEND_BCL_MESSAGE) {
+			return -1;
+		}
+		auto text = message.getSysExData() + 8;
+		auto end = message.getSysExData() + message.getSysExDataSize();
+		text = std::find_if(text, end, [](uint8 ch) { return !std::isspace(ch); });
+		if (end - text <= (ptrdiff_t)command.size() || !std::equal(command.begin(), command.end(), text) || !std::isspace(text[command.size()])) {
+			return -1;
+		}
+		int result = 0;
+		bool digits = false;
+		for (text += command.size(); text != end; text++) {
+			if (std::isdigit(*text)) {
+				result = result * 10 + (*text - '0');
+				digits = true;
+			}
+			else if (digits || !std::isspace(*text)) {
+				break;
+			}
+		}
+		return digits ? result : -1;
+	}
+
 	void BCR2000::writeToFile(std::string const &filename, std::string const &bcl) const
 	{
 		std::ofstream bcrFile;
@@ -100,59 +129,61 @@ namespace midikraft {
 	std::vector<juce::MidiMessage> BCR2000::convertToSyx(std::string const &bcl, bool verbatim /* = false */) const
 	{
 		std::vector<MidiMessage> result;
+		result.reserve((size_t)std::count(bcl.begin(), bcl.end(), '\n') + 1);
 
 		// This is a first - we actually send the program text in BCL clear text format to the device
 		// wrapped in messages not longer than 512 byte
-		std::vector<uint8> sysEx = createSysexCommandData(SEND_BCL_MESSAGE);
+		const size_t maxLen = 500;
+		std::vector<uint8> message = createSysexCommandData(SEND_BCL_MESSAGE);
+		const size_t headerSize = message.size();
+		message.reserve(headerSize + 2 + maxLen);
 
 		// Looping over the source code, chunking it into as many MIDI messages as required
-		std::stringstream input(bcl);
-		size_t maxLen = 500;
+		std::string_view input(bcl);
 		uint16 messageNo = 0;
-		while (!input.eof()) {
-			std::vector<uint8> characters;
-			std::string line;
-			std::getline(input, line, '\n');
+		size_t lineStart = 0;
+		while (lineStart <= input.size()) {
+			size_t lineEnd = input.find('\n', lineStart);
+			if (lineEnd == std::string_view::npos) {
+				lineEnd = input.size();
+			}
+			auto line = input.substr(lineStart, lineEnd - lineStart);
+			lineStart = lineEnd + 1;
 
 			if (!verbatim) {
 				// Strip comments to accelerate transmission
-				line = line.substr(0, line.find(";", 0));
-				rtrim(line);
-
-				// No need to send empty lines to BCR
-				if (line.empty())
-					continue;
+				line = line.substr(0, line.find(';'));
 			}
-			else {
-				// Only trim - this is important for \r\n to \n conversion
-				rtrim(line);
+			// Trim the end - this is important for \r\n to \n conversion
+			while (!line.empty() && std::isspace(static_cast<unsigned char>(line.back()))) {
+				line.remove_suffix(1);
 			}
-
-			for (auto c : line) characters.push_back(static_cast<uint8>(c));
-
-			// First sanitize characters...
-			for (uint8 &value : characters) {
-				if (value < 32 || value > 127) {
-					// Shouldn't happen
-					jassert(false);
-					value = '_';
-				}
+			if (!verbatim && line.empty()) {
+				// No need to send empty lines to BCR
+				continue;
 			}
+
 			// Truncate lines longer than maxLen characters
-			if (characters.size() > maxLen) {
-				characters.resize(maxLen);
+			if (line.size() > maxLen) {
+				line = line.substr(0, maxLen);
 			}
 
-			std::vector<uint8> message;
-			std::copy(sysEx.begin(), sysEx.end(), std::back_inserter(message));
-
+			message.resize(headerSize);
 			// Write sequential number (14 bits)
 			message.push_back((messageNo >> 7) & 0x7f);
 			message.push_back(messageNo & 0x7f);
 			messageNo++;
 
-			std::copy(characters.begin(), characters.end(), std::back_inserter(message));
-			result.push_back(MidiMessage::createSysExMessage(&message[0], (int)message.size()));
+			for (char c : line) {
+				uint8 value = static_cast<uint8>(c);
+				if (value < 32 || value > 127) {
+					// Shouldn't happen
+					jassert(false);
+					value = '_';
+				}
+				message.push_back(value);
+			}
+			result.push_back(MidiMessage::createSysExMessage(message.data(), (int)message.size()));
 		}
 		return result;
 	}
@@ -165,14 +196,11 @@ namespace midikraft {
 		if (isSysexFromBCR2000(message)) {
 			auto data = message.getSysExData();
 			if (data[5] == SEND_BCL_MESSAGE) {
-				// This is a BCL message which contains actually only a line of text in 7bit ASCII
-				uint16 lineno = (uint16)(data[6] << 7 | data[7]);
-				ignoreUnused(lineno);
-				std::string result;
-				for (int rest = 8; rest < message.getSysExDataSize(); rest++) {
-					result.push_back(static_cast<char>(data[rest]));
+				// This is a BCL message which contains actually only a line of text in 7bit ASCII, after the 14 bit line number
+				if (message.getSysExDataSize() > 8) {
+					return std::string(reinterpret_cast<char const *>(data + 8), (size_t)(message.getSysExDataSize() - 8));
 				}
-				return result;
+				return "";
 			}
 		}
 		jassert(false);
@@ -180,18 +208,42 @@ namespace midikraft {
 	}
 
 	std::string BCR2000::findPresetName(std::vector<MidiMessage> const &messages) const {
-		// Find the first line which states ".name"
-		const std::regex base_regex(R"([[:space:]]*\.name[[:space:]]+'([^']*)')", std::regex_constants::extended| std::regex_constants::icase);
-		std::smatch base_match;
-		for (auto message : messages) {
-			auto line = convertSyxToText(message);
-			if (std::regex_match(line, base_match, base_regex)) {
-				// The second submatch is the expression, the first one the whole string that matches
-				if (base_match.size() == 2) {
-					std::ssub_match base_sub_match = base_match[1];
-					return base_sub_match;
+		// Find the first line which is exactly: optional whitespace, ".name" in any case, whitespace, and the name in single quotes
+		for (auto const &message : messages) {
+			if (!isSysexFromBCR2000(message) || message.getSysExDataSize() < 8 || message.getSysExData()[5] != SEND_BCL_MESSAGE) {
+				continue;
+			}
+			std::string_view line(reinterpret_cast<char const *>(message.getSysExData() + 8), (size_t)(message.getSysExDataSize() - 8));
+			size_t pos = 0;
+			while (pos < line.size() && std::isspace(static_cast<unsigned char>(line[pos]))) {
+				pos++;
+			}
+			const std::string_view keyword(".name");
+			if (line.size() - pos < keyword.size()) {
+				continue;
+			}
+			bool isName = true;
+			for (size_t i = 0; i < keyword.size(); i++) {
+				if (std::tolower(static_cast<unsigned char>(line[pos + i])) != keyword[i]) {
+					isName = false;
+					break;
 				}
 			}
+			pos += keyword.size();
+			if (!isName || pos >= line.size() || !std::isspace(static_cast<unsigned char>(line[pos]))) {
+				continue;
+			}
+			while (pos < line.size() && std::isspace(static_cast<unsigned char>(line[pos]))) {
+				pos++;
+			}
+			if (pos >= line.size() || line[pos] != '\'') {
+				continue;
+			}
+			size_t closing = line.find('\'', pos + 1);
+			if (closing == std::string_view::npos || closing != line.size() - 1) {
+				continue;
+			}
+			return std::string(line.substr(pos + 1, closing - pos - 1));
 		}
 		return "Unknown Preset";
 	}
@@ -214,14 +266,80 @@ namespace midikraft {
 		return message.getSysExData()[5];
 	}
 
+	void BCR2000::setUploadWindow(int messagesInFlight)
+	{
+		uploadWindow_ = std::max(1, messagesInFlight);
+	}
+
+	int BCR2000::uploadWindow() const
+	{
+		return uploadWindow_;
+	}
+
 	void BCR2000::sendSysExToBCR(std::shared_ptr<SafeMidiOutput> midiOutput, std::vector<MidiMessage> const &messages, std::function<void(std::vector<BCRError> const &errors)> const whenDone)
 	{
+		// A BCL storing into preset slots which already got exactly these lines from us needs no upload, just recall the preset it would recall
+		std::vector<int> storagePlaces;
+		int recallPreset = -1;
+		MD5 contentHash;
+		{
+			MemoryBlock content;
+			for (auto const &message : messages) {
+				int place = bclCommandArgument(message, "$store");
+				if (place >= 1 && place <= 32) {
+					storagePlaces.push_back(place);
+				}
+				int recall = bclCommandArgument(message, "$recall");
+				if (recall >= 1 && recall <= 32) {
+					recallPreset = recall;
+				}
+				content.append(message.getRawData(), (size_t)message.getRawDataSize());
+			}
+			contentHash = MD5(content);
+		}
+		if (!storagePlaces.empty()) {
+			bool unchanged = std::all_of(storagePlaces.begin(), storagePlaces.end(), [this, &contentHash](int place) {
+				auto found = uploadedPresets_.find(place);
+				return found != uploadedPresets_.end() && found->second == contentHash;
+			});
+			if (unchanged) {
+				spdlog::info("BCR2000 presets already up to date, skipping upload of {} lines", messages.size());
+				if (recallPreset != -1 && midiOutput != nullptr) {
+					auto command = createSysexCommandData(SELECT_PRESET);
+					command.push_back((uint8)(recallPreset - 1));
+					midiOutput->sendMessageNow(MidiHelpers::sysexMessage(command));
+				}
+				whenDone({});
+				return;
+			}
+			// Whatever happens during the upload, these slots won't hold what we remembered anymore
+			for (int place : storagePlaces) {
+				uploadedPresets_.erase(place);
+			}
+		}
+
+		if (messages.empty()) {
+			jassert(false);
+			whenDone({});
+			return;
+		}
+
 		errorsDuringUpload_.clear();
-		TransferCounters *receivedCounter = new TransferCounters;
+		// Owned by the handler and the sender, so it goes away with the handler also when the upload never completes
+		auto receivedCounter = std::make_shared<TransferCounters>();
 		// Determine what we will do with the answer...
 		auto handle = MidiController::makeOneHandle();
 		std::vector<MidiMessage> localCopy = messages;
-		MidiController::instance()->addMessageHandler(handle, [this, localCopy, midiOutput, receivedCounter, handle, whenDone](MidiInput *source, const juce::MidiMessage &answer) {
+		// Keep up to windowSize lines in flight. The replies come in order, so any gap in the line numbers replied means a lost
+		// message or reply. Then we switch to stop-and-wait and retransmit from the first line not confirmed
+		auto sendMore = [localCopy, midiOutput, receivedCounter]() {
+			int lastToSend = receivedCounter->numMessages - 1; // The final message is not waited for, see below
+			while (receivedCounter->nextToSend < lastToSend && receivedCounter->nextToSend - receivedCounter->receivedMessages < receivedCounter->windowSize) {
+				midiOutput->sendMessageNow(localCopy[static_cast<size_t>(receivedCounter->nextToSend)]);
+				receivedCounter->nextToSend++;
+			}
+		};
+		MidiController::instance()->addMessageHandler(handle, [this, localCopy, receivedCounter, handle, whenDone, sendMore, storagePlaces, contentHash](MidiInput *source, const juce::MidiMessage &answer) {
 			if (source->getDeviceInfo() != midiInput()) return;
 
 			// Check the answer from the BCR2000
@@ -234,15 +352,35 @@ namespace midikraft {
 						uint16 lineNo = (uint16)(data[6] << 7 | data[7]);
 						uint8 error = data[8];
 
-						// Check for dropped messages...
-						int logicalLineNumber = receivedCounter->overflowCounter * (1 << 14) + lineNo;
-						if (logicalLineNumber != receivedCounter->receivedMessages && receivedCounter->lastLine != -1) {
-							spdlog::warn("BCR2000: Seems to have a MIDI message drop in communication");
-						}
+						// The line number has only 14 bits, so we need to realize when it wraps around
 						if (lineNo < receivedCounter->lastLine && lineNo == 0) {
-							// That was a wrap around
 							receivedCounter->overflowCounter++;
 						}
+						receivedCounter->lastLine = lineNo;
+						int logicalLineNumber = receivedCounter->overflowCounter * (1 << 14) + lineNo;
+
+						// Check for dropped messages...
+						if (logicalLineNumber != receivedCounter->receivedMessages) {
+							if (logicalLineNumber < receivedCounter->receivedMessages) {
+								// Reply to a line that was sent again, it has been counted already
+								return;
+							}
+							if (receivedCounter->windowSize > 1 || receivedCounter->recovering) {
+								if (!receivedCounter->recovering) {
+									detectedMessageDrops_++;
+									spdlog::warn("BCR2000: Seems to have a MIDI message drop in communication, resending from line {} one by one", receivedCounter->receivedMessages + 1);
+									receivedCounter->windowSize = 1;
+									receivedCounter->recovering = true;
+									receivedCounter->nextToSend = receivedCounter->receivedMessages;
+									sendMore();
+								}
+								// Replies to the lines still in flight behind the gap are ignored, these lines are sent again
+								return;
+							}
+							detectedMessageDrops_++;
+							spdlog::warn("BCR2000: Seems to have a MIDI message drop in communication");
+						}
+						receivedCounter->recovering = false;
 
 						if (error != 0) {
 							std::string errorText = "unknown error";
@@ -257,19 +395,28 @@ namespace midikraft {
 							else {
 								spdlog::error("Error {} ({}) in line {}", error, errorText, (logicalLineNumber + 1));
 							}
+							// Don't push the device any further once it complains
+							receivedCounter->windowSize = 1;
 						}
 
-						// Check if we are done with the upload. As this wraps when we send more than 16000 lines, we need to make sure we realize that this happened
+						// Check if we are done with the upload
 						receivedCounter->receivedMessages++;
 						if (receivedCounter->receivedMessages == receivedCounter->numMessages - 1) {
-							delete receivedCounter;
 							MidiController::instance()->removeMessageHandler(handle);
 							spdlog::info("All messages received by BCR2000");
+							if (errorsDuringUpload_.empty()) {
+								for (int place : storagePlaces) {
+									uploadedPresets_[place] = contentHash;
+								}
+							}
 							whenDone(errorsDuringUpload_);
 						}
 						else {
-							receivedCounter->lastLine = lineNo; // To detect the wrap around
-							midiOutput->sendMessageNow(localCopy[static_cast<size_t>(receivedCounter->lastLine + 1)]);
+							if (receivedCounter->nextToSend < receivedCounter->receivedMessages) {
+								// A reply came in for a line that was declared lost, no need to send that one again
+								receivedCounter->nextToSend = receivedCounter->receivedMessages;
+							}
+							sendMore();
 						}
 					}
 				}
@@ -277,21 +424,21 @@ namespace midikraft {
 			// Ignore all other messages
 		});
 
-		// Send all messages immediately
-		if (messages.size() > 0) {
-			receivedCounter->numMessages = (int) messages.size();
-			receivedCounter->receivedMessages = 0;
-			receivedCounter->lastLine = -1;
-			receivedCounter->overflowCounter = 0;
-			if (midiOutput != nullptr) {
-				midiOutput->sendMessageNow(messages[0]);
-			}
-			else {
-				spdlog::warn("No Midi Output known for BCR2000, not sending anything!");
-			}
+		// Send the first window of messages immediately
+		receivedCounter->numMessages = (int) messages.size();
+		receivedCounter->receivedMessages = 0;
+		receivedCounter->lastLine = -1;
+		receivedCounter->overflowCounter = 0;
+		receivedCounter->nextToSend = 0;
+		receivedCounter->windowSize = uploadWindow_;
+		receivedCounter->recovering = false;
+		if (midiOutput != nullptr) {
+			midiOutput->sendMessageNow(messages[0]);
+			receivedCounter->nextToSend = 1;
+			sendMore();
 		}
 		else {
-			jassert(false);
+			spdlog::warn("No Midi Output known for BCR2000, not sending anything!");
 		}
 	}
 
@@ -302,6 +449,9 @@ namespace midikraft {
 
 	std::vector<juce::MidiMessage> BCR2000::deviceDetect(int /* channel */) // The BCR can not detect on a specific channel, but will reply on all of them as it uses sysex
 	{
+		// A new detection runs when the device went away or the MIDI setup changed. Whatever answers might have been edited or power cycled
+		// in the meantime, so the next upload must not trust what we sent before
+		forgetUploadedPresets();
 		return { MidiHelpers::sysexMessage(createSysexCommandData(REQUEST_IDENTITY)) };
 	}
 
@@ -316,6 +466,8 @@ namespace midikraft {
 		if (isSysexFromBCR2000(message)) {
 			// This is the reply. We do not use the identity string returned
 			if (message.getSysExDataSize() >= 5 && sysexCommand(message) == SEND_IDENTITY) {
+				// Reconnected, possibly a different unit on the same port
+				forgetUploadedPresets();
 				return MidiChannel::fromZeroBase(0); // I think this flags only that the BCR was detected successfully - as we talk to it only via sysex, it has no "channel"
 			}
 		}
@@ -457,6 +609,11 @@ namespace midikraft {
 		bcrPresets_.clear();
 	}
 
+	void BCR2000::forgetUploadedPresets()
+	{
+		uploadedPresets_.clear();
+	}
+
 	MidiMessage BCR2000::requestEditBuffer() const
 	{
 		return requestStreamElement(0x7F, StreamLoadCapability::StreamType::EDIT_BUFFER_DUMP)[0];
@@ -522,9 +679,15 @@ namespace midikraft {
 		// Find the name
 		auto name = findPresetName(streamDump);
 
+		// Size the preset once and copy the messages straight into it, without copying each message first
+		size_t total = 0;
+		for (auto const &message : streamDump) {
+			total += static_cast<size_t>(message.getRawDataSize());
+		}
 		std::vector<uint8> patchData;
-		for (auto message : streamDump) {
-			std::copy(message.getRawData(), message.getRawData() + message.getRawDataSize(), std::back_inserter(patchData));
+		patchData.reserve(total);
+		for (auto const &message : streamDump) {
+			patchData.insert(patchData.end(), message.getRawData(), message.getRawData() + message.getRawDataSize());
 		}
 		result.push_back(std::make_shared<BCR2000Preset>(name, patchData));
 		return result;
@@ -19,6 +19,8 @@
 
 #include "Logger.h"
 
+#include <atomic>
+#include <map>
 #include <vector>
 #include <string>
 
@@ -41,10 +43,15 @@ namespace midikraft {
 		std::vector<MidiMessage> convertToSyx(std::string const &bcl, bool verbatim = false) const;
 
 		static std::string convertSyxToText(const MidiMessage &message);
+		// Gaps in the line numbers of the replies seen since the start of the program, over all BCR2000s
+		static uint64 detectedMessageDrops() { return detectedMessageDrops_.load(); }
 		std::string findPresetName(std::vector<MidiMessage> const &messages) const;
 		static bool isSysexFromBCR2000(const MidiMessage& message);
 
 		void sendSysExToBCR(std::shared_ptr<SafeMidiOutput> midiOutput, std::vector<MidiMessage> const &messages, std::function<void(std::vector<BCRError> const &errors)> const whenDone);
+		// Number of BCL lines sent ahead of the device's replies during an upload, 1 is plain stop-and-wait
+		void setUploadWindow(int messagesInFlight);
+		int uploadWindow() const;
 
 		// Implementation of DiscoverableDevice
 		virtual std::string getName() const override;
@@ -67,6 +74,8 @@ namespace midikraft {
 		void selectPreset(MidiController *controller, int presetIndex);
 		void refreshListOfPresets(std::function<void()> callback);
 		void invalidateListOfPresets();
+		// sendSysExToBCR() skips uploads identical to the last one into the same preset slots. Call this if the presets might have been changed by other means
+		void forgetUploadedPresets();
 
 		// Unused so far
 		MidiMessage requestEditBuffer() const;
@@ -100,12 +109,18 @@ namespace midikraft {
 		std::vector<uint8> createSysexCommandData(uint8 commandCode) const;
 		std::vector<std::string> bcrPresets_; // These are the names of the 32 presets stored in the BCR2000
 		std::vector<BCRError> errorsDuringUpload_; // Make sure to not run two uploads in parallel...
+		std::map<int, MD5> uploadedPresets_; // Hash of the last upload completed without errors, per storage slot 1 to 32
+		int uploadWindow_ = 4;
+		static std::atomic<uint64> detectedMessageDrops_;
 
 		struct TransferCounters {
 			int numMessages;
 			int receivedMessages;
 			int lastLine;
 			int overflowCounter;
+			int nextToSend; // Index of the first message not sent yet
+			int windowSize; // Drops to 1 after the first error or drop
+			bool recovering; // A drop was detected and the missing line was sent again, waiting for its reply
 		};
 	};
 
@@ -383,29 +383,47 @@ namespace midikraft {
 		return k3PatchToSysex(wave->data(), static_cast<int>(KawaiK3::WaveType::USER_WAVE), false);
 	}
 
-	std::vector<float> KawaiK3::romWave(int waveNo)
-	{
-		std::vector<float> result;
-		if (waveNo <= 0 || waveNo > 31) {
-			// This could happen if you go in here with the user wave, noise, or the wave turned off
-			return result;
+	namespace {
+
+		constexpr int kNumberOfRomWaves = 31;
+		constexpr int kRomWaveLength = 32 * 16;
+
+		// All ROM waves decoded from the address bit layout once, index 0 is the first ROM wave
+		std::vector<std::vector<float>> const &decodedRomWaves() {
+			static std::vector<std::vector<float>> waves = []() {
+				// Load the ROM
+				const uint8 *romData = reinterpret_cast<const uint8 *>(R6P_09_27c256_BIN);
+				jassert(R6P_09_27c256_BIN_size == 32768);
+
+				std::vector<std::vector<float>> result(kNumberOfRomWaves);
+				for (int waveNo = 1; waveNo <= kNumberOfRomWaves; waveNo++) {
+					auto &wave = result[waveNo - 1];
+					wave.reserve(kRomWaveLength);
+					// Build up the address bits!
+					// see https://acreil.wordpress.com/2018/07/15/kawai-k3-and-k3m-1986/
+					int wa10wa15 = (waveNo & 0x3f) << 10; // The highest bit would select the RAM waveform
+					for (int step = 0; step < 32; step++) {
+						int wa5wa9 = step << 5;
+						for (int m = 0; m < 16; m++) {
+							int wa0wa4 = m << 1; // The lowest bit seems to be the one selecting the "multi-sample". But what exactly is that? A second sample?
+							wave.push_back(romData[wa0wa4 | wa5wa9 | wa10wa15]);
+						}
+					}
+				}
+				return result;
+			}();
+			return waves;
 		}
 
-		// Load the ROM
-		const uint8 *romData = reinterpret_cast<const uint8 *>(R6P_09_27c256_BIN);
-		jassert(R6P_09_27c256_BIN_size == 32768);
+	}
 
-		// Build up the address bits!
-		// see https://acreil.wordpress.com/2018/07/15/kawai-k3-and-k3m-1986/
-		int wa10wa15 = (waveNo & 0x3f) << 10; // The highest bit would select the RAM waveform
-		for (int step = 0; step < 32; step++) {
-			int wa5wa9 = step << 5;
-			for (int m = 0; m < 16; m++) {
-				int wa0wa4 = m << 1; // The lowest bit seems to be the one selecting the "multi-sample". But what exactly is that? A second sample?
-				result.push_back(romData[wa0wa4 | wa5wa9 | wa10wa15]);
-			}
+	std::vector<float> KawaiK3::romWave(int waveNo)
+	{
+		if (waveNo <= 0 || waveNo > kNumberOfRomWaves) {
+			// This could happen if you go in here with the user wave, noise, or the wave turned off
+			return {};
 		}
-		return result;
+		return decodedRomWaves()[waveNo - 1];
 	}
 
 	std::string KawaiK3::waveName(int waveNo)
@@ -652,8 +670,8 @@ namespace midikraft {
 
 	void KawaiK3::selectHarmonics(Patch *currentPatch, std::string const &name, Additive::Harmonics const &selectedHarmonics)
 	{
-		auto samples = Additive::createSamplesFromHarmonics(selectedHarmonics);
-		//wave1_.displaySampledWave(samples);
+		// The K3 wave is defined by its harmonics directly, resynthesize with Additive::createSamplesFromHarmonics() only for display
+		//wave1_.displaySampledWave(Additive::createSamplesFromHarmonics(selectedHarmonics));
 		auto wave = std::make_shared<KawaiK3Wave>(selectedHarmonics, MidiProgramNumber::fromZeroBase(static_cast<int>(WaveType::USER_WAVE)));
 		auto userWave = waveToSysex(wave);
 		spdlog::debug("Sending user wave for registration {} to K3", name);
@@ -670,61 +688,70 @@ namespace midikraft {
 		else {
 			spdlog::info("Writing K3 patch '{}' to program {}", nameForPatch(dataFile), friendlyProgramName(kFakeEditBuffer));
 		}
-		MidiBuffer messages = MidiHelpers::bufferFromMessages(dataFileToMessages(dataFile, target));
-		sendPatchToSynth(MidiController::instance(), messages);
-	}
-
-	void KawaiK3::sendPatchToSynth(MidiController * controller, MidiBuffer const &messages) {
-		auto secondHandler = MidiController::makeOneHandle();
-		MidiController::instance()->addMessageHandler(secondHandler, [this, controller, secondHandler](MidiInput *source, MidiMessage const &message) {
-			ignoreUnused(source);
-			if (isWriteConfirmation(message)) {
-				MidiController::instance()->removeMessageHandler(secondHandler);
-				spdlog::info("Got patch write confirmation from K3");
-				MidiBuffer midiBuffer;
-                midiBuffer.addEvent(MidiMessage::programChange(channel().toOneBasedInt(), 1), 1); // Any program can be used
-                midiBuffer.addEvent(MidiMessage::programChange(channel().toOneBasedInt(), kFakeEditBuffer.toZeroBasedDiscardingBank()), 2);
-				controller->getMidiOutput(midiOutput())->sendBlockOfMessagesFullSpeed(midiBuffer);
-				// We ignore the result of these sends, just hope for the best
-			}
-			else {
-				//TODO the message handler is never removed in case you do not get a write confirmation. This will crash.
-			}
-		});
-		controller->enableMidiOutput(midiOutput());
+		sendBlockOfMessagesToSynth(midiOutput(), dataFileToMessages(dataFile, target));
+	}
+
+	KawaiK3Upload::Reply KawaiK3::classifyWriteReply(MidiMessage const &message) const
+	{
+		switch (sysexFunction(message)) {
+		case WRITE_COMPLETE:
+			return KawaiK3Upload::Reply::Confirmation;
+		case WRITE_ERROR:
+		case WRITE_ERROR_BY_PROTECT:
+		case WRITE_ERROR_BY_NO_CARTRIDGE:
+			return KawaiK3Upload::Reply::Error;
+		default:
+			return KawaiK3Upload::Reply::None;
+		}
+	}
+
+	void KawaiK3::uploadWrites(juce::MidiDeviceInfo const &output, std::vector<MidiMessage> const &writes)
+	{
+		std::lock_guard<std::mutex> guard(uploadLock_);
+		if (upload_ && upload_->append(writes)) {
+			// Will be sent right after what is queued already
+			return;
+		}
+		auto controller = MidiController::instance();
+		controller->enableMidiOutput(output);
 		controller->enableMidiInput(midiInput());
-		controller->getMidiOutput(midiOutput())->sendBlockOfMessagesFullSpeed(messages);
+		upload_ = std::make_shared<KawaiK3Upload>(output, [this](MidiMessage const &message) { return classifyWriteReply(message); }, [this, output]() {
+			spdlog::info("Kawai K3 has confirmed all writes");
+			// Make the K3 load the fake edit buffer again, so what was written there can be heard
+			MidiBuffer midiBuffer;
+			midiBuffer.addEvent(MidiMessage::programChange(channel().toOneBasedInt(), 1), 1); // Any program can be used
+			midiBuffer.addEvent(MidiMessage::programChange(channel().toOneBasedInt(), kFakeEditBuffer.toZeroBasedDiscardingBank()), 2);
+			MidiController::instance()->getMidiOutput(output)->sendBlockOfMessagesFullSpeed(midiBuffer);
+			// We ignore the result of these sends, just hope for the best
+		});
+		upload_->append(writes);
+		upload_->start();
 	}
 
 	void KawaiK3::sendBlockOfMessagesToSynth(juce::MidiDeviceInfo const& midiOutput, std::vector<MidiMessage> const& buffer)
 	{
-		// We need to inspect if in there are any patch dumps are wave dump messages
+		// Patch dumps and wave dumps are written into the K3's memory, and it confirms each of them.
+		// They go one by one through the upload, everything else is sent right away
 		auto midiOut = MidiController::instance()->getMidiOutput(midiOutput);
 		std::vector<MidiMessage> filtered;
-		std::shared_ptr<MidiMessage> patchToSend;
-		std::shared_ptr<MidiMessage> waveToSend;
+		std::vector<MidiMessage> writes;
 		for (const auto& message : buffer) {
 			// Suppress empty sysex messages, they seem to confuse vintage hardware (the Kawai K3 in particular)
 			if (MidiHelpers::isEmptySysex(message)) continue;
 
-			// Special handling required for patch dumps and wave dumps!
-			if (isSingleProgramDump({ message })) {
-				patchToSend = std::make_shared<MidiMessage>(message);
-			}
-			else if (isWaveBufferDump(message)) {
-				waveToSend = std::make_shared<MidiMessage>(message);
+			if (isSingleProgramDump({ message }) || isWaveBufferDump(message)) {
+				writes.push_back(message);
 			}
 			else {
 				filtered.push_back(message);
 			}
 		}
 		// Send the filtered stuff
-		midiOut->sendBlockOfMessagesFullSpeed(MidiHelpers::bufferFromMessages(filtered));
-		if (patchToSend) {
-			sendPatchToSynth(MidiController::instance(), MidiHelpers::bufferFromMessages({ *patchToSend }));
+		if (!filtered.empty()) {
+			midiOut->sendBlockOfMessagesFullSpeed(MidiHelpers::bufferFromMessages(filtered));
 		}
-		if (waveToSend) {
-			sendPatchToSynth(MidiController::instance(), MidiHelpers::bufferFromMessages({ *waveToSend}));
+		if (!writes.empty()) {
+			uploadWrites(midiOutput, writes);
 		}
 	}
 
@@ -29,6 +29,9 @@
 
 #include "SupportedByBCR2000.h" // Should be moved into the bidirectional sync?
 
+#include "KawaiK3_Upload.h"
+
+#include <mutex>
 #include <set>
 
 namespace midikraft {
@@ -149,7 +152,8 @@ namespace midikraft {
 		virtual Synth::PatchData createInitPatch() override;
 
 	private:
-		void sendPatchToSynth(MidiController* controller, MidiBuffer const& messages);
+		KawaiK3Upload::Reply classifyWriteReply(MidiMessage const &message) const;
+		void uploadWrites(juce::MidiDeviceInfo const &output, std::vector<MidiMessage> const &writes);
 
 		friend class KawaiK3Control;
 		friend class KawaiK3Parameter;
@@ -179,6 +183,9 @@ namespace midikraft {
 		MidiController::HandlerHandle k3BCRSyncHandler_ = MidiController::makeNoneHandle();
 
 		MidiProgramNumber programNo_;
+
+		std::mutex uploadLock_;
+		std::shared_ptr<KawaiK3Upload> upload_;
 	};
 
 }
@@ -0,0 +1,126 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "KawaiK3_Upload.h"
+
+#include "MidiHelpers.h"
+
+#include <spdlog/spdlog.h>
+
+namespace midikraft {
+
+	KawaiK3Upload::KawaiK3Upload(juce::MidiDeviceInfo const &midiOutput, TReplyClassifier classify, std::function<void()> onFinished) :
+		midiOutput_(midiOutput), classify_(classify), onFinished_(onFinished)
+	{
+	}
+
+	bool KawaiK3Upload::append(std::vector<MidiMessage> const &writes)
+	{
+		std::lock_guard<std::mutex> guard(lock_);
+		if (finished_) {
+			return false;
+		}
+		writes_.insert(writes_.end(), writes.begin(), writes.end());
+		return true;
+	}
+
+	void KawaiK3Upload::start()
+	{
+		std::weak_ptr<KawaiK3Upload> weak = shared_from_this();
+		handler_ = MidiController::makeOneHandle();
+		MidiController::instance()->addMessageHandler(handler_, [weak](MidiInput *source, MidiMessage const &message) {
+			ignoreUnused(source);
+			// Hold on to the upload, the handler might be removed while it runs
+			auto upload = weak.lock();
+			if (upload) {
+				auto reply = upload->classify_(message);
+				if (reply != Reply::None) {
+					upload->replyReceived(reply);
+				}
+			}
+		});
+		bool done;
+		{
+			std::lock_guard<std::mutex> guard(lock_);
+			done = sendNextWhileLocked();
+		}
+		if (done) {
+			finish();
+		}
+	}
+
+	void KawaiK3Upload::replyReceived(Reply reply)
+	{
+		bool done;
+		{
+			std::lock_guard<std::mutex> guard(lock_);
+			if (!waiting_) {
+				// A reply to something else, or to a write given up on already
+				return;
+			}
+			if (reply == Reply::Error) {
+				spdlog::error("Kawai K3 reported a write error, is the memory protected? Not sending the remaining {} writes", writes_.size());
+				writes_.clear();
+			}
+			done = sendNextWhileLocked();
+		}
+		if (done) {
+			finish();
+		}
+	}
+
+	void KawaiK3Upload::timedOut(int writeNumber)
+	{
+		bool done;
+		{
+			std::lock_guard<std::mutex> guard(lock_);
+			if (!waiting_ || writeNumber != writesSent_) {
+				return;
+			}
+			spdlog::warn("No write confirmation from the Kawai K3 after {} ms, sending the next write anyway", kConfirmationTimeoutMs);
+			done = sendNextWhileLocked();
+		}
+		if (done) {
+			finish();
+		}
+	}
+
+	bool KawaiK3Upload::sendNextWhileLocked()
+	{
+		if (writes_.empty()) {
+			// From now on append() refuses, so no write can get stuck in a finished upload
+			waiting_ = false;
+			finished_ = true;
+			return true;
+		}
+		auto write = writes_.front();
+		writes_.pop_front();
+		waiting_ = true;
+		int writeNumber = ++writesSent_;
+		auto midiOut = MidiController::instance()->getMidiOutput(midiOutput_);
+		midiOut->sendBlockOfMessagesFullSpeed(MidiHelpers::bufferFromMessages({ write }));
+
+		std::weak_ptr<KawaiK3Upload> weak = shared_from_this();
+		Timer::callAfterDelay(kConfirmationTimeoutMs, [weak, writeNumber]() {
+			auto upload = weak.lock();
+			if (upload) {
+				upload->timedOut(writeNumber);
+			}
+		});
+		return false;
+	}
+
+	void KawaiK3Upload::finish()
+	{
+		// Not under the lock, the MIDI thread might be waiting for it in the handler that is removed here
+		MidiController::instance()->removeMessageHandler(handler_);
+		handler_ = MidiController::makeNoneHandle();
+		if (onFinished_) {
+			onFinished_();
+		}
+	}
+
+}
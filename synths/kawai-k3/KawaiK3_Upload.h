@@ -0,0 +1,56 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include "MidiController.h"
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+namespace midikraft {
+
+	// Sends one block write after the other to the K3, each as soon as the K3 has confirmed the previous one. So a full bank
+	// goes over at the speed the K3 can write its memory. Should a confirmation get lost, the next write is sent after a timeout.
+	// A write error stops the upload, the K3 will not accept the rest either (memory protect or missing cartridge).
+	// Writes queued while an upload is running are appended to it.
+	class KawaiK3Upload : public std::enable_shared_from_this<KawaiK3Upload> {
+	public:
+		enum class Reply { None, Confirmation, Error };
+		typedef std::function<Reply(MidiMessage const &message)> TReplyClassifier;
+
+		KawaiK3Upload(juce::MidiDeviceInfo const &midiOutput, TReplyClassifier classify, std::function<void()> onFinished);
+
+		// Returns false if the upload has finished already, then a new one is needed
+		bool append(std::vector<MidiMessage> const &writes);
+		void start();
+
+		static constexpr int kConfirmationTimeoutMs = 500;
+
+	private:
+		void replyReceived(Reply reply);
+		void timedOut(int writeNumber);
+		// Returns true when there was nothing left to send, then finish() must be called after releasing the lock
+		bool sendNextWhileLocked();
+		void finish();
+
+		juce::MidiDeviceInfo midiOutput_;
+		TReplyClassifier classify_;
+		std::function<void()> onFinished_;
+		MidiController::HandlerHandle handler_ = MidiController::makeNoneHandle();
+
+		std::mutex lock_;
+		std::deque<MidiMessage> writes_;
+		int writesSent_ = 0; // Numbers the write waiting for its confirmation, so an old timeout can be told apart
+		bool waiting_ = false;
+		bool finished_ = false;
+	};
+
+}
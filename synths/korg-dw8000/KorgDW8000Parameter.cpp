@@ -10,29 +10,13 @@
 
 #include <fmt/format.h>
 
-namespace midikraft {
-
+#include <array>
 
-	KorgDW8000Parameter::KorgDW8000Parameter(Parameter const paramIndex, std::string const &name, int bits) :
-		paramIndex_(paramIndex), parameterName_(name), maxValue_(static_cast<uint8>((1 << bits) - 1))
-	{
-	}
+namespace midikraft {
 
-	KorgDW8000Parameter::KorgDW8000Parameter(Parameter const paramIndex, std::string const &name, int bits, TValueLookup const &valueLookup) :
-		paramIndex_(paramIndex), parameterName_(name), maxValue_(static_cast<uint8>((1 << bits) - 1)), valueLookup_(valueLookup)
-	{
-	}
 
-	KorgDW8000Parameter::KorgDW8000Parameter(Parameter const paramIndex, std::string const &name, int bits, uint8 maxValue) :
-		paramIndex_(paramIndex), parameterName_(name), maxValue_(maxValue)
+	KorgDW8000Parameter::KorgDW8000Parameter(PackedParameterField const &field) : field_(field)
 	{
-        juce::ignoreUnused(bits);
-	}
-
-	KorgDW8000Parameter::KorgDW8000Parameter(Parameter const paramIndex, std::string const &name, int bits, uint8 maxValue, TValueLookup const &valueLookup) :
-		paramIndex_(paramIndex), parameterName_(name), maxValue_(maxValue), valueLookup_(valueLookup)
-	{
-        juce::ignoreUnused(bits);
 	}
 
 	SynthParameterDefinition::ParamType KorgDW8000Parameter::type() const
@@ -42,15 +26,15 @@ namespace midikraft {
 
 	std::string KorgDW8000Parameter::name() const
 	{
-		return parameterName_;
+		return field_.name;
 	}
 
 	std::string KorgDW8000Parameter::valueAsText(int value) const
 	{
-		auto found = valueLookup_.find(value);
-		if (found != valueLookup_.end()) {
+		auto valueName = ParameterTable::valueName(field_, value);
+		if (valueName) {
 			// How convenient, we can just use the string from the lookup table
-			return found->second;
+			return valueName;
 		}
 
 		// Format as text
@@ -59,7 +43,7 @@ namespace midikraft {
 
 	int KorgDW8000Parameter::sysexIndex() const
 	{
-		return paramIndex_; // No mapping required for the Korg 
+		return field_.sysexIndex; // No mapping required for the Korg 
 	}
 
 	std::string KorgDW8000Parameter::description() const
@@ -78,17 +62,14 @@ namespace midikraft {
 
 	bool KorgDW8000Parameter::valueInPatch(DataFile const &patch, int &outValue) const
 	{
-		if (paramIndex_ >= patch.data().size()) {
+		auto const &data = patch.data();
+		if (field_.sysexIndex >= static_cast<int>(data.size())) {
 			return false;
 		}
-
-		int value = patch.at(paramIndex_);
-		if (value < 0 || value > maxValue_) {
+		if (!ParameterTable::extract(field_, data.data(), data.size(), outValue)) {
 			jassert(false);
 			return false;
 		}
-
-		outValue = value;
 		return true;
 	}
 
@@ -104,76 +85,120 @@ namespace midikraft {
 
 	int KorgDW8000Parameter::maxValue() const
 	{
-		return maxValue_;
+		return field_.maxValue;
 	}
 
-	KorgDW8000Parameter::TValueLookup cOctave = { { 0, "16""" },{ 1, "8""" },{ 2, "4""" } };
-	KorgDW8000Parameter::TValueLookup cWaveform = { { 0, "Sawtooth"}, { 1, "Square" }, { 2, "Piano" }, { 3, "Electric piano 1" }, { 4, "Electric piano 2" }, { 5, "Clavinet" },
-		{ 6, "Organ" }, { 7, "Brass" }, { 8, "Sax" }, { 9, "Violin" }, { 10, "Guitar" }, { 11, "Electric guitar" }, { 12, "Bass" }, { 13, "Digital bass" }, { 14, "Bell and whistle" }, { 15, "Sine" } };
-
-	std::vector<std::shared_ptr<SynthParameterDefinition>> KorgDW8000Parameter::allParameters = {
-		std::make_shared<KorgDW8000Parameter>(KorgDW8000Parameter(OSC1_OCTAVE, "Osc 1 Octave", 2, 2, cOctave)),
-		std::make_shared<KorgDW8000Parameter>(KorgDW8000Parameter(OSC1_WAVE_FORM, "Osc1 Wave Form", 4, cWaveform)),
-		std::make_shared<KorgDW8000Parameter>(OSC1_LEVEL, "Osc 1 Level", 5),
-		std::make_shared<KorgDW8000Parameter>(KorgDW8000Parameter(AUTO_BEND_SELECT, "Auto Bend Select", 2, { {0, "Off"}, { 1, "Osc1" }, {2, "Osc2"}, {3, "Both"}})),
-		std::make_shared<KorgDW8000Parameter>(KorgDW8000Parameter(AUTO_BEND_MODE, "Auto Bend Mode", 1, {{0, "Up"}, {1, "Down"}})),
-		std::make_shared<KorgDW8000Parameter>(AUTO_BEND_TIME, "Auto Bend Time", 5),
-		std::make_shared<KorgDW8000Parameter>(AUTO_BEND_INTENSITY, "Auto Bend Intensity", 5),
-		std::make_shared<KorgDW8000Parameter>(KorgDW8000Parameter(OSC2_OCTAVE, "Osc 2 Octave", 2, 2, cOctave)),
-		std::make_shared<KorgDW8000Parameter>(KorgDW8000Parameter(OSC2_WAVE_FORM, "Osc 2 Wave Form", 4, cWaveform)),
-		std::make_shared<KorgDW8000Parameter>(OSC2_LEVEL,"Osc 2 Level", 5),
-		std::make_shared<KorgDW8000Parameter>(KorgDW8000Parameter(INTERVAL, "Osc 2 Interval", 3, 4, { {0, "1"}, {1, "-3 ST"}, {2, "3 ST"}, { 3, "4 ST"}, { 4, "5 ST" } })),
-		std::make_shared<KorgDW8000Parameter>(DETUNE, "Osc2 Detune", 3, (uint8) 6),
-		std::make_shared<KorgDW8000Parameter>(NOISE_LEVEL, "Noise Level", 5),
-		std::make_shared<KorgDW8000Parameter>(KorgDW8000Parameter(ASSIGN_MODE, "Assign Mode", 2, {{0, "Poly 1"}, {1, "Poly 2"}, {2, "Unison 1"}, {3, "Unison 2"}})),
-		std::make_shared<KorgDW8000Parameter>(PARAMETER_NO_MEMORY, "Default Parameter", 6, (uint8) 62),
-		std::make_shared<KorgDW8000Parameter>(CUTOFF, "Cutoff", 6),
-		std::make_shared<KorgDW8000Parameter>(RESONANCE, "Resonance", 5),
-		std::make_shared<KorgDW8000Parameter>(KorgDW8000Parameter(KBD_TRACK, "VCF Keyboard Tracking", 2, { {0, "0"}, {1, "1/4"}, {2, "1/2"}, {3, "Full"}})),
-		std::make_shared<KorgDW8000Parameter>(KorgDW8000Parameter(POLARITY, "VCF Envelope Polarity", 1, { {0, "Positive"}, { 1, "Negative"}})),
-		std::make_shared<KorgDW8000Parameter>(EG_INTENSITY, "VCF Env Intensity", 5),
-		std::make_shared<KorgDW8000Parameter>(VCF_ATTACK, "VCF Env Attack", 5),
-		std::make_shared<KorgDW8000Parameter>(VCF_DECAY, "VCF Env Decay", 5),
-		std::make_shared<KorgDW8000Parameter>(VCF_BREAK_POINT, "VCF Env Break Point", 5),
-		std::make_shared<KorgDW8000Parameter>(VCF_SLOPE, "VCF Env Slope", 5),
-		std::make_shared<KorgDW8000Parameter>(VCF_SUSTAIN, "VCF Env Sustain", 5),
-		std::make_shared<KorgDW8000Parameter>(VCF_RELEASE, "VCF Env Release", 5),
-		std::make_shared<KorgDW8000Parameter>(VCF_VELOCITY_SENSIVITY, "VCF Velocity Sensitivity", 3),
-		std::make_shared<KorgDW8000Parameter>(VCA_ATTACK, "VCA Env Attack", 5),
-		std::make_shared<KorgDW8000Parameter>(VCA_DECAY, "VCA Env Decay", 5),
-		std::make_shared<KorgDW8000Parameter>(VCA_BREAK_POINT, "VCA Env Break Point", 5),
-		std::make_shared<KorgDW8000Parameter>(VCA_SLOPE, "VCA Env Slope", 5),
-		std::make_shared<KorgDW8000Parameter>(VCA_SUSTAIN, "VCA Env Sustain", 5),
-		std::make_shared<KorgDW8000Parameter>(VCA_RELEASE, "VCA Env Release", 5),
-		std::make_shared<KorgDW8000Parameter>(VCA_VELOCITY_SENSIVITY, "VCA Velocity Sensitivity", 3),
-		std::make_shared<KorgDW8000Parameter>(KorgDW8000Parameter(MG_WAVE_FORM, "Modulation Wave Form", 2, {{0, "Triangle"}, {1, "Sawtooth"}, {2, "Inverse Saw"}, {3, "Square"}})),
-		std::make_shared<KorgDW8000Parameter>(MG_FREQUENCY, "Modulation Frequency", 5),
-		std::make_shared<KorgDW8000Parameter>(MG_DELAY, "Modulation Delay", 5),
-		std::make_shared<KorgDW8000Parameter>(MG_OSC, "Modulation Osc", 5),
-		std::make_shared<KorgDW8000Parameter>(MG_VCF, "Modulation VCF", 5),
-		std::make_shared<KorgDW8000Parameter>(BEND_OSC, "Pitch Bend Oscillators", 4, (uint8) 12),
-		std::make_shared<KorgDW8000Parameter>(KorgDW8000Parameter(BEND_VCF, "Pitch Bend VCF", 1, {{0, "On"}, {1, "Off"}})),
-		std::make_shared<KorgDW8000Parameter>(DELAY_TIME, "Delay Time", 3),
-		std::make_shared<KorgDW8000Parameter>(DELAY_FACTOR, "Delay Factor", 4),
-		std::make_shared<KorgDW8000Parameter>(DELAY_FEEDBACK, "Delay Feedback", 4),
-		std::make_shared<KorgDW8000Parameter>(DELAY_FREQUENCY, "Delay Frequency", 5),
-		std::make_shared<KorgDW8000Parameter>(DELAY_INTENSITY, "Delay Intensity", 5),
-		std::make_shared<KorgDW8000Parameter>(DELAY_EFFECT_LEVEL, "Delay Effect Level", 4),
-		std::make_shared<KorgDW8000Parameter>(PORTAMENTO, "Portamento", 5),
-		std::make_shared<KorgDW8000Parameter>(AFTER_TOUCH_OSC_MG, "Aftertouch Osc Modulation", 2),
-		std::make_shared<KorgDW8000Parameter>(AFTER_TOUCH_VCF, "Aftertouch VCF Modulation", 2),
-		std::make_shared<KorgDW8000Parameter>(AFTER_TOUCH_VCA, "Aftertouch VCA Modulation", 2)
-	};
+	namespace {
+
+		constexpr char const *cOctave[] = { "16", "8", "4" };
+		constexpr char const *cWaveform[] = { "Sawtooth", "Square", "Piano", "Electric piano 1", "Electric piano 2", "Clavinet",
+			"Organ", "Brass", "Sax", "Violin", "Guitar", "Electric guitar", "Bass", "Digital bass", "Bell and whistle", "Sine" };
+		constexpr char const *cAutoBendSelect[] = { "Off", "Osc1", "Osc2", "Both" };
+		constexpr char const *cAutoBendMode[] = { "Up", "Down" };
+		constexpr char const *cInterval[] = { "1", "-3 ST", "3 ST", "4 ST", "5 ST" };
+		constexpr char const *cAssignMode[] = { "Poly 1", "Poly 2", "Unison 1", "Unison 2" };
+		constexpr char const *cKeyboardTracking[] = { "0", "1/4", "1/2", "Full" };
+		constexpr char const *cPolarity[] = { "Positive", "Negative" };
+		constexpr char const *cModulationWaveForm[] = { "Triangle", "Sawtooth", "Inverse Saw", "Square" };
+		constexpr char const *cBendVCF[] = { "On", "Off" };
+
+		// Each parameter is a full data byte, the range is given by the number of bits used or an explicit maximum
+		constexpr PackedParameterField field(KorgDW8000Parameter::Parameter index, char const *name, int maxValue) {
+			return { index, 0, 8, 0, maxValue, name, nullptr, 0 };
+		}
 
-	std::shared_ptr<KorgDW8000Parameter> KorgDW8000Parameter::findParameter(Parameter param)
-	{
-		for (auto parm : allParameters) {
-			auto dw8000Param = std::dynamic_pointer_cast<KorgDW8000Parameter>(parm);
-			if (dw8000Param) {
-				if (dw8000Param->paramIndex_ == param) {
-					return dw8000Param;
+		template<size_t N>
+		constexpr PackedParameterField field(KorgDW8000Parameter::Parameter index, char const *name, int maxValue, char const *const (&valueNames)[N]) {
+			return { index, 0, 8, 0, maxValue, name, valueNames, static_cast<int>(N) };
+		}
+
+		constexpr int bits(int numberOfBits) {
+			return (1 << numberOfBits) - 1;
+		}
+
+		using P = KorgDW8000Parameter;
+
+		constexpr std::array<PackedParameterField, KorgDW8000Parameter::kNumberOfParameters> kLayout = { {
+			field(P::OSC1_OCTAVE, "Osc 1 Octave", 2, cOctave),
+			field(P::OSC1_WAVE_FORM, "Osc1 Wave Form", bits(4), cWaveform),
+			field(P::OSC1_LEVEL, "Osc 1 Level", bits(5)),
+			field(P::AUTO_BEND_SELECT, "Auto Bend Select", bits(2), cAutoBendSelect),
+			field(P::AUTO_BEND_MODE, "Auto Bend Mode", bits(1), cAutoBendMode),
+			field(P::AUTO_BEND_TIME, "Auto Bend Time", bits(5)),
+			field(P::AUTO_BEND_INTENSITY, "Auto Bend Intensity", bits(5)),
+			field(P::OSC2_OCTAVE, "Osc 2 Octave", 2, cOctave),
+			field(P::OSC2_WAVE_FORM, "Osc 2 Wave Form", bits(4), cWaveform),
+			field(P::OSC2_LEVEL, "Osc 2 Level", bits(5)),
+			field(P::INTERVAL, "Osc 2 Interval", 4, cInterval),
+			field(P::DETUNE, "Osc2 Detune", 6),
+			field(P::NOISE_LEVEL, "Noise Level", bits(5)),
+			field(P::ASSIGN_MODE, "Assign Mode", bits(2), cAssignMode),
+			field(P::PARAMETER_NO_MEMORY, "Default Parameter", 62),
+			field(P::CUTOFF, "Cutoff", bits(6)),
+			field(P::RESONANCE, "Resonance", bits(5)),
+			field(P::KBD_TRACK, "VCF Keyboard Tracking", bits(2), cKeyboardTracking),
+			field(P::POLARITY, "VCF Envelope Polarity", bits(1), cPolarity),
+			field(P::EG_INTENSITY, "VCF Env Intensity", bits(5)),
+			field(P::VCF_ATTACK, "VCF Env Attack", bits(5)),
+			field(P::VCF_DECAY, "VCF Env Decay", bits(5)),
+			field(P::VCF_BREAK_POINT, "VCF Env Break Point", bits(5)),
+			field(P::VCF_SLOPE, "VCF Env Slope", bits(5)),
+			field(P::VCF_SUSTAIN, "VCF Env Sustain", bits(5)),
+			field(P::VCF_RELEASE, "VCF Env Release", bits(5)),
+			field(P::VCF_VELOCITY_SENSIVITY, "VCF Velocity Sensitivity", bits(3)),
+			field(P::VCA_ATTACK, "VCA Env Attack", bits(5)),
+			field(P::VCA_DECAY, "VCA Env Decay", bits(5)),
+			field(P::VCA_BREAK_POINT, "VCA Env Break Point", bits(5)),
+			field(P::VCA_SLOPE, "VCA Env Slope", bits(5)),
+			field(P::VCA_SUSTAIN, "VCA Env Sustain", bits(5)),
+			field(P::VCA_RELEASE, "VCA Env Release", bits(5)),
+			field(P::VCA_VELOCITY_SENSIVITY, "VCA Velocity Sensitivity", bits(3)),
+			field(P::MG_WAVE_FORM, "Modulation Wave Form", bits(2), cModulationWaveForm),
+			field(P::MG_FREQUENCY, "Modulation Frequency", bits(5)),
+			field(P::MG_DELAY, "Modulation Delay", bits(5)),
+			field(P::MG_OSC, "Modulation Osc", bits(5)),
+			field(P::MG_VCF, "Modulation VCF", bits(5)),
+			field(P::BEND_OSC, "Pitch Bend Oscillators", 12),
+			field(P::BEND_VCF, "Pitch Bend VCF", bits(1), cBendVCF),
+			field(P::DELAY_TIME, "Delay Time", bits(3)),
+			field(P::DELAY_FACTOR, "Delay Factor", bits(4)),
+			field(P::DELAY_FEEDBACK, "Delay Feedback", bits(4)),
+			field(P::DELAY_FREQUENCY, "Delay Frequency", bits(5)),
+			field(P::DELAY_INTENSITY, "Delay Intensity", bits(5)),
+			field(P::DELAY_EFFECT_LEVEL, "Delay Effect Level", bits(4)),
+			field(P::PORTAMENTO, "Portamento", bits(5)),
+			field(P::AFTER_TOUCH_OSC_MG, "Aftertouch Osc Modulation", bits(2)),
+			field(P::AFTER_TOUCH_VCF, "Aftertouch VCF Modulation", bits(2)),
+			field(P::AFTER_TOUCH_VCA, "Aftertouch VCA Modulation", bits(2))
+		} };
+
+		constexpr bool layoutIsInParameterOrder() {
+			for (size_t i = 0; i < kLayout.size(); i++) {
+				if (kLayout[i].sysexIndex != static_cast<int>(i)) {
+					return false;
 				}
 			}
+			return true;
+		}
+		static_assert(layoutIsInParameterOrder(), "The DW 8000 layout must list the parameters by index, findParameter relies on it");
+
+		std::vector<std::shared_ptr<SynthParameterDefinition>> buildParameters() {
+			std::vector<std::shared_ptr<SynthParameterDefinition>> result;
+			for (auto const &field : kLayout) {
+				result.push_back(std::make_shared<KorgDW8000Parameter>(field));
+			}
+			return result;
+		}
+
+	}
+
+	std::vector<std::shared_ptr<SynthParameterDefinition>> KorgDW8000Parameter::allParameters = buildParameters();
+
+	std::shared_ptr<KorgDW8000Parameter> KorgDW8000Parameter::findParameter(Parameter param)
+	{
+		size_t index = static_cast<size_t>(param);
+		if (index < allParameters.size()) {
+			return std::dynamic_pointer_cast<KorgDW8000Parameter>(allParameters[index]);
 		}
 		return nullptr;
 	}
@@ -7,13 +7,12 @@
 #pragma once
 
 #include "SynthParameterDefinition.h"
+#include "ParameterTable.h"
 
 namespace midikraft {
 
 	class KorgDW8000Parameter : public SynthParameterDefinition, public SynthIntParameterCapability {
 	public:
-		typedef std::map<int, std::string> TValueLookup;
-
 		enum Parameter {
 			OSC1_OCTAVE = 0,
 			OSC1_WAVE_FORM = 1,
@@ -68,13 +67,13 @@ namespace midikraft {
 			AFTER_TOUCH_VCA = 50
 		};
 
+		static constexpr size_t kNumberOfParameters = 51;
+
+		// Built from the layout, in the order of the parameter index
 		static std::vector<std::shared_ptr<SynthParameterDefinition>> allParameters;
 		static std::shared_ptr <KorgDW8000Parameter> findParameter(Parameter param);
 
-		KorgDW8000Parameter(Parameter const paramIndex, std::string const &name, int bits);
-		KorgDW8000Parameter(Parameter const paramIndex, std::string const &name, int bits, uint8 maxValue);
-		KorgDW8000Parameter(Parameter const paramIndex, std::string const &name, int bits, TValueLookup const &valueLookup);
-		KorgDW8000Parameter(Parameter const paramIndex, std::string const &name, int bits, uint8 maxValue, TValueLookup const &valueLookup);
+		explicit KorgDW8000Parameter(PackedParameterField const &field);
         KorgDW8000Parameter(KorgDW8000Parameter const& other) = default;
         virtual ~KorgDW8000Parameter() = default;
 
@@ -95,10 +94,7 @@ namespace midikraft {
 		std::string valueAsText(int value) const;
 		
 	private:
-		Parameter paramIndex_; // In the DW8000, this is really a list of 51 consecutive parameter bytes, no lookup necessary
-		std::string parameterName_;
-		uint8 maxValue_;
-		TValueLookup valueLookup_;
+		PackedParameterField const &field_; // In the DW8000, this is really a list of 51 consecutive parameter bytes, no lookup necessary
 	};
 
 }
@@ -20,7 +20,9 @@
 //#include "BCR2000.h"
 
 #include "MidiHelpers.h"
+#include "SysexCodecs.h"
 
+#include <algorithm>
 #include <set>
 //#include "BCR2000_Presets.h"
 
@@ -208,18 +210,36 @@ namespace midikraft {
 	{
 		// The Matrix1000 either sends Edit Buffers as Program Dumps, or it is a Single Patch Data to Edit Buffer message, which the M1k will never generate on its own, 
 		// but we will when we save data to disk.
-		return isSingleProgramDump(message) || 
-			(message.size() == 1 && isOwnSysex(message[0]) && MidiHelpers::isSysexMessageMatching(message[0], { {2, MIDI_COMMAND.SINGLE_PATCH_TO_EDIT_BUFFER}, { 3, (uint8)0x00} }));
+		return message.size() == 1 && isEditBufferMessage(message[0]);
+	}
+
+	bool Matrix1000::isEditBufferMessage(MidiMessage const &message) const
+	{
+		return isProgramDumpMessage(message) ||
+			(isOwnSysex(message) && MidiHelpers::isSysexMessageMatching(message, { {2, MIDI_COMMAND.SINGLE_PATCH_TO_EDIT_BUFFER}, { 3, (uint8)0x00} }));
 	}
 
 
 	bool Matrix1000::isSingleProgramDump(const std::vector<MidiMessage>& message) const
 	{
-		return message.size() == 1 && isOwnSysex(message[0])
-			&& message[0].getSysExDataSize() > 3
-			&& message[0].getSysExData()[2] == MIDI_COMMAND.SINGLE_PATCH_DATA
-			// && message[0].getSysExData()[3] >= 0x00 Always true
-			&& message[0].getSysExData()[3] < 100; // Should be a valid program number in this bank
+		return message.size() == 1 && isProgramDumpMessage(message[0]);
+	}
+
+	bool Matrix1000::isProgramDumpMessage(MidiMessage const &message) const
+	{
+		return isOwnSysex(message)
+			&& message.getSysExDataSize() > 3
+			&& message.getSysExData()[2] == MIDI_COMMAND.SINGLE_PATCH_DATA
+			// && message.getSysExData()[3] >= 0x00 Always true
+			&& message.getSysExData()[3] < 100; // Should be a valid program number in this bank
+	}
+
+	std::shared_ptr<DataFile> Matrix1000::patchFromDumpMessage(MidiMessage const &message) const
+	{
+		// Both the program dump and the edit buffer message have the program number at 3 and the data from 4 on. Only the
+		// unescaped patch data is copied, the message itself can be dropped afterwards
+		MidiProgramNumber place = isProgramDumpMessage(message) ? MidiProgramNumber::fromZeroBase(message.getSysExData()[3]) : MidiProgramNumber::invalidProgram();
+		return std::make_shared<Matrix1000Patch>(unescapeSysex(&message.getSysExData()[4], message.getSysExDataSize() - 4), place);
 	}
 
 	MidiProgramNumber Matrix1000::getProgramNumber(const std::vector<MidiMessage>&message) const
@@ -283,51 +303,69 @@ namespace midikraft {
 	{
 		switch (streamType) {
 		case StreamLoadCapability::StreamType::BANK_DUMP:
-			return isSingleProgramDump({ message }) || isSplitPatch(message) || globalSettingsLoader_->isDataFile(message, 0);
+			return isProgramDumpMessage(message) || isSplitPatch(message) || globalSettingsLoader_->isDataFile(message, 0);
 		case StreamLoadCapability::StreamType::EDIT_BUFFER_DUMP:
-			return isEditBufferDump({ message });
+			return isEditBufferMessage(message);
 		default:
 			return false;
 		}
 	}
 
-	bool Matrix1000::isStreamComplete(std::vector<MidiMessage> const &messages, StreamType streamType) const
+	void Matrix1000::countStreamMessage(MidiMessage const &message, StreamCounts &counts) const
 	{
-		// Count the number of patch dumps in that stream
-		int found = 0;
-		int split = 0;
-		int master = 0;
-		int editbuffer = 0;
-		for (auto message : messages) {
-			switch (streamType) {
-			case midikraft::StreamLoadCapability::StreamType::BANK_DUMP:
-				if (isSingleProgramDump({ message })) {
-					found++;
-				}
-				else if (isSplitPatch(message)) {
-					split++;
-				}
-				else if (globalSettingsLoader_->isDataFile(message, 0 /* TODO this is ignored */)) {
-					master++;
-				}
-				break;
-			case midikraft::StreamLoadCapability::StreamType::EDIT_BUFFER_DUMP:
-				if (isEditBufferDump({ message })) {
-					editbuffer++;
-				}
-				break;
-			default:
-				break;
+		switch (counts.streamType) {
+		case midikraft::StreamLoadCapability::StreamType::BANK_DUMP:
+			if (isProgramDumpMessage(message)) {
+				counts.found++;
+			}
+			else if (isSplitPatch(message)) {
+				counts.split++;
+			}
+			else if (globalSettingsLoader_->isDataFile(message, 0 /* TODO this is ignored */)) {
+				counts.master++;
 			}
+			break;
+		case midikraft::StreamLoadCapability::StreamType::EDIT_BUFFER_DUMP:
+			if (isEditBufferMessage(message)) {
+				counts.editbuffer++;
+			}
+			break;
+		default:
+			break;
+		}
+	}
+
+	bool Matrix1000::isStreamComplete(std::vector<MidiMessage> const &messages, StreamType streamType) const
+	{
+		// Count the number of patch dumps in that stream, continuing from the last call if this is the same stream grown by more messages
+		std::lock_guard<std::mutex> guard(streamCountsLock_);
+		auto &counts = streamCounts_;
+		bool sameStream = counts.streamType == streamType && counts.counted > 0 && counts.counted <= messages.size();
+		if (sameStream) {
+			auto const &last = messages[counts.counted - 1];
+			sameStream = static_cast<size_t>(last.getRawDataSize()) == counts.lastCounted.size()
+				&& std::equal(counts.lastCounted.begin(), counts.lastCounted.end(), last.getRawData());
+		}
+		if (!sameStream) {
+			counts = StreamCounts();
+			counts.streamType = streamType;
+		}
+		for (size_t i = counts.counted; i < messages.size(); i++) {
+			countStreamMessage(messages[i], counts);
 		}
+		counts.counted = messages.size();
+		if (!messages.empty()) {
+			counts.lastCounted.assign(messages.back().getRawData(), messages.back().getRawData() + messages.back().getRawDataSize());
+		}
+
 		switch (streamType)
 		{
 		case midikraft::StreamLoadCapability::StreamType::EDIT_BUFFER_DUMP:			
-			return editbuffer > 0;
+			return counts.editbuffer > 0;
 		case midikraft::StreamLoadCapability::StreamType::BANK_DUMP:
 			// The documentation found in the Internet on the split patches is wrong. It states the Matrix 1000 sends 50, but in reality it sends 0x50 = 80. That is a strange number.
 			// Bob from Tauntek confirmed the assembler code of the M1K uses $50, so that error probably has been there since the 80s.
-			return found == numberOfPatches() && split == 0x50 && master > 0;
+			return counts.found == numberOfPatches() && counts.split == 0x50 && counts.master > 0;
 		default:
 			return true;
 		}
@@ -343,16 +381,22 @@ namespace midikraft {
 	midikraft::TPatchVector Matrix1000::loadPatchesFromStream(std::vector<MidiMessage> const &sysexMessages) const
 	{
 		TPatchVector result;
-		for (auto message : sysexMessages) {
-			if (isSingleProgramDump({ message })) {
-				result.push_back(patchFromProgramDumpSysex({ message }));
+		result.reserve(static_cast<size_t>(numberOfPatches()));
+		for (auto const &message : sysexMessages) {
+			if (isSplitPatch(message)) {
+				// Ignore the fake split patches, checked first as they are almost half of a bank dump
+				continue;
 			}
-			else if (isEditBufferDump({ message })) {
+			// Classify the message in place, wrapping each one into a vector for the capability functions would copy all of them
+			if (isProgramDumpMessage(message)) {
+				result.push_back(patchFromDumpMessage(message));
+			}
+			else if (isEditBufferMessage(message)) {
 				// This code will be reached for the message format "single patch data to edit buffer", which the M1k will never generate, but I will
-				result.push_back(patchFromSysex({ message }));
+				result.push_back(patchFromDumpMessage(message));
 			}
-			else if (isSplitPatch(message) || globalSettingsLoader_->isDataFile(message, 0)) {
-				// Ignore other messages like global settings and fake split patches
+			else if (globalSettingsLoader_->isDataFile(message, 0)) {
+				// Ignore other messages like global settings
 			}
 			else {
 				spdlog::info("Matrix 1000: Ignoring sysex message found, not implemented: {}", message.getDescription());
@@ -557,25 +601,20 @@ namespace midikraft {
 
 	Synth::PatchData Matrix1000::unescapeSysex(const uint8 *sysExData, int sysExLen) const
 	{
-		Synth::PatchData result;
-
 		// The Matrix 1000 does two things: Calculate a checksum (yes, it's a sum) and pack each byte into two nibbles. That's not really
 		// data efficient, but hey, a 2 MHz 8-bit CPU must be able to pack and unpack that at MIDI speed!
-		uint8 checksum = 0;
-		for (int index = 0; index < sysExLen; ) {
-			// Read one more data byte from two bytes
-			uint8 byte = (uint8)((int)sysExData[index] | sysExData[index + 1] << 4);
-			result.push_back(byte);
-			checksum += byte;
-			index += 2;
-			if (index == sysExLen - 1) {
-				// This is the checksum!
-				if (sysExData[index] != (checksum & 0x7f)) {
-					// Invalid checksum, don't use this
-					result.clear();
-					return result;
-				}
-				index++;
+		size_t packedSize = sysExLen > 0 ? (size_t)sysExLen : 0;
+		Synth::PatchData result(SysexCodecs::nibblesUnpackedSize(packedSize));
+		SysexCodecs::unpackNibbles(sysExData, packedSize, result.data());
+		if (packedSize % 2 == 1) {
+			// The odd byte at the end is the checksum!
+			uint8 checksum = 0;
+			for (auto byte : result) {
+				checksum += byte;
+			}
+			if (sysExData[packedSize - 1] != (checksum & 0x7f)) {
+				// Invalid checksum, don't use this
+				result.clear();
 			}
 		}
 		return result;
@@ -583,15 +622,14 @@ namespace midikraft {
 
 	std::vector<juce::uint8> Matrix1000::escapeSysex(const PatchData &programEditBuffer) const
 	{
-		std::vector<uint8> result;
 		// We generate the nibbles and the checksum
+		std::vector<uint8> result(SysexCodecs::nibblesPackedSize(programEditBuffer.size()) + 1);
+		SysexCodecs::packNibbles(programEditBuffer.data(), programEditBuffer.size(), result.data());
 		int checksum = 0;
-		for (size_t i = 0; i < programEditBuffer.size(); i++) {
-			checksum += programEditBuffer[i];
-			result.push_back(programEditBuffer[i] & 0x0f);
-			result.push_back((programEditBuffer[i] & 0xf0) >> 4);
+		for (auto byte : programEditBuffer) {
+			checksum += byte;
 		}
-		result.push_back(checksum & 0x7f);
+		result.back() = (uint8)(checksum & 0x7f);
 		return result;
 	}
 
@@ -20,6 +20,8 @@
 
 #include "MidiController.h"
 
+#include <mutex>
+
 namespace midikraft {
 
 	class Matrix1000_GlobalSettings_Loader;
@@ -121,8 +123,27 @@ namespace midikraft {
 		MidiMessage createBankSelect(MidiBankNumber bankNo) const;
 		MidiMessage createBankUnlock() const;
 
+		// The single message tests behind the capability functions, for the stream code which looks at one message at a time
+		bool isProgramDumpMessage(MidiMessage const &message) const;
+		bool isEditBufferMessage(MidiMessage const &message) const;
+		std::shared_ptr<DataFile> patchFromDumpMessage(MidiMessage const &message) const;
+
 		MidiController::HandlerHandle matrixBCRSyncHandler_ = MidiController::makeNoneHandle();
 
+		// isStreamComplete() is asked again with every message arriving. As the stream only grows, only the new messages are classified
+		struct StreamCounts {
+			StreamType streamType = StreamType::BANK_DUMP;
+			size_t counted = 0;
+			std::vector<uint8> lastCounted; // Raw bytes of the last message counted, to recognize a different stream of the same length
+			int found = 0;
+			int split = 0;
+			int master = 0;
+			int editbuffer = 0;
+		};
+		void countStreamMessage(MidiMessage const &message, StreamCounts &counts) const;
+		mutable std::mutex streamCountsLock_;
+		mutable StreamCounts streamCounts_;
+
 		// This listener implements sending update messages via NRPN when any of the global settings is changed via the UI
 		class GlobalSettingsListener : public ValueTree::Listener {
 		public:
@@ -93,6 +93,16 @@ namespace midikraft {
 	}
 
 	bool Matrix1000ParamDefinition::valueInPatch(DataFile const &patch, int &outValue) const
+	{
+		// Patches decode all parameters once, and then answer from the decoded view until their data changes
+		auto matrix1000Patch = dynamic_cast<Matrix1000Patch const *>(&patch);
+		if (matrix1000Patch) {
+			return matrix1000Patch->decodedValue(paramId_, outValue);
+		}
+		return extractFromPatch(patch, outValue);
+	}
+
+	bool Matrix1000ParamDefinition::extractFromPatch(DataFile const &patch, int &outValue) const
 	{
 		// For this to work, this parameter must have a sysex definition
 		if (sysexIndex_ == -1 || sysexIndex_ >= static_cast<int>(patch.data().size())) {
@@ -112,18 +122,56 @@ namespace midikraft {
 		return true;
 	}
 
+	namespace {
+
+		// Lookup tables into allDefinitions, built on first use. The definitions are never modified after static initialization
+		struct DefinitionIndex {
+			DefinitionIndex() : byId(LAST, nullptr), bySysexIndex(256, nullptr) {
+				for (auto param : Matrix1000ParamDefinition::allDefinitions) {
+					auto matrix1000param = std::dynamic_pointer_cast<Matrix1000ParamDefinition>(param);
+					if (!matrix1000param) {
+						continue;
+					}
+					if (!byId[matrix1000param->id()]) {
+						byId[matrix1000param->id()] = matrix1000param.get();
+					}
+					int sysexIndex = matrix1000param->sysexIndex();
+					if (sysexIndex >= 0 && sysexIndex < static_cast<int>(bySysexIndex.size()) && !bySysexIndex[sysexIndex]) {
+						bySysexIndex[sysexIndex] = matrix1000param.get();
+					}
+				}
+			}
+
+			std::vector<Matrix1000ParamDefinition const *> byId;
+			std::vector<Matrix1000ParamDefinition const *> bySysexIndex;
+		};
+
+		DefinitionIndex const &definitionIndex() {
+			static DefinitionIndex index;
+			return index;
+		}
+
+	}
+
 	SynthParameterDefinition const & Matrix1000ParamDefinition::param(Matrix1000Param id)
 	{
-		// For now, just scan the table
-		for (auto param : allDefinitions) {
-			auto matrix100param = std::dynamic_pointer_cast<Matrix1000ParamDefinition>(param);
-			if (matrix100param->paramId_ == id) {
-				return *param;
-			}
+		auto const &index = definitionIndex().byId;
+		size_t position = static_cast<size_t>(id);
+		if (position < index.size() && index[position]) {
+			return *index[position];
 		}
 		throw new std::runtime_error("Invalid Matrix 1000 param ID");
 	}
 
+	Matrix1000ParamDefinition const *Matrix1000ParamDefinition::bySysexIndex(int sysexIndex)
+	{
+		auto const &index = definitionIndex().bySysexIndex;
+		if (sysexIndex >= 0 && sysexIndex < static_cast<int>(index.size())) {
+			return index[sysexIndex];
+		}
+		return nullptr;
+	}
+
 	midikraft::SynthParameterDefinition::ParamType Matrix1000ParamDefinition::type() const
 	{
 		return SynthParameterDefinition::ParamType::INT;
@@ -236,13 +284,12 @@ namespace midikraft {
 
 	// Helper function required while refactoring to midikraft code
 	static int valueBySysexIndex(DataFile const &patch, int sysexIndex) {
-		auto matrix1000Patch = dynamic_cast<Matrix1000Patch const *>(&patch);
-		if (matrix1000Patch) {
-			return matrix1000Patch->value(matrix1000Patch->paramBySysexIndex(sysexIndex));
-		}
-		else {
-			return -1;
+		auto param = Matrix1000ParamDefinition::bySysexIndex(sysexIndex);
+		int value;
+		if (param && param->valueInPatch(patch, value)) {
+			return value;
 		}
+		return -1;
 	}
 
 	std::vector<std::shared_ptr<SynthParameterDefinition>> Matrix1000ParamDefinition::allDefinitions = {
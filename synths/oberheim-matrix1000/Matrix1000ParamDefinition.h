@@ -227,10 +227,14 @@ namespace midikraft {
 		virtual int maxValue() const override;
 		virtual int sysexIndex() const override;
 		virtual bool valueInPatch(DataFile const &patch, int &outValue) const override;
+		// Reads the value from the raw bytes, bypassing the decoded view of a Matrix1000Patch
+		bool extractFromPatch(DataFile const &patch, int &outValue) const;
 
 		virtual bool isActive(DataFile const *patch) const override;
 
 		static SynthParameterDefinition const &param(Matrix1000Param id);
+		// The first definition stored at this sysex index, or nullptr
+		static Matrix1000ParamDefinition const *bySysexIndex(int sysexIndex);
 
 	private:
 		std::string valueAsText(int value) const;
@@ -81,6 +81,37 @@ namespace midikraft {
 		return number_;
 	}
 
+	Matrix1000Patch::DecodedView &Matrix1000Patch::DecodedView::operator=(DecodedView const &)
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		decodedFrom.clear();
+		return *this;
+	}
+
+	bool Matrix1000Patch::decodedValue(Matrix1000Param id, int &outValue) const
+	{
+		std::lock_guard<std::mutex> guard(decoded_.lock);
+		if (decoded_.values.empty() || decoded_.decodedFrom != data()) {
+			decoded_.values.assign(LAST, 0);
+			decoded_.present.assign(LAST, false);
+			for (auto param : Matrix1000ParamDefinition::allDefinitions) {
+				auto matrix1000param = std::dynamic_pointer_cast<Matrix1000ParamDefinition>(param);
+				int value;
+				if (matrix1000param && matrix1000param->extractFromPatch(*this, value)) {
+					decoded_.values[matrix1000param->id()] = value;
+					decoded_.present[matrix1000param->id()] = true;
+				}
+			}
+			decoded_.decodedFrom = data();
+		}
+		size_t position = static_cast<size_t>(id);
+		if (position < decoded_.values.size() && decoded_.present[position]) {
+			outValue = decoded_.values[position];
+			return true;
+		}
+		return false;
+	}
+
 	int Matrix1000Patch::value(SynthParameterDefinition const &param) const
 	{
 		int result;
@@ -93,18 +124,19 @@ namespace midikraft {
 
 	int Matrix1000Patch::param(Matrix1000Param id) const
 	{
-		auto &param = Matrix1000ParamDefinition::param(id);
-		return value(param);
+		int result;
+		if (decodedValue(id, result)) {
+			return result;
+		}
+		throw new std::runtime_error("Invalid parameter");
 	}
 
 	SynthParameterDefinition const & Matrix1000Patch::paramBySysexIndex(int sysexIndex) const 
 	{
-		for (auto param : Matrix1000ParamDefinition::allDefinitions) {
-			auto intParam = midikraft::Capability::hasCapability<SynthIntParameterCapability>(param);
-			if (intParam && intParam->sysexIndex() == sysexIndex) {
-				//! TODO- this is a bad way to address the parameters, as this is not uniquely defined
-				return *param;
-			}
+		//! TODO- this is a bad way to address the parameters, as this is not uniquely defined
+		auto param = Matrix1000ParamDefinition::bySysexIndex(sysexIndex);
+		if (param) {
+			return *param;
 		}
 		throw new std::runtime_error("Bogus call");
 	}
@@ -12,6 +12,8 @@
 
 #include "Matrix1000ParamDefinition.h"
 
+#include <mutex>
+
 namespace midikraft {
 
 	class Matrix1000Patch : public Patch, public StoredPatchNameCapability, public DefaultNameCapability, public DetailedParametersCapability {
@@ -36,8 +38,24 @@ namespace midikraft {
 
 		virtual std::vector<std::shared_ptr<SynthParameterDefinition>> allParameterDefinitions() const override;
 
+		// All parameters are decoded once into a flat array, which is rebuilt when the patch data has changed
+		bool decodedValue(Matrix1000Param id, int &outValue) const;
+
 	private:
+		// Copies of a patch start with an empty view, as the mutex can't be copied
+		struct DecodedView {
+			DecodedView() = default;
+			DecodedView(DecodedView const &) {}
+			DecodedView &operator=(DecodedView const &);
+
+			std::mutex lock;
+			Synth::PatchData decodedFrom;
+			std::vector<int> values;
+			std::vector<bool> present;
+		};
+
 		MidiProgramNumber number_;
+		mutable DecodedView decoded_;
 	};
 
 }
@@ -15,6 +15,8 @@
 
 #include "spdlog/spdlog.h"
 
+#include <algorithm>
+
 namespace midikraft {
 
 	// Definitions from the manual, see p. 62ff
@@ -132,26 +134,7 @@ namespace midikraft {
 	std::shared_ptr<DataFile> MKS50::patchFromSysex(const std::vector<MidiMessage>& message) const
 	{
 		if (isEditBufferDump(message)) {
-			switch (message[0].getSysExData()[4])
-			{
-			case 0b00100000: /* Level 1 */
-				if (message[0].getSysExData()[5] == 1 /* Group ID*/) {
-					return MKS50_Patch::createFromToneAPR(message[0]);
-				}
-				else {
-					jassert(false);
-					spdlog::error("Group ID is not 1, probably corrupt file. Ignoring this APR package.");
-				}
-			case 0b00110000: /* Level 2 */
-				spdlog::warn("Ignoring patch data for now, looking for tone data!");
-				break;
-			case 0b01000000: /* Level 3 */
-				spdlog::warn("Ignoring chord data for now, looking for tone data!");
-				break;
-			default:
-				jassert(false);
-				spdlog::error("Unknown level in APR package, probably corrupt file. Ignoring this APR package.");
-			}
+			return toneFromAPR(message[0]);
 		}
 		return std::shared_ptr<MKS50_Patch>();
 	}
@@ -206,6 +189,8 @@ namespace midikraft {
 
 		bool done;
 		MidiMessage previousMessage;
+		MidiMessage ack;
+		MidiMessage rjc;
 		bool isBulkDump;
 		int numWSF;
 		bool success;
@@ -214,7 +199,10 @@ namespace midikraft {
 
 	std::shared_ptr<HandshakeLoadingCapability::ProtocolState> MKS50::createStateObject()
 	{
-		return std::make_shared<MKS50HandshakeState>();
+		auto state = std::make_shared<MKS50HandshakeState>();
+		state->ack = buildHandshakingMessage(MKS50_Operation_Code::ACK);
+		state->rjc = buildHandshakingMessage(MKS50_Operation_Code::RJC);
+		return state;
 	}
 
 	void MKS50::startDownload(std::shared_ptr<SafeMidiOutput> output, std::shared_ptr<ProtocolState> saveState)
@@ -248,32 +236,32 @@ namespace midikraft {
 			case MKS50_Operation_Code::WSF:
 				if (s->numWSF > 2) {
 					// This is more than 2 WSF, reject
-					answer = { buildHandshakingMessage(MKS50_Operation_Code::RJC) };
+					answer = { s->rjc };
 					s->done = true;
 					return false;
 				}
 				s->numWSF++;
-				answer = { buildHandshakingMessage(MKS50_Operation_Code::ACK) };
+				answer = { s->ack };
 				return false;
 			case MKS50_Operation_Code::DAT:
 				if (s->numWSF < 1) {
 					// This is data without a WSF first, reject
-					answer = { buildHandshakingMessage(MKS50_Operation_Code::RJC) };
+					answer = { s->rjc };
 					s->done = true;
 					return false;
 				}
 				// This data package is part of the proper data, acknowledge and return true so the data is kept
-				answer = { buildHandshakingMessage(MKS50_Operation_Code::ACK) };
+				answer = { s->ack };
 				s->dataPackages++;
 				return true;
 			case MKS50_Operation_Code::RQF:
 				// If RQF comes during a download, something is really wrong. 
 				s->done = true;
-				answer = { buildHandshakingMessage(MKS50_Operation_Code::RJC) };
+				answer = { s->rjc };
 				return false;
 			case MKS50_Operation_Code::EOF_:
 				// The MKS50 thinks it is done and wants an ACK for that
-				answer = { buildHandshakingMessage(MKS50_Operation_Code::ACK) };
+				answer = { s->ack };
 				s->done = true;
 				s->success = s->dataPackages == 16;
 				return false;
@@ -294,168 +282,221 @@ namespace midikraft {
 
 	TPatchVector MKS50::loadSysex(std::vector<MidiMessage> const& sysexMessages)
 	{
-		// Now, the MKS50 has three different formats: The BLD format from single-way dumps, the DAT format from two-way dumps, and the APR format 
-		TPatchVector result;
-		int datPackageCounter = 0;
-		for (auto message : sysexMessages) {
-			if (isOwnSysex(message)) {
-				switch (getSysexOperationCode(message)) {
-				case MKS50_Operation_Code::BLD:
-					// This is a bulk dump message
-					switch (message.getSysExData()[4]) {
-					case 0b00100000:
-						// Level 1, Tone Dump
-						if (message.getSysExData()[5] == 0x01 /* Required group 1 */) {
-							if (message.getSysExData()[6] == 0x00 /* Documentation says "program number extension" and requires it to be 0? */) {
-								spdlog::debug(fmt::format("Found tone data block starting at #{}", (int)message.getSysExData()[7]));
-								for (int patch = 0; patch < 4; patch++) {
-									std::vector<uint8> patchData;
-									for (int i = 0; i < 64; i += 2) {
-										int index = 8 + patch * 64 + i;
-										uint8 nibble1 = message.getSysExData()[index];
-										uint8 nibble2 = message.getSysExData()[index + 1];
-										patchData.push_back((uint8)(nibble1 | (nibble2 << 4)));
-									}
-									auto newPatch = MKS50_Patch::createFromToneBLD(MidiProgramNumber::fromZeroBase(message.getSysExData()[7] + patch), patchData);
-									result.push_back(newPatch);
-									spdlog::debug("Found tone " + newPatch->name());
-								}
-							}
-							else {
-								spdlog::error("Program Number extension is not 0");
-								return TPatchVector();
-							}
-						}
-						else {
-							spdlog::error("Group is not set to 1");
-							return TPatchVector();
-						}
-						break;
-					case 0b00110000:
-						// Level 2, Patch Dump, MKS-50 only (no Alpha Juno)
-						if (message.getSysExData()[5] == 0x01 /* Required group 1 */) {
-							if (message.getSysExData()[6] == 0x00 /* Documentation says "program number extension" and requires it to be 0? */) {
-								spdlog::debug("Found patch data block starting at #{}", (int)message.getSysExData()[7]);
-								for (int patch = 0; patch < 4; patch++) {
-									std::vector<uint8> patchData;
-									for (int i = 0; i < 64; i += 2) {
-										int index = 8 + patch * 64 + i;
-										uint8 nibble1 = message.getSysExData()[index];
-										uint8 nibble2 = message.getSysExData()[index + 1];
-										patchData.push_back((uint8)(nibble1 | (nibble2 << 4)));
-									}
-									//TODO - not loading patch data for now, all I am interested in is whether the program name is also blanked out with AAAAAAAAAA
-									std::string patchName;
-									for (size_t i = 11; i < 20; i++) {
-										//TODO use global variable
-										const std::string kPatchNameChar = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789 -";
-										patchName.push_back(kPatchNameChar[patchData[i] & 0b00111111]);
-									}
-									spdlog::debug("Found patch data for tone " + patchName);
-								}
-							}
-							else {
-								spdlog::error("Program Number extension is not 0");
-								return TPatchVector();
-							}
-						}
-						else {
-							spdlog::error("Group is not set to 1");
-							return TPatchVector();
-						}
-						break;
-					case 0b01000000:
-						// Level 3, Chord Memory Dump, MKS-50 only and for now ignored
-						break;
-					default:
-						spdlog::error("Unknown Level in BLD package");
-						return TPatchVector();
-					}
-					break;
-				case MKS50_Operation_Code::DAT:
-					// This is a DAT message, part of a bulk dump created with handshake. Very similar to the BLD message.
-					switch (message.getSysExDataSize()) {
-					case 256 + 5: {
-						// This is either a tone or a patch block - which one, we can only figure out via context in the message stream!
-						// In this mode there is a checksum!
-						uint8 checksum = 0;
-						for (int i = 4; i < 256 + 4; i++) {
-							checksum = (checksum + message.getSysExData()[i]) & 0x7f;
-						}
-						if (((checksum + message.getSysExData()[256 + 4]) & 0x7f) != 0) {
-							Sysex::saveSysex("failed_checksum.bin", { message });
-							jassert(false);
-							spdlog::error("Checksum error, aborting!");
-							return result;
-						}
-
-						if (datPackageCounter < 16) {
-							// Must be a tone block
-							for (int patch = 0; patch < 4; patch++) {
-								std::vector<uint8> patchData;
-								for (int i = 0; i < 64; i += 2) {
-									int index = 4 + patch * 64 + i;
-									uint8 nibble1 = message.getSysExData()[index];
-									uint8 nibble2 = message.getSysExData()[index + 1];
-									patchData.push_back((uint8)(nibble1 | (nibble2 << 4)));
-								}
-								auto newPatch = MKS50_Patch::createFromToneDAT(MidiProgramNumber::fromZeroBase(datPackageCounter * 4 + patch), patchData);
-								if (newPatch) {
-									if (newPatch->name() == "AAAAAAAAAA") {
-										// This is the only indicator we have that you are actually trying to load patch data instead of tone data. The engineers must have found this problem
-										// only late in the game, because it doesn't make any sense. There is a tip from the internet which now completely makes sense:
-										//
-										// There is also an undocumented shortcut to quickly transfer all of the Tone names in Tone Group 'b' to Patch Group 'B' however, it will erase all of the Tones in Tone Group 'a' and restore them to the factory defaults
-										// 1) Load a bank of Tones into Tone Group 'b' then hold the[4] + [8] buttons during the next power - up
-										// 2) All Group 'b' Tone names will overwrite all Group 'B' Patch names leaving all the Tone Group 'b' data intact
-										//
-										// This is what you will need to do if you used the handshake mode to transfer data from synth A to B
-										spdlog::error("This is actually patch data, not tone data. Make sure to use the Bulk Dump [T-a] function and not [P-A]. Aborting!");
-										return result;
-									}
-									else {
-										result.push_back(newPatch);
-										spdlog::debug("Found tone {}", newPatch->name());
-									}
-								}
-								else {
-									jassert(false);
-								}
-							}
-						}
-						else {
-							// Must be a patch block
-							//TODO - this is not correct, in case you have saved patch and tone data into different files...
-							spdlog::warn("Ignoring patch definition part of patch dump (for now)");
-						}
-						datPackageCounter++;
-						break;
+		// Now, the MKS50 has three different formats: The BLD format from single-way dumps, the DAT format from two-way dumps, and the APR format.
+		// Each message is looked at once and handed to the loader of its format, which appends the tones found to the state
+		static const std::pair<MKS50_Operation_Code, TBlockLoader> kLoaders[] = {
+			{ MKS50_Operation_Code::BLD, &loadBLD },
+			{ MKS50_Operation_Code::DAT, &loadDAT },
+			{ MKS50_Operation_Code::APR, &loadAPR },
+		};
+
+		LoadState state;
+		// At most 4 tones per message, so this is the only allocation of the result
+		state.result.reserve(sysexMessages.size() * static_cast<size_t>(kTonesPerBlock));
+		state.logDetails = spdlog::default_logger_raw()->should_log(spdlog::level::debug);
+		for (auto const &message : sysexMessages) {
+			if (!isOwnSysex(message)) {
+				continue;
+			}
+			auto code = getSysexOperationCode(message);
+			auto loader = std::find_if(std::begin(kLoaders), std::end(kLoaders), [code](std::pair<MKS50_Operation_Code, TBlockLoader> const &entry) { return entry.first == code; });
+			if (loader == std::end(kLoaders)) {
+				jassertfalse;
+				continue;
+			}
+			switch (loader->second(message, state)) {
+			case LoadResult::Continue:
+				break;
+			case LoadResult::Stop:
+				return state.result;
+			case LoadResult::Discard:
+				return TPatchVector();
+			}
+		}
+		return state.result;
+	}
+
+	MKS50::LoadResult MKS50::loadBLD(MidiMessage const &message, LoadState &state)
+	{
+		// This is a bulk dump message, level, group, program number extension and the first program number come before the nibbles
+		auto data = message.getSysExData();
+		if (message.getSysExDataSize() < 5) {
+			spdlog::warn("Ignoring BLD package that is too short");
+			return LoadResult::Continue;
+		}
+		uint8 level = data[4];
+		if (level == 0b01000000) {
+			// Level 3, Chord Memory Dump, MKS-50 only and for now ignored. Its blocks are shorter than those of tones and patches
+			return LoadResult::Continue;
+		}
+		if (level != 0b00100000 && level != 0b00110000) {
+			spdlog::error("Unknown Level in BLD package");
+			return LoadResult::Discard;
+		}
+		if (message.getSysExDataSize() < 8 + kTonesPerBlock * kNibblesPerTone) {
+			spdlog::warn("Ignoring BLD package that is too short");
+			return LoadResult::Continue;
+		}
+		if (data[5] != 0x01 /* Required group 1 */) {
+			spdlog::error("Group is not set to 1");
+			return LoadResult::Discard;
+		}
+		if (data[6] != 0x00 /* Documentation says "program number extension" and requires it to be 0? */) {
+			spdlog::error("Program Number extension is not 0");
+			return LoadResult::Discard;
+		}
+
+		if (level == 0b00100000) {
+			// Level 1, Tone Dump
+			if (state.logDetails) {
+				spdlog::debug("Found tone data block starting at #{}", (int)data[7]);
+			}
+			for (int tone = 0; tone < kTonesPerBlock; tone++) {
+				unpackNibbles(data + 8 + tone * kNibblesPerTone, state.block);
+				auto newPatch = MKS50_Patch::createFromToneBLD(MidiProgramNumber::fromZeroBase(data[7] + tone), state.block);
+				if (newPatch) {
+					state.result.push_back(newPatch);
+					if (state.logDetails) {
+						spdlog::debug("Found tone {}", newPatch->name());
 					}
-					case 192 + 5:
-						// This is a chord memory block
-						spdlog::debug("Ignoring chord memory definition part of patch dump");
-						break;
-					default:
+				}
+			}
+		}
+		else if (state.logDetails) {
+			// Level 2, Patch Dump, MKS-50 only (no Alpha Juno)
+			//TODO - not loading patch data for now, all I am interested in is whether the program name is also blanked out with AAAAAAAAAA
+			spdlog::debug("Found patch data block starting at #{}", (int)data[7]);
+			for (int patch = 0; patch < kTonesPerBlock; patch++) {
+				unpackNibbles(data + 8 + patch * kNibblesPerTone, state.block);
+				std::string patchName;
+				for (size_t i = 11; i < 20; i++) {
+					patchName.push_back(MKS50_Patch::kPatchNameChar[state.block[i] & 0b00111111]);
+				}
+				spdlog::debug("Found patch data for tone {}", patchName);
+			}
+		}
+		return LoadResult::Continue;
+	}
+
+	MKS50::LoadResult MKS50::loadDAT(MidiMessage const &message, LoadState &state)
+	{
+		// This is a DAT message, part of a bulk dump created with handshake. Very similar to the BLD message.
+		auto data = message.getSysExData();
+		switch (message.getSysExDataSize()) {
+		case 256 + 5: {
+			// This is either a tone or a patch block - which one, we can only figure out via context in the message stream!
+			// In this mode there is a checksum!
+			uint8 checksum = 0;
+			for (int i = 4; i < 256 + 4; i++) {
+				checksum = (checksum + data[i]) & 0x7f;
+			}
+			if (((checksum + data[256 + 4]) & 0x7f) != 0) {
+				Sysex::saveSysex("failed_checksum.bin", { message });
+				jassert(false);
+				spdlog::error("Checksum error, aborting!");
+				return LoadResult::Stop;
+			}
+
+			if (state.datPackages < 16) {
+				// Must be a tone block
+				for (int tone = 0; tone < kTonesPerBlock; tone++) {
+					unpackNibbles(data + 4 + tone * kNibblesPerTone, state.block);
+					auto newPatch = MKS50_Patch::createFromToneDAT(MidiProgramNumber::fromZeroBase(state.datPackages * kTonesPerBlock + tone), state.block);
+					if (!newPatch) {
 						jassert(false);
-						spdlog::warn("Warning - ignoring DAT block of irregular length");
-						break;
+						continue;
+					}
+					if (newPatch->name() == "AAAAAAAAAA") {
+						// This is the only indicator we have that you are actually trying to load patch data instead of tone data. The engineers must have found this problem
+						// only late in the game, because it doesn't make any sense. There is a tip from the internet which now completely makes sense:
+						//
+						// There is also an undocumented shortcut to quickly transfer all of the Tone names in Tone Group 'b' to Patch Group 'B' however, it will erase all of the Tones in Tone Group 'a' and restore them to the factory defaults
+						// 1) Load a bank of Tones into Tone Group 'b' then hold the[4] + [8] buttons during the next power - up
+						// 2) All Group 'b' Tone names will overwrite all Group 'B' Patch names leaving all the Tone Group 'b' data intact
+						//
+						// This is what you will need to do if you used the handshake mode to transfer data from synth A to B
+						spdlog::error("This is actually patch data, not tone data. Make sure to use the Bulk Dump [T-a] function and not [P-A]. Aborting!");
+						return LoadResult::Stop;
+					}
+					state.result.push_back(newPatch);
+					if (state.logDetails) {
+						spdlog::debug("Found tone {}", newPatch->name());
 					}
-					break;
-				case MKS50_Operation_Code::APR: {
-                    // APR packages are the default and I call them "editBuffer", because it behaves like one.
-                    auto newPatch = patchFromSysex({message});
-                    if (newPatch) {
-                        result.push_back(newPatch);
-                        spdlog::debug("Found tone {}", nameForPatch(newPatch));
-                    }
-                    }
-                    break;
-                default:
-                    jassertfalse;
 				}
 			}
+			else {
+				// Must be a patch block
+				//TODO - this is not correct, in case you have saved patch and tone data into different files...
+				spdlog::warn("Ignoring patch definition part of patch dump (for now)");
+			}
+			state.datPackages++;
+			break;
+		}
+		case 192 + 5:
+			// This is a chord memory block
+			spdlog::debug("Ignoring chord memory definition part of patch dump");
+			break;
+		default:
+			jassert(false);
+			spdlog::warn("Warning - ignoring DAT block of irregular length");
+			break;
+		}
+		return LoadResult::Continue;
+	}
+
+	MKS50::LoadResult MKS50::loadAPR(MidiMessage const &message, LoadState &state)
+	{
+		// APR packages are the default and I call them "editBuffer", because it behaves like one.
+		auto newPatch = toneFromAPR(message);
+		if (newPatch) {
+			state.result.push_back(newPatch);
+			if (state.logDetails) {
+				spdlog::debug("Found tone {}", newPatch->name());
+			}
+		}
+		return LoadResult::Continue;
+	}
+
+	std::shared_ptr<MKS50_Patch> MKS50::toneFromAPR(MidiMessage const &message)
+	{
+		if (message.getSysExDataSize() < 6) {
+			spdlog::error("APR package too short, probably corrupt file. Ignoring this APR package.");
+			return std::shared_ptr<MKS50_Patch>();
+		}
+		switch (message.getSysExData()[4])
+		{
+		case 0b00100000: /* Level 1 */
+			if (message.getSysExData()[5] != 1 /* Group ID*/) {
+				jassert(false);
+				spdlog::error("Group ID is not 1, probably corrupt file. Ignoring this APR package.");
+			}
+			else if (message.getSysExDataSize() < 46 + 6) {
+				spdlog::error("APR tone package too short, probably corrupt file. Ignoring this APR package.");
+			}
+			else {
+				return MKS50_Patch::createFromToneAPR(message);
+			}
+			break;
+		case 0b00110000: /* Level 2 */
+			spdlog::warn("Ignoring patch data for now, looking for tone data!");
+			break;
+		case 0b01000000: /* Level 3 */
+			spdlog::warn("Ignoring chord data for now, looking for tone data!");
+			break;
+		default:
+			jassert(false);
+			spdlog::error("Unknown level in APR package, probably corrupt file. Ignoring this APR package.");
+		}
+		return std::shared_ptr<MKS50_Patch>();
+	}
+
+	void MKS50::unpackNibbles(uint8 const *nibbles, std::vector<uint8> &outTone)
+	{
+		// Low nibble first, the buffer is reused for all tones of a load
+		outTone.resize(static_cast<size_t>(kNibblesPerTone / 2));
+		for (size_t i = 0; i < outTone.size(); i++) {
+			outTone[i] = (uint8)(nibbles[2 * i] | (nibbles[2 * i + 1] << 4));
 		}
-		return result;
 	}
 
 	std::vector<std::shared_ptr<midikraft::SynthParameterDefinition>> MKS50::allParameterDefinitions() const
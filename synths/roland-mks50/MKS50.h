@@ -16,6 +16,8 @@
 
 namespace midikraft {
 
+	class MKS50_Patch;
+
 	class MKS50 : public Synth, public HasBanksCapability, public EditBufferCapability, public HandshakeLoadingCapability,
 		public SimpleDiscoverableDevice, public DetailedParametersCapability {
 	public:
@@ -59,6 +61,25 @@ namespace midikraft {
 	private:
 		enum class MKS50_Operation_Code;
 
+		// loadSysex() keeps this while going over the messages
+		struct LoadState {
+			TPatchVector result;
+			std::vector<uint8> block; // The tone currently unpacked, reused
+			int datPackages = 0; // DAT blocks are numbered by their position in the stream
+			bool logDetails = false; // Decode names for the log only when the debug level is on
+		};
+		enum class LoadResult { Continue, Stop /* keep what has been found so far */, Discard };
+		typedef LoadResult(*TBlockLoader)(MidiMessage const &message, LoadState &state);
+
+		static constexpr int kTonesPerBlock = 4;
+		static constexpr int kNibblesPerTone = 64;
+
+		static LoadResult loadBLD(MidiMessage const &message, LoadState &state);
+		static LoadResult loadDAT(MidiMessage const &message, LoadState &state);
+		static LoadResult loadAPR(MidiMessage const &message, LoadState &state);
+		static std::shared_ptr<MKS50_Patch> toneFromAPR(MidiMessage const &message);
+		static void unpackNibbles(uint8 const *nibbles, std::vector<uint8> &outTone);
+
 		MidiMessage buildHandshakingMessage(MKS50_Operation_Code code) const;
 		MKS50::MKS50_Operation_Code getSysexOperationCode(MidiMessage const& message) const;
 
@@ -194,6 +194,9 @@ namespace midikraft {
 
 		bool done;
 		MidiMessage previousMessage;
+		MidiMessage ack;
+		MidiMessage eof;
+		MidiMessage rjc;
 		int numWSF;
 		bool success;
 		int dataPackages;
@@ -201,7 +204,11 @@ namespace midikraft {
 
 	std::shared_ptr<HandshakeLoadingCapability::ProtocolState> MKS80::createStateObject()
 	{
-		return std::make_shared<MKS80HandshakeState>();
+		auto state = std::make_shared<MKS80HandshakeState>();
+		state->ack = buildHandshakingMessage(MKS80_Operation_Code::ACK);
+		state->eof = buildHandshakingMessage(MKS80_Operation_Code::EOF_);
+		state->rjc = buildHandshakingMessage(MKS80_Operation_Code::RJC);
+		return state;
 	}
 
 	void MKS80::startDownload(std::shared_ptr<SafeMidiOutput> output, std::shared_ptr<ProtocolState> saveState)
@@ -228,35 +235,35 @@ namespace midikraft {
 				if (s->numWSF > 2) {
 					//TODO - shouldn't it be more than 1?
 					// This is more than 2 WSF, reject
-					answer = { buildHandshakingMessage(MKS80_Operation_Code::RJC) };
+					answer = { s->rjc };
 					s->done = true;
 					return false; // No need to store this message in the librarian
 				}
 				s->numWSF++;
-				answer = { buildHandshakingMessage(MKS80_Operation_Code::ACK) };
+				answer = { s->ack };
 				return false;
 			case MKS80_Operation_Code::DAT:
 				// The documentation says this would happen when we send a RQF, so this isn't an error at all
 
 				// This data package is part of the proper data, acknowledge and return true so the data is kept
-				answer = { buildHandshakingMessage(MKS80_Operation_Code::ACK) };
+				answer = { s->ack };
 				s->dataPackages++;
 				s->success = s->dataPackages == 16;
 				if (s->success) {
 					// We need to answer with an EOF message in case we got all 16 packages, in addition to the ACK message
-					answer.push_back(buildHandshakingMessage(MKS80_Operation_Code::EOF_));
+					answer.push_back(s->eof);
 				}
 				return true;
 			case MKS80_Operation_Code::RQF:
 				// If RQF comes during a download, something is really wrong. 
 				jassert(false);
 				s->done = true;
-				answer = { buildHandshakingMessage(MKS80_Operation_Code::RJC) };
+				answer = { s->rjc };
 				return false;
 			case MKS80_Operation_Code::EOF_:
 				// The MKS80 thinks it is done and wants an ACK for that
 				// This does happen only in SAVE mode (initiated from the device), and not in the RQF mode
-				answer = { buildHandshakingMessage(MKS80_Operation_Code::ACK) };
+				answer = { s->ack };
 				s->done = true;
 				s->success = s->dataPackages == 16;
 				return false;
@@ -341,7 +348,8 @@ namespace midikraft {
 		// Now, the MKS80 has two different formats: The DAT format from two-way handshake dumps, and the APR format 
 		TPatchVector result;
 		SysexLoadingState state;
-		for (auto message : sysexMessages) {
+		state.datBlocks.reserve(64);
+		for (auto const &message : sysexMessages) {
 			if (isOwnSysex(message)) {
 				switch (getSysexOperationCode(message)) {
 				case MKS80_Operation_Code::DAT: {
@@ -375,9 +383,8 @@ namespace midikraft {
 
 					// All good, we can construct 4 partial patches (layers) now
 					for (size_t block = 0; block < 4; block++) {
-						state.datBlocks.emplace_back();
-						size_t startOfBlock = 4 + block * 62;
-						std::copy(&message.getSysExData()[startOfBlock], &message.getSysExData()[startOfBlock + 62], std::back_inserter(state.datBlocks.back()));
+						uint8 const *startOfBlock = message.getSysExData() + 4 + block * 62;
+						state.datBlocks.emplace_back(startOfBlock, startOfBlock + 62);
 						state.patchCounter++;
 					}
 					break;
@@ -427,9 +434,8 @@ namespace midikraft {
 						spdlog::warn("Warning - got duplicate APR section, ignoring it");
 						break;
 					}
-					state.data[section] = std::vector<uint8>();
 					// Copy the useful data bytes
-					std::copy(&data[6], &data[message.getSysExDataSize()], std::back_inserter(state.data[section]));
+					state.data[section].assign(data + 6, data + message.getSysExDataSize());
 
 					// Are we finished?
 					if (state.data.size() == 4) {
@@ -451,6 +457,8 @@ namespace midikraft {
 			}
 			std::vector<std::vector<uint8>> toneData;
 			std::vector<std::vector<uint8>> patchData;
+			toneData.reserve(state.datBlocks.size());
+			patchData.reserve(state.datBlocks.size());
 			for (size_t i = 0; i < state.datBlocks.size(); i++) {
 				// First, extract the tone data stored in the dat block!
 				toneData.emplace_back(MKS80_Patch::toneFromDat(state.datBlocks[i]));
@@ -486,15 +494,27 @@ namespace midikraft {
 
 	TPatchVector MKS80::patchesFromAPRs(std::vector<std::vector<uint8>> const &toneData, std::vector<std::vector<uint8>> const &patchData) {
 		TPatchVector result;
+		result.reserve(toneData.size());
 
 		// Now, build up 64 standalone patches that ignore the complexity of where the tone data is stored in RAM
-		for (size_t i = 0; i < toneData.size(); i++) {
+		for (size_t i = 0; i < toneData.size() && i < patchData.size(); i++) {
+			auto const &patchRow = patchData[i];
+			if (patchRow.size() < 30) {
+				spdlog::warn("Ignoring MKS80 patch {} with truncated patch data", i);
+				continue;
+			}
 			std::map<MKS80_Patch::APR_Section, std::vector<uint8>> patch;
-			patch[MKS80_Patch::APR_Section::PATCH_UPPER] = std::vector<uint8>(patchData[i].begin(), patchData[i].begin() + 15); //TODO - no range check done here...
-			patch[MKS80_Patch::APR_Section::PATCH_LOWER] = std::vector<uint8>(patchData[i].begin() + 15, patchData[i].end());
-			size_t upperTone = patch[MKS80_Patch::APR_Section::PATCH_UPPER][MKS80_Parameter::TONE_NUMBER];
+			auto &upper = patch[MKS80_Patch::APR_Section::PATCH_UPPER];
+			upper.assign(patchRow.begin(), patchRow.begin() + 15);
+			auto &lower = patch[MKS80_Patch::APR_Section::PATCH_LOWER];
+			lower.assign(patchRow.begin() + 15, patchRow.end());
+			size_t upperTone = upper[MKS80_Parameter::TONE_NUMBER];
+			size_t lowerTone = lower[MKS80_Parameter::TONE_NUMBER];
+			if (upperTone >= toneData.size() || lowerTone >= toneData.size()) {
+				spdlog::warn("Ignoring MKS80 patch {} referring to tone outside of the bank", i);
+				continue;
+			}
 			patch[MKS80_Patch::APR_Section::TONE_UPPER] = toneData[upperTone];
-			size_t lowerTone = patch[MKS80_Patch::APR_Section::PATCH_LOWER][MKS80_Parameter::TONE_NUMBER];
 			//jassert(lowerTone== i); // If this is not guaranteed, we might not archive the whole data because a patch might refer to "outside" tone data, leaving tone data unused
 			patch[MKS80_Patch::APR_Section::TONE_LOWER] = toneData[lowerTone];
 			result.push_back(std::make_shared<MKS80_Patch>(MidiProgramNumber::fromZeroBase(static_cast<int>(i)), patch));
@@ -7,7 +7,7 @@
 
 namespace midikraft {
 
-	std::string MKS80_LegacyBankLoader::readPascalString(std::vector<uint8>::iterator start, std::vector<uint8>::iterator &position, std::vector<uint8>::iterator const &end)
+	std::string MKS80_LegacyBankLoader::readPascalString(std::vector<uint8>::const_iterator start, std::vector<uint8>::const_iterator &position, std::vector<uint8>::const_iterator const &end)
 	{
 		ignoreUnused(start);
 		std::string name;
@@ -25,34 +25,41 @@ namespace midikraft {
 		return name;
 	}
 
-	std::vector<uint8> MKS80_LegacyBankLoader::readBinaryBlock(std::vector<uint8>::iterator &position, std::vector<uint8>::iterator const &end, int sizeToRead) {
-		std::vector<uint8> result;
+	bool MKS80_LegacyBankLoader::readBinaryBlock(std::vector<uint8>::const_iterator &position, std::vector<uint8>::const_iterator const &end, int sizeToRead, std::vector<uint8> &block) {
 		if (std::distance(position, end) > sizeToRead - 1) {
-			std::copy(position, position + sizeToRead, std::back_inserter(result)); 
+			block.insert(block.end(), position, position + sizeToRead);
 			position += sizeToRead;
+			return true;
 		}
-		return result;
+		return false;
 	}
 
-	midikraft::TPatchVector MKS80_LegacyBankLoader::loadM80File(std::vector<uint8> fileContent)
+	midikraft::TPatchVector MKS80_LegacyBankLoader::loadM80File(std::vector<uint8> const &fileContent)
 	{
 		// Load this old bank format floating around in the Internet - these are really just the DAT stream data with patch and tone names
 		std::vector<std::vector<uint8>> toneDatas;
 		std::vector<std::string> toneNames;
 		std::vector<std::vector<uint8>> patchDatas;
 		std::vector<std::string> patchNames;
+		toneDatas.reserve(64);
+		toneNames.reserve(64);
+		patchDatas.reserve(64);
+		patchNames.reserve(64);
 
-		auto nextByte = fileContent.begin();
-		while (nextByte != fileContent.end()) {
-			std::string patch = readPascalString(fileContent.begin(), nextByte, fileContent.end());
-			std::vector<uint8> patchData = readBinaryBlock(nextByte, fileContent.end(), 0x17); // 0x17 bytes (23 dec) is one patch in the DAT format
-			std::string tone = readPascalString(fileContent.begin(), nextByte, fileContent.end());
-			std::vector<uint8> toneData = readBinaryBlock(nextByte, fileContent.end(), 0x27); // 0x27 bytes (39 dec) is one tone in the DAT format
-			std::copy(toneData.begin(), toneData.end(), std::back_inserter(patchData));
-			if (patchData.size() == 0x17 + 0x27) {
-				patchDatas.push_back(MKS80_Patch::patchesFromDat(patchData));
+		// One DAT row, the patch followed by its tone. Reused for all rows
+		std::vector<uint8> datRow;
+		datRow.reserve(0x17 + 0x27);
+		auto nextByte = fileContent.cbegin();
+		while (nextByte != fileContent.cend()) {
+			datRow.clear();
+			std::string patch = readPascalString(fileContent.cbegin(), nextByte, fileContent.cend());
+			bool complete = readBinaryBlock(nextByte, fileContent.cend(), 0x17, datRow); // 0x17 bytes (23 dec) is one patch in the DAT format
+			std::string tone = readPascalString(fileContent.cbegin(), nextByte, fileContent.cend());
+			complete = complete && readBinaryBlock(nextByte, fileContent.cend(), 0x27, datRow); // 0x27 bytes (39 dec) is one tone in the DAT format
+			if (complete) {
+				patchDatas.push_back(MKS80_Patch::patchesFromDat(datRow));
 				patchNames.push_back(patch);
-				toneDatas.push_back(MKS80_Patch::toneFromDat(toneData));
+				toneDatas.push_back(MKS80_Patch::toneFromDat(std::vector<uint8>(datRow.begin() + 0x17, datRow.end())));
 				toneNames.push_back(tone);
 			}
 			else {
@@ -73,7 +80,7 @@ namespace midikraft {
 		}
 	}
 
-	midikraft::TPatchVector MKS80_LegacyBankLoader::loadMKS80File(std::vector<uint8> fileContent)
+	midikraft::TPatchVector MKS80_LegacyBankLoader::loadMKS80File(std::vector<uint8> const &fileContent)
 	{
 		if (fileContent.size() != 0xf80) {
 			spdlog::info("MKS80 loader: File length is not 0xf80, this does not seem to be an mks80 file, trying other formats");
@@ -82,9 +89,14 @@ namespace midikraft {
 
 		std::vector<std::vector<uint8>> toneDatas;
 		std::vector<std::vector<uint8>> patchDatas;
-		auto nextByte = fileContent.begin();
+		toneDatas.reserve(64);
+		patchDatas.reserve(64);
+		std::vector<uint8> datRow;
+		datRow.reserve(0x17 + 0x27);
+		auto nextByte = fileContent.cbegin();
 		for (int i = 0; i < 64; i++) {
-			auto datRow = readBinaryBlock(nextByte, fileContent.end(), 0x17 + 0x27); // 0x17 bytes (23 dec) is one patch in the DAT format and 0x27 bytes (39 dec) is one tone in the DAT format
+			datRow.clear();
+			readBinaryBlock(nextByte, fileContent.cend(), 0x17 + 0x27, datRow); // 0x17 bytes (23 dec) is one patch in the DAT format and 0x27 bytes (39 dec) is one tone in the DAT format
 			patchDatas.push_back(MKS80_Patch::patchesFromDat(datRow)); 
 			toneDatas.push_back(MKS80_Patch::toneFromDat(datRow));
 		}
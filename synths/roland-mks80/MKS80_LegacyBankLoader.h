@@ -8,13 +8,14 @@ namespace midikraft {
 
 	class MKS80_LegacyBankLoader {
 	public:
-		static TPatchVector loadM80File(std::vector<uint8> fileContent);
-		static TPatchVector loadMKS80File(std::vector<uint8> fileContent);
+		static TPatchVector loadM80File(std::vector<uint8> const &fileContent);
+		static TPatchVector loadMKS80File(std::vector<uint8> const &fileContent);
 
 	private:
 		//! This reads a Pascal-like small string, where the first byte specifies the length of the string, and advances the read pointer
-		static std::string readPascalString(std::vector<uint8>::iterator start, std::vector<uint8>::iterator &position, std::vector<uint8>::iterator const &end);
-		static std::vector<uint8> readBinaryBlock(std::vector<uint8>::iterator &position, std::vector<uint8>::iterator const &end, int sizeToRead);
+		static std::string readPascalString(std::vector<uint8>::const_iterator start, std::vector<uint8>::const_iterator &position, std::vector<uint8>::const_iterator const &end);
+		//! Appends sizeToRead bytes to the block and advances the read pointer, returns false and appends nothing if there are not enough bytes left
+		static bool readBinaryBlock(std::vector<uint8>::const_iterator &position, std::vector<uint8>::const_iterator const &end, int sizeToRead, std::vector<uint8> &block);
 	};
 
 }
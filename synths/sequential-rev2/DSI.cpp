@@ -7,10 +7,13 @@
 #include "DSI.h"
 
 #include "MidiHelpers.h"
+#include "SysexCodecs.h"
 
 #include <spdlog/spdlog.h>
 #include "SpdLogJuce.h"
 
+#include <algorithm>
+
 namespace midikraft {
 
 	std::map<int, std::string> kDSIAlternateTunings() {
@@ -202,49 +205,21 @@ namespace midikraft {
 
 	Synth::PatchData DSISynth::unescapeSysex(const uint8 *sysExData, int sysExLen, int expectedLength)
 	{
-		PatchData result;
-		int dataIndex = 0;
-		while (dataIndex < sysExLen) {
-			uint8 ms_bits = sysExData[dataIndex];
-			dataIndex++;
-			for (int i = 0; i < 7; i++) {
-				// Actually, the last 7 byte block might be incomplete, as the original number of data bytes might not be a
-				// multitude of 7. Instead of buffering with 0, the DSI folks terminate the block with less than 7 bytes
-				if (dataIndex < sysExLen) {
-					result.push_back(sysExData[dataIndex] | ((ms_bits & (1 << i)) << (7 - i)));
-				}
-				dataIndex++;
-			}
-		}
-		// This is do work around a bug in the Rev2 firmware 1.1 that made the program edit buffer dump sent 3 bytes short, which is  bytes less after un-escaping
-		while (result.size() < (size_t)expectedLength) {
-			result.push_back(0);
-		}
+		// The last 7 byte block might be incomplete, as the original number of data bytes might not be a
+		// multitude of 7. Instead of buffering with 0, the DSI folks terminate the block with less than 7 bytes
+		size_t packedSize = sysExLen > 0 ? (size_t)sysExLen : 0;
+		PatchData result(std::max(SysexCodecs::msbFirstUnpackedSize(packedSize), expectedLength > 0 ? (size_t)expectedLength : (size_t)0), 0);
+		SysexCodecs::unpackMsbFirst(sysExData, packedSize, result.data());
+		// Keeping the result at least expectedLength long works around a bug in the Rev2 firmware 1.1 that made the program edit buffer dump sent 3 bytes short
 		return result;
 	}
 
 	std::vector<juce::uint8> DSISynth::escapeSysex(const PatchData &programEditBuffer, size_t bytesToEscape)
 	{
-		std::vector<juce::uint8> result;
-		size_t readIndex = 0;
-		while (readIndex < bytesToEscape) {
-			// Write an empty msb byte and record the index
-			result.push_back(0);
-			size_t msbIndex = result.size() - 1;
-
-			// Now append the next 7 bytes from the input, and set their msb byte
-			uint8 msb = 0;
-			for (int i = 0; i < 7; i++) {
-				if (readIndex < bytesToEscape) {
-					result.push_back(programEditBuffer.at(readIndex) & 0x7f);
-					msb |= (programEditBuffer.at(readIndex) & 0x80) >> (7 - i);
-				}
-				readIndex++;
-			}
-
-			// Then poke the msb back into the result stream
-			result.at(msbIndex) = msb;
-		}
+		jassert(bytesToEscape <= programEditBuffer.size());
+		bytesToEscape = std::min(bytesToEscape, programEditBuffer.size());
+		std::vector<juce::uint8> result(SysexCodecs::msbFirstPackedSize(bytesToEscape));
+		SysexCodecs::packMsbFirst(programEditBuffer.data(), bytesToEscape, result.data());
 		return result;
 	}
 
@@ -258,49 +233,102 @@ namespace midikraft {
 		if (dataFile && dataFile->dataTypeID() == settingsDataFileType()) {
 			auto message = MidiMessage::createSysExMessage(dataFile->data().data(), (int)dataFile->data().size());
 			std::vector<uint8> globalParameterData(&message.getSysExData()[3], message.getSysExData() + message.getSysExDataSize());
+			auto definitions = dsiGlobalSettings();
+			std::map<size_t, int> known;
 			// Loop over it and fill out the GlobalSettings Properties
-			for (size_t i = 0; i < dsiGlobalSettings().size(); i++) {
-				if (i < globalParameterData.size()) {
+			for (size_t i = 0; i < definitions.size(); i++) {
+				auto const &def = definitions[i];
+				if (def.sysexIndex >= 0 && static_cast<size_t>(def.sysexIndex) < globalParameterData.size()) {
+					int midiValue = globalParameterData[static_cast<size_t>(def.sysexIndex)];
+					known[i] = midiValue;
 					// As this is coming from a datafile, we assume this is coming from the synth (we don't store the global settings data files on the computer)
 					// Therefore, don't notify the update synth listener, because that would send out the same data back to the synth where it is coming from
 					globalSettingsTree_.setPropertyExcludingListener(&updateSynthWithGlobalSettingsListener_,
-						Identifier(dsiGlobalSettings()[i].typedNamedValue.name()),
-						var(globalParameterData[dsiGlobalSettings()[i].sysexIndex] + dsiGlobalSettings()[i].displayOffset),
+						Identifier(def.typedNamedValue.name()),
+						var(midiValue + def.displayOffset),
 						nullptr);
 				}
 			}
+			std::lock_guard<std::mutex> guard(globalCacheLock_);
+			knownGlobalValues_ = known;
+			globalSettingsVersion_++;
+			globalSettingsLoadedMs_ = Time::getMillisecondCounter();
 		}
 	}
 
+	int DSISynth::globalSettingsVersion() const
+	{
+		std::lock_guard<std::mutex> guard(globalCacheLock_);
+		return globalSettingsVersion_;
+	}
+
+	bool DSISynth::globalSettingsAreStale() const
+	{
+		std::lock_guard<std::mutex> guard(globalCacheLock_);
+		return globalSettingsVersion_ == 0 || Time::getMillisecondCounter() - globalSettingsLoadedMs_ > kGlobalSettingsMaxAgeMs;
+	}
+
 	void DSISynth::GlobalSettingsListener::valueTreePropertyChanged(ValueTree& treeWhosePropertyHasChanged, const Identifier& property)
 	{
 		if (!synth_->wasDetected()) return;
 
 		Value value = treeWhosePropertyHasChanged.getPropertyAsValue(property, nullptr, false);
 		// Need to find definition for this setting now, suboptimal data structures
-		for (const auto& def : synth_->dsiGlobalSettings()) {
-			if (def.typedNamedValue.name() == property.getCharPointer()) {
-				int newMidiValue = ((int)value.getValue()) - def.displayOffset;
-				auto messages = synth_->createNRPN(def.nrpn, newMidiValue);
-				String valueText;
-				switch (def.typedNamedValue.valueType()) {
-				case ValueType::Integer:
-					valueText = String(int(value.getValue())); break;
-				case ValueType::Bool:
-					valueText = bool(value.getValue()) ? "On" : "Off"; break;
-				case ValueType::Lookup:
-					valueText = def.typedNamedValue.lookup()[int(value.getValue())]; break;
-				default:
-					//TODO not implemented yet
-					jassert(false);
-				}
-				spdlog::info("Setting {} to {}",def.typedNamedValue.name(), valueText);				
-				synth_->sendBlockOfMessagesToSynth(synth_->midiOutput(), messages);
+		auto definitions = synth_->dsiGlobalSettings();
+		for (size_t i = 0; i < definitions.size(); i++) {
+			if (definitions[i].typedNamedValue.name() == property.getCharPointer()) {
+				// A later change of the same setting replaces the earlier one, only the last value is sent
+				pending_[i] = ((int)value.getValue()) - definitions[i].displayOffset;
+				triggerAsyncUpdate();
 				return;
 			}
 		}
 	}
 
+	void DSISynth::GlobalSettingsListener::handleAsyncUpdate()
+	{
+		auto definitions = synth_->dsiGlobalSettings();
+		std::vector<MidiMessage> messages;
+		std::vector<std::pair<size_t, int>> sent;
+		{
+			std::lock_guard<std::mutex> guard(synth_->globalCacheLock_);
+			for (auto const &change : pending_) {
+				auto known = synth_->knownGlobalValues_.find(change.first);
+				if (change.first >= definitions.size() || (known != synth_->knownGlobalValues_.end() && known->second == change.second)) {
+					// The synth has this value already, e.g. the slider was moved back to where it was
+					continue;
+				}
+				auto nrpn = synth_->createNRPN(definitions[change.first].nrpn, change.second);
+				messages.insert(messages.end(), nrpn.begin(), nrpn.end());
+				synth_->knownGlobalValues_[change.first] = change.second;
+				sent.push_back(change);
+			}
+		}
+		pending_.clear();
+		if (messages.empty()) {
+			return;
+		}
+
+		for (auto const &change : sent) {
+			auto const &def = definitions[change.first];
+			int displayValue = change.second + def.displayOffset;
+			String valueText;
+			switch (def.typedNamedValue.valueType()) {
+			case ValueType::Integer:
+				valueText = String(displayValue); break;
+			case ValueType::Bool:
+				valueText = displayValue != 0 ? "On" : "Off"; break;
+			case ValueType::Lookup:
+				valueText = def.typedNamedValue.lookup()[displayValue]; break;
+			default:
+				//TODO not implemented yet
+				jassert(false);
+			}
+			spdlog::info("Setting {} to {}", def.typedNamedValue.name(), valueText);
+		}
+		synth_->sendBlockOfMessagesToSynth(synth_->midiOutput(), messages);
+	}
+
 }
 
 
@@ -17,6 +17,9 @@
 
 #include "TypedNamedValue.h"
 
+#include <map>
+#include <mutex>
+
 namespace midikraft {
 
 	// Global constants
@@ -78,6 +81,14 @@ namespace midikraft {
 		// Implement this to get the common global settings implementation working
 		virtual std::vector<DSIGlobalSettingDefinition> dsiGlobalSettings() const = 0;
 
+		// Counts the global dumps taken from the synth, 0 means the settings shown are just the defaults
+		int globalSettingsVersion() const;
+		// True if no dump has been received yet or the last one is older than kGlobalSettingsMaxAgeMs, then a full dump should be requested again.
+		// Changes made via the UI keep the cache current, only changes on the front panel of the synth are missed
+		bool globalSettingsAreStale() const;
+
+		static constexpr uint32 kGlobalSettingsMaxAgeMs = 10 * 60 * 1000;
+
 	protected:
 		DSISynth(uint8 midiModelID);
 
@@ -90,15 +101,26 @@ namespace midikraft {
 		bool localControl_;
 		bool midiControl_;
 
-		// This listener implements sending update messages via NRPN when any of the global settings is changed via the UI
-		class GlobalSettingsListener : public ValueTree::Listener {
+		// This listener implements sending update messages via NRPN when any of the global settings is changed via the UI.
+		// The changes are collected and sent as one block from the message loop, so dragging a slider does not produce an NRPN burst per step,
+		// and only settings whose value differs from what the synth is known to have are sent at all
+		class GlobalSettingsListener : public ValueTree::Listener, private AsyncUpdater {
 		public:
 			GlobalSettingsListener(DSISynth *synth) : synth_(synth) {}
 			void valueTreePropertyChanged(ValueTree& treeWhosePropertyHasChanged, const Identifier& property) override;
 		private:
+			void handleAsyncUpdate() override;
+
 			DSISynth *synth_;
+			std::map<size_t, int> pending_; // Index into dsiGlobalSettings() to the new MIDI value, message thread only
 		};
-		
+
+		// The last values known to be in the synth, in MIDI units and indexed like dsiGlobalSettings()
+		mutable std::mutex globalCacheLock_;
+		std::map<size_t, int> knownGlobalValues_;
+		int globalSettingsVersion_ = 0;
+		uint32 globalSettingsLoadedMs_ = 0;
+
 		TypedNamedValueSet globalSettings_;
 		ValueTree globalSettingsTree_;
 		GlobalSettingsListener updateSynthWithGlobalSettingsListener_;
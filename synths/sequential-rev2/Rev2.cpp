@@ -9,31 +9,19 @@
 #include "Patch.h"
 
 #include "Rev2Patch.h"
+#include "Rev2Program.h"
 
 #include <algorithm>
 #include <spdlog/spdlog.h>
 
 #include "MidiHelpers.h"
+#include "SysexCodecs.h"
 #include "TypedNamedValue.h"
 #include "MidiTuning.h"
 #include "MTSFile.h"
 
 namespace midikraft {
 
-	// Definitions for the SysEx format we need
-	const size_t cGatedSeqOnIndex = 139;
-	const size_t cGatedSeqDestination = 111;
-	const size_t cGatedSeqIndex = 140;
-	const size_t cStepSeqNote1Index = 256;
-	const size_t cStepSeqVelocity1Index = 320;
-	const size_t cLayerB = 2048 / 2;
-	const size_t cABMode = 231;
-	const size_t cBpmTempo = 130;
-	const size_t cClockDivide = 131;
-
-	// Some constants
-	const uint8 cDefaultNote = 0x3c;
-
 	std::vector<Range<size_t>> kRev2BlankOutZones = {
 		{ 211, 231 }, // unused according to doc
 		{ 1235, 1255 }, // same in layer B
@@ -181,136 +169,44 @@ namespace midikraft {
 		return std::vector<MidiMessage>({ MidiHelpers::sysexMessage(programEditBufferDataDump) });
 	}
 
-	uint8 Rev2::clamp(int value, uint8 minimum /* = 9*/, uint8 maximum /* = 127 */) {
-		return static_cast<uint8>(std::min((int)maximum, std::max(value, (int)minimum)));
-	}
-
-	juce::MidiMessage Rev2::filterProgramEditBuffer(const MidiMessage &programEditBuffer, std::function<void(std::vector<uint8> &)> filterExpressionInPlace) {
+	bool Rev2::decodeProgramEditBuffer(const MidiMessage &programEditBuffer, Rev2Program &outProgram) const
+	{
 		if (!isEditBufferDump({ programEditBuffer })) {
-			jassert(false);
-			return MidiMessage(); // Empty sysex message so it doesn't crash
+			return false;
 		}
-
-		// Decode the data
 		const uint8 *startOfData = &programEditBuffer.getSysExData()[3];
-		std::vector<uint8> programEditBufferDecoded = unescapeSysex(startOfData, programEditBuffer.getSysExDataSize() - 3, 2048);
-
-		// Perform filter operation
-		filterExpressionInPlace(programEditBufferDecoded);
-
-		return buildSysexFromEditBuffer(programEditBufferDecoded);
+		outProgram = Rev2Program(unescapeSysex(startOfData, programEditBuffer.getSysExDataSize() - 3, 2048));
+		return true;
 	}
 
-	juce::MidiMessage Rev2::buildSysexFromEditBuffer(std::vector<uint8> editBuffer) {
-		// Done, now create a new encoded buffer
-		std::vector<uint8> encodedBuffer = escapeSysex(editBuffer, 2046);
-
-		// Build the sysex method with the patched buffer
+	juce::MidiMessage Rev2::encodeProgramEditBuffer(Rev2Program const &program) const
+	{
+		// Escape directly behind the header of the program edit buffer dump
 		std::vector<uint8> sysEx({ 0b00000001, 0b00101111, 0b00000011 });
-		sysEx.insert(sysEx.end(), encodedBuffer.begin(), encodedBuffer.end());
-		auto result = MidiMessage::createSysExMessage(&sysEx.at(0), (int)sysEx.size());
-		return result;
-	}
-
-	bool isPolySequencerRest(int note, int velocity) {
-		// Wild guess...
-		return note == 60 && velocity == 128;
-	}
-
-	bool isPolySequencerTie(int note, int velocity) {
-		ignoreUnused(velocity);
-		return note > 128;
+		sysEx.resize(3 + SysexCodecs::msbFirstPackedSize(2046));
+		SysexCodecs::packMsbFirst(program.data().data(), 2046, sysEx.data() + 3);
+		return MidiMessage::createSysExMessage(sysEx.data(), (int)sysEx.size());
 	}
 
 	juce::MidiMessage Rev2::patchPolySequenceToGatedTrack(const MidiMessage& message, int gatedSeqTrack)
 	{
-		return filterProgramEditBuffer(message, [gatedSeqTrack](std::vector<uint8> &programEditBuffer) {
-			// Copy the PolySequence into the Gated Track
-			// Find the lowest note in the poly sequence
-			int lowestNote = 127;
-			for (int i = 0; i < 16; i++) {
-				if (programEditBuffer[cStepSeqNote1Index + i] < lowestNote) {
-					lowestNote = programEditBuffer[cStepSeqNote1Index + i];
-				}
-			}
-
-			// As the Gated Sequencer only has positive values, and I want the key to be the first key of the sequence, our only choice is
-			// to move up a few octaves so we stay in key...
-			int indexNote = programEditBuffer[cStepSeqNote1Index];
-			while (lowestNote < indexNote) {
-				indexNote -= 12;
-			}
-
-			for (int i = 0; i < 16; i++) {
-				// 16 steps in the gated sequencer...
-				// The gated sequencer allows half-half steps in pitch, so we multiply by 2...
-				uint8 notePlayed = programEditBuffer[cStepSeqNote1Index + i];
-				uint8 velocityPlayed = programEditBuffer[cStepSeqVelocity1Index + i];
-				if (velocityPlayed > 0 && !isPolySequencerRest(notePlayed, velocityPlayed) && !isPolySequencerTie(notePlayed, velocityPlayed)) {
-					programEditBuffer[gatedSeqTrack * 16 + i + cGatedSeqIndex] = clamp((notePlayed - indexNote) * 2, 0, 125);
-				}
-				else {
-					// 126 is the reset in the gated sequencer, 127 is the rest, which is only allowed in track 1 if I believe the Prophet 8 documentation
-					programEditBuffer[gatedSeqTrack * 16 + i + cGatedSeqIndex] = 127;
-				}
-				programEditBuffer[(gatedSeqTrack + 1) * 16 + i + cGatedSeqIndex] = clamp(velocityPlayed / 2, 0, 125);
-			}
-
-			// Poke the sequencer on and set the destination to OscAllFreq
-			programEditBuffer[cGatedSeqOnIndex] = 0; // 0 is gated sequencer, 1 is poly sequencer
-			programEditBuffer[cGatedSeqDestination] = 3;
-
-			// If we are in a stacked program, we copy layer A to B so both sounds get the same sequence
-			if (programEditBuffer[cABMode] == 1) {
-				programEditBuffer[cLayerB + cGatedSeqDestination] = programEditBuffer[cGatedSeqDestination];
-				programEditBuffer[cLayerB + cGatedSeqOnIndex] = programEditBuffer[cGatedSeqOnIndex];
-				std::copy(std::next(programEditBuffer.begin(), cGatedSeqIndex),
-					std::next(programEditBuffer.begin(), cGatedSeqIndex + 4 * 16),
-					std::next(programEditBuffer.begin(), cLayerB + cGatedSeqIndex));
-
-				// And we should make sure that the bpm and clock divide is the same on layer B
-				programEditBuffer[cLayerB + cBpmTempo] = programEditBuffer[cBpmTempo];
-				programEditBuffer[cLayerB + cClockDivide] = programEditBuffer[cClockDivide];
-			}
-		});
+		Rev2Program program;
+		if (!decodeProgramEditBuffer(message, program)) {
+			jassert(false);
+			return MidiMessage(); // Empty sysex message so it doesn't crash
+		}
+		return encodeProgramEditBuffer(program.patchPolySequenceToGatedTrack(gatedSeqTrack));
 	}
 
 	juce::MidiMessage Rev2::copySequencersFromOther(const MidiMessage& currentProgram, const MidiMessage &lockedProgram)
 	{
-		// Decode locked data as well
-		jassert(isEditBufferDump({ lockedProgram }));
-		const uint8 *startOfData = &lockedProgram.getSysExData()[3];
-		std::vector<uint8> lockedProgramBufferDecoded = unescapeSysex(startOfData, lockedProgram.getSysExDataSize() - 3, 2048);
-		return filterProgramEditBuffer(currentProgram, [lockedProgramBufferDecoded](std::vector<uint8> &programEditBuffer) {
-			// Copy poly sequence of both layers, 6 tracks with 64 bytes for note and 64 bytes for velocity each!
-			std::copy(std::next(lockedProgramBufferDecoded.begin(), cStepSeqNote1Index),
-				std::next(lockedProgramBufferDecoded.begin(), cStepSeqNote1Index + 6 * 64 * 2),
-				std::next(programEditBuffer.begin(), cStepSeqNote1Index));
-			std::copy(std::next(lockedProgramBufferDecoded.begin(), cLayerB + cStepSeqNote1Index),
-				std::next(lockedProgramBufferDecoded.begin(), cLayerB + cStepSeqNote1Index + 6 * 64 * 2),
-				std::next(programEditBuffer.begin(), cLayerB + cStepSeqNote1Index));
-
-			// Copy 4 tracks with 16 bytes each for the gated sequencer
-			std::copy(std::next(lockedProgramBufferDecoded.begin(), cGatedSeqIndex),
-				std::next(lockedProgramBufferDecoded.begin(), cGatedSeqIndex + 4 * 16),
-				std::next(programEditBuffer.begin(), cGatedSeqIndex));
-			std::copy(std::next(lockedProgramBufferDecoded.begin(), cLayerB + cGatedSeqIndex),
-				std::next(lockedProgramBufferDecoded.begin(), cLayerB + cGatedSeqIndex + 4 * 16),
-				std::next(programEditBuffer.begin(), cLayerB + cGatedSeqIndex));
-
-			// For the gated to work as expected, take over the switch as well which of the sequencers is on (poly or gated),
-			// and we need the gated destination for track 1 to be osc all frequencies
-			programEditBuffer[cGatedSeqOnIndex] = lockedProgramBufferDecoded[cGatedSeqOnIndex];
-			programEditBuffer[cGatedSeqDestination] = lockedProgramBufferDecoded[cGatedSeqDestination];
-			programEditBuffer[cLayerB + cGatedSeqOnIndex] = lockedProgramBufferDecoded[cLayerB + cGatedSeqOnIndex];
-			programEditBuffer[cLayerB + cGatedSeqDestination] = lockedProgramBufferDecoded[cLayerB + cGatedSeqDestination];
-
-			// Also copy over tempo and clock
-			programEditBuffer[cBpmTempo] = lockedProgramBufferDecoded[cBpmTempo];
-			programEditBuffer[cClockDivide] = lockedProgramBufferDecoded[cClockDivide];
-			programEditBuffer[cLayerB + cBpmTempo] = lockedProgramBufferDecoded[cLayerB + cBpmTempo];
-			programEditBuffer[cLayerB + cClockDivide] = lockedProgramBufferDecoded[cLayerB + cClockDivide];
-		});
+		Rev2Program current;
+		Rev2Program locked;
+		if (!decodeProgramEditBuffer(currentProgram, current) || !decodeProgramEditBuffer(lockedProgram, locked)) {
+			jassert(false);
+			return MidiMessage(); // Empty sysex message so it doesn't crash
+		}
+		return encodeProgramEditBuffer(current.copySequencersFrom(locked));
 	}
 
 	void Rev2::switchToLayer(int layerNo)
@@ -593,21 +489,12 @@ namespace midikraft {
 
 	juce::MidiMessage Rev2::clearPolySequencer(const MidiMessage &programEditBuffer, bool layerA, bool layerB)
 	{
-		return filterProgramEditBuffer(programEditBuffer, [layerA, layerB](std::vector<uint8> &programEditBuffer) {
-			// Just fill all 6 tracks of the Poly Sequencer with note 0x3f and velocity 0
-			for (int track = 0; track < 6; track++) {
-				for (int step = 0; step < 64; step++) {
-					if (layerA) {
-						programEditBuffer[cStepSeqNote1Index + track * 128 + step] = cDefaultNote;
-						programEditBuffer[cStepSeqVelocity1Index + track * 128 + step] = 0x00;
-					}
-					if (layerB) {
-						programEditBuffer[cLayerB + cStepSeqNote1Index + track * 128 + step] = cDefaultNote;
-						programEditBuffer[cLayerB + cStepSeqVelocity1Index + track * 128 + step] = 0x00;
-					}
-				}
-			}
-		});
+		Rev2Program program;
+		if (!decodeProgramEditBuffer(programEditBuffer, program)) {
+			jassert(false);
+			return MidiMessage(); // Empty sysex message so it doesn't crash
+		}
+		return encodeProgramEditBuffer(program.clearPolySequencer(layerA, layerB));
 	}
 
 	int Rev2::settingsDataFileType() const
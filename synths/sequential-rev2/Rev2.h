@@ -13,6 +13,8 @@
 #include "DataFileLoadCapability.h"
 #include "DataFileSendCapability.h"
 
+#include "Rev2Program.h"
+
 namespace midikraft {
 
 	class Rev2 : public DSISynth, public LayerCapability, public DataFileLoadCapability, public DataFileSendCapability
@@ -47,6 +49,10 @@ namespace midikraft {
 		MidiMessage clearPolySequencer(const MidiMessage &programEditBuffer, bool layerA, bool layerB);
 		MidiMessage copySequencersFromOther(const MidiMessage& currentProgram, const MidiMessage &lockedProgram);
 
+		// For chaining several of the operations above, decode once, modify the Rev2Program and encode once
+		bool decodeProgramEditBuffer(const MidiMessage &programEditBuffer, Rev2Program &outProgram) const;
+		MidiMessage encodeProgramEditBuffer(Rev2Program const &program) const;
+
 		// LayerCapability
 		virtual void switchToLayer(int layerNo) override;
 		virtual std::vector<MidiMessage> layerToSysex(std::shared_ptr<DataFile> const patch, int sourceLayer, int targetLayer) const override;
@@ -83,13 +89,7 @@ namespace midikraft {
 		virtual std::vector<DSIGlobalSettingDefinition> dsiGlobalSettings() const override;
 
 	private:
-		MidiMessage buildSysexFromEditBuffer(std::vector<uint8> editBuffer);
-		MidiMessage filterProgramEditBuffer(const MidiMessage &programEditBuffer, std::function<void(std::vector<uint8> &)> filterExpressionInPlace);
-
 		void initGlobalSettings();
-
-		// That's not very Rev2 specific
-		static uint8 clamp(int value, uint8 min = 0, uint8 max = 127);
 	};
 
 }
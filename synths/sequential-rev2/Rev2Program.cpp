@@ -0,0 +1,161 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "Rev2Program.h"
+
+#include <algorithm>
+
+namespace midikraft {
+
+	// Definitions for the SysEx format we need
+	const size_t cGatedSeqOnIndex = 139;
+	const size_t cGatedSeqDestination = 111;
+	const size_t cGatedSeqIndex = 140;
+	const size_t cStepSeqNote1Index = 256;
+	const size_t cStepSeqVelocity1Index = 320;
+	const size_t cLayerB = 2048 / 2;
+	const size_t cABMode = 231;
+	const size_t cBpmTempo = 130;
+	const size_t cClockDivide = 131;
+
+	// Some constants
+	const uint8 cDefaultNote = 0x3c;
+
+	static bool isPolySequencerRest(int note, int velocity) {
+		// Wild guess...
+		return note == 60 && velocity == 128;
+	}
+
+	static bool isPolySequencerTie(int note, int velocity) {
+		ignoreUnused(velocity);
+		return note > 128;
+	}
+
+	Rev2Program::Rev2Program() : data_(2048, 0)
+	{
+	}
+
+	Rev2Program::Rev2Program(Synth::PatchData decoded) : data_(std::move(decoded))
+	{
+		// Short edit buffers from firmware 1.1 are already padded by the unescape, but make sure all indexes below are valid
+		if (data_.size() < 2048) {
+			data_.resize(2048, 0);
+		}
+	}
+
+	Synth::PatchData const &Rev2Program::data() const
+	{
+		return data_;
+	}
+
+	uint8 Rev2Program::clamp(int value, uint8 minimum /* = 0 */, uint8 maximum /* = 127 */) {
+		return static_cast<uint8>(std::min((int)maximum, std::max(value, (int)minimum)));
+	}
+
+	Rev2Program &Rev2Program::patchPolySequenceToGatedTrack(int gatedSeqTrack)
+	{
+		// Copy the PolySequence into the Gated Track
+		// Find the lowest note in the poly sequence
+		int lowestNote = 127;
+		for (int i = 0; i < 16; i++) {
+			if (data_[cStepSeqNote1Index + i] < lowestNote) {
+				lowestNote = data_[cStepSeqNote1Index + i];
+			}
+		}
+
+		// As the Gated Sequencer only has positive values, and I want the key to be the first key of the sequence, our only choice is
+		// to move up a few octaves so we stay in key...
+		int indexNote = data_[cStepSeqNote1Index];
+		while (lowestNote < indexNote) {
+			indexNote -= 12;
+		}
+
+		for (int i = 0; i < 16; i++) {
+			// 16 steps in the gated sequencer...
+			// The gated sequencer allows half-half steps in pitch, so we multiply by 2...
+			uint8 notePlayed = data_[cStepSeqNote1Index + i];
+			uint8 velocityPlayed = data_[cStepSeqVelocity1Index + i];
+			if (velocityPlayed > 0 && !isPolySequencerRest(notePlayed, velocityPlayed) && !isPolySequencerTie(notePlayed, velocityPlayed)) {
+				data_[gatedSeqTrack * 16 + i + cGatedSeqIndex] = clamp((notePlayed - indexNote) * 2, 0, 125);
+			}
+			else {
+				// 126 is the reset in the gated sequencer, 127 is the rest, which is only allowed in track 1 if I believe the Prophet 8 documentation
+				data_[gatedSeqTrack * 16 + i + cGatedSeqIndex] = 127;
+			}
+			data_[(gatedSeqTrack + 1) * 16 + i + cGatedSeqIndex] = clamp(velocityPlayed / 2, 0, 125);
+		}
+
+		// Poke the sequencer on and set the destination to OscAllFreq
+		data_[cGatedSeqOnIndex] = 0; // 0 is gated sequencer, 1 is poly sequencer
+		data_[cGatedSeqDestination] = 3;
+
+		// If we are in a stacked program, we copy layer A to B so both sounds get the same sequence
+		if (data_[cABMode] == 1) {
+			data_[cLayerB + cGatedSeqDestination] = data_[cGatedSeqDestination];
+			data_[cLayerB + cGatedSeqOnIndex] = data_[cGatedSeqOnIndex];
+			std::copy(std::next(data_.begin(), cGatedSeqIndex),
+				std::next(data_.begin(), cGatedSeqIndex + 4 * 16),
+				std::next(data_.begin(), cLayerB + cGatedSeqIndex));
+
+			// And we should make sure that the bpm and clock divide is the same on layer B
+			data_[cLayerB + cBpmTempo] = data_[cBpmTempo];
+			data_[cLayerB + cClockDivide] = data_[cClockDivide];
+		}
+		return *this;
+	}
+
+	Rev2Program &Rev2Program::clearPolySequencer(bool layerA, bool layerB)
+	{
+		// Just fill all 6 tracks of the Poly Sequencer with note 0x3f and velocity 0
+		for (int track = 0; track < 6; track++) {
+			for (int step = 0; step < 64; step++) {
+				if (layerA) {
+					data_[cStepSeqNote1Index + track * 128 + step] = cDefaultNote;
+					data_[cStepSeqVelocity1Index + track * 128 + step] = 0x00;
+				}
+				if (layerB) {
+					data_[cLayerB + cStepSeqNote1Index + track * 128 + step] = cDefaultNote;
+					data_[cLayerB + cStepSeqVelocity1Index + track * 128 + step] = 0x00;
+				}
+			}
+		}
+		return *this;
+	}
+
+	Rev2Program &Rev2Program::copySequencersFrom(Rev2Program const &other)
+	{
+		// Copy poly sequence of both layers, 6 tracks with 64 bytes for note and 64 bytes for velocity each!
+		std::copy(std::next(other.data_.begin(), cStepSeqNote1Index),
+			std::next(other.data_.begin(), cStepSeqNote1Index + 6 * 64 * 2),
+			std::next(data_.begin(), cStepSeqNote1Index));
+		std::copy(std::next(other.data_.begin(), cLayerB + cStepSeqNote1Index),
+			std::next(other.data_.begin(), cLayerB + cStepSeqNote1Index + 6 * 64 * 2),
+			std::next(data_.begin(), cLayerB + cStepSeqNote1Index));
+
+		// Copy 4 tracks with 16 bytes each for the gated sequencer
+		std::copy(std::next(other.data_.begin(), cGatedSeqIndex),
+			std::next(other.data_.begin(), cGatedSeqIndex + 4 * 16),
+			std::next(data_.begin(), cGatedSeqIndex));
+		std::copy(std::next(other.data_.begin(), cLayerB + cGatedSeqIndex),
+			std::next(other.data_.begin(), cLayerB + cGatedSeqIndex + 4 * 16),
+			std::next(data_.begin(), cLayerB + cGatedSeqIndex));
+
+		// For the gated to work as expected, take over the switch as well which of the sequencers is on (poly or gated),
+		// and we need the gated destination for track 1 to be osc all frequencies
+		data_[cGatedSeqOnIndex] = other.data_[cGatedSeqOnIndex];
+		data_[cGatedSeqDestination] = other.data_[cGatedSeqDestination];
+		data_[cLayerB + cGatedSeqOnIndex] = other.data_[cLayerB + cGatedSeqOnIndex];
+		data_[cLayerB + cGatedSeqDestination] = other.data_[cLayerB + cGatedSeqDestination];
+
+		// Also copy over tempo and clock
+		data_[cBpmTempo] = other.data_[cBpmTempo];
+		data_[cClockDivide] = other.data_[cClockDivide];
+		data_[cLayerB + cBpmTempo] = other.data_[cLayerB + cBpmTempo];
+		data_[cLayerB + cClockDivide] = other.data_[cLayerB + cClockDivide];
+		return *this;
+	}
+
+}
@@ -0,0 +1,35 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include "Synth.h"
+
+namespace midikraft {
+
+	// The decoded 2048 bytes of a Rev2 program. The sequencer operations modify it in place and can be chained,
+	// so a sequence of edits costs one unescape when decoding and one escape when sending, see Rev2::decodeProgramEditBuffer()
+	class Rev2Program {
+	public:
+		Rev2Program();
+		explicit Rev2Program(Synth::PatchData decoded);
+
+		Synth::PatchData const &data() const;
+
+		Rev2Program &patchPolySequenceToGatedTrack(int gatedSeqTrack);
+		Rev2Program &clearPolySequencer(bool layerA, bool layerB);
+		Rev2Program &copySequencersFrom(Rev2Program const &other);
+
+	private:
+		// That's not very Rev2 specific
+		static uint8 clamp(int value, uint8 min = 0, uint8 max = 127);
+
+		Synth::PatchData data_;
+	};
+
+}
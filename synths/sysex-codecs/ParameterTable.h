@@ -0,0 +1,50 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace midikraft {
+
+	// One parameter stored in a bit field of a single patch byte. Synths describe their patch layout as a constexpr array of these,
+	// and build their polymorphic SynthParameterDefinition objects from it.
+	struct PackedParameterField {
+		int sysexIndex;
+		int bitOffset;
+		int bitWidth;
+		int minValue;
+		int maxValue;
+		char const *name;
+		char const *const *valueNames; // Optional names for the values 0 to numberOfValueNames - 1
+		int numberOfValueNames;
+	};
+
+	// Kernels working directly on the patch bytes. They neither allocate nor dispatch virtually.
+	class ParameterTable {
+	public:
+		static constexpr bool extract(PackedParameterField const &field, uint8_t const *data, size_t size, int &outValue) {
+			if (field.sysexIndex < 0 || static_cast<size_t>(field.sysexIndex) >= size) {
+				return false;
+			}
+			int value = (data[field.sysexIndex] >> field.bitOffset) & ((1 << field.bitWidth) - 1);
+			if (value < field.minValue || value > field.maxValue) {
+				return false;
+			}
+			outValue = value;
+			return true;
+		}
+
+		static constexpr char const *valueName(PackedParameterField const &field, int value) {
+			if (value >= 0 && value < field.numberOfValueNames) {
+				return field.valueNames[value];
+			}
+			return nullptr;
+		}
+	};
+
+}
@@ -0,0 +1,94 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#include "SysexCodecs.h"
+
+namespace midikraft {
+
+	size_t SysexCodecs::msbFirstPackedSize(size_t unpackedSize)
+	{
+		return unpackedSize + (unpackedSize + 6) / 7;
+	}
+
+	size_t SysexCodecs::msbFirstUnpackedSize(size_t packedSize)
+	{
+		// Every started block of 8 spends one byte on the MSBs
+		return packedSize - (packedSize + 7) / 8;
+	}
+
+	size_t SysexCodecs::packMsbFirst(uint8_t const *data, size_t size, uint8_t *out)
+	{
+		size_t fullBlocks = size / 7;
+		// Full blocks have a fixed length, so these loops have no data dependent branches
+		for (size_t block = 0; block < fullBlocks; block++) {
+			uint8_t const *in = data + block * 7;
+			uint8_t *o = out + block * 8;
+			uint8_t msbits = 0;
+			for (int i = 0; i < 7; i++) {
+				msbits |= (uint8_t)((in[i] & 0x80) >> (7 - i));
+				o[i + 1] = in[i] & 0x7f;
+			}
+			o[0] = msbits;
+		}
+		size_t written = fullBlocks * 8;
+		size_t rest = size - fullBlocks * 7;
+		if (rest > 0) {
+			uint8_t const *in = data + fullBlocks * 7;
+			uint8_t msbits = 0;
+			for (size_t i = 0; i < rest; i++) {
+				msbits |= (uint8_t)((in[i] & 0x80) >> (7 - i));
+				out[written + 1 + i] = in[i] & 0x7f;
+			}
+			out[written] = msbits;
+			written += rest + 1;
+		}
+		return written;
+	}
+
+	size_t SysexCodecs::unpackMsbFirst(uint8_t const *packed, size_t size, uint8_t *out)
+	{
+		size_t fullBlocks = size / 8;
+		for (size_t block = 0; block < fullBlocks; block++) {
+			uint8_t const *in = packed + block * 8;
+			uint8_t *o = out + block * 7;
+			uint8_t msbits = in[0];
+			for (int i = 0; i < 7; i++) {
+				o[i] = (uint8_t)(in[i + 1] | ((msbits << (7 - i)) & 0x80));
+			}
+		}
+		size_t written = fullBlocks * 7;
+		size_t rest = size - fullBlocks * 8;
+		if (rest > 1) {
+			// A short last block, the DSI synths terminate it instead of filling it up
+			uint8_t const *in = packed + fullBlocks * 8;
+			uint8_t msbits = in[0];
+			for (size_t i = 0; i < rest - 1; i++) {
+				out[written + i] = (uint8_t)(in[i + 1] | ((msbits << (7 - i)) & 0x80));
+			}
+			written += rest - 1;
+		}
+		return written;
+	}
+
+	size_t SysexCodecs::packNibbles(uint8_t const *data, size_t size, uint8_t *out)
+	{
+		for (size_t i = 0; i < size; i++) {
+			out[2 * i] = data[i] & 0x0f;
+			out[2 * i + 1] = (uint8_t)((data[i] & 0xf0) >> 4);
+		}
+		return size * 2;
+	}
+
+	size_t SysexCodecs::unpackNibbles(uint8_t const *packed, size_t size, uint8_t *out)
+	{
+		size_t count = size / 2;
+		for (size_t i = 0; i < count; i++) {
+			out[i] = (uint8_t)(packed[2 * i] | (packed[2 * i + 1] << 4));
+		}
+		return count;
+	}
+
+}
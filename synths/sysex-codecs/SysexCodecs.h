@@ -0,0 +1,32 @@
+/*
+   Copyright (c) 2021 Christof Ruch. All rights reserved.
+
+   Dual licensed: Distributed under Affero GPL license by default, an MIT license is available for purchase
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace midikraft {
+
+	// Pack and unpack kernels for 8 bit data sent via 7 bit sysex. They neither allocate nor check bounds per byte,
+	// the caller provides an output buffer of at least the size the matching ...Size() function returns.
+	class SysexCodecs {
+	public:
+		// MSB first scheme: 1 byte with the most significant bits of the following up to 7 bytes, the last block may be short
+		static size_t msbFirstPackedSize(size_t unpackedSize);
+		static size_t msbFirstUnpackedSize(size_t packedSize);
+		static size_t packMsbFirst(uint8_t const *data, size_t size, uint8_t *out);
+		static size_t unpackMsbFirst(uint8_t const *packed, size_t size, uint8_t *out);
+
+		// Nibble scheme: each byte is sent as its low nibble followed by its high nibble
+		static size_t nibblesPackedSize(size_t unpackedSize) { return unpackedSize * 2; }
+		static size_t nibblesUnpackedSize(size_t packedSize) { return packedSize / 2; }
+		static size_t packNibbles(uint8_t const *data, size_t size, uint8_t *out);
+		// Unpacks size / 2 bytes, ignoring an odd byte at the end
+		static size_t unpackNibbles(uint8_t const *packed, size_t size, uint8_t *out);
+	};
+
+}
@@ -67,8 +67,8 @@ namespace midikraft {
 	{
 		ignoreUnused(streamType); // Both stream types consist of the same message types
 		if (isOwnSysex(message)) {
-			TDataBlock block;
-			if (dataBlockFromDump(message, block)) {
+			TBlockAddress block;
+			if (blockAddressFromDump(message, block)) {
 				return (block.addressHigh == 0x0e && block.addressMid == 0x0f && block.addressLow == 0x00)  // Bulk header
 					|| (block.addressHigh == 0x0f && block.addressMid == 0x0f && block.addressLow == 0x00)  // Bulk footer
 					|| (block.addressHigh == 0x30 && block.addressMid == 0x00 && block.addressLow == 0x00)  // Common voice data
@@ -81,9 +81,10 @@ namespace midikraft {
 	bool RefaceDX::isStreamComplete(std::vector<MidiMessage> const &messages, StreamType streamType) const {
 		int headers, footers, common, operators;
 		headers = footers = common = operators = 0;
-		for (auto message : messages) {
-			TDataBlock block;
-			if (dataBlockFromDump(message, block)) {
+		// This is called for every message arriving, so only the block addresses are validated and nothing is copied
+		for (auto const &message : messages) {
+			TBlockAddress block;
+			if (blockAddressFromDump(message, block)) {
 				if (block.addressHigh == 0x0e && block.addressMid == 0x0f && block.addressLow == 0x00) headers++;
 				if (block.addressHigh == 0x0f && block.addressMid == 0x0f && block.addressLow == 0x00)  footers++;
 				if (block.addressHigh == 0x30 && block.addressMid == 0x00 && block.addressLow == 0x00)  common++;
@@ -108,9 +109,9 @@ namespace midikraft {
 	{
 		int headers, footers;
 		headers = footers = 0;
-		for (auto message : messages) {
-			TDataBlock block;
-			if (dataBlockFromDump(message, block)) {
+		for (auto const &message : messages) {
+			TBlockAddress block;
+			if (blockAddressFromDump(message, block)) {
 				if (block.addressHigh == 0x0e && block.addressMid == 0x0f && block.addressLow == 0x00) headers++;
 				if (block.addressHigh == 0x0f && block.addressMid == 0x0f && block.addressLow == 0x00)  footers++;
 			}
@@ -191,40 +192,43 @@ namespace midikraft {
 		midiControlOn_ = isOn;
 	}
 
-	bool RefaceDX::dataBlockFromDump(const MidiMessage &message, TDataBlock &outBlock) const {
+	bool RefaceDX::blockAddressFromDump(const MidiMessage &message, TBlockAddress &outAddress) const {
 		if (isOwnSysex(message)) {
 			// Check the number of bytes 
 			uint16 dataLength = ((uint16)message.getSysExData()[4]) << 7 | message.getSysExData()[5];
-			if (message.getSysExDataSize() == dataLength + 7) {
-				// Looks good up to here, now extract the data block, but don't copy the checksum (hence - 1)
-				outBlock.data.clear();
+			if (dataLength >= 4 && message.getSysExDataSize() == dataLength + 7) {
+				// Looks good up to here, the checksum covers address and data, but not itself (hence - 1)
+				const uint8 *payload = message.getSysExData() + 7;
 				int sum = 0;
 				for (int i = 0; i < dataLength - 1; i++) {
-					uint8 dataByte = message.getSysExData()[7 + i];
-					switch (i) {
-					case 0: outBlock.addressHigh = dataByte; break;
-					case 1: outBlock.addressMid = dataByte; break;
-					case 2: outBlock.addressLow = dataByte; break;
-					default:
-						outBlock.data.push_back(dataByte);
-					}
-					sum -= dataByte;
+					sum -= payload[i];
 				}
 				// Strangely, the Model ID 0x05 is included in the checksum. Manually add in back in here, as we did not get it out
 				uint8 checkSum = ((sum - 0x05) & 0x7f);
-				uint8 expected = message.getSysExData()[7 + dataLength - 1];
+				uint8 expected = payload[dataLength - 1];
 				if (checkSum == expected) {
+					outAddress.addressHigh = payload[0];
+					outAddress.addressMid = payload[1];
+					outAddress.addressLow = payload[2];
 					return true;
 				}
-				else {
-					// Checksum error
-					return false;
-				}
+				// Checksum error
 			}
 		}
 		return false;
 	}
 
+	bool RefaceDX::dataBlockFromDump(const MidiMessage &message, TDataBlock &outBlock) const {
+		if (blockAddressFromDump(message, outBlock)) {
+			// Copy the data following the address, but not the checksum
+			uint16 dataLength = ((uint16)message.getSysExData()[4]) << 7 | message.getSysExData()[5];
+			const uint8 *payload = message.getSysExData() + 7;
+			outBlock.data.assign(payload + 3, payload + dataLength - 1);
+			return true;
+		}
+		return false;
+	}
+
 	MidiMessage RefaceDX::buildDataBlockMessage(TDataBlock const &block) const {
 		std::vector<uint8> bulkDump(
 			{ 0x43 /* Yamaha */, (uint8)(0x00 /* bulk dump */ | deviceID_), 0x7f /* Group high */, 0x1c /* Group low */, 0, 0, 0x05 /* Model */,
@@ -327,10 +331,11 @@ namespace midikraft {
 	{
 		// Patches loaded from a list of MidiMessages... First we need to find complete "voices"
 		std::vector<RefaceDXPatch::TVoiceData> voiceData;
+		voiceData.reserve(32); // A full bank
 		bool patchActive = false;
 		int count = 0;
+		TDataBlock block;
 		for (const auto& message : sysexMessages) {
-			TDataBlock block;
 			if (dataBlockFromDump(message, block)) {
 				if (block.addressHigh == 0x0e && block.addressMid == 0x0f && block.addressLow == 0x00) {
 					// Bulk header
@@ -385,8 +390,10 @@ namespace midikraft {
 
 		// We now might have or not a list of valid VoiceData packages, which we can wrap into patch classes
 		TPatchVector result;
-		for (auto voice : voiceData) {
+		result.reserve(voiceData.size());
+		for (auto const &voice : voiceData) {
 			std::vector<uint8> aggregated;
+			aggregated.reserve(voice.common.size() + voice.op[0].size() * 4);
 			std::copy(voice.common.begin(), voice.common.end(), std::back_inserter(aggregated));
 			for (int op = 0; op < 4; op++) std::copy(voice.op[op].begin(), voice.op[op].end(), std::back_inserter(aggregated));
 			result.push_back(std::make_shared<RefaceDXPatch>(aggregated, MidiProgramNumber::fromZeroBase(voice.count)));
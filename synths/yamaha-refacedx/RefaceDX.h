@@ -66,13 +66,15 @@ namespace midikraft {
 		std::vector<MidiMessage> patchToSysex(std::shared_ptr<DataFile> patch) const;
 
 	private:
-		struct TDataBlock {
+		struct TBlockAddress {
+			uint8 addressHigh, addressMid, addressLow;
+		};
+
+		struct TDataBlock : public TBlockAddress {
 			TDataBlock() = default;
 			TDataBlock(uint8 hi, uint8 mid, uint8 low, std::vector<uint8>::const_iterator d, size_t bytes) :
-				addressHigh(hi), addressMid(mid), addressLow(low) {
-				std::copy(d, d + bytes, std::back_inserter(data));
+				TBlockAddress{ hi, mid, low }, data(d, d + bytes) {
 			}
-			uint8 addressHigh, addressMid, addressLow;
 			std::vector<uint8> data;
 		};
 
@@ -80,6 +82,8 @@ namespace midikraft {
 		juce::MidiMessage buildParameterChange(uint8 addressHigh, uint8 addressMid, uint8 addressLow, uint8 value);
 		MidiMessage buildDataBlockMessage(TDataBlock const &block) const;
 		bool dataBlockFromDump(const MidiMessage &message, TDataBlock &outBlock) const;
+		// Validates length and checksum of a bulk dump block, but only extracts the address
+		bool blockAddressFromDump(const MidiMessage &message, TBlockAddress &outAddress) const;
 
 		MidiChannel transmitChannel_ = MidiChannel::invalidChannel(); // The RefaceDX has separate send and receive channels!
 		bool localControl_ = false; // And it can also turn local control on and off